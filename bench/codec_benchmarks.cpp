@@ -0,0 +1,142 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffer_writer.h>
+
+#include "codec_schema.h"
+
+//
+// Encode and decode throughput of a nested schema with inline and out-of-line
+// codecs. Run with `make bench-codec`, which builds this benchmark twice, once
+// with the default inline encoders and once with NOP_BENCH_OUT_OF_LINE set,
+// prints the section sizes of both binaries, and runs them. The results are
+// written to out/codec_bench.json and out/codec_bench_out_of_line.json.
+//
+
+namespace {
+
+using codec_bench::Customer;
+using codec_bench::LineItem;
+using codec_bench::MakeOrder;
+using codec_bench::Money;
+using codec_bench::Order;
+using codec_bench::ReadInvoice;
+using codec_bench::WriteInvoice;
+
+struct SmallOrder {
+  using Type = Order;
+  static Type Make() { return MakeOrder(2); }
+};
+
+struct LargeOrder {
+  using Type = Order;
+  static Type Make() { return MakeOrder(256); }
+};
+
+struct Items {
+  using Type = std::vector<LineItem>;
+  static Type Make() { return MakeOrder(64).items; }
+};
+
+struct Customers {
+  using Type = std::vector<Customer>;
+  static Type Make() { return Type(32, MakeOrder(0).customer); }
+};
+
+template <typename T>
+std::vector<std::uint8_t> Encode(const T& value) {
+  std::vector<std::uint8_t> bytes(nop::Encoding<T>::Size(value));
+  nop::Serializer<nop::BufferWriter> serializer{bytes.data(), bytes.size()};
+  if (!serializer.Write(value))
+    std::abort();
+  return bytes;
+}
+
+template <typename Value>
+void BM_Encode(benchmark::State& state) {
+  const typename Value::Type value = Value::Make();
+  std::vector<std::uint8_t> buffer = Encode(value);
+
+  for (auto _ : state) {
+    nop::BufferWriter writer{buffer.data(), buffer.size()};
+    nop::Serializer<nop::BufferWriter*> serializer{&writer};
+    auto status = serializer.Write(value);
+    if (!status)
+      state.SkipWithError(status.GetErrorMessage());
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * buffer.size());
+}
+
+template <typename Value>
+void BM_Decode(benchmark::State& state) {
+  const std::vector<std::uint8_t> encoding = Encode(Value::Make());
+
+  typename Value::Type value{};
+  for (auto _ : state) {
+    nop::BufferReader reader{encoding.data(), encoding.size()};
+    nop::Deserializer<nop::BufferReader*> deserializer{&reader};
+    auto status = deserializer.Read(&value);
+    if (!status)
+      state.SkipWithError(status.GetErrorMessage());
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetBytesProcessed(state.iterations() * encoding.size());
+}
+
+// Round trip through the handlers in codec_invoice.cpp.
+void BM_Invoice(benchmark::State& state) {
+  const Order order = MakeOrder(16);
+  std::vector<std::uint8_t> buffer(nop::Encoding<Order>::Size(order));
+
+  Customer customer;
+  std::vector<LineItem> items;
+  Money total;
+  for (auto _ : state) {
+    nop::BufferWriter writer{buffer.data(), buffer.size()};
+    auto status = WriteInvoice(order, &writer);
+    if (!status)
+      state.SkipWithError(status.GetErrorMessage());
+
+    nop::BufferReader reader{buffer.data(), writer.size()};
+    status = ReadInvoice(&customer, &items, &total, &reader);
+    if (!status)
+      state.SkipWithError(status.GetErrorMessage());
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetBytesProcessed(state.iterations() * buffer.size());
+}
+
+}  // anonymous namespace
+
+#define NOP_BENCHMARK(value)          \
+  BENCHMARK_TEMPLATE(BM_Encode, value); \
+  BENCHMARK_TEMPLATE(BM_Decode, value)
+
+NOP_BENCHMARK(SmallOrder);
+NOP_BENCHMARK(LargeOrder);
+NOP_BENCHMARK(Items);
+NOP_BENCHMARK(Customers);
+BENCHMARK(BM_Invoice);
+
+BENCHMARK_MAIN();
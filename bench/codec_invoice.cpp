@@ -0,0 +1,47 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "codec_schema.h"
+
+namespace codec_bench {
+
+nop::Status<void> WriteInvoice(const Order& order, nop::BufferWriter* writer) {
+  nop::Serializer<nop::BufferWriter*> serializer{writer};
+  auto status = serializer.Write(order.customer);
+  if (!status)
+    return status;
+
+  status = serializer.Write(order.items);
+  if (!status)
+    return status;
+
+  return serializer.Write(order.total);
+}
+
+nop::Status<void> ReadInvoice(Customer* customer, std::vector<LineItem>* items,
+                              Money* total, nop::BufferReader* reader) {
+  nop::Deserializer<nop::BufferReader*> deserializer{reader};
+  auto status = deserializer.Read(customer);
+  if (!status)
+    return status;
+
+  status = deserializer.Read(items);
+  if (!status)
+    return status;
+
+  return deserializer.Read(total);
+}
+
+}  // namespace codec_bench
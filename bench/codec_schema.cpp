@@ -0,0 +1,54 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "codec_schema.h"
+
+namespace codec_bench {
+
+Order MakeOrder(std::size_t item_count) {
+  const Address address{"1600 Amphitheatre Parkway", "Mountain View", "CA",
+                        "94043", "US"};
+
+  Order order;
+  order.id = 0x1234567890ULL;
+  order.customer = {42, "Customer Name", "customer@example.com", address,
+                    address};
+  for (std::size_t i = 0; i < item_count; i++) {
+    order.items.push_back({1000000 + i,
+                           "Line item description",
+                           static_cast<std::uint32_t>(i % 5 + 1),
+                           {19, 990000000, "USD"},
+                           {"gift", "fragile"}});
+  }
+  order.total = {static_cast<std::int64_t>(20 * item_count), 0, "USD"};
+  order.attributes = {{"channel", "web"}, {"priority", "standard"}};
+  order.note = std::string{"Leave at the front door."};
+  return order;
+}
+
+}  // namespace codec_bench
+
+#if NOP_BENCH_OUT_OF_LINE
+NOP_DEFINE_CODEC(::codec_bench::Money, ::nop::BufferWriter,
+                 ::nop::BufferReader);
+NOP_DEFINE_CODEC(::codec_bench::Address, ::nop::BufferWriter,
+                 ::nop::BufferReader);
+NOP_DEFINE_CODEC(::codec_bench::LineItem, ::nop::BufferWriter,
+                 ::nop::BufferReader);
+NOP_DEFINE_CODEC(::codec_bench::Customer, ::nop::BufferWriter,
+                 ::nop::BufferReader);
+NOP_DEFINE_CODEC(::codec_bench::Order, ::nop::BufferWriter,
+                 ::nop::BufferReader);
+#endif
@@ -0,0 +1,109 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef LIBNOP_BENCH_CODEC_SCHEMA_H_
+#define LIBNOP_BENCH_CODEC_SCHEMA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nop/codec.h>
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/types/optional.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffer_writer.h>
+
+//
+// Schema shared by the inline and out-of-line builds of the codec benchmark.
+// When NOP_BENCH_OUT_OF_LINE is set the codecs of every type are declared here
+// and defined once in codec_schema.cpp.
+//
+
+namespace codec_bench {
+
+struct Money {
+  std::int64_t units;
+  std::int32_t nanos;
+  std::string currency;
+  NOP_STRUCTURE(Money, units, nanos, currency);
+};
+
+struct Address {
+  std::string street;
+  std::string city;
+  std::string region;
+  std::string postal_code;
+  std::string country;
+  NOP_STRUCTURE(Address, street, city, region, postal_code, country);
+};
+
+struct LineItem {
+  std::uint64_t sku;
+  std::string description;
+  std::uint32_t quantity;
+  Money unit_price;
+  std::vector<std::string> tags;
+  NOP_STRUCTURE(LineItem, sku, description, quantity, unit_price, tags);
+};
+
+struct Customer {
+  std::uint64_t id;
+  std::string name;
+  std::string email;
+  Address billing;
+  Address shipping;
+  NOP_STRUCTURE(Customer, id, name, email, billing, shipping);
+};
+
+struct Order {
+  std::uint64_t id;
+  Customer customer;
+  std::vector<LineItem> items;
+  Money total;
+  std::map<std::string, std::string> attributes;
+  nop::Optional<std::string> note;
+  NOP_STRUCTURE(Order, id, customer, items, total, attributes, note);
+};
+
+// Returns an order with |item_count| line items.
+Order MakeOrder(std::size_t item_count);
+
+// Writes and reads the billed parts of an order. These live in their own
+// translation unit, as the other modules of a program using the schema would,
+// so that the inline build carries a second copy of the nested encoders.
+nop::Status<void> WriteInvoice(const Order& order, nop::BufferWriter* writer);
+nop::Status<void> ReadInvoice(Customer* customer, std::vector<LineItem>* items,
+                              Money* total, nop::BufferReader* reader);
+
+}  // namespace codec_bench
+
+#if NOP_BENCH_OUT_OF_LINE
+NOP_DECLARE_CODEC(::codec_bench::Money, ::nop::BufferWriter,
+                  ::nop::BufferReader);
+NOP_DECLARE_CODEC(::codec_bench::Address, ::nop::BufferWriter,
+                  ::nop::BufferReader);
+NOP_DECLARE_CODEC(::codec_bench::LineItem, ::nop::BufferWriter,
+                  ::nop::BufferReader);
+NOP_DECLARE_CODEC(::codec_bench::Customer, ::nop::BufferWriter,
+                  ::nop::BufferReader);
+NOP_DECLARE_CODEC(::codec_bench::Order, ::nop::BufferWriter,
+                  ::nop::BufferReader);
+#endif
+
+#endif  // LIBNOP_BENCH_CODEC_SCHEMA_H_
@@ -0,0 +1,306 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/flat_hash_map.h>
+#include <nop/types/variant.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffer_writer.h>
+#include <nop/utility/fd_reader.h>
+#include <nop/utility/fd_writer.h>
+#include <nop/utility/stream_reader.h>
+#include <nop/utility/stream_writer.h>
+
+#include "../test/allocation_counter.h"
+
+//
+// Encode and decode throughput of each encoding across the buffer, stream,
+// and file descriptor readers and writers. Run with `make bench`, which writes
+// the results to out/bench.json. Each benchmark reports the bytes processed
+// per second and the number of heap allocations per iteration.
+//
+
+namespace {
+
+//
+// Values.
+//
+
+struct Record {
+  std::uint64_t id;
+  std::string name;
+  std::vector<float> samples;
+  NOP_STRUCTURE(Record, id, name, samples);
+};
+
+struct Settings {
+  nop::Entry<std::uint32_t, 0> version;
+  nop::Entry<std::string, 1> owner;
+  nop::Entry<std::vector<std::int32_t>, 2> limits;
+  nop::Entry<std::map<std::string, std::string>, 3> labels;
+  NOP_TABLE_NS("Settings", Settings, version, owner, limits, labels);
+};
+
+using Variant = nop::Variant<std::int32_t, std::string, std::vector<double>>;
+
+struct Int32 {
+  using Type = std::int32_t;
+  static Type Make() { return -100000; }
+};
+
+struct UInt64 {
+  using Type = std::uint64_t;
+  static Type Make() { return 0x123456789abcdefULL; }
+};
+
+struct String {
+  using Type = std::string;
+  static Type Make() { return std::string(256, 'x'); }
+};
+
+struct IntVector {
+  using Type = std::vector<std::int32_t>;
+  static Type Make() {
+    Type value;
+    for (std::int32_t i = 0; i < 1024; i++)
+      value.push_back(i * 1000 - 5000);
+    return value;
+  }
+};
+
+struct StringVector {
+  using Type = std::vector<std::string>;
+  static Type Make() { return Type(64, std::string(32, 's')); }
+};
+
+struct Map {
+  using Type = std::map<std::uint32_t, std::string>;
+  static Type Make() {
+    Type value;
+    for (std::uint32_t i = 0; i < 64; i++)
+      value.emplace(i * 7, std::string(16, 'm'));
+    return value;
+  }
+};
+
+// Large lookup tables decoded into node-based and open-addressing hash maps.
+template <typename MapType>
+struct LookupTable {
+  using Type = MapType;
+  static Type Make() {
+    Type value;
+    for (std::uint32_t i = 0; i < 65536; i++)
+      value.emplace(i * 2654435761u, i);
+    return value;
+  }
+};
+
+using UnorderedMap =
+    LookupTable<std::unordered_map<std::uint32_t, std::uint32_t>>;
+using FlatHashMap = LookupTable<nop::FlatHashMap<std::uint32_t, std::uint32_t>>;
+
+struct VariantValue {
+  using Type = Variant;
+  static Type Make() { return Variant{std::vector<double>(128, 1.5)}; }
+};
+
+struct Structure {
+  using Type = std::vector<Record>;
+  static Type Make() {
+    return Type(32, Record{123456789, "record", std::vector<float>(16, 2.5f)});
+  }
+};
+
+struct Table {
+  using Type = Settings;
+  static Type Make() {
+    Settings value;
+    value.version = 3;
+    value.owner = std::string{"owner"};
+    value.limits = std::vector<std::int32_t>(32, 100);
+    value.labels = std::map<std::string, std::string>{{"region", "west"},
+                                                      {"tier", "gold"}};
+    return value;
+  }
+};
+
+//
+// Readers and writers.
+//
+
+class BufferIO {
+ public:
+  using Writer = nop::BufferWriter;
+  using Reader = nop::BufferReader;
+
+  explicit BufferIO(const std::vector<std::uint8_t>& encoding)
+      : buffer_{encoding} {}
+
+  Writer MakeWriter() { return Writer{buffer_.data(), buffer_.size()}; }
+  Reader MakeReader() { return Reader{buffer_.data(), buffer_.size()}; }
+
+ private:
+  std::vector<std::uint8_t> buffer_;
+};
+
+class StreamIO {
+ public:
+  using Writer = nop::StreamWriter<std::stringstream>;
+  using Reader = nop::StreamReader<std::stringstream>;
+
+  explicit StreamIO(const std::vector<std::uint8_t>& encoding) {
+    reader_.stream().write(reinterpret_cast<const char*>(encoding.data()),
+                           encoding.size());
+  }
+
+  Writer& MakeWriter() {
+    writer_.stream().seekp(0);
+    return writer_;
+  }
+  Reader& MakeReader() {
+    reader_.stream().clear();
+    reader_.stream().seekg(0);
+    return reader_;
+  }
+
+ private:
+  Writer writer_;
+  Reader reader_;
+};
+
+// The writer and reader share the file offset of a temporary file through
+// duplicated descriptors, so seeking the original rewinds both.
+class FdIO {
+ public:
+  using Writer = nop::FdWriter;
+  using Reader = nop::FdReader;
+
+  explicit FdIO(const std::vector<std::uint8_t>& encoding)
+      : file_{std::tmpfile()},
+        writer_{::dup(fileno(file_))},
+        reader_{::dup(fileno(file_))} {
+    if (::write(fileno(file_), encoding.data(), encoding.size()) < 0)
+      std::abort();
+  }
+  ~FdIO() { std::fclose(file_); }
+
+  Writer& MakeWriter() { return Rewind(writer_); }
+  Reader& MakeReader() { return Rewind(reader_); }
+
+ private:
+  template <typename T>
+  T& Rewind(T& value) {
+    ::lseek(fileno(file_), 0, SEEK_SET);
+    return value;
+  }
+
+  std::FILE* file_;
+  Writer writer_;
+  Reader reader_;
+};
+
+//
+// Benchmarks.
+//
+
+template <typename T>
+std::vector<std::uint8_t> Encode(const T& value) {
+  std::vector<std::uint8_t> bytes(nop::Encoding<T>::Size(value));
+  nop::Serializer<nop::BufferWriter> serializer{bytes.data(), bytes.size()};
+  if (!serializer.Write(value))
+    std::abort();
+  return bytes;
+}
+
+void ReportCounters(benchmark::State& state, std::size_t size,
+                    std::size_t allocations) {
+  state.SetBytesProcessed(state.iterations() * size);
+  state.counters["allocations"] = benchmark::Counter(
+      static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+template <typename Value, typename IO>
+void BM_Encode(benchmark::State& state) {
+  const typename Value::Type value = Value::Make();
+  const std::vector<std::uint8_t> encoding = Encode(value);
+  IO io{encoding};
+
+  const nop::AllocationCounter counter;
+  for (auto _ : state) {
+    auto&& writer = io.MakeWriter();
+    nop::Serializer<typename IO::Writer*> serializer{&writer};
+    auto status = serializer.Write(value);
+    if (!status)
+      state.SkipWithError(status.GetErrorMessage());
+    benchmark::ClobberMemory();
+  }
+  ReportCounters(state, encoding.size(), counter.allocations());
+}
+
+template <typename Value, typename IO>
+void BM_Decode(benchmark::State& state) {
+  const std::vector<std::uint8_t> encoding = Encode(Value::Make());
+  IO io{encoding};
+
+  typename Value::Type value{};
+  const nop::AllocationCounter counter;
+  for (auto _ : state) {
+    auto&& reader = io.MakeReader();
+    nop::Deserializer<typename IO::Reader*> deserializer{&reader};
+    auto status = deserializer.Read(&value);
+    if (!status)
+      state.SkipWithError(status.GetErrorMessage());
+    benchmark::DoNotOptimize(value);
+  }
+  ReportCounters(state, encoding.size(), counter.allocations());
+}
+
+}  // anonymous namespace
+
+#define NOP_BENCHMARK_IO(value, io)        \
+  BENCHMARK_TEMPLATE(BM_Encode, value, io); \
+  BENCHMARK_TEMPLATE(BM_Decode, value, io)
+
+#define NOP_BENCHMARK(value)          \
+  NOP_BENCHMARK_IO(value, BufferIO);  \
+  NOP_BENCHMARK_IO(value, StreamIO);  \
+  NOP_BENCHMARK_IO(value, FdIO)
+
+NOP_BENCHMARK(Int32);
+NOP_BENCHMARK(UInt64);
+NOP_BENCHMARK(String);
+NOP_BENCHMARK(IntVector);
+NOP_BENCHMARK(StringVector);
+NOP_BENCHMARK(Map);
+NOP_BENCHMARK(UnorderedMap);
+NOP_BENCHMARK(FlatHashMap);
+NOP_BENCHMARK(VariantValue);
+NOP_BENCHMARK(Structure);
+NOP_BENCHMARK(Table);
+
+BENCHMARK_MAIN();
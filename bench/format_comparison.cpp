@@ -0,0 +1,334 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffer_writer.h>
+
+#include "../test/allocation_counter.h"
+
+#if NOP_BENCH_WITH_PROTOBUF
+#include "order.pb.h"
+#endif
+
+#if NOP_BENCH_WITH_FLATBUFFERS
+#include "order_generated.h"
+#endif
+
+#if NOP_BENCH_WITH_MSGPACK
+#include <msgpack.hpp>
+#endif
+
+//
+// Comparison of libnop with other serialization formats on the same nested
+// order record. Each format that is found when building is benchmarked on
+// encoding its own representation of the order into a reused buffer and on
+// decoding it back into a reused object. Each benchmark reports the encoded
+// size in bytes and the heap allocations per iteration. Run with
+// `make bench-formats`, which writes the results to out/format_bench.json.
+//
+// FlatBuffers are read in place rather than decoded, so decoding a FlatBuffer
+// verifies it and copies its fields into the application type, which is what
+// a consumer that keeps the data beyond the buffer has to do.
+//
+
+namespace {
+
+struct Customer {
+  std::string name;
+  std::string email;
+  NOP_STRUCTURE(Customer, name, email);
+};
+
+struct LineItem {
+  std::string sku;
+  std::uint32_t quantity;
+  double price;
+  NOP_STRUCTURE(LineItem, sku, quantity, price);
+};
+
+struct Order {
+  nop::Entry<std::uint64_t, 0> id;
+  nop::Entry<Customer, 1> customer;
+  nop::Entry<std::vector<LineItem>, 2> items;
+  nop::Entry<std::vector<std::string>, 3> tags;
+  nop::Entry<std::uint64_t, 4> timestamp;
+  NOP_TABLE_NS("Order", Order, id, customer, items, tags, timestamp);
+};
+
+Order MakeOrder() {
+  Order order;
+  order.id = 1234567890123ULL;
+  order.customer = Customer{"Ada Lovelace", "ada@example.com"};
+  order.items = std::vector<LineItem>{};
+  for (std::uint32_t i = 0; i < 16; i++) {
+    order.items.get().push_back(
+        LineItem{"SKU-" + std::to_string(100000 + i), i + 1, 9.99 * (i + 1)});
+  }
+  order.tags = std::vector<std::string>{"priority", "gift", "international"};
+  order.timestamp = 1526400000000ULL;
+  return order;
+}
+
+enum : std::size_t { kBufferSize = 4096 };
+
+class Nop {
+ public:
+  explicit Nop(const Order& order) : order_{order} {}
+
+  bool Encode() {
+    nop::Serializer<nop::BufferWriter> serializer{buffer_, kBufferSize};
+    if (!serializer.Write(order_))
+      return false;
+    size_ = serializer.writer().size();
+    return true;
+  }
+
+  bool Decode() {
+    nop::Deserializer<nop::BufferReader> deserializer{buffer_, size_};
+    return !!deserializer.Read(&decoded_);
+  }
+
+  std::size_t size() const { return size_; }
+
+ private:
+  Order order_;
+  Order decoded_;
+  std::uint8_t buffer_[kBufferSize];
+  std::size_t size_{0};
+};
+
+#if NOP_BENCH_WITH_PROTOBUF
+class Protobuf {
+ public:
+  explicit Protobuf(const Order& order) {
+    message_.set_id(order.id.get());
+    message_.mutable_customer()->set_name(order.customer.get().name);
+    message_.mutable_customer()->set_email(order.customer.get().email);
+    for (const LineItem& item : order.items.get()) {
+      nop::bench::pb::LineItem* message_item = message_.add_items();
+      message_item->set_sku(item.sku);
+      message_item->set_quantity(item.quantity);
+      message_item->set_price(item.price);
+    }
+    for (const std::string& tag : order.tags.get())
+      message_.add_tags(tag);
+    message_.set_timestamp(order.timestamp.get());
+  }
+
+  bool Encode() {
+    size_ = message_.ByteSizeLong();
+    return message_.SerializeToArray(buffer_, kBufferSize);
+  }
+
+  bool Decode() { return decoded_.ParseFromArray(buffer_, size_); }
+
+  std::size_t size() const { return size_; }
+
+ private:
+  nop::bench::pb::Order message_;
+  nop::bench::pb::Order decoded_;
+  std::uint8_t buffer_[kBufferSize];
+  std::size_t size_{0};
+};
+#endif
+
+#if NOP_BENCH_WITH_FLATBUFFERS
+class FlatBuffers {
+ public:
+  explicit FlatBuffers(const Order& order) : order_{order} {}
+
+  bool Encode() {
+    namespace fb = nop::bench::fb;
+    builder_.Clear();
+
+    const Customer& customer = order_.customer.get();
+    auto customer_offset =
+        fb::CreateCustomer(builder_, builder_.CreateString(customer.name),
+                           builder_.CreateString(customer.email));
+
+    std::vector<flatbuffers::Offset<fb::LineItem>> items;
+    for (const LineItem& item : order_.items.get()) {
+      items.push_back(fb::CreateLineItem(
+          builder_, builder_.CreateString(item.sku), item.quantity,
+          item.price));
+    }
+    auto items_offset = builder_.CreateVector(items);
+    auto tags_offset = builder_.CreateVectorOfStrings(order_.tags.get());
+
+    fb::FinishOrderBuffer(
+        builder_, fb::CreateOrder(builder_, order_.id.get(), customer_offset,
+                                  items_offset, tags_offset,
+                                  order_.timestamp.get()));
+    return true;
+  }
+
+  bool Decode() {
+    namespace fb = nop::bench::fb;
+    flatbuffers::Verifier verifier{builder_.GetBufferPointer(),
+                                   builder_.GetSize()};
+    if (!fb::VerifyOrderBuffer(verifier))
+      return false;
+
+    const fb::Order* order = fb::GetOrder(builder_.GetBufferPointer());
+    if (!order->customer() || !order->items() || !order->tags())
+      return false;
+
+    decoded_.id = order->id();
+    decoded_.customer = Customer{order->customer()->name()->str(),
+                                 order->customer()->email()->str()};
+    decoded_.items = std::vector<LineItem>{};
+    for (const fb::LineItem* item : *order->items()) {
+      decoded_.items.get().push_back(
+          LineItem{item->sku()->str(), item->quantity(), item->price()});
+    }
+    decoded_.tags = std::vector<std::string>{};
+    for (const flatbuffers::String* tag : *order->tags())
+      decoded_.tags.get().push_back(tag->str());
+    decoded_.timestamp = order->timestamp();
+    return true;
+  }
+
+  std::size_t size() const { return builder_.GetSize(); }
+
+ private:
+  Order order_;
+  Order decoded_;
+  flatbuffers::FlatBufferBuilder builder_{kBufferSize};
+};
+#endif
+
+#if NOP_BENCH_WITH_MSGPACK
+struct MsgpackCustomer {
+  std::string name;
+  std::string email;
+  MSGPACK_DEFINE(name, email);
+};
+
+struct MsgpackLineItem {
+  std::string sku;
+  std::uint32_t quantity;
+  double price;
+  MSGPACK_DEFINE(sku, quantity, price);
+};
+
+struct MsgpackOrder {
+  std::uint64_t id;
+  MsgpackCustomer customer;
+  std::vector<MsgpackLineItem> items;
+  std::vector<std::string> tags;
+  std::uint64_t timestamp;
+  MSGPACK_DEFINE(id, customer, items, tags, timestamp);
+};
+
+class Msgpack {
+ public:
+  explicit Msgpack(const Order& order) {
+    order_.id = order.id.get();
+    order_.customer = MsgpackCustomer{order.customer.get().name,
+                                       order.customer.get().email};
+    for (const LineItem& item : order.items.get())
+      order_.items.push_back({item.sku, item.quantity, item.price});
+    order_.tags = order.tags.get();
+    order_.timestamp = order.timestamp.get();
+  }
+
+  bool Encode() {
+    buffer_.clear();
+    msgpack::pack(buffer_, order_);
+    return true;
+  }
+
+  bool Decode() {
+    msgpack::object_handle handle =
+        msgpack::unpack(buffer_.data(), buffer_.size());
+    handle.get().convert(decoded_);
+    return true;
+  }
+
+  std::size_t size() const { return buffer_.size(); }
+
+ private:
+  MsgpackOrder order_;
+  MsgpackOrder decoded_;
+  msgpack::sbuffer buffer_{kBufferSize};
+};
+#endif
+
+void ReportCounters(benchmark::State& state, std::size_t size,
+                    std::size_t allocations) {
+  state.counters["bytes"] = static_cast<double>(size);
+  state.counters["allocations"] = benchmark::Counter(
+      static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+template <typename Format>
+void BM_Encode(benchmark::State& state) {
+  std::unique_ptr<Format> format{new Format{MakeOrder()}};
+
+  const nop::AllocationCounter counter;
+  for (auto _ : state) {
+    if (!format->Encode())
+      state.SkipWithError("Failed to encode.");
+    benchmark::ClobberMemory();
+  }
+  ReportCounters(state, format->size(), counter.allocations());
+}
+
+template <typename Format>
+void BM_Decode(benchmark::State& state) {
+  std::unique_ptr<Format> format{new Format{MakeOrder()}};
+  if (!format->Encode())
+    std::abort();
+
+  const nop::AllocationCounter counter;
+  for (auto _ : state) {
+    if (!format->Decode())
+      state.SkipWithError("Failed to decode.");
+    benchmark::ClobberMemory();
+  }
+  ReportCounters(state, format->size(), counter.allocations());
+}
+
+}  // anonymous namespace
+
+BENCHMARK_TEMPLATE(BM_Encode, Nop);
+BENCHMARK_TEMPLATE(BM_Decode, Nop);
+
+#if NOP_BENCH_WITH_PROTOBUF
+BENCHMARK_TEMPLATE(BM_Encode, Protobuf);
+BENCHMARK_TEMPLATE(BM_Decode, Protobuf);
+#endif
+
+#if NOP_BENCH_WITH_FLATBUFFERS
+BENCHMARK_TEMPLATE(BM_Encode, FlatBuffers);
+BENCHMARK_TEMPLATE(BM_Decode, FlatBuffers);
+#endif
+
+#if NOP_BENCH_WITH_MSGPACK
+BENCHMARK_TEMPLATE(BM_Encode, Msgpack);
+BENCHMARK_TEMPLATE(BM_Decode, Msgpack);
+#endif
+
+BENCHMARK_MAIN();
@@ -0,0 +1,334 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/rpc/interface.h>
+#include <nop/rpc/shared_memory_channel.h>
+#include <nop/rpc/simple_method_receiver.h>
+#include <nop/rpc/simple_method_sender.h>
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/buffered_fd_reader.h>
+#include <nop/utility/buffered_fd_writer.h>
+
+//
+// End-to-end RPC latency and throughput of SimpleMethodSender and
+// SimpleMethodReceiver over pipes, Unix domain sockets, TCP loopback, and
+// SharedMemoryChannel. Each call sends a payload of the given size to a server
+// thread, which echoes it back. Run with `make bench-rpc`; the results are
+// written to out/rpc_bench.json.
+//
+// Every benchmark thread has its own connection and server thread, so the
+// thread count is the number of concurrent clients. Besides the time per call,
+// each run reports the round-trip latency percentiles of a single call in
+// microseconds, averaged over the clients, and the total calls per second.
+//
+
+namespace {
+
+using nop::BindInterface;
+using nop::BufferedFdReader;
+using nop::BufferedFdWriter;
+using nop::Deserializer;
+using nop::Interface;
+using nop::Serializer;
+using nop::SharedMemoryChannel;
+using nop::SharedMemoryEndpoint;
+using nop::Status;
+
+struct Message {
+  std::uint64_t id;
+  std::vector<std::uint8_t> payload;
+
+  NOP_STRUCTURE(Message, id, payload);
+};
+
+struct EchoInterface : Interface<EchoInterface> {
+  NOP_INTERFACE("io.github.eieio.bench.Echo");
+
+  NOP_METHOD(Echo, Message(const Message& message));
+
+  NOP_INTERFACE_API(Echo);
+};
+
+const auto kBindings = BindInterface(
+    EchoInterface::Echo::Bind([](const Message& message) { return message; }));
+
+//
+// Transports. Each one connects a client to a server thread that dispatches
+// calls until the client disconnects.
+//
+
+using StreamSerializer = Serializer<BufferedFdWriter<>>;
+using StreamDeserializer = Deserializer<BufferedFdReader<>>;
+
+// Client and server ends of a stream transport, as file descriptors for each
+// direction. The descriptors may refer to the same socket.
+struct StreamFds {
+  int client_read;
+  int client_write;
+  int server_read;
+  int server_write;
+};
+
+bool MakePipes(StreamFds* fds) {
+  int requests[2];
+  int responses[2];
+  if (::pipe(requests) < 0)
+    return false;
+  if (::pipe(responses) < 0) {
+    ::close(requests[0]);
+    ::close(requests[1]);
+    return false;
+  }
+
+  // Large payloads would otherwise block in the default 64KiB pipe buffer
+  // before the other side starts reading.
+  ::fcntl(requests[1], F_SETPIPE_SZ, 1 << 20);
+  ::fcntl(responses[1], F_SETPIPE_SZ, 1 << 20);
+
+  *fds = {responses[0], requests[1], requests[0], responses[1]};
+  return true;
+}
+
+// Splits a pair of connected sockets into separately owned read and write
+// descriptors.
+bool SplitSockets(int client, int server, StreamFds* fds) {
+  *fds = {client, ::dup(client), server, ::dup(server)};
+  return fds->client_write >= 0 && fds->server_write >= 0;
+}
+
+bool MakeUnixSockets(StreamFds* fds) {
+  int sockets[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0)
+    return false;
+  return SplitSockets(sockets[0], sockets[1], fds);
+}
+
+bool MakeTcpLoopback(StreamFds* fds) {
+  const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (listener < 0)
+    return false;
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  const int client = ::socket(AF_INET, SOCK_STREAM, 0);
+  int server = -1;
+  if (client >= 0 &&
+      ::bind(listener, reinterpret_cast<sockaddr*>(&address), length) == 0 &&
+      ::listen(listener, 1) == 0 &&
+      ::getsockname(listener, reinterpret_cast<sockaddr*>(&address),
+                    &length) == 0 &&
+      ::connect(client, reinterpret_cast<sockaddr*>(&address), length) == 0) {
+    server = ::accept(listener, nullptr, nullptr);
+  }
+  ::close(listener);
+  if (server < 0) {
+    ::close(client);
+    return false;
+  }
+
+  // Small calls must not wait for Nagle's algorithm to coalesce them.
+  const int enable = 1;
+  ::setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+  ::setsockopt(server, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+  return SplitSockets(client, server, fds);
+}
+
+// Transport over a pair of byte streams made by MakeFds.
+template <bool (*MakeFds)(StreamFds*)>
+class StreamTransport {
+ public:
+  using Sender = nop::SimpleMethodSender<StreamSerializer, StreamDeserializer>;
+
+  StreamTransport() {
+    StreamFds fds;
+    if (!MakeFds(&fds))
+      return;
+
+    serializer_ = std::make_unique<StreamSerializer>(fds.client_write);
+    deserializer_ = std::make_unique<StreamDeserializer>(fds.client_read);
+    sender_ = std::make_unique<Sender>(serializer_.get(), deserializer_.get());
+
+    server_ = std::thread{[fds] {
+      StreamSerializer serializer{fds.server_write};
+      StreamDeserializer deserializer{fds.server_read};
+      auto receiver =
+          nop::MakeSimpleMethodReceiver(&serializer, &deserializer);
+      while (kBindings(&receiver)) {
+      }
+    }};
+  }
+
+  // Closing the client ends makes the server read the end of the stream.
+  ~StreamTransport() {
+    sender_.reset();
+    serializer_.reset();
+    deserializer_.reset();
+    if (server_.joinable())
+      server_.join();
+  }
+
+  bool is_valid() const { return sender_ != nullptr; }
+  Sender* sender() { return sender_.get(); }
+
+ private:
+  std::unique_ptr<StreamSerializer> serializer_;
+  std::unique_ptr<StreamDeserializer> deserializer_;
+  std::unique_ptr<Sender> sender_;
+  std::thread server_;
+};
+
+using Pipe = StreamTransport<MakePipes>;
+using UnixSocket = StreamTransport<MakeUnixSockets>;
+using TcpLoopback = StreamTransport<MakeTcpLoopback>;
+
+// Transport over a SharedMemoryChannel in an anonymous shared mapping.
+class SharedMemory {
+ public:
+  using Sender = SharedMemoryEndpoint::Sender;
+
+  // Each ring holds one call with the largest payload benchmarked.
+  enum : std::size_t { kRingCapacity = 1 << 18, kBulkCapacity = 4096 };
+
+  SharedMemory()
+      : size_{SharedMemoryChannel::RegionSize(kRingCapacity, kBulkCapacity)},
+        memory_{::mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0)} {
+    if (memory_ == MAP_FAILED)
+      return;
+
+    SharedMemoryChannel channel{memory_, kRingCapacity, kBulkCapacity};
+    if (!channel.Initialize())
+      return;
+
+    client_ = std::make_unique<SharedMemoryEndpoint>(
+        channel, SharedMemoryEndpoint::Side::Client);
+    server_ = std::thread{[channel] {
+      SharedMemoryEndpoint server{channel, SharedMemoryEndpoint::Side::Server};
+      while (server.Dispatch(kBindings)) {
+      }
+    }};
+  }
+
+  ~SharedMemory() {
+    client_.reset();
+    if (server_.joinable())
+      server_.join();
+    if (memory_ != MAP_FAILED)
+      ::munmap(memory_, size_);
+  }
+
+  bool is_valid() const { return client_ != nullptr; }
+  Sender* sender() { return client_->sender(); }
+
+ private:
+  std::size_t size_;
+  void* memory_;
+  std::unique_ptr<SharedMemoryEndpoint> client_;
+  std::thread server_;
+};
+
+//
+// Benchmarks.
+//
+
+// Returns the given percentile of |latencies|, reordering them.
+double Percentile(std::vector<double>* latencies, double percentile) {
+  if (latencies->empty())
+    return 0;
+
+  const std::size_t index = std::min(
+      latencies->size() - 1,
+      static_cast<std::size_t>(percentile * latencies->size() / 100));
+  std::nth_element(latencies->begin(), latencies->begin() + index,
+                   latencies->end());
+  return (*latencies)[index];
+}
+
+template <typename Transport>
+void BM_RoundTrip(benchmark::State& state) {
+  Transport transport;
+  if (!transport.is_valid()) {
+    state.SkipWithError("Failed to connect the transport.");
+    return;
+  }
+
+  Message message{0, std::vector<std::uint8_t>(state.range(0), 0xa5)};
+  std::vector<double> latencies;
+  latencies.reserve(state.max_iterations);
+
+  for (auto _ : state) {
+    const auto start = std::chrono::steady_clock::now();
+    auto status = EchoInterface::Echo::Invoke(transport.sender(), message);
+    const auto end = std::chrono::steady_clock::now();
+    if (!status) {
+      state.SkipWithError(status.GetErrorMessage());
+      break;
+    }
+
+    benchmark::DoNotOptimize(status);
+    latencies.push_back(
+        std::chrono::duration<double, std::micro>(end - start).count());
+    message.id++;
+  }
+
+  state.SetBytesProcessed(state.iterations() * 2 * message.payload.size());
+  state.counters["calls"] = benchmark::Counter(
+      static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+  state.counters["p50_us"] = benchmark::Counter(
+      Percentile(&latencies, 50), benchmark::Counter::kAvgThreads);
+  state.counters["p99_us"] = benchmark::Counter(
+      Percentile(&latencies, 99), benchmark::Counter::kAvgThreads);
+  state.counters["p999_us"] = benchmark::Counter(
+      Percentile(&latencies, 99.9), benchmark::Counter::kAvgThreads);
+}
+
+void PayloadSizes(benchmark::internal::Benchmark* benchmark) {
+  for (int size : {0, 64, 1024, 16 * 1024, 64 * 1024})
+    benchmark->Arg(size);
+}
+
+}  // anonymous namespace
+
+#define NOP_RPC_BENCHMARK(transport)          \
+  BENCHMARK_TEMPLATE(BM_RoundTrip, transport) \
+      ->Apply(PayloadSizes)                   \
+      ->ThreadRange(1, 4)                     \
+      ->UseRealTime()
+
+NOP_RPC_BENCHMARK(Pipe);
+NOP_RPC_BENCHMARK(UnixSocket);
+NOP_RPC_BENCHMARK(TcpLoopback);
+NOP_RPC_BENCHMARK(SharedMemory);
+
+BENCHMARK_MAIN();
@@ -17,6 +17,7 @@
 // library. The shared library is loaded using the ctypes module.
 //
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <vector>
@@ -80,6 +81,9 @@ struct CPolyhedron {
 // Assert that Polyhedron and CPolyhedron have compatible wire formats.
 static_assert(nop::IsFungible<Polyhedron, CPolyhedron>::value, "");
 
+// Assert that Triangle may be viewed from python as nine packed floats.
+static_assert(sizeof(Triangle) == 9 * sizeof(float), "");
+
 }  // anonymous namespace
 
 // Fills the given buffer with a pre-defined Polyhedron.
@@ -122,3 +126,70 @@ extern "C" ssize_t DeserializePolyhedron(CPolyhedron* poly, const void* buffer,
   else
     return 0;
 }
+
+// Fills the given buffer with |count| pre-defined Polyhedrons, one after the
+// other. Polyhedron i has i % 4 triangles.
+extern "C" ssize_t GetSerializedPolyhedra(void* buffer, size_t buffer_size,
+                                          size_t count) {
+  nop::Serializer<nop::BufferWriter> serializer{buffer, buffer_size};
+
+  Polyhedron polyhedron;
+  for (size_t i = 0; i < count; i++) {
+    const float base = static_cast<float>(i);
+    polyhedron.triangles.assign(
+        i % 4, Triangle{{base, base, base}, {base, 0.f, 0.f}, {0.f, 0.f, 0.f}});
+
+    auto status = nop::Protocol<Polyhedron>::Write(&serializer, polyhedron);
+    if (!status)
+      return -static_cast<ssize_t>(status.error());
+  }
+
+  return serializer.writer().size();
+}
+
+// Deserializes a sequence of Polyhedrons from the given buffer in one call, for
+// callers where the cost of each call dominates the cost of decoding a small
+// message. The triangles of every message are stored one after the other in
+// |triangles| and the triangles of message i are those in the range
+// [offsets[i], offsets[i + 1]), so |offsets| is one longer than the number of
+// messages decoded.
+//
+// Decoding stops at the end of the buffer, or before the first message that
+// does not fit in |triangles| or |offsets|. The number of bytes consumed is
+// stored in |bytes_read| so that the caller may continue from there with
+// another call. Returns the number of messages decoded, or a negative error
+// code.
+extern "C" ssize_t DeserializePolyhedra(const void* buffer, size_t buffer_size,
+                                        size_t* bytes_read, Triangle* triangles,
+                                        size_t triangle_capacity,
+                                        size_t* offsets,
+                                        size_t offset_capacity) {
+  nop::Deserializer<nop::BufferReader> deserializer{buffer, buffer_size};
+  *bytes_read = 0;
+  if (offset_capacity == 0)
+    return 0;
+
+  // Reuse the same vector for every message to avoid allocating once the
+  // largest message has been seen.
+  Polyhedron polyhedron;
+  size_t count = 0;
+  offsets[0] = 0;
+  while (deserializer.reader().remaining() != 0 &&
+         count + 1 < offset_capacity) {
+    auto status = nop::Protocol<Polyhedron>::Read(&deserializer, &polyhedron);
+    if (!status)
+      return -static_cast<ssize_t>(status.error());
+
+    const size_t size = polyhedron.triangles.size();
+    if (size > triangle_capacity - offsets[count])
+      break;
+
+    std::copy(polyhedron.triangles.begin(), polyhedron.triangles.end(),
+              triangles + offsets[count]);
+    offsets[count + 1] = offsets[count] + size;
+    *bytes_read = buffer_size - deserializer.reader().remaining();
+    count++;
+  }
+
+  return count;
+}
@@ -17,10 +17,18 @@
 # library. The shared library is loaded using the ctypes module.
 #
 
+from __future__ import print_function
+
+import binascii
 from ctypes import *
 import sys
 import os
 
+try:
+  import numpy
+except ImportError:
+  numpy = None
+
 # Define ctypes structures that mirror the basic protocol types.
 
 # Three component vector of floats.
@@ -79,6 +87,8 @@ def LoadProtocolLibrary():
   global GetSerializedPolyhedron
   global SerializePolyhedron
   global DeserializePolyhedron
+  global GetSerializedPolyhedra
+  global DeserializePolyhedra
 
   # Load the shared library.
   ProtocolLibrary = cdll.LoadLibrary('out/shared_protocol.so')
@@ -96,6 +106,52 @@ def LoadProtocolLibrary():
   DeserializePolyhedron.argtypes = (POINTER(PolyhedronBase), c_void_p, c_size_t)
   DeserializePolyhedron.restype = c_ssize_t
 
+  GetSerializedPolyhedra = ProtocolLibrary.GetSerializedPolyhedra
+  GetSerializedPolyhedra.argtypes = (c_void_p, c_size_t, c_size_t)
+  GetSerializedPolyhedra.restype = c_ssize_t
+
+  DeserializePolyhedra = ProtocolLibrary.DeserializePolyhedra
+  DeserializePolyhedra.argtypes = (c_void_p, c_size_t, POINTER(c_size_t),
+                                   c_void_p, c_size_t, c_void_p, c_size_t)
+  DeserializePolyhedra.restype = c_ssize_t
+
+# Decodes every Polyhedron in |payload|, which may be any object supporting the
+# buffer protocol, such as bytes, a memoryview, an mmap, or a numpy array.
+# Messages are decoded in batches of up to |batch_size| per native call directly
+# into preallocated numpy arrays, without copying the payload.
+#
+# Returns a tuple (triangles, offsets) where triangles is an array of shape
+# (N, 3, 3) holding the vertices of every triangle and the triangles of message
+# i are triangles[offsets[i]:offsets[i + 1]].
+def DecodePolyhedra(payload, batch_size=4096, triangle_capacity=65536):
+  data = numpy.frombuffer(payload, dtype=numpy.uint8)
+  triangles = numpy.empty((triangle_capacity, 3, 3), dtype=numpy.float32)
+  offsets = [numpy.zeros(1, dtype=numpy.uintp)]
+  offset_batch = numpy.empty(batch_size + 1, dtype=numpy.uintp)
+  bytes_read = c_size_t(0)
+  position = 0
+  triangle_count = 0
+
+  while position < len(data):
+    count = DeserializePolyhedra(
+        data.ctypes.data + position, len(data) - position, byref(bytes_read),
+        triangles.ctypes.data + triangle_count * triangles.itemsize * 9,
+        triangle_capacity - triangle_count, offset_batch.ctypes.data,
+        len(offset_batch))
+    if count < 0:
+      raise IOError('Error decoding polyhedra: %d' % -count)
+    elif count == 0:
+      # A single message needs more room than is left; grow and try again.
+      triangle_capacity *= 2
+      triangles.resize((triangle_capacity, 3, 3), refcheck=False)
+      continue
+
+    offsets.append(offset_batch[1:count + 1] + triangle_count)
+    triangle_count = int(offsets[-1][-1])
+    position += bytes_read.value
+
+  return triangles[:triangle_count], numpy.concatenate(offsets)
+
 def main():
   LoadProtocolLibrary()
 
@@ -113,30 +169,45 @@ def main():
 
   count = SerializePolyhedron(polyhedron, payload_buffer, len(payload_buffer))
   if count >= 0:
-    print count, 'bytes:', payload_buffer[0:count].encode('hex')
+    print(count, 'bytes:', binascii.hexlify(payload_buffer[0:count]))
   else:
-    print 'Error:', -count
+    print('Error:', -count)
 
   # Create an empty Polyhedron that can hold up to 10 triangles read the payload.
   polyhedron = Polyhedron(reserve=10)
 
   count = DeserializePolyhedron(polyhedron, payload_buffer, len(payload_buffer))
   if count >= 0:
-    print polyhedron
+    print(polyhedron)
   else:
-    print 'Error:', -count
+    print('Error:', -count)
 
   # Get a serialized Polyhedron from the library and then deserialize it.
   count = GetSerializedPolyhedron(payload_buffer, len(payload_buffer))
   if count < 0:
-    print 'Error:', -count
+    print('Error:', -count)
     return;
 
   count = DeserializePolyhedron(polyhedron, payload_buffer, len(payload_buffer))
   if count >= 0:
-    print polyhedron
+    print(polyhedron)
   else:
-    print 'Error:', -count
+    print('Error:', -count)
+
+  # Decode a large batch of messages in a few native calls.
+  if numpy is None:
+    print('Install numpy to decode batches of messages.')
+    return
+
+  batch_buffer = create_string_buffer(1 << 20)
+  size = GetSerializedPolyhedra(batch_buffer, len(batch_buffer), 10000)
+  if size < 0:
+    print('Error:', -size)
+    return
+
+  triangles, offsets = DecodePolyhedra(memoryview(batch_buffer)[0:size])
+  print(len(offsets) - 1, 'messages,', len(triangles), 'triangles,',
+        'first vertex of last triangle:', triangles[-1][0])
 
 if __name__ == '__main__':
   main()
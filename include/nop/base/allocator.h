@@ -0,0 +1,83 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_ALLOCATOR_H_
+#define LIBNOP_INCLUDE_NOP_BASE_ALLOCATOR_H_
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace nop {
+
+//
+// Support for allocator-aware decoding.
+//
+// Containers construct the elements they hold through their allocator, which
+// passes itself on to elements that use allocators when it is a scoped or
+// polymorphic allocator. Elements that are decoded before being inserted into
+// a container must be constructed the same way, or else they allocate from
+// the default allocator and are copied when inserted. MakeWithAllocator()
+// constructs a value following the uses-allocator convention so that the whole
+// decoded object graph comes from the allocator of the outermost container.
+//
+
+namespace detail {
+
+template <typename T, typename Allocator>
+using UsesLeadingAllocator = std::integral_constant<
+    bool, std::uses_allocator<T, Allocator>::value &&
+              std::is_constructible<T, std::allocator_arg_t,
+                                    const Allocator&>::value>;
+
+template <typename T, typename Allocator>
+using UsesTrailingAllocator = std::integral_constant<
+    bool, std::uses_allocator<T, Allocator>::value &&
+              !UsesLeadingAllocator<T, Allocator>::value &&
+              std::is_constructible<T, const Allocator&>::value>;
+
+template <typename T, typename Allocator>
+std::enable_if_t<UsesLeadingAllocator<T, Allocator>::value, T>
+MakeWithAllocator(const Allocator& allocator) {
+  return T(std::allocator_arg, allocator);
+}
+
+template <typename T, typename Allocator>
+std::enable_if_t<UsesTrailingAllocator<T, Allocator>::value, T>
+MakeWithAllocator(const Allocator& allocator) {
+  return T(allocator);
+}
+
+template <typename T, typename Allocator>
+std::enable_if_t<!std::uses_allocator<T, Allocator>::value, T>
+MakeWithAllocator(const Allocator& /*allocator*/) {
+  return T{};
+}
+
+// Pairs do not use allocators themselves; each member is constructed with the
+// allocator instead.
+template <typename First, typename Second, typename Allocator>
+std::pair<First, Second> MakePairWithAllocator(const Allocator& allocator) {
+  return std::pair<First, Second>{MakeWithAllocator<First>(allocator),
+                                  MakeWithAllocator<Second>(allocator)};
+}
+
+}  // namespace detail
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_ALLOCATOR_H_
@@ -20,6 +20,7 @@
 #include <array>
 
 #include <nop/base/encoding.h>
+#include <nop/base/fixint_array.h>
 #include <nop/base/utility.h>
 
 namespace nop {
@@ -94,13 +95,7 @@ struct Encoding<std::array<T, Length>, EnableIfNotIntegral<T>>
     else if (size != Length)
       return ErrorStatus::InvalidContainerLength;
 
-    for (SizeType i = 0; i < Length; i++) {
-      status = Encoding<T>::Read(&(*value)[i], reader);
-      if (!status)
-        return status;
-    }
-
-    return {};
+    return detail::ReadElements(value->data(), value->data() + Length, reader);
   }
 };
 
@@ -152,13 +147,7 @@ struct Encoding<T[Length], EnableIfNotIntegral<T>> : EncodingIO<T[Length]> {
     else if (size != Length)
       return ErrorStatus::InvalidContainerLength;
 
-    for (SizeType i = 0; i < Length; i++) {
-      status = Encoding<T>::Read(&(*value)[i], reader);
-      if (!status)
-        return status;
-    }
-
-    return {};
+    return detail::ReadElements(*value, *value + Length, reader);
   }
 };
 
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_BIT_ARRAY_H_
+#define LIBNOP_INCLUDE_NOP_BASE_BIT_ARRAY_H_
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <nop/base/encoding.h>
+
+namespace nop {
+
+//
+// std::vector<bool> and std::bitset<N> encoding format:
+//
+// +-----+------------+---//----+
+// | BIT | INT64:BITS | L BYTES |
+// +-----+------------+---//----+
+//
+// Where L = ceil(BITS / 8). Bit i is stored in bit i % 8 of byte i / 8, least
+// significant bit first, and the unused high bits of the last byte are zero.
+// std::bitset<N> requires BITS == N.
+//
+
+namespace detail {
+
+// Number of packed bytes staged on the stack for each writer or reader call.
+enum : std::size_t { kBitArrayBlockSize = 512 };
+
+// Returns the number of bytes that |count| bits pack into.
+constexpr SizeType BitArrayBytes(SizeType count) {
+  return count / 8 + (count % 8 != 0);
+}
+
+// Writes the bit count and the packed bits of |bits|, which may be any type
+// with an operator[] returning bool, such as std::vector<bool> or std::bitset.
+template <typename Bits, typename Writer>
+Status<void> WriteBitArray(const Bits& bits, std::size_t count,
+                           Writer* writer) {
+  auto status = Encoding<SizeType>::Write(count, writer);
+  if (!status)
+    return status;
+
+  std::uint8_t block[kBitArrayBlockSize];
+  std::size_t index = 0;
+  while (index < count) {
+    const std::size_t block_bits =
+        std::min<std::size_t>(count - index, kBitArrayBlockSize * 8);
+    const std::size_t length = BitArrayBytes(block_bits);
+    for (std::size_t i = 0; i < length; i++) {
+      const std::size_t byte_bits = std::min<std::size_t>(count - index, 8);
+      std::uint8_t byte = 0;
+      for (std::size_t bit = 0; bit < byte_bits; bit++)
+        byte |= static_cast<std::uint8_t>(bits[index + bit]) << bit;
+      block[i] = byte;
+      index += byte_bits;
+    }
+
+    status = writer->Write(block, block + length);
+    if (!status)
+      return status;
+  }
+  return {};
+}
+
+// Reads |count| packed bits into |bits|, which must hold at least |count| bits.
+template <typename Bits, typename Reader>
+Status<void> ReadBitArray(Bits* bits, std::size_t count, Reader* reader) {
+  std::uint8_t block[kBitArrayBlockSize];
+  std::size_t index = 0;
+  while (index < count) {
+    const std::size_t block_bits =
+        std::min<std::size_t>(count - index, kBitArrayBlockSize * 8);
+    const std::size_t length = BitArrayBytes(block_bits);
+    auto status = reader->Read(block, block + length);
+    if (!status)
+      return status;
+
+    for (std::size_t i = 0; i < length; i++) {
+      const std::size_t byte_bits = std::min<std::size_t>(count - index, 8);
+      const std::uint8_t byte = block[i];
+      if (byte >> byte_bits != 0)
+        return ErrorStatus::InvalidContainerLength;
+      for (std::size_t bit = 0; bit < byte_bits; bit++)
+        (*bits)[index + bit] = (byte >> bit) & 1;
+      index += byte_bits;
+    }
+  }
+  return {};
+}
+
+}  // namespace detail
+
+template <typename Allocator>
+struct Encoding<std::vector<bool, Allocator>>
+    : EncodingIO<std::vector<bool, Allocator>> {
+  using Type = std::vector<bool, Allocator>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::BitArray;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(value.size()) +
+           detail::BitArrayBytes(value.size());
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::BitArray;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    return detail::WriteBitArray(value, value.size(), writer);
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
+                                            Type* value, Reader* reader) {
+    SizeType count = 0;
+    auto status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+
+    // Make sure the reader has enough data to fulfill the requested size as a
+    // defense against abusive or erroneous vector sizes.
+    status = reader->Ensure(detail::BitArrayBytes(count));
+    if (!status)
+      return status;
+
+    value->resize(count);
+    return detail::ReadBitArray(value, count, reader);
+  }
+};
+
+template <std::size_t Size_>
+struct Encoding<std::bitset<Size_>> : EncodingIO<std::bitset<Size_>> {
+  using Type = std::bitset<Size_>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::BitArray;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(Size_) +
+           detail::BitArrayBytes(Size_);
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::BitArray;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    return detail::WriteBitArray(value, Size_, writer);
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
+                                            Type* value, Reader* reader) {
+    SizeType count = 0;
+    auto status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+    else if (count != Size_)
+      return ErrorStatus::InvalidContainerLength;
+
+    return detail::ReadBitArray(value, Size_, reader);
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_BIT_ARRAY_H_
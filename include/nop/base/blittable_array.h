@@ -0,0 +1,139 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_BLITTABLE_ARRAY_H_
+#define LIBNOP_INCLUDE_NOP_BASE_BLITTABLE_ARRAY_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <nop/base/encoding.h>
+#include <nop/base/vector.h>
+#include <nop/schema_fingerprint.h>
+#include <nop/types/blittable_array.h>
+
+namespace nop {
+
+//
+// BlittableArray<T> encoding format:
+//
+// +-----+---------+--------+---//----+
+// | BIN | INT64:L | UINT64 | N * S   |
+// +-----+---------+--------+---//----+
+//
+// Where S = sizeof(T) and L = 8 + N * S. The UINT64 is the little-endian
+// layout fingerprint of T, BlittableLayout<T>::Fingerprint, followed by the
+// object representations of the N elements.
+//
+// The decoder also accepts the encodings of std::vector<T>, decoding each
+// element normally.
+//
+
+// Provides the layout fingerprint of blittable type T: its schema fingerprint
+// combined with its size.
+template <typename T>
+struct BlittableLayout {
+  enum : std::uint64_t {
+    Fingerprint = detail::Fingerprint(detail::FingerprintKind::Layout,
+                                      SchemaFingerprint<T>::Value, sizeof(T))
+  };
+};
+
+template <typename T, typename Allocator>
+struct Encoding<BlittableArray<T, Allocator>>
+    : EncodingIO<BlittableArray<T, Allocator>> {
+  using Type = BlittableArray<T, Allocator>;
+  using VectorType = typename Type::VectorType;
+
+  enum : std::size_t { FingerprintSize = sizeof(std::uint64_t) };
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    const SizeType size = PayloadSize(value);
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(size) +
+           size;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary ||
+           Encoding<VectorType>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    auto status = Encoding<SizeType>::Write(PayloadSize(value), writer);
+    if (!status)
+      return status;
+
+    const std::uint64_t fingerprint = BlittableLayout<T>::Fingerprint;
+    status = writer->Write(&fingerprint, &fingerprint + 1);
+    if (!status)
+      return status;
+
+    const VectorType& elements = value.get();
+    const std::uint8_t* begin =
+        reinterpret_cast<const std::uint8_t*>(elements.data());
+    return writer->Write(begin, begin + elements.size() * sizeof(T));
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    if (prefix != EncodingByte::Binary)
+      return Encoding<VectorType>::ReadPayload(prefix, &value->get(), reader);
+
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+    else if (size < FingerprintSize ||
+             (size - FingerprintSize) % sizeof(T) != 0)
+      return ErrorStatus::InvalidContainerLength;
+
+    // Make sure the reader has enough data to fulfill the requested size as a
+    // defense against abusive or erroneous sizes.
+    status = reader->Ensure(size);
+    if (!status)
+      return status;
+
+    std::uint64_t fingerprint = 0;
+    status = reader->Read(&fingerprint, &fingerprint + 1);
+    if (!status)
+      return status;
+    else if (fingerprint != BlittableLayout<T>::Fingerprint)
+      return ErrorStatus::VersionMismatch;
+
+    VectorType& elements = value->get();
+    elements.resize((size - FingerprintSize) / sizeof(T));
+    std::uint8_t* begin = reinterpret_cast<std::uint8_t*>(elements.data());
+    return reader->Read(begin, begin + elements.size() * sizeof(T));
+  }
+
+ private:
+  static constexpr SizeType PayloadSize(const Type& value) {
+    return FingerprintSize + value.get().size() * sizeof(T);
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_BLITTABLE_ARRAY_H_
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_CACHED_H_
+#define LIBNOP_INCLUDE_NOP_BASE_CACHED_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/recording_reader.h>
+#include <nop/base/size_cache.h>
+#include <nop/base/skip.h>
+#include <nop/base/utility.h>
+#include <nop/types/cached.h>
+
+namespace nop {
+
+//
+// Cached<T> encoding format:
+//
+// +---//----+
+// | ELEMENT |
+// +---//----+
+//
+// Element must be a valid encoding of type T. The element is written by
+// copying the bytes retained by the Cached<T>. During deserialization the
+// element is decoded as type T while its bytes, including the prefix, are
+// recorded and retained for the next time the value is written. Values read
+// with a string dictionary, object table, or chunk store are encoded afresh
+// instead.
+//
+
+template <typename T>
+struct Encoding<Cached<T>> : EncodingIO<Cached<T>> {
+  using Type = Cached<T>;
+
+  static constexpr EncodingByte Prefix(const Type& value) {
+    return value.encoding_.empty()
+               ? Encoding<T>::Prefix(value.value_)
+               : static_cast<EncodingByte>(value.encoding_[0]);
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache) {
+    return value.encoding_.empty() ? CachedSize(value.value_, cache)
+                                   : value.encoding_.size();
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<T>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte prefix,
+                                             const Type& value,
+                                             Writer* writer) {
+    if (value.encoding_.empty()) {
+      return Encoding<T>::WritePayload(prefix, value.value_, writer);
+    } else {
+      const std::uint8_t* begin = value.encoding_.data();
+      return writer->Write(begin + 1, begin + value.encoding_.size());
+    }
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    // Values read with session state are encoded again without it, since their
+    // definitions and references only make sense in the current session.
+    if (detail::HasSessionState(reader)) {
+      auto status = Encoding<T>::ReadPayload(prefix, &value->value_, reader);
+      if (!status)
+        return status;
+
+      value->Encode();
+      return {};
+    }
+
+    // Reuse the capacity of the previous encoding.
+    std::vector<std::uint8_t> bytes = std::move(value->encoding_);
+    bytes.clear();
+    bytes.push_back(static_cast<std::uint8_t>(prefix));
+
+    detail::RecordingReader<Reader> recording_reader{reader, &bytes};
+    auto status =
+        Encoding<T>::ReadPayload(prefix, &value->value_, &recording_reader);
+    if (!status)
+      return status;
+
+    value->SetEncoding(std::move(bytes));
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_CACHED_H_
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_CANONICAL_H_
+#define LIBNOP_INCLUDE_NOP_BASE_CANONICAL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/traits/is_canonical_writer.h>
+#include <nop/types/handle.h>
+
+namespace nop {
+
+//
+// Support for the canonical encoding of unordered containers.
+//
+// The canonical order of a container is the order of the encoded bytes of its
+// keys, compared lexicographically. Keys are encoded to a temporary buffer to
+// be sorted, since their encoded order generally differs from any ordering of
+// the keys themselves.
+//
+
+namespace detail {
+
+// Writer that appends the encoding of keys to a buffer. Handles are pushed to
+// the writer of the container, so that the references written match the
+// handles that writer sends, and nested containers in the keys are also
+// written canonically.
+template <typename Writer>
+class CanonicalKeyWriter {
+ public:
+  CanonicalKeyWriter(Writer* writer, std::vector<std::uint8_t>* buffer)
+      : writer_{writer}, buffer_{buffer} {}
+
+  Status<void> Prepare(std::size_t size) {
+    buffer_->reserve(buffer_->size() + size);
+    return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) {
+    buffer_->push_back(byte);
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::uint8_t* first = reinterpret_cast<const std::uint8_t*>(begin);
+    const std::uint8_t* last = reinterpret_cast<const std::uint8_t*>(end);
+    buffer_->insert(buffer_->end(), first, last);
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    buffer_->insert(buffer_->end(), padding_bytes, padding_value);
+    return {};
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    return writer_->PushHandle(handle);
+  }
+
+  bool canonical() const { return true; }
+
+ private:
+  Writer* writer_;
+  std::vector<std::uint8_t>* buffer_;
+};
+
+// Writes the elements of the map |value| ordered by the encoded bytes of their
+// keys. The element count must already have been written.
+template <typename Key, typename T, typename Map, typename Writer>
+Status<void> WriteCanonicalMap(const Map& value, Writer* writer) {
+  struct Element {
+    std::size_t begin;
+    std::size_t end;
+    const T* value;
+  };
+
+  std::vector<std::uint8_t> keys;
+  std::vector<Element> elements;
+  elements.reserve(value.size());
+
+  CanonicalKeyWriter<Writer> key_writer{writer, &keys};
+  for (const auto& element : value) {
+    const std::size_t begin = keys.size();
+    auto status = Encoding<Key>::Write(element.first, &key_writer);
+    if (!status)
+      return status;
+
+    elements.push_back({begin, keys.size(), &element.second});
+  }
+
+  const std::uint8_t* data = keys.data();
+  std::sort(elements.begin(), elements.end(),
+            [data](const Element& a, const Element& b) {
+              return std::lexicographical_compare(
+                  data + a.begin, data + a.end, data + b.begin, data + b.end);
+            });
+
+  for (const Element& element : elements) {
+    auto status = writer->Write(data + element.begin, data + element.end);
+    if (!status)
+      return status;
+
+    status = Encoding<T>::Write(*element.value, writer);
+    if (!status)
+      return status;
+  }
+
+  return {};
+}
+
+}  // namespace detail
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_CANONICAL_H_
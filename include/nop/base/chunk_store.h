@@ -0,0 +1,242 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_CHUNK_STORE_H_
+#define LIBNOP_INCLUDE_NOP_BASE_CHUNK_STORE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/traits/is_detected.h>
+#include <nop/types/flat_hash_map.h>
+#include <nop/utility/content_chunker.h>
+#include <nop/utility/sip_hash.h>
+
+namespace nop {
+
+//
+// Chunk stores hold the session state of the ChunkedBlob encoding. A writer
+// carrying a ChunkEncodeStore splits each blob into content-defined chunks and
+// sends only the chunks the peer does not already hold, referring to the
+// others by id; a reader carrying a ChunkDecodeStore keeps the chunks it
+// receives and resolves references to them. Blobs sent as plain binary are
+// split into chunks on both ends as well, so the first copy of some data
+// defines the chunks that later copies refer to.
+//
+// A chunk id is the 128-bit SipHash of the chunk bytes, computed with the same
+// key on both ends. Receivers check the id of every chunk they are sent, so a
+// keyed hash prevents untrusted senders from planting chunks under the id of
+// other content.
+//
+// Both ends must see the same sequence of chunks: the stores must use the same
+// chunker and be created, limited, and reset at the same points in the stream
+// on either end. Each
+// store holds chunks totalling up to limit() bytes; once it is full new chunks
+// are sent in full without being kept, which bounds the memory used on both
+// ends. A receiver that already holds chunks, for instance from an earlier
+// session, lists them with entries() so that the sender can Define() each of
+// them, which keeps the sizes of the two stores in step.
+//
+
+using ChunkId = std::array<std::uint64_t, 2>;
+
+namespace detail {
+
+struct ChunkIdHash {
+  std::size_t operator()(const ChunkId& id) const {
+    return static_cast<std::size_t>(id[0] ^ id[1]);
+  }
+};
+
+}  // namespace detail
+
+class ChunkEncodeStore {
+ public:
+  enum : std::size_t { kDefaultLimit = 256 * 1024 * 1024 };
+
+  ChunkEncodeStore() = default;
+  explicit ChunkEncodeStore(std::size_t limit,
+                            const ContentChunker& chunker = ContentChunker{})
+      : limit_{limit}, chunker_{chunker} {}
+
+  // Returns true if the peer holds the chunk with |id|.
+  bool Contains(const ChunkId& id) const { return sizes_.contains(id); }
+
+  // Records that the peer holds the chunk with |id| of |size| bytes. Returns
+  // false if the chunk is already recorded or the store is full.
+  bool Define(const ChunkId& id, std::size_t size) {
+    if (size > limit_ - std::min(bytes_, limit_) || sizes_.contains(id))
+      return false;
+
+    sizes_.emplace(id, size);
+    bytes_ += size;
+    return true;
+  }
+
+  // Returns the id of the |size| bytes at |data|.
+  ChunkId Hash(const std::uint8_t* data, std::size_t size) const {
+    return SipHasher<128>::Compute(data, size, key_[0], key_[1]);
+  }
+
+  // Forgets all chunks.
+  void Reset() {
+    sizes_.clear();
+    bytes_ = 0;
+  }
+
+  std::size_t size() const { return sizes_.size(); }
+  std::size_t bytes() const { return bytes_; }
+  std::size_t limit() const { return limit_; }
+
+  // Sets the number of bytes of chunks the store may hold. Chunks already
+  // defined beyond a lower limit remain defined until the next Reset().
+  void set_limit(std::size_t limit) { limit_ = limit; }
+
+  // Sets the SipHash key used to compute chunk ids, which must match the key
+  // of the peer.
+  void set_key(std::uint64_t k0, std::uint64_t k1) { key_ = {{k0, k1}}; }
+
+  const ContentChunker& chunker() const { return chunker_; }
+  void set_chunker(const ContentChunker& chunker) { chunker_ = chunker; }
+
+ private:
+  FlatHashMap<ChunkId, std::size_t, detail::ChunkIdHash> sizes_;
+  std::size_t bytes_{0};
+  std::size_t limit_{kDefaultLimit};
+  ChunkId key_{{0, 0}};
+  ContentChunker chunker_;
+};
+
+class ChunkDecodeStore {
+ public:
+  enum : std::size_t { kDefaultLimit = ChunkEncodeStore::kDefaultLimit };
+
+  using Chunk = std::shared_ptr<const std::vector<std::uint8_t>>;
+
+  ChunkDecodeStore() = default;
+  explicit ChunkDecodeStore(std::size_t limit,
+                            const ContentChunker& chunker = ContentChunker{})
+      : limit_{limit}, chunker_{chunker} {}
+
+  // Returns true if the chunk with |id| is kept.
+  bool Contains(const ChunkId& id) const { return chunks_.contains(id); }
+
+  // Returns the chunk with |id|.
+  Status<Chunk> Find(const ChunkId& id) const {
+    auto search = chunks_.find(id);
+    if (search == chunks_.end())
+      return ErrorStatus::InvalidChunkReference;
+    else
+      return search->second;
+  }
+
+  // Keeps |chunk| under |id|. Returns false if a chunk with |id| is already
+  // kept or the store is full, since the writer would not have defined it
+  // either.
+  bool Define(const ChunkId& id, Chunk chunk) {
+    const std::size_t size = chunk->size();
+    if (size > limit_ - std::min(bytes_, limit_) || chunks_.contains(id))
+      return false;
+
+    chunks_.emplace(id, std::move(chunk));
+    bytes_ += size;
+    return true;
+  }
+
+  // Returns the id of the |size| bytes at |data|.
+  ChunkId Hash(const std::uint8_t* data, std::size_t size) const {
+    return SipHasher<128>::Compute(data, size, key_[0], key_[1]);
+  }
+
+  // Returns the id and size of each chunk kept, in no particular order, for the
+  // sender to Define() when the store outlives a session.
+  std::vector<std::pair<ChunkId, std::size_t>> entries() const {
+    std::vector<std::pair<ChunkId, std::size_t>> entries;
+    entries.reserve(chunks_.size());
+    for (const auto& entry : chunks_)
+      entries.emplace_back(entry.first, entry.second->size());
+    return entries;
+  }
+
+  // Forgets all chunks.
+  void Reset() {
+    chunks_.clear();
+    bytes_ = 0;
+  }
+
+  std::size_t size() const { return chunks_.size(); }
+  std::size_t bytes() const { return bytes_; }
+  std::size_t limit() const { return limit_; }
+
+  // Sets the number of bytes of chunks the store may hold. Chunks already
+  // defined beyond a lower limit remain defined until the next Reset().
+  void set_limit(std::size_t limit) { limit_ = limit; }
+
+  // Sets the SipHash key used to check chunk ids, which must match the key of
+  // the peer.
+  void set_key(std::uint64_t k0, std::uint64_t k1) { key_ = {{k0, k1}}; }
+
+  const ContentChunker& chunker() const { return chunker_; }
+  void set_chunker(const ContentChunker& chunker) { chunker_ = chunker; }
+
+ private:
+  FlatHashMap<ChunkId, Chunk, detail::ChunkIdHash> chunks_;
+  std::size_t bytes_{0};
+  std::size_t limit_{kDefaultLimit};
+  ChunkId key_{{0, 0}};
+  ContentChunker chunker_;
+};
+
+// Test expression for writers and readers that carry a chunk store.
+template <typename WriterOrReader>
+using ChunkStoreTest = decltype(std::declval<WriterOrReader&>().chunk_store());
+
+// Returns the ChunkEncodeStore carried by |writer|, if any.
+template <typename Writer>
+std::enable_if_t<IsDetected<ChunkStoreTest, Writer>::value, ChunkEncodeStore*>
+GetChunkEncodeStore(Writer* writer) {
+  return writer->chunk_store();
+}
+
+template <typename Writer>
+std::enable_if_t<!IsDetected<ChunkStoreTest, Writer>::value, ChunkEncodeStore*>
+GetChunkEncodeStore(Writer* /*writer*/) {
+  return nullptr;
+}
+
+// Returns the ChunkDecodeStore carried by |reader|, if any.
+template <typename Reader>
+std::enable_if_t<IsDetected<ChunkStoreTest, Reader>::value, ChunkDecodeStore*>
+GetChunkDecodeStore(Reader* reader) {
+  return reader->chunk_store();
+}
+
+template <typename Reader>
+std::enable_if_t<!IsDetected<ChunkStoreTest, Reader>::value, ChunkDecodeStore*>
+GetChunkDecodeStore(Reader* /*reader*/) {
+  return nullptr;
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_CHUNK_STORE_H_
@@ -0,0 +1,303 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_CHUNKED_BLOB_H_
+#define LIBNOP_INCLUDE_NOP_BASE_CHUNKED_BLOB_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <nop/base/chunk_store.h>
+#include <nop/base/encoding.h>
+#include <nop/base/vector.h>
+#include <nop/types/chunked_blob.h>
+
+namespace nop {
+
+//
+// ChunkedBlob encoding formats:
+//
+// +-----+---------+---//----+
+// | BIN | INT64:N | N BYTES |
+// +-----+---------+---//----+
+//
+// +-----+---------+---------+------//-----+
+// | CKM | INT64:L | INT64:N | N ENTRIES   |
+// +-----+---------+---------+------//-----+
+//
+// A chunk manifest (CKM) holds L bytes of data split into N chunks. Each entry
+// is the id of a chunk as two U64 words, low word first, followed by either
+// the chunk bytes as BIN or NIL when the peer holds the chunk already. Chunk
+// manifests are only written to writers that carry a chunk store, for data
+// longer than the minimum chunk size, and only when the manifest is smaller
+// than the BIN encoding; otherwise the data is written as BIN. Either way
+// both ends keep the chunks of the data in their chunk stores.
+//
+// The size computed for a ChunkedBlob is that of the BIN encoding, which is
+// never less than the encoding actually written.
+//
+
+namespace detail {
+
+// A chunk of the data of a ChunkedBlob, as planned for a chunk manifest.
+struct ManifestEntry {
+  std::size_t offset;
+  std::size_t size;
+  ChunkId id;
+  bool send;
+};
+
+}  // namespace detail
+
+template <>
+struct Encoding<ChunkedBlob> : EncodingIO<ChunkedBlob> {
+  using Type = ChunkedBlob;
+  using Bytes = std::vector<std::uint8_t>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static std::size_t Size(const Type& value) {
+    return Encoding<Bytes>::Size(value.get());
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary ||
+           prefix == EncodingByte::ChunkManifest;
+  }
+
+  // Writes a chunk manifest for |value| if |writer| carries a chunk store and
+  // the manifest is smaller than the data, otherwise the data itself.
+  template <typename Writer>
+  static Status<void> Write(const Type& value, Writer* writer) {
+    ChunkEncodeStore* store = GetChunkEncodeStore(writer);
+    if (store && value.size() > store->chunker().min_size()) {
+      // The chunks defined while planning are kept by the reader whether
+      // they are sent in the manifest or as part of the data.
+      std::vector<detail::ManifestEntry> entries;
+      if (PlanManifest(value, store, &entries) < Size(value))
+        return WriteManifest(value, entries, writer);
+    }
+
+    auto status =
+        writer->Write(static_cast<std::uint8_t>(EncodingByte::Binary));
+    if (!status)
+      return status;
+
+    return WritePayload(EncodingByte::Binary, value, writer);
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    return Encoding<Bytes>::WritePayload(EncodingByte::Binary, value.get(),
+                                         writer);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                  Reader* reader) {
+    ChunkDecodeStore* store = GetChunkDecodeStore(reader);
+    if (prefix == EncodingByte::Binary) {
+      auto status = Encoding<Bytes>::ReadPayload(prefix, &value->get(), reader);
+      if (!status)
+        return status;
+
+      if (store && value->size() > store->chunker().min_size())
+        DefineChunks(*value, store);
+      return {};
+    }
+
+    SizeType length = 0;
+    auto status = Encoding<SizeType>::Read(&length, reader);
+    if (!status)
+      return status;
+
+    SizeType count = 0;
+    status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+
+    Bytes& data = value->get();
+    data.clear();
+    for (SizeType i = 0; i < count; i++) {
+      ChunkId id;
+      status = Encoding<std::uint64_t>::Read(&id[0], reader);
+      if (!status)
+        return status;
+      status = Encoding<std::uint64_t>::Read(&id[1], reader);
+      if (!status)
+        return status;
+
+      status = ReadChunk(id, length - data.size(), store, &data, reader);
+      if (!status)
+        return status;
+    }
+
+    if (data.size() != length)
+      return ErrorStatus::InvalidContainerLength;
+    return {};
+  }
+
+ private:
+  // Splits |value| into chunks, defining in |store| the chunks the peer does
+  // not hold, and returns the size of the manifest.
+  static std::size_t PlanManifest(const Type& value, ChunkEncodeStore* store,
+                                  std::vector<detail::ManifestEntry>* entries) {
+    std::size_t size = 0;
+    std::size_t offset = 0;
+    store->chunker().ForEachChunk(
+        value.data(), value.size(),
+        [&](const std::uint8_t* chunk, std::size_t chunk_size) {
+          detail::ManifestEntry entry{offset, chunk_size,
+                                      store->Hash(chunk, chunk_size), false};
+          if (!store->Contains(entry.id)) {
+            entry.send = true;
+            store->Define(entry.id, chunk_size);
+          }
+
+          size += Encoding<std::uint64_t>::Size(entry.id[0]) +
+                  Encoding<std::uint64_t>::Size(entry.id[1]);
+          if (entry.send) {
+            size += BaseEncodingSize(EncodingByte::Binary) +
+                    Encoding<SizeType>::Size(chunk_size) + chunk_size;
+          } else {
+            size += BaseEncodingSize(EncodingByte::Nil);
+          }
+
+          offset += chunk_size;
+          entries->push_back(entry);
+        });
+
+    return BaseEncodingSize(EncodingByte::ChunkManifest) +
+           Encoding<SizeType>::Size(value.size()) +
+           Encoding<SizeType>::Size(entries->size()) + size;
+  }
+
+  template <typename Writer>
+  static Status<void> WriteManifest(
+      const Type& value, const std::vector<detail::ManifestEntry>& entries,
+      Writer* writer) {
+    auto status =
+        writer->Write(static_cast<std::uint8_t>(EncodingByte::ChunkManifest));
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(entries.size(), writer);
+    if (!status)
+      return status;
+
+    for (const detail::ManifestEntry& entry : entries) {
+      status = Encoding<std::uint64_t>::Write(entry.id[0], writer);
+      if (!status)
+        return status;
+      status = Encoding<std::uint64_t>::Write(entry.id[1], writer);
+      if (!status)
+        return status;
+
+      if (entry.send) {
+        status = writer->Write(static_cast<std::uint8_t>(EncodingByte::Binary));
+        if (!status)
+          return status;
+
+        const std::uint8_t* begin = value.data() + entry.offset;
+        status = Encoding<SizeType>::Write(entry.size, writer);
+        if (!status)
+          return status;
+        status = writer->Write(begin, begin + entry.size);
+      } else {
+        status = writer->Write(static_cast<std::uint8_t>(EncodingByte::Nil));
+      }
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  // Keeps the chunks of |value|, received as BIN, as the writer did.
+  static void DefineChunks(const Type& value, ChunkDecodeStore* store) {
+    store->chunker().ForEachChunk(
+        value.data(), value.size(),
+        [store](const std::uint8_t* chunk, std::size_t chunk_size) {
+          const ChunkId id = store->Hash(chunk, chunk_size);
+          if (!store->Contains(id)) {
+            store->Define(id, std::make_shared<const Bytes>(
+                                  chunk, chunk + chunk_size));
+          }
+        });
+  }
+
+  // Reads the chunk with |id|, either sent in full or held in |store|, and
+  // appends it to |data|. The chunk must be at most |remaining| bytes.
+  template <typename Reader>
+  static Status<void> ReadChunk(const ChunkId& id, std::size_t remaining,
+                                ChunkDecodeStore* store, Bytes* data,
+                                Reader* reader) {
+    std::uint8_t prefix_byte = 0;
+    auto status = reader->Read(&prefix_byte);
+    if (!status)
+      return status;
+
+    const EncodingByte prefix = static_cast<EncodingByte>(prefix_byte);
+    if (prefix == EncodingByte::Nil) {
+      if (!store)
+        return ErrorStatus::InvalidChunkReference;
+
+      auto chunk = store->Find(id);
+      if (!chunk)
+        return chunk.error();
+      else if (chunk.get()->size() > remaining)
+        return ErrorStatus::InvalidContainerLength;
+
+      status = detail::ChargeAllocation(chunk.get()->size(), 1, reader);
+      if (!status)
+        return status;
+
+      data->insert(data->end(), chunk.get()->begin(), chunk.get()->end());
+      return {};
+    } else if (prefix != EncodingByte::Binary) {
+      return ErrorStatus::UnexpectedEncodingType;
+    }
+
+    auto chunk = std::make_shared<Bytes>();
+    status = Encoding<Bytes>::ReadPayload(prefix, chunk.get(), reader);
+    if (!status)
+      return status;
+    else if (chunk->size() > remaining)
+      return ErrorStatus::InvalidContainerLength;
+
+    data->insert(data->end(), chunk->begin(), chunk->end());
+    if (store) {
+      if (store->Hash(chunk->data(), chunk->size()) != id)
+        return ErrorStatus::ChecksumMismatch;
+      store->Define(id, std::move(chunk));
+    }
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_CHUNKED_BLOB_H_
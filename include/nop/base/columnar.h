@@ -0,0 +1,410 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_COLUMNAR_H_
+#define LIBNOP_INCLUDE_NOP_BASE_COLUMNAR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/members.h>
+#include <nop/base/min_encoded_size.h>
+#include <nop/base/size_cache.h>
+#include <nop/base/skip.h>
+#include <nop/base/utility.h>
+#include <nop/types/columnar.h>
+
+namespace nop {
+
+//
+// Columnar<T> encoding format:
+//
+// +-----+---------+-----//----+
+// | STC | INT64:M | M COLUMNS |
+// +-----+---------+-----//----+
+//
+// Where M is the number of members of T and each column holds the values of
+// one member for every element, in member order. Columns of arithmetic and enum
+// members other than bool hold the raw little-endian values:
+//
+// +-----+---------+-----//-----+
+// | BIN | INT64:L | L BYTES    |
+// +-----+---------+-----//-----+
+//
+// Where L is N * sizeof(member). Columns of other members hold an array of
+// their encodings:
+//
+// +-----+---------+-----//----+
+// | ARY | INT64:N | N MEMBERS |
+// +-----+---------+-----//----+
+//
+// Every column must hold the same number of elements N.
+//
+
+namespace detail {
+
+// Evaluates to true if members of type T are stored as raw bytes in a column.
+template <typename T>
+struct IsRawColumn
+    : std::integral_constant<bool, (std::is_arithmetic<T>::value &&
+                                    !std::is_same<T, bool>::value) ||
+                                       std::is_enum<T>::value> {};
+
+}  // namespace detail
+
+template <typename T, typename Allocator>
+struct Encoding<Columnar<T, Allocator>> : EncodingIO<Columnar<T, Allocator>> {
+  using Type = Columnar<T, Allocator>;
+  using VectorType = typename Type::VectorType;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Structure;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache) {
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(Count) +
+           ColumnsSize(value.get(), cache, Index<Count>{});
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Structure;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    auto status = Encoding<SizeType>::Write(Count, writer);
+    if (!status)
+      return status;
+    else
+      return WriteColumns(value.get(), writer, Index<Count>{});
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
+                                            Type* value, Reader* reader) {
+    return ReadColumns<AllColumns>(&value->get(), reader);
+  }
+
+  // Reads only the columns of the members in |Projection|, skipping the other
+  // columns without decoding them. Skipped members are value initialized.
+  template <typename Projection, typename Reader>
+  static constexpr Status<void> ReadProjected(Type* value, Reader* reader) {
+    static_assert(ProjectedCount<Projection>(Index<Count>{}) ==
+                      Projection::Count,
+                  "Projection members must be members of the structure.");
+
+    std::uint8_t prefix_byte = 0;
+    auto status = reader->Read(&prefix_byte);
+    if (!status)
+      return status;
+    else if (!Match(static_cast<EncodingByte>(prefix_byte)))
+      return ErrorStatus::UnexpectedEncodingType;
+    else
+      return ReadColumns<Projection>(&value->get(), reader);
+  }
+
+ private:
+  enum : std::size_t { Count = MemberListTraits<T>::MemberList::Count };
+
+  using MemberList = typename MemberListTraits<T>::MemberList;
+
+  template <std::size_t Index>
+  using PointerAt = typename MemberList::template At<Index>;
+
+  // Projection-like type that contains every column.
+  struct AllColumns {
+    template <typename Pointer>
+    using Contains = std::true_type;
+  };
+
+  template <typename Pointer>
+  struct ColumnTraits {
+    using MemberType = typename Pointer::Type;
+    using IsRaw = detail::IsRawColumn<MemberType>;
+
+    static_assert(
+        std::is_pointer<decltype(Pointer::Resolve(std::declval<T*>()))>::value,
+        "Columnar encoding does not support logical buffer members.");
+  };
+
+  static constexpr std::size_t ColumnsSize(const VectorType& /*rows*/,
+                                           SizeCache* /*cache*/, Index<0>) {
+    return 0;
+  }
+
+  template <std::size_t index>
+  static constexpr std::size_t ColumnsSize(const VectorType& rows,
+                                           SizeCache* cache, Index<index>) {
+    using Pointer = PointerAt<index - 1>;
+    const std::size_t size = ColumnsSize(rows, cache, Index<index - 1>{});
+    return size + ColumnSize<Pointer>(
+                      rows, cache, typename ColumnTraits<Pointer>::IsRaw{});
+  }
+
+  template <typename Pointer>
+  static constexpr std::size_t ColumnSize(const VectorType& rows,
+                                          SizeCache* /*cache*/,
+                                          std::true_type /*is_raw*/) {
+    using MemberType = typename ColumnTraits<Pointer>::MemberType;
+    const SizeType size = rows.size() * sizeof(MemberType);
+    return BaseEncodingSize(EncodingByte::Binary) +
+           Encoding<SizeType>::Size(size) + size;
+  }
+
+  template <typename Pointer>
+  static constexpr std::size_t ColumnSize(const VectorType& rows,
+                                          SizeCache* cache,
+                                          std::false_type /*is_raw*/) {
+    std::size_t size = BaseEncodingSize(EncodingByte::Array) +
+                       Encoding<SizeType>::Size(rows.size());
+    for (const T& row : rows)
+      size += CachedSize(Pointer::Resolve(row), cache);
+    return size;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WriteColumns(const VectorType& /*rows*/,
+                                             Writer* /*writer*/, Index<0>) {
+    return {};
+  }
+
+  template <std::size_t index, typename Writer>
+  static constexpr Status<void> WriteColumns(const VectorType& rows,
+                                             Writer* writer, Index<index>) {
+    auto status = WriteColumns(rows, writer, Index<index - 1>{});
+    if (!status)
+      return status;
+
+    using Pointer = PointerAt<index - 1>;
+    return WriteColumn<Pointer>(rows, writer,
+                                typename ColumnTraits<Pointer>::IsRaw{});
+  }
+
+  // Gathers the member values into one buffer and writes it in one operation.
+  template <typename Pointer, typename Writer>
+  static constexpr Status<void> WriteColumn(const VectorType& rows,
+                                            Writer* writer,
+                                            std::true_type /*is_raw*/) {
+    using MemberType = typename ColumnTraits<Pointer>::MemberType;
+    std::vector<std::uint8_t> column(rows.size() * sizeof(MemberType));
+    std::uint8_t* data = column.data();
+    for (const T& row : rows) {
+      std::memcpy(data, &Pointer::Resolve(row), sizeof(MemberType));
+      data += sizeof(MemberType);
+    }
+
+    auto status =
+        writer->Write(static_cast<std::uint8_t>(EncodingByte::Binary));
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(column.size(), writer);
+    if (!status)
+      return status;
+
+    return writer->Write(column.data(), column.data() + column.size());
+  }
+
+  template <typename Pointer, typename Writer>
+  static constexpr Status<void> WriteColumn(const VectorType& rows,
+                                            Writer* writer,
+                                            std::false_type /*is_raw*/) {
+    using MemberType = typename ColumnTraits<Pointer>::MemberType;
+    auto status = writer->Write(static_cast<std::uint8_t>(EncodingByte::Array));
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(rows.size(), writer);
+    if (!status)
+      return status;
+
+    for (const T& row : rows) {
+      status = Encoding<MemberType>::Write(Pointer::Resolve(row), writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  template <typename Projection, typename Reader>
+  static constexpr Status<void> ReadColumns(VectorType* rows, Reader* reader) {
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+    else if (size != Count)
+      return ErrorStatus::InvalidMemberCount;
+
+    // The first column read determines the number of rows.
+    bool sized = false;
+    return ReadColumns<Projection>(rows, &sized, reader, Index<Count>{});
+  }
+
+  template <typename Projection, typename Reader>
+  static constexpr Status<void> ReadColumns(VectorType* /*rows*/,
+                                            bool* /*sized*/,
+                                            Reader* /*reader*/, Index<0>) {
+    return {};
+  }
+
+  template <typename Projection, std::size_t index, typename Reader>
+  static constexpr Status<void> ReadColumns(VectorType* rows, bool* sized,
+                                            Reader* reader, Index<index>) {
+    auto status =
+        ReadColumns<Projection>(rows, sized, reader, Index<index - 1>{});
+    if (!status)
+      return status;
+
+    using Pointer = PointerAt<index - 1>;
+    if (!Projection::template Contains<Pointer>::value)
+      return SkipValue(reader);
+    else
+      return ReadColumn<Pointer>(rows, sized, reader,
+                                 typename ColumnTraits<Pointer>::IsRaw{});
+  }
+
+  // Sizes |rows| for the first column read and checks that later columns have
+  // the same number of elements.
+  static Status<void> SetRowCount(VectorType* rows, bool* sized,
+                                  std::size_t count) {
+    if (!*sized) {
+      rows->clear();
+      rows->resize(count);
+      *sized = true;
+      return {};
+    } else if (rows->size() != count) {
+      return ErrorStatus::InvalidContainerLength;
+    } else {
+      return {};
+    }
+  }
+
+  template <typename Pointer, typename Reader>
+  static constexpr Status<void> ReadColumn(VectorType* rows, bool* sized,
+                                           Reader* reader,
+                                           std::true_type /*is_raw*/) {
+    using MemberType = typename ColumnTraits<Pointer>::MemberType;
+    std::uint8_t prefix_byte = 0;
+    auto status = reader->Read(&prefix_byte);
+    if (!status)
+      return status;
+    else if (static_cast<EncodingByte>(prefix_byte) != EncodingByte::Binary)
+      return ErrorStatus::UnexpectedEncodingType;
+
+    SizeType size = 0;
+    status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+    else if (size % sizeof(MemberType) != 0)
+      return ErrorStatus::InvalidContainerLength;
+
+    // Make sure the reader holds the column before sizing the rows for it.
+    status = reader->Ensure(size);
+    if (!status)
+      return status;
+
+    status = SetRowCount(rows, sized, size / sizeof(MemberType));
+    if (!status)
+      return status;
+
+    std::vector<std::uint8_t> column(size);
+    status = reader->Read(column.data(), column.data() + column.size());
+    if (!status)
+      return status;
+
+    const std::uint8_t* data = column.data();
+    for (T& row : *rows) {
+      std::memcpy(Pointer::Resolve(&row), data, sizeof(MemberType));
+      data += sizeof(MemberType);
+    }
+
+    return {};
+  }
+
+  template <typename Pointer, typename Reader>
+  static constexpr Status<void> ReadColumn(VectorType* rows, bool* sized,
+                                           Reader* reader,
+                                           std::false_type /*is_raw*/) {
+    using MemberType = typename ColumnTraits<Pointer>::MemberType;
+    std::uint8_t prefix_byte = 0;
+    auto status = reader->Read(&prefix_byte);
+    if (!status)
+      return status;
+    else if (static_cast<EncodingByte>(prefix_byte) != EncodingByte::Array)
+      return ErrorStatus::UnexpectedEncodingType;
+
+    SizeType count = 0;
+    status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+
+    if (*sized) {
+      if (rows->size() != count)
+        return ErrorStatus::InvalidContainerLength;
+
+      for (T& row : *rows) {
+        status = Encoding<MemberType>::Read(Pointer::Resolve(&row), reader);
+        if (!status)
+          return status;
+      }
+      return {};
+    }
+
+    // The count is not yet backed by any bytes read, so grow the rows as the
+    // members are read rather than sizing them up front.
+    rows->clear();
+    rows->reserve(
+        ReserveLimit(count, MinEncodedSize<MemberType>::value, reader));
+    for (SizeType i = 0; i < count; i++) {
+      rows->emplace_back();
+      status = Encoding<MemberType>::Read(Pointer::Resolve(&rows->back()),
+                                          reader);
+      if (!status)
+        return status;
+    }
+
+    *sized = true;
+    return {};
+  }
+
+  template <typename Projection>
+  static constexpr std::size_t ProjectedCount(Index<0>) {
+    return 0;
+  }
+
+  template <typename Projection, std::size_t index>
+  static constexpr std::size_t ProjectedCount(Index<index>) {
+    using Contains =
+        typename Projection::template Contains<PointerAt<index - 1>>;
+    return ProjectedCount<Projection>(Index<index - 1>{}) +
+           (Contains::value ? 1 : 0);
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_COLUMNAR_H_
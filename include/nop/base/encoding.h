@@ -26,8 +26,12 @@
 #include <vector>
 
 #include <nop/base/encoding_byte.h>
+#include <nop/base/instrumentation.h>
 #include <nop/base/utility.h>
 #include <nop/status.h>
+#include <nop/traits/is_budget_reader.h>
+#include <nop/traits/is_infallible_writer.h>
+#include <nop/traits/is_trusted_reader.h>
 
 namespace nop {
 
@@ -55,9 +59,18 @@ inline constexpr std::size_t BaseEncodingSize(EncodingByte prefix) {
     case EncodingByte::Variant:
     case EncodingByte::Structure:
     case EncodingByte::Array:
+    case EncodingByte::ChunkedArray:
+    case EncodingByte::IndexedArray:
+    case EncodingByte::PackedArray:
+    case EncodingByte::BitArray:
+    case EncodingByte::ChunkManifest:
     case EncodingByte::Map:
     case EncodingByte::Binary:
     case EncodingByte::String:
+    case EncodingByte::StringReference:
+    case EncodingByte::StringDefinition:
+    case EncodingByte::ObjectReference:
+    case EncodingByte::ObjectDefinition:
     case EncodingByte::Nil:
     case EncodingByte::Extension:
       return 1U;
@@ -97,6 +110,64 @@ struct Encoding {
                 "include the appropriate encoder header.");
 };
 
+// Out-of-line codecs. Specializing HasOutOfLineEncoder or HasOutOfLineDecoder
+// for a type and a writer or reader type routes EncodingIO through the
+// non-inline members of OutOfLineEncoder or OutOfLineDecoder, which are
+// explicitly instantiated in a single translation unit. Use the macros in
+// nop/codec.h rather than specializing these directly.
+template <typename T, typename Writer>
+struct HasOutOfLineEncoder : std::false_type {};
+
+template <typename T, typename Reader>
+struct HasOutOfLineDecoder : std::false_type {};
+
+template <typename T, typename Writer>
+struct OutOfLineEncoder {
+  static Status<void> Write(const T& value, Writer* writer);
+};
+
+template <typename T, typename Reader>
+struct OutOfLineDecoder {
+  static Status<void> Read(T* value, Reader* reader);
+};
+
+namespace detail {
+
+// Charges one decoded value to the work budget of |reader|, when it has one.
+template <typename Reader>
+constexpr std::enable_if_t<IsBudgetReader<Reader>::value, Status<void>>
+ChargeValue(Reader* reader) {
+  return reader->ChargeValue();
+}
+
+template <typename Reader>
+constexpr std::enable_if_t<!IsBudgetReader<Reader>::value, Status<void>>
+ChargeValue(Reader* /*reader*/) {
+  return {};
+}
+
+// Charges storage for |count| elements of |element_size| bytes to the work
+// budget of |reader|, when it has one. Containers call this before growing to
+// a decoded length. Sizes that overflow are charged as the maximum size.
+template <typename Reader>
+constexpr std::enable_if_t<IsBudgetReader<Reader>::value, Status<void>>
+ChargeAllocation(std::uint64_t count, std::size_t element_size,
+                 Reader* reader) {
+  const std::size_t max_size = static_cast<std::size_t>(-1);
+  return reader->ChargeAllocation(count > max_size / element_size
+                                      ? max_size
+                                      : count * element_size);
+}
+
+template <typename Reader>
+constexpr std::enable_if_t<!IsBudgetReader<Reader>::value, Status<void>>
+ChargeAllocation(std::uint64_t /*count*/, std::size_t /*element_size*/,
+                 Reader* /*reader*/) {
+  return {};
+}
+
+}  // namespace detail
+
 // Implements general IO for encoding types. May also be mixed-in with an
 // Encoding<T> specialization to provide uniform access to Read/Write through
 // the specilization itself.
@@ -112,29 +183,90 @@ template <typename T>
 struct EncodingIO {
   template <typename Writer>
   static constexpr Status<void> Write(const T& value, Writer* writer) {
+    return Write(value, writer, HasOutOfLineEncoder<T, Writer>{});
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> Read(T* value, Reader* reader) {
+    return Read(value, reader, HasOutOfLineDecoder<T, Reader>{});
+  }
+
+ protected:
+  template <typename, typename>
+  friend struct OutOfLineEncoder;
+  template <typename, typename>
+  friend struct OutOfLineDecoder;
+
+  template <typename Writer>
+  static Status<void> Write(const T& value, Writer* writer,
+                            std::true_type /*out_of_line*/) {
+    return OutOfLineEncoder<T, Writer>::Write(value, writer);
+  }
+
+  template <typename Reader>
+  static Status<void> Read(T* value, Reader* reader,
+                           std::true_type /*out_of_line*/) {
+    return OutOfLineDecoder<T, Reader>::Read(value, reader);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> Write(const T& value, Writer* writer,
+                                      std::false_type /*out_of_line*/) {
+#if NOP_ENABLE_INSTRUMENTATION
+    const std::uint64_t start = detail::InstrumentationClock();
+    auto status = WriteValue(value, writer);
+    detail::Instrument<T>(InstrumentationOp::Encode, start,
+                          status ? Encoding<T>::Size(value) : 0, !!status);
+    return status;
+#else
+    return WriteValue(value, writer);
+#endif
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> Read(T* value, Reader* reader,
+                                     std::false_type /*out_of_line*/) {
+#if NOP_ENABLE_INSTRUMENTATION
+    const std::uint64_t start = detail::InstrumentationClock();
+    auto status = ReadValue(value, reader);
+    detail::Instrument<T>(InstrumentationOp::Decode, start,
+                          status ? Encoding<T>::Size(*value) : 0, !!status);
+    return status;
+#else
+    return ReadValue(value, reader);
+#endif
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WriteValue(const T& value, Writer* writer) {
     EncodingByte prefix = Encoding<T>::Prefix(value);
     auto status = writer->Write(static_cast<std::uint8_t>(prefix));
-    if (!status)
+    if (!IsInfallibleWriter<Writer>::value && !status)
       return status;
     else
       return Encoding<T>::WritePayload(prefix, value, writer);
   }
 
   template <typename Reader>
-  static constexpr Status<void> Read(T* value, Reader* reader) {
+  static constexpr Status<void> ReadValue(T* value, Reader* reader) {
+    if (IsBudgetReader<Reader>::value) {
+      auto status = detail::ChargeValue(reader);
+      if (!status)
+        return status;
+    }
+
     std::uint8_t prefix_byte = 0;
     auto status = reader->Read(&prefix_byte);
     if (!status)
       return status;
 
     const EncodingByte prefix = static_cast<EncodingByte>(prefix_byte);
-    if (Encoding<T>::Match(prefix))
+    if (IsTrustedReader<Reader>::value || Encoding<T>::Match(prefix))
       return Encoding<T>::ReadPayload(prefix, value, reader);
     else
       return ErrorStatus::UnexpectedEncodingType;
   }
 
- protected:
   template <typename As, typename From, typename Writer,
             typename Enabled = EnableIfArithmetic<As, From>>
   static constexpr Status<void> WriteAs(From value, Writer* writer) {
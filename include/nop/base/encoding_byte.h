@@ -52,7 +52,30 @@ enum class EncodingByte : std::uint8_t {
 
   // Reserved types.
   ReservedMin = 0x8a,
-  ReservedMax = 0xb4,
+  ReservedMax = 0xab,
+
+  // Chunk manifest types.
+  ChunkManifest = 0xac,
+
+  // Bit array types.
+  BitArray = 0xad,
+
+  // Shared object types.
+  ObjectReference = 0xae,
+  ObjectDefinition = 0xaf,
+
+  // Interned string types.
+  StringReference = 0xb0,
+  StringDefinition = 0xb1,
+
+  // Packed integer array types.
+  PackedArray = 0xb2,
+
+  // Indexed array types.
+  IndexedArray = 0xb3,
+
+  // Chunked array types.
+  ChunkedArray = 0xb4,
 
   // Table types.
   Table = 0xb5,
@@ -0,0 +1,312 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_FIXED_STRUCTURE_H_
+#define LIBNOP_INCLUDE_NOP_BASE_FIXED_STRUCTURE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/enum.h>
+#include <nop/base/utility.h>
+#include <nop/types/detail/member_pointer.h>
+#include <nop/utility/buffer_reader.h>
+
+namespace nop {
+
+//
+// Fixed structure encoding format:
+//
+// +-----+---------+-----//----+
+// | STC | INT64:N | N MEMBERS |
+// +-----+---------+-----//----+
+//
+// Structures defined with NOP_FIXED_STRUCTURE have the same format as other
+// structures, except that each member is written with a fixed width:
+//
+//   * Integers and enums are always written with the prefix matching the size
+//     of the type, (U8/I8, U16/I16, U32/I32, or U64/I64) followed by the full
+//     width of the value, instead of the smallest encoding that holds it.
+//   * Booleans, floating point values, and std::array of integral types have
+//     fixed width encodings already.
+//   * Nested fixed structures are written as above.
+//
+// As a result every value of the type has the same encoded size,
+// FixedEncoding<T>::Size, and each member is at a constant offset from the
+// start of the encoding. View<T> in nop/types/view.h uses these offsets to read
+// members directly from an encoded buffer. Since the format is an ordinary
+// structure encoding, fixed structures are deserialized normally.
+//
+
+// Provides the fixed width encoding of type T. Undefined for types that do not
+// have a fixed width encoding.
+template <typename T, typename Enabled = void>
+struct FixedEncoding;
+
+// Evaluates to true if type T has a fixed width encoding.
+template <typename T, typename = void>
+struct IsFixedEncoding : std::false_type {};
+template <typename T>
+struct IsFixedEncoding<T, Void<decltype(FixedEncoding<T>::Size)>>
+    : std::true_type {};
+
+// Evaluates to true if type T is defined with NOP_FIXED_STRUCTURE.
+template <typename T, typename = void>
+struct IsFixedStructure : std::false_type {};
+template <typename T>
+struct IsFixedStructure<T, EnableIfHasMemberList<T>>
+    : IsFixedMemberList<typename MemberListTraits<T>::MemberList> {};
+
+namespace detail {
+
+// Returns true if the |size| bytes at |data| are exactly an encoding of the
+// container length |length|.
+inline bool MatchFixedLength(const std::uint8_t* data, std::size_t size,
+                             SizeType length) {
+  BufferReader reader{data, size};
+  SizeType value = 0;
+  return Encoding<SizeType>::Read(&value, &reader) && value == length &&
+         reader.empty();
+}
+
+// Computes the layout of the members of a fixed structure.
+template <typename MemberList,
+          typename = std::make_index_sequence<MemberList::Count>>
+struct FixedLayout;
+
+template <typename MemberList, std::size_t... Is>
+struct FixedLayout<MemberList, std::index_sequence<Is...>> {
+  static_assert(
+      And<IsFixedEncoding<
+          typename MemberList::template At<Is>::Type>...>::value,
+      "Members of a fixed structure must have fixed width encodings.");
+
+  enum : std::size_t {
+    HeaderSize = BaseEncodingSize(EncodingByte::Structure) +
+                 Encoding<SizeType>::Size(MemberList::Count),
+  };
+
+  // Returns the offset of the member at |index|, or the size of the structure
+  // when |index| is the member count.
+  static constexpr std::size_t Offset(std::size_t index) {
+    const std::size_t sizes[] = {
+        FixedEncoding<typename MemberList::template At<Is>::Type>::Size...,
+        0};
+    std::size_t offset = HeaderSize;
+    for (std::size_t i = 0; i < index; i++)
+      offset += sizes[i];
+    return offset;
+  }
+
+  enum : std::size_t { Size = Offset(MemberList::Count) };
+};
+
+}  // namespace detail
+
+template <>
+struct FixedEncoding<bool> {
+  enum : std::size_t { Size = 1 };
+
+  static constexpr bool Match(const std::uint8_t* data) {
+    return Encoding<bool>::Match(static_cast<EncodingByte>(data[0]));
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> Write(bool value, Writer* writer) {
+    return Encoding<bool>::Write(value, writer);
+  }
+
+  static bool Load(const std::uint8_t* data) {
+    return static_cast<EncodingByte>(data[0]) == EncodingByte::True;
+  }
+};
+
+template <typename T>
+struct FixedEncoding<T, std::enable_if_t<std::is_integral<T>::value &&
+                                         !std::is_same<T, bool>::value>> {
+  // The prefix followed by the full width of the value.
+  enum : std::size_t { Size = 1 + sizeof(T) };
+
+  static constexpr EncodingByte Prefix() {
+    return std::is_signed<T>::value && !std::is_same<T, char>::value
+               ? SignedPrefix(sizeof(T))
+               : UnsignedPrefix(sizeof(T));
+  }
+
+  static constexpr bool Match(const std::uint8_t* data) {
+    return static_cast<EncodingByte>(data[0]) == Prefix();
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> Write(T value, Writer* writer) {
+    auto status = writer->Write(static_cast<std::uint8_t>(Prefix()));
+    if (!status)
+      return status;
+    else
+      return Encoding<T>::WritePayload(Prefix(), value, writer);
+  }
+
+  static T Load(const std::uint8_t* data) {
+    T value;
+    std::memcpy(&value, data + 1, sizeof(T));
+    return value;
+  }
+
+ private:
+  static constexpr EncodingByte SignedPrefix(std::size_t size) {
+    return size == 1 ? EncodingByte::I8
+                     : size == 2 ? EncodingByte::I16
+                                 : size == 4 ? EncodingByte::I32
+                                             : EncodingByte::I64;
+  }
+
+  static constexpr EncodingByte UnsignedPrefix(std::size_t size) {
+    return size == 1 ? EncodingByte::U8
+                     : size == 2 ? EncodingByte::U16
+                                 : size == 4 ? EncodingByte::U32
+                                             : EncodingByte::U64;
+  }
+};
+
+template <typename T>
+struct FixedEncoding<T, std::enable_if_t<std::is_floating_point<T>::value>> {
+  enum : std::size_t { Size = 1 + sizeof(T) };
+
+  static constexpr bool Match(const std::uint8_t* data) {
+    return Encoding<T>::Match(static_cast<EncodingByte>(data[0]));
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> Write(T value, Writer* writer) {
+    return Encoding<T>::Write(value, writer);
+  }
+
+  static T Load(const std::uint8_t* data) {
+    T value;
+    std::memcpy(&value, data + 1, sizeof(T));
+    return value;
+  }
+};
+
+// Enums use the fixed width encoding of the underlying integer type.
+template <typename T>
+struct FixedEncoding<T, EnableIfEnum<T>> {
+  using IntegerType = std::underlying_type_t<T>;
+  enum : std::size_t { Size = FixedEncoding<IntegerType>::Size };
+
+  static constexpr bool Match(const std::uint8_t* data) {
+    return FixedEncoding<IntegerType>::Match(data);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> Write(T value, Writer* writer) {
+    return FixedEncoding<IntegerType>::Write(static_cast<IntegerType>(value),
+                                             writer);
+  }
+
+  static T Load(const std::uint8_t* data) {
+    return static_cast<T>(FixedEncoding<IntegerType>::Load(data));
+  }
+};
+
+template <typename T, std::size_t Length>
+struct FixedEncoding<std::array<T, Length>, EnableIfIntegral<T>> {
+  using Type = std::array<T, Length>;
+  enum : std::size_t {
+    PayloadSize = Length * sizeof(T),
+    HeaderSize = BaseEncodingSize(EncodingByte::Binary) +
+                 Encoding<SizeType>::Size(PayloadSize),
+    Size = HeaderSize + PayloadSize,
+  };
+
+  static constexpr bool Match(const std::uint8_t* data) {
+    return static_cast<EncodingByte>(data[0]) == EncodingByte::Binary &&
+           MatchLength(data + 1);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> Write(const Type& value, Writer* writer) {
+    return Encoding<Type>::Write(value, writer);
+  }
+
+  static Type Load(const std::uint8_t* data) {
+    Type value;
+    std::memcpy(value.data(), data + HeaderSize, PayloadSize);
+    return value;
+  }
+
+ private:
+  static bool MatchLength(const std::uint8_t* data) {
+    return detail::MatchFixedLength(data, HeaderSize - 1, PayloadSize);
+  }
+};
+
+template <typename T>
+struct FixedEncoding<T, std::enable_if_t<IsFixedStructure<T>::value>> {
+  using MemberList = typename MemberListTraits<T>::MemberList;
+  using Layout = detail::FixedLayout<MemberList>;
+
+  enum : std::size_t {
+    Count = MemberList::Count,
+    HeaderSize = Layout::HeaderSize,
+    Size = Layout::Size,
+  };
+
+  // The type of the member at the given index.
+  template <std::size_t Index>
+  using MemberType = typename MemberList::template At<Index>::Type;
+
+  // Returns the offset of the encoding of the member at the given index from
+  // the start of the encoding of the structure.
+  template <std::size_t Index>
+  static constexpr std::size_t Offset() {
+    return Layout::Offset(Index);
+  }
+
+  static bool Match(const std::uint8_t* data) {
+    return static_cast<EncodingByte>(data[0]) == EncodingByte::Structure &&
+           detail::MatchFixedLength(data + 1, HeaderSize - 1, Count) &&
+           MatchMembers(data, std::make_index_sequence<Count>{});
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> Write(const T& value, Writer* writer) {
+    return Encoding<T>::Write(value, writer);
+  }
+
+ private:
+  template <std::size_t... Is>
+  static bool MatchMembers(const std::uint8_t* data,
+                           std::index_sequence<Is...>) {
+    const bool matches[] = {
+        true, FixedEncoding<MemberType<Is>>::Match(data + Offset<Is>())...};
+    for (bool match : matches) {
+      if (!match)
+        return false;
+    }
+    return true;
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_FIXED_STRUCTURE_H_
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_FIXINT_ARRAY_H_
+#define LIBNOP_INCLUDE_NOP_BASE_FIXINT_ARRAY_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <nop/base/encoding.h>
+#include <nop/base/min_encoded_size.h>
+#include <nop/base/utility.h>
+#include <nop/traits/is_borrowing_reader.h>
+#include <nop/traits/is_detected.h>
+
+namespace nop {
+
+//
+// Bulk decoding of array elements with single byte encodings.
+//
+// Arrays of enums, bools, and small integers stored as ARY or CHA elements are
+// usually made up entirely of values whose encoding is a single prefix byte:
+// positive or negative fixints, or the True and False prefixes. When the reader
+// exposes its buffer, ReadElements() validates the prefix bytes eight at a time
+// in 32 byte blocks, converts the whole run of single byte elements at once,
+// and skips past it. The first byte that is not a single byte encoding of the
+// element type, such as the prefix of a wider integer, is handed to the regular
+// element decoder, after which bulk decoding resumes.
+//
+// The checks use plain 64-bit words rather than target specific vector
+// instructions, which keeps the header portable and lets the compiler widen the
+// loops where the target supports it.
+//
+
+namespace detail {
+
+// Byte classes describing which single byte encodings an element type accepts.
+// Each class provides Invalid(), which returns a non-zero value if any of the
+// eight bytes packed in |word| is outside of the class, and Valid(), which
+// tests a single byte.
+
+// Accepts only the True and False prefixes.
+struct BooleanBytes {
+  static std::uint64_t Invalid(std::uint64_t word) {
+    return word & 0xfefefefefefefefeULL;
+  }
+  static bool Valid(std::uint8_t byte) { return byte <= 0x01; }
+};
+
+// Accepts positive fixints, the bytes with the high bit clear.
+struct PositiveFixIntBytes {
+  static std::uint64_t Invalid(std::uint64_t word) {
+    return word & 0x8080808080808080ULL;
+  }
+  static bool Valid(std::uint8_t byte) { return byte < 0x80; }
+};
+
+// Accepts positive and negative fixints. The only bytes rejected are those with
+// the high bit set and the next bit clear, which are the non-fixint prefixes.
+struct SignedFixIntBytes {
+  static std::uint64_t Invalid(std::uint64_t word) {
+    return word & ~(word << 1) & 0x8080808080808080ULL;
+  }
+  static bool Valid(std::uint8_t byte) { return byte < 0x80 || byte >= 0xc0; }
+};
+
+// Selects the byte class of an integral or enum element type; the type member
+// is void for element types that have no single byte encodings.
+template <typename T, typename Enable = void>
+struct FixIntByteClass {
+  using Type = void;
+};
+template <>
+struct FixIntByteClass<bool> {
+  using Type = BooleanBytes;
+};
+template <>
+struct FixIntByteClass<char> {
+  using Type = PositiveFixIntBytes;
+};
+template <typename T>
+struct FixIntByteClass<
+    T, std::enable_if_t<std::is_integral<T>::value &&
+                        !std::is_same<T, bool>::value &&
+                        !std::is_same<T, char>::value && sizeof(T) <= 8>> {
+  using Type = std::conditional_t<std::is_signed<T>::value, SignedFixIntBytes,
+                                  PositiveFixIntBytes>;
+};
+template <typename T>
+struct FixIntByteClass<T, std::enable_if_t<std::is_enum<T>::value>>
+    : FixIntByteClass<std::underlying_type_t<T>> {};
+
+// Converts a single byte encoding to a value of integral or enum type T.
+template <typename T>
+std::enable_if_t<std::is_same<T, bool>::value, T> FromFixInt(
+    std::uint8_t byte) {
+  return byte != 0;
+}
+template <typename T>
+std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                     std::is_signed<T>::value,
+                 T>
+FromFixInt(std::uint8_t byte) {
+  return static_cast<T>(static_cast<std::int8_t>(byte));
+}
+template <typename T>
+std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                     !std::is_signed<T>::value,
+                 T>
+FromFixInt(std::uint8_t byte) {
+  return static_cast<T>(byte);
+}
+template <typename T>
+std::enable_if_t<std::is_enum<T>::value, T> FromFixInt(std::uint8_t byte) {
+  return static_cast<T>(FromFixInt<std::underlying_type_t<T>>(byte));
+}
+
+// Returns the number of leading bytes of |data| that belong to ByteClass.
+template <typename ByteClass>
+std::size_t CountFixIntBytes(const std::uint8_t* data, std::size_t size) {
+  enum : std::size_t { kWordSize = sizeof(std::uint64_t), kBlockSize = 32 };
+  auto load = [data](std::size_t index) {
+    std::uint64_t word;
+    std::memcpy(&word, data + index, sizeof(word));
+    return word;
+  };
+
+  std::size_t index = 0;
+  for (; index + kBlockSize <= size; index += kBlockSize) {
+    if (ByteClass::Invalid(load(index) | load(index + 8) | load(index + 16) |
+                           load(index + 24))) {
+      break;
+    }
+  }
+  for (; index + kWordSize <= size; index += kWordSize) {
+    if (ByteClass::Invalid(load(index)))
+      break;
+  }
+  for (; index < size; index++) {
+    if (!ByteClass::Valid(data[index]))
+      break;
+  }
+  return index;
+}
+
+// Evaluates to true if elements of type T may be decoded in bulk from Reader.
+// The reader must lend out its buffer and report how many bytes remain.
+template <typename T, typename Reader>
+using IsFixIntBulkReadable =
+    And<std::integral_constant<
+            bool, !std::is_void<typename FixIntByteClass<T>::Type>::value>,
+        IsBorrowingReader<Reader>, IsDetected<ReaderRemainingTest, Reader>>;
+
+// Test expression for readers over non-contiguous input that report how many
+// bytes may be borrowed at once.
+template <typename Reader>
+using ReaderContiguousTest =
+    decltype(std::declval<const Reader&>().contiguous());
+
+// Returns the number of bytes that may be borrowed from |reader| at once.
+template <typename Reader>
+std::enable_if_t<IsDetected<ReaderContiguousTest, Reader>::value, std::size_t>
+BorrowableSize(const Reader* reader) {
+  return reader->contiguous();
+}
+
+template <typename Reader>
+std::enable_if_t<!IsDetected<ReaderContiguousTest, Reader>::value, std::size_t>
+BorrowableSize(const Reader* reader) {
+  return reader->remaining();
+}
+
+template <typename T, typename Reader>
+Status<void> ReadElements(T* begin, T* end, Reader* reader,
+                          std::false_type /*is_bulk_readable*/) {
+  for (; begin != end; ++begin) {
+    auto status = Encoding<T>::Read(begin, reader);
+    if (!status)
+      return status;
+  }
+  return {};
+}
+
+template <typename T, typename Reader>
+Status<void> ReadElements(T* begin, T* end, Reader* reader,
+                          std::true_type /*is_bulk_readable*/) {
+  using ByteClass = typename FixIntByteClass<T>::Type;
+
+  while (begin != end) {
+    const std::size_t window = std::min<std::size_t>(
+        static_cast<std::size_t>(end - begin), BorrowableSize(reader));
+    auto status = reader->Ensure(window);
+    if (!status)
+      return status;
+
+    const void* data = nullptr;
+    status = reader->Borrow(&data, 0);
+    if (!status)
+      return status;
+
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    const std::size_t count = CountFixIntBytes<ByteClass>(bytes, window);
+    for (std::size_t i = 0; i < count; i++)
+      begin[i] = FromFixInt<T>(bytes[i]);
+    status = reader->Skip(count);
+    if (!status)
+      return status;
+
+    // Decode the element that ended the run, if any, the regular way.
+    begin += count;
+    if (begin != end) {
+      status = Encoding<T>::Read(begin, reader);
+      if (!status)
+        return status;
+      ++begin;
+    }
+  }
+  return {};
+}
+
+// Decodes the encoded elements into the range [begin, end), using the bulk path
+// for single byte elements when the element type and reader support it.
+template <typename T, typename Reader>
+Status<void> ReadElements(T* begin, T* end, Reader* reader) {
+  return ReadElements(begin, end, reader, IsFixIntBulkReadable<T, Reader>{});
+}
+
+}  // namespace detail
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_FIXINT_ARRAY_H_
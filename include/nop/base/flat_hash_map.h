@@ -0,0 +1,150 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_FLAT_HASH_MAP_H_
+#define LIBNOP_INCLUDE_NOP_BASE_FLAT_HASH_MAP_H_
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include <nop/base/allocator.h>
+#include <nop/base/canonical.h>
+#include <nop/base/encoding.h>
+#include <nop/base/min_encoded_size.h>
+#include <nop/base/size_cache.h>
+#include <nop/types/flat_hash_map.h>
+
+namespace nop {
+
+//
+// FlatHashMap<Key, T> encoding format:
+//
+// +-----+---------+--------//---------+
+// | MAP | INT64:N | N KEY/VALUE PAIRS |
+// +-----+---------+--------//---------+
+//
+// Each pair must be a valid encoding of Key followed by a valid encoding of T.
+// The format is the same as std::unordered_map<Key, T>, including the ordering
+// of pairs for writers that request canonical encoding. Decoding reserves the
+// map once and appends the pairs in the order read; when a key repeats the
+// first pair is kept.
+//
+
+template <typename Key, typename T, typename Hash, typename KeyEqual,
+          typename Allocator>
+struct Encoding<FlatHashMap<Key, T, Hash, KeyEqual, Allocator>>
+    : EncodingIO<FlatHashMap<Key, T, Hash, KeyEqual, Allocator>> {
+  using Type = FlatHashMap<Key, T, Hash, KeyEqual, Allocator>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Map;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache) {
+    std::size_t size = BaseEncodingSize(Prefix(value)) +
+                       Encoding<SizeType>::Size(value.size());
+    for (const auto& element : value) {
+      size += CachedSize(element.first, cache);
+      size += CachedSize(element.second, cache);
+    }
+    return size;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Map;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    return WriteElements(value, writer, IsCanonicalWriter<Writer>{});
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
+                                            Type* value, Reader* reader) {
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    status = detail::ChargeAllocation(
+        size, sizeof(typename Type::value_type), reader);
+    if (!status)
+      return status;
+
+    // Reserve the elements and the index once for no more elements than the
+    // bytes remaining in the reader could hold, without trusting the size.
+    value->clear();
+    value->reserve(ReserveLimit(
+        size, MinEncodedSize<Key>::value + MinEncodedSize<T>::value, reader));
+    for (SizeType i = 0; i < size; i++) {
+      std::pair<Key, T> element =
+          detail::MakePairWithAllocator<Key, T>(value->get_allocator());
+      status = Encoding<Key>::Read(&element.first, reader);
+      if (!status)
+        return status;
+
+      status = Encoding<T>::Read(&element.second, reader);
+      if (!status)
+        return status;
+
+      value->Append(std::move(element));
+    }
+
+    return {};
+  }
+
+ private:
+  // Writes the elements in storage order.
+  template <typename Writer>
+  static constexpr Status<void> WriteElements(const Type& value,
+                                              Writer* writer,
+                                              std::false_type) {
+    for (const auto& element : value) {
+      auto status = Encoding<Key>::Write(element.first, writer);
+      if (!status)
+        return status;
+
+      status = Encoding<T>::Write(element.second, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  // Writes the elements ordered by their encoded keys.
+  template <typename Writer>
+  static Status<void> WriteElements(const Type& value, Writer* writer,
+                                    std::true_type) {
+    return detail::WriteCanonicalMap<Key, T>(value, writer);
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_FLAT_HASH_MAP_H_
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_FLAT_MAP_H_
+#define LIBNOP_INCLUDE_NOP_BASE_FLAT_MAP_H_
+
+#include <cstddef>
+#include <utility>
+
+#include <nop/base/allocator.h>
+#include <nop/base/encoding.h>
+#include <nop/base/min_encoded_size.h>
+#include <nop/base/size_cache.h>
+#include <nop/types/flat_map.h>
+
+namespace nop {
+
+//
+// FlatMap<Key, T> encoding format:
+//
+// +-----+---------+--------//---------+
+// | MAP | INT64:N | N KEY/VALUE PAIRS |
+// +-----+---------+--------//---------+
+//
+// Each pair must be a valid encoding of Key followed by a valid encoding of T.
+// The format is the same as std::map<Key, T>. Pairs are written in key order.
+// Decoding appends the pairs in the order read, sorting them once at the end
+// only if the input was not already in key order.
+//
+
+template <typename Key, typename T, typename Compare, typename Allocator>
+struct Encoding<FlatMap<Key, T, Compare, Allocator>>
+    : EncodingIO<FlatMap<Key, T, Compare, Allocator>> {
+  using Type = FlatMap<Key, T, Compare, Allocator>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Map;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache) {
+    std::size_t size = BaseEncodingSize(Prefix(value)) +
+                       Encoding<SizeType>::Size(value.size());
+    for (const auto& element : value) {
+      size += CachedSize(element.first, cache);
+      size += CachedSize(element.second, cache);
+    }
+    return size;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Map;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    for (const auto& element : value) {
+      status = Encoding<Key>::Write(element.first, writer);
+      if (!status)
+        return status;
+
+      status = Encoding<T>::Write(element.second, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
+                                            Type* value, Reader* reader) {
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    // Reserve storage for no more elements than the bytes remaining in the
+    // reader could hold, without trusting the size.
+    value->clear();
+    value->reserve(ReserveLimit(
+        size, MinEncodedSize<Key>::value + MinEncodedSize<T>::value, reader));
+
+    bool ordered = true;
+    for (SizeType i = 0; i < size; i++) {
+      std::pair<Key, T> element =
+          detail::MakePairWithAllocator<Key, T>(value->get_allocator());
+      status = Encoding<Key>::Read(&element.first, reader);
+      if (!status)
+        break;
+
+      status = Encoding<T>::Read(&element.second, reader);
+      if (!status)
+        break;
+
+      ordered = value->Append(std::move(element)) && ordered;
+    }
+
+    // Leave the map ordered even if decoding stopped early.
+    if (!ordered)
+      value->Sort();
+    return status;
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_FLAT_MAP_H_
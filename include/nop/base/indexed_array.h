@@ -0,0 +1,265 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_INDEXED_ARRAY_H_
+#define LIBNOP_INCLUDE_NOP_BASE_INDEXED_ARRAY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/size_cache.h>
+#include <nop/base/vector.h>
+#include <nop/types/indexed_array.h>
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+//
+// IndexedArray<T> encoding format:
+//
+// +-----+---------+-----+---------+---//----+-----//-----+
+// | IXA | INT64:N | BIN | INT64:L | OFFSETS | N ELEMENTS |
+// +-----+---------+-----+---------+---//----+-----//-----+
+//
+// OFFSETS holds N little-endian unsigned integers, each L / N bytes wide,
+// giving the byte offset of each element from the start of the first element.
+// Offsets are four bytes wide when every element starts within the first 4GB
+// of the element data and eight bytes wide otherwise. Elements must be valid
+// encodings of type T.
+//
+// The elements are encoded before the offset table is written, so that the
+// offsets give the positions the elements were actually written at even for
+// encodings whose computed size is an upper bound, such as handles, interned
+// strings, shared pointers, and chunked blobs. Elements that refer to session
+// state, such as string definitions and references, can only be decoded in
+// order; random access through IndexedArrayView requires elements that stand
+// on their own.
+//
+// IndexedArray<T> decodes any encoding of std::vector<T>.
+//
+
+namespace detail {
+
+// Returns the width of the offsets of an indexed array whose last element
+// starts at |last_offset|.
+constexpr std::size_t OffsetWidth(std::uint64_t last_offset) {
+  return last_offset <= std::numeric_limits<std::uint32_t>::max()
+             ? sizeof(std::uint32_t)
+             : sizeof(std::uint64_t);
+}
+
+// Returns the encoded size of the offset table for the given element count and
+// last element offset.
+constexpr std::size_t OffsetTableSize(std::size_t count,
+                                      std::uint64_t last_offset) {
+  return BaseEncodingSize(EncodingByte::Binary) +
+         Encoding<SizeType>::Size(count * OffsetWidth(last_offset)) +
+         count * OffsetWidth(last_offset);
+}
+
+// Writes the offset table of an indexed array with the given element offsets.
+template <typename Writer>
+Status<void> WriteOffsetTable(const std::vector<std::uint64_t>& offsets,
+                              Writer* writer) {
+  const std::size_t width = OffsetWidth(offsets.empty() ? 0 : offsets.back());
+  auto status = writer->Write(static_cast<std::uint8_t>(EncodingByte::Binary));
+  if (!status)
+    return status;
+
+  status = Encoding<SizeType>::Write(offsets.size() * width, writer);
+  if (!status)
+    return status;
+
+  if (width == sizeof(std::uint32_t)) {
+    std::vector<std::uint32_t> table;
+    table.reserve(offsets.size());
+    for (std::uint64_t offset : offsets) {
+      table.push_back(HostEndian<std::uint32_t>::ToLittle(
+          static_cast<std::uint32_t>(offset)));
+    }
+    return writer->Write(table.data(), table.data() + table.size());
+  } else {
+    std::vector<std::uint64_t> table;
+    table.reserve(offsets.size());
+    for (std::uint64_t offset : offsets)
+      table.push_back(HostEndian<std::uint64_t>::ToLittle(offset));
+    return writer->Write(table.data(), table.data() + table.size());
+  }
+}
+
+// Writer that collects the encodings of the elements of an indexed array ahead
+// of the offset table. Handles and session state are those of the underlying
+// writer.
+template <typename Writer>
+class ElementBufferWriter {
+ public:
+  ElementBufferWriter(Writer* writer, std::size_t capacity) : writer_{writer} {
+    data_.reserve(capacity);
+  }
+
+  Status<void> Prepare(std::size_t /*size*/) { return {}; }
+
+  Status<void> Write(std::uint8_t byte) {
+    data_.push_back(byte);
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(begin);
+    data_.insert(data_.end(), bytes, bytes + (end - begin) * sizeof(T));
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    data_.insert(data_.end(), padding_bytes, padding_value);
+    return {};
+  }
+
+  Status<void> Borrow(void** data, std::size_t size) {
+    const std::size_t offset = data_.size();
+    data_.resize(offset + size);
+    *data = data_.data() + offset;
+    return {};
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    return writer_->PushHandle(handle);
+  }
+
+  // Forwards the SizeCache of the underlying writer, when it has one.
+  template <typename W = Writer>
+  auto size_cache() const -> decltype(std::declval<W&>().size_cache()) {
+    return writer_->size_cache();
+  }
+
+  // Forwards the canonical encoding request of the underlying writer.
+  template <typename W = Writer>
+  auto canonical() const -> decltype(std::declval<const W&>().canonical()) {
+    return writer_->canonical();
+  }
+
+  // Forwards the string dictionary of the underlying writer, when it has one.
+  template <typename W = Writer>
+  auto string_dictionary() const
+      -> decltype(std::declval<W&>().string_dictionary()) {
+    return writer_->string_dictionary();
+  }
+
+  // Forwards the chunk store of the underlying writer, when it has one.
+  template <typename W = Writer>
+  auto chunk_store() const -> decltype(std::declval<W&>().chunk_store()) {
+    return writer_->chunk_store();
+  }
+
+  // Forwards the shared object table of the underlying writer, when it has one.
+  template <typename W = Writer>
+  auto object_table() const -> decltype(std::declval<W&>().object_table()) {
+    return writer_->object_table();
+  }
+
+  const std::vector<std::uint8_t>& data() const { return data_; }
+  std::size_t size() const { return data_.size(); }
+
+ private:
+  Writer* writer_;
+  std::vector<std::uint8_t> data_;
+};
+
+}  // namespace detail
+
+template <typename T, typename Allocator>
+struct Encoding<IndexedArray<T, Allocator>>
+    : EncodingIO<IndexedArray<T, Allocator>> {
+  using Type = IndexedArray<T, Allocator>;
+  using VectorType = typename Type::VectorType;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::IndexedArray;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache) {
+    const VectorType& elements = value.get();
+    std::size_t elements_size = 0;
+    std::size_t last_offset = 0;
+    for (const T& element : elements) {
+      last_offset = elements_size;
+      elements_size += CachedSize(element, cache);
+    }
+
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(elements.size()) +
+           detail::OffsetTableSize(elements.size(), last_offset) +
+           elements_size;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<VectorType>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    const VectorType& elements = value.get();
+    auto status = Encoding<SizeType>::Write(elements.size(), writer);
+    if (!status)
+      return status;
+
+    std::size_t capacity = 0;
+    for (const T& element : elements)
+      capacity += Encoding<T>::Size(element);
+
+    // Record where each element starts as it is encoded.
+    detail::ElementBufferWriter<Writer> element_writer{writer, capacity};
+    std::vector<std::uint64_t> offsets;
+    offsets.reserve(elements.size());
+    for (const T& element : elements) {
+      offsets.push_back(element_writer.size());
+      status = Encoding<T>::Write(element, &element_writer);
+      if (!status)
+        return status;
+    }
+
+    status = detail::WriteOffsetTable(offsets, writer);
+    if (!status)
+      return status;
+
+    const std::vector<std::uint8_t>& data = element_writer.data();
+    return writer->Write(data.data(), data.data() + data.size());
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    return Encoding<VectorType>::ReadPayload(prefix, &value->get(), reader);
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_INDEXED_ARRAY_H_
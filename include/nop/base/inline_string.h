@@ -0,0 +1,98 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_INLINE_STRING_H_
+#define LIBNOP_INCLUDE_NOP_BASE_INLINE_STRING_H_
+
+#include <cstddef>
+
+#include <nop/base/encoding.h>
+#include <nop/traits/is_utf8_validating_reader.h>
+#include <nop/types/inline_string.h>
+#include <nop/utility/utf8.h>
+
+namespace nop {
+
+//
+// InlineString<N> encoding format is the same as std::string, described in
+// base/string.h:
+//
+// +-----+---------+---//----+
+// | STR | INT64:N | N BYTES |
+// +-----+---------+---//----+
+//
+
+template <std::size_t N>
+struct Encoding<InlineString<N>> : EncodingIO<InlineString<N>> {
+  using Type = InlineString<N>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::String;
+  }
+
+  static std::size_t Size(const Type& value) {
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(value.size()) + value.size();
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::String;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    return writer->Write(value.begin(), value.end());
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
+                                            Type* value, Reader* reader) {
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    // Make sure the reader has enough data to fulfill the requested size as a
+    // defense against abusive or erroneous string sizes.
+    status = reader->Ensure(size);
+    if (!status)
+      return status;
+
+    status = detail::ChargeAllocation(size, 1, reader);
+    if (!status)
+      return status;
+
+    value->resize(size);
+    status = reader->Read(value->begin(), value->end());
+    if (!status)
+      return status;
+    else if (IsUtf8ValidatingReader<Reader>::value &&
+             !ValidateUtf8(value->data(), size))
+      return ErrorStatus::InvalidUtf8;
+    else
+      return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_INLINE_STRING_H_
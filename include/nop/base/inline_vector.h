@@ -0,0 +1,181 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_INLINE_VECTOR_H_
+#define LIBNOP_INCLUDE_NOP_BASE_INLINE_VECTOR_H_
+
+#include <cstddef>
+#include <numeric>
+#include <type_traits>
+
+#include <nop/base/encoding.h>
+#include <nop/base/size_cache.h>
+#include <nop/base/utility.h>
+#include <nop/base/vector.h>
+#include <nop/types/inline_vector.h>
+
+namespace nop {
+
+//
+// InlineVector<T, N> encoding format is the same as std::vector<T>, described
+// in base/vector.h: ARY for non-integral types and BIN for integral types, with
+// the CHA, IXA and PKA forms accepted by the same decoders. Decoding reuses the
+// inline storage, so a vector of at most N elements is read without touching
+// the heap.
+//
+// InlineVector<bool, N> is not supported, since std::vector<bool> uses the
+// bit-packed BIT encoding.
+//
+
+// Specialization for non-integral types.
+template <typename T, std::size_t N>
+struct Encoding<InlineVector<T, N>, EnableIfNotIntegral<T>>
+    : EncodingIO<InlineVector<T, N>> {
+  using Type = InlineVector<T, N>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Array;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache) {
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(value.size()) +
+           std::accumulate(value.cbegin(), value.cend(), 0U,
+                           [cache](const std::size_t& sum, const T& element) {
+                             return sum + CachedSize(element, cache);
+                           });
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Array ||
+           prefix == EncodingByte::ChunkedArray ||
+           prefix == EncodingByte::IndexedArray;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    for (const T& element : value) {
+      status = Encoding<T>::Write(element, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    if (prefix == EncodingByte::ChunkedArray)
+      return detail::ReadChunkedArray(value, reader);
+
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    if (prefix == EncodingByte::IndexedArray) {
+      status = detail::SkipOffsetTable(size, reader);
+      if (!status)
+        return status;
+    }
+
+    if (value->size() > size)
+      value->erase(value->begin() + size, value->end());
+    return detail::ReadVectorElements(value, 0, size, reader);
+  }
+};
+
+// Specialization for integral types other than bool.
+template <typename T, std::size_t N>
+struct Encoding<
+    InlineVector<T, N>,
+    std::enable_if_t<IsIntegral<T>::value && !std::is_same<T, bool>::value>>
+    : EncodingIO<InlineVector<T, N>> {
+  using Type = InlineVector<T, N>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    const SizeType size = value.size() * sizeof(T);
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(size) +
+           size;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary ||
+           prefix == EncodingByte::ChunkedArray ||
+           prefix == EncodingByte::PackedArray;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    const SizeType length = value.size();
+    auto status = Encoding<SizeType>::Write(length * sizeof(T), writer);
+    if (!status)
+      return status;
+
+    return writer->Write(value.data(), value.data() + length);
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    if (prefix == EncodingByte::ChunkedArray)
+      return detail::ReadChunkedArray(value, reader);
+    else if (prefix == EncodingByte::PackedArray)
+      return detail::ReadPackedArray(value, reader);
+
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    if (size % sizeof(T) != 0)
+      return ErrorStatus::InvalidContainerLength;
+
+    const SizeType length = size / sizeof(T);
+
+    status = reader->Ensure(size);
+    if (!status)
+      return status;
+
+    status = detail::ChargeAllocation(size, 1, reader);
+    if (!status)
+      return status;
+
+    value->resize(length);
+    return reader->Read(value->data(), value->data() + length);
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_INLINE_VECTOR_H_
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_INSTRUMENTATION_H_
+#define LIBNOP_INCLUDE_NOP_BASE_INSTRUMENTATION_H_
+
+//
+// Per-type encode and decode instrumentation.
+//
+// Instrumentation is compiled out unless NOP_ENABLE_INSTRUMENTATION is defined
+// to 1, in which case EncodingIO<T>::Write() and EncodingIO<T>::Read() report
+// an InstrumentationEvent for every value they encode or decode to the current
+// InstrumentationHandler. Define NOP_ENABLE_INSTRUMENTATION_CYCLES to 1 as well
+// to include the elapsed cycle count of each value in its event.
+//
+// The byte count of an event is Encoding<T>::Size() of the value written or
+// read, which adds a size walk to each instrumented value. Nested values are
+// reported individually and their counts are included in those of the values
+// that contain them. Encodings that provide their own Write() or Read() are not
+// instrumented, and instrumented encoders cannot be evaluated at compile time.
+//
+// The definition of NOP_ENABLE_INSTRUMENTATION must be the same in every
+// translation unit of a program.
+//
+// The default handler aggregates the events of each thread into per-type
+// counters that are retrieved with GetInstrumentationCounters(), for example to
+// export as metrics:
+//
+//   for (const auto& entry : nop::GetInstrumentationCounters())
+//     Export(entry.first, entry.second.encode_bytes);
+//
+
+#ifndef NOP_ENABLE_INSTRUMENTATION
+#define NOP_ENABLE_INSTRUMENTATION 0
+#endif
+
+#ifndef NOP_ENABLE_INSTRUMENTATION_CYCLES
+#define NOP_ENABLE_INSTRUMENTATION_CYCLES 0
+#endif
+
+#if NOP_ENABLE_INSTRUMENTATION
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include <nop/base/type_name.h>
+
+namespace nop {
+
+enum class InstrumentationOp { Encode, Decode };
+
+struct InstrumentationEvent {
+  InstrumentationOp op;
+
+  // Name of the type of the value. The string has static storage duration and
+  // a unique address for each type.
+  const char* type_name;
+
+  // Encoded size of the value, or zero if the operation failed.
+  std::size_t bytes;
+
+  // Elapsed cycles, or zero unless NOP_ENABLE_INSTRUMENTATION_CYCLES is 1.
+  std::uint64_t cycles;
+
+  bool ok;
+};
+
+using InstrumentationHandler = void (*)(const InstrumentationEvent& event);
+
+struct InstrumentationCounters {
+  std::uint64_t encode_count{0};
+  std::uint64_t encode_bytes{0};
+  std::uint64_t encode_cycles{0};
+  std::uint64_t decode_count{0};
+  std::uint64_t decode_bytes{0};
+  std::uint64_t decode_cycles{0};
+  std::uint64_t error_count{0};
+};
+
+// Counters keyed by InstrumentationEvent::type_name.
+using InstrumentationCounterMap =
+    std::unordered_map<const char*, InstrumentationCounters>;
+
+// Returns the counters aggregated for the calling thread by the default
+// handler.
+inline InstrumentationCounterMap& GetInstrumentationCounters() {
+  static thread_local InstrumentationCounterMap counters;
+  return counters;
+}
+
+inline void ResetInstrumentationCounters() {
+  GetInstrumentationCounters().clear();
+}
+
+// Adds |event| to the counters of the calling thread. This is the default
+// handler.
+inline void AggregateInstrumentationEvent(const InstrumentationEvent& event) {
+  InstrumentationCounters& counters =
+      GetInstrumentationCounters()[event.type_name];
+  if (!event.ok) {
+    counters.error_count++;
+  } else if (event.op == InstrumentationOp::Encode) {
+    counters.encode_count++;
+    counters.encode_bytes += event.bytes;
+    counters.encode_cycles += event.cycles;
+  } else {
+    counters.decode_count++;
+    counters.decode_bytes += event.bytes;
+    counters.decode_cycles += event.cycles;
+  }
+}
+
+namespace detail {
+
+inline std::atomic<InstrumentationHandler>& InstrumentationHandlerStorage() {
+  static std::atomic<InstrumentationHandler> handler{
+      &AggregateInstrumentationEvent};
+  return handler;
+}
+
+inline std::uint64_t InstrumentationClock() {
+#if !NOP_ENABLE_INSTRUMENTATION_CYCLES
+  return 0;
+#elif defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+  std::uint64_t value;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+  return value;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+}  // namespace detail
+
+// Installs |handler| for all threads and returns the previous handler. Passing
+// nullptr stops reporting events.
+inline InstrumentationHandler SetInstrumentationHandler(
+    InstrumentationHandler handler) {
+  return detail::InstrumentationHandlerStorage().exchange(handler);
+}
+
+namespace detail {
+
+// Reports an operation on a value of type T that started at |start|.
+template <typename T>
+void Instrument(InstrumentationOp op, std::uint64_t start, std::size_t bytes,
+                bool ok) {
+  const InstrumentationHandler handler =
+      InstrumentationHandlerStorage().load(std::memory_order_relaxed);
+  if (handler == nullptr)
+    return;
+
+  const std::uint64_t cycles = InstrumentationClock() - start;
+  handler(InstrumentationEvent{op, TypeName<T>(), bytes, cycles, ok});
+}
+
+}  // namespace detail
+}  // namespace nop
+
+#endif  // NOP_ENABLE_INSTRUMENTATION
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_INSTRUMENTATION_H_
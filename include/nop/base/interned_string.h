@@ -0,0 +1,147 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_INTERNED_STRING_H_
+#define LIBNOP_INCLUDE_NOP_BASE_INTERNED_STRING_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/string.h>
+#include <nop/base/string_dictionary.h>
+#include <nop/types/interned_string.h>
+
+namespace nop {
+
+//
+// InternedString encoding formats:
+//
+// +-----+---------+---//----+
+// | STR | INT64:N | N BYTES |
+// +-----+---------+---//----+
+//
+// +-----+---------+---//----+
+// | SDF | INT64:N | N BYTES |
+// +-----+---------+---//----+
+//
+// +-----+----------+
+// | SRF | INT64:ID |
+// +-----+----------+
+//
+// A string definition (SDF) is laid out like a string and also gives the string
+// the next id in the dictionary of the session. A string reference (SRF) stands
+// for the string previously defined with ID. Definitions and references are
+// only written to writers that carry a string dictionary; otherwise, and when
+// the dictionary is full, the string is written as STR.
+//
+// The size computed for an InternedString is that of the STR encoding, which
+// is never less than the encoding actually written.
+//
+
+template <>
+struct Encoding<InternedString> : EncodingIO<InternedString> {
+  using Type = InternedString;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::String;
+  }
+
+  static std::size_t Size(const Type& value) {
+    return Encoding<std::string>::Size(value.get());
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::String ||
+           prefix == EncodingByte::StringDefinition ||
+           prefix == EncodingByte::StringReference;
+  }
+
+  // Writes a reference to |value| if it is in the dictionary of |writer|,
+  // otherwise a definition if there is room, or the string itself.
+  template <typename Writer>
+  static Status<void> Write(const Type& value, Writer* writer) {
+    StringEncodeDictionary* dictionary = GetStringEncodeDictionary(writer);
+    EncodingByte prefix = EncodingByte::String;
+    SizeType id = 0;
+    if (dictionary && dictionary->Find(value.get(), &id))
+      prefix = EncodingByte::StringReference;
+    else if (dictionary && dictionary->Define(value.get()))
+      prefix = EncodingByte::StringDefinition;
+
+    auto status = writer->Write(static_cast<std::uint8_t>(prefix));
+    if (!status)
+      return status;
+
+    if (prefix == EncodingByte::StringReference)
+      return Encoding<SizeType>::Write(id, writer);
+    else
+      return WritePayload(prefix, value, writer);
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    return Encoding<std::string>::WritePayload(EncodingByte::String,
+                                               value.get(), writer);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                  Reader* reader) {
+    StringDecodeDictionary* dictionary = GetStringDecodeDictionary(reader);
+    if (prefix != EncodingByte::String && !dictionary)
+      return ErrorStatus::InvalidStringReference;
+
+    if (prefix == EncodingByte::StringReference) {
+      SizeType id = 0;
+      auto status = Encoding<SizeType>::Read(&id, reader);
+      if (!status)
+        return status;
+
+      auto shared = dictionary->Find(id);
+      if (!shared)
+        return shared.error();
+
+      *value = InternedString{shared.take()};
+      return {};
+    }
+
+    std::string string;
+    auto status =
+        Encoding<std::string>::ReadPayload(EncodingByte::String, &string,
+                                           reader);
+    if (!status)
+      return status;
+
+    auto shared = std::make_shared<const std::string>(std::move(string));
+    if (prefix == EncodingByte::StringDefinition) {
+      status = dictionary->Define(shared);
+      if (!status)
+        return status;
+    }
+
+    *value = InternedString{std::move(shared)};
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_INTERNED_STRING_H_
@@ -19,9 +19,14 @@
 
 #include <map>
 #include <numeric>
+#include <type_traits>
 #include <unordered_map>
 
+#include <nop/base/allocator.h>
+#include <nop/base/canonical.h>
 #include <nop/base/encoding.h>
+#include <nop/base/min_encoded_size.h>
+#include <nop/base/size_cache.h>
 
 namespace nop {
 
@@ -33,6 +38,9 @@ namespace nop {
 // +-----+---------+--------//---------+
 //
 // Each pair must be a valid encoding of Key followed by a valid encoding of T.
+// Writers that request canonical encoding receive the pairs of unordered maps
+// ordered by the encoded bytes of their keys; std::map pairs are always written
+// in the order of the map.
 //
 
 template <typename Key, typename T, typename Compare, typename Allocator>
@@ -45,14 +53,22 @@ struct Encoding<std::map<Key, T, Compare, Allocator>>
   }
 
   static constexpr std::size_t Size(const Type& value) {
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache) {
+    // Elements are taken by reference to the stored pair; binding them to
+    // std::pair<Key, T> would size a temporary copy of every element.
     return BaseEncodingSize(Prefix(value)) +
            Encoding<SizeType>::Size(value.size()) +
-           std::accumulate(
-               value.cbegin(), value.cend(), 0U,
-               [](const std::size_t& sum, const std::pair<Key, T>& element) {
-                 return sum + Encoding<Key>::Size(element.first) +
-                        Encoding<T>::Size(element.second);
-               });
+           std::accumulate(value.cbegin(), value.cend(), 0U,
+                           [cache](const std::size_t& sum,
+                                   const typename Type::value_type& element) {
+                             const std::size_t key_size =
+                                 CachedSize(element.first, cache);
+                             return sum + key_size +
+                                    CachedSize(element.second, cache);
+                           });
   }
 
   static constexpr bool Match(EncodingByte prefix) {
@@ -88,9 +104,17 @@ struct Encoding<std::map<Key, T, Compare, Allocator>>
     if (!status)
       return status;
 
+    status = detail::ChargeAllocation(
+        size, sizeof(typename Type::value_type), reader);
+    if (!status)
+      return status;
+
     value->clear();
     for (SizeType i = 0; i < size; i++) {
-      std::pair<Key, T> element;
+      // Construct the element with the allocator of the map, so that it is
+      // moved rather than copied into the map by scoped allocators.
+      std::pair<Key, T> element =
+          detail::MakePairWithAllocator<Key, T>(value->get_allocator());
       status = Encoding<Key>::Read(&element.first, reader);
       if (!status)
         return status;
@@ -99,7 +123,9 @@ struct Encoding<std::map<Key, T, Compare, Allocator>>
       if (!status)
         return status;
 
-      value->emplace(std::move(element));
+      // Maps are written in key order, so inserting at the end is amortized
+      // constant time; out of order keys fall back to a full search.
+      value->emplace_hint(value->end(), std::move(element));
     }
 
     return {};
@@ -117,14 +143,22 @@ struct Encoding<std::unordered_map<Key, T, Hash, KeyEqual, Allocator>>
   }
 
   static constexpr std::size_t Size(const Type& value) {
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache) {
+    // Elements are taken by reference to the stored pair; binding them to
+    // std::pair<Key, T> would size a temporary copy of every element.
     return BaseEncodingSize(Prefix(value)) +
            Encoding<SizeType>::Size(value.size()) +
-           std::accumulate(
-               value.cbegin(), value.cend(), 0U,
-               [](const std::size_t& sum, const std::pair<Key, T>& element) {
-                 return sum + Encoding<Key>::Size(element.first) +
-                        Encoding<T>::Size(element.second);
-               });
+           std::accumulate(value.cbegin(), value.cend(), 0U,
+                           [cache](const std::size_t& sum,
+                                   const typename Type::value_type& element) {
+                             const std::size_t key_size =
+                                 CachedSize(element.first, cache);
+                             return sum + key_size +
+                                    CachedSize(element.second, cache);
+                           });
   }
 
   static constexpr bool Match(EncodingByte prefix) {
@@ -139,17 +173,7 @@ struct Encoding<std::unordered_map<Key, T, Hash, KeyEqual, Allocator>>
     if (!status)
       return status;
 
-    for (const auto& element : value) {
-      status = Encoding<Key>::Write(element.first, writer);
-      if (!status)
-        return status;
-
-      status = Encoding<T>::Write(element.second, writer);
-      if (!status)
-        return status;
-    }
-
-    return {};
+    return WriteElements(value, writer, IsCanonicalWriter<Writer>{});
   }
 
   template <typename Reader>
@@ -160,9 +184,21 @@ struct Encoding<std::unordered_map<Key, T, Hash, KeyEqual, Allocator>>
     if (!status)
       return status;
 
+    status = detail::ChargeAllocation(
+        size, sizeof(typename Type::value_type), reader);
+    if (!status)
+      return status;
+
+    // Reserve buckets for no more elements than the bytes remaining in the
+    // reader could hold, to avoid rehashing without trusting the size.
     value->clear();
+    value->reserve(ReserveLimit(
+        size, MinEncodedSize<Key>::value + MinEncodedSize<T>::value, reader));
     for (SizeType i = 0; i < size; i++) {
-      std::pair<Key, T> element;
+      // Construct the element with the allocator of the map, so that it is
+      // moved rather than copied into the map by scoped allocators.
+      std::pair<Key, T> element =
+          detail::MakePairWithAllocator<Key, T>(value->get_allocator());
       status = Encoding<Key>::Read(&element.first, reader);
       if (!status)
         return status;
@@ -176,6 +212,32 @@ struct Encoding<std::unordered_map<Key, T, Hash, KeyEqual, Allocator>>
 
     return {};
   }
+
+ private:
+  // Writes the elements in iteration order.
+  template <typename Writer>
+  static constexpr Status<void> WriteElements(const Type& value,
+                                              Writer* writer,
+                                              std::false_type) {
+    for (const auto& element : value) {
+      auto status = Encoding<Key>::Write(element.first, writer);
+      if (!status)
+        return status;
+
+      status = Encoding<T>::Write(element.second, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  // Writes the elements ordered by their encoded keys.
+  template <typename Writer>
+  static Status<void> WriteElements(const Type& value, Writer* writer,
+                                    std::true_type) {
+    return detail::WriteCanonicalMap<Key, T>(value, writer);
+  }
 };
 
 }  // namespace nop
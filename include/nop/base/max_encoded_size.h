@@ -0,0 +1,142 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_MAX_ENCODED_SIZE_H_
+#define LIBNOP_INCLUDE_NOP_BASE_MAX_ENCODED_SIZE_H_
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/traits/is_detected.h>
+#include <nop/traits/void.h>
+#include <nop/types/detail/member_pointer.h>
+
+namespace nop {
+
+//
+// MaxEncodedSize<T>::value is the largest number of bytes any value of type T
+// may take when encoded, for types whose encoding has a bounded size: bool,
+// integral, floating point and enum types (including enum flags), std::array
+// and C arrays of these, and structures made only of such members. Other types
+// have no member named value, which HasMaxEncodedSize<T> detects.
+//
+// The bound accounts for the widest prefix each value could be encoded with,
+// so it is an upper limit on the result of Encoding<T>::Size() for any value.
+//
+
+template <typename T, typename Enabled = void>
+struct MaxEncodedSize {};
+
+// Test expression for types with a bounded encoded size.
+template <typename T>
+using MaxEncodedSizeTest = decltype(MaxEncodedSize<T>::value);
+
+// Evaluates to true if the encoded size of type T is bounded.
+template <typename T>
+using HasMaxEncodedSize = IsDetected<MaxEncodedSizeTest, T>;
+
+template <>
+struct MaxEncodedSize<bool> {
+  enum : std::size_t { value = 1 };
+};
+
+// Integers and floating point values are at most a prefix followed by their
+// full width.
+template <typename T>
+struct MaxEncodedSize<T, std::enable_if_t<std::is_arithmetic<T>::value &&
+                                          !std::is_same<T, bool>::value>> {
+  enum : std::size_t { value = 1 + sizeof(T) };
+};
+
+template <typename T>
+struct MaxEncodedSize<T, std::enable_if_t<std::is_enum<T>::value>>
+    : MaxEncodedSize<std::underlying_type_t<T>> {};
+
+// Arrays of integral types use the binary format, other arrays the array
+// format.
+template <typename T, std::size_t Length>
+struct MaxEncodedSize<std::array<T, Length>, EnableIfIntegral<T>> {
+  enum : std::size_t {
+    value = BaseEncodingSize(EncodingByte::Binary) +
+            Encoding<SizeType>::Size(Length * sizeof(T)) + Length * sizeof(T)
+  };
+};
+
+template <typename T, std::size_t Length>
+struct MaxEncodedSize<
+    std::array<T, Length>,
+    std::enable_if_t<!std::is_integral<T>::value &&
+                     HasMaxEncodedSize<T>::value>> {
+  enum : std::size_t {
+    value = BaseEncodingSize(EncodingByte::Array) +
+            Encoding<SizeType>::Size(Length) +
+            Length * MaxEncodedSize<T>::value
+  };
+};
+
+template <typename T, std::size_t Length>
+struct MaxEncodedSize<T[Length]> : MaxEncodedSize<std::array<T, Length>> {};
+
+namespace detail {
+
+template <typename MemberList, typename Indices, typename = void>
+struct MaxMembersSize {};
+
+template <typename... Ts>
+constexpr std::size_t MaxEncodedSizeSum() {
+  const std::size_t sizes[] = {0, MaxEncodedSize<Ts>::value...};
+  std::size_t sum = 0;
+  for (std::size_t size : sizes)
+    sum += size;
+  return sum;
+}
+
+template <typename MemberList, std::size_t... Is>
+struct MaxMembersSize<
+    MemberList, std::index_sequence<Is...>,
+    Void<MaxEncodedSizeTest<typename MemberList::template At<Is>::Type>...>> {
+  enum : std::size_t {
+    value = MaxEncodedSizeSum<typename MemberList::template At<Is>::Type...>()
+  };
+};
+
+}  // namespace detail
+
+// Structures are bounded when all of their members are.
+template <typename T>
+struct MaxEncodedSize<
+    T, Void<EnableIfHasMemberList<T>,
+            decltype(detail::MaxMembersSize<
+                     typename MemberListTraits<T>::MemberList,
+                     std::make_index_sequence<
+                         MemberListTraits<T>::MemberList::Count>>::value)>> {
+  using MemberList = typename MemberListTraits<T>::MemberList;
+
+  enum : std::size_t {
+    value = BaseEncodingSize(EncodingByte::Structure) +
+            Encoding<SizeType>::Size(MemberList::Count) +
+            detail::MaxMembersSize<
+                MemberList, std::make_index_sequence<MemberList::Count>>::value
+  };
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_MAX_ENCODED_SIZE_H_
@@ -17,9 +17,21 @@
 #ifndef LIBNOP_INCLUDE_NOP_BASE_MEMBERS_H_
 #define LIBNOP_INCLUDE_NOP_BASE_MEMBERS_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
 #include <nop/base/encoding.h>
+#include <nop/base/fixed_structure.h>
+#include <nop/base/fixint_array.h>
 #include <nop/base/logical_buffer.h>
+#include <nop/base/size_cache.h>
+#include <nop/base/skip.h>
 #include <nop/base/utility.h>
+#include <nop/traits/is_borrowing_reader.h>
+#include <nop/traits/is_borrowing_writer.h>
 #include <nop/types/detail/member_pointer.h>
 
 namespace nop {
@@ -31,9 +43,114 @@ namespace nop {
 // | STC | INT64:N | N MEMBERS |
 // +-----+---------+-----//----+
 //
-// Members must be valid encodings of their member type.
+// Members must be valid encodings of their member type. Structures defined with
+// NOP_FIXED_STRUCTURE write their members with fixed width encodings; see
+// nop/base/fixed_structure.h.
+//
+// Runs of consecutive arithmetic and enum members are written to writers that
+// support Borrow() with a single bulk write: the encodings of the run are
+// formatted into a block on the stack and passed to the writer at once,
+// instead of making a call for the prefix and another for the payload of each
+// member. Borrowing writers take raw bytes without interpreting them, unlike
+// writers such as EndianWriter that convert arithmetic values, so the output
+// is the same either way.
+//
+// Reading works the same way in reverse for readers that support Borrow() and
+// report their remaining input. When the reader holds at least the largest
+// possible encoding of a run, the run is decoded straight from the borrowed
+// input without a bounds check for each member, and the reader is advanced
+// past the bytes it took in one step. Runs near the end of the input are read
+// member by member, so truncated input is still rejected.
 //
 
+namespace detail {
+
+// Upper bound on the size of the stack block used for a run of members.
+enum : std::size_t { kMaxFusedMemberBytes = 256 };
+
+// Bound on the encoded size of a member of type T that may be written as part
+// of a run, or zero if T may not.
+template <typename T>
+struct FusedMemberSize
+    : std::integral_constant<std::size_t,
+                             std::is_arithmetic<T>::value ||
+                                     std::is_enum<T>::value
+                                 ? 1 + sizeof(T)
+                                 : 0> {};
+
+// Infallible writer that collects the encodings of a run of members.
+template <std::size_t Capacity>
+class MemberBlockWriter {
+ public:
+  Status<void> Write(std::uint8_t byte) {
+    data_[size_++] = byte;
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::size_t length_bytes = (end - begin) * sizeof(T);
+    std::memcpy(&data_[size_], begin, length_bytes);
+    size_ += length_bytes;
+    return {};
+  }
+
+  bool infallible() const { return true; }
+
+  template <typename Writer>
+  Status<void> Flush(Writer* writer) const {
+    return writer->Write(data_, data_ + size_);
+  }
+
+ private:
+  std::uint8_t data_[Capacity];
+  std::size_t size_{0};
+};
+
+// Reader over borrowed input known to hold a whole run of members, which reads
+// without bounds checks. Trusted is the trusted property of the reader the
+// input was borrowed from.
+template <bool Trusted>
+class MemberBlockReader {
+ public:
+  explicit MemberBlockReader(const void* data)
+      : begin_{static_cast<const std::uint8_t*>(data)}, data_{begin_} {}
+
+  Status<void> Ensure(std::size_t /*size*/) { return {}; }
+
+  Status<void> Read(std::uint8_t* byte) {
+    *byte = *data_++;
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    const std::size_t length_bytes = (end - begin) * sizeof(T);
+    std::memcpy(begin, data_, length_bytes);
+    data_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    data_ += padding_bytes;
+    return {};
+  }
+
+  template <bool Enabled = Trusted, typename = std::enable_if_t<Enabled>>
+  bool trusted() const {
+    return true;
+  }
+
+  // Returns the number of bytes read.
+  std::size_t size() const { return data_ - begin_; }
+
+ private:
+  const std::uint8_t* begin_;
+  const std::uint8_t* data_;
+};
+
+}  // namespace detail
+
 template <typename T>
 struct Encoding<T, EnableIfHasMemberList<T>> : EncodingIO<T> {
   static constexpr EncodingByte Prefix(const T& /*value*/) {
@@ -41,8 +158,12 @@ struct Encoding<T, EnableIfHasMemberList<T>> : EncodingIO<T> {
   }
 
   static constexpr std::size_t Size(const T& value) {
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const T& value, SizeCache* cache) {
     return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(Count) +
-           Size(value, Index<Count>{});
+           Size(value, cache, Index<Count>{});
   }
 
   static constexpr bool Match(EncodingByte prefix) {
@@ -53,10 +174,10 @@ struct Encoding<T, EnableIfHasMemberList<T>> : EncodingIO<T> {
   static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
                                              const T& value, Writer* writer) {
     auto status = Encoding<SizeType>::Write(Count, writer);
-    if (!status)
+    if (!IsInfallibleWriter<Writer>::value && !status)
       return status;
     else
-      return WriteMembers(value, writer, Index<Count>{});
+      return WriteMembers(value, writer, IsFused<Writer>{});
   }
 
   template <typename Reader>
@@ -64,12 +185,37 @@ struct Encoding<T, EnableIfHasMemberList<T>> : EncodingIO<T> {
                                             Reader* reader) {
     SizeType size = 0;
     auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+    else if (!IsTrustedReader<Reader>::value && size != Count)
+      return ErrorStatus::InvalidMemberCount;
+    else
+      return ReadMembers(value, reader, IsFusedReader<Reader>{});
+  }
+
+  // Reads only the members in |Projection|, skipping the encodings of the
+  // other members without decoding them. Skipped members keep their values.
+  template <typename Projection, typename Reader>
+  static constexpr Status<void> ReadProjected(T* value, Reader* reader) {
+    static_assert(ProjectedCount<Projection>(Index<Count>{}) ==
+                      Projection::Count,
+                  "Projection members must be members of the structure.");
+
+    std::uint8_t prefix_byte = 0;
+    auto status = reader->Read(&prefix_byte);
+    if (!status)
+      return status;
+    else if (!Match(static_cast<EncodingByte>(prefix_byte)))
+      return ErrorStatus::UnexpectedEncodingType;
+
+    SizeType size = 0;
+    status = Encoding<SizeType>::Read(&size, reader);
     if (!status)
       return status;
     else if (size != Count)
       return ErrorStatus::InvalidMemberCount;
     else
-      return ReadMembers(value, reader, Index<Count>{});
+      return ReadProjectedMembers<Projection>(value, reader, Index<Count>{});
   }
 
  private:
@@ -80,11 +226,62 @@ struct Encoding<T, EnableIfHasMemberList<T>> : EncodingIO<T> {
   template <std::size_t Index>
   using PointerAt = typename MemberList::template At<Index>;
 
-  static constexpr std::size_t Size(const T& /*value*/, Index<0>) { return 0; }
+  static constexpr std::size_t Size(const T& /*value*/, SizeCache* /*cache*/,
+                                    Index<0>) {
+    return 0;
+  }
 
   template <std::size_t index>
-  static constexpr std::size_t Size(const T& value, Index<index>) {
-    return Size(value, Index<index - 1>{}) + PointerAt<index - 1>::Size(value);
+  static constexpr std::size_t Size(const T& value, SizeCache* cache,
+                                    Index<index>) {
+    // Size the members in order so that cached sizes are in write order.
+    const std::size_t size = Size(value, cache, Index<index - 1>{});
+    return size + MemberSize<PointerAt<index - 1>>(value, cache, IsFixed{});
+  }
+
+  using IsFixed = IsFixedMemberList<MemberList>;
+
+  template <typename Pointer>
+  static constexpr std::size_t MemberSize(const T& value, SizeCache* cache,
+                                          std::false_type) {
+    return Pointer::Size(value, cache);
+  }
+
+  template <typename Pointer>
+  static constexpr std::size_t MemberSize(const T& /*value*/,
+                                          SizeCache* /*cache*/,
+                                          std::true_type) {
+    return FixedEncoding<typename Pointer::Type>::Size;
+  }
+
+  template <typename Pointer, typename Writer>
+  static constexpr Status<void> WriteMember(const T& value, Writer* writer,
+                                            std::false_type) {
+    return Pointer::Write(value, writer, MemberList{});
+  }
+
+  template <typename Pointer, typename Writer>
+  static constexpr Status<void> WriteMember(const T& value, Writer* writer,
+                                            std::true_type) {
+    return FixedEncoding<typename Pointer::Type>::Write(Pointer::Resolve(value),
+                                                        writer);
+  }
+
+  template <typename Writer>
+  using IsFused =
+      std::integral_constant<bool, !IsFixed::value &&
+                                       IsBorrowingWriter<Writer>::value>;
+
+  template <typename Writer>
+  static constexpr Status<void> WriteMembers(const T& value, Writer* writer,
+                                             std::false_type /*fused*/) {
+    return WriteMembers(value, writer, Index<Count>{});
+  }
+
+  template <typename Writer>
+  static Status<void> WriteMembers(const T& value, Writer* writer,
+                                   std::true_type /*fused*/) {
+    return WriteRuns(value, writer, Index<0>{});
   }
 
   template <typename Writer>
@@ -93,14 +290,178 @@ struct Encoding<T, EnableIfHasMemberList<T>> : EncodingIO<T> {
     return {};
   }
 
+  // Writers that cannot fail write every member and keep the first error
+  // instead of branching after each member.
   template <std::size_t index, typename Writer>
   static constexpr Status<void> WriteMembers(const T& value, Writer* writer,
                                              Index<index>) {
     auto status = WriteMembers(value, writer, Index<index - 1>{});
+    if (!IsInfallibleWriter<Writer>::value && !status)
+      return status;
+
+    auto member_status =
+        WriteMember<PointerAt<index - 1>>(value, writer, IsFixed{});
+    return status ? member_status : status;
+  }
+
+  // Returns the end of the run of members starting at |begin|, which is one
+  // past |begin| if the member at |begin| cannot be part of a run.
+  template <std::size_t... Is>
+  static constexpr std::size_t RunEnd(std::size_t begin,
+                                      std::index_sequence<Is...>) {
+    const std::size_t sizes[] = {
+        detail::FusedMemberSize<typename PointerAt<Is>::Type>::value..., 0};
+    std::size_t end = begin;
+    std::size_t bytes = 0;
+    while (sizes[end] != 0 &&
+           bytes + sizes[end] <= detail::kMaxFusedMemberBytes) {
+      bytes += sizes[end];
+      end++;
+    }
+    return end == begin ? begin + 1 : end;
+  }
+
+  template <std::size_t... Is>
+  static constexpr std::size_t RunSize(std::size_t begin, std::size_t end,
+                                       std::index_sequence<Is...>) {
+    const std::size_t sizes[] = {
+        detail::FusedMemberSize<typename PointerAt<Is>::Type>::value..., 0};
+    std::size_t bytes = 0;
+    for (std::size_t i = begin; i < end; i++)
+      bytes += sizes[i];
+    return bytes;
+  }
+
+  template <typename Writer>
+  static Status<void> WriteRuns(const T& /*value*/, Writer* /*writer*/,
+                                Index<Count>) {
+    return {};
+  }
+
+  template <std::size_t begin, typename Writer>
+  static Status<void> WriteRuns(const T& value, Writer* writer, Index<begin>) {
+    enum : std::size_t {
+      End = RunEnd(begin, std::make_index_sequence<Count>{})
+    };
+    auto status =
+        WriteRun(value, writer, Index<begin>{}, Index<End>{},
+                 std::integral_constant<bool, (End - begin > 1)>{});
+    if (!IsInfallibleWriter<Writer>::value && !status)
+      return status;
+
+    auto rest_status = WriteRuns(value, writer, Index<End>{});
+    return status ? rest_status : status;
+  }
+
+  template <std::size_t begin, std::size_t end, typename Writer>
+  static Status<void> WriteRun(const T& value, Writer* writer, Index<begin>,
+                               Index<end>, std::false_type /*block*/) {
+    return WriteMember<PointerAt<begin>>(value, writer, std::false_type{});
+  }
+
+  template <std::size_t begin, std::size_t end, typename Writer>
+  static Status<void> WriteRun(const T& value, Writer* writer, Index<begin>,
+                               Index<end>, std::true_type /*block*/) {
+    enum : std::size_t {
+      Size = RunSize(begin, end, std::make_index_sequence<Count>{})
+    };
+    detail::MemberBlockWriter<Size> block;
+    WriteBlock(value, &block, Index<begin>{}, Index<end>{});
+    return block.Flush(writer);
+  }
+
+  template <std::size_t end, typename BlockWriter>
+  static void WriteBlock(const T& /*value*/, BlockWriter* /*block*/,
+                         Index<end>, Index<end>) {}
+
+  template <std::size_t index, std::size_t end, typename BlockWriter>
+  static void WriteBlock(const T& value, BlockWriter* block, Index<index>,
+                         Index<end>) {
+    PointerAt<index>::Write(value, block, MemberList{});
+    WriteBlock(value, block, Index<index + 1>{}, Index<end>{});
+  }
+
+  // Work budgets count each member, so budget readers read one at a time.
+  template <typename Reader>
+  using IsFusedReader =
+      And<IsBorrowingReader<Reader>, IsDetected<ReaderRemainingTest, Reader>,
+          std::integral_constant<bool, !IsBudgetReader<Reader>::value>>;
+
+  template <typename Reader>
+  static constexpr Status<void> ReadMembers(T* value, Reader* reader,
+                                            std::false_type /*fused*/) {
+    return ReadMembers(value, reader, Index<Count>{});
+  }
+
+  template <typename Reader>
+  static Status<void> ReadMembers(T* value, Reader* reader,
+                                  std::true_type /*fused*/) {
+    return ReadRuns(value, reader, Index<0>{});
+  }
+
+  template <typename Reader>
+  static Status<void> ReadRuns(T* /*value*/, Reader* /*reader*/,
+                               Index<Count>) {
+    return {};
+  }
+
+  template <std::size_t begin, typename Reader>
+  static Status<void> ReadRuns(T* value, Reader* reader, Index<begin>) {
+    enum : std::size_t {
+      End = RunEnd(begin, std::make_index_sequence<Count>{})
+    };
+    auto status = ReadRun(value, reader, Index<begin>{}, Index<End>{},
+                          std::integral_constant<bool, (End - begin > 1)>{});
     if (!status)
       return status;
     else
-      return PointerAt<index - 1>::Write(value, writer, MemberList{});
+      return ReadRuns(value, reader, Index<End>{});
+  }
+
+  template <std::size_t begin, std::size_t end, typename Reader>
+  static Status<void> ReadRun(T* value, Reader* reader, Index<begin>,
+                              Index<end>, std::false_type /*block*/) {
+    return ReadMembers(value, reader, Index<begin>{}, Index<end>{});
+  }
+
+  template <std::size_t begin, std::size_t end, typename Reader>
+  static Status<void> ReadRun(T* value, Reader* reader, Index<begin>,
+                              Index<end>, std::true_type /*block*/) {
+    enum : std::size_t {
+      Size = RunSize(begin, end, std::make_index_sequence<Count>{})
+    };
+    if (detail::BorrowableSize(reader) < Size)
+      return ReadMembers(value, reader, Index<begin>{}, Index<end>{});
+
+    const void* data = nullptr;
+    auto status = reader->Borrow(&data, 0);
+    if (!status)
+      return status;
+
+    detail::MemberBlockReader<IsTrustedReader<Reader>::value> block{data};
+    status = ReadMembers(value, &block, Index<begin>{}, Index<end>{});
+    if (!status)
+      return status;
+
+    // Advance past the bytes used by the run, a subset of those checked above.
+    return reader->Borrow(&data, block.size());
+  }
+
+  // Reads the members in the range [begin, end) one at a time.
+  template <std::size_t end, typename Reader>
+  static Status<void> ReadMembers(T* /*value*/, Reader* /*reader*/, Index<end>,
+                                  Index<end>) {
+    return {};
+  }
+
+  template <std::size_t index, std::size_t end, typename Reader>
+  static Status<void> ReadMembers(T* value, Reader* reader, Index<index>,
+                                  Index<end>) {
+    auto status = PointerAt<index>::Read(value, reader, MemberList{});
+    if (!status)
+      return status;
+    else
+      return ReadMembers(value, reader, Index<index + 1>{}, Index<end>{});
   }
 
   template <typename Reader>
@@ -118,6 +479,52 @@ struct Encoding<T, EnableIfHasMemberList<T>> : EncodingIO<T> {
     else
       return PointerAt<index - 1>::Read(value, reader, MemberList{});
   }
+
+  template <typename Projection>
+  static constexpr std::size_t ProjectedCount(Index<0>) {
+    return 0;
+  }
+
+  template <typename Projection, std::size_t index>
+  static constexpr std::size_t ProjectedCount(Index<index>) {
+    using Contains =
+        typename Projection::template Contains<PointerAt<index - 1>>;
+    return ProjectedCount<Projection>(Index<index - 1>{}) +
+           (Contains::value ? 1 : 0);
+  }
+
+  template <typename Projection, typename Reader>
+  static constexpr Status<void> ReadProjectedMembers(T* /*value*/,
+                                                     Reader* /*reader*/,
+                                                     Index<0>) {
+    return {};
+  }
+
+  template <typename Projection, std::size_t index, typename Reader>
+  static constexpr Status<void> ReadProjectedMembers(T* value, Reader* reader,
+                                                     Index<index>) {
+    auto status =
+        ReadProjectedMembers<Projection>(value, reader, Index<index - 1>{});
+    if (!status)
+      return status;
+
+    using Pointer = PointerAt<index - 1>;
+    return ReadProjectedMember<Pointer>(
+        value, reader, typename Projection::template Contains<Pointer>{});
+  }
+
+  template <typename Pointer, typename Reader>
+  static constexpr Status<void> ReadProjectedMember(T* value, Reader* reader,
+                                                    std::true_type) {
+    return Pointer::Read(value, reader, MemberList{});
+  }
+
+  template <typename Pointer, typename Reader>
+  static constexpr Status<void> ReadProjectedMember(T* /*value*/,
+                                                    Reader* reader,
+                                                    std::false_type) {
+    return SkipValue(reader);
+  }
 };
 
 }  // namespace nop
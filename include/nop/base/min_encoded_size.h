@@ -0,0 +1,127 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_MIN_ENCODED_SIZE_H_
+#define LIBNOP_INCLUDE_NOP_BASE_MIN_ENCODED_SIZE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/traits/is_detected.h>
+#include <nop/types/detail/member_pointer.h>
+
+namespace nop {
+
+//
+// MinEncodedSize<T>::value is a lower bound on the number of bytes any value of
+// type T takes when encoded. Every encoding has at least a prefix byte, which
+// is the bound used for most types; structures and arrays, whose encodings have
+// a fixed number of elements, sum the bounds of their elements.
+//
+// Containers use this bound to limit how much storage they reserve up front to
+// what the bytes remaining in the reader could actually hold.
+//
+
+template <typename T, typename Enabled = void>
+struct MinEncodedSize {
+  enum : std::size_t { value = 1 };
+};
+
+template <typename T, std::size_t Length>
+struct MinEncodedSize<std::array<T, Length>, EnableIfIntegral<T>> {
+  enum : std::size_t {
+    value = BaseEncodingSize(EncodingByte::Binary) +
+            Encoding<SizeType>::Size(Length * sizeof(T)) + Length * sizeof(T)
+  };
+};
+
+template <typename T, std::size_t Length>
+struct MinEncodedSize<std::array<T, Length>, EnableIfNotIntegral<T>> {
+  enum : std::size_t {
+    value = BaseEncodingSize(EncodingByte::Array) +
+            Encoding<SizeType>::Size(Length) +
+            Length * MinEncodedSize<T>::value
+  };
+};
+
+template <typename T, std::size_t Length>
+struct MinEncodedSize<T[Length]> : MinEncodedSize<std::array<T, Length>> {};
+
+namespace detail {
+
+template <typename... Ts>
+constexpr std::size_t MinEncodedSizeSum() {
+  const std::size_t sizes[] = {0, MinEncodedSize<Ts>::value...};
+  std::size_t sum = 0;
+  for (std::size_t size : sizes)
+    sum += size;
+  return sum;
+}
+
+template <typename MemberList, typename Indices>
+struct MinMembersSize;
+
+template <typename MemberList, std::size_t... Is>
+struct MinMembersSize<MemberList, std::index_sequence<Is...>> {
+  enum : std::size_t {
+    value = MinEncodedSizeSum<typename MemberList::template At<Is>::Type...>()
+  };
+};
+
+}  // namespace detail
+
+template <typename T>
+struct MinEncodedSize<T, EnableIfHasMemberList<T>> {
+  using MemberList = typename MemberListTraits<T>::MemberList;
+
+  enum : std::size_t {
+    value = BaseEncodingSize(EncodingByte::Structure) +
+            Encoding<SizeType>::Size(MemberList::Count) +
+            detail::MinMembersSize<
+                MemberList, std::make_index_sequence<MemberList::Count>>::value
+  };
+};
+
+// Test expression for readers that report the number of bytes remaining.
+template <typename Reader>
+using ReaderRemainingTest = decltype(std::declval<const Reader&>().remaining());
+
+// Returns how many elements of at least |min_element_size| bytes a container
+// may reserve for a length of |size| read from |reader|: no more than the
+// remaining bytes could hold, or none if the reader does not report them.
+template <typename Reader>
+constexpr std::enable_if_t<IsDetected<ReaderRemainingTest, Reader>::value,
+                           std::size_t>
+ReserveLimit(SizeType size, std::size_t min_element_size, const Reader* reader) {
+  return std::min<std::size_t>(size, reader->remaining() / min_element_size);
+}
+
+template <typename Reader>
+constexpr std::enable_if_t<!IsDetected<ReaderRemainingTest, Reader>::value,
+                           std::size_t>
+ReserveLimit(SizeType /*size*/, std::size_t /*min_element_size*/,
+             const Reader* /*reader*/) {
+  return 0;
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_MIN_ENCODED_SIZE_H_
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_OBJECT_TABLE_H_
+#define LIBNOP_INCLUDE_NOP_BASE_OBJECT_TABLE_H_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/status.h>
+#include <nop/traits/is_detected.h>
+
+namespace nop {
+
+//
+// Object tables hold the session state of the std::shared_ptr<T> encoding. The
+// first time an object is written through a writer carrying an
+// ObjectEncodeTable it is defined with the next id in sequence; later
+// occurrences of the same object are written as a reference to that id. A
+// reader carrying an ObjectDecodeTable assigns ids to definitions in the same
+// order and resolves references to the objects it has already decoded, so that
+// the decoded pointers share objects in the same way as the originals.
+//
+// Objects are identified by address and type. The encode table keeps every
+// object it has defined alive until the next Reset(), so that the address of a
+// defined object cannot be reused by a different object in the same session.
+//
+
+namespace detail {
+
+// Returns a unique value for each type T, without relying on RTTI.
+template <typename T>
+struct ObjectTypeId {
+  static const void* Get() { return &id; }
+  static const char id;
+};
+
+template <typename T>
+const char ObjectTypeId<T>::id = 0;
+
+}  // namespace detail
+
+class ObjectEncodeTable {
+ public:
+  ObjectEncodeTable() = default;
+
+  // Returns true and stores the id of |object| in |id| if |object| has been
+  // defined.
+  template <typename T>
+  bool Find(const std::shared_ptr<T>& object, SizeType* id) const {
+    auto search = ids_.find(Key(object));
+    if (search == ids_.end())
+      return false;
+
+    *id = search->second;
+    return true;
+  }
+
+  // Gives |object| the next id in sequence.
+  template <typename T>
+  void Define(const std::shared_ptr<T>& object) {
+    const SizeType id = objects_.size();
+    ids_.emplace(Key(object), id);
+    objects_.push_back(object);
+  }
+
+  // Forgets all definitions; the next definition has id zero.
+  void Reset() {
+    ids_.clear();
+    objects_.clear();
+  }
+
+  std::size_t size() const { return objects_.size(); }
+
+ private:
+  using KeyType = std::pair<const void*, const void*>;
+
+  template <typename T>
+  static KeyType Key(const std::shared_ptr<T>& object) {
+    return {static_cast<const void*>(object.get()),
+            detail::ObjectTypeId<std::remove_cv_t<T>>::Get()};
+  }
+
+  std::map<KeyType, SizeType> ids_;
+  std::vector<std::shared_ptr<const void>> objects_;
+};
+
+class ObjectDecodeTable {
+ public:
+  ObjectDecodeTable() = default;
+
+  // Returns the object defined with |id|. Returns an error if there is no such
+  // object, if it has a different type, or if it is still being decoded.
+  template <typename T>
+  Status<std::shared_ptr<T>> Find(SizeType id) const {
+    if (id >= entries_.size())
+      return ErrorStatus::InvalidObjectReference;
+
+    const Entry& entry = entries_[id];
+    if (!entry.complete || entry.type != detail::ObjectTypeId<T>::Get())
+      return ErrorStatus::InvalidObjectReference;
+
+    return std::static_pointer_cast<T>(entry.object);
+  }
+
+  // Gives |object| the next id in sequence and returns the id. The object may
+  // not be referred to until Complete() is called with the id, which prevents
+  // decoding a cycle of references.
+  template <typename T>
+  SizeType Define(std::shared_ptr<T> object) {
+    const SizeType id = entries_.size();
+    entries_.push_back(
+        {std::move(object), detail::ObjectTypeId<T>::Get(), false});
+    return id;
+  }
+
+  // Gives the next id in sequence to an object that was skipped instead of
+  // decoded, so that later definitions get the same ids as on the writer.
+  // References to the skipped object fail.
+  SizeType DefineSkipped() {
+    const SizeType id = entries_.size();
+    entries_.push_back({nullptr, nullptr, false});
+    return id;
+  }
+
+  // Marks the object defined with |id| as completely decoded.
+  void Complete(SizeType id) { entries_[id].complete = true; }
+
+  // Forgets all definitions; the next definition has id zero.
+  void Reset() { entries_.clear(); }
+
+  std::size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    std::shared_ptr<void> object;
+    const void* type;
+    bool complete;
+  };
+
+  std::vector<Entry> entries_;
+};
+
+// Test expression for writers and readers that carry an object table.
+template <typename WriterOrReader>
+using ObjectTableTest =
+    decltype(std::declval<WriterOrReader&>().object_table());
+
+// Returns the ObjectEncodeTable carried by |writer|, if any.
+template <typename Writer>
+std::enable_if_t<IsDetected<ObjectTableTest, Writer>::value,
+                 ObjectEncodeTable*>
+GetObjectEncodeTable(Writer* writer) {
+  return writer->object_table();
+}
+
+template <typename Writer>
+std::enable_if_t<!IsDetected<ObjectTableTest, Writer>::value,
+                 ObjectEncodeTable*>
+GetObjectEncodeTable(Writer* /*writer*/) {
+  return nullptr;
+}
+
+// Returns the ObjectDecodeTable carried by |reader|, if any.
+template <typename Reader>
+std::enable_if_t<IsDetected<ObjectTableTest, Reader>::value,
+                 ObjectDecodeTable*>
+GetObjectDecodeTable(Reader* reader) {
+  return reader->object_table();
+}
+
+template <typename Reader>
+std::enable_if_t<!IsDetected<ObjectTableTest, Reader>::value,
+                 ObjectDecodeTable*>
+GetObjectDecodeTable(Reader* /*reader*/) {
+  return nullptr;
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_OBJECT_TABLE_H_
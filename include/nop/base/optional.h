@@ -18,6 +18,7 @@
 #define LIBNOP_INCLUDE_NOP_BASE_OPTIONAL_H_
 
 #include <nop/base/encoding.h>
+#include <nop/base/size_cache.h>
 #include <nop/types/optional.h>
 
 namespace nop {
@@ -49,7 +50,11 @@ struct Encoding<Optional<T>> : EncodingIO<Optional<T>> {
   }
 
   static constexpr std::size_t Size(const Type& value) {
-    return value ? Encoding<T>::Size(value.get())
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache) {
+    return value ? CachedSize(value.get(), cache)
                  : BaseEncodingSize(EncodingByte::Nil);
   }
 
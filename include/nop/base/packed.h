@@ -0,0 +1,154 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_PACKED_H_
+#define LIBNOP_INCLUDE_NOP_BASE_PACKED_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/vector.h>
+#include <nop/types/packed.h>
+#include <nop/utility/bit_packing.h>
+
+namespace nop {
+
+//
+// Packed<T> encoding format:
+//
+// +-----+---------+-------------+-----+---------+---//---+
+// | PKA | INT64:N | INT64:FIRST | BIN | INT64:L | BLOCKS |
+// +-----+---------+-------------+-----+---------+---//---+
+//
+// FIRST is the first element, or zero for an empty array. BLOCKS holds the
+// N - 1 differences between consecutive elements, zigzag encoded, in blocks of
+// detail::kPackedBlockSize; each block is a byte W followed by its differences
+// packed W bits each. See docs/format.md for the details.
+//
+// Packed<T> decodes any encoding of std::vector<T>.
+//
+
+template <typename T, typename Allocator>
+struct Encoding<Packed<T, Allocator>> : EncodingIO<Packed<T, Allocator>> {
+  using Type = Packed<T, Allocator>;
+  using VectorType = typename Type::VectorType;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::PackedArray;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    const VectorType& elements = value.get();
+    std::size_t blocks_size = 0;
+    ForEachBlock(elements, [&blocks_size](const std::uint64_t* /*deltas*/,
+                                          std::size_t count,
+                                          std::size_t width) {
+      blocks_size += 1 + PackedSize(count, width);
+    });
+
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(elements.size()) +
+           Encoding<std::int64_t>::Size(First(elements)) +
+           BaseEncodingSize(EncodingByte::Binary) +
+           Encoding<SizeType>::Size(blocks_size) + blocks_size;
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* /*cache*/) {
+    return Size(value);
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<VectorType>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    const VectorType& elements = value.get();
+    auto status = Encoding<SizeType>::Write(elements.size(), writer);
+    if (!status)
+      return status;
+
+    status = Encoding<std::int64_t>::Write(First(elements), writer);
+    if (!status)
+      return status;
+
+    // Pack the blocks into one buffer so that the total length is known when
+    // the binary header is written.
+    std::vector<std::uint8_t> blocks;
+    ForEachBlock(elements, [&blocks](const std::uint64_t* deltas,
+                                     std::size_t count, std::size_t width) {
+      const std::size_t offset = blocks.size();
+      blocks.resize(offset + 1 + PackedSize(count, width));
+      blocks[offset] = static_cast<std::uint8_t>(width);
+      PackBits(deltas, count, width, blocks.data() + offset + 1);
+    });
+
+    status = writer->Write(static_cast<std::uint8_t>(EncodingByte::Binary));
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(blocks.size(), writer);
+    if (!status)
+      return status;
+
+    return writer->Write(blocks.data(), blocks.data() + blocks.size());
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    return Encoding<VectorType>::ReadPayload(prefix, &value->get(), reader);
+  }
+
+ private:
+  static constexpr std::int64_t First(const VectorType& elements) {
+    return elements.empty()
+               ? 0
+               : static_cast<std::int64_t>(detail::WidenInteger(elements[0]));
+  }
+
+  // Calls |function(deltas, count, width)| for each block of zigzag-encoded
+  // differences between consecutive elements.
+  template <typename Function>
+  static void ForEachBlock(const VectorType& elements, Function function) {
+    std::uint64_t deltas[detail::kPackedBlockSize];
+    for (std::size_t index = 1; index < elements.size();
+         index += detail::kPackedBlockSize) {
+      const std::size_t count = std::min<std::size_t>(
+          detail::kPackedBlockSize, elements.size() - index);
+
+      std::uint64_t bits = 0;
+      for (std::size_t i = 0; i < count; i++) {
+        const std::uint64_t delta =
+            detail::WidenInteger(elements[index + i]) -
+            detail::WidenInteger(elements[index + i - 1]);
+        deltas[i] = ZigZagEncode(static_cast<std::int64_t>(delta));
+        bits |= deltas[i];
+      }
+
+      function(deltas, count, BitWidth(bits));
+    }
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_PACKED_H_
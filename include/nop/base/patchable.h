@@ -0,0 +1,128 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_PATCHABLE_H_
+#define LIBNOP_INCLUDE_NOP_BASE_PATCHABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/max_encoded_size.h>
+#include <nop/base/utility.h>
+#include <nop/traits/is_detected.h>
+#include <nop/types/patchable.h>
+
+namespace nop {
+
+//
+// Patchable<T, Index> encoding format:
+//
+// +-----+---------+
+// | INT | PAYLOAD |
+// +-----+---------+
+//
+// Where INT is the U8, U16, U32, or U64 prefix for unsigned T and the I8, I16,
+// I32, or I64 prefix for signed T, matching sizeof(T), and the payload is the
+// sizeof(T) byte little-endian value. This is an ordinary integer encoding that
+// simply never uses a narrower form.
+//
+
+// Test expression for writers that record the positions of patchable fields.
+// Such writers implement the following method, which is called right before
+// the payload of the field with the given index is written:
+//
+//   constexpr Status<void> MarkField(std::size_t index, std::size_t width);
+//
+template <typename Writer>
+using WriterMarkFieldTest = decltype(std::declval<Writer&>().MarkField(
+    std::declval<std::size_t>(), std::declval<std::size_t>()));
+
+namespace detail {
+
+template <typename T>
+constexpr EncodingByte PatchablePrefix() {
+  return std::is_signed<T>::value
+             ? (sizeof(T) == 1   ? EncodingByte::I8
+                : sizeof(T) == 2 ? EncodingByte::I16
+                : sizeof(T) == 4 ? EncodingByte::I32
+                                 : EncodingByte::I64)
+             : (sizeof(T) == 1   ? EncodingByte::U8
+                : sizeof(T) == 2 ? EncodingByte::U16
+                : sizeof(T) == 4 ? EncodingByte::U32
+                                 : EncodingByte::U64);
+}
+
+template <typename Writer>
+constexpr std::enable_if_t<IsDetected<WriterMarkFieldTest, Writer>::value,
+                           Status<void>>
+MarkField(std::size_t index, std::size_t width, Writer* writer) {
+  return writer->MarkField(index, width);
+}
+
+template <typename Writer>
+constexpr std::enable_if_t<!IsDetected<WriterMarkFieldTest, Writer>::value,
+                           Status<void>>
+MarkField(std::size_t /*index*/, std::size_t /*width*/, Writer* /*writer*/) {
+  return {};
+}
+
+}  // namespace detail
+
+template <typename T, std::size_t Index>
+struct Encoding<Patchable<T, Index>> : EncodingIO<Patchable<T, Index>> {
+  using Type = Patchable<T, Index>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return detail::PatchablePrefix<T>();
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return BaseEncodingSize(Prefix(value));
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<T>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    auto status = detail::MarkField(Index, sizeof(T), writer);
+    if (!status)
+      return status;
+
+    const T payload = value.value_;
+    return writer->Write(&payload, &payload + 1);
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    return Encoding<T>::ReadPayload(prefix, &value->value_, reader);
+  }
+};
+
+template <typename T, std::size_t Index>
+struct MaxEncodedSize<Patchable<T, Index>> : MaxEncodedSize<T> {};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_PATCHABLE_H_
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_RANGE_H_
+#define LIBNOP_INCLUDE_NOP_BASE_RANGE_H_
+
+#include <cstddef>
+#include <type_traits>
+
+#include <nop/base/encoding.h>
+#include <nop/base/size_cache.h>
+#include <nop/base/utility.h>
+#include <nop/types/range.h>
+
+namespace nop {
+
+//
+// Range<Iterator> encoding format for integral element types:
+//
+// +-----+---------+---//----+
+// | BIN | INT64:L | L BYTES |
+// +-----+---------+---//----+
+//
+// Where L = N * sizeof(T).
+//
+// Range<Iterator> encoding format for non-integral element types:
+//
+// +-----+---------+-----//-----+
+// | ARY | INT64:N | N ELEMENTS |
+// +-----+---------+-----//-----+
+//
+// Both formats are the same as std::vector<T> of the element type T. Ranges
+// may only be written.
+//
+
+template <typename Iterator>
+struct Encoding<Range<Iterator>> : EncodingIO<Range<Iterator>> {
+  using Type = Range<Iterator>;
+  using ElementType = std::decay_t<typename Type::value_type>;
+  enum : bool { IsBinary = std::is_integral<ElementType>::value };
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return IsBinary ? EncodingByte::Binary : EncodingByte::Array;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache) {
+    return Size(value, cache, std::integral_constant<bool, IsBinary>{});
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == (IsBinary ? EncodingByte::Binary : EncodingByte::Array);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    return WritePayload(value, writer,
+                        std::integral_constant<bool, IsBinary>{});
+  }
+
+ private:
+  static constexpr std::size_t Size(const Type& value, SizeCache* /*cache*/,
+                                    std::true_type) {
+    const SizeType size = value.size() * sizeof(ElementType);
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(size) +
+           size;
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache,
+                                    std::false_type) {
+    std::size_t size = BaseEncodingSize(Prefix(value)) +
+                       Encoding<SizeType>::Size(value.size());
+    Iterator element = value.begin();
+    for (std::size_t i = 0; i < value.size(); i++, ++element)
+      size += CachedSize(static_cast<const ElementType&>(*element), cache);
+    return size;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(const Type& value, Writer* writer,
+                                             std::true_type) {
+    const SizeType length_bytes = value.size() * sizeof(ElementType);
+    auto status = Encoding<SizeType>::Write(length_bytes, writer);
+    if (!status)
+      return status;
+
+    return WriteElements(value.begin(), value.size(), writer);
+  }
+
+  // Contiguous elements are written in one call.
+  template <typename T, typename Writer>
+  static constexpr Status<void> WriteElements(T* begin,
+                                              std::size_t size,
+                                              Writer* writer) {
+    return writer->Write(begin, begin + size);
+  }
+
+  template <typename ElementIterator, typename Writer>
+  static constexpr Status<void> WriteElements(ElementIterator element,
+                                              std::size_t size,
+                                              Writer* writer) {
+    for (std::size_t i = 0; i < size; i++, ++element) {
+      const ElementType temp = *element;
+      auto status = writer->Write(&temp, &temp + 1);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(const Type& value, Writer* writer,
+                                             std::false_type) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    Iterator element = value.begin();
+    for (std::size_t i = 0; i < value.size(); i++, ++element) {
+      status = Encoding<ElementType>::Write(*element, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_RANGE_H_
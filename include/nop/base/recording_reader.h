@@ -0,0 +1,68 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_RECORDING_READER_H_
+#define LIBNOP_INCLUDE_NOP_BASE_RECORDING_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+namespace detail {
+
+// Reader adapter that appends every byte read or skipped to a vector.
+template <typename Reader>
+class RecordingReader {
+ public:
+  RecordingReader(Reader* reader, std::vector<std::uint8_t>* bytes)
+      : reader_{reader}, bytes_{bytes} {}
+
+  Status<void> Ensure(std::size_t size) { return reader_->Ensure(size); }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    auto status = reader_->Read(begin, end);
+    if (!status)
+      return status;
+
+    const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(begin);
+    bytes_->insert(bytes_->end(), bytes, bytes + (end - begin) * sizeof(T));
+    return {};
+  }
+
+  Status<void> Skip(std::size_t size) {
+    const std::size_t offset = bytes_->size();
+    bytes_->resize(offset + size);
+    std::uint8_t* data = bytes_->data() + offset;
+    return reader_->Read(data, data + size);
+  }
+
+ private:
+  Reader* reader_;
+  std::vector<std::uint8_t>* bytes_;
+};
+
+}  // namespace detail
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_RECORDING_READER_H_
@@ -23,7 +23,8 @@
 
 namespace nop {
 
-// std::reference_wrapper<T> encoding forwards to Encoding<T>.
+// std::reference_wrapper<T> encoding forwards to Encoding<T>. References to
+// const values, such as std::cref() of a container, may only be written.
 
 template <typename T>
 struct Encoding<std::reference_wrapper<T>>
@@ -56,6 +57,31 @@ struct Encoding<std::reference_wrapper<T>>
   }
 };
 
+template <typename T>
+struct Encoding<std::reference_wrapper<const T>>
+    : EncodingIO<std::reference_wrapper<const T>> {
+  using Type = std::reference_wrapper<const T>;
+
+  static constexpr EncodingByte Prefix(const Type& value) {
+    return Encoding<T>::Prefix(value);
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return Encoding<T>::Size(value);
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<T>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte prefix,
+                                             const Type& value,
+                                             Writer* writer) {
+    return Encoding<T>::WritePayload(prefix, value, writer);
+  }
+};
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_BASE_REFERENCE_WRAPPER_H_
@@ -17,10 +17,19 @@
 #ifndef LIBNOP_INCLUDE_NOP_BASE_SERIALIZER_H_
 #define LIBNOP_INCLUDE_NOP_BASE_SERIALIZER_H_
 
+#include <cstdint>
 #include <memory>
+#include <type_traits>
+#include <utility>
 
 #include <nop/base/encoding.h>
+#include <nop/base/size_cache.h>
+#include <nop/base/skip.h>
+#include <nop/base/tracepoints.h>
+#include <nop/base/type_name.h>
 #include <nop/status.h>
+#include <nop/traits/is_detected.h>
+#include <nop/traits/is_single_pass_writer.h>
 
 namespace nop {
 
@@ -48,21 +57,99 @@ namespace nop {
 // deserialization tasks.
 //
 
+namespace detail {
+
+// Returns the name of type T as a tracepoint argument.
+template <typename T>
+std::uint64_t TraceTypeName() {
+  return reinterpret_cast<std::uintptr_t>(TypeName<T>());
+}
+
+}  // namespace detail
+
+// Test expression for writers that buffer output until Flush() is called.
+template <typename Writer>
+using WriterFlushTest = decltype(std::declval<Writer&>().Flush());
+
 // Implementation of Write method common to all Serializer specializations.
 struct SerializerCommon {
   template <typename T, typename Writer>
   static constexpr Status<void> Write(const T& value, Writer* writer) {
-    // Determine how much space to prepare the writer for.
-    const std::size_t size_bytes = Encoding<T>::Size(value);
+    NOP_TRACE(write_entry, detail::TraceTypeName<T>(),
+              Encoding<T>::Size(value));
+    auto status = WriteAndFlush(value, writer);
+    NOP_TRACE(write_exit, detail::TraceTypeName<T>(),
+              static_cast<std::uint64_t>(status.error()));
+    return status;
+  }
+
+ private:
+  template <typename T, typename Writer>
+  static constexpr Status<void> WriteAndFlush(const T& value, Writer* writer) {
+    // Serialize the data to the writer.
+    auto status = WriteValue(value, writer);
+    if (!status)
+      return status;
+
+    // Give buffering writers the chance to send the complete value at once.
+    return Flush(writer);
+  }
+
+  template <typename T, typename Writer>
+  static constexpr std::enable_if_t<!IsSinglePassWriter<Writer>::value,
+                                    Status<void>>
+  WriteValue(const T& value, Writer* writer) {
+    // Determine how much space to prepare the writer for, remembering the
+    // sizes of table entries so they are not computed again while writing.
+    SizeCache cache;
+    const std::size_t size_bytes = CachedSize(value, &cache);
 
     // Prepare the writer for the serialized data.
     auto status = writer->Prepare(size_bytes);
     if (!status)
       return status;
 
-    // Serialize the data to the writer.
+    if (cache.empty()) {
+      return Encoding<T>::Write(value, writer);
+    } else {
+      SizeCacheWriter<Writer> cache_writer{writer, &cache};
+      return Encoding<T>::Write(value, &cache_writer);
+    }
+  }
+
+  // Single-pass writers check bounds as they go; skip the Size() walk.
+  template <typename T, typename Writer>
+  static constexpr std::enable_if_t<IsSinglePassWriter<Writer>::value,
+                                    Status<void>>
+  WriteValue(const T& value, Writer* writer) {
     return Encoding<T>::Write(value, writer);
   }
+
+  template <typename Writer>
+  static constexpr std::enable_if_t<IsDetected<WriterFlushTest, Writer>::value,
+                                    Status<void>>
+  Flush(Writer* writer) {
+    return writer->Flush();
+  }
+
+  template <typename Writer>
+  static constexpr std::enable_if_t<!IsDetected<WriterFlushTest, Writer>::value,
+                                    Status<void>>
+  Flush(Writer* /*writer*/) {
+    return {};
+  }
+};
+
+// Implementation of Read method common to all Deserializer specializations.
+struct DeserializerCommon {
+  template <typename T, typename Reader>
+  static constexpr Status<void> Read(T* value, Reader* reader) {
+    NOP_TRACE(read_entry, detail::TraceTypeName<T>());
+    auto status = Encoding<T>::Read(value, reader);
+    NOP_TRACE(read_exit, detail::TraceTypeName<T>(),
+              static_cast<std::uint64_t>(status.error()));
+    return status;
+  }
 };
 
 // Serializer with internal instance of Writer.
@@ -175,7 +262,17 @@ class Deserializer {
   // Deserializes the data from the reader.
   template <typename T>
   constexpr Status<void> Read(T* value) {
-    return Encoding<T>::Read(value, &reader_);
+    return DeserializerCommon::Read(value, &reader_);
+  }
+
+  // Skips the next value without decoding it.
+  constexpr Status<void> Skip() { return SkipValue(&reader_); }
+
+  // Deserializes only the members of |value| listed in |Projection|, skipping
+  // the others. See nop/projection.h.
+  template <typename Projection, typename T>
+  constexpr Status<void> ReadProjected(T* value) {
+    return Encoding<T>::template ReadProjected<Projection>(value, &reader_);
   }
 
   constexpr const Reader& reader() const { return reader_; }
@@ -201,7 +298,17 @@ class Deserializer<Reader*> {
   // Deserializes the data from the reader.
   template <typename T>
   constexpr Status<void> Read(T* value) {
-    return Encoding<T>::Read(value, reader_);
+    return DeserializerCommon::Read(value, reader_);
+  }
+
+  // Skips the next value without decoding it.
+  constexpr Status<void> Skip() { return SkipValue(reader_); }
+
+  // Deserializes only the members of |value| listed in |Projection|, skipping
+  // the others. See nop/projection.h.
+  template <typename Projection, typename T>
+  constexpr Status<void> ReadProjected(T* value) {
+    return Encoding<T>::template ReadProjected<Projection>(value, reader_);
   }
 
   constexpr const Reader& reader() const { return *reader_; }
@@ -224,7 +331,17 @@ class Deserializer<std::unique_ptr<Reader>> {
   // Deserializes the data from the reader.
   template <typename T>
   constexpr Status<void> Read(T* value) {
-    return Encoding<T>::Read(value, reader_.get());
+    return DeserializerCommon::Read(value, reader_.get());
+  }
+
+  // Skips the next value without decoding it.
+  constexpr Status<void> Skip() { return SkipValue(reader_.get()); }
+
+  // Deserializes only the members of |value| listed in |Projection|, skipping
+  // the others. See nop/projection.h.
+  template <typename Projection, typename T>
+  constexpr Status<void> ReadProjected(T* value) {
+    return Encoding<T>::template ReadProjected<Projection>(value, reader_.get());
   }
 
   constexpr const Reader& reader() const { return *reader_; }
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_SHARED_BLOB_H_
+#define LIBNOP_INCLUDE_NOP_BASE_SHARED_BLOB_H_
+
+#include <cstdint>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/types/file_handle.h>
+#include <nop/types/shared_blob.h>
+
+namespace nop {
+
+//
+// SharedBlob encoding format:
+//
+// +-----+---------+--------+-------------+-------------+
+// | STC | INT64:3 | HANDLE | UINT:OFFSET | UINT:LENGTH |
+// +-----+---------+--------+-------------+-------------+
+//
+// Handle must be a valid encoding of a FileHandle referring to a memfd sealed
+// against writing and shrinking; it may be empty only when length is zero.
+// Offset and length select the payload within the memfd. The format is the
+// same as a structure of those three members.
+//
+
+template <>
+struct Encoding<SharedBlob> : EncodingIO<SharedBlob> {
+  using Type = SharedBlob;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Structure;
+  }
+
+  static std::size_t Size(const Type& value) {
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(3u) +
+           Encoding<FileHandle>::Size(value.handle()) +
+           Encoding<std::uint64_t>::Size(value.offset()) +
+           Encoding<std::uint64_t>::Size(value.size());
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Structure;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    // An unsealed memfd could be modified under the receiver.
+    if (value.handle() && !value.is_sealed())
+      return ErrorStatus::InvalidHandleValue;
+
+    auto status = Encoding<SizeType>::Write(3u, writer);
+    if (!status)
+      return status;
+
+    status = Encoding<FileHandle>::Write(value.handle(), writer);
+    if (!status)
+      return status;
+
+    status = Encoding<std::uint64_t>::Write(value.offset(), writer);
+    if (!status)
+      return status;
+
+    return Encoding<std::uint64_t>::Write(value.size(), writer);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    SizeType count = 0;
+    auto status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+    else if (count != 3u)
+      return ErrorStatus::InvalidMemberCount;
+
+    FileHandle handle;
+    status = Encoding<FileHandle>::Read(&handle, reader);
+    if (!status)
+      return status;
+
+    // Take ownership of the received fd before anything else can fail.
+    UniqueFileHandle fd{handle.get()};
+
+    std::uint64_t offset = 0;
+    status = Encoding<std::uint64_t>::Read(&offset, reader);
+    if (!status)
+      return status;
+
+    std::uint64_t size = 0;
+    status = Encoding<std::uint64_t>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    if (!fd) {
+      if (size != 0)
+        return ErrorStatus::InvalidHandleValue;
+      *value = SharedBlob{};
+      return {};
+    }
+
+    auto blob = SharedBlob::Map(std::move(fd), offset, size);
+    if (!blob)
+      return blob.error();
+
+    *value = blob.take();
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_SHARED_BLOB_H_
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_SHARED_PTR_H_
+#define LIBNOP_INCLUDE_NOP_BASE_SHARED_PTR_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include <nop/base/encoding.h>
+#include <nop/base/object_table.h>
+
+namespace nop {
+
+//
+// std::shared_ptr<T> encoding formats:
+//
+// +-----+
+// | NIL |
+// +-----+
+//
+// +---//----+
+// | ELEMENT |
+// +---//----+
+//
+// +-----+---//----+
+// | ODF | ELEMENT |
+// +-----+---//----+
+//
+// +-----+----------+
+// | ORF | INT64:ID |
+// +-----+----------+
+//
+// A null pointer is encoded as NIL. Element must be a valid encoding of type T.
+// An object definition (ODF) gives the object the next id in the object table
+// of the session; an object reference (ORF) stands for the object previously
+// defined with ID. Definitions and references are only written to writers that
+// carry an object table; otherwise the object is written as ELEMENT, once for
+// every pointer to it, and decoded into a separate object each time.
+//
+// The size computed for a pointer is an upper bound that counts the object in
+// full for every pointer to it. Pointers must not form cycles: computing the
+// size of a cyclic graph does not terminate, and cyclic references are
+// rejected while decoding. Types T that may themselves be encoded as NIL are
+// decoded as null pointers when they are.
+//
+
+template <typename T>
+struct Encoding<std::shared_ptr<T>> : EncodingIO<std::shared_ptr<T>> {
+  using Type = std::shared_ptr<T>;
+  using ValueType = std::remove_cv_t<T>;
+
+  static constexpr EncodingByte Prefix(const Type& value) {
+    return value ? Encoding<ValueType>::Prefix(*value) : EncodingByte::Nil;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    // A definition adds a prefix to the element; a reference may be larger
+    // than a small element.
+    return value ? std::max(1 + Encoding<ValueType>::Size(*value),
+                            1 + BaseEncodingSize(EncodingByte::U64))
+                 : BaseEncodingSize(EncodingByte::Nil);
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Nil ||
+           prefix == EncodingByte::ObjectDefinition ||
+           prefix == EncodingByte::ObjectReference ||
+           Encoding<ValueType>::Match(prefix);
+  }
+
+  // Writes a reference to |value| if it is in the object table of |writer|,
+  // otherwise a definition if there is a table, or the object itself.
+  template <typename Writer>
+  static Status<void> Write(const Type& value, Writer* writer) {
+    ObjectEncodeTable* table = GetObjectEncodeTable(writer);
+    if (!value || !table)
+      return EncodingIO<Type>::Write(value, writer);
+
+    SizeType id = 0;
+    if (table->Find(value, &id)) {
+      auto status = writer->Write(
+          static_cast<std::uint8_t>(EncodingByte::ObjectReference));
+      if (!status)
+        return status;
+
+      return Encoding<SizeType>::Write(id, writer);
+    }
+
+    // Define the object before writing it, matching the order of the ids
+    // assigned by the reader.
+    table->Define(value);
+    auto status = writer->Write(
+        static_cast<std::uint8_t>(EncodingByte::ObjectDefinition));
+    if (!status)
+      return status;
+
+    return Encoding<ValueType>::Write(*value, writer);
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte prefix, const Type& value,
+                                   Writer* writer) {
+    if (value)
+      return Encoding<ValueType>::WritePayload(prefix, *value, writer);
+    else
+      return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                  Reader* reader) {
+    if (prefix == EncodingByte::Nil) {
+      value->reset();
+      return {};
+    }
+
+    ObjectDecodeTable* table = GetObjectDecodeTable(reader);
+    if (prefix == EncodingByte::ObjectReference) {
+      if (!table)
+        return ErrorStatus::InvalidObjectReference;
+
+      SizeType id = 0;
+      auto status = Encoding<SizeType>::Read(&id, reader);
+      if (!status)
+        return status;
+
+      auto object = table->template Find<ValueType>(id);
+      if (!object)
+        return object.error();
+
+      *value = object.take();
+      return {};
+    }
+
+    auto object = std::make_shared<ValueType>();
+    if (prefix == EncodingByte::ObjectDefinition) {
+      if (!table)
+        return ErrorStatus::InvalidObjectReference;
+
+      const SizeType id = table->Define(object);
+      auto status = Encoding<ValueType>::Read(object.get(), reader);
+      if (!status)
+        return status;
+
+      table->Complete(id);
+    } else {
+      auto status =
+          Encoding<ValueType>::ReadPayload(prefix, object.get(), reader);
+      if (!status)
+        return status;
+    }
+
+    *value = std::move(object);
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_SHARED_PTR_H_
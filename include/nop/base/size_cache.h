@@ -0,0 +1,225 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_SIZE_CACHE_H_
+#define LIBNOP_INCLUDE_NOP_BASE_SIZE_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/traits/is_detected.h>
+#include <nop/types/handle.h>
+
+namespace nop {
+
+//
+// SizeCache memoizes the sizes of table entries for the duration of one
+// Serializer::Write() call. Table entries are prefixed by the size of their
+// value, which would otherwise be computed again while writing each entry,
+// once for every level of table nesting above it.
+//
+// Sizes are recorded in the order the entries are visited while computing the
+// size of the top-level value, which is the order they are written in, and are
+// consumed in that order while writing. Each record is keyed by the address of
+// the entry, so that a subtree that is sized without the cache simply falls
+// back to computing its entry sizes again instead of consuming the wrong
+// record.
+//
+// The cache has a fixed capacity so that it may be used in constant
+// expressions and without dynamic memory allocation; entries beyond the
+// capacity are sized on demand as before.
+//
+class SizeCache {
+ public:
+  enum : std::size_t { kCapacity = 32, kInvalidSlot = kCapacity };
+
+  constexpr SizeCache() = default;
+
+  // Reserves the next record for the entry at |key| and returns its slot, or
+  // kInvalidSlot if the cache is full. Reserving before sizing the value of an
+  // entry keeps the records of nested entries after their parent.
+  constexpr std::size_t Reserve(const void* key) {
+    if (count_ == kCapacity)
+      return kInvalidSlot;
+
+    records_[count_].key = key;
+    return count_++;
+  }
+
+  // Records |size| in a slot returned by Reserve().
+  constexpr void Set(std::size_t slot, std::size_t size) {
+    if (slot != kInvalidSlot)
+      records_[slot].size = size;
+  }
+
+  // Consumes the next record if it belongs to the entry at |key|.
+  constexpr bool Take(const void* key, std::size_t* size) {
+    if (index_ == count_ || records_[index_].key != key)
+      return false;
+
+    *size = records_[index_++].size;
+    return true;
+  }
+
+  constexpr std::size_t size() const { return count_; }
+  constexpr bool empty() const { return count_ == 0; }
+
+ private:
+  struct Record {
+    const void* key{nullptr};
+    std::size_t size{0};
+  };
+
+  Record records_[kCapacity]{};
+  std::size_t count_{0};
+  std::size_t index_{0};
+};
+
+// Test expression for encodings that can record sizes in a SizeCache.
+template <typename T>
+using EncodingCachedSizeTest = decltype(Encoding<T>::Size(
+    std::declval<const T&>(), std::declval<SizeCache*>()));
+
+// Returns the encoded size of |value|, recording the sizes of any table entries
+// it contains in |cache| when the encoding of T supports it. |cache| may be
+// nullptr.
+template <typename T>
+constexpr std::enable_if_t<IsDetected<EncodingCachedSizeTest, T>::value,
+                           std::size_t>
+CachedSize(const T& value, SizeCache* cache) {
+  return Encoding<T>::Size(value, cache);
+}
+
+template <typename T>
+constexpr std::enable_if_t<!IsDetected<EncodingCachedSizeTest, T>::value,
+                           std::size_t>
+CachedSize(const T& value, SizeCache* /*cache*/) {
+  return Encoding<T>::Size(value);
+}
+
+// Test expression for writers that carry a SizeCache.
+template <typename Writer>
+using WriterSizeCacheTest = decltype(std::declval<Writer&>().size_cache());
+
+// Returns the SizeCache carried by |writer|, if any.
+template <typename Writer>
+constexpr std::enable_if_t<IsDetected<WriterSizeCacheTest, Writer>::value,
+                           SizeCache*>
+GetSizeCache(Writer* writer) {
+  return writer->size_cache();
+}
+
+template <typename Writer>
+constexpr std::enable_if_t<!IsDetected<WriterSizeCacheTest, Writer>::value,
+                           SizeCache*>
+GetSizeCache(Writer* /*writer*/) {
+  return nullptr;
+}
+
+// Writer type that wraps another writer pointer to make a SizeCache available
+// to the encodings while writing. All writer operations are passed through to
+// the underlying writer.
+template <typename Writer>
+class SizeCacheWriter {
+ public:
+  constexpr SizeCacheWriter(Writer* writer, SizeCache* cache)
+      : writer_{writer}, cache_{cache} {}
+
+  constexpr Status<void> Prepare(std::size_t size) {
+    return writer_->Prepare(size);
+  }
+
+  constexpr Status<void> Write(std::uint8_t byte) {
+    return writer_->Write(byte);
+  }
+
+  template <typename T>
+  constexpr Status<void> Write(const T* begin, const T* end) {
+    return writer_->Write(begin, end);
+  }
+
+  constexpr Status<void> Skip(std::size_t padding_bytes,
+                              std::uint8_t padding_value = 0x00) {
+    return writer_->Skip(padding_bytes, padding_value);
+  }
+
+  // Forwards borrowing to the underlying writer, when it supports it.
+  template <typename W = Writer>
+  constexpr auto Borrow(void** data, std::size_t size)
+      -> decltype(std::declval<W&>().Borrow(data, size)) {
+    return writer_->Borrow(data, size);
+  }
+
+  template <typename HandleType>
+  constexpr Status<HandleReference> PushHandle(const HandleType& handle) {
+    return writer_->PushHandle(handle);
+  }
+
+  // Forwards the canonical encoding request of the underlying writer.
+  template <typename W = Writer>
+  constexpr auto canonical() const
+      -> decltype(std::declval<const W&>().canonical()) {
+    return writer_->canonical();
+  }
+
+  // Forwards the infallible property of the underlying writer.
+  template <typename W = Writer>
+  constexpr auto infallible() const
+      -> decltype(std::declval<const W&>().infallible()) {
+    return writer_->infallible();
+  }
+
+  // Forwards the positions of patchable fields to the underlying writer, when
+  // it records them.
+  template <typename W = Writer>
+  constexpr auto MarkField(std::size_t index, std::size_t width)
+      -> decltype(std::declval<W&>().MarkField(index, width)) {
+    return writer_->MarkField(index, width);
+  }
+
+  // Forwards the string dictionary of the underlying writer, when it has one.
+  template <typename W = Writer>
+  constexpr auto string_dictionary() const
+      -> decltype(std::declval<W&>().string_dictionary()) {
+    return writer_->string_dictionary();
+  }
+
+  // Forwards the chunk store of the underlying writer, when it has one.
+  template <typename W = Writer>
+  constexpr auto chunk_store() const
+      -> decltype(std::declval<W&>().chunk_store()) {
+    return writer_->chunk_store();
+  }
+
+  // Forwards the shared object table of the underlying writer, when it has one.
+  template <typename W = Writer>
+  constexpr auto object_table() const
+      -> decltype(std::declval<W&>().object_table()) {
+    return writer_->object_table();
+  }
+
+  constexpr SizeCache* size_cache() const { return cache_; }
+
+ private:
+  Writer* writer_;
+  SizeCache* cache_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_SIZE_CACHE_H_
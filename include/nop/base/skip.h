@@ -0,0 +1,429 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_SKIP_H_
+#define LIBNOP_INCLUDE_NOP_BASE_SKIP_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nop/base/chunk_store.h>
+#include <nop/base/encoding.h>
+#include <nop/base/object_table.h>
+#include <nop/base/string.h>
+#include <nop/base/string_dictionary.h>
+
+namespace nop {
+
+//
+// Generic skipping of encoded values.
+//
+// SkipValue() advances a reader past one complete encoded value of any type by
+// following the self-describing structure of the wire format, without knowing
+// the high-level type of the value. Containers are skipped recursively up to
+// kMaxSkipDepth levels deep; more deeply nested input is rejected with
+// ErrorStatus::UnexpectedEncodingType rather than exhausting the stack.
+// Extension and reserved prefixes have no defined layout and are rejected in
+// the same way.
+//
+// When the reader carries a string dictionary the string definitions in the
+// skipped value are added to it, including those in the sized entries of
+// tables, so that later references resolve to the strings the writer meant.
+// Likewise, when the reader carries an object table each skipped object
+// definition takes the next id, so that the ids of later definitions match;
+// references to a skipped object fail with ErrorStatus::InvalidObjectReference.
+// When the reader carries a chunk store the chunks sent in full in skipped
+// chunk manifests are kept, as reading the manifest would. A ChunkedBlob sent
+// as binary cannot be told apart from other binary data, so its chunks are not
+// kept when it is skipped.
+//
+
+enum : std::size_t { kMaxSkipDepth = 64 };
+
+template <typename Reader>
+constexpr Status<void> SkipPayload(EncodingByte prefix, Reader* reader,
+                                   std::size_t depth = 0);
+
+template <typename Reader>
+constexpr Status<void> SkipValue(Reader* reader, std::size_t depth = 0) {
+  std::uint8_t prefix_byte = 0;
+  auto status = reader->Read(&prefix_byte);
+  if (!status)
+    return status;
+
+  return SkipPayload(static_cast<EncodingByte>(prefix_byte), reader, depth);
+}
+
+namespace detail {
+
+template <typename Reader>
+constexpr Status<void> SkipValues(SizeType count, Reader* reader,
+                                  std::size_t depth) {
+  for (SizeType i = 0; i < count; i++) {
+    auto status = SkipValue(reader, depth);
+    if (!status)
+      return status;
+  }
+  return {};
+}
+
+template <typename Reader>
+constexpr Status<void> SkipBytes(Reader* reader) {
+  SizeType size = 0;
+  auto status = Encoding<SizeType>::Read(&size, reader);
+  if (!status)
+    return status;
+
+  status = reader->Ensure(size);
+  if (!status)
+    return status;
+
+  return reader->Skip(size);
+}
+
+// Returns true if |reader| carries session state that skipped values must
+// update as if they had been read.
+template <typename Reader>
+bool HasSessionState(Reader* reader) {
+  return GetStringDecodeDictionary(reader) || GetObjectDecodeTable(reader) ||
+         GetChunkDecodeStore(reader);
+}
+
+// Reader over the copied bytes of a sized value, which forwards the session
+// state of the reader the bytes came from. Skipping values nested inside it
+// uses the same reader type, which bounds the instantiations of SkipValue().
+class SizedValueReader {
+ public:
+  template <typename Reader>
+  SizedValueReader(std::vector<std::uint8_t> bytes, Reader* reader)
+      : bytes_{std::move(bytes)},
+        dictionary_{GetStringDecodeDictionary(reader)},
+        table_{GetObjectDecodeTable(reader)},
+        store_{GetChunkDecodeStore(reader)} {}
+
+  Status<void> Ensure(std::size_t size) {
+    if (bytes_.size() - index_ < size)
+      return ErrorStatus::ReadLimitReached;
+    return {};
+  }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    const std::size_t size = (end - begin) * sizeof(T);
+    if (bytes_.size() - index_ < size)
+      return ErrorStatus::ReadLimitReached;
+
+    std::copy(&bytes_[index_], &bytes_[index_] + size,
+              reinterpret_cast<std::uint8_t*>(begin));
+    index_ += size;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t size) {
+    if (bytes_.size() - index_ < size)
+      return ErrorStatus::ReadLimitReached;
+
+    index_ += size;
+    return {};
+  }
+
+  StringDecodeDictionary* string_dictionary() const { return dictionary_; }
+  ObjectDecodeTable* object_table() const { return table_; }
+  ChunkDecodeStore* chunk_store() const { return store_; }
+
+ private:
+  std::vector<std::uint8_t> bytes_;
+  std::size_t index_{0};
+  StringDecodeDictionary* dictionary_;
+  ObjectDecodeTable* table_;
+  ChunkDecodeStore* store_;
+};
+
+// Skips a string definition, adding the string to the dictionary of |reader|
+// if it has one.
+template <typename Reader>
+Status<void> SkipStringDefinition(Reader* reader) {
+  StringDecodeDictionary* dictionary = GetStringDecodeDictionary(reader);
+  if (!dictionary)
+    return SkipBytes(reader);
+
+  std::string string;
+  auto status =
+      Encoding<std::string>::ReadPayload(EncodingByte::String, &string, reader);
+  if (!status)
+    return status;
+
+  return dictionary->Define(
+      std::make_shared<const std::string>(std::move(string)));
+}
+
+// Skips the chunk of a chunk manifest entry with |id|, keeping it in the chunk
+// store of |reader| if it is sent in full and the reader has a store.
+template <typename Reader>
+Status<void> SkipManifestChunk(const ChunkId& id, Reader* reader) {
+  ChunkDecodeStore* store = GetChunkDecodeStore(reader);
+  std::uint8_t prefix_byte = 0;
+  auto status = reader->Read(&prefix_byte);
+  if (!status)
+    return status;
+
+  const EncodingByte prefix = static_cast<EncodingByte>(prefix_byte);
+  if (prefix == EncodingByte::Nil)
+    return {};
+  else if (prefix != EncodingByte::Binary)
+    return ErrorStatus::UnexpectedEncodingType;
+  else if (!store)
+    return SkipBytes(reader);
+
+  SizeType size = 0;
+  status = Encoding<SizeType>::Read(&size, reader);
+  if (!status)
+    return status;
+
+  status = reader->Ensure(size);
+  if (!status)
+    return status;
+
+  auto chunk = std::make_shared<std::vector<std::uint8_t>>(size);
+  status = reader->Read(chunk->data(), chunk->data() + size);
+  if (!status)
+    return status;
+
+  if (store->Hash(chunk->data(), chunk->size()) != id)
+    return ErrorStatus::ChecksumMismatch;
+
+  store->Define(id, std::move(chunk));
+  return {};
+}
+
+// Skips a sized value, such as a table entry, along with any padding after the
+// value. The bytes are skipped as they are unless the reader carries session
+// state, in which case the value is walked to find its definitions.
+template <typename Reader>
+Status<void> SkipSizedValue(Reader* reader, std::size_t depth) {
+  SizeType size = 0;
+  auto status = Encoding<SizeType>::Read(&size, reader);
+  if (!status)
+    return status;
+
+  if (!HasSessionState(reader) || size == 0)
+    return reader->Skip(size);
+
+  status = reader->Ensure(size);
+  if (!status)
+    return status;
+
+  std::vector<std::uint8_t> bytes(size);
+  status = reader->Read(bytes.data(), bytes.data() + size);
+  if (!status)
+    return status;
+
+  SizedValueReader value_reader{std::move(bytes), reader};
+  return SkipValue(&value_reader, depth);
+}
+
+}  // namespace detail
+
+// Skips the remainder of a value whose prefix has already been read.
+template <typename Reader>
+constexpr Status<void> SkipPayload(EncodingByte prefix, Reader* reader,
+                                   std::size_t depth) {
+  if (depth >= kMaxSkipDepth)
+    return ErrorStatus::UnexpectedEncodingType;
+  depth++;
+
+  SizeType count = 0;
+  switch (prefix) {
+    case EncodingByte::U8:
+    case EncodingByte::U16:
+    case EncodingByte::U32:
+    case EncodingByte::U64:
+    case EncodingByte::I8:
+    case EncodingByte::I16:
+    case EncodingByte::I32:
+    case EncodingByte::I64:
+    case EncodingByte::F32:
+    case EncodingByte::F64: {
+      const std::size_t size = BaseEncodingSize(prefix) - 1;
+      auto status = reader->Ensure(size);
+      if (!status)
+        return status;
+      return reader->Skip(size);
+    }
+
+    case EncodingByte::Nil:
+      return {};
+
+    case EncodingByte::Binary:
+    case EncodingByte::String:
+      return detail::SkipBytes(reader);
+
+    case EncodingByte::StringDefinition:
+      return detail::SkipStringDefinition(reader);
+
+    case EncodingByte::StringReference:
+      return Encoding<SizeType>::Read(&count, reader);
+
+    // Object definitions take the next id, as when they are read.
+    case EncodingByte::ObjectDefinition:
+      if (ObjectDecodeTable* table = GetObjectDecodeTable(reader))
+        table->DefineSkipped();
+      return SkipValue(reader, depth);
+
+    // Object references are followed by their id, errors by a value.
+    case EncodingByte::Error:
+    case EncodingByte::ObjectReference:
+      return SkipValue(reader, depth);
+
+    case EncodingByte::Handle:
+    case EncodingByte::Variant:
+      return detail::SkipValues(2, reader, depth);
+
+    case EncodingByte::Array:
+    case EncodingByte::Structure:
+    case EncodingByte::Map: {
+      auto status = Encoding<SizeType>::Read(&count, reader);
+      if (!status)
+        return status;
+      if (prefix != EncodingByte::Map)
+        return detail::SkipValues(count, reader, depth);
+
+      // Each map entry is a key followed by a value.
+      for (SizeType i = 0; i < count; i++) {
+        status = detail::SkipValues(2, reader, depth);
+        if (!status)
+          return status;
+      }
+      return {};
+    }
+
+    case EncodingByte::IndexedArray: {
+      auto status = Encoding<SizeType>::Read(&count, reader);
+      if (!status)
+        return status;
+
+      // The offset table is a binary container.
+      status = SkipValue(reader, depth);
+      if (!status)
+        return status;
+
+      return detail::SkipValues(count, reader, depth);
+    }
+
+    case EncodingByte::PackedArray: {
+      auto status = Encoding<SizeType>::Read(&count, reader);
+      if (!status)
+        return status;
+
+      // The first element is followed by the packed deltas in a binary
+      // container.
+      return detail::SkipValues(2, reader, depth);
+    }
+
+    case EncodingByte::BitArray: {
+      auto status = Encoding<SizeType>::Read(&count, reader);
+      if (!status)
+        return status;
+
+      const SizeType size = count / 8 + (count % 8 != 0);
+      status = reader->Ensure(size);
+      if (!status)
+        return status;
+      return reader->Skip(size);
+    }
+
+    case EncodingByte::ChunkedArray:
+      while (true) {
+        auto status = Encoding<SizeType>::Read(&count, reader);
+        if (!status)
+          return status;
+        else if (count == 0)
+          return {};
+
+        status = detail::SkipValues(count, reader, depth);
+        if (!status)
+          return status;
+      }
+
+    case EncodingByte::ChunkManifest: {
+      // The data length is followed by the entry count and the entries, each
+      // an id of two words and the chunk bytes or nil.
+      auto status = Encoding<SizeType>::Read(&count, reader);
+      if (!status)
+        return status;
+
+      status = Encoding<SizeType>::Read(&count, reader);
+      if (!status)
+        return status;
+
+      for (SizeType i = 0; i < count; i++) {
+        ChunkId id;
+        status = Encoding<std::uint64_t>::Read(&id[0], reader);
+        if (!status)
+          return status;
+        status = Encoding<std::uint64_t>::Read(&id[1], reader);
+        if (!status)
+          return status;
+
+        status = detail::SkipManifestChunk(id, reader);
+        if (!status)
+          return status;
+      }
+      return {};
+    }
+
+    case EncodingByte::Table: {
+      auto status = SkipValue(reader, depth);
+      if (!status)
+        return status;
+
+      status = Encoding<SizeType>::Read(&count, reader);
+      if (!status)
+        return status;
+
+      for (SizeType i = 0; i < count; i++) {
+        status = SkipValue(reader, depth);
+        if (!status)
+          return status;
+
+        status = detail::SkipSizedValue(reader, depth);
+        if (!status)
+          return status;
+      }
+      return {};
+    }
+
+    default:
+      if ((prefix >= EncodingByte::PositiveFixIntMin &&
+           prefix <= EncodingByte::PositiveFixIntMax) ||
+          (prefix >= EncodingByte::NegativeFixIntMin &&
+           prefix <= EncodingByte::NegativeFixIntMax)) {
+        return {};
+      }
+      return ErrorStatus::UnexpectedEncodingType;
+  }
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_SKIP_H_
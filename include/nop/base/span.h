@@ -0,0 +1,200 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_SPAN_H_
+#define LIBNOP_INCLUDE_NOP_BASE_SPAN_H_
+
+#include <cstddef>
+#include <type_traits>
+
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+
+#include <nop/base/encoding.h>
+#include <nop/base/size_cache.h>
+#include <nop/base/utility.h>
+#include <nop/traits/is_borrowing_reader.h>
+#include <nop/types/span.h>
+
+namespace nop {
+
+//
+// Span<T> encoding format for integral types:
+//
+// +-----+---------+---//----+
+// | BIN | INT64:L | L BYTES |
+// +-----+---------+---//----+
+//
+// Where L = N * sizeof(T).
+//
+// The format is the same as std::vector<T> of integral T, making the types
+// interchangeable. Spans of any integral type may be written; reading a span
+// borrows the elements from the reader, which must support Borrow(), and is
+// limited to single-byte element types so that the borrowed elements are
+// always suitably aligned.
+//
+// Span<T> encoding format for non-integral types:
+//
+// +-----+---------+-----//-----+
+// | ARY | INT64:N | N ELEMENTS |
+// +-----+---------+-----//-----+
+//
+// Elements must be valid encodings of type T. The format is the same as
+// std::vector<T> of non-integral T. These spans may only be written, to send a
+// slice of a larger array without copying it into a temporary vector; the
+// receiver decodes them into a std::vector<T>.
+//
+
+template <typename T>
+struct Encoding<Span<T>, EnableIfIntegral<T>> : EncodingIO<Span<T>> {
+  using Type = Span<T>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    const SizeType size = value.size() * sizeof(T);
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(size) +
+           size;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    const SizeType length_bytes = value.size() * sizeof(T);
+    auto status = Encoding<SizeType>::Write(length_bytes, writer);
+    if (!status)
+      return status;
+
+    return writer->Write(value.begin(), value.end());
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
+                                            Type* value, Reader* reader) {
+    static_assert(IsBorrowingReader<Reader>::value,
+                  "Reading a span requires a reader that supports Borrow(), "
+                  "such as BufferReader.");
+    static_assert(sizeof(T) == 1,
+                  "Only single-byte element types may be borrowed.");
+
+    SizeType length_bytes = 0;
+    auto status = Encoding<SizeType>::Read(&length_bytes, reader);
+    if (!status)
+      return status;
+
+    // Make sure the reader has enough data to fulfill the requested size as a
+    // defense against abusive or erroneous vector sizes.
+    status = reader->Ensure(length_bytes);
+    if (!status)
+      return status;
+
+    const void* data = nullptr;
+    status = reader->Borrow(&data, length_bytes);
+    if (!status)
+      return status;
+
+    *value = Type{static_cast<const T*>(data), length_bytes};
+    return {};
+  }
+};
+
+template <typename T>
+struct Encoding<Span<T>, EnableIfNotIntegral<T>> : EncodingIO<Span<T>> {
+  using Type = Span<T>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Array;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache) {
+    std::size_t size = BaseEncodingSize(Prefix(value)) +
+                       Encoding<SizeType>::Size(value.size());
+    for (const T& element : value)
+      size += CachedSize(element, cache);
+    return size;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Array;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    for (const T& element : value) {
+      status = Encoding<T>::Write(element, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+};
+
+#if defined(__cpp_lib_span)
+// std::span<T> encodes the same as Span<T> and may only be written.
+template <typename T, std::size_t Extent>
+struct Encoding<std::span<T, Extent>>
+    : EncodingIO<std::span<T, Extent>> {
+  using Type = std::span<T, Extent>;
+  using SpanType = Span<std::remove_const_t<T>>;
+
+  static constexpr EncodingByte Prefix(const Type& value) {
+    return Encoding<SpanType>::Prefix(ToSpan(value));
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return Encoding<SpanType>::Size(ToSpan(value));
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<SpanType>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte prefix,
+                                             const Type& value,
+                                             Writer* writer) {
+    return Encoding<SpanType>::WritePayload(prefix, ToSpan(value), writer);
+  }
+
+ private:
+  static constexpr SpanType ToSpan(const Type& value) {
+    return SpanType{value.data(), value.size()};
+  }
+};
+#endif
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_SPAN_H_
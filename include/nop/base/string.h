@@ -20,6 +20,8 @@
 #include <string>
 
 #include <nop/base/encoding.h>
+#include <nop/traits/is_utf8_validating_reader.h>
+#include <nop/utility/utf8.h>
 
 namespace nop {
 
@@ -82,8 +84,28 @@ struct Encoding<std::basic_string<CharType, Traits, Allocator>>
     if (!status)
       return status;
 
+    status = detail::ChargeAllocation(length_bytes, 1, reader);
+    if (!status)
+      return status;
+
+#if defined(__cpp_lib_string_resize_and_overwrite)
+    // Grow the string without filling it first, since the reader overwrites
+    // every character.
+    value->resize_and_overwrite(size, [&](CharType* data, std::size_t count) {
+      status = reader->Read(data, data + count);
+      return status ? count : 0;
+    });
+#else
     value->resize(size);
-    return reader->Read(&(*value)[0], &(*value)[size]);
+    status = reader->Read(&(*value)[0], &(*value)[size]);
+#endif
+    if (!status)
+      return status;
+    else if (IsUtf8ValidatingReader<Reader>::value && CharSize == 1 &&
+             !ValidateUtf8(value->data(), size))
+      return ErrorStatus::InvalidUtf8;
+    else
+      return {};
   }
 };
 
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_STRING_DICTIONARY_H_
+#define LIBNOP_INCLUDE_NOP_BASE_STRING_DICTIONARY_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/status.h>
+#include <nop/traits/is_detected.h>
+
+namespace nop {
+
+//
+// String dictionaries hold the session state of the InternedString encoding.
+// The first time a string is written through a writer carrying a
+// StringEncodeDictionary it is defined with the next id in sequence; later
+// occurrences are written as a reference to that id. A reader carrying a
+// StringDecodeDictionary assigns ids to definitions in the same order and
+// resolves references to the shared strings it has already decoded.
+//
+// Both ends must see the same sequence of definitions: the dictionaries must be
+// created, limited, and reset at the same points in the stream on either end.
+// Each dictionary holds up to limit() strings; once it is full new strings are
+// written in full without a definition, which bounds the memory used on both
+// ends.
+//
+
+class StringEncodeDictionary {
+ public:
+  enum : std::size_t { kDefaultLimit = 4096 };
+
+  StringEncodeDictionary() = default;
+  explicit StringEncodeDictionary(std::size_t limit) : limit_{limit} {}
+
+  // Returns true and stores the id of |value| in |id| if |value| has been
+  // defined.
+  bool Find(const std::string& value, SizeType* id) const {
+    auto search = ids_.find(value);
+    if (search == ids_.end())
+      return false;
+
+    *id = search->second;
+    return true;
+  }
+
+  // Gives |value| the next id in sequence. Returns false if the dictionary is
+  // full.
+  bool Define(const std::string& value) {
+    if (ids_.size() >= limit_)
+      return false;
+
+    const SizeType id = ids_.size();
+    ids_.emplace(value, id);
+    return true;
+  }
+
+  // Forgets all definitions; the next definition has id zero.
+  void Reset() { ids_.clear(); }
+
+  std::size_t size() const { return ids_.size(); }
+  std::size_t limit() const { return limit_; }
+
+  // Sets the number of strings the dictionary may hold. Strings already defined
+  // beyond a lower limit remain defined until the next Reset().
+  void set_limit(std::size_t limit) { limit_ = limit; }
+
+ private:
+  std::unordered_map<std::string, SizeType> ids_;
+  std::size_t limit_{kDefaultLimit};
+};
+
+class StringDecodeDictionary {
+ public:
+  enum : std::size_t { kDefaultLimit = StringEncodeDictionary::kDefaultLimit };
+
+  StringDecodeDictionary() = default;
+  explicit StringDecodeDictionary(std::size_t limit) : limit_{limit} {}
+
+  // Returns the string defined with |id|.
+  Status<std::shared_ptr<const std::string>> Find(SizeType id) const {
+    if (id >= strings_.size())
+      return ErrorStatus::InvalidStringReference;
+    else
+      return strings_[id];
+  }
+
+  // Gives |value| the next id in sequence. Returns an error if the dictionary
+  // is full, since the writer would not have defined the string.
+  Status<void> Define(std::shared_ptr<const std::string> value) {
+    if (strings_.size() >= limit_)
+      return ErrorStatus::ProtocolError;
+
+    strings_.push_back(std::move(value));
+    return {};
+  }
+
+  // Forgets all definitions; the next definition has id zero.
+  void Reset() { strings_.clear(); }
+
+  std::size_t size() const { return strings_.size(); }
+  std::size_t limit() const { return limit_; }
+
+  // Sets the number of strings the dictionary may hold. Strings already defined
+  // beyond a lower limit remain defined until the next Reset().
+  void set_limit(std::size_t limit) { limit_ = limit; }
+
+ private:
+  std::vector<std::shared_ptr<const std::string>> strings_;
+  std::size_t limit_{kDefaultLimit};
+};
+
+// Test expression for writers and readers that carry a string dictionary.
+template <typename WriterOrReader>
+using StringDictionaryTest =
+    decltype(std::declval<WriterOrReader&>().string_dictionary());
+
+// Returns the StringEncodeDictionary carried by |writer|, if any.
+template <typename Writer>
+std::enable_if_t<IsDetected<StringDictionaryTest, Writer>::value,
+                 StringEncodeDictionary*>
+GetStringEncodeDictionary(Writer* writer) {
+  return writer->string_dictionary();
+}
+
+template <typename Writer>
+std::enable_if_t<!IsDetected<StringDictionaryTest, Writer>::value,
+                 StringEncodeDictionary*>
+GetStringEncodeDictionary(Writer* /*writer*/) {
+  return nullptr;
+}
+
+// Returns the StringDecodeDictionary carried by |reader|, if any.
+template <typename Reader>
+std::enable_if_t<IsDetected<StringDictionaryTest, Reader>::value,
+                 StringDecodeDictionary*>
+GetStringDecodeDictionary(Reader* reader) {
+  return reader->string_dictionary();
+}
+
+template <typename Reader>
+std::enable_if_t<!IsDetected<StringDictionaryTest, Reader>::value,
+                 StringDecodeDictionary*>
+GetStringDecodeDictionary(Reader* /*reader*/) {
+  return nullptr;
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_STRING_DICTIONARY_H_
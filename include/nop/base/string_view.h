@@ -0,0 +1,109 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_STRING_VIEW_H_
+#define LIBNOP_INCLUDE_NOP_BASE_STRING_VIEW_H_
+
+#include <nop/base/encoding.h>
+#include <nop/traits/is_borrowing_reader.h>
+#include <nop/traits/is_utf8_validating_reader.h>
+#include <nop/types/string_view.h>
+#include <nop/utility/utf8.h>
+
+namespace nop {
+
+//
+// BasicStringView<...> encoding format:
+//
+// +-----+---------+---//----+
+// | STR | INT64:N | N BYTES |
+// +-----+---------+---//----+
+//
+// The format is the same as std::basic_string<...>, making the types
+// interchangeable. Reading a string view borrows the characters from the
+// reader, which must support Borrow(); single-byte character types are
+// required so that the borrowed characters are always suitably aligned.
+//
+
+template <typename CharType, typename Traits>
+struct Encoding<BasicStringView<CharType, Traits>>
+    : EncodingIO<BasicStringView<CharType, Traits>> {
+  using Type = BasicStringView<CharType, Traits>;
+  enum : std::size_t { CharSize = sizeof(CharType) };
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::String;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    const std::size_t length_bytes = value.length() * CharSize;
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(length_bytes) + length_bytes;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::String;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    const std::size_t length_bytes = value.length() * CharSize;
+    auto status = Encoding<SizeType>::Write(length_bytes, writer);
+    if (!status)
+      return status;
+
+    return writer->Write(value.begin(), value.end());
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
+                                            Type* value, Reader* reader) {
+    static_assert(IsBorrowingReader<Reader>::value,
+                  "Reading a string view requires a reader that supports "
+                  "Borrow(), such as BufferReader.");
+    static_assert(CharSize == 1,
+                  "Only single-byte character types may be borrowed.");
+
+    SizeType length_bytes = 0;
+    auto status = Encoding<SizeType>::Read(&length_bytes, reader);
+    if (!status)
+      return status;
+
+    // Make sure the reader has enough data to fulfill the requested size as a
+    // defense against abusive or erroneous string sizes.
+    status = reader->Ensure(length_bytes);
+    if (!status)
+      return status;
+
+    const void* data = nullptr;
+    status = reader->Borrow(&data, length_bytes);
+    if (!status)
+      return status;
+
+    if (IsUtf8ValidatingReader<Reader>::value &&
+        !ValidateUtf8(data, length_bytes))
+      return ErrorStatus::InvalidUtf8;
+
+    *value = Type{static_cast<const CharType*>(data), length_bytes};
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_STRING_VIEW_H_
@@ -17,17 +17,27 @@
 #ifndef LIBNOP_INCLUDE_NOP_BASE_TABLE_H_
 #define LIBNOP_INCLUDE_NOP_BASE_TABLE_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
 #include <nop/base/encoding.h>
 #include <nop/base/members.h>
+#include <nop/base/size_cache.h>
+#include <nop/base/skip.h>
 #include <nop/base/utility.h>
 #include <nop/table.h>
+#include <nop/traits/is_canonical_writer.h>
+#include <nop/traits/is_single_pass_writer.h>
 #include <nop/utility/bounded_reader.h>
 #include <nop/utility/bounded_writer.h>
+#include <nop/utility/key_index_map.h>
 
 namespace nop {
 
 //
-// Entry<T, Id, ActiveEntry> encoding format:
+// Entry<T, Id, ActiveEntry> and Entry<T, Id, IndirectEntry> encoding format:
 //
 // +----------+------------+-------+---------+
 // | INT64:ID | INT64:SIZE | VALUE | PADDING |
@@ -56,7 +66,9 @@ namespace nop {
 //
 // Where HASH is derived from the table label and N is the number of non-empty,
 // active entries in the table. Older code may encounter unknown entry ids when
-// reading data from newer table definitions.
+// reading data from newer table definitions. Entries are written in the order
+// they are declared in the table, or in order of increasing id when the writer
+// requests canonical encoding.
 //
 
 template <typename Table>
@@ -66,11 +78,17 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
   }
 
   static constexpr std::size_t Size(const Table& value) {
+    return Size(value, nullptr);
+  }
+
+  // Computes the size of the table, recording the size of each active entry in
+  // |cache| for use by WriteEntry().
+  static constexpr std::size_t Size(const Table& value, SizeCache* cache) {
     return BaseEncodingSize(Prefix(value)) +
            Encoding<std::uint64_t>::Size(
                EntryListTraits<Table>::EntryList::Hash) +
            Encoding<SizeType>::Size(ActiveEntryCount(value, Index<Count>{})) +
-           Size(value, Index<Count>{});
+           Size(value, cache, Index<Count>{});
   }
 
   static constexpr bool Match(EncodingByte prefix) {
@@ -91,12 +109,45 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
     if (!status)
       return status;
 
-    return WriteEntries(value, writer, Index<Count>{});
+    return WriteEntries(value, writer, IsCanonicalWriter<Writer>{});
   }
 
   template <typename Reader>
   static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
                                             Table* value, Reader* reader) {
+    return ReadProjectedPayload<AllEntries>(value, reader);
+  }
+
+  // Reads only the entries in |Projection|, skipping the other entries using
+  // their sized wrappers. Entries that are skipped are left empty.
+  template <typename Projection, typename Reader>
+  static constexpr Status<void> ReadProjected(Table* value, Reader* reader) {
+    static_assert(ProjectedCount<Projection>(Index<Count>{}) ==
+                      Projection::Count,
+                  "Projection entries must be entries of the table.");
+
+    std::uint8_t prefix_byte = 0;
+    auto status = reader->Read(&prefix_byte);
+    if (!status)
+      return status;
+    else if (!Match(static_cast<EncodingByte>(prefix_byte)))
+      return ErrorStatus::UnexpectedEncodingType;
+    else
+      return ReadProjectedPayload<Projection>(value, reader);
+  }
+
+ private:
+  enum : std::size_t { Count = EntryListTraits<Table>::EntryList::Count };
+
+  // Projection that contains every entry of the table.
+  struct AllEntries {
+    template <typename Pointer>
+    using Contains = std::true_type;
+  };
+
+  template <typename Projection, typename Reader>
+  static constexpr Status<void> ReadProjectedPayload(Table* value,
+                                                     Reader* reader) {
     // Clear entries so that we can detect whether there are duplicate entries
     // for the same id during deserialization.
     ClearEntries(value, Index<Count>{});
@@ -113,11 +164,12 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
     if (!status)
       return status;
 
-    return ReadEntries(value, count, reader);
+    return ReadEntries<Projection>(value, count, reader);
   }
 
- private:
-  enum : std::size_t { Count = EntryListTraits<Table>::EntryList::Count };
+  template <typename Writer, bool SinglePass>
+  using EnableIfSinglePass =
+      std::enable_if_t<IsSinglePassWriter<Writer>::value == SinglePass>;
 
   template <std::size_t Index>
   using PointerAt =
@@ -136,10 +188,18 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
     return ActiveEntryCount(value, Index<index - 1>{}) + count;
   }
 
-  template <typename T, std::uint64_t Id>
-  static constexpr std::size_t Size(const Entry<T, Id, ActiveEntry>& entry) {
+  template <typename T, std::uint64_t Id, typename Storage>
+  static constexpr std::size_t Size(const Entry<T, Id, Storage>& entry,
+                                    SizeCache* cache) {
     if (entry) {
-      const std::size_t size = Encoding<T>::Size(entry.get());
+      // Reserve the record before sizing the value so that the records of any
+      // nested entries follow this one, matching the order they are written.
+      const std::size_t slot =
+          cache ? cache->Reserve(&entry) : SizeCache::kInvalidSlot;
+      const std::size_t size = CachedSize(entry.get(), cache);
+      if (cache)
+        cache->Set(slot, size);
+
       return Encoding<std::uint64_t>::Size(Id) +
              Encoding<std::uint64_t>::Size(size) + size;
     } else {
@@ -149,18 +209,35 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
 
   template <typename T, std::uint64_t Id>
   static constexpr std::size_t Size(
-      const Entry<T, Id, DeletedEntry>& /*entry*/) {
+      const Entry<T, Id, DeletedEntry>& /*entry*/, SizeCache* /*cache*/) {
     return 0;
   }
 
-  static constexpr std::size_t Size(const Table& /*value*/, Index<0>) {
+  static constexpr std::size_t Size(const Table& /*value*/,
+                                    SizeCache* /*cache*/, Index<0>) {
     return 0;
   }
 
   template <std::size_t index>
-  static constexpr std::size_t Size(const Table& value, Index<index>) {
+  static constexpr std::size_t Size(const Table& value, SizeCache* cache,
+                                    Index<index>) {
     using Pointer = PointerAt<index - 1>;
-    return Size(value, Index<index - 1>{}) + Size(Pointer::Resolve(value));
+    // Size the entries in order so their records are in write order.
+    const std::size_t size = Size(value, cache, Index<index - 1>{});
+    return size + Size(Pointer::Resolve(value), cache);
+  }
+
+  // Returns the size of the value of an active entry, from the cache carried
+  // by the writer when it holds a record for the entry.
+  template <typename T, std::uint64_t Id, typename Storage, typename Writer>
+  static constexpr std::size_t EntrySize(
+      const Entry<T, Id, Storage>& entry, Writer* writer) {
+    SizeCache* cache = GetSizeCache(writer);
+    std::size_t size = 0;
+    if (cache && cache->Take(&entry, &size))
+      return size;
+    else
+      return Encoding<T>::Size(entry.get());
   }
 
   static void ClearEntries(Table* /*value*/, Index<0>) {}
@@ -171,15 +248,16 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
     PointerAt<index - 1>::Resolve(value)->clear();
   }
 
-  template <typename T, std::uint64_t Id, typename Writer>
+  template <typename T, std::uint64_t Id, typename Storage, typename Writer,
+            typename Enabled = EnableIfSinglePass<Writer, false>>
   static constexpr Status<void> WriteEntry(
-      const Entry<T, Id, ActiveEntry>& entry, Writer* writer) {
+      const Entry<T, Id, Storage>& entry, Writer* writer) {
     if (entry) {
       auto status = Encoding<std::uint64_t>::Write(Id, writer);
       if (!status)
         return status;
 
-      const SizeType size = Encoding<T>::Size(entry.get());
+      const SizeType size = EntrySize(entry, writer);
       status = Encoding<SizeType>::Write(size, writer);
       if (!status)
         return status;
@@ -204,6 +282,32 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
     }
   }
 
+  // Writes the entry in a single pass, patching the size in afterwards rather
+  // than computing it up front.
+  template <typename T, std::uint64_t Id, typename Storage, typename Writer,
+            typename Enabled = EnableIfSinglePass<Writer, true>,
+            typename = void>
+  static constexpr Status<void> WriteEntry(
+      const Entry<T, Id, Storage>& entry, Writer* writer) {
+    if (entry) {
+      auto status = Encoding<std::uint64_t>::Write(Id, writer);
+      if (!status)
+        return status;
+
+      auto position = writer->ReserveSize();
+      if (!position)
+        return position.error();
+
+      status = Encoding<T>::Write(entry.get(), writer);
+      if (!status)
+        return status;
+
+      return writer->PatchSize(position.get());
+    } else {
+      return {};
+    }
+  }
+
   template <typename T, std::uint64_t Id, typename Writer>
   static constexpr Status<void> WriteEntry(
       const Entry<T, Id, DeletedEntry>& /*entry*/, Writer* /*writer*/) {
@@ -227,8 +331,71 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
     return WriteEntry(Pointer::Resolve(value), writer);
   }
 
-  template <typename T, std::uint64_t Id, typename Reader>
-  static constexpr Status<void> ReadEntry(Entry<T, Id, ActiveEntry>* entry,
+  template <typename Writer>
+  static constexpr Status<void> WriteEntries(const Table& value, Writer* writer,
+                                             std::false_type) {
+    return WriteEntries(value, writer, Index<Count>{});
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WriteEntries(const Table& value, Writer* writer,
+                                             std::true_type) {
+    return WriteEntriesById(value, writer, Index<Count>{});
+  }
+
+  // Returns the number of entries in the table with ids less than |Id|, which
+  // is the position of the entry with that id in canonical order.
+  template <std::uint64_t Id>
+  static constexpr std::size_t EntryRank(Index<0>) {
+    return 0;
+  }
+
+  template <std::uint64_t Id, std::size_t index>
+  static constexpr std::size_t EntryRank(Index<index>) {
+    using Pointer = PointerAt<index - 1>;
+    const std::size_t count = Pointer::Type::Id < Id ? 1 : 0;
+    return EntryRank<Id>(Index<index - 1>{}) + count;
+  }
+
+  // Writes the entry with canonical position |rank|.
+  template <std::size_t rank, typename Writer>
+  static constexpr Status<void> WriteEntryWithRank(const Table& /*value*/,
+                                                   Writer* /*writer*/,
+                                                   Index<0>) {
+    return {};
+  }
+
+  template <std::size_t rank, std::size_t index, typename Writer>
+  static constexpr Status<void> WriteEntryWithRank(const Table& value,
+                                                   Writer* writer,
+                                                   Index<index>) {
+    using Pointer = PointerAt<index - 1>;
+    if (EntryRank<Pointer::Type::Id>(Index<Count>{}) == rank)
+      return WriteEntry(Pointer::Resolve(value), writer);
+    else
+      return WriteEntryWithRank<rank>(value, writer, Index<index - 1>{});
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WriteEntriesById(const Table& /*value*/,
+                                                 Writer* /*writer*/,
+                                                 Index<0>) {
+    return {};
+  }
+
+  template <std::size_t index, typename Writer>
+  static constexpr Status<void> WriteEntriesById(const Table& value,
+                                                 Writer* writer,
+                                                 Index<index>) {
+    auto status = WriteEntriesById(value, writer, Index<index - 1>{});
+    if (!status)
+      return status;
+
+    return WriteEntryWithRank<index - 1>(value, writer, Index<Count>{});
+  }
+
+  template <typename T, std::uint64_t Id, typename Storage, typename Reader>
+  static constexpr Status<void> ReadEntry(Entry<T, Id, Storage>* entry,
                                           Reader* reader) {
     // At the beginning of reading the table the destination entries are
     // cleared. If an entry is not cleared here then more than one entry for
@@ -242,29 +409,20 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
       // Default construct the entry;
       *entry = T{};
 
-      // Use a BoundedReader to handle any padding that might follow the
-      // value and catch invalid sizes while decoding inside the binary
-      // container.
-      BoundedReader<Reader> bounded_reader{reader, size};
-      status = Encoding<T>::Read(&entry->get(), &bounded_reader);
-      if (!status)
-        return status;
-
-      return bounded_reader.ReadPadding();
+      // Limit the reader to the binary container to handle any padding that
+      // might follow the value and catch invalid sizes while decoding inside
+      // it.
+      return ReadBoundedValue(&entry->get(), size, reader);
     } else {
       return ErrorStatus::DuplicateTableEntry;
     }
   }
 
-  // Skips over the binary container for an entry.
+  // Skips over the binary container for an entry, updating the session state
+  // of the reader with any definitions in it.
   template <typename Reader>
   static constexpr Status<void> SkipEntry(Reader* reader) {
-    SizeType size = 0;
-    auto status = Encoding<SizeType>::Read(&size, reader);
-    if (!status)
-      return status;
-
-    return reader->Skip(size);
+    return detail::SkipSizedValue(reader, 0);
   }
 
   template <typename T, std::uint64_t Id, typename Reader>
@@ -273,25 +431,58 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
     return SkipEntry(reader);
   }
 
-  template <typename Reader>
-  static constexpr Status<void> ReadEntryForId(Table* /*value*/,
-                                               std::uint64_t /*id*/,
-                                               Reader* reader, Index<0>) {
+  template <typename EntryType, typename Reader>
+  static constexpr Status<void> ReadProjectedEntry(EntryType* entry,
+                                                   Reader* reader,
+                                                   std::true_type) {
+    return ReadEntry(entry, reader);
+  }
+
+  // Skips entries that are not in the projection without constructing their
+  // values.
+  template <typename EntryType, typename Reader>
+  static constexpr Status<void> ReadProjectedEntry(EntryType* /*entry*/,
+                                                   Reader* reader,
+                                                   std::false_type) {
     return SkipEntry(reader);
   }
 
-  template <typename Reader, std::size_t index>
-  static constexpr Status<void> ReadEntryForId(Table* value, std::uint64_t id,
-                                               Reader* reader, Index<index>) {
-    using Pointer = PointerAt<index - 1>;
-    using Type = typename Pointer::Type;
-    if (Type::Id == id)
-      return ReadEntry(Pointer::Resolve(value), reader);
+  template <typename Projection, std::size_t index, typename Reader>
+  static Status<void> ReadEntryAt(Table* value, Reader* reader) {
+    using Pointer = PointerAt<index>;
+    return ReadProjectedEntry(
+        Pointer::Resolve(value), reader,
+        typename Projection::template Contains<Pointer>{});
+  }
+
+  template <typename Projection, typename Reader>
+  static Status<void> ReadEntryForId(Table* /*value*/, std::uint64_t /*id*/,
+                                     Reader* reader, std::index_sequence<>) {
+    return SkipEntry(reader);
+  }
+
+  // Reads the entry with |id| by looking up its index in a compile-time map of
+  // entry ids and dispatching through a table of per-entry readers, so that
+  // the cost does not grow linearly with the number of entries. Unknown ids
+  // and entries outside of |Projection| are skipped.
+  template <typename Projection, typename Reader, std::size_t... Is>
+  static Status<void> ReadEntryForId(Table* value, std::uint64_t id,
+                                     Reader* reader,
+                                     std::index_sequence<Is...>) {
+    using Thunk = Status<void> (*)(Table*, Reader*);
+    static constexpr Thunk kReaders[] = {
+        &ReadEntryAt<Projection, Is, Reader>...};
+    static constexpr KeyIndexMap<std::uint64_t, Count> kIdMap{
+        {PointerAt<Is>::Type::Id...}};
+
+    const std::size_t index = kIdMap.Find(id);
+    if (index == Count)
+      return SkipEntry(reader);
     else
-      return ReadEntryForId(value, id, reader, Index<index - 1>{});
+      return kReaders[index](value, reader);
   }
 
-  template <typename Reader>
+  template <typename Projection, typename Reader>
   static constexpr Status<void> ReadEntries(Table* value, SizeType count,
                                             Reader* reader) {
     for (SizeType i = 0; i < count; i++) {
@@ -300,12 +491,26 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
       if (!status)
         return status;
 
-      status = ReadEntryForId(value, id, reader, Index<Count>{});
+      status = ReadEntryForId<Projection>(value, id, reader,
+                                          std::make_index_sequence<Count>{});
       if (!status)
         return status;
     }
     return {};
   }
+
+  template <typename Projection>
+  static constexpr std::size_t ProjectedCount(Index<0>) {
+    return 0;
+  }
+
+  template <typename Projection, std::size_t index>
+  static constexpr std::size_t ProjectedCount(Index<index>) {
+    using Contains =
+        typename Projection::template Contains<PointerAt<index - 1>>;
+    return ProjectedCount<Projection>(Index<index - 1>{}) +
+           (Contains::value ? 1 : 0);
+  }
 };
 
 }  // namespace nop
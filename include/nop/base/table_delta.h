@@ -0,0 +1,383 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_TABLE_DELTA_H_
+#define LIBNOP_INCLUDE_NOP_BASE_TABLE_DELTA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/skip.h>
+#include <nop/base/table.h>
+#include <nop/base/utility.h>
+#include <nop/table.h>
+#include <nop/traits/is_comparable.h>
+#include <nop/types/table_delta.h>
+#include <nop/utility/bounded_reader.h>
+#include <nop/utility/bounded_writer.h>
+#include <nop/utility/key_index_map.h>
+
+namespace nop {
+
+//
+// TableDelta<Table> encoding format:
+//
+// +-----+---+------------------+-------------+-------+
+// | STU | 3 | INT64:BASE_VERS. | INT64:VERS. | DELTA |
+// +-----+---+------------------+-------------+-------+
+//
+// DELTA has the layout of the table encoding, with entries only for the ids
+// that changed between BASE_VERSION and VERSION:
+//
+// +-----+------------+---------+-----------+
+// | TAB | INT64:HASH | INT64:N | N ENTRIES |
+// +-----+------------+---------+-----------+
+//
+// Added and changed entries are encoded as they are in a table. A cleared
+// entry is encoded with a SIZE of zero and no value, which no active entry can
+// have:
+//
+// +----------+---+
+// | INT64:ID | 0 |
+// +----------+---+
+//
+// A delta is therefore a valid structure and can be skipped without decoding.
+//
+
+template <typename Table>
+struct Encoding<TableDelta<Table>, EnableIfHasEntryList<Table>>
+    : EncodingIO<TableDelta<Table>> {
+  using Type = TableDelta<Table>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Structure;
+  }
+
+  static std::size_t Size(const Type& value) {
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(kMemberCount) +
+           Encoding<std::uint64_t>::Size(value.base_version_) +
+           Encoding<std::uint64_t>::Size(value.version_) +
+           BaseEncodingSize(EncodingByte::Table) +
+           Encoding<std::uint64_t>::Size(EntryList::Hash) +
+           Encoding<SizeType>::Size(ChangedCount(value, Index<Count>{})) +
+           Size(value, Index<Count>{});
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Structure;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    auto status = Encoding<SizeType>::Write(kMemberCount, writer);
+    if (!status)
+      return status;
+
+    status = Encoding<std::uint64_t>::Write(value.base_version_, writer);
+    if (!status)
+      return status;
+
+    status = Encoding<std::uint64_t>::Write(value.version_, writer);
+    if (!status)
+      return status;
+
+    status = writer->Write(static_cast<std::uint8_t>(EncodingByte::Table));
+    if (!status)
+      return status;
+
+    status = Encoding<std::uint64_t>::Write(EntryList::Hash, writer);
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(ChangedCount(value, Index<Count>{}),
+                                       writer);
+    if (!status)
+      return status;
+
+    return WriteEntries(value, writer, Index<Count>{});
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    SizeType member_count = 0;
+    auto status = Encoding<SizeType>::Read(&member_count, reader);
+    if (!status)
+      return status;
+    else if (member_count != kMemberCount)
+      return ErrorStatus::InvalidMemberCount;
+
+    status = Encoding<std::uint64_t>::Read(&value->base_version_, reader);
+    if (!status)
+      return status;
+
+    status = Encoding<std::uint64_t>::Read(&value->version_, reader);
+    if (!status)
+      return status;
+
+    if (value->target_ == nullptr || value->target_version_ == nullptr)
+      return ErrorStatus::ProtocolError;
+
+    // Skip deltas for other versions so the reader stays in step with the
+    // stream.
+    if (value->base_version_ != *value->target_version_) {
+      status = SkipValue(reader);
+      if (!status)
+        return status;
+      else
+        return ErrorStatus::VersionMismatch;
+    }
+
+    std::uint8_t prefix_byte = 0;
+    status = reader->Read(&prefix_byte);
+    if (!status)
+      return status;
+    else if (static_cast<EncodingByte>(prefix_byte) != EncodingByte::Table)
+      return ErrorStatus::UnexpectedEncodingType;
+
+    std::uint64_t hash = 0;
+    status = Encoding<std::uint64_t>::Read(&hash, reader);
+    if (!status)
+      return status;
+    else if (hash != EntryList::Hash)
+      return ErrorStatus::InvalidTableHash;
+
+    SizeType count = 0;
+    status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+
+    for (SizeType i = 0; i < count; i++) {
+      std::uint64_t id = 0;
+      status = Encoding<std::uint64_t>::Read(&id, reader);
+      if (!status)
+        return status;
+
+      status = ApplyEntryForId(value->target_, id, reader,
+                               std::make_index_sequence<Count>{});
+      if (!status)
+        return status;
+    }
+
+    *value->target_version_ = value->version_;
+    return {};
+  }
+
+ private:
+  using EntryList = typename EntryListTraits<Table>::EntryList;
+
+  enum : std::size_t { Count = EntryList::Count };
+  enum : SizeType { kMemberCount = 3 };
+
+  template <std::size_t Index>
+  using PointerAt = typename EntryList::template At<Index>;
+
+  // Change state of an entry between the previous and current tables.
+  enum class Change { None, Cleared, Written };
+
+  template <typename T, std::uint64_t Id, typename Storage>
+  static Change GetChange(const Entry<T, Id, Storage>& previous,
+                          const Entry<T, Id, Storage>& current) {
+    if (!current)
+      return previous ? Change::Cleared : Change::None;
+    else if (previous && Equal(previous.get(), current.get(), IsEqual<T>{}))
+      return Change::None;
+    else
+      return Change::Written;
+  }
+
+  template <typename T, std::uint64_t Id>
+  static Change GetChange(const Entry<T, Id, DeletedEntry>& /*previous*/,
+                          const Entry<T, Id, DeletedEntry>& /*current*/) {
+    return Change::None;
+  }
+
+  template <typename T>
+  using IsEqual = IsComparableEqual<T, T>;
+
+  template <typename T>
+  static bool Equal(const T& a, const T& b, std::true_type) {
+    return a == b;
+  }
+
+  // Values without operator== are always considered changed.
+  template <typename T>
+  static bool Equal(const T& /*a*/, const T& /*b*/, std::false_type) {
+    return false;
+  }
+
+  template <std::size_t index>
+  static Change ChangeAt(const Type& value) {
+    using Pointer = PointerAt<index>;
+    return GetChange(Pointer::Resolve(*value.previous_),
+                     Pointer::Resolve(*value.current_));
+  }
+
+  static std::size_t ChangedCount(const Type& /*value*/, Index<0>) {
+    return 0;
+  }
+
+  template <std::size_t index>
+  static std::size_t ChangedCount(const Type& value, Index<index>) {
+    const std::size_t count = ChangeAt<index - 1>(value) != Change::None;
+    return ChangedCount(value, Index<index - 1>{}) + count;
+  }
+
+  template <typename T, std::uint64_t Id, typename Storage>
+  static std::size_t EntrySize(const Entry<T, Id, Storage>& entry,
+                               Change change) {
+    if (change == Change::Cleared) {
+      return Encoding<std::uint64_t>::Size(Id) + Encoding<SizeType>::Size(0);
+    } else if (change == Change::Written) {
+      const std::size_t size = Encoding<T>::Size(entry.get());
+      return Encoding<std::uint64_t>::Size(Id) +
+             Encoding<SizeType>::Size(size) + size;
+    } else {
+      return 0;
+    }
+  }
+
+  template <typename T, std::uint64_t Id>
+  static std::size_t EntrySize(const Entry<T, Id, DeletedEntry>& /*entry*/,
+                               Change /*change*/) {
+    return 0;
+  }
+
+  static std::size_t Size(const Type& /*value*/, Index<0>) { return 0; }
+
+  template <std::size_t index>
+  static std::size_t Size(const Type& value, Index<index>) {
+    using Pointer = PointerAt<index - 1>;
+    return Size(value, Index<index - 1>{}) +
+           EntrySize(Pointer::Resolve(*value.current_),
+                     ChangeAt<index - 1>(value));
+  }
+
+  template <typename T, std::uint64_t Id, typename Storage, typename Writer>
+  static Status<void> WriteEntry(const Entry<T, Id, Storage>& entry,
+                                 Change change, Writer* writer) {
+    if (change == Change::None)
+      return {};
+
+    auto status = Encoding<std::uint64_t>::Write(Id, writer);
+    if (!status)
+      return status;
+
+    if (change == Change::Cleared)
+      return Encoding<SizeType>::Write(0, writer);
+
+    const SizeType size = Encoding<T>::Size(entry.get());
+    status = Encoding<SizeType>::Write(size, writer);
+    if (!status)
+      return status;
+
+    // Pad out any overestimate of the size, as table entries do.
+    BoundedWriter<Writer> bounded_writer{writer, size};
+    status = Encoding<T>::Write(entry.get(), &bounded_writer);
+    if (!status)
+      return status;
+
+    return bounded_writer.WritePadding();
+  }
+
+  template <typename T, std::uint64_t Id, typename Writer>
+  static Status<void> WriteEntry(const Entry<T, Id, DeletedEntry>& /*entry*/,
+                                 Change /*change*/, Writer* /*writer*/) {
+    return {};
+  }
+
+  template <typename Writer>
+  static Status<void> WriteEntries(const Type& /*value*/, Writer* /*writer*/,
+                                   Index<0>) {
+    return {};
+  }
+
+  template <std::size_t index, typename Writer>
+  static Status<void> WriteEntries(const Type& value, Writer* writer,
+                                   Index<index>) {
+    auto status = WriteEntries(value, writer, Index<index - 1>{});
+    if (!status)
+      return status;
+
+    using Pointer = PointerAt<index - 1>;
+    return WriteEntry(Pointer::Resolve(*value.current_),
+                      ChangeAt<index - 1>(value), writer);
+  }
+
+  template <typename T, std::uint64_t Id, typename Storage, typename Reader>
+  static Status<void> ApplyEntry(Entry<T, Id, Storage>* entry, Reader* reader) {
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    if (size == 0) {
+      entry->clear();
+      return {};
+    }
+
+    // Decode into a fresh value, since the delta carries the complete value of
+    // the entry rather than changes to it.
+    *entry = T{};
+    return ReadBoundedValue(&entry->get(), size, reader);
+  }
+
+  // Skips over the binary container for an entry, updating the session state
+  // of the reader with any definitions in it.
+  template <typename Reader>
+  static Status<void> SkipEntry(Reader* reader) {
+    return detail::SkipSizedValue(reader, 0);
+  }
+
+  template <typename T, std::uint64_t Id, typename Reader>
+  static Status<void> ApplyEntry(Entry<T, Id, DeletedEntry>* /*entry*/,
+                                 Reader* reader) {
+    return SkipEntry(reader);
+  }
+
+  template <std::size_t index, typename Reader>
+  static Status<void> ApplyEntryAt(Table* table, Reader* reader) {
+    return ApplyEntry(PointerAt<index>::Resolve(table), reader);
+  }
+
+  // Dispatches to the entry with |id| through a compile-time map of entry ids,
+  // as table decoding does. Unknown ids are skipped.
+  template <typename Reader, std::size_t... Is>
+  static Status<void> ApplyEntryForId(Table* table, std::uint64_t id,
+                                      Reader* reader,
+                                      std::index_sequence<Is...>) {
+    using Thunk = Status<void> (*)(Table*, Reader*);
+    static constexpr Thunk kAppliers[] = {&ApplyEntryAt<Is, Reader>...};
+    static constexpr KeyIndexMap<std::uint64_t, Count> kIdMap{
+        {PointerAt<Is>::Type::Id...}};
+
+    const std::size_t index = kIdMap.Find(id);
+    if (index == Count)
+      return SkipEntry(reader);
+    else
+      return kAppliers[index](table, reader);
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_TABLE_DELTA_H_
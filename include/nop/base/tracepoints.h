@@ -0,0 +1,142 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_TRACEPOINTS_H_
+#define LIBNOP_INCLUDE_NOP_BASE_TRACEPOINTS_H_
+
+//
+// Static tracepoints.
+//
+// Tracepoints are compiled out unless NOP_ENABLE_TRACEPOINTS is defined to 1,
+// in which case libnop places USDT probes, in the SystemTap SDT format that
+// perf, bpftrace, and other tracers understand, at the following points:
+//
+//   nop:write_entry(type_name, size)    Serializer::Write() of a value.
+//   nop:write_exit(type_name, error)
+//   nop:read_entry(type_name)           Deserializer::Read() of a value.
+//   nop:read_exit(type_name, error)
+//   nop:dispatch(selector, index)       InterfaceBindings dispatch, where
+//                                       index is the count of bindings if the
+//                                       selector is not bound.
+//   nop:dispatch_id(method_id)          InterfaceBindings::DispatchById().
+//   nop:fd_read(fd, size, result)       read(2) and write(2) by FdReader and
+//   nop:fd_write(fd, size, result)      FdWriter, with the syscall result.
+//
+// Arguments are 64-bit; type names are pointers to NUL-terminated strings and
+// errors are ErrorStatus values. Each probe is a nop instruction guarded by an
+// SDT semaphore, so when no tracer is attached a probe costs a load and an
+// untaken branch, and arguments such as the encoded size of a value are only
+// computed while a tracer is attached. For example:
+//
+//   bpftrace -e 'usdt:./server:nop:write_entry {
+//       @bytes[str(arg0)] = sum(arg1); }'
+//
+// Probes are emitted on ELF targets for x86-64 and AArch64 and are compiled
+// out elsewhere. Probes inside Serializer::Write() prevent it from being
+// evaluated at compile time. The definition of NOP_ENABLE_TRACEPOINTS must be
+// the same in every translation unit of a program.
+//
+
+#ifndef NOP_ENABLE_TRACEPOINTS
+#define NOP_ENABLE_TRACEPOINTS 0
+#endif
+
+#if NOP_ENABLE_TRACEPOINTS && defined(__ELF__) && \
+    (defined(__x86_64__) || defined(__aarch64__))
+#define NOP_HAS_TRACEPOINTS 1
+#else
+#define NOP_HAS_TRACEPOINTS 0
+#endif
+
+#if NOP_HAS_TRACEPOINTS
+
+#include <cstdint>
+
+// Assembles the SDT note of a probe with three 64-bit arguments, following
+// the layout of <sys/sdt.h> so that no system header is required.
+#define _NOP_SDT_NOTE(name, semaphore)                                      \
+  "990: nop\n"                                                              \
+  ".pushsection .note.stapsdt,\"?\",\"note\"\n"                             \
+  ".balign 4\n"                                                             \
+  ".4byte 992f-991f,994f-993f,3\n"                                          \
+  "991: .asciz \"stapsdt\"\n"                                               \
+  "992: .balign 4\n"                                                        \
+  "993: .8byte 990b\n"                                                      \
+  ".8byte _.stapsdt.base\n"                                                 \
+  ".8byte " semaphore "\n"                                                  \
+  ".asciz \"nop\"\n"                                                        \
+  ".asciz \"" name "\"\n"                                                   \
+  ".asciz \"8@%[a0] 8@%[a1] 8@%[a2]\"\n"                                    \
+  "994: .balign 4\n"                                                        \
+  ".popsection\n"                                                           \
+  ".ifndef _.stapsdt.base\n"                                                \
+  ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"   \
+  ".weak _.stapsdt.base\n"                                                  \
+  ".hidden _.stapsdt.base\n"                                                \
+  "_.stapsdt.base: .space 1\n"                                              \
+  ".size _.stapsdt.base,1\n"                                                \
+  ".popsection\n"                                                           \
+  ".endif\n"
+
+// Defines the semaphore and probe function of tracepoint |name|. Semaphores
+// are weak so that every translation unit may define them.
+#define _NOP_DEFINE_TRACEPOINT(name)                                        \
+  extern "C" {                                                              \
+  __attribute__((weak, used, section(".probes"))) volatile unsigned short  \
+      nop_##name##_semaphore = 0;                                           \
+  }                                                                         \
+  namespace nop {                                                           \
+  namespace detail {                                                        \
+  inline void Trace_##name(std::uint64_t a0, std::uint64_t a1 = 0,          \
+                           std::uint64_t a2 = 0) {                          \
+    __asm__ __volatile__(                                                   \
+        _NOP_SDT_NOTE(#name, "nop_" #name "_semaphore")::[a0] "nor"(a0),    \
+        [a1] "nor"(a1), [a2] "nor"(a2));                                    \
+  }                                                                         \
+  }                                                                         \
+  }
+
+_NOP_DEFINE_TRACEPOINT(write_entry)
+_NOP_DEFINE_TRACEPOINT(write_exit)
+_NOP_DEFINE_TRACEPOINT(read_entry)
+_NOP_DEFINE_TRACEPOINT(read_exit)
+_NOP_DEFINE_TRACEPOINT(dispatch)
+_NOP_DEFINE_TRACEPOINT(dispatch_id)
+_NOP_DEFINE_TRACEPOINT(fd_read)
+_NOP_DEFINE_TRACEPOINT(fd_write)
+
+// Evaluates to true while a tracer is attached to tracepoint |name|.
+#define NOP_TRACEPOINT_ACTIVE(name) \
+  (__builtin_expect(nop_##name##_semaphore != 0, 0))
+
+// Fires tracepoint |name|. The arguments are only evaluated while a tracer is
+// attached and are converted to std::uint64_t.
+#define NOP_TRACE(name, ... /*args*/)           \
+  do {                                          \
+    if (NOP_TRACEPOINT_ACTIVE(name))            \
+      ::nop::detail::Trace_##name(__VA_ARGS__); \
+  } while (0)
+
+#else  // NOP_HAS_TRACEPOINTS
+
+#define NOP_TRACEPOINT_ACTIVE(name) false
+#define NOP_TRACE(name, ... /*args*/) \
+  do {                                \
+  } while (0)
+
+#endif  // NOP_HAS_TRACEPOINTS
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_TRACEPOINTS_H_
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_TYPE_NAME_H_
+#define LIBNOP_INCLUDE_NOP_BASE_TYPE_NAME_H_
+
+#include <cstring>
+#include <string>
+#include <typeinfo>
+
+namespace nop {
+
+namespace detail {
+
+// Extracts the type from the signature of TypeName<T>().
+inline std::string ParseTypeName(const char* signature) {
+  const char* begin = std::strstr(signature, "T = ");
+  const char* end = std::strrchr(signature, ']');
+  if (begin == nullptr || end == nullptr || end < begin)
+    return signature;
+  begin += 4;
+  return std::string(begin, end);
+}
+
+}  // namespace detail
+
+// Returns the readable name of type T, for example "std::vector<int>". The
+// string has static storage duration and a unique address for each type.
+template <typename T>
+const char* TypeName() {
+#if defined(__GNUC__) || defined(__clang__)
+  static const std::string name = detail::ParseTypeName(__PRETTY_FUNCTION__);
+#else
+  static const std::string name = typeid(T).name();
+#endif
+  return name.c_str();
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_TYPE_NAME_H_
@@ -18,6 +18,7 @@
 #define LIBNOP_INCLUDE_NOP_BASE_VARIANT_H_
 
 #include <nop/base/encoding.h>
+#include <nop/base/size_cache.h>
 #include <nop/types/variant.h>
 
 namespace nop {
@@ -82,11 +83,14 @@ struct Encoding<Variant<Ts...>> : EncodingIO<Variant<Ts...>> {
   }
 
   static constexpr std::size_t Size(const Type& value) {
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache) {
     return BaseEncodingSize(Prefix(value)) +
            Encoding<std::int32_t>::Size(value.index()) +
-           value.Visit([](const auto& element) {
-             using Element = typename std::decay<decltype(element)>::type;
-             return Encoding<Element>::Size(element);
+           value.Visit([cache](const auto& element) {
+             return CachedSize(element, cache);
            });
   }
 
@@ -120,6 +124,8 @@ struct Encoding<Variant<Ts...>> : EncodingIO<Variant<Ts...>> {
       return ErrorStatus::UnexpectedVariantType;
     }
 
+    // Become() keeps the active element when the index is unchanged, so the
+    // element is decoded in place and any storage it owns is reused.
     value->Become(type);
 
     return value->Visit([reader](auto&& element) {
@@ -18,9 +18,17 @@
 #define LIBNOP_INCLUDE_NOP_BASE_VECTOR_H_
 
 #include <nop/base/encoding.h>
+#include <nop/base/fixint_array.h>
+#include <nop/base/min_encoded_size.h>
+#include <nop/base/size_cache.h>
 #include <nop/base/utility.h>
+#include <nop/utility/bit_packing.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <numeric>
+#include <type_traits>
 #include <vector>
 
 namespace nop {
@@ -34,7 +42,8 @@ namespace nop {
 //
 // Elements must be valid encodings of type T.
 //
-// std::vector<T> encoding format for integral types:
+// std::vector<T> encoding format for integral types other than bool, which is
+// bit-packed as described in base/bit_array.h:
 //
 // +-----+---------+---//----+
 // | BIN | INT64:L | L BYTES |
@@ -45,6 +54,281 @@ namespace nop {
 // Elements are stored as direct little-endian representation of the integral
 // value; each element is sizeof(T) bytes in size.
 //
+// std::vector<T> chunked encoding format, accepted by the decoders of both
+// forms above:
+//
+// +-----+---------+------//-----+---------+------//-----+-----+---------+
+// | CHA | INT64:N | N ELEMENTS  | INT64:M | M ELEMENTS  | ... | INT64:0 |
+// +-----+---------+------//-----+---------+------//-----+-----+---------+
+//
+// Elements must be valid encodings of type T, even for integral types. Each
+// chunk is a non-zero element count followed by that many elements, and the
+// sequence of chunks is terminated by a zero count. This form is written by
+// ChunkedArrayWriter for producers that do not know the number of elements up
+// front.
+//
+// std::vector<T> indexed encoding format for non-integral types, accepted by
+// the decoder of the ARY form:
+//
+// +-----+---------+-----+---------+---//----+-----//-----+
+// | IXA | INT64:N | BIN | INT64:L | OFFSETS | N ELEMENTS |
+// +-----+---------+-----+---------+---//----+-----//-----+
+//
+// Where OFFSETS holds the byte offset of each element from the start of the
+// first element, as N little-endian integers that are each L / N bytes wide.
+// This form is written by IndexedArray<T> and is read in order here, ignoring
+// the offsets; ArrayCursor and IndexedArrayView use them for random access.
+//
+// std::vector<T> packed encoding format for integral types, accepted by the
+// decoder of the BIN form:
+//
+// +-----+---------+-------------+-----+---------+---//---+
+// | PKA | INT64:N | INT64:FIRST | BIN | INT64:L | BLOCKS |
+// +-----+---------+-------------+-----+---------+---//---+
+//
+// Where BLOCKS holds the zigzag-encoded differences between consecutive
+// elements, bit-packed in blocks of kPackedBlockSize, each preceded by a byte
+// giving its width in bits. This form is written by Packed<T>; see
+// docs/format.md for the details.
+//
+
+namespace detail {
+
+enum : std::size_t { kPackedBlockSize = 128 };
+
+// Returns |value| extended to 64 bits, with sign extension for signed types.
+template <typename T>
+constexpr std::uint64_t WidenInteger(T value) {
+  return std::is_signed<T>::value
+             ? static_cast<std::uint64_t>(static_cast<std::int64_t>(value))
+             : static_cast<std::uint64_t>(value);
+}
+
+// The readers below take any Vector with the interface of std::vector used
+// here, so that InlineVector<T, N> decodes the same forms.
+
+// Reads the payload of a packed array of integral type T.
+template <typename Vector, typename Reader>
+Status<void> ReadPackedArray(Vector* value, Reader* reader) {
+  using T = typename Vector::value_type;
+
+  SizeType count = 0;
+  auto status = Encoding<SizeType>::Read(&count, reader);
+  if (!status)
+    return status;
+
+  std::int64_t first = 0;
+  status = Encoding<std::int64_t>::Read(&first, reader);
+  if (!status)
+    return status;
+
+  std::uint8_t prefix_byte = 0;
+  status = reader->Read(&prefix_byte);
+  if (!status)
+    return status;
+  else if (static_cast<EncodingByte>(prefix_byte) != EncodingByte::Binary)
+    return ErrorStatus::UnexpectedEncodingType;
+
+  SizeType size = 0;
+  status = Encoding<SizeType>::Read(&size, reader);
+  if (!status)
+    return status;
+
+  status = reader->Ensure(size);
+  if (!status)
+    return status;
+
+  // Every block takes at least its width byte, which bounds the element count
+  // by the bytes available before sizing the vector.
+  const SizeType delta_count = count == 0 ? 0 : count - 1;
+  const SizeType block_count =
+      (delta_count + kPackedBlockSize - 1) / kPackedBlockSize;
+  if (block_count > size || (count == 0 && size != 0))
+    return ErrorStatus::InvalidContainerLength;
+
+  value->resize(count);
+  if (count == 0)
+    return {};
+
+  std::uint64_t current = static_cast<std::uint64_t>(first);
+  (*value)[0] = static_cast<T>(current);
+  if (WidenInteger((*value)[0]) != current)
+    return ErrorStatus::InvalidContainerLength;
+
+  std::uint8_t data[kPackedBlockSize * sizeof(std::uint64_t) +
+                    sizeof(std::uint64_t)] = {};
+  std::uint64_t deltas[kPackedBlockSize];
+  SizeType remaining = size;
+  for (SizeType index = 1; index < count; index += kPackedBlockSize) {
+    const std::size_t block_size =
+        std::min<SizeType>(kPackedBlockSize, count - index);
+
+    std::uint8_t width = 0;
+    status = reader->Read(&width);
+    if (!status)
+      return status;
+
+    const std::size_t packed_size = PackedSize(block_size, width);
+    if (width > 64 || packed_size >= remaining)
+      return ErrorStatus::InvalidContainerLength;
+    remaining -= packed_size + 1;
+
+    status = reader->Read(data, data + packed_size);
+    if (!status)
+      return status;
+
+    UnpackBits(data, block_size, width, deltas);
+    for (std::size_t i = 0; i < block_size; i++) {
+      current += static_cast<std::uint64_t>(ZigZagDecode(deltas[i]));
+      T& element = (*value)[index + i];
+      element = static_cast<T>(current);
+      if (WidenInteger(element) != current)
+        return ErrorStatus::InvalidContainerLength;
+    }
+  }
+
+  if (remaining != 0)
+    return ErrorStatus::InvalidContainerLength;
+
+  return {};
+}
+
+// Reads the header of the offset table of an indexed array of |count| elements,
+// returning the width of each offset in bytes.
+template <typename Reader>
+Status<std::size_t> ReadOffsetTableHeader(SizeType count, Reader* reader) {
+  std::uint8_t prefix_byte = 0;
+  auto status = reader->Read(&prefix_byte);
+  if (!status)
+    return status.error();
+  else if (static_cast<EncodingByte>(prefix_byte) != EncodingByte::Binary)
+    return ErrorStatus::UnexpectedEncodingType;
+
+  SizeType size = 0;
+  status = Encoding<SizeType>::Read(&size, reader);
+  if (!status)
+    return status.error();
+
+  if (count == 0) {
+    if (size != 0)
+      return ErrorStatus::InvalidContainerLength;
+    return 0;
+  }
+
+  const SizeType width = size / count;
+  if (size % count != 0 || (width != sizeof(std::uint32_t) &&
+                            width != sizeof(std::uint64_t))) {
+    return ErrorStatus::InvalidContainerLength;
+  }
+
+  return width;
+}
+
+// Skips the offset table of an indexed array of |count| elements.
+template <typename Reader>
+Status<void> SkipOffsetTable(SizeType count, Reader* reader) {
+  auto width = ReadOffsetTableHeader(count, reader);
+  if (!width)
+    return width.error();
+
+  const std::size_t size = count * width.get();
+  auto status = reader->Ensure(size);
+  if (!status)
+    return status;
+
+  return reader->Skip(size);
+}
+
+// Decodes |count| elements into |value| starting at |index|, decoding into the
+// existing elements in place and growing the vector as elements are read. To
+// prevent abuse from very large counts, only as many elements are reserved as
+// the bytes remaining in the reader could hold; readers that do not report the
+// remaining bytes grow the vector one element at a time.
+template <typename Vector, typename Reader>
+Status<void> ReadVectorElements(Vector* value, std::size_t index,
+                                SizeType count, Reader* reader,
+                                std::false_type /*is_bulk_readable*/) {
+  using T = typename Vector::value_type;
+
+  value->reserve(std::max<std::size_t>(
+      value->size(),
+      index + ReserveLimit(count, MinEncodedSize<T>::value, reader)));
+
+  for (SizeType i = 0; i < count; i++, index++) {
+    if (index < value->size()) {
+      auto status = Encoding<T>::Read(&(*value)[index], reader);
+      if (!status)
+        return status;
+    } else {
+      value->emplace_back();
+      auto status = Encoding<T>::Read(&value->back(), reader);
+      if (!status) {
+        value->pop_back();
+        return status;
+      }
+    }
+  }
+  return {};
+}
+
+// Every element takes at least one byte, so the vector may be sized up front
+// once the reader is known to hold |count| more bytes, leaving the elements to
+// be decoded in bulk.
+template <typename Vector, typename Reader>
+Status<void> ReadVectorElements(Vector* value, std::size_t index,
+                                SizeType count, Reader* reader,
+                                std::true_type /*is_bulk_readable*/) {
+  using T = typename Vector::value_type;
+
+  if (count > reader->remaining())
+    return ErrorStatus::ReadLimitReached;
+
+  if (value->size() < index + count)
+    value->resize(index + count);
+
+  T* begin = value->data() + index;
+  return ReadElements(begin, begin + count, reader, std::true_type{});
+}
+
+template <typename Vector, typename Reader>
+Status<void> ReadVectorElements(Vector* value, std::size_t index,
+                                SizeType count, Reader* reader) {
+  using T = typename Vector::value_type;
+
+  auto status = ChargeAllocation(count, sizeof(T), reader);
+  if (!status)
+    return status;
+
+  return ReadVectorElements(value, index, count, reader,
+                            IsFixIntBulkReadable<T, Reader>{});
+}
+
+// Reads the chunks of a chunked array into |value|, decoding into the existing
+// elements in place and truncating or growing the vector to the number of
+// elements read.
+template <typename Vector, typename Reader>
+Status<void> ReadChunkedArray(Vector* value, Reader* reader) {
+  std::size_t index = 0;
+  while (true) {
+    SizeType count = 0;
+    auto status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+    else if (count == 0)
+      break;
+
+    status = ReadVectorElements(value, index, count, reader);
+    if (!status)
+      return status;
+    index += count;
+  }
+
+  if (value->size() > index)
+    value->erase(value->begin() + index, value->end());
+  return {};
+}
+
+}  // namespace detail
 
 // Specialization for non-integral types.
 template <typename T, typename Allocator>
@@ -57,16 +341,22 @@ struct Encoding<std::vector<T, Allocator>, EnableIfNotIntegral<T>>
   }
 
   static constexpr std::size_t Size(const Type& value) {
+    return Size(value, nullptr);
+  }
+
+  static constexpr std::size_t Size(const Type& value, SizeCache* cache) {
     return BaseEncodingSize(Prefix(value)) +
            Encoding<SizeType>::Size(value.size()) +
            std::accumulate(value.cbegin(), value.cend(), 0U,
-                           [](const std::size_t& sum, const T& element) {
-                             return sum + Encoding<T>::Size(element);
+                           [cache](const std::size_t& sum, const T& element) {
+                             return sum + CachedSize(element, cache);
                            });
   }
 
   static constexpr bool Match(EncodingByte prefix) {
-    return prefix == EncodingByte::Array;
+    return prefix == EncodingByte::Array ||
+           prefix == EncodingByte::ChunkedArray ||
+           prefix == EncodingByte::IndexedArray;
   }
 
   template <typename Writer>
@@ -87,35 +377,36 @@ struct Encoding<std::vector<T, Allocator>, EnableIfNotIntegral<T>>
   }
 
   template <typename Reader>
-  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
-                                            Type* value, Reader* reader) {
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    if (prefix == EncodingByte::ChunkedArray)
+      return detail::ReadChunkedArray(value, reader);
+
     SizeType size = 0;
     auto status = Encoding<SizeType>::Read(&size, reader);
     if (!status)
       return status;
 
-    // Clear the vector to make sure elements are inserted at the correct
-    // indices. Intentionally avoid calling reserve() to prevent abuse from very
-    // large size values. Regardless of the size specified in the encoding the
-    // bytes remaining in the reader provide a natural upper limit to the number
-    // of allocations.
-    value->clear();
-    for (SizeType i = 0; i < size; i++) {
-      T element;
-      status = Encoding<T>::Read(&element, reader);
+    if (prefix == EncodingByte::IndexedArray) {
+      status = detail::SkipOffsetTable(size, reader);
       if (!status)
         return status;
-
-      value->push_back(std::move(element));
     }
 
-    return {};
+    // Decode into the existing elements in place so that any storage they own
+    // is reused, truncating or growing the vector to the encoded size.
+    if (value->size() > size)
+      value->erase(value->begin() + size, value->end());
+    return detail::ReadVectorElements(value, 0, size, reader);
   }
 };
 
-// Specialization for integral types.
+// Specialization for integral types. std::vector<bool> has no contiguous
+// storage to copy and is handled in base/bit_array.h.
 template <typename T, typename Allocator>
-struct Encoding<std::vector<T, Allocator>, EnableIfIntegral<T>>
+struct Encoding<
+    std::vector<T, Allocator>,
+    std::enable_if_t<IsIntegral<T>::value && !std::is_same<T, bool>::value>>
     : EncodingIO<std::vector<T, Allocator>> {
   using Type = std::vector<T, Allocator>;
 
@@ -130,7 +421,9 @@ struct Encoding<std::vector<T, Allocator>, EnableIfIntegral<T>>
   }
 
   static constexpr bool Match(EncodingByte prefix) {
-    return prefix == EncodingByte::Binary;
+    return prefix == EncodingByte::Binary ||
+           prefix == EncodingByte::ChunkedArray ||
+           prefix == EncodingByte::PackedArray;
   }
 
   template <typename Writer>
@@ -147,8 +440,13 @@ struct Encoding<std::vector<T, Allocator>, EnableIfIntegral<T>>
   }
 
   template <typename Reader>
-  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
-                                            Type* value, Reader* reader) {
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    if (prefix == EncodingByte::ChunkedArray)
+      return detail::ReadChunkedArray(value, reader);
+    else if (prefix == EncodingByte::PackedArray)
+      return detail::ReadPackedArray(value, reader);
+
     SizeType size = 0;
     auto status = Encoding<SizeType>::Read(&size, reader);
     if (!status)
@@ -165,6 +463,12 @@ struct Encoding<std::vector<T, Allocator>, EnableIfIntegral<T>>
     if (!status)
       return status;
 
+    status = detail::ChargeAllocation(size, 1, reader);
+    if (!status)
+      return status;
+
+    // Vectors using DefaultInitAllocator grow without zero-filling the new
+    // elements before they are overwritten here.
     value->resize(length);
     return reader->Read(value->data(), value->data() + length);
   }
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_CODEC_H_
+#define LIBNOP_INCLUDE_NOP_CODEC_H_
+
+#include <type_traits>
+
+#include <nop/base/encoding.h>
+#include <nop/utility/compiler.h>
+
+namespace nop {
+
+//
+// Out-of-line codecs.
+//
+// Encodings are header-only, so every translation unit that serializes a type
+// instantiates and inlines the complete encoder for the type and everything it
+// contains. For large schemas this multiplies code size and spreads the encode
+// and decode paths of each type over many copies. The macros below instead
+// route the encoder or decoder of a type, for a specific writer or reader type,
+// through a single out-of-line function:
+//
+//   NOP_DECLARE_ENCODER(type, writer) / NOP_DEFINE_ENCODER(type, writer)
+//   NOP_DECLARE_DECODER(type, reader) / NOP_DEFINE_DECODER(type, reader)
+//   NOP_DECLARE_CODEC(type, writer, reader) / NOP_DEFINE_CODEC(...)
+//
+// The declaration must be visible wherever the type is serialized, which is
+// best arranged by placing it in the header that defines the type, after the
+// definition. The definition must appear in exactly one translation unit.
+// Both must be used at global scope with fully qualified type names; use an
+// alias for template types whose arguments contain commas.
+//
+// Encoders and decoders only apply to the writer or reader type the encodings
+// of the type see, so declare them for the type wrapped by the serializer,
+// such as nop::BufferWriter for Serializer<BufferWriter*>. Types containing
+// tables are written through a SizeCacheWriter<Writer> wrapper by
+// non-single-pass writers and may be declared for it as well. Nested types are
+// routed through their own out-of-line functions when they have them, so
+// declaring the codecs of the types shared across a schema keeps a single copy
+// of each. Encodings that provide their own Write() or Read(), instead of using
+// those of EncodingIO, are not affected.
+//
+// Example:
+//
+//  // record.h
+//  struct Record { ... NOP_STRUCTURE(Record, ...); };
+//  NOP_DECLARE_CODEC(::example::Record, ::nop::BufferWriter,
+//                    ::nop::BufferReader);
+//
+//  // record.cpp
+//  NOP_DEFINE_CODEC(::example::Record, ::nop::BufferWriter,
+//                   ::nop::BufferReader);
+//
+
+// The definitions are not inlined into each other so that the codecs of
+// nested types keep a single copy in the defining translation unit as well.
+template <typename T, typename Writer>
+NOP_NOINLINE Status<void> OutOfLineEncoder<T, Writer>::Write(const T& value,
+                                                             Writer* writer) {
+  return EncodingIO<T>::Write(value, writer, std::false_type{});
+}
+
+template <typename T, typename Reader>
+NOP_NOINLINE Status<void> OutOfLineDecoder<T, Reader>::Read(T* value,
+                                                             Reader* reader) {
+  return EncodingIO<T>::Read(value, reader, std::false_type{});
+}
+
+}  // namespace nop
+
+#define NOP_DECLARE_ENCODER(type, writer)                            \
+  namespace nop {                                                   \
+  template <>                                                       \
+  struct HasOutOfLineEncoder<type, writer> : std::true_type {};     \
+  extern template struct OutOfLineEncoder<type, writer>;            \
+  }                                                                 \
+  static_assert(true, "")
+
+#define NOP_DECLARE_DECODER(type, reader)                            \
+  namespace nop {                                                   \
+  template <>                                                       \
+  struct HasOutOfLineDecoder<type, reader> : std::true_type {};     \
+  extern template struct OutOfLineDecoder<type, reader>;            \
+  }                                                                 \
+  static_assert(true, "")
+
+#define NOP_DEFINE_ENCODER(type, writer) \
+  template struct ::nop::OutOfLineEncoder<type, writer>
+
+#define NOP_DEFINE_DECODER(type, reader) \
+  template struct ::nop::OutOfLineDecoder<type, reader>
+
+#define NOP_DECLARE_CODEC(type, writer, reader) \
+  NOP_DECLARE_ENCODER(type, writer);            \
+  NOP_DECLARE_DECODER(type, reader)
+
+#define NOP_DEFINE_CODEC(type, writer, reader) \
+  NOP_DEFINE_ENCODER(type, writer);            \
+  NOP_DEFINE_DECODER(type, reader)
+
+#endif  // LIBNOP_INCLUDE_NOP_CODEC_H_
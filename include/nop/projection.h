@@ -0,0 +1,74 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_PROJECTION_H_
+#define LIBNOP_INCLUDE_NOP_PROJECTION_H_
+
+#include <cstddef>
+#include <type_traits>
+
+#include <nop/base/utility.h>
+#include <nop/structure.h>
+
+namespace nop {
+
+//
+// Projections select a subset of the members of a serializable structure or
+// the entries of a table to decode. Deserializer::ReadProjected() reads only
+// the members in the projection; the encodings of the other members are
+// skipped without being decoded and those members keep their current values.
+// Unlisted table entries are skipped using their sized wrappers and are left
+// empty.
+//
+// Example:
+//
+//  struct Record {
+//    int id;
+//    std::string name;
+//    std::vector<Sample> samples;
+//    NOP_STRUCTURE(Record, id, name, samples);
+//  };
+//
+//  using RecordName = NOP_PROJECTION(Record, id, name);
+//
+//  Record record;
+//  auto status = deserializer.ReadProjected<RecordName>(&record);
+//
+// A projection lists the members with the same names used in NOP_STRUCTURE or
+// NOP_TABLE, including logical buffer pairs in parentheses.
+//
+
+// Captures a list of MemberPointers to decode.
+template <typename... MemberPointers>
+struct Projection {
+  static_assert(sizeof...(MemberPointers) > 0,
+                "A projection must have at least one member.");
+
+  enum : std::size_t { Count = sizeof...(MemberPointers) };
+
+  // Evaluates to true if the given MemberPointer is in the projection.
+  template <typename MemberPointer>
+  using Contains = Or<std::is_same<MemberPointer, MemberPointers>...>;
+};
+
+// Defines a Projection type of the given structure or table type and list of
+// member or entry names.
+#define NOP_PROJECTION(type, ... /*members*/) \
+  ::nop::Projection<_NOP_MEMBER_LIST(type, __VA_ARGS__)>
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_PROJECTION_H_
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_AWAITABLE_METHOD_H_
+#define LIBNOP_INCLUDE_NOP_RPC_AWAITABLE_METHOD_H_
+
+#include <nop/utility/compiler.h>
+
+#if NOP_HAS_COROUTINES
+
+#include <coroutine>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <nop/status.h>
+
+namespace nop {
+
+// MethodAwaiter is a C++20 awaitable that invokes an interface method with an
+// asynchronous sender, such as PipelinedMethodSender, and suspends the awaiting
+// coroutine until the return value arrives. The coroutine is resumed on the
+// thread that receives the return value, typically an event loop calling
+// PipelinedMethodSender::ReceiveReturn(), so any number of calls may be
+// outstanding without a thread for each. The awaiter is created with
+// AwaitMethod():
+//
+//  Status<int> sum = co_await AwaitMethod<Calculator::Sum>(&sender, 10, 20);
+//
+// The arguments are copied into the awaiter before the call is sent. If the
+// call cannot be sent the coroutine continues without suspending and the
+// result holds the error.
+//
+// This header is empty unless the compiler supports C++20 coroutines.
+template <typename Method, typename Sender, typename... Args>
+class MethodAwaiter {
+ public:
+  using Return = typename Method::InterfaceTraits::Return;
+
+  MethodAwaiter(Sender* sender, Args&&... args)
+      : sender_{sender}, args_{std::forward<Args>(args)...} {}
+
+  bool await_ready() const noexcept { return false; }
+
+  bool await_suspend(std::coroutine_handle<> handle) {
+    // The return value may arrive on another thread and resume the coroutine,
+    // destroying this awaiter, before the send returns; only the local result
+    // may be used afterwards.
+    auto request_id = Send(handle, std::index_sequence_for<Args...>{});
+    if (!request_id) {
+      result_ = request_id.error();
+      return false;
+    }
+    return true;
+  }
+
+  Status<Return> await_resume() { return std::move(result_); }
+
+ private:
+  template <std::size_t... Is>
+  auto Send(std::coroutine_handle<> handle, std::index_sequence<Is...>) {
+    return Method::InvokeAsync(
+        sender_,
+        [this, handle](Status<Return> result) {
+          result_ = std::move(result);
+          handle.resume();
+        },
+        std::get<Is>(args_)...);
+  }
+
+  Sender* sender_;
+  std::tuple<std::decay_t<Args>...> args_;
+  Status<Return> result_;
+};
+
+// Returns an awaitable that invokes |Method| with the given sender and
+// arguments.
+template <typename Method, typename Sender, typename... Args>
+MethodAwaiter<Method, Sender, Args...> AwaitMethod(Sender* sender,
+                                                   Args&&... args) {
+  return {sender, std::forward<Args>(args)...};
+}
+
+}  // namespace nop
+
+#endif  // NOP_HAS_COROUTINES
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_AWAITABLE_METHOD_H_
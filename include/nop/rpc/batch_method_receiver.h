@@ -0,0 +1,123 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_BATCH_METHOD_RECEIVER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_BATCH_METHOD_RECEIVER_H_
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+// BatchMethodReceiver is the Receiver counterpart of BatchingMethodSender. It
+// is used with InterfaceBindings::DispatchBatch(), which calls BeginBatch() to
+// read a request frame, dispatches each call in the frame in order, and calls
+// EndBatch() to write the return values of the calls as one response frame.
+//
+// Calls within a frame are decoded from memory, so the transport is read once
+// and written once per batch regardless of the number of calls it holds.
+template <typename Serializer, typename Deserializer>
+class BatchMethodReceiver {
+ public:
+  // Type of the id used to match return values to calls.
+  using RequestId = std::uint64_t;
+
+  BatchMethodReceiver(Serializer* serializer, Deserializer* deserializer)
+      : serializer_{serializer},
+        deserializer_{deserializer},
+        frame_deserializer_{&frame_reader_},
+        response_serializer_{&response_} {}
+
+  BatchMethodReceiver(const BatchMethodReceiver&) = delete;
+  void operator=(const BatchMethodReceiver&) = delete;
+
+  // Reads the next request frame from the deserializer.
+  Status<void> BeginBatch() {
+    response_.clear();
+    auto status = deserializer_->Read(&frame_);
+    if (!status) {
+      frame_reader_ = BufferReader{};
+      return status;
+    }
+
+    frame_reader_ = BufferReader{frame_.data(), frame_.size()};
+    return {};
+  }
+
+  // Returns true if the current request frame holds more calls.
+  bool HasNextCall() const { return frame_reader_.remaining() > 0; }
+
+  // Writes the return values of the calls dispatched since BeginBatch() as one
+  // response frame.
+  Status<void> EndBatch() {
+    auto status = serializer_->Write(response_.data());
+    response_.clear();
+    return status;
+  }
+
+  template <typename MethodSelector>
+  Status<void> GetMethodSelector(MethodSelector* method_selector) {
+    auto status = frame_deserializer_.Read(&request_id_);
+    if (!status)
+      return status;
+
+    return frame_deserializer_.Read(method_selector);
+  }
+
+  template <typename... Args>
+  Status<void> GetArgs(std::tuple<Args...>* args) {
+    return frame_deserializer_.Read(args);
+  }
+
+  template <typename Return>
+  Status<void> SendReturn(const Return& return_value) {
+    auto status = response_serializer_.Write(request_id_);
+    if (!status)
+      return status;
+
+    return response_serializer_.Write(return_value);
+  }
+
+  // Returns the request id of the call being dispatched.
+  RequestId request_id() const { return request_id_; }
+
+  const Serializer& serializer() const { return *serializer_; }
+  Serializer& serializer() { return *serializer_; }
+  const Deserializer& deserializer() const { return *deserializer_; }
+  Deserializer& deserializer() { return *deserializer_; }
+
+ private:
+  Serializer* serializer_;
+  Deserializer* deserializer_;
+  RequestId request_id_{0};
+
+  std::vector<std::uint8_t> frame_;
+  BufferReader frame_reader_;
+  nop::Deserializer<BufferReader*> frame_deserializer_;
+
+  VectorWriter response_;
+  nop::Serializer<VectorWriter*> response_serializer_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_BATCH_METHOD_RECEIVER_H_
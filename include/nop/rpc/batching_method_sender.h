@@ -0,0 +1,364 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_BATCHING_METHOD_SENDER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_BATCHING_METHOD_SENDER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <nop/base/serializer.h>
+#include <nop/rpc/detail/pending_calls.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+// Limits that determine when BatchingMethodSender flushes the calls it has
+// collected. A batch is flushed as soon as it holds max_calls calls or
+// max_bytes bytes of encoded calls, or by FlushIfDue() once the oldest call in
+// the batch has waited max_delay.
+struct BatchLimits {
+  std::size_t max_calls{32};
+  std::size_t max_bytes{16 * 1024};
+  std::chrono::steady_clock::duration max_delay{std::chrono::milliseconds{1}};
+};
+
+// BatchingMethodSender is a Sender type that packs many calls into one frame,
+// so that a burst of small calls costs one write to the underlying transport
+// instead of one per call. It is the counterpart of BatchMethodReceiver, which
+// dispatches the calls in a frame in order and returns their results in one
+// response frame.
+//
+// Each frame is written as a single binary value holding a sequence of calls,
+// each of which is a request id, method selector, and argument tuple. Each
+// response frame is a binary value holding the request id and return value of
+// every call in the matching request frame. Response frames arrive in the
+// order the request frames were sent; calls in a request frame that its
+// response does not answer, because the receiver stopped dispatching the frame
+// at an error, are completed with ErrorStatus::ProtocolError.
+//
+// Calls are made with InterfaceMethod::InvokeAsync() and complete when
+// ReceiveReturn() reads the response frame that holds their return values.
+// Calls are held until a limit in BatchLimits is reached or Flush() is called;
+// an event loop should call FlushIfDue() periodically to bound the latency of
+// calls made when traffic is light. InterfaceMethod::Invoke() flushes the
+// current batch and receives responses until its own return value arrives.
+//
+// Calls may be sent and responses received from any thread. Only one thread
+// reads a response frame at a time; a synchronous call whose return value is
+// received by another thread waits for that thread to complete it. Completion
+// ops run without the sender's locks held, so they may make further
+// asynchronous calls.
+template <typename Serializer, typename Deserializer>
+class BatchingMethodSender {
+ public:
+  // Type of the id used to match return values to calls.
+  using RequestId = std::uint64_t;
+
+  BatchingMethodSender(Serializer* serializer, Deserializer* deserializer,
+                       BatchLimits limits = {})
+      : serializer_{serializer},
+        deserializer_{deserializer},
+        limits_{limits},
+        batch_serializer_{&batch_} {}
+
+  BatchingMethodSender(const BatchingMethodSender&) = delete;
+  void operator=(const BatchingMethodSender&) = delete;
+
+  // Adds a call to the current batch, registering |op| to be invoked with the
+  // Status<Return> of the call once its return value is received. Flushes the
+  // batch if it has reached one of the limits. Returns the request id of the
+  // call, or an error if the call could not be encoded or the batch could not
+  // be sent, in which case |op| is never invoked. When a flush fails the other
+  // calls in the batch are completed with the error.
+  template <typename Return, typename MethodSelector, typename... Args,
+            typename Op>
+  Status<RequestId> SendMethodAsync(MethodSelector method_selector,
+                                    const std::tuple<Args...>& args, Op&& op) {
+    std::vector<Completion> cancelled;
+    std::unique_lock<std::mutex> send_lock{send_mutex_};
+    const RequestId request_id = next_request_id_++;
+    const std::size_t mark = batch_.size();
+
+    auto status = batch_serializer_.Write(request_id);
+    if (status)
+      status = batch_serializer_.Write(method_selector);
+    if (status)
+      status = batch_serializer_.Write(args);
+
+    if (!status) {
+      batch_.Truncate(mark);
+      return status.error();
+    }
+
+    pending_.Add(request_id, Pending::template MakeCompletion<Return>(
+                                 std::forward<Op>(op)));
+    if (batch_ids_.empty())
+      batch_start_ = std::chrono::steady_clock::now();
+    batch_ids_.push_back(request_id);
+
+    if (batch_ids_.size() >= limits_.max_calls ||
+        batch_.size() >= limits_.max_bytes) {
+      status = FlushBatch(&cancelled, request_id);
+      send_lock.unlock();
+      if (!status) {
+        CompleteCancelled(&cancelled, status.error());
+        return status.error();
+      }
+    }
+
+    return request_id;
+  }
+
+  // Adds a call to the current batch, flushes it, and receives responses until
+  // the return value of the call arrives.
+  template <typename MethodSelector, typename Return, typename... Args>
+  void SendMethod(MethodSelector method_selector, Status<Return>* return_value,
+                  const std::tuple<Args...>& args) {
+    // Guarded by receive_mutex_, since the call is completed by whichever
+    // thread receives its return value.
+    bool complete = false;
+    auto request_id = SendMethodAsync<Return>(
+        method_selector, args,
+        [this, return_value, &complete](Status<Return> value) {
+          *return_value = std::move(value);
+          std::lock_guard<std::mutex> receive_lock{receive_mutex_};
+          complete = true;
+          receive_condition_.notify_all();
+        });
+    if (!request_id) {
+      *return_value = request_id.error();
+      return;
+    }
+
+    auto status = Flush();
+    std::unique_lock<std::mutex> receive_lock{receive_mutex_};
+    while (status && !complete) {
+      if (receiving_)
+        receive_condition_.wait(receive_lock);
+      else
+        status = ReceiveFrame(&receive_lock);
+    }
+    if (complete)
+      return;
+
+    // Fail the call unless another thread has already taken it to complete.
+    receive_lock.unlock();
+    if (pending_.Take(request_id.get())) {
+      *return_value = status.error();
+      return;
+    }
+
+    receive_lock.lock();
+    receive_condition_.wait(receive_lock, [&complete] { return complete; });
+  }
+
+  // Sends the current batch, if it holds any calls.
+  Status<void> Flush() {
+    std::vector<Completion> cancelled;
+    std::unique_lock<std::mutex> send_lock{send_mutex_};
+    auto status = FlushBatch(&cancelled);
+    send_lock.unlock();
+
+    if (!status)
+      CompleteCancelled(&cancelled, status.error());
+    return status;
+  }
+
+  // Sends the current batch if its oldest call has waited at least as long as
+  // the max_delay limit.
+  Status<void> FlushIfDue() {
+    std::vector<Completion> cancelled;
+    std::unique_lock<std::mutex> send_lock{send_mutex_};
+    if (batch_ids_.empty() ||
+        std::chrono::steady_clock::now() - batch_start_ < limits_.max_delay) {
+      return {};
+    }
+
+    auto status = FlushBatch(&cancelled);
+    send_lock.unlock();
+
+    if (!status)
+      CompleteCancelled(&cancelled, status.error());
+    return status;
+  }
+
+  // Reads one response frame from the deserializer and completes the calls
+  // whose return values it holds, along with the calls in the matching
+  // request frame that it does not answer. Waits while another thread is
+  // reading a response frame. Returns ErrorStatus::ProtocolError if a request
+  // id does not match a call in flight.
+  Status<void> ReceiveReturn() {
+    std::unique_lock<std::mutex> receive_lock{receive_mutex_};
+    receive_condition_.wait(receive_lock, [this] { return !receiving_; });
+    return ReceiveFrame(&receive_lock);
+  }
+
+  // Completes every call in flight with |error|, for example when the channel
+  // is closed. Calls that have not been flushed are discarded.
+  void CancelPending(ErrorStatus error) {
+    {
+      std::lock_guard<std::mutex> send_lock{send_mutex_};
+      batch_.clear();
+      batch_ids_.clear();
+      frames_.clear();
+    }
+    pending_.CancelAll(error);
+  }
+
+  // Returns the number of calls in flight, including calls in the current
+  // batch.
+  std::size_t pending_count() const { return pending_.size(); }
+
+  // Returns the number of calls in the current batch.
+  std::size_t batch_count() const {
+    std::lock_guard<std::mutex> send_lock{send_mutex_};
+    return batch_ids_.size();
+  }
+
+  const BatchLimits& limits() const { return limits_; }
+
+  const Serializer& serializer() const { return *serializer_; }
+  Serializer& serializer() { return *serializer_; }
+  const Deserializer& deserializer() const { return *deserializer_; }
+  Deserializer& deserializer() { return *deserializer_; }
+
+ private:
+  using FrameDeserializer = nop::Deserializer<BufferReader*>;
+  using Pending = detail::PendingCalls<FrameDeserializer>;
+  using Completion = typename Pending::Completion;
+
+  // Writes the current batch as one frame and starts a new batch. If the write
+  // fails the completions of the calls in the batch are moved to |cancelled|,
+  // to be completed with the error once send_mutex_ is released, except for
+  // |caller_id|, whose error is returned to its caller instead. Must be called
+  // with send_mutex_ held.
+  Status<void> FlushBatch(std::vector<Completion>* cancelled,
+                          RequestId caller_id = ~RequestId{0}) {
+    if (batch_ids_.empty())
+      return {};
+
+    auto status = serializer_->Write(batch_.data());
+    batch_.clear();
+
+    if (status) {
+      frames_.push_back(std::move(batch_ids_));
+    } else {
+      for (RequestId request_id : batch_ids_) {
+        Completion completion = pending_.Take(request_id);
+        if (completion && request_id != caller_id)
+          cancelled->push_back(std::move(completion));
+      }
+    }
+
+    batch_ids_.clear();
+    return status;
+  }
+
+  static void CompleteCancelled(std::vector<Completion>* cancelled,
+                                ErrorStatus error) {
+    for (Completion& completion : *cancelled)
+      completion(nullptr, error);
+    cancelled->clear();
+  }
+
+  // Reads one response frame as the only receiving thread. Must be called with
+  // |receive_lock| holding receive_mutex_ while no other thread is receiving;
+  // the lock is released while the frame is read and its calls completed.
+  Status<void> ReceiveFrame(std::unique_lock<std::mutex>* receive_lock) {
+    receiving_ = true;
+    receive_lock->unlock();
+
+    auto status = deserializer_->Read(&response_);
+    if (status) {
+      std::vector<RequestId> frame_ids;
+      {
+        std::lock_guard<std::mutex> send_lock{send_mutex_};
+        if (!frames_.empty()) {
+          frame_ids = std::move(frames_.front());
+          frames_.pop_front();
+        }
+      }
+
+      status = CompleteReturns();
+
+      // Calls the response did not answer were not dispatched by the receiver.
+      const ErrorStatus error =
+          status ? ErrorStatus::ProtocolError : status.error();
+      for (RequestId request_id : frame_ids)
+        pending_.Cancel(request_id, error);
+    }
+
+    receive_lock->lock();
+    receiving_ = false;
+    receive_condition_.notify_all();
+    return status;
+  }
+
+  // Completes the calls whose return values are held in response_.
+  Status<void> CompleteReturns() {
+    BufferReader reader{response_.data(), response_.size()};
+    FrameDeserializer deserializer{&reader};
+    while (reader.remaining() > 0) {
+      RequestId request_id = 0;
+      auto status = deserializer.Read(&request_id);
+      if (!status)
+        return status;
+
+      auto completion = pending_.Take(request_id);
+      if (!completion)
+        return ErrorStatus::ProtocolError;
+
+      status = completion(&deserializer, ErrorStatus::None);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  Serializer* serializer_;
+  Deserializer* deserializer_;
+  const BatchLimits limits_;
+
+  mutable std::mutex send_mutex_;
+  RequestId next_request_id_{0};
+  VectorWriter batch_;
+  nop::Serializer<VectorWriter*> batch_serializer_;
+  std::vector<RequestId> batch_ids_;
+  std::chrono::steady_clock::time_point batch_start_;
+  std::deque<std::vector<RequestId>> frames_;
+
+  std::mutex receive_mutex_;
+  std::condition_variable receive_condition_;
+  bool receiving_{false};
+  std::vector<std::uint8_t> response_;
+
+  Pending pending_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_BATCHING_METHOD_SENDER_H_
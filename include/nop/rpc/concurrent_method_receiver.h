@@ -0,0 +1,145 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_CONCURRENT_METHOD_RECEIVER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_CONCURRENT_METHOD_RECEIVER_H_
+
+#include <cstdint>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+#include <nop/rpc/interface.h>
+#include <nop/status.h>
+#include <nop/utility/work_stealing_pool.h>
+
+namespace nop {
+
+// ConcurrentMethodReceiver is a Receiver type that runs interface method
+// handlers on a WorkStealingPool, so that slow handlers do not hold up the
+// other calls on a channel. The wire format is the same as that of
+// PipelinedMethodReceiver: every call is preceded by a request id, which is
+// echoed before its return value so that a PipelinedMethodSender can match
+// return values that arrive out of order.
+//
+// Dispatch() is called on a single I/O thread. It reads the method selector
+// and arguments of the next call and submits the bound handler to the pool.
+// The handler writes its return value through the serializer with a lock held,
+// so return values are written one at a time in the order the handlers finish.
+// Handlers may run concurrently with each other and must be thread safe.
+//
+// The bindings, passthrough arguments, serializer, and this receiver must
+// outlive every call submitted to the pool; WorkStealingPool::Wait() may be
+// used to wait for them to finish.
+template <typename Serializer, typename Deserializer>
+class ConcurrentMethodReceiver {
+ public:
+  // Type of the id used to match return values to calls.
+  using RequestId = std::uint64_t;
+
+  ConcurrentMethodReceiver(Serializer* serializer, Deserializer* deserializer,
+                           WorkStealingPool* pool)
+      : serializer_{serializer}, deserializer_{deserializer}, pool_{pool} {}
+
+  ConcurrentMethodReceiver(const ConcurrentMethodReceiver&) = delete;
+  void operator=(const ConcurrentMethodReceiver&) = delete;
+
+  // Reads the next call and submits its handler from |bindings| to the pool.
+  // Errors reading the call are returned; errors sending the return value from
+  // the pool are reported by status().
+  template <typename Bindings, typename... Args>
+  Status<void> Dispatch(const Bindings& bindings, Args&&... args) {
+    auto call = bindings.Defer(this, std::forward<Args>(args)...);
+    if (!call)
+      return call.error();
+
+    pool_->Submit([this, call = call.take()] {
+      auto status = call();
+      if (!status)
+        SetError(status.error());
+    });
+    return {};
+  }
+
+  template <typename MethodSelector>
+  Status<void> GetMethodSelector(MethodSelector* method_selector) {
+    auto status = deserializer_->Read(&request_id_);
+    if (!status)
+      return status;
+
+    return deserializer_->Read(method_selector);
+  }
+
+  template <typename... Args>
+  Status<void> GetArgs(std::tuple<Args...>* args) {
+    return deserializer_->Read(args);
+  }
+
+  // Returns the request id of the call most recently read.
+  RequestId request_id() const { return request_id_; }
+
+  // Sends the return value of the call with the given request id.
+  template <typename Return>
+  Status<void> SendReturn(RequestId request_id, const Return& return_value) {
+    std::lock_guard<std::mutex> lock{send_mutex_};
+    auto status = serializer_->Write(request_id);
+    if (!status)
+      return status;
+
+    return serializer_->Write(return_value);
+  }
+
+  // Sends the return value of the call most recently read, for synchronous
+  // dispatch on the I/O thread.
+  template <typename Return>
+  Status<void> SendReturn(const Return& return_value) {
+    return SendReturn(request_id_, return_value);
+  }
+
+  // Returns the first error encountered sending a return value, if any.
+  Status<void> status() const {
+    std::lock_guard<std::mutex> lock{error_mutex_};
+    if (error_ != ErrorStatus::None)
+      return error_;
+    else
+      return {};
+  }
+
+  const Serializer& serializer() const { return *serializer_; }
+  Serializer& serializer() { return *serializer_; }
+  const Deserializer& deserializer() const { return *deserializer_; }
+  Deserializer& deserializer() { return *deserializer_; }
+
+ private:
+  void SetError(ErrorStatus error) {
+    std::lock_guard<std::mutex> lock{error_mutex_};
+    if (error_ == ErrorStatus::None)
+      error_ = error;
+  }
+
+  Serializer* serializer_;
+  Deserializer* deserializer_;
+  WorkStealingPool* pool_;
+  RequestId request_id_{0};
+
+  std::mutex send_mutex_;
+  mutable std::mutex error_mutex_;
+  ErrorStatus error_{ErrorStatus::None};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_CONCURRENT_METHOD_RECEIVER_H_
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_DETAIL_PENDING_CALLS_H_
+#define LIBNOP_INCLUDE_NOP_RPC_DETAIL_PENDING_CALLS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include <nop/status.h>
+
+namespace nop {
+namespace detail {
+
+// PendingCalls tracks the completion ops of the calls a sender has in flight,
+// keyed by request id. Each completion reads the return value of its call from
+// the given deserializer and passes it to the op, or passes an error when the
+// deserializer is nullptr. All members are thread safe.
+template <typename Deserializer>
+class PendingCalls {
+ public:
+  using RequestId = std::uint64_t;
+  using Completion = std::function<Status<void>(Deserializer*, ErrorStatus)>;
+
+  // Returns a completion that reads a value of type Return and passes the
+  // resulting Status<Return> to |op|.
+  template <typename Return, typename Op>
+  static Completion MakeCompletion(Op&& op) {
+    return Completion{CompletionOp<Return, std::decay_t<Op>>{
+        std::forward<Op>(op)}};
+  }
+
+  void Add(RequestId request_id, Completion completion) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    pending_.emplace(request_id, std::move(completion));
+  }
+
+  // Removes and returns the completion for |request_id|, or an empty
+  // completion if there is no such call in flight.
+  Completion Take(RequestId request_id) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto search = pending_.find(request_id);
+    if (search == pending_.end())
+      return {};
+
+    Completion completion = std::move(search->second);
+    pending_.erase(search);
+    return completion;
+  }
+
+  // Completes the call with |request_id|, if it is in flight, with |error|.
+  void Cancel(RequestId request_id, ErrorStatus error) {
+    Completion completion = Take(request_id);
+    if (completion)
+      completion(nullptr, error);
+  }
+
+  // Completes every call in flight with |error|.
+  void CancelAll(ErrorStatus error) {
+    std::unordered_map<RequestId, Completion> pending;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      std::swap(pending, pending_);
+    }
+
+    for (auto& entry : pending)
+      entry.second(nullptr, error);
+  }
+
+  std::size_t size() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return pending_.size();
+  }
+
+ private:
+  template <typename Return, typename Op>
+  struct CompletionOp {
+    Op op;
+
+    Status<void> operator()(Deserializer* deserializer, ErrorStatus error) {
+      if (!deserializer) {
+        op(Status<Return>{error});
+        return {};
+      }
+
+      Return return_value;
+      auto status = deserializer->Read(&return_value);
+      if (!status)
+        op(Status<Return>{status.error()});
+      else
+        op(Status<Return>{std::move(return_value)});
+      return status;
+    }
+  };
+
+  template <typename Op>
+  struct CompletionOp<void, Op> {
+    Op op;
+
+    Status<void> operator()(Deserializer* deserializer, ErrorStatus error) {
+      if (!deserializer)
+        op(Status<void>{error});
+      else
+        op(Status<void>{});
+      return {};
+    }
+  };
+
+  mutable std::mutex mutex_;
+  std::unordered_map<RequestId, Completion> pending_;
+};
+
+}  // namespace detail
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_DETAIL_PENDING_CALLS_H_
@@ -0,0 +1,452 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_EPOLL_SERVER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_EPOLL_SERVER_H_
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <nop/base/serializer.h>
+#include <nop/rpc/simple_method_receiver.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/frame_reader.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+// Options for EpollServer.
+struct EpollServerOptions {
+  // Number of event loop threads.
+  std::size_t thread_count{1};
+
+  // Gives each event loop thread its own listening socket bound with
+  // SO_REUSEPORT so that the kernel shards incoming connections across the
+  // threads. Otherwise the threads share one listening socket.
+  bool reuse_port{true};
+
+  // Number of response bytes that may be queued for a connection before the
+  // server stops reading requests from it until the peer catches up.
+  std::size_t max_output_bytes{1024 * 1024};
+
+  // Initial size of the read buffer of each connection and the size of the
+  // largest request frame accepted.
+  std::size_t read_buffer_size{4096};
+  std::size_t max_frame_size{FrameReader::DefaultMaxFrameSize};
+
+  int backlog{SOMAXCONN};
+};
+
+// EpollServer is a reference server transport for remote interfaces that
+// serves many connections from a small number of epoll event loop threads.
+// Each request is a frame, as written by FrameWriter, holding a method
+// selector and argument tuple, which is dispatched through the given
+// InterfaceBindings with SimpleMethodReceiver; the return value is queued as a
+// response frame. FramedMethodSender is a matching client.
+//
+// Connections are non-blocking and edge triggered: every readable event reads
+// until the socket is drained, dispatching each complete frame from one bulk
+// read, and responses are written until the socket is full. A connection with
+// more than max_output_bytes of queued responses is not read again until its
+// output drains, which pushes back on clients that do not read responses.
+//
+// Connections are closed on malformed frames, unknown methods, and I/O errors.
+// Handlers run on the event loop threads and must be thread safe when there is
+// more than one thread. The bindings must outlive the server.
+//
+// Example:
+//
+//  auto bindings = BindInterface(Service::Sum::Bind(&Sum));
+//  EpollServer<decltype(bindings)> server{&bindings, options};
+//  sockaddr_in address{};
+//  address.sin_family = AF_INET;
+//  address.sin_port = htons(8000);
+//  auto status = server.Listen(reinterpret_cast<sockaddr*>(&address),
+//                              sizeof(address));
+//  if (status)
+//    status = server.Start();
+//
+template <typename Bindings>
+class EpollServer {
+ public:
+  EpollServer(const Bindings* bindings, EpollServerOptions options = {})
+      : bindings_{bindings}, options_{options} {
+    if (options_.thread_count == 0)
+      options_.thread_count = 1;
+  }
+
+  EpollServer(const EpollServer&) = delete;
+  void operator=(const EpollServer&) = delete;
+
+  ~EpollServer() {
+    Stop();
+    for (int fd : listen_fds_)
+      ::close(fd);
+  }
+
+  // Creates the listening sockets and binds them to |address|. When the port
+  // of |address| is zero the first socket picks a port and the others, if
+  // any, bind to the same port.
+  Status<void> Listen(const sockaddr* address, socklen_t address_size) {
+    sockaddr_storage storage{};
+    if (address_size > sizeof(storage))
+      return ErrorStatus::SystemError;
+    std::memcpy(&storage, address, address_size);
+
+    const std::size_t count = options_.reuse_port ? options_.thread_count : 1;
+    for (std::size_t i = 0; i < count; i++) {
+      const int fd = ::socket(storage.ss_family,
+                              SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      if (fd < 0)
+        return ErrorStatus::SystemError;
+      listen_fds_.push_back(fd);
+
+      const int enable = 1;
+      if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable,
+                       sizeof(enable)) < 0) {
+        return ErrorStatus::SystemError;
+      }
+      if (options_.reuse_port && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT,
+                                              &enable, sizeof(enable)) < 0) {
+        return ErrorStatus::SystemError;
+      }
+
+      if (::bind(fd, reinterpret_cast<const sockaddr*>(&storage),
+                 address_size) < 0) {
+        return ErrorStatus::SystemError;
+      }
+      if (::listen(fd, options_.backlog) < 0)
+        return ErrorStatus::SystemError;
+
+      // Bind the remaining sockets to the port chosen for the first one.
+      socklen_t bound_size = sizeof(storage);
+      if (::getsockname(fd, reinterpret_cast<sockaddr*>(&storage),
+                        &bound_size) < 0) {
+        return ErrorStatus::SystemError;
+      }
+    }
+
+    return {};
+  }
+
+  // Returns the port the listening sockets are bound to.
+  Status<std::uint16_t> port() const {
+    if (listen_fds_.empty())
+      return ErrorStatus::SystemError;
+
+    sockaddr_storage storage{};
+    socklen_t size = sizeof(storage);
+    if (::getsockname(listen_fds_[0], reinterpret_cast<sockaddr*>(&storage),
+                      &size) < 0) {
+      return ErrorStatus::SystemError;
+    }
+
+    if (storage.ss_family == AF_INET)
+      return ntohs(reinterpret_cast<sockaddr_in*>(&storage)->sin_port);
+    else if (storage.ss_family == AF_INET6)
+      return ntohs(reinterpret_cast<sockaddr_in6*>(&storage)->sin6_port);
+    else
+      return ErrorStatus::SystemError;
+  }
+
+  // Starts the event loop threads. Listen() must have succeeded.
+  Status<void> Start() {
+    if (listen_fds_.empty() || !threads_.empty())
+      return ErrorStatus::SystemError;
+
+    const bool shared = listen_fds_.size() < options_.thread_count;
+    for (std::size_t i = 0; i < options_.thread_count; i++) {
+      const int listen_fd = listen_fds_[shared ? 0 : i];
+      std::unique_ptr<Loop> loop{new Loop{this, listen_fd}};
+      auto status = loop->Init(shared);
+      if (!status) {
+        Stop();
+        return status;
+      }
+      loops_.push_back(std::move(loop));
+    }
+
+    for (auto& loop : loops_)
+      threads_.emplace_back([&loop] { loop->Run(); });
+    return {};
+  }
+
+  // Stops the event loop threads and closes every connection.
+  void Stop() {
+    for (auto& loop : loops_)
+      loop->Stop();
+    for (auto& thread : threads_)
+      thread.join();
+
+    threads_.clear();
+    loops_.clear();
+  }
+
+ private:
+  struct Connection {
+    Connection(int fd, const EpollServerOptions& options)
+        : fd{fd}, input{options.read_buffer_size, options.max_frame_size} {}
+
+    std::size_t pending_output() const { return output.size() - offset; }
+
+    int fd;
+    FrameReader input;
+    VectorWriter output;
+    std::size_t offset{0};
+    bool paused{false};
+  };
+
+  class Loop {
+   public:
+    Loop(EpollServer* server, int listen_fd)
+        : server_{server}, listen_fd_{listen_fd} {}
+
+    Loop(const Loop&) = delete;
+    void operator=(const Loop&) = delete;
+
+    ~Loop() {
+      for (auto& entry : connections_)
+        ::close(entry.first->fd);
+      if (stop_fd_ >= 0)
+        ::close(stop_fd_);
+      if (epoll_fd_ >= 0)
+        ::close(epoll_fd_);
+    }
+
+    Status<void> Init(bool shared_listener) {
+      epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+      if (epoll_fd_ < 0)
+        return ErrorStatus::SystemError;
+
+      stop_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (stop_fd_ < 0)
+        return ErrorStatus::SystemError;
+
+      // Wake only one loop per connection when the listener is shared.
+      std::uint32_t listen_events = EPOLLIN;
+      if (shared_listener)
+        listen_events |= EPOLLEXCLUSIVE;
+      auto status = Add(listen_fd_, &listen_fd_, listen_events);
+      if (!status)
+        return status;
+
+      return Add(stop_fd_, &stop_fd_, EPOLLIN);
+    }
+
+    void Stop() {
+      const std::uint64_t value = 1;
+      if (::write(stop_fd_, &value, sizeof(value)) < 0) {
+        // The counter can only overflow if Stop() is called 2^64 times.
+      }
+    }
+
+    void Run() {
+      epoll_event events[kMaxEvents];
+      while (true) {
+        const int count = ::epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+        if (count < 0 && errno == EINTR)
+          continue;
+        else if (count < 0)
+          return;
+
+        for (int i = 0; i < count; i++) {
+          void* source = events[i].data.ptr;
+          if (source == &stop_fd_) {
+            return;
+          } else if (source == &listen_fd_) {
+            Accept();
+          } else {
+            Connection* connection = static_cast<Connection*>(source);
+            if ((events[i].events & EPOLLERR) || !Service(connection))
+              Close(connection);
+          }
+        }
+      }
+    }
+
+   private:
+    enum : int { kMaxEvents = 64 };
+
+    Status<void> Add(int fd, void* source, std::uint32_t events) {
+      epoll_event event{};
+      event.events = events;
+      event.data.ptr = source;
+      if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0)
+        return ErrorStatus::SystemError;
+      else
+        return {};
+    }
+
+    void Accept() {
+      while (true) {
+        const int fd = ::accept4(listen_fd_, nullptr, nullptr,
+                                 SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0 && errno == EINTR)
+          continue;
+        else if (fd < 0)
+          return;  // Drained, or out of descriptors until a connection closes.
+
+        // Responses are small and written as soon as they are ready, so avoid
+        // delaying them behind unacknowledged data. This fails harmlessly on
+        // sockets that are not TCP.
+        const int enable = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        std::unique_ptr<Connection> connection{
+            new Connection{fd, server_->options_}};
+        auto status = Add(fd, connection.get(),
+                          EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+        if (!status) {
+          ::close(fd);
+          continue;
+        }
+
+        Connection* key = connection.get();
+        connections_.emplace(key, std::move(connection));
+      }
+    }
+
+    void Close(Connection* connection) {
+      ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection->fd, nullptr);
+      ::close(connection->fd);
+      connections_.erase(connection);
+    }
+
+    // Writes queued responses, dispatches buffered requests, and reads until
+    // the socket is drained or the connection is paused. Returns false when
+    // the connection should be closed.
+    bool Service(Connection* connection) {
+      if (!WriteOutput(connection))
+        return false;
+
+      if (connection->paused) {
+        if (connection->pending_output() > server_->options_.max_output_bytes)
+          return true;
+        connection->paused = false;
+      }
+
+      while (true) {
+        if (!DispatchFrames(connection))
+          return false;
+        else if (connection->paused)
+          break;
+
+        auto read = connection->input.ReadFrom(connection->fd);
+        if (!read) {
+          // Send what can be sent of the responses to a peer that has shut
+          // down its end of the connection.
+          WriteOutput(connection);
+          return false;
+        } else if (read.get() == 0) {
+          break;
+        }
+      }
+
+      return WriteOutput(connection);
+    }
+
+    // Dispatches each complete request frame in the read buffer, pausing the
+    // connection if too many response bytes are queued and the socket is full.
+    bool DispatchFrames(Connection* connection) {
+      using RequestDeserializer = Deserializer<BufferReader*>;
+      using ResponseSerializer = FrameWriter<VectorWriter>;
+
+      while (!connection->paused) {
+        BufferReader frame;
+        auto next = connection->input.NextFrame(&frame);
+        if (!next)
+          return false;
+        else if (!next.get())
+          return true;
+
+        RequestDeserializer deserializer{&frame};
+        ResponseSerializer serializer{&connection->output};
+        SimpleMethodReceiver<ResponseSerializer, RequestDeserializer> receiver{
+            &serializer, &deserializer};
+        auto status = (*server_->bindings_)(&receiver);
+        if (!status)
+          return false;
+
+        // Stop reading only when the responses cannot be sent as fast as the
+        // requests arrive; the next writable event resumes the connection.
+        if (connection->pending_output() > server_->options_.max_output_bytes) {
+          if (!WriteOutput(connection))
+            return false;
+          if (connection->pending_output() >
+              server_->options_.max_output_bytes) {
+            connection->paused = true;
+          }
+        }
+      }
+
+      return true;
+    }
+
+    // Writes queued responses until they are sent or the socket is full.
+    bool WriteOutput(Connection* connection) {
+      const std::uint8_t* data = connection->output.data().data();
+      while (connection->pending_output() > 0) {
+        const ssize_t ret =
+            ::send(connection->fd, data + connection->offset,
+                   connection->pending_output(), MSG_NOSIGNAL);
+        if (ret > 0)
+          connection->offset += ret;
+        else if (ret < 0 && errno == EINTR)
+          continue;
+        else if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+          return true;
+        else
+          return false;
+      }
+
+      connection->output.clear();
+      connection->offset = 0;
+      return true;
+    }
+
+    EpollServer* server_;
+    int listen_fd_;
+    int epoll_fd_{-1};
+    int stop_fd_{-1};
+    std::unordered_map<Connection*, std::unique_ptr<Connection>> connections_;
+  };
+
+  const Bindings* bindings_;
+  EpollServerOptions options_;
+  std::vector<int> listen_fds_;
+  std::vector<std::unique_ptr<Loop>> loops_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_EPOLL_SERVER_H_
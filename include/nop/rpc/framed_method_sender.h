@@ -0,0 +1,139 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_FRAMED_METHOD_SENDER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_FRAMED_METHOD_SENDER_H_
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/frame_reader.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+// FramedMethodSender is a Sender type for servers that use the frame format of
+// FrameWriter and FrameReader, such as EpollServer. Each call is written as
+// one frame holding the method selector and argument tuple, with a single
+// write, and the return value is read from the next response frame.
+//
+// The sender performs blocking I/O on the given socket, which it does not own.
+class FramedMethodSender {
+ public:
+  explicit FramedMethodSender(int fd) : fd_{fd} {}
+
+  FramedMethodSender(const FramedMethodSender&) = delete;
+  void operator=(const FramedMethodSender&) = delete;
+
+  template <typename MethodSelector, typename Return, typename... Args>
+  void SendMethod(MethodSelector method_selector, Status<Return>* return_value,
+                  const std::tuple<Args...>& args) {
+    payload_.clear();
+    Serializer<VectorWriter*> serializer{&payload_};
+    auto status = serializer.Write(method_selector);
+    if (status)
+      status = serializer.Write(args);
+    if (status)
+      status = SendFrame();
+    if (!status) {
+      *return_value = status.error();
+      return;
+    }
+
+    GetReturn(return_value);
+  }
+
+  int fd() const { return fd_; }
+
+ private:
+  Status<void> SendFrame() {
+    frame_.clear();
+    FrameWriter<VectorWriter> frame_writer{&frame_};
+    const std::uint8_t* begin = payload_.data().data();
+    auto status = frame_writer.WriteFrame(begin, begin + payload_.size());
+    if (!status)
+      return status;
+
+    std::size_t offset = 0;
+    while (offset < frame_.size()) {
+      const ssize_t ret = ::send(fd_, frame_.data().data() + offset,
+                                 frame_.size() - offset, MSG_NOSIGNAL);
+      if (ret > 0)
+        offset += ret;
+      else if (ret < 0 && errno == EINTR)
+        continue;
+      else
+        return ErrorStatus::IOError;
+    }
+
+    return {};
+  }
+
+  Status<void> ReceiveFrame(BufferReader* frame) {
+    while (true) {
+      auto next = frames_.NextFrame(frame);
+      if (!next)
+        return next.error();
+      else if (next.get())
+        return {};
+
+      auto read = frames_.ReadFrom(fd_);
+      if (!read)
+        return read.error();
+      else if (read.get() == 0)
+        return ErrorStatus::IOError;  // The socket must be blocking.
+    }
+  }
+
+  template <typename Return>
+  void GetReturn(Status<Return>* return_status) {
+    BufferReader frame;
+    auto status = ReceiveFrame(&frame);
+    if (!status) {
+      *return_status = status.error();
+      return;
+    }
+
+    Return return_value;
+    Deserializer<BufferReader*> deserializer{&frame};
+    status = deserializer.Read(&return_value);
+    if (!status)
+      *return_status = status.error();
+    else
+      *return_status = std::move(return_value);
+  }
+
+  void GetReturn(Status<void>* return_status) { *return_status = {}; }
+
+  int fd_;
+  VectorWriter payload_;
+  VectorWriter frame_;
+  FrameReader frames_{4096};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_FRAMED_METHOD_SENDER_H_
@@ -17,21 +17,32 @@
 #ifndef LIBNOP_INCLUDE_NOP_RPC_INTERFACE_H_
 #define LIBNOP_INCLUDE_NOP_RPC_INTERFACE_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <nop/base/encoding.h>
 #include <nop/base/members.h>
+#include <nop/base/tracepoints.h>
 #include <nop/base/tuple.h>
 #include <nop/base/utility.h>
 #include <nop/traits/function_traits.h>
 #include <nop/types/variant.h>
+#include <nop/utility/key_index_map.h>
 #include <nop/utility/sip_hash.h>
 
 namespace nop {
 
+// A method call whose arguments have been read from a receiver but whose
+// handler has not run yet, as returned by InterfaceBindings::Defer(). Invoking
+// it runs the handler and sends the return value through the receiver.
+using DeferredMethodCall = std::function<Status<void>()>;
+
 // InterfaceMethod captures the function signature and selector id of a method
 // in a remote interface. The signature describes the protocol to use when
 // serializing the method for RPC invocation and deserializing the return value.
@@ -51,8 +62,12 @@ namespace nop {
 // the remote method. The return type of these bind methods are primarly useful
 // as arguments to the BindInterface function, which collects a group of
 // bindings into an instance of the InterfaceBindings class to handle dispatch.
+//
+// The optional Name type provides the name of the method through a static
+// Get() function, as generated by NOP_METHOD(). The name is informational only
+// and does not affect the selector or the wire format.
 template <typename MethodSelector_, MethodSelector_ Selector_,
-          typename Signature>
+          typename Signature, typename Name = void>
 struct InterfaceMethod {
   // Enforce that the MethodSelector type is integral.
   static_assert(std::is_integral<MethodSelector_>::value,
@@ -94,6 +109,10 @@ struct InterfaceMethod {
     return method_selector == Selector;
   }
 
+  // Returns the name of this interface method, or an empty string if the
+  // method was defined without a name.
+  static constexpr const char* GetName() { return NameHelper<Name>::Get(); }
+
   // Invokes this interface method using the given sender and arguments.
   template <typename Sender, typename... Args,
             typename Return = typename InterfaceTraits::Return>
@@ -107,6 +126,20 @@ struct InterfaceMethod {
     return return_value;
   }
 
+  // Invokes this interface method asynchronously using the given sender and
+  // arguments. The sender invokes |op| with the Status<Return> of the call when
+  // the return value arrives; the result of this method only indicates whether
+  // the call was sent. The sender must support asynchronous calls, such as
+  // PipelinedMethodSender.
+  template <typename Sender, typename Op, typename... Args,
+            typename Return = typename InterfaceTraits::Return>
+  static EnableIfConforming<Return(Args...),
+                            Status<typename Sender::RequestId>>
+  InvokeAsync(Sender* sender, Op&& op, Args&&... args) {
+    return Helper<ConformingSignature<Return(Args...)>>::InvokeAsync(
+        sender, std::forward<Op>(op), std::forward<Args>(args)...);
+  }
+
   template <typename Sender, typename Return, typename... Args>
   static EnableIfConforming<Return(Args...), Status<void>> Invoke(
       Sender* sender, Return* return_value, Args&&... args) {
@@ -176,6 +209,17 @@ struct InterfaceMethod {
       return Helper<typename FunctionTraits<Op>::Signature>::Dispatch(
           receiver, op, std::forward<Passthrough>(passthrough)...);
     }
+
+    // Deserializes the protocol arguments using the given receiver and returns
+    // a call that executes the handler and sends its return value later,
+    // possibly on another thread. The passthrough arguments are captured by
+    // value.
+    template <typename Receiver, typename... Passthrough>
+    Status<DeferredMethodCall> Defer(Receiver* receiver,
+                                     Passthrough&&... passthrough) const {
+      return Helper<typename FunctionTraits<Op>::Signature>::Defer(
+          receiver, op, std::forward<Passthrough>(passthrough)...);
+    }
   };
 
   // Nested type that holds a method pointer handler for receiver-side dispatch
@@ -205,6 +249,18 @@ struct InterfaceMethod {
           receiver, instance, method,
           std::forward<Passthrough>(passthrough)...);
     }
+
+    // Deserializes the protocol arguments using the given receiver and returns
+    // a call that executes the handler and sends its return value later,
+    // possibly on another thread. The passthrough arguments are captured by
+    // value.
+    template <typename Receiver, typename... Passthrough>
+    Status<DeferredMethodCall> Defer(Receiver* receiver, Class* instance,
+                                     Passthrough&&... passthrough) const {
+      return Helper<typename FunctionTraits<Method>::Signature>::Defer(
+          receiver, instance, method,
+          std::forward<Passthrough>(passthrough)...);
+    }
   };
 
   // Returns an instance of Binding holding the given callable object.
@@ -229,6 +285,16 @@ struct InterfaceMethod {
   }
 
  private:
+  // Resolves the name of the method from the optional Name type.
+  template <typename NameType, typename Enabled = void>
+  struct NameHelper {
+    static constexpr const char* Get() { return NameType::Get(); }
+  };
+  template <typename Enabled>
+  struct NameHelper<void, Enabled> {
+    static constexpr const char* Get() { return ""; }
+  };
+
   // Base type for the helper below.
   template <typename>
   struct Helper;
@@ -248,6 +314,16 @@ struct InterfaceMethod {
                                   std::forward_as_tuple(args...));
     }
 
+    // Invokes the remote method asynchronously using the given sender.
+    template <typename Sender, typename Op>
+    static Status<typename Sender::RequestId> InvokeAsync(Sender* sender,
+                                                          Op&& op,
+                                                          Args... args) {
+      return sender->template SendMethodAsync<Return>(
+          InterfaceMethod::Selector, std::forward_as_tuple(args...),
+          std::forward<Op>(op));
+    }
+
     // Dispatches the given handler op, getting the arguments from the given
     // receiver and passthough arguments and then passing the return value back
     // to the receiver.
@@ -285,8 +361,86 @@ struct InterfaceMethod {
       return receiver->SendReturn(return_value);
     }
 
+    // Gets the arguments for the given handler op from the given receiver and
+    // returns a call that invokes the handler with them and the passthrough
+    // arguments, passing the return value back to the receiver tagged with the
+    // request id of the call. The receiver must provide request_id() and
+    // SendReturn(request_id, return_value).
+    template <typename Receiver, typename Op, typename... Passthrough>
+    static Status<DeferredMethodCall> Defer(Receiver* receiver, const Op& op,
+                                            Passthrough&&... passthrough) {
+      auto args = std::make_shared<ArgsTuple>();
+      auto status = receiver->GetArgs(args.get());
+      if (!status)
+        return status.error();
+
+      const auto request_id = receiver->request_id();
+      auto passthrough_args =
+          std::make_shared<std::tuple<std::decay_t<Passthrough>...>>(
+              std::forward<Passthrough>(passthrough)...);
+      return DeferredMethodCall{
+          [receiver, &op, args, passthrough_args, request_id] {
+            Return return_value{
+                CallDeferred(op, args.get(), passthrough_args.get(),
+                             std::index_sequence_for<Passthrough...>{})};
+            return receiver->SendReturn(request_id, return_value);
+          }};
+    }
+
+    // Gets the arguments for the given handler method from the given receiver
+    // and returns a call that invokes the method on |instance| later.
+    template <typename Receiver, typename Class, typename Op,
+              typename... Passthrough>
+    static Status<DeferredMethodCall> Defer(Receiver* receiver,
+                                            Class* instance, const Op& op,
+                                            Passthrough&&... passthrough) {
+      auto args = std::make_shared<ArgsTuple>();
+      auto status = receiver->GetArgs(args.get());
+      if (!status)
+        return status.error();
+
+      const auto request_id = receiver->request_id();
+      auto passthrough_args =
+          std::make_shared<std::tuple<std::decay_t<Passthrough>...>>(
+              std::forward<Passthrough>(passthrough)...);
+      return DeferredMethodCall{
+          [receiver, instance, &op, args, passthrough_args, request_id] {
+            Return return_value{
+                CallDeferred(instance, op, args.get(), passthrough_args.get(),
+                             std::index_sequence_for<Passthrough...>{})};
+            return receiver->SendReturn(request_id, return_value);
+          }};
+    }
+
+    // Helper functions to expand the captured passthrough arguments of a
+    // deferred call.
+    template <typename Op, typename PassthroughTuple, std::size_t... Ps>
+    static Return CallDeferred(const Op& op, ArgsTuple* args,
+                               PassthroughTuple* passthrough,
+                               std::index_sequence<Ps...>) {
+      // Silence compiler warning in case there are no passthrough arguments.
+      (void)passthrough;
+
+      return Call(op, args, std::make_index_sequence<sizeof...(Args)>{},
+                  std::get<Ps>(*passthrough)...);
+    }
+    template <typename Class, typename Op, typename PassthroughTuple,
+              std::size_t... Ps>
+    static Return CallDeferred(Class* instance, const Op& op, ArgsTuple* args,
+                               PassthroughTuple* passthrough,
+                               std::index_sequence<Ps...>) {
+      // Silence compiler warning in case there are no passthrough arguments.
+      (void)passthrough;
+
+      return Call(instance, op, args,
+                  std::make_index_sequence<sizeof...(Args)>{},
+                  std::get<Ps>(*passthrough)...);
+    }
+
     // Helper function to marshall passthough arguments and deserialized
-    // arugments to the given handler op.
+    // arugments to the given handler op. The deserialized arguments are moved
+    // out of the tuple, so handlers taking arguments by value or by rvalue
+    // reference do not copy them.
     template <typename Op, std::size_t... Is, typename... Passthrough>
     static Return Call(Op&& op, ArgsTuple* args, std::index_sequence<Is...>,
                        Passthrough&&... passthrough) {
@@ -367,12 +521,25 @@ struct Interface {
     return InterfaceType::GetName();
   }
 
+  // Returns the number of methods in the interface.
+  static constexpr std::size_t GetMethodCount() {
+    using InterfaceApiType = typename T::NOP__INTERFACE_API;
+    return InterfaceApiType::MethodCount;
+  }
+
   // Looks up the selector for a method in the interface by numeric index.
   template <std::size_t Index>
   static constexpr auto GetMethodSelector() {
     using InterfaceApiType = typename T::NOP__INTERFACE_API;
     return InterfaceApiType::template Method<Index>::Selector;
   }
+
+  // Looks up the name of a method in the interface by numeric index.
+  template <std::size_t Index>
+  static constexpr const char* GetMethodName() {
+    using InterfaceApiType = typename T::NOP__INTERFACE_API;
+    return InterfaceApiType::template Method<Index>::GetName();
+  }
 };
 
 // Utility type to capture the argument sequence that will be passed through
@@ -382,6 +549,10 @@ struct Interface {
 template <typename... Args>
 struct Passthrough {};
 
+// The maximum number of methods that may be given compact method ids. Ids up
+// to 127 encode in one byte and the rest in two. See nop/rpc/method_ids.h.
+enum : std::size_t { kMaxMethodIds = 256 };
+
 // Base type for InterfaceBindings dispatcher class.
 template <typename, typename...>
 class InterfaceBindings;
@@ -403,6 +574,13 @@ class InterfaceBindings<Passthrough<Args...>, Bindings...> {
   static_assert(IsSame<SameSelectorType, Bindings...>::value,
                 "Interface methods must have the same selector type.");
 
+  template <typename A, typename B>
+  using SameSelector =
+      std::integral_constant<bool, A::InterfaceMethodType::Selector ==
+                                       B::InterfaceMethodType::Selector>;
+  static_assert(IsUnique<SameSelector, Bindings...>::value,
+                "Interface methods must have unique selectors.");
+
  public:
   // The method selector type used by this dispatch table.
   using MethodSelector =
@@ -419,7 +597,7 @@ class InterfaceBindings<Passthrough<Args...>, Bindings...> {
   // Returns true if the given selector matches one of the interface methods
   // bound in this dispatch table.
   bool Match(MethodSelector method_selector) {
-    return MatchTable(method_selector, Index<sizeof...(Bindings)>{});
+    return FindBinding(method_selector) != Count;
   }
 
   // Attempts to dispatch one of the bound handlers with the given receiver and
@@ -433,56 +611,153 @@ class InterfaceBindings<Passthrough<Args...>, Bindings...> {
       return status.error();
 
     return DispatchTable(receiver, method_selector,
-                         Index<sizeof...(Bindings)>{},
+                         std::make_index_sequence<Count>{},
+                         std::forward<Args>(args)...);
+  }
+
+  // Reads the method selector and arguments of the next call from the given
+  // receiver and returns a call that runs the bound handler later, possibly on
+  // another thread. The passthrough args are captured by value and the
+  // bindings must outlive the returned call. If the selector does not match
+  // one of the bound methods ErrorStatus::InvalidInterfaceMethod is returned.
+  template <typename Receiver>
+  Status<DeferredMethodCall> Defer(Receiver* receiver, Args&&... args) const {
+    MethodSelector method_selector;
+    auto status = receiver->GetMethodSelector(&method_selector);
+    if (!status)
+      return status.error();
+
+    return DeferTable(receiver, method_selector,
+                      std::make_index_sequence<Count>{},
+                      std::forward<Args>(args)...);
+  }
+
+  // Returns the table of method ids of this dispatch table for the handshake
+  // of a connection that uses compact method ids. The id of each method is its
+  // position in the table, which lists the selectors in binding order.
+  static std::vector<MethodSelector> GetMethodIdTable() {
+    static_assert(static_cast<std::size_t>(Count) <=
+                      static_cast<std::size_t>(kMaxMethodIds),
+                  "Too many methods for compact method ids.");
+    return {static_cast<MethodSelector>(
+        Bindings::InterfaceMethodType::Selector)...};
+  }
+
+  // Attempts to dispatch one of the bound handlers like operator(), except
+  // that the receiver provides the compact method id negotiated from
+  // GetMethodIdTable() in place of the method selector. The id indexes the
+  // dispatch table directly. If the id is out of range
+  // ErrorStatus::InvalidInterfaceMethod is returned.
+  template <typename Receiver>
+  Status<void> DispatchById(Receiver* receiver, Args&&... args) const {
+    MethodSelector method_id;
+    auto status = receiver->GetMethodSelector(&method_id);
+    if (!status)
+      return status.error();
+
+    NOP_TRACE(dispatch_id, method_id);
+    return DispatchIndex(receiver, static_cast<std::size_t>(method_id),
+                         std::make_index_sequence<Count>{},
                          std::forward<Args>(args)...);
   }
 
+  // Reads a batch of calls from the given receiver, such as a
+  // BatchMethodReceiver, and dispatches them in order. The return values of
+  // the calls dispatched before any error are sent as one response, and the
+  // first error is returned. BatchingMethodSender completes the calls the
+  // response does not answer with ErrorStatus::ProtocolError. Each call
+  // receives its own copy of the passthrough args.
+  template <typename Receiver>
+  Status<void> DispatchBatch(Receiver* receiver, Args&&... args) const {
+    auto status = receiver->BeginBatch();
+    if (!status)
+      return status;
+
+    while (status && receiver->HasNextCall())
+      status = (*this)(receiver, static_cast<Args>(args)...);
+
+    auto end_status = receiver->EndBatch();
+    if (!status)
+      return status;
+    else
+      return end_status;
+  }
+
  private:
   // The bindings for each interface method in this dispatch table.
   std::tuple<Bindings...> bindings_;
 
-  // Looks up the binding type for a binding in this dispatch table by index.
-  template <std::size_t Index>
-  using At = typename std::tuple_element<Index, decltype(bindings_)>::type;
+  // Returns the index of the binding for the given method selector, or Count
+  // if the selector is not bound in this dispatch table. The selectors are
+  // sorted at compile time, so the lookup takes logarithmic time.
+  static std::size_t FindBinding(MethodSelector method_selector) {
+    static constexpr KeyIndexMap<MethodSelector, Count> kSelectorMap{
+        {static_cast<MethodSelector>(
+            Bindings::InterfaceMethodType::Selector)...}};
+    return kSelectorMap.Find(method_selector);
+  }
 
-  // Terminates recursion when searching for the given method selector. Reaching
-  // this function means the selector was not found in this dispatch table.
-  template <typename MethodSelector>
-  bool MatchTable(MethodSelector /*method_selector*/, Index<0>) const {
-    return false;
+  // Dispatches the binding at the given index.
+  template <std::size_t index, typename Receiver>
+  static Status<void> DispatchAt(const InterfaceBindings& self,
+                                 Receiver* receiver, Args&&... args) {
+    return std::get<index>(self.bindings_)
+        .Dispatch(receiver, std::forward<Args>(args)...);
   }
 
-  // Recurses through the bindings in this dispatch table looking for the given
-  // method selector.
-  template <typename MethodSelector, std::size_t index>
-  bool MatchTable(MethodSelector method_selector, Index<index>) const {
-    if (At<index - 1>::Match(method_selector))
-      return true;
+  // Looks up the binding for the given method selector and dispatches it
+  // through a table of per-binding functions.
+  template <typename Receiver, std::size_t... Is>
+  Status<void> DispatchTable(Receiver* receiver, MethodSelector method_selector,
+                             std::index_sequence<Is...> indices,
+                             Args&&... args) const {
+    const std::size_t index = FindBinding(method_selector);
+    NOP_TRACE(dispatch, method_selector, index);
+    return DispatchIndex(receiver, index, indices,
+                         std::forward<Args>(args)...);
+  }
+
+  // Dispatches the binding at the given index through a table of per-binding
+  // functions.
+  template <typename Receiver, std::size_t... Is>
+  Status<void> DispatchIndex(Receiver* receiver, std::size_t index,
+                             std::index_sequence<Is...>, Args&&... args) const {
+    using Thunk =
+        Status<void> (*)(const InterfaceBindings&, Receiver*, Args&&...);
+    static constexpr Thunk kDispatchers[] = {&DispatchAt<Is, Receiver>...};
+
+    if (index >= Count)
+      return ErrorStatus::InvalidInterfaceMethod;
     else
-      return MatchTable(method_selector, Index<index - 1>{});
+      return kDispatchers[index](*this, receiver, std::forward<Args>(args)...);
   }
 
-  // Terminates recursion when searching for the given method selector to
-  // dispatch.
-  template <typename Receiver, typename MethodSelector>
-  Status<void> DispatchTable(Receiver* /*receiver*/,
-                             MethodSelector /*method_selector*/, Index<0>,
-                             Args&&... /*args*/) const {
-    return ErrorStatus::InvalidInterfaceMethod;
+  // Defers the binding at the given index.
+  template <std::size_t index, typename Receiver>
+  static Status<DeferredMethodCall> DeferAt(const InterfaceBindings& self,
+                                            Receiver* receiver,
+                                            Args&&... args) {
+    return std::get<index>(self.bindings_)
+        .Defer(receiver, std::forward<Args>(args)...);
   }
 
-  // Recurses through the bindings in this dispatch table looking for the given
-  // method selector.
-  template <typename Receiver, typename MethodSelector, std::size_t index>
-  Status<void> DispatchTable(Receiver* receiver, MethodSelector method_selector,
-                             Index<index>, Args&&... args) const {
-    if (At<index - 1>::Match(method_selector)) {
-      return std::get<index - 1>(bindings_).Dispatch(
-          receiver, std::forward<Args>(args)...);
-    } else {
-      return DispatchTable(receiver, method_selector, Index<index - 1>{},
-                           std::forward<Args>(args)...);
-    }
+  // Looks up the binding for the given method selector and defers it through
+  // a table of per-binding functions.
+  template <typename Receiver, std::size_t... Is>
+  Status<DeferredMethodCall> DeferTable(Receiver* receiver,
+                                        MethodSelector method_selector,
+                                        std::index_sequence<Is...>,
+                                        Args&&... args) const {
+    using Thunk = Status<DeferredMethodCall> (*)(const InterfaceBindings&,
+                                                 Receiver*, Args&&...);
+    static constexpr Thunk kDeferrers[] = {&DeferAt<Is, Receiver>...};
+
+    const std::size_t index = FindBinding(method_selector);
+    NOP_TRACE(dispatch, method_selector, index);
+    if (index == Count)
+      return ErrorStatus::InvalidInterfaceMethod;
+    else
+      return kDeferrers[index](*this, receiver, std::forward<Args>(args)...);
   }
 };
 
@@ -565,10 +840,16 @@ inline constexpr MethodSelector ComputeMethodSelector(
                      #name, NOP__INTERFACE::Hash),                             \
                  name, __VA_ARGS__)
 
-// Defines a remote method with a manually specified method selector.
-#define NOP_METHOD_SEL(selector, name, ... /* signature */)           \
-  using name = ::nop::InterfaceMethod<NOP__INTERFACE::MethodSelector, \
-                                      selector, __VA_ARGS__>
+// Defines a remote method with a manually specified method selector. The name
+// of the method is captured by a nested type so that it is available at
+// runtime through InterfaceMethod::GetName().
+#define NOP_METHOD_SEL(selector, name, ... /* signature */)               \
+  struct NOP__METHOD_NAME_##name {                                        \
+    static constexpr const char* Get() { return #name; }                  \
+  };                                                                      \
+  using name =                                                            \
+      ::nop::InterfaceMethod<NOP__INTERFACE::MethodSelector, selector,    \
+                             __VA_ARGS__, NOP__METHOD_NAME_##name>
 
 // Defines the collection of remote methods that comprise the remote interface.
 // The arguments to this function must be the symbol names passed to
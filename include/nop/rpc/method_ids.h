@@ -0,0 +1,161 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_METHOD_IDS_H_
+#define LIBNOP_INCLUDE_NOP_RPC_METHOD_IDS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <nop/rpc/interface.h>
+#include <nop/status.h>
+#include <nop/types/flat_hash_map.h>
+
+namespace nop {
+
+//
+// Compact method ids.
+//
+// Method selectors are 64-bit hashes that take nine bytes to encode on every
+// call. Connections that make many small calls may instead negotiate dense ids
+// for the methods of an interface when they are established:
+//
+//  1. The receiving side sends the table returned by
+//     InterfaceBindings::GetMethodIdTable(), a std::vector of the selectors of
+//     its bound methods. The id of each method is its position in the table.
+//  2. The sending side reads the table into a MethodIds and sends calls
+//     through a CompactMethodSender, which writes the id of each method where
+//     the method selector would otherwise be.
+//  3. The receiving side dispatches calls with DispatchById() instead of
+//     operator() of InterfaceBindings, which indexes the dispatch table with
+//     the id.
+//
+// Ids below 128 encode in one byte and ids up to kMaxMethodIds in two. Both
+// sides must use the same bindings for the life of the connection; calls to
+// methods missing from the table fail with ErrorStatus::InvalidInterfaceMethod
+// without being sent.
+//
+// Example:
+//
+//  // Receiver, after accepting a connection.
+//  auto bindings = BindInterface(Service::Get::Bind(...), ...);
+//  status = serializer.Write(bindings.GetMethodIdTable());
+//  ...
+//  status = bindings.DispatchById(&receiver);
+//
+//  // Sender, after connecting.
+//  std::vector<std::uint64_t> table;
+//  status = deserializer.Read(&table);
+//  auto ids = MethodIds<std::uint64_t>::Create(std::move(table));
+//  CompactMethodSender<decltype(sender)> compact{&sender, &ids.get()};
+//  auto value = Service::Get::Invoke(&compact, key);
+//
+
+// Maps the method selectors in a table received during a handshake to their
+// compact method ids.
+template <typename MethodSelector>
+class MethodIds {
+  static_assert(std::is_integral<MethodSelector>::value,
+                "Method selector must be an integral type.");
+
+ public:
+  MethodIds() = default;
+  MethodIds(const MethodIds&) = default;
+  MethodIds(MethodIds&&) = default;
+  MethodIds& operator=(const MethodIds&) = default;
+  MethodIds& operator=(MethodIds&&) = default;
+
+  // Builds the map from the table of method selectors. Returns
+  // ErrorStatus::InvalidInterfaceMethod if the table lists a selector more
+  // than once or has more than kMaxMethodIds entries.
+  static Status<MethodIds> Create(std::vector<MethodSelector> selectors) {
+    if (selectors.size() > kMaxMethodIds)
+      return ErrorStatus::InvalidInterfaceMethod;
+
+    MethodIds method_ids;
+    method_ids.ids_.reserve(selectors.size());
+    for (std::size_t i = 0; i < selectors.size(); i++) {
+      if (!method_ids.ids_.emplace(selectors[i], static_cast<MethodSelector>(i))
+               .second) {
+        return ErrorStatus::InvalidInterfaceMethod;
+      }
+    }
+
+    method_ids.selectors_ = std::move(selectors);
+    return {std::move(method_ids)};
+  }
+
+  // Returns the id of the method with the given selector, or
+  // ErrorStatus::InvalidInterfaceMethod if the method is not in the table.
+  Status<MethodSelector> Find(MethodSelector method_selector) const {
+    auto search = ids_.find(method_selector);
+    if (search == ids_.end())
+      return ErrorStatus::InvalidInterfaceMethod;
+    else
+      return search->second;
+  }
+
+  // Returns the method selector with the given id.
+  MethodSelector selector(std::size_t method_id) const {
+    return selectors_[method_id];
+  }
+
+  bool empty() const { return selectors_.empty(); }
+  std::size_t size() const { return selectors_.size(); }
+  const std::vector<MethodSelector>& selectors() const { return selectors_; }
+
+ private:
+  std::vector<MethodSelector> selectors_;
+  FlatHashMap<MethodSelector, MethodSelector> ids_;
+};
+
+// CompactMethodSender is a Sender type that replaces the method selector of
+// each call with the compact method id negotiated in |method_ids| and passes
+// the call on to another Sender type, such as SimpleMethodSender. The other
+// sender and the ids must outlive this sender.
+template <typename Sender, typename MethodSelector = std::uint64_t>
+class CompactMethodSender {
+ public:
+  constexpr CompactMethodSender(Sender* sender,
+                                const MethodIds<MethodSelector>* method_ids)
+      : sender_{sender}, method_ids_{method_ids} {}
+
+  template <typename Return, typename... Args>
+  void SendMethod(MethodSelector method_selector, Status<Return>* return_value,
+                  const std::tuple<Args...>& args) {
+    auto method_id = method_ids_->Find(method_selector);
+    if (!method_id)
+      *return_value = method_id.error();
+    else
+      sender_->SendMethod(method_id.get(), return_value, args);
+  }
+
+  const Sender& sender() const { return *sender_; }
+  Sender& sender() { return *sender_; }
+  const MethodIds<MethodSelector>& method_ids() const { return *method_ids_; }
+
+ private:
+  Sender* sender_;
+  const MethodIds<MethodSelector>* method_ids_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_METHOD_IDS_H_
@@ -0,0 +1,579 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_METHOD_METRICS_H_
+#define LIBNOP_INCLUDE_NOP_RPC_METHOD_METRICS_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/rpc/interface.h>
+#include <nop/status.h>
+
+namespace nop {
+
+//
+// Per-method RPC metrics.
+//
+// MethodMetrics collects call counts, argument and return sizes, and latency
+// histograms for each remote method dispatched through an InstrumentedReceiver
+// or invoked through an InstrumentedSender. Instrumentation is opt-in: the
+// adapters wrap an existing receiver or sender, and code that does not use them
+// pays nothing.
+//
+// On the receiving side, passing an InstrumentedReceiver to
+// InterfaceBindings::operator() records three latencies per call: decoding the
+// arguments, running the handler, and encoding the return value. On the sending
+// side, wrapping a sender such as SimpleMethodSender records the round trip
+// latency of SendMethod(). Argument and return sizes are computed from the
+// values with Encoding<T>::Size().
+//
+// Each thread records into its own shard of counters without taking locks.
+// Snapshot() merges the shards and may be called at any time, including while
+// other threads are recording. Methods are keyed by selector; registering an
+// interface with RegisterInterface() attaches the names given to NOP_METHOD()
+// to the selectors of its methods.
+//
+// Example:
+//
+//   nop::MethodMetrics metrics;
+//   metrics.RegisterInterface<Calculator>();
+//
+//   auto receiver = nop::MakeInstrumentedReceiver(&simple_receiver, &metrics);
+//   while (bindings(&receiver))
+//     ;
+//
+//   for (const auto& method : metrics.Snapshot().methods)
+//     Log(method.name, method.calls, method.handler.Percentile(0.99));
+//
+
+namespace detail {
+class LatencyRecorder;
+}  // namespace detail
+
+// Histogram of latencies in nanoseconds. Values are counted in log-linear
+// buckets with eight sub-buckets per power of two, in the style of HDR
+// histograms, so that each bucket spans at most 12.5% of its lower bound.
+// Values of 2^40 nanoseconds (about 18 minutes) or more are counted in the last
+// bucket.
+class LatencyHistogram {
+ public:
+  enum : std::size_t {
+    kSubBucketBits = 3,
+    kSubBucketCount = std::size_t{1} << kSubBucketBits,
+    kMaxValueBits = 40,
+    kBucketCount = kSubBucketCount * (kMaxValueBits - kSubBucketBits + 1),
+  };
+
+  // Returns the index of the bucket that counts |value|.
+  static constexpr std::size_t BucketIndex(std::uint64_t value) {
+    if (value >= (std::uint64_t{1} << kMaxValueBits))
+      return kBucketCount - 1;
+
+    std::size_t shift = 0;
+    while ((value >> shift) >= 2 * kSubBucketCount)
+      shift++;
+    return kSubBucketCount * shift + static_cast<std::size_t>(value >> shift);
+  }
+
+  // Returns the smallest value counted by the bucket at |index|.
+  static constexpr std::uint64_t BucketLowerBound(std::size_t index) {
+    if (index < 2 * kSubBucketCount)
+      return index;
+
+    const std::size_t shift = index / kSubBucketCount - 1;
+    return static_cast<std::uint64_t>(index % kSubBucketCount +
+                                      kSubBucketCount)
+           << shift;
+  }
+
+  // Returns the largest value counted by the bucket at |index|.
+  static constexpr std::uint64_t BucketUpperBound(std::size_t index) {
+    return index + 1 < kBucketCount ? BucketLowerBound(index + 1) - 1
+                                    : ~std::uint64_t{0};
+  }
+
+  // Counts |value| in the histogram.
+  void Record(std::uint64_t value) {
+    buckets_[BucketIndex(value)]++;
+    count_++;
+    sum_ += value;
+    max_ = std::max(max_, value);
+  }
+
+  // Adds the counts of |other| to this histogram.
+  void Merge(const LatencyHistogram& other) {
+    for (std::size_t i = 0; i < kBucketCount; i++)
+      buckets_[i] += other.buckets_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+  }
+
+  // Returns the value at the given fraction of the recorded values, from 0.0
+  // for the smallest to 1.0 for the largest. The result is the upper bound of
+  // the bucket holding that value, limited to the largest recorded value.
+  // Returns zero if the histogram is empty.
+  std::uint64_t Percentile(double fraction) const {
+    if (count_ == 0)
+      return 0;
+
+    const double clamped = std::min(std::max(fraction, 0.0), 1.0);
+    std::uint64_t rank = static_cast<std::uint64_t>(clamped * count_);
+    if (rank == 0)
+      rank = 1;
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBucketCount; i++) {
+      seen += buckets_[i];
+      if (seen >= rank)
+        return std::min(BucketUpperBound(i), max_);
+    }
+    return max_;
+  }
+
+  // Returns the mean of the recorded values, or zero if there are none.
+  double mean() const {
+    return count_ == 0 ? 0.0 : static_cast<double>(sum_) / count_;
+  }
+
+  std::uint64_t count() const { return count_; }
+  std::uint64_t sum() const { return sum_; }
+  std::uint64_t max() const { return max_; }
+  std::uint64_t bucket(std::size_t index) const { return buckets_[index]; }
+
+ private:
+  friend class detail::LatencyRecorder;
+
+  std::array<std::uint64_t, kBucketCount> buckets_{};
+  std::uint64_t count_{0};
+  std::uint64_t sum_{0};
+  std::uint64_t max_{0};
+};
+
+// Metrics of a single remote method, as returned by MethodMetrics::Snapshot().
+// For dispatched calls |decode|, |handler|, and |encode| hold the latencies of
+// reading the arguments, running the handler, and writing the return value.
+// For sent calls |round_trip| holds the latency from sending the arguments to
+// receiving the return value. Byte counts are totals over all of the calls.
+struct MethodStatistics {
+  std::uint64_t selector{0};
+  std::string name;
+  std::uint64_t calls{0};
+  std::uint64_t errors{0};
+  std::uint64_t argument_bytes{0};
+  std::uint64_t return_bytes{0};
+  LatencyHistogram decode;
+  LatencyHistogram handler;
+  LatencyHistogram encode;
+  LatencyHistogram round_trip;
+};
+
+// Snapshot of the metrics of every method that has been registered or called,
+// sorted by selector.
+struct MethodMetricsSnapshot {
+  std::vector<MethodStatistics> methods;
+
+  // Returns the metrics of the method with the given selector, or nullptr if
+  // the method has not been registered or called.
+  const MethodStatistics* Find(std::uint64_t selector) const {
+    for (const auto& method : methods) {
+      if (method.selector == selector)
+        return &method;
+    }
+    return nullptr;
+  }
+
+  // Returns the metrics of the method with the given name, or nullptr if no
+  // registered method has the name.
+  const MethodStatistics* Find(const std::string& name) const {
+    for (const auto& method : methods) {
+      if (method.name == name)
+        return &method;
+    }
+    return nullptr;
+  }
+};
+
+namespace detail {
+
+// Adds |value| to a counter that only the calling thread modifies. The relaxed
+// load and store are cheaper than an atomic read-modify-write while still
+// allowing other threads to read the counter concurrently.
+inline void AddToCounter(std::atomic<std::uint64_t>* counter,
+                         std::uint64_t value) {
+  counter->store(counter->load(std::memory_order_relaxed) + value,
+                 std::memory_order_relaxed);
+}
+
+// Per-thread recorder for LatencyHistogram. Only the owning thread records;
+// any thread may load the counts into a histogram.
+class LatencyRecorder {
+ public:
+  void Record(std::uint64_t value) {
+    AddToCounter(&buckets_[LatencyHistogram::BucketIndex(value)], 1);
+    AddToCounter(&count_, 1);
+    AddToCounter(&sum_, value);
+    if (value > max_.load(std::memory_order_relaxed))
+      max_.store(value, std::memory_order_relaxed);
+  }
+
+  void MergeInto(LatencyHistogram* histogram) const {
+    for (std::size_t i = 0; i < LatencyHistogram::kBucketCount; i++)
+      histogram->buckets_[i] += buckets_[i].load(std::memory_order_relaxed);
+    histogram->count_ += count_.load(std::memory_order_relaxed);
+    histogram->sum_ += sum_.load(std::memory_order_relaxed);
+    histogram->max_ =
+        std::max(histogram->max_, max_.load(std::memory_order_relaxed));
+  }
+
+ private:
+  std::array<std::atomic<std::uint64_t>, LatencyHistogram::kBucketCount>
+      buckets_{};
+  std::atomic<std::uint64_t> count_{0};
+  std::atomic<std::uint64_t> sum_{0};
+  std::atomic<std::uint64_t> max_{0};
+};
+
+// Per-thread counters of a single method.
+struct MethodRecorder {
+  std::atomic<std::uint64_t> calls{0};
+  std::atomic<std::uint64_t> errors{0};
+  std::atomic<std::uint64_t> argument_bytes{0};
+  std::atomic<std::uint64_t> return_bytes{0};
+  LatencyRecorder decode;
+  LatencyRecorder handler;
+  LatencyRecorder encode;
+  LatencyRecorder round_trip;
+
+  void MergeInto(MethodStatistics* statistics) const {
+    statistics->calls += calls.load(std::memory_order_relaxed);
+    statistics->errors += errors.load(std::memory_order_relaxed);
+    statistics->argument_bytes +=
+        argument_bytes.load(std::memory_order_relaxed);
+    statistics->return_bytes += return_bytes.load(std::memory_order_relaxed);
+    decode.MergeInto(&statistics->decode);
+    handler.MergeInto(&statistics->handler);
+    encode.MergeInto(&statistics->encode);
+    round_trip.MergeInto(&statistics->round_trip);
+  }
+};
+
+// The counters recorded by one thread into one MethodMetrics instance. Only the
+// owning thread adds methods, so it looks them up without locking; the mutex
+// orders additions with iteration by Snapshot().
+struct MethodMetricsShard {
+  std::mutex mutex;
+  std::unordered_map<std::uint64_t, std::unique_ptr<MethodRecorder>> methods;
+
+  MethodRecorder* Get(std::uint64_t selector) {
+    auto search = methods.find(selector);
+    if (search != methods.end())
+      return search->second.get();
+
+    std::lock_guard<std::mutex> lock{mutex};
+    auto& recorder = methods[selector];
+    recorder.reset(new MethodRecorder);
+    return recorder.get();
+  }
+};
+
+using MetricsClock = std::chrono::steady_clock;
+
+inline std::uint64_t ElapsedNanoseconds(MetricsClock::time_point start,
+                                        MetricsClock::time_point end) {
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+          .count());
+}
+
+}  // namespace detail
+
+// Collects per-method metrics recorded by InstrumentedReceiver and
+// InstrumentedSender. Instances may be shared by any number of adapters on any
+// number of threads.
+class MethodMetrics {
+ public:
+  MethodMetrics() : id_{NextId()} {}
+
+  MethodMetrics(const MethodMetrics&) = delete;
+  void operator=(const MethodMetrics&) = delete;
+
+  // Associates |name| with the method with the given |selector| in snapshots.
+  void RegisterMethod(std::uint64_t selector, std::string name) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    names_[selector] = std::move(name);
+  }
+
+  // Registers the names of the methods of the interface type T, as given to
+  // NOP_METHOD().
+  template <typename T>
+  void RegisterInterface() {
+    RegisterMethods<T>(
+        std::make_index_sequence<Interface<T>::GetMethodCount()>{});
+  }
+
+  // Records a dispatched call that read its arguments and ran its handler.
+  // |ok| indicates whether the return value was sent successfully.
+  void RecordDispatch(std::uint64_t selector, bool ok,
+                      std::size_t argument_bytes, std::size_t return_bytes,
+                      std::uint64_t decode_ns, std::uint64_t handler_ns,
+                      std::uint64_t encode_ns) {
+    detail::MethodRecorder* recorder = GetShard()->Get(selector);
+    detail::AddToCounter(&recorder->calls, 1);
+    detail::AddToCounter(&recorder->errors, ok ? 0 : 1);
+    detail::AddToCounter(&recorder->argument_bytes, argument_bytes);
+    detail::AddToCounter(&recorder->return_bytes, return_bytes);
+    recorder->decode.Record(decode_ns);
+    recorder->handler.Record(handler_ns);
+    recorder->encode.Record(encode_ns);
+  }
+
+  // Records a sent call. |ok| indicates whether the call completed
+  // successfully.
+  void RecordSend(std::uint64_t selector, bool ok, std::size_t argument_bytes,
+                  std::size_t return_bytes, std::uint64_t round_trip_ns) {
+    detail::MethodRecorder* recorder = GetShard()->Get(selector);
+    detail::AddToCounter(&recorder->calls, 1);
+    detail::AddToCounter(&recorder->errors, ok ? 0 : 1);
+    detail::AddToCounter(&recorder->argument_bytes, argument_bytes);
+    detail::AddToCounter(&recorder->return_bytes, return_bytes);
+    recorder->round_trip.Record(round_trip_ns);
+  }
+
+  // Records a call that failed before its handler ran, such as when its
+  // arguments could not be read.
+  void RecordError(std::uint64_t selector) {
+    detail::MethodRecorder* recorder = GetShard()->Get(selector);
+    detail::AddToCounter(&recorder->calls, 1);
+    detail::AddToCounter(&recorder->errors, 1);
+  }
+
+  // Returns the metrics recorded so far by all threads. Counts recorded while
+  // the snapshot is taken may or may not be included.
+  MethodMetricsSnapshot Snapshot() const {
+    std::map<std::uint64_t, MethodStatistics> methods;
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (const auto& name : names_)
+      methods[name.first].name = name.second;
+
+    for (const auto& shard : shards_) {
+      std::lock_guard<std::mutex> shard_lock{shard->mutex};
+      for (const auto& method : shard->methods)
+        method.second->MergeInto(&methods[method.first]);
+    }
+
+    MethodMetricsSnapshot snapshot;
+    snapshot.methods.reserve(methods.size());
+    for (auto& method : methods) {
+      method.second.selector = method.first;
+      snapshot.methods.push_back(std::move(method.second));
+    }
+    return snapshot;
+  }
+
+ private:
+  struct ShardCacheEntry {
+    detail::MethodMetricsShard* shard;
+    std::weak_ptr<detail::MethodMetricsShard> owner;
+  };
+  using ShardCache = std::unordered_map<std::uint64_t, ShardCacheEntry>;
+
+  template <typename T, std::size_t... Is>
+  void RegisterMethods(std::index_sequence<Is...>) {
+    const std::uint64_t selectors[] = {
+        0, static_cast<std::uint64_t>(
+               Interface<T>::template GetMethodSelector<Is>())...};
+    const char* const names[] = {
+        "", Interface<T>::template GetMethodName<Is>()...};
+    for (std::size_t i = 1; i < sizeof...(Is) + 1; i++)
+      RegisterMethod(selectors[i], names[i]);
+  }
+
+  // Returns the shard of the calling thread, creating it on first use. Each
+  // instance has a unique id, so the per-thread cache never confuses a live
+  // instance with a destroyed one; entries for destroyed instances are pruned
+  // when a new shard is created.
+  detail::MethodMetricsShard* GetShard() {
+    static thread_local ShardCache cache;
+    auto search = cache.find(id_);
+    if (search != cache.end())
+      return search->second.shard;
+
+    for (auto entry = cache.begin(); entry != cache.end();) {
+      if (entry->second.owner.expired())
+        entry = cache.erase(entry);
+      else
+        ++entry;
+    }
+
+    auto shard = std::make_shared<detail::MethodMetricsShard>();
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      shards_.push_back(shard);
+    }
+    cache[id_] = ShardCacheEntry{shard.get(), shard};
+    return shard.get();
+  }
+
+  static std::uint64_t NextId() {
+    static std::atomic<std::uint64_t> next_id{0};
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  const std::uint64_t id_;
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<detail::MethodMetricsShard>> shards_;
+  std::map<std::uint64_t, std::string> names_;
+};
+
+// InstrumentedReceiver wraps a Receiver, such as SimpleMethodReceiver, and
+// records the metrics of each call dispatched through it by
+// InterfaceBindings::operator() into a MethodMetrics instance. The handler
+// latency is the time from reading the arguments to sending the return value.
+// Calls dispatched with a selector that is not bound are not recorded.
+//
+// This adapter supports synchronous dispatch only; it does not forward the
+// request ids used by InterfaceBindings::Defer().
+template <typename Receiver>
+class InstrumentedReceiver {
+ public:
+  constexpr InstrumentedReceiver(Receiver* receiver, MethodMetrics* metrics)
+      : receiver_{receiver}, metrics_{metrics} {}
+
+  template <typename MethodSelector>
+  Status<void> GetMethodSelector(MethodSelector* method_selector) {
+    auto status = receiver_->GetMethodSelector(method_selector);
+    if (!status)
+      return status;
+
+    selector_ = static_cast<std::uint64_t>(*method_selector);
+    return {};
+  }
+
+  template <typename... Args>
+  Status<void> GetArgs(std::tuple<Args...>* args) {
+    const auto start = detail::MetricsClock::now();
+    auto status = receiver_->GetArgs(args);
+    if (!status) {
+      metrics_->RecordError(selector_);
+      return status;
+    }
+
+    decode_ns_ =
+        detail::ElapsedNanoseconds(start, detail::MetricsClock::now());
+    argument_bytes_ = Encoding<std::tuple<Args...>>::Size(*args);
+    handler_start_ = detail::MetricsClock::now();
+    return {};
+  }
+
+  template <typename Return>
+  Status<void> SendReturn(const Return& return_value) {
+    const auto start = detail::MetricsClock::now();
+    auto status = receiver_->SendReturn(return_value);
+    const auto end = detail::MetricsClock::now();
+
+    metrics_->RecordDispatch(selector_, static_cast<bool>(status),
+                             argument_bytes_,
+                             Encoding<Return>::Size(return_value), decode_ns_,
+                             detail::ElapsedNanoseconds(handler_start_, start),
+                             detail::ElapsedNanoseconds(start, end));
+    return status;
+  }
+
+  constexpr const Receiver& receiver() const { return *receiver_; }
+  constexpr Receiver& receiver() { return *receiver_; }
+
+ private:
+  Receiver* receiver_;
+  MethodMetrics* metrics_;
+
+  // State of the call being dispatched.
+  std::uint64_t selector_{0};
+  std::uint64_t decode_ns_{0};
+  std::size_t argument_bytes_{0};
+  detail::MetricsClock::time_point handler_start_{};
+};
+
+template <typename Receiver>
+InstrumentedReceiver<Receiver> MakeInstrumentedReceiver(
+    Receiver* receiver, MethodMetrics* metrics) {
+  return {receiver, metrics};
+}
+
+// InstrumentedSender wraps a Sender, such as SimpleMethodSender, and records
+// the metrics of each call sent through it into a MethodMetrics instance. The
+// round trip latency covers sending the arguments and receiving the return
+// value. Only the synchronous SendMethod() is forwarded.
+template <typename Sender>
+class InstrumentedSender {
+ public:
+  constexpr InstrumentedSender(Sender* sender, MethodMetrics* metrics)
+      : sender_{sender}, metrics_{metrics} {}
+
+  template <typename MethodSelector, typename Return, typename... Args>
+  void SendMethod(MethodSelector method_selector, Status<Return>* return_value,
+                  const std::tuple<Args...>& args) {
+    const auto start = detail::MetricsClock::now();
+    sender_->SendMethod(method_selector, return_value, args);
+    const auto end = detail::MetricsClock::now();
+
+    metrics_->RecordSend(static_cast<std::uint64_t>(method_selector),
+                         static_cast<bool>(*return_value),
+                         Encoding<std::tuple<Args...>>::Size(args),
+                         ReturnSize(*return_value),
+                         detail::ElapsedNanoseconds(start, end));
+  }
+
+  constexpr const Sender& sender() const { return *sender_; }
+  constexpr Sender& sender() { return *sender_; }
+
+ private:
+  template <typename Return>
+  static std::size_t ReturnSize(const Status<Return>& return_value) {
+    return return_value ? Encoding<Return>::Size(return_value.get()) : 0;
+  }
+
+  static std::size_t ReturnSize(const Status<void>&) { return 0; }
+
+  Sender* sender_;
+  MethodMetrics* metrics_;
+};
+
+template <typename Sender>
+InstrumentedSender<Sender> MakeInstrumentedSender(Sender* sender,
+                                                  MethodMetrics* metrics) {
+  return {sender, metrics};
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_METHOD_METRICS_H_
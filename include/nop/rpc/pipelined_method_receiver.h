@@ -0,0 +1,88 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_PIPELINED_METHOD_RECEIVER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_PIPELINED_METHOD_RECEIVER_H_
+
+#include <cstdint>
+#include <tuple>
+
+#include <nop/status.h>
+
+namespace nop {
+
+// PipelinedMethodReceiver is the Receiver counterpart of PipelinedMethodSender.
+// It reads the request id that precedes the method selector of each call and
+// echoes it before the return value, so that the sender can match return
+// values to calls when many calls are in flight. Otherwise it behaves like
+// SimpleMethodReceiver, leaving all transport-level concerns to the serializer
+// and deserializer type.
+template <typename Serializer, typename Deserializer>
+class PipelinedMethodReceiver {
+ public:
+  // Type of the id used to match return values to calls.
+  using RequestId = std::uint64_t;
+
+  constexpr PipelinedMethodReceiver(Serializer* serializer,
+                                    Deserializer* deserializer)
+      : serializer_{serializer}, deserializer_{deserializer} {}
+
+  template <typename MethodSelector>
+  Status<void> GetMethodSelector(MethodSelector* method_selector) {
+    auto status = deserializer_->Read(&request_id_);
+    if (!status)
+      return status;
+
+    return deserializer_->Read(method_selector);
+  }
+
+  template <typename... Args>
+  Status<void> GetArgs(std::tuple<Args...>* args) {
+    return deserializer_->Read(args);
+  }
+
+  template <typename Return>
+  Status<void> SendReturn(const Return& return_value) {
+    auto status = serializer_->Write(request_id_);
+    if (!status)
+      return status;
+
+    return serializer_->Write(return_value);
+  }
+
+  // Returns the request id of the call being dispatched.
+  RequestId request_id() const { return request_id_; }
+
+  const Serializer& serializer() const { return *serializer_; }
+  Serializer& serializer() { return *serializer_; }
+  const Deserializer& deserializer() const { return *deserializer_; }
+  Deserializer& deserializer() { return *deserializer_; }
+
+ private:
+  Serializer* serializer_;
+  Deserializer* deserializer_;
+  RequestId request_id_{0};
+};
+
+template <typename Serializer, typename Deserializer>
+PipelinedMethodReceiver<Serializer, Deserializer> MakePipelinedMethodReceiver(
+    Serializer* serializer, Deserializer* deserializer) {
+  return {serializer, deserializer};
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_PIPELINED_METHOD_RECEIVER_H_
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_PIPELINED_METHOD_SENDER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_PIPELINED_METHOD_SENDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+#include <nop/rpc/detail/pending_calls.h>
+#include <nop/status.h>
+
+namespace nop {
+
+// PipelinedMethodSender is an implementation of the Sender type required by
+// the remote interface support in nop/rpc/interface.h that allows many calls
+// to be in flight on one channel at the same time. Each call is tagged with a
+// request id, which PipelinedMethodReceiver echoes back with the return value,
+// so that return values may arrive in any order.
+//
+// Calls are made with InterfaceMethod::InvokeAsync(), which sends the request
+// and registers a completion op to be invoked with the Status<Return> of the
+// call. Completions are run by ReceiveReturn(), which reads one response from
+// the deserializer. The wire format of each request is the request id, method
+// selector, and argument tuple, and that of each response is the request id
+// and return value.
+//
+// InterfaceMethod::Invoke() is also supported: it sends the call and receives
+// responses, completing any other calls that are in flight, until its own
+// return value arrives.
+//
+// Calls may be sent from any thread. Responses must be received by one thread
+// at a time, which may be different from the sending threads.
+template <typename Serializer, typename Deserializer>
+class PipelinedMethodSender {
+ public:
+  // Type of the id used to match return values to calls.
+  using RequestId = std::uint64_t;
+
+  PipelinedMethodSender(Serializer* serializer, Deserializer* deserializer)
+      : serializer_{serializer}, deserializer_{deserializer} {}
+
+  PipelinedMethodSender(const PipelinedMethodSender&) = delete;
+  void operator=(const PipelinedMethodSender&) = delete;
+
+  // Sends a call, registering |op| to be invoked with the Status<Return> of
+  // the call once its return value is received. Returns the request id of the
+  // call, or an error if the call could not be sent, in which case |op| is
+  // never invoked.
+  template <typename Return, typename MethodSelector, typename... Args,
+            typename Op>
+  Status<RequestId> SendMethodAsync(MethodSelector method_selector,
+                                    const std::tuple<Args...>& args, Op&& op) {
+    std::lock_guard<std::mutex> send_lock{send_mutex_};
+    const RequestId request_id = next_request_id_++;
+
+    // Register the completion before sending so that a fast response always
+    // finds it.
+    pending_.Add(request_id, Pending::template MakeCompletion<Return>(
+                                 std::forward<Op>(op)));
+
+    auto status = serializer_->Write(request_id);
+    if (status)
+      status = serializer_->Write(method_selector);
+    if (status)
+      status = serializer_->Write(args);
+
+    if (!status) {
+      pending_.Take(request_id);
+      return status.error();
+    }
+
+    return request_id;
+  }
+
+  // Sends a call and receives responses until its return value arrives.
+  template <typename MethodSelector, typename Return, typename... Args>
+  void SendMethod(MethodSelector method_selector, Status<Return>* return_value,
+                  const std::tuple<Args...>& args) {
+    bool complete = false;
+    auto request_id = SendMethodAsync<Return>(
+        method_selector, args, [return_value, &complete](Status<Return> value) {
+          *return_value = std::move(value);
+          complete = true;
+        });
+    if (!request_id) {
+      *return_value = request_id.error();
+      return;
+    }
+
+    while (!complete) {
+      auto status = ReceiveReturn();
+      if (!status && !complete) {
+        pending_.Take(request_id.get());
+        *return_value = status.error();
+        return;
+      }
+    }
+  }
+
+  // Reads one response from the deserializer and completes the matching call.
+  // Returns ErrorStatus::ProtocolError if the request id does not match a call
+  // in flight.
+  Status<void> ReceiveReturn() {
+    RequestId request_id = 0;
+    auto status = deserializer_->Read(&request_id);
+    if (!status)
+      return status;
+
+    auto completion = pending_.Take(request_id);
+    if (!completion)
+      return ErrorStatus::ProtocolError;
+
+    return completion(deserializer_, ErrorStatus::None);
+  }
+
+  // Completes every call in flight with |error|, for example when the channel
+  // is closed.
+  void CancelPending(ErrorStatus error) { pending_.CancelAll(error); }
+
+  // Returns the number of calls in flight.
+  std::size_t pending_count() const { return pending_.size(); }
+
+  const Serializer& serializer() const { return *serializer_; }
+  Serializer& serializer() { return *serializer_; }
+  const Deserializer& deserializer() const { return *deserializer_; }
+  Deserializer& deserializer() { return *deserializer_; }
+
+ private:
+  using Pending = detail::PendingCalls<Deserializer>;
+
+  Serializer* serializer_;
+  Deserializer* deserializer_;
+
+  std::mutex send_mutex_;
+  RequestId next_request_id_{0};
+
+  Pending pending_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_PIPELINED_METHOD_SENDER_H_
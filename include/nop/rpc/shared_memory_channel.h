@@ -0,0 +1,254 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_SHARED_MEMORY_CHANNEL_H_
+#define LIBNOP_INCLUDE_NOP_RPC_SHARED_MEMORY_CHANNEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include <nop/rpc/simple_method_receiver.h>
+#include <nop/rpc/simple_method_sender.h>
+#include <nop/serializer.h>
+#include <nop/status.h>
+#include <nop/structure.h>
+#include <nop/utility/shared_ring.h>
+#include <nop/utility/shared_ring_reader.h>
+#include <nop/utility/shared_ring_writer.h>
+
+namespace nop {
+
+// Reference to a block of bytes in the bulk area of a SharedMemoryChannel.
+// Passing a SharedBlock as a method argument or return value sends only the
+// offset and size of the data, which the other side resolves to a pointer into
+// the shared region with SharedMemoryEndpoint::Resolve().
+struct SharedBlock {
+  std::uint64_t offset{0};
+  std::uint64_t size{0};
+
+  NOP_STRUCTURE(SharedBlock, offset, size);
+};
+
+// SharedMemoryChannel describes the layout of a shared memory region used for
+// RPC between two co-located processes, such as one obtained from
+// shm_open(3) or memfd_create(2) and mapped with MAP_SHARED in both of them.
+// It is a non-owning view of the region and is cheap to copy.
+//
+// The region holds two directions, requests from the client to the server and
+// responses from the server to the client. Each direction is a SharedRing of
+// |ring_capacity| bytes, which carries the serialized method selectors,
+// arguments, and return values, followed by a bulk area of |bulk_capacity|
+// bytes for data passed by SharedBlock reference.
+//
+// Exactly one process must call Initialize() before the channel is used.
+class SharedMemoryChannel {
+ public:
+  enum class Direction : std::size_t { Request = 0, Response = 1 };
+
+  SharedMemoryChannel() = default;
+  SharedMemoryChannel(void* memory, std::size_t ring_capacity,
+                      std::size_t bulk_capacity)
+      : memory_{static_cast<std::uint8_t*>(memory)},
+        ring_capacity_{ring_capacity},
+        bulk_capacity_{bulk_capacity} {}
+
+  // Returns the region size needed for the given ring and bulk capacities.
+  static constexpr std::size_t RegionSize(std::size_t ring_capacity,
+                                          std::size_t bulk_capacity) {
+    return 2 * DirectionSize(ring_capacity, bulk_capacity);
+  }
+
+  // Initializes both rings and returns false if |ring_capacity| is too small to
+  // hold a ring.
+  bool Initialize() const {
+    return ring(Direction::Request).Initialize() &&
+           ring(Direction::Response).Initialize();
+  }
+
+  // Returns the ring carrying messages in the given direction.
+  SharedRing ring(Direction direction) const {
+    return {Base(direction), SharedRing::RegionSize(ring_capacity_)};
+  }
+
+  // Returns the start of the bulk area for the given direction.
+  std::uint8_t* bulk(Direction direction) const {
+    return Base(direction) +
+           AlignedSize(SharedRing::RegionSize(ring_capacity_));
+  }
+
+  std::size_t ring_capacity() const { return ring_capacity_; }
+  std::size_t bulk_capacity() const { return bulk_capacity_; }
+  bool is_valid() const { return memory_ != nullptr; }
+
+ private:
+  enum : std::size_t { kDirectionAlignment = 64 };
+
+  static constexpr std::size_t AlignedSize(std::size_t size) {
+    return (size + kDirectionAlignment - 1) / kDirectionAlignment *
+           kDirectionAlignment;
+  }
+
+  static constexpr std::size_t DirectionSize(std::size_t ring_capacity,
+                                             std::size_t bulk_capacity) {
+    return AlignedSize(SharedRing::RegionSize(ring_capacity)) +
+           AlignedSize(bulk_capacity);
+  }
+
+  std::uint8_t* Base(Direction direction) const {
+    return memory_ + static_cast<std::size_t>(direction) *
+                         DirectionSize(ring_capacity_, bulk_capacity_);
+  }
+
+  std::uint8_t* memory_{nullptr};
+  std::size_t ring_capacity_{0};
+  std::size_t bulk_capacity_{0};
+};
+
+// SharedMemoryEndpoint is one side of a SharedMemoryChannel. The client side
+// provides a Sender for the remote interface support in nop/rpc/interface.h
+// and the server side provides a Receiver, so that an interface may be called
+// across processes without copying messages through the kernel:
+//
+//  // Client process.
+//  SharedMemoryEndpoint client{channel, SharedMemoryEndpoint::Side::Client};
+//  auto sum = Calculator::Sum::Invoke(client.sender(), 1, 2);
+//
+//  // Server process.
+//  SharedMemoryEndpoint server{channel, SharedMemoryEndpoint::Side::Server};
+//  while (server.Dispatch(bindings)) {}
+//
+// Messages are serialized directly into the ring of the outgoing direction and
+// deserialized directly from the ring of the incoming direction. A side that
+// is waiting for a message spins for |spin_count| polls before sleeping on a
+// futex, so back-to-back calls complete without entering the kernel while an
+// idle server does not burn a core.
+//
+// Large arguments and return values may be placed in the bulk area of the
+// outgoing direction with Allocate() or Copy() and passed by SharedBlock. The
+// bulk area is a simple arena: blocks remain valid until Reset() is called by
+// the side that allocated them, typically once the call that uses them has
+// returned. Calls are synchronous, so each ring holds at most one call or
+// return value at a time; a message that does not fit in the ring fails with
+// ErrorStatus::WriteLimitReached and should use the bulk area instead.
+//
+// Destroying an endpoint closes its outgoing ring, after which the other side
+// reports ErrorStatus::ReadLimitReached.
+class SharedMemoryEndpoint {
+ public:
+  enum class Side { Client, Server };
+
+  using Serializer = nop::Serializer<SharedRingWriter>;
+  using Deserializer = nop::Deserializer<SharedRingReader>;
+  using Sender = SimpleMethodSender<Serializer, Deserializer>;
+  using Receiver = SimpleMethodReceiver<Serializer, Deserializer>;
+
+  SharedMemoryEndpoint(const SharedMemoryChannel& channel, Side side,
+                       std::size_t spin_count =
+                           SharedRingReader::kDefaultSpinCount)
+      : channel_{channel},
+        outgoing_{side == Side::Client
+                      ? SharedMemoryChannel::Direction::Request
+                      : SharedMemoryChannel::Direction::Response},
+        incoming_{side == Side::Client
+                      ? SharedMemoryChannel::Direction::Response
+                      : SharedMemoryChannel::Direction::Request},
+        serializer_{channel.ring(outgoing_)},
+        deserializer_{channel.ring(incoming_), spin_count},
+        sender_{&serializer_, &deserializer_},
+        receiver_{&serializer_, &deserializer_} {}
+
+  SharedMemoryEndpoint(const SharedMemoryEndpoint&) = delete;
+  void operator=(const SharedMemoryEndpoint&) = delete;
+
+  // Returns the Sender to pass to InterfaceMethod::Invoke() on the client side.
+  Sender* sender() { return &sender_; }
+
+  // Returns the Receiver to pass to interface bindings on the server side.
+  Receiver* receiver() { return &receiver_; }
+
+  // Receives one call and dispatches it to |bindings|.
+  template <typename Bindings, typename... Args>
+  Status<void> Dispatch(const Bindings& bindings, Args&&... args) {
+    return bindings(&receiver_, std::forward<Args>(args)...);
+  }
+
+  // Reserves |size| bytes in the outgoing bulk area and stores a pointer to
+  // them in |data|, so that large values may be built in place. Returns
+  // ErrorStatus::WriteLimitReached if the bulk area is full.
+  Status<SharedBlock> Allocate(std::size_t size, std::uint8_t** data) {
+    const std::size_t offset = bulk_used_;
+    if (size > channel_.bulk_capacity() - offset)
+      return ErrorStatus::WriteLimitReached;
+
+    bulk_used_ = offset + AlignedSize(size);
+    if (bulk_used_ > channel_.bulk_capacity())
+      bulk_used_ = channel_.bulk_capacity();
+
+    *data = channel_.bulk(outgoing_) + offset;
+    return SharedBlock{offset, size};
+  }
+
+  // Copies |size| bytes from |data| into the outgoing bulk area.
+  Status<SharedBlock> Copy(const void* data, std::size_t size) {
+    std::uint8_t* destination = nullptr;
+    auto block = Allocate(size, &destination);
+    if (block && size)
+      std::memcpy(destination, data, size);
+    return block;
+  }
+
+  // Releases every block allocated in the outgoing bulk area.
+  void Reset() { bulk_used_ = 0; }
+
+  // Returns a pointer to the data of a block received from the other side, or
+  // ErrorStatus::InvalidContainerLength if the block does not lie within the
+  // bulk area.
+  Status<const std::uint8_t*> Resolve(const SharedBlock& block) const {
+    const std::uint64_t capacity = channel_.bulk_capacity();
+    if (block.offset > capacity || block.size > capacity - block.offset)
+      return ErrorStatus::InvalidContainerLength;
+
+    const std::uint8_t* data = channel_.bulk(incoming_) + block.offset;
+    return data;
+  }
+
+  // Returns the number of bytes allocated in the outgoing bulk area.
+  std::size_t bulk_used() const { return bulk_used_; }
+
+  // Closes the outgoing ring.
+  void Close() { serializer_.writer().Close(); }
+
+ private:
+  static constexpr std::size_t AlignedSize(std::size_t size) {
+    return (size + SharedRing::kAlignment - 1) / SharedRing::kAlignment *
+           SharedRing::kAlignment;
+  }
+
+  SharedMemoryChannel channel_;
+  SharedMemoryChannel::Direction outgoing_;
+  SharedMemoryChannel::Direction incoming_;
+  Serializer serializer_;
+  Deserializer deserializer_;
+  Sender sender_;
+  Receiver receiver_;
+  std::size_t bulk_used_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_SHARED_MEMORY_CHANNEL_H_
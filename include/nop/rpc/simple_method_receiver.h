@@ -19,6 +19,8 @@
 
 #include <tuple>
 
+#include <nop/status.h>
+
 namespace nop {
 
 // SimpleMethodReceiver is a minimal implementation of the Receiver type
@@ -19,6 +19,8 @@
 
 #include <tuple>
 
+#include <nop/status.h>
+
 namespace nop {
 
 // SimpleMethodSender is a minimal implementation of the Sender type required by
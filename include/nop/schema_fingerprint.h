@@ -0,0 +1,331 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_SCHEMA_FINGERPRINT_H_
+#define LIBNOP_INCLUDE_NOP_SCHEMA_FINGERPRINT_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <nop/base/enum.h>
+#include <nop/base/logical_buffer.h>
+#include <nop/base/members.h>
+#include <nop/base/table.h>
+#include <nop/base/utility.h>
+#include <nop/types/detail/member_pointer.h>
+#include <nop/types/flat_map.h>
+#include <nop/types/optional.h>
+#include <nop/types/variant.h>
+#include <nop/utility/sip_hash.h>
+
+namespace nop {
+
+//
+// Schema fingerprints.
+//
+// SchemaFingerprint<T>::Value is a 64-bit compile-time hash of the shape of
+// type T: the kinds, widths, and signedness of its integers, the element types
+// of its containers, the member types of its structures, in order, and the
+// namespace hashes, entry ids, and entry types of its tables. Two programs
+// built from the same definitions compute the same fingerprint for a type,
+// and changing any of these properties changes it. Member names and the names
+// of types are not part of the shape.
+//
+// Fingerprints are meant to be exchanged once when a connection is set up, to
+// confirm that both peers use identical definitions before enabling decoding
+// paths that rely on it, such as TrustedDeserializer in
+// nop/utility/trusted_deserializer.h.
+//
+// Fingerprints are defined for the arithmetic, enum, string, container,
+// Optional, Variant, structure, and table types. Other types, including handles
+// and recursive types, have no fingerprint; HasSchemaFingerprint<T> is false
+// for any type containing them. User-defined encodings may specialize
+// SchemaFingerprint to supply one.
+//
+
+template <typename T, typename Enabled = void>
+struct SchemaFingerprint;
+
+// Evaluates to true if type T has a schema fingerprint.
+template <typename T, typename = void>
+struct HasSchemaFingerprint : std::false_type {};
+template <typename T>
+struct HasSchemaFingerprint<T, Void<decltype(SchemaFingerprint<T>::Value)>>
+    : std::true_type {};
+
+// Enables a specialization of SchemaFingerprint only if all of the given
+// component types have fingerprints.
+template <typename... Types>
+using EnableIfHaveSchemaFingerprints =
+    std::enable_if_t<And<HasSchemaFingerprint<Types>...>::value>;
+
+// SipHash keys used to compute schema fingerprints.
+enum : std::uint64_t {
+  kSchemaFingerprintKey0 = 0x5eed5c4e3a0f1a9e,
+  kSchemaFingerprintKey1 = 0x0f1e2d3c4b5a6978,
+};
+
+namespace detail {
+
+// Distinguishes the kinds of types that make up a fingerprint.
+enum class FingerprintKind : std::uint64_t {
+  Bool = 1,
+  Integer,
+  Float,
+  Enum,
+  String,
+  Array,
+  Vector,
+  Map,
+  Tuple,
+  Optional,
+  Variant,
+  Structure,
+  Table,
+  Entry,
+  Layout,
+};
+
+// Byte container over a sequence of 64-bit words, in little-endian order, for
+// SipHash::Compute().
+template <std::size_t Count>
+struct FingerprintBlock {
+  std::uint64_t words[Count];
+
+  constexpr std::size_t size() const { return Count * sizeof(std::uint64_t); }
+  constexpr std::uint8_t operator[](std::size_t index) const {
+    return static_cast<std::uint8_t>(words[index / sizeof(std::uint64_t)] >>
+                                     (8 * (index % sizeof(std::uint64_t))));
+  }
+};
+
+// Returns the fingerprint of a type of the given kind with the given
+// properties, which are typically the fingerprints of its component types.
+template <typename... Words>
+constexpr std::uint64_t Fingerprint(FingerprintKind kind, Words... words) {
+  return SipHash::Compute(
+      FingerprintBlock<1 + sizeof...(Words)>{
+          {static_cast<std::uint64_t>(kind),
+           static_cast<std::uint64_t>(words)...}},
+      kSchemaFingerprintKey0, kSchemaFingerprintKey1);
+}
+
+// Has the same fingerprint as type T, if it has one.
+template <typename T, typename = void>
+struct SameFingerprint {};
+
+template <typename T>
+struct SameFingerprint<T, EnableIfHaveSchemaFingerprints<T>>
+    : SchemaFingerprint<T> {};
+
+// Member and entry list fingerprints have no Value unless all of the member
+// types have fingerprints.
+template <typename MemberList,
+          typename = std::make_index_sequence<MemberList::Count>,
+          typename = void>
+struct MemberListFingerprint {};
+
+template <typename MemberList, std::size_t... Is>
+struct MemberListFingerprint<
+    MemberList, std::index_sequence<Is...>,
+    EnableIfHaveSchemaFingerprints<
+        typename MemberList::template At<Is>::Type...>> {
+  enum : std::uint64_t {
+    Value = Fingerprint(
+        FingerprintKind::Structure,
+        SchemaFingerprint<typename MemberList::template At<Is>::Type>::Value...)
+  };
+};
+
+template <typename EntryList,
+          typename = std::make_index_sequence<EntryList::Count>,
+          typename = void>
+struct EntryListFingerprint {};
+
+template <typename EntryList, std::size_t... Is>
+struct EntryListFingerprint<
+    EntryList, std::index_sequence<Is...>,
+    EnableIfHaveSchemaFingerprints<
+        typename EntryList::template At<Is>::Type...>> {
+  enum : std::uint64_t {
+    Value = Fingerprint(
+        FingerprintKind::Table, EntryList::Hash,
+        SchemaFingerprint<typename EntryList::template At<Is>::Type>::Value...)
+  };
+};
+
+}  // namespace detail
+
+template <>
+struct SchemaFingerprint<bool> {
+  enum : std::uint64_t {
+    Value = detail::Fingerprint(detail::FingerprintKind::Bool)
+  };
+};
+
+template <typename T>
+struct SchemaFingerprint<T, std::enable_if_t<std::is_integral<T>::value &&
+                                             !std::is_same<T, bool>::value>> {
+  enum : std::uint64_t {
+    Value = detail::Fingerprint(detail::FingerprintKind::Integer, sizeof(T),
+                                std::is_signed<T>::value)
+  };
+};
+
+template <typename T>
+struct SchemaFingerprint<
+    T, std::enable_if_t<std::is_floating_point<T>::value>> {
+  enum : std::uint64_t {
+    Value = detail::Fingerprint(detail::FingerprintKind::Float, sizeof(T))
+  };
+};
+
+template <typename T>
+struct SchemaFingerprint<T, EnableIfEnum<T>> {
+  enum : std::uint64_t {
+    Value = detail::Fingerprint(
+        detail::FingerprintKind::Enum,
+        SchemaFingerprint<std::underlying_type_t<T>>::Value)
+  };
+};
+
+template <typename CharType, typename Traits, typename Allocator>
+struct SchemaFingerprint<std::basic_string<CharType, Traits, Allocator>,
+                         EnableIfHaveSchemaFingerprints<CharType>> {
+  enum : std::uint64_t {
+    Value = detail::Fingerprint(detail::FingerprintKind::String,
+                                SchemaFingerprint<CharType>::Value)
+  };
+};
+
+template <typename T, std::size_t Length>
+struct SchemaFingerprint<std::array<T, Length>,
+                         EnableIfHaveSchemaFingerprints<T>> {
+  enum : std::uint64_t {
+    Value = detail::Fingerprint(detail::FingerprintKind::Array,
+                                SchemaFingerprint<T>::Value, Length)
+  };
+};
+
+template <typename T, std::size_t Length>
+struct SchemaFingerprint<T[Length], EnableIfHaveSchemaFingerprints<T>>
+    : SchemaFingerprint<std::array<T, Length>> {};
+
+template <typename T, typename Allocator>
+struct SchemaFingerprint<std::vector<T, Allocator>,
+                         EnableIfHaveSchemaFingerprints<T>> {
+  enum : std::uint64_t {
+    Value = detail::Fingerprint(detail::FingerprintKind::Vector,
+                                SchemaFingerprint<T>::Value)
+  };
+};
+
+// Logical buffers decode like vectors of their element type.
+template <typename BufferType, typename SizeType, bool IsUnbounded>
+struct SchemaFingerprint<LogicalBuffer<BufferType, SizeType, IsUnbounded>>
+    : detail::SameFingerprint<std::vector<
+          std::remove_const_t<typename ArrayTraits<BufferType>::ElementType>>> {
+};
+
+template <typename Key, typename T, typename... Any>
+struct SchemaFingerprint<std::map<Key, T, Any...>,
+                         EnableIfHaveSchemaFingerprints<Key, T>> {
+  enum : std::uint64_t {
+    Value = detail::Fingerprint(detail::FingerprintKind::Map,
+                                SchemaFingerprint<Key>::Value,
+                                SchemaFingerprint<T>::Value)
+  };
+};
+
+template <typename Key, typename T, typename... Any>
+struct SchemaFingerprint<std::unordered_map<Key, T, Any...>,
+                         EnableIfHaveSchemaFingerprints<Key, T>>
+    : SchemaFingerprint<std::map<Key, T>> {};
+
+// Flat maps decode like std::map.
+template <typename Key, typename T, typename... Any>
+struct SchemaFingerprint<FlatMap<Key, T, Any...>,
+                         EnableIfHaveSchemaFingerprints<Key, T>>
+    : SchemaFingerprint<std::map<Key, T>> {};
+
+template <typename... Types>
+struct SchemaFingerprint<std::tuple<Types...>,
+                         EnableIfHaveSchemaFingerprints<Types...>> {
+  enum : std::uint64_t {
+    Value = detail::Fingerprint(detail::FingerprintKind::Tuple,
+                                SchemaFingerprint<Types>::Value...)
+  };
+};
+
+template <typename First, typename Second>
+struct SchemaFingerprint<std::pair<First, Second>,
+                         EnableIfHaveSchemaFingerprints<First, Second>>
+    : SchemaFingerprint<std::tuple<First, Second>> {};
+
+template <typename T>
+struct SchemaFingerprint<Optional<T>, EnableIfHaveSchemaFingerprints<T>> {
+  enum : std::uint64_t {
+    Value = detail::Fingerprint(detail::FingerprintKind::Optional,
+                                SchemaFingerprint<T>::Value)
+  };
+};
+
+template <typename... Types>
+struct SchemaFingerprint<Variant<Types...>,
+                         EnableIfHaveSchemaFingerprints<Types...>> {
+  enum : std::uint64_t {
+    Value = detail::Fingerprint(detail::FingerprintKind::Variant,
+                                SchemaFingerprint<Types>::Value...)
+  };
+};
+
+template <typename T>
+struct SchemaFingerprint<T, EnableIfHasMemberList<T>>
+    : detail::MemberListFingerprint<typename MemberListTraits<T>::MemberList> {
+};
+
+// Value wrappers encode exactly like their wrapped member.
+template <typename T>
+struct SchemaFingerprint<T, EnableIfIsValueWrapper<T>>
+    : detail::SameFingerprint<
+          typename ValueWrapperTraits<T>::Pointer::Type> {};
+
+template <typename T>
+struct SchemaFingerprint<T, EnableIfHasEntryList<T>>
+    : detail::EntryListFingerprint<typename EntryListTraits<T>::EntryList> {};
+
+template <typename T, std::uint64_t Id, typename Storage>
+struct SchemaFingerprint<Entry<T, Id, Storage>,
+                         EnableIfHaveSchemaFingerprints<T>> {
+  enum : std::uint64_t {
+    Value = detail::Fingerprint(detail::FingerprintKind::Entry, Id,
+                                std::is_same<Storage, DeletedEntry>::value,
+                                SchemaFingerprint<T>::Value)
+  };
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_SCHEMA_FINGERPRINT_H_
@@ -18,18 +18,37 @@
 #define LIBNOP_INCLUDE_NOP_SERIALIZER_H_
 
 #include <nop/base/array.h>
+#include <nop/base/bit_array.h>
+#include <nop/base/blittable_array.h>
+#include <nop/base/cached.h>
+#include <nop/base/chunked_blob.h>
+#include <nop/base/columnar.h>
 #include <nop/base/encoding.h>
 #include <nop/base/enum.h>
+#include <nop/base/flat_hash_map.h>
+#include <nop/base/flat_map.h>
 #include <nop/base/handle.h>
+#include <nop/base/indexed_array.h>
+#include <nop/base/inline_string.h>
+#include <nop/base/inline_vector.h>
+#include <nop/base/interned_string.h>
+#include <nop/base/lazy.h>
 #include <nop/base/map.h>
 #include <nop/base/members.h>
 #include <nop/base/optional.h>
+#include <nop/base/packed.h>
+#include <nop/base/patchable.h>
 #include <nop/base/pair.h>
+#include <nop/base/range.h>
 #include <nop/base/reference_wrapper.h>
 #include <nop/base/result.h>
 #include <nop/base/serializer.h>
+#include <nop/base/shared_ptr.h>
+#include <nop/base/span.h>
 #include <nop/base/string.h>
+#include <nop/base/string_view.h>
 #include <nop/base/table.h>
+#include <nop/base/table_delta.h>
 #include <nop/base/tuple.h>
 #include <nop/base/value.h>
 #include <nop/base/variant.h>
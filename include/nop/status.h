@@ -49,6 +49,15 @@ enum class ErrorStatus {
   IOError,                 // 16
   SystemError,             // 17
   DebugError,              // 18
+  NeedMoreData,            // 19
+  ChecksumMismatch,        // 20
+  InvalidStringReference,  // 21
+  VersionMismatch,         // 22
+  InvalidUtf8,             // 23
+  InvalidObjectReference,  // 24
+  BudgetExceeded,          // 25
+  DeadlineExceeded,        // 26
+  InvalidChunkReference,   // 27
 };
 
 template <typename T>
@@ -95,6 +104,24 @@ struct Status : Result<ErrorStatus, T> {
         return "System Error";
       case ErrorStatus::DebugError:
         return "Debug Error";
+      case ErrorStatus::NeedMoreData:
+        return "Need More Data";
+      case ErrorStatus::ChecksumMismatch:
+        return "Checksum Mismatch";
+      case ErrorStatus::InvalidStringReference:
+        return "Invalid String Reference";
+      case ErrorStatus::VersionMismatch:
+        return "Version Mismatch";
+      case ErrorStatus::InvalidUtf8:
+        return "Invalid UTF-8";
+      case ErrorStatus::InvalidObjectReference:
+        return "Invalid Object Reference";
+      case ErrorStatus::BudgetExceeded:
+        return "Budget Exceeded";
+      case ErrorStatus::DeadlineExceeded:
+        return "Deadline Exceeded";
+      case ErrorStatus::InvalidChunkReference:
+        return "Invalid Chunk Reference";
       default:
         return "Unknown Error";
     }
@@ -61,6 +61,22 @@ namespace nop {
   friend struct ::nop::MemberListTraits;      \
   using NOP__MEMBERS = ::nop::MemberList<_NOP_MEMBER_LIST(type, __VA_ARGS__)>
 
+// Similar to NOP_STRUCTURE except that every member is encoded with a fixed
+// width, so that the offset of each member in the encoding is the same for
+// every value of the type. Members must be integral, floating point, or enum
+// types, std::array of integral types, or other fixed structures. The encoding
+// remains a valid structure encoding that any reader of the type accepts; see
+// nop/base/fixed_structure.h and nop/types/view.h.
+#define NOP_FIXED_STRUCTURE(type, ... /*members*/) \
+  template <typename, typename>                    \
+  friend struct ::nop::Encoding;                   \
+  template <typename, typename>                    \
+  friend struct ::nop::HasInternalMemberList;      \
+  template <typename, typename>                    \
+  friend struct ::nop::MemberListTraits;           \
+  using NOP__MEMBERS =                             \
+      ::nop::FixedMemberList<_NOP_MEMBER_LIST(type, __VA_ARGS__)>
+
 // Defines the set of members belonging to a type that should be
 // serialized/deserialized without changing the type itself. This is useful for
 // making external library types with public data serializable.
@@ -17,7 +17,9 @@
 #ifndef LIBNOP_INCLUDE_NOP_TABLE_H_
 #define LIBNOP_INCLUDE_NOP_TABLE_H_
 
+#include <memory>
 #include <type_traits>
+#include <utility>
 
 #include <nop/base/macros.h>
 #include <nop/structure.h>
@@ -39,7 +41,9 @@ namespace nop {
 // either be empty or contain a value of type T. Entries that are empty are not
 // encoded during serialization to save space. Programs using tables should
 // handle empty values in a sensible way, ensuring that missing entries in older
-// data are handled gracefully.
+// data are handled gracefully. Tables with many, mostly empty entries may use
+// Entry<T, Id, IndirectEntry> to store values out-of-line and reduce the size
+// of each table instance.
 //
 // Example of a simple table definition:
 //
@@ -81,8 +85,10 @@ namespace nop {
 //      data.
 //
 
-// Type tags to define used and deprecated entries.
+// Type tags to define used and deprecated entries. IndirectEntry defines a used
+// entry that stores its value out-of-line; see below.
 struct ActiveEntry {};
+struct IndirectEntry {};
 struct DeletedEntry {};
 
 // Base type of table entries.
@@ -98,6 +104,71 @@ struct Entry<T, Id_, ActiveEntry> : Optional<T> {
   using Optional<T>::operator=;
 };
 
+// Specialization of Entry for active entries that store their value
+// out-of-line. The value is allocated on the heap only while the entry is
+// non-empty, so an empty entry costs a single pointer instead of the full size
+// of T plus the engaged flag and padding of Optional<T>. This suits large
+// tables with many entries that are usually empty. Indirect entries are encoded
+// exactly like ActiveEntry entries and the two may be interchanged without
+// affecting compatibility.
+template <typename T, std::uint64_t Id_>
+struct Entry<T, Id_, IndirectEntry> {
+  enum : std::uint64_t { Id = Id_ };
+
+  Entry() = default;
+  Entry(const Entry& other)
+      : value_{other.value_ ? new T(*other.value_) : nullptr} {}
+  Entry(Entry&&) = default;
+  Entry(const T& value) : value_{new T(value)} {}
+  Entry(T&& value) : value_{new T(std::move(value))} {}
+
+  Entry& operator=(const Entry& other) {
+    if (other)
+      Assign(*other.value_);
+    else
+      clear();
+    return *this;
+  }
+  Entry& operator=(Entry&&) = default;
+  Entry& operator=(const T& value) {
+    Assign(value);
+    return *this;
+  }
+  Entry& operator=(T&& value) {
+    Assign(std::move(value));
+    return *this;
+  }
+
+  bool empty() const { return !value_; }
+  explicit operator bool() const { return !empty(); }
+
+  const T& get() const { return *value_; }
+  T& get() { return *value_; }
+  T&& take() { return std::move(*value_); }
+
+  void clear() { value_.reset(); }
+
+  friend bool operator==(const Entry& a, const Entry& b) {
+    if (a.empty() || b.empty())
+      return a.empty() == b.empty();
+    else
+      return a.get() == b.get();
+  }
+  friend bool operator!=(const Entry& a, const Entry& b) { return !(a == b); }
+
+ private:
+  // Assigns the value, reusing the existing allocation if there is one.
+  template <typename U>
+  void Assign(U&& value) {
+    if (value_)
+      *value_ = std::forward<U>(value);
+    else
+      value_.reset(new T(std::forward<U>(value)));
+  }
+
+  std::unique_ptr<T> value_;
+};
+
 // Specialization of Entry for deleted/deprecated entries. These entries are
 // always empty and are never encoded. When encountered during deserialization
 // these entries are ignored.
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TRAITS_IS_BLITTABLE_H_
+#define LIBNOP_INCLUDE_NOP_TRAITS_IS_BLITTABLE_H_
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include <nop/base/members.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// Evaluates to true if values of type T may be copied to and from the wire as
+// their raw object representation. This holds for:
+//
+//   * Integral types other than bool, and enums of them.
+//   * IEEE 754 floating point types.
+//   * std::array<T, N> and T[N] of blittable T.
+//   * Trivially copyable, standard layout structures defined with
+//     NOP_STRUCTURE whose members are all blittable and which have no padding,
+//     so that every byte of the object belongs to exactly one member.
+//
+// Bool is excluded so that decoding cannot produce bools with values other than
+// true or false. Like the binary encoding of integral vectors, the raw
+// representation assumes a little-endian host.
+template <typename T, typename Enabled = void>
+struct IsBlittable : std::false_type {};
+
+template <typename T>
+struct IsBlittable<T, std::enable_if_t<std::is_integral<T>::value &&
+                                       !std::is_same<T, bool>::value>>
+    : std::true_type {};
+
+template <typename T>
+struct IsBlittable<T, std::enable_if_t<std::is_floating_point<T>::value>>
+    : std::integral_constant<bool, std::numeric_limits<T>::is_iec559> {};
+
+template <typename T>
+struct IsBlittable<T, std::enable_if_t<std::is_enum<T>::value>>
+    : IsBlittable<std::underlying_type_t<T>> {};
+
+template <typename T, std::size_t Length>
+struct IsBlittable<std::array<T, Length>>
+    : std::integral_constant<bool, IsBlittable<T>::value &&
+                                       sizeof(std::array<T, Length>) ==
+                                           sizeof(T) * Length> {};
+
+template <typename T, std::size_t Length>
+struct IsBlittable<T[Length]> : IsBlittable<T> {};
+
+namespace detail {
+
+// Returns the sum of |sizes|.
+template <typename... Sizes>
+constexpr std::size_t SumSizes(Sizes... sizes) {
+  std::size_t sum = 0;
+  for (std::size_t size : {std::size_t{0}, sizes...})
+    sum += size;
+  return sum;
+}
+
+template <typename T, typename MemberList,
+          typename = std::make_index_sequence<MemberList::Count>>
+struct IsBlittableMemberList;
+
+template <typename T, typename MemberList, std::size_t... Is>
+struct IsBlittableMemberList<T, MemberList, std::index_sequence<Is...>>
+    : std::integral_constant<
+          bool,
+          std::is_trivially_copyable<T>::value &&
+              std::is_standard_layout<T>::value &&
+              And<IsBlittable<
+                  typename MemberList::template At<Is>::Type>...>::value &&
+              SumSizes(sizeof(
+                  typename MemberList::template At<Is>::Type)...) ==
+                  sizeof(T)> {};
+
+}  // namespace detail
+
+template <typename T>
+struct IsBlittable<T, EnableIfHasMemberList<T>>
+    : detail::IsBlittableMemberList<T,
+                                    typename MemberListTraits<T>::MemberList> {
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TRAITS_IS_BLITTABLE_H_
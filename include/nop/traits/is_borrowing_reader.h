@@ -0,0 +1,44 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TRAITS_IS_BORROWING_READER_H_
+#define LIBNOP_INCLUDE_NOP_TRAITS_IS_BORROWING_READER_H_
+
+#include <cstddef>
+#include <utility>
+
+#include <nop/traits/is_detected.h>
+
+namespace nop {
+
+// Test expression for readers that can lend out direct references to their
+// input. Such readers implement the following method, which stores a pointer to
+// the next |size| bytes of input in |data| and advances past them:
+//
+//   Status<void> Borrow(const void** data, std::size_t size);
+//
+// The referenced bytes must remain valid for as long as the input buffer does.
+template <typename Reader>
+using ReaderBorrowTest = decltype(std::declval<Reader&>().Borrow(
+    std::declval<const void**>(), std::declval<std::size_t>()));
+
+// Evaluates to true if Reader supports borrowing with Borrow().
+template <typename Reader>
+using IsBorrowingReader = IsDetected<ReaderBorrowTest, Reader>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TRAITS_IS_BORROWING_READER_H_
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TRAITS_IS_BORROWING_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_TRAITS_IS_BORROWING_WRITER_H_
+
+#include <cstddef>
+#include <utility>
+
+#include <nop/traits/is_detected.h>
+
+namespace nop {
+
+// Test expression for writers that can lend out direct references to their
+// output. Such writers implement the following method, which stores a pointer
+// to the next |size| bytes of output in |data| and advances past them:
+//
+//   Status<void> Borrow(void** data, std::size_t size);
+//
+// The caller fills in the referenced bytes, which remain valid until the next
+// operation on the writer.
+template <typename Writer>
+using WriterBorrowTest = decltype(std::declval<Writer&>().Borrow(
+    std::declval<void**>(), std::declval<std::size_t>()));
+
+// Evaluates to true if Writer supports borrowing with Borrow().
+template <typename Writer>
+using IsBorrowingWriter = IsDetected<WriterBorrowTest, Writer>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TRAITS_IS_BORROWING_WRITER_H_
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TRAITS_IS_BUDGET_READER_H_
+#define LIBNOP_INCLUDE_NOP_TRAITS_IS_BUDGET_READER_H_
+
+#include <cstddef>
+#include <utility>
+
+#include <nop/traits/is_detected.h>
+
+namespace nop {
+
+// Test expression for readers that limit the work done by a decode. Such
+// readers implement the following methods:
+//
+//   // Called before each value is decoded, including the elements of
+//   // containers and the members of structures.
+//   Status<void> ChargeValue();
+//
+//   // Called before a container grows its storage by |bytes| for a decoded
+//   // length.
+//   Status<void> ChargeAllocation(std::size_t bytes);
+//
+// Decoding stops with the first error returned by either method. Use
+// BudgetReader in nop/utility/budget_reader.h rather than implementing these
+// methods directly.
+template <typename Reader>
+using ReaderBudgetTest =
+    decltype(std::declval<Reader&>().ChargeValue(),
+             std::declval<Reader&>().ChargeAllocation(std::size_t{}));
+
+// Evaluates to true if Reader limits the work done by a decode.
+template <typename Reader>
+using IsBudgetReader = IsDetected<ReaderBudgetTest, Reader>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TRAITS_IS_BUDGET_READER_H_
@@ -0,0 +1,44 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TRAITS_IS_CANONICAL_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_TRAITS_IS_CANONICAL_WRITER_H_
+
+#include <utility>
+
+#include <nop/traits/is_detected.h>
+
+namespace nop {
+
+// Test expression for writers that request the canonical encoding of values.
+// Such writers implement the following method:
+//
+//   bool canonical() const;
+//
+// Encodings with more than one valid output for the same value, such as
+// unordered containers and tables, write the canonical form when the writer
+// passes this test, so that equal values always produce identical bytes.
+template <typename Writer>
+using WriterCanonicalTest = decltype(std::declval<const Writer&>().canonical());
+
+// Evaluates to true if Writer requests canonical encoding.
+template <typename Writer>
+using IsCanonicalWriter = IsDetected<WriterCanonicalTest, Writer>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TRAITS_IS_CANONICAL_WRITER_H_
@@ -19,6 +19,7 @@
 
 #include <array>
 #include <map>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <unordered_map>
@@ -29,8 +30,12 @@
 #include <nop/base/members.h>
 #include <nop/base/table.h>
 #include <nop/base/utility.h>
+#include <nop/types/flat_map.h>
 #include <nop/types/optional.h>
+#include <nop/types/range.h>
 #include <nop/types/result.h>
+#include <nop/types/span.h>
+#include <nop/types/string_view.h>
 #include <nop/types/variant.h>
 
 // This header defines rules for which types have equivalent encodings. Types
@@ -112,6 +117,27 @@ struct IsFungible<std::unordered_map<KeyA, ValueA, AnyA...>,
     : And<IsFungible<std::decay_t<KeyA>, std::decay_t<KeyB>>,
           IsFungible<std::decay_t<ValueA>, std::decay_t<ValueB>>> {};
 
+// Compares FlatMaps with each other and with std::map to see if the element
+// types are fungible. FlatMap shares the encoding of std::map.
+template <typename KeyA, typename ValueA, typename KeyB, typename ValueB,
+          typename... AnyA, typename... AnyB>
+struct IsFungible<FlatMap<KeyA, ValueA, AnyA...>,
+                  FlatMap<KeyB, ValueB, AnyB...>>
+    : And<IsFungible<std::decay_t<KeyA>, std::decay_t<KeyB>>,
+          IsFungible<std::decay_t<ValueA>, std::decay_t<ValueB>>> {};
+template <typename KeyA, typename ValueA, typename KeyB, typename ValueB,
+          typename... AnyA, typename... AnyB>
+struct IsFungible<std::map<KeyA, ValueA, AnyA...>,
+                  FlatMap<KeyB, ValueB, AnyB...>>
+    : And<IsFungible<std::decay_t<KeyA>, std::decay_t<KeyB>>,
+          IsFungible<std::decay_t<ValueA>, std::decay_t<ValueB>>> {};
+template <typename KeyA, typename ValueA, typename KeyB, typename ValueB,
+          typename... AnyA, typename... AnyB>
+struct IsFungible<FlatMap<KeyA, ValueA, AnyA...>,
+                  std::map<KeyB, ValueB, AnyB...>>
+    : And<IsFungible<std::decay_t<KeyA>, std::decay_t<KeyB>>,
+          IsFungible<std::decay_t<ValueA>, std::decay_t<ValueB>>> {};
+
 // Compares two std::tuples to see if the corresponding elements are
 // fungible. Fungible tuples must have the same number of elements.
 template <typename... A, typename... B>
@@ -248,6 +274,37 @@ struct IsFungible<LogicalBuffer<A, SizeTypeA, IsUnboundedA, EnabledA>,
                   std::vector<B, AllocatorB>>
     : IsFungible<A, std::vector<B, AllocatorB>> {};
 
+// Compares a std::basic_string and a BasicStringView to see if they are
+// fungible. Both use the String encoding, which lets interface handlers borrow
+// string arguments from the receive buffer instead of copying them.
+template <typename CharType, typename Traits, typename Allocator>
+struct IsFungible<std::basic_string<CharType, Traits, Allocator>,
+                  BasicStringView<CharType, Traits>> : std::true_type {};
+template <typename CharType, typename Traits, typename Allocator>
+struct IsFungible<BasicStringView<CharType, Traits>,
+                  std::basic_string<CharType, Traits, Allocator>>
+    : std::true_type {};
+
+// Compares a std::vector and a Span to see if they are fungible. Spans use the
+// same encodings as vectors of the same element type.
+template <typename A, typename B, typename Allocator>
+struct IsFungible<std::vector<A, Allocator>, Span<B>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B, typename Allocator>
+struct IsFungible<Span<A>, std::vector<B, Allocator>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+
+// Compares a std::vector and a Range to see if they are fungible. Ranges use
+// the same encodings as vectors of their element type.
+template <typename A, typename Iterator, typename Allocator>
+struct IsFungible<std::vector<A, Allocator>, Range<Iterator>>
+    : IsFungible<std::decay_t<A>,
+                 std::decay_t<typename Range<Iterator>::value_type>> {};
+template <typename Iterator, typename B, typename Allocator>
+struct IsFungible<Range<Iterator>, std::vector<B, Allocator>>
+    : IsFungible<std::decay_t<typename Range<Iterator>::value_type>,
+                 std::decay_t<B>> {};
+
 // Compares MemberList<A...> and MemberList<B...> to see if every
 // MemberPointer::Type in A is fungible with every MemberPointer::Type in B.
 template <typename... A, typename... B>
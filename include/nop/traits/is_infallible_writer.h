@@ -0,0 +1,48 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TRAITS_IS_INFALLIBLE_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_TRAITS_IS_INFALLIBLE_WRITER_H_
+
+#include <utility>
+
+#include <nop/traits/is_detected.h>
+
+namespace nop {
+
+// Test expression for writers whose Write() and Skip() methods cannot fail once
+// Prepare() has succeeded for the size of the value being written. Such
+// writers implement the following method:
+//
+//   bool infallible() const;
+//
+// Encodings skip the status checks after writer calls when the writer passes
+// this test. Errors returned by the encodings themselves are still reported:
+// sequences of member writes continue past a failed member and return the
+// first error at the end, leaving no branch per member, which is safe because a
+// failed encoding never writes more than its size.
+template <typename Writer>
+using WriterInfallibleTest =
+    decltype(std::declval<const Writer&>().infallible());
+
+// Evaluates to true if Writer cannot fail after Prepare().
+template <typename Writer>
+using IsInfallibleWriter = IsDetected<WriterInfallibleTest, Writer>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TRAITS_IS_INFALLIBLE_WRITER_H_
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TRAITS_IS_LIMIT_READER_H_
+#define LIBNOP_INCLUDE_NOP_TRAITS_IS_LIMIT_READER_H_
+
+#include <cstddef>
+#include <utility>
+
+#include <nop/traits/is_detected.h>
+
+namespace nop {
+
+// Test expression for readers that can limit their own input, so that sized
+// values such as table entries are read without wrapping the reader in a
+// BoundedReader. Such readers implement the following methods:
+//
+//   // Limits reads to the next |size| bytes and returns the previous limit.
+//   Status<std::size_t> PushLimit(std::size_t size);
+//
+//   // Skips the bytes remaining within the current limit and restores the
+//   // |previous| limit returned by the matching PushLimit().
+//   Status<void> PopLimit(std::size_t previous);
+//
+// The previous limit is held by the caller, so limits may nest to any depth
+// and each read is checked against the innermost limit only.
+template <typename Reader>
+using ReaderLimitTest =
+    decltype(std::declval<Reader&>().PushLimit(std::size_t{}),
+             std::declval<Reader&>().PopLimit(std::size_t{}));
+
+// Evaluates to true if Reader supports PushLimit() and PopLimit().
+template <typename Reader>
+using IsLimitReader = IsDetected<ReaderLimitTest, Reader>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TRAITS_IS_LIMIT_READER_H_
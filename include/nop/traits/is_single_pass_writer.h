@@ -0,0 +1,45 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TRAITS_IS_SINGLE_PASS_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_TRAITS_IS_SINGLE_PASS_WRITER_H_
+
+#include <cstddef>
+#include <utility>
+
+#include <nop/traits/is_detected.h>
+
+namespace nop {
+
+// Test expression for writers that serialize in a single pass. Such writers
+// implement the following methods, which reserve a fixed-width size field in
+// the output and later fill it in with the number of bytes written after it:
+//
+//   Status<std::size_t> ReserveSize();
+//   Status<void> PatchSize(std::size_t position);
+//
+// Single-pass writers are not prepared with the total size of each value and
+// must therefore check bounds on every write.
+template <typename Writer>
+using WriterReserveSizeTest = decltype(std::declval<Writer&>().ReserveSize());
+
+// Evaluates to true if Writer supports single-pass serialization.
+template <typename Writer>
+using IsSinglePassWriter = IsDetected<WriterReserveSizeTest, Writer>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TRAITS_IS_SINGLE_PASS_WRITER_H_
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TRAITS_IS_TRUSTED_READER_H_
+#define LIBNOP_INCLUDE_NOP_TRAITS_IS_TRUSTED_READER_H_
+
+#include <utility>
+
+#include <nop/traits/is_detected.h>
+
+namespace nop {
+
+// Test expression for readers whose input is known to have been written from
+// the same type definitions as the values being read. Such readers implement
+// the following method:
+//
+//   bool trusted() const;
+//
+// Encodings skip the prefix and member count validation of their input when
+// the reader passes this test. Bounds checks with Ensure() are still performed,
+// so that truncated input cannot cause reads past its end. Use TrustedReader in
+// nop/utility/trusted_deserializer.h rather than implementing this method
+// directly.
+template <typename Reader>
+using ReaderTrustedTest = decltype(std::declval<const Reader&>().trusted());
+
+// Evaluates to true if Reader reads trusted input.
+template <typename Reader>
+using IsTrustedReader = IsDetected<ReaderTrustedTest, Reader>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TRAITS_IS_TRUSTED_READER_H_
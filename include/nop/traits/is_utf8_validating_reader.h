@@ -0,0 +1,46 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TRAITS_IS_UTF8_VALIDATING_READER_H_
+#define LIBNOP_INCLUDE_NOP_TRAITS_IS_UTF8_VALIDATING_READER_H_
+
+#include <utility>
+
+#include <nop/traits/is_detected.h>
+
+namespace nop {
+
+// Test expression for readers that require decoded strings to be well-formed
+// UTF-8. Such readers implement the following method:
+//
+//   bool validates_utf8() const;
+//
+// Strings and string views of single-byte characters are validated right after
+// their bytes are read, while they are still in cache, and decoding fails with
+// ErrorStatus::InvalidUtf8 if they are malformed. Use Utf8ValidatingReader in
+// nop/utility/utf8_validating_reader.h to add this property to another reader.
+template <typename Reader>
+using ReaderValidatesUtf8Test =
+    decltype(std::declval<const Reader&>().validates_utf8());
+
+// Evaluates to true if Reader requires strings to be valid UTF-8.
+template <typename Reader>
+using IsUtf8ValidatingReader = IsDetected<ReaderValidatesUtf8Test, Reader>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TRAITS_IS_UTF8_VALIDATING_READER_H_
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_BLITTABLE_ARRAY_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_BLITTABLE_ARRAY_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <nop/base/utility.h>
+#include <nop/traits/is_blittable.h>
+
+namespace nop {
+
+// BlittableArray<T> holds a std::vector<T> of a blittable type T, see
+// IsBlittable<T>, that is serialized as the raw bytes of its elements in a
+// single binary container, preceded by a fingerprint of the layout of T.
+// Encoding and decoding are each one copy of the element storage, instead of
+// a prefix and a branch per member of every element, which suits large arrays
+// of small fixed-layout records such as vertices or samples.
+//
+// The layout fingerprint covers the member types, in order, and the size of
+// T; decoding an array written with a different layout fails with
+// ErrorStatus::VersionMismatch. Decoding also accepts the regular encoding of
+// std::vector<T>, so a reader may switch to BlittableArray<T> before its
+// writers do.
+//
+// Example:
+//
+//  struct Vertex {
+//    std::uint32_t id;
+//    float x, y, z;
+//    NOP_STRUCTURE(Vertex, id, x, y, z);
+//  };
+//
+//  struct Mesh {
+//    std::string name;
+//    BlittableArray<Vertex> vertices;
+//    NOP_STRUCTURE(Mesh, name, vertices);
+//  };
+//
+template <typename T, typename Allocator = std::allocator<T>>
+class BlittableArray {
+  static_assert(IsBlittable<T>::value,
+                "Only arrays of blittable types may be written as raw bytes. "
+                "See IsBlittable<T> for the requirements.");
+  static_assert(!IsIntegral<T>::value,
+                "Vectors of integral types are already written as raw bytes; "
+                "use std::vector<T> instead.");
+
+ public:
+  using VectorType = std::vector<T, Allocator>;
+
+  BlittableArray() = default;
+  BlittableArray(const BlittableArray&) = default;
+  BlittableArray(BlittableArray&&) = default;
+  BlittableArray(const VectorType& value) : value_{value} {}
+  BlittableArray(VectorType&& value) : value_{std::move(value)} {}
+
+  BlittableArray& operator=(const BlittableArray&) = default;
+  BlittableArray& operator=(BlittableArray&&) = default;
+
+  VectorType& get() { return value_; }
+  const VectorType& get() const { return value_; }
+
+  VectorType take() { return std::move(value_); }
+
+ private:
+  VectorType value_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_BLITTABLE_ARRAY_H_
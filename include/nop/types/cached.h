@@ -0,0 +1,120 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_CACHED_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_CACHED_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+// Cached<T> holds a value of type T together with its encoded bytes, so that a
+// value serialized many times without changing is encoded only once. Writing a
+// Cached<T> copies the retained bytes with a single writer->Write(), and its
+// encoded size is the length of the bytes.
+//
+// The bytes are produced whenever the value is set, so serializing the same
+// Cached<T> from several threads at once is safe. Modify() applies a change to
+// the value and encodes it again; there is no way to change the value without
+// refreshing the bytes. When a Cached<T> is deserialized, the bytes that were
+// read are retained along with the decoded value. Cached<T> encodes exactly
+// like T, so the two may be used interchangeably on either end of a protocol.
+//
+// Values containing handles must not be wrapped in Cached<T>: handles are
+// pushed to the writer each time they are serialized.
+//
+// Example:
+//
+//  Cached<RoutingTable> routes{LoadRoutes()};
+//
+//  // Each write copies the bytes encoded at construction.
+//  for (auto& peer : peers)
+//    peer.serializer.Write(routes);
+//
+//  routes.Modify([](RoutingTable* table) { table->Add(route); });
+//
+template <typename T>
+class Cached {
+ public:
+  Cached() { Encode(); }
+  Cached(const Cached&) = default;
+  Cached(Cached&&) = default;
+  Cached(const T& value) : value_{value} { Encode(); }
+  Cached(T&& value) : value_{std::move(value)} { Encode(); }
+
+  Cached& operator=(const Cached&) = default;
+  Cached& operator=(Cached&&) = default;
+  Cached& operator=(const T& value) {
+    value_ = value;
+    Encode();
+    return *this;
+  }
+  Cached& operator=(T&& value) {
+    value_ = std::move(value);
+    Encode();
+    return *this;
+  }
+
+  const T& get() const { return value_; }
+  const T& operator*() const { return value_; }
+  const T* operator->() const { return &value_; }
+
+  // Calls |op| with a pointer to the value and encodes the modified value.
+  template <typename Op>
+  void Modify(Op&& op) {
+    std::forward<Op>(op)(&value_);
+    Encode();
+  }
+
+  // Returns the encoded bytes of the value. The bytes are empty only if the
+  // value could not be encoded, in which case writing the value encodes it
+  // directly and reports the error.
+  const std::vector<std::uint8_t>& encoding() const { return encoding_; }
+
+ private:
+  template <typename, typename>
+  friend struct Encoding;
+
+  void Encode() {
+    VectorWriter writer;
+    auto status = writer.Prepare(Encoding<T>::Size(value_));
+    if (status)
+      status = Encoding<T>::Write(value_, &writer);
+
+    if (status)
+      encoding_ = writer.take();
+    else
+      encoding_.clear();
+  }
+
+  // Takes the bytes the value was decoded from.
+  void SetEncoding(std::vector<std::uint8_t>&& encoding) {
+    encoding_ = std::move(encoding);
+  }
+
+  T value_{};
+  std::vector<std::uint8_t> encoding_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_CACHED_H_
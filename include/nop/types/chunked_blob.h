@@ -0,0 +1,84 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_CHUNKED_BLOB_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_CHUNKED_BLOB_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace nop {
+
+// ChunkedBlob holds a large binary payload that is sent as a manifest of
+// content-defined chunks, so that successive versions of a payload that differ
+// only slightly cost little more than their differences to send. When written
+// through a writer that carries a chunk store, such as ChunkStoreWriter, only
+// the chunks the peer does not already hold are sent, and the others are
+// referred to by id; a reader that carries the matching store, such as
+// ChunkStoreReader, reassembles the payload from the chunks it receives and
+// the chunks it kept from earlier messages.
+//
+// Without a chunk store a ChunkedBlob encodes exactly like
+// std::vector<std::uint8_t>, and plain binary data is always accepted when
+// reading a ChunkedBlob.
+//
+// Example:
+//
+//  struct Artifact {
+//    std::string name;
+//    std::uint64_t version;
+//    ChunkedBlob contents;
+//    NOP_STRUCTURE(Artifact, name, version, contents);
+//  };
+//
+class ChunkedBlob {
+ public:
+  ChunkedBlob() = default;
+  ChunkedBlob(const ChunkedBlob&) = default;
+  ChunkedBlob(ChunkedBlob&&) = default;
+  ChunkedBlob(std::vector<std::uint8_t> data) : data_{std::move(data)} {}
+
+  ChunkedBlob& operator=(const ChunkedBlob&) = default;
+  ChunkedBlob& operator=(ChunkedBlob&&) = default;
+
+  const std::vector<std::uint8_t>& get() const { return data_; }
+  std::vector<std::uint8_t>& get() { return data_; }
+  const std::vector<std::uint8_t>& operator*() const { return data_; }
+  std::vector<std::uint8_t>& operator*() { return data_; }
+  const std::vector<std::uint8_t>* operator->() const { return &data_; }
+  std::vector<std::uint8_t>* operator->() { return &data_; }
+
+  const std::uint8_t* data() const { return data_.data(); }
+  std::size_t size() const { return data_.size(); }
+  bool empty() const { return data_.empty(); }
+
+  // Returns the payload, leaving the blob empty.
+  std::vector<std::uint8_t> take() { return std::move(data_); }
+
+  bool operator==(const ChunkedBlob& other) const {
+    return data_ == other.data_;
+  }
+  bool operator!=(const ChunkedBlob& other) const { return !(*this == other); }
+
+ private:
+  std::vector<std::uint8_t> data_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_CHUNKED_BLOB_H_
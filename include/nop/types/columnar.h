@@ -0,0 +1,75 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_COLUMNAR_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_COLUMNAR_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace nop {
+
+// Columnar<T> holds a std::vector<T> of a serializable structure type T that is
+// serialized one column per member instead of one structure per element. The
+// values of each arithmetic or enum member are stored together as raw bytes in
+// a single binary container, so a column is written and read with one copy and
+// compresses far better than interleaved rows. Raw values are fixed width, so
+// small integers take more space than their compact encodings in rows. Other
+// members are stored as an array of their encodings. Individual columns may be decoded with
+// Deserializer::ReadProjected() and a projection of T, skipping the others.
+//
+// The columnar encoding is distinct from that of std::vector<T>, so both ends
+// must agree to use Columnar<T>. Logical buffer members are not supported.
+//
+// Example:
+//
+//  struct Sample {
+//    std::uint64_t timestamp;
+//    std::uint32_t sensor;
+//    float value;
+//    NOP_STRUCTURE(Sample, timestamp, sensor, value);
+//  };
+//
+//  Columnar<Sample> samples{ReadSamples()};
+//  auto status = serializer.Write(samples);
+//
+template <typename T, typename Allocator = std::allocator<T>>
+class Columnar {
+ public:
+  using VectorType = std::vector<T, Allocator>;
+
+  Columnar() = default;
+  Columnar(const Columnar&) = default;
+  Columnar(Columnar&&) = default;
+  Columnar(const VectorType& value) : value_{value} {}
+  Columnar(VectorType&& value) : value_{std::move(value)} {}
+
+  Columnar& operator=(const Columnar&) = default;
+  Columnar& operator=(Columnar&&) = default;
+
+  VectorType& get() { return value_; }
+  const VectorType& get() const { return value_; }
+
+  VectorType take() { return std::move(value_); }
+
+ private:
+  VectorType value_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_COLUMNAR_H_
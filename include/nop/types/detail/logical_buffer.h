@@ -17,6 +17,8 @@
 #ifndef LIBNOP_INCLUDE_NOP_TYPES_DETAIL_LOGICAL_BUFFER_H_
 #define LIBNOP_INCLUDE_NOP_TYPES_DETAIL_LOGICAL_BUFFER_H_
 
+#include <cstddef>
+#include <limits>
 #include <type_traits>
 
 namespace nop {
@@ -21,6 +21,7 @@
 #include <tuple>
 
 #include <nop/base/encoding.h>
+#include <nop/base/size_cache.h>
 #include <nop/base/utility.h>
 #include <nop/traits/is_detected.h>
 #include <nop/types/detail/logical_buffer.h>
@@ -49,6 +50,9 @@ struct MemberPointer<T Class::*, Pointer> {
   static constexpr std::size_t Size(const Class& instance) {
     return Encoding<Type>::Size(Resolve(instance));
   }
+  static constexpr std::size_t Size(const Class& instance, SizeCache* cache) {
+    return CachedSize(Resolve(instance), cache);
+  }
 
   template <typename Writer, typename MemberList>
   static constexpr Status<void> Write(const Class& instance, Writer* writer,
@@ -114,6 +118,10 @@ struct MemberPointer<First Class::*, FirstPointer, Second Class::*,
     const Type pair = Resolve(instance);
     return Encoding<Type>::Size(pair);
   }
+  static constexpr std::size_t Size(const Class& instance,
+                                    SizeCache* /*cache*/) {
+    return Size(instance);
+  }
 
   template <typename Writer, typename MemberList>
   static constexpr Status<void> Write(const Class& instance, Writer* writer,
@@ -158,6 +166,18 @@ struct MemberList {
   using At = typename std::tuple_element<Index, Members>::type;
 };
 
+// Captures a list of MemberPointers whose members are encoded with a fixed
+// width, as defined by NOP_FIXED_STRUCTURE. See nop/base/fixed_structure.h.
+template <typename... MemberPointers>
+struct FixedMemberList : MemberList<MemberPointers...> {};
+
+// Evaluates to true if the given MemberList type is a FixedMemberList.
+template <typename T>
+struct IsFixedMemberList : std::false_type {};
+template <typename... MemberPointers>
+struct IsFixedMemberList<FixedMemberList<MemberPointers...>> : std::true_type {
+};
+
 // Utility to retrieve a traits type that defines a MemberList for type T using
 // ADL. The macros NOP_STRUCTURE, NOP_EXTERNAL_STRUCTURE, and
 // NOP_EXTERNAL_TEMPLATE define the appropriate traits type and a defintion of
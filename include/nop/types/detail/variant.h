@@ -164,7 +164,6 @@ union Union<Type> {
 
   Type& get(TypeTag<Type>) { return first_; }
   const Type& get(TypeTag<Type>) const { return first_; }
-  EmptyVariant get(TypeTag<EmptyVariant>) const { return {}; }
   constexpr std::int32_t index(TypeTag<Type>) const { return 0; }
 
   template <typename... Args>
@@ -178,12 +177,6 @@ union Union<Type> {
     return 0;
   }
 
-  void Destruct(std::int32_t target_index) {
-    if (target_index == index(TypeTag<Type>{})) {
-      (&get(TypeTag<Type>{}))->~Type();
-    }
-  }
-
   template <typename T>
   bool Assign(TypeTag<Type>, std::int32_t target_index, T&& value) {
     if (target_index == 0) {
@@ -209,31 +202,6 @@ union Union<Type> {
     return false;
   }
 
-  template <typename Op>
-  decltype(auto) Visit(std::int32_t target_index, Op&& op) {
-    if (target_index == index(TypeTag<Type>{}))
-      return std::forward<Op>(op)(get(TypeTag<Type>{}));
-    else
-      return std::forward<Op>(op)(get(TypeTag<EmptyVariant>{}));
-  }
-  template <typename Op>
-  decltype(auto) Visit(std::int32_t target_index, Op&& op) const {
-    if (target_index == index(TypeTag<Type>{}))
-      return std::forward<Op>(op)(get(TypeTag<Type>{}));
-    else
-      return std::forward<Op>(op)(get(TypeTag<EmptyVariant>{}));
-  }
-
-  template <typename... Args>
-  bool Become(std::int32_t target_index, Args&&... args) {
-    if (target_index == index(TypeTag<Type>{})) {
-      Construct(TypeTag<Type>{}, std::forward<Args>(args)...);
-      return true;
-    } else {
-      return false;
-    }
-  }
-
  private:
   Type first_;
 };
@@ -329,14 +297,6 @@ union Union<First, Rest...> {
     return 1 + rest_.Construct(std::forward<Args>(args)...);
   }
 
-  void Destruct(std::int32_t target_index) {
-    if (target_index == index(TypeTag<First>{})) {
-      (get(TypeTag<First>{})).~First();
-    } else {
-      rest_.Destruct(target_index - 1);
-    }
-  }
-
   template <typename T>
   bool Assign(TypeTag<First>, std::int32_t target_index, T&& value) {
     if (target_index == 0) {
@@ -366,36 +326,88 @@ union Union<First, Rest...> {
     return rest_.Assign(target_index - 1, std::forward<T>(value));
   }
 
-  // Recursively traverses the union and calls Op on the active value when the
-  // active type is found. If the union is empty Op is called on EmptyVariant.
+ private:
+  First first_;
+  Union<Rest...> rest_;
+};
+
+// Dispatches operations on the active element of a Union through tables of
+// function pointers indexed by the active element index, so that the cost of
+// visiting, destroying, or constructing an element is independent of the number
+// of element types. Slot zero of each table handles the empty index -1.
+template <typename... Types>
+struct UnionDispatch {
+  using UnionType = Union<Types...>;
+
+  enum : std::int32_t { kSize = sizeof...(Types) };
+
   template <typename Op>
-  decltype(auto) Visit(std::int32_t target_index, Op&& op) {
-    if (target_index == index(TypeTag<First>{}))
-      return std::forward<Op>(op)(get(TypeTag<First>{}));
-    else
-      return rest_.Visit(target_index - 1, std::forward<Op>(op));
+  using Return = decltype(std::declval<Op>()(std::declval<EmptyVariant>()));
+
+  template <typename U, typename Op>
+  static Return<Op> Visit(U& value, std::int32_t index, Op&& op) {
+    return Visit(value, index, std::forward<Op>(op),
+                 std::index_sequence_for<Types...>{});
   }
-  template <typename Op>
-  decltype(auto) Visit(std::int32_t target_index, Op&& op) const {
-    if (target_index == index(TypeTag<First>{}))
-      return std::forward<Op>(op)(get(TypeTag<First>{}));
-    else
-      return rest_.Visit(target_index - 1, std::forward<Op>(op));
+
+  static void Destruct(UnionType& value, std::int32_t index) {
+    Destruct(value, index, std::index_sequence_for<Types...>{});
   }
 
   template <typename... Args>
-  bool Become(std::int32_t target_index, Args&&... args) {
-    if (target_index == index(TypeTag<First>{})) {
-      Construct(TypeTag<First>{}, std::forward<Args>(args)...);
-      return true;
-    } else {
-      return rest_.Become(target_index - 1, std::forward<Args>(args)...);
-    }
+  static bool Become(UnionType& value, std::int32_t index, Args&&... args) {
+    if (index < 0 || index >= kSize)
+      return false;
+
+    Become(value, index, std::index_sequence_for<Types...>{},
+           std::forward<Args>(args)...);
+    return true;
   }
 
  private:
-  First first_;
-  Union<Rest...> rest_;
+  template <typename U, typename Op>
+  static Return<Op> VisitEmpty(U& /*value*/, Op&& op) {
+    return std::forward<Op>(op)(EmptyVariant{});
+  }
+  template <std::size_t I, typename U, typename Op>
+  static Return<Op> VisitElement(U& value, Op&& op) {
+    return std::forward<Op>(op)(value.get(TypeTagForIndex<I, Types...>{}));
+  }
+  template <typename U, typename Op, std::size_t... Is>
+  static Return<Op> Visit(U& value, std::int32_t index, Op&& op,
+                          std::index_sequence<Is...>) {
+    using Thunk = Return<Op> (*)(U&, Op&&);
+    static constexpr Thunk kTable[] = {&VisitEmpty<U, Op>,
+                                       &VisitElement<Is, U, Op>...};
+    return kTable[index + 1](value, std::forward<Op>(op));
+  }
+
+  static void DestructEmpty(UnionType& /*value*/) {}
+  template <std::size_t I>
+  static void DestructElement(UnionType& value) {
+    using Type = TypeForIndex<I, Types...>;
+    value.get(TypeTag<Type>{}).~Type();
+  }
+  template <std::size_t... Is>
+  static void Destruct(UnionType& value, std::int32_t index,
+                       std::index_sequence<Is...>) {
+    using Thunk = void (*)(UnionType&);
+    static constexpr Thunk kTable[] = {&DestructEmpty, &DestructElement<Is>...};
+    kTable[index + 1](value);
+  }
+
+  template <std::size_t I, typename... Args>
+  static void BecomeElement(UnionType& value, Args&&... args) {
+    value.Construct(TypeTagForIndex<I, Types...>{},
+                    std::forward<Args>(args)...);
+  }
+  template <std::size_t... Is, typename... Args>
+  static void Become(UnionType& value, std::int32_t index,
+                     std::index_sequence<Is...>, Args&&... args) {
+    using Thunk = void (*)(UnionType&, Args&&...);
+    static constexpr Thunk kTable[] = {&BecomeElement<Is, Args...>...};
+    kTable[index](value, std::forward<Args>(args)...);
+  }
 };
 
 }  // namespace detail
@@ -0,0 +1,292 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_FLAT_HASH_MAP_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_FLAT_HASH_MAP_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace nop {
+
+// FlatHashMap is an unordered associative container that stores its elements
+// contiguously in a vector and finds them through an open-addressing index of
+// small slots with linear probing. Compared with std::unordered_map there is
+// no heap node per element and iteration is a linear scan, which matters for
+// very large lookup tables that are decoded once and then read many times.
+//
+// FlatHashMap uses the same encoding as std::unordered_map, so the two may be
+// used interchangeably on either end of a protocol. Decoding reserves the
+// elements and the index once for the encoded count, bounded by the bytes
+// remaining in the reader, and appends the elements as they are read.
+//
+// Elements are kept in insertion order until one is erased, which moves the
+// last element into its place. Insertion and erasure invalidate iterators and
+// references to elements, and elements are stored as std::pair<Key, T> with a
+// mutable key, which must not be modified through iteration. A map holds at
+// most 2^32 - 1 elements.
+//
+template <typename Key, typename T, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Allocator = std::allocator<std::pair<Key, T>>>
+class FlatHashMap {
+ public:
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<Key, T>;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using allocator_type = Allocator;
+  using container_type = std::vector<value_type, Allocator>;
+  using size_type = std::size_t;
+  using iterator = typename container_type::iterator;
+  using const_iterator = typename container_type::const_iterator;
+
+  FlatHashMap() = default;
+  FlatHashMap(const FlatHashMap&) = default;
+  FlatHashMap(FlatHashMap&&) = default;
+  explicit FlatHashMap(const Allocator& allocator)
+      : elements_{allocator}, slots_{SlotAllocator{allocator}} {}
+  FlatHashMap(std::initializer_list<value_type> elements) {
+    reserve(elements.size());
+    for (const value_type& element : elements)
+      insert(element);
+  }
+
+  FlatHashMap& operator=(const FlatHashMap&) = default;
+  FlatHashMap& operator=(FlatHashMap&&) = default;
+
+  iterator begin() { return elements_.begin(); }
+  iterator end() { return elements_.end(); }
+  const_iterator begin() const { return elements_.begin(); }
+  const_iterator end() const { return elements_.end(); }
+  const_iterator cbegin() const { return elements_.cbegin(); }
+  const_iterator cend() const { return elements_.cend(); }
+
+  bool empty() const { return elements_.empty(); }
+  size_type size() const { return elements_.size(); }
+
+  // Returns the number of slots in the index.
+  size_type bucket_count() const { return slots_.size(); }
+
+  void clear() {
+    elements_.clear();
+    std::fill(slots_.begin(), slots_.end(), Slot{});
+  }
+
+  // Makes room for |count| elements without growing the index again.
+  void reserve(size_type count) {
+    elements_.reserve(count);
+    if (SlotCountFor(count) > slots_.size())
+      Rehash(SlotCountFor(count));
+  }
+
+  iterator find(const Key& key) {
+    const std::size_t slot = FindSlot(key, HashOf(key));
+    return slot != kNotFound ? begin() + slots_[slot].index - 1 : end();
+  }
+  const_iterator find(const Key& key) const {
+    const std::size_t slot = FindSlot(key, HashOf(key));
+    return slot != kNotFound ? begin() + slots_[slot].index - 1 : end();
+  }
+
+  size_type count(const Key& key) const { return find(key) != end() ? 1 : 0; }
+  bool contains(const Key& key) const { return find(key) != end(); }
+
+  // Inserts |element| unless an element with the same key exists. Returns the
+  // position of the element with the key and whether it was inserted.
+  std::pair<iterator, bool> insert(value_type element) {
+    const std::uint32_t hash = HashOf(element.first);
+    const std::size_t slot = FindSlot(element.first, hash);
+    if (slot != kNotFound)
+      return {begin() + slots_[slot].index - 1, false};
+
+    Add(std::move(element), hash);
+    return {end() - 1, true};
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return insert(value_type(std::forward<Args>(args)...));
+  }
+
+  T& operator[](const Key& key) {
+    const std::uint32_t hash = HashOf(key);
+    const std::size_t slot = FindSlot(key, hash);
+    if (slot != kNotFound)
+      return elements_[slots_[slot].index - 1].second;
+
+    Add(value_type{key, T{}}, hash);
+    return elements_.back().second;
+  }
+
+  // Removes the element with |key|, moving the last element into its place.
+  size_type erase(const Key& key) {
+    const std::size_t slot = FindSlot(key, HashOf(key));
+    if (slot == kNotFound)
+      return 0;
+
+    const std::uint32_t index = slots_[slot].index - 1;
+    RemoveSlot(slot);
+
+    const std::uint32_t last = static_cast<std::uint32_t>(size() - 1);
+    if (index != last) {
+      const std::size_t last_slot =
+          FindSlot(elements_[last].first, HashOf(elements_[last].first));
+      slots_[last_slot].index = index + 1;
+      elements_[index] = std::move(elements_[last]);
+    }
+    elements_.pop_back();
+    return 1;
+  }
+
+  hasher hash_function() const { return hash_; }
+  key_equal key_eq() const { return key_equal_; }
+  allocator_type get_allocator() const { return elements_.get_allocator(); }
+
+  // Returns the elements, in insertion order unless elements were erased.
+  const container_type& elements() const { return elements_; }
+
+  // Maps are equal when they hold the same elements in any order.
+  bool operator==(const FlatHashMap& other) const {
+    if (size() != other.size())
+      return false;
+    for (const value_type& element : elements_) {
+      const_iterator position = other.find(element.first);
+      if (position == other.end() || !(position->second == element.second))
+        return false;
+    }
+    return true;
+  }
+  bool operator!=(const FlatHashMap& other) const { return !(*this == other); }
+
+ private:
+  template <typename, typename>
+  friend struct Encoding;
+
+  // An index slot holds the position of an element plus one, or zero if the
+  // slot is empty, and the hash of its key.
+  struct Slot {
+    std::uint32_t index{0};
+    std::uint32_t hash{0};
+  };
+
+  using SlotAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+
+  enum : std::size_t {
+    kNotFound = static_cast<std::size_t>(-1),
+    kMinSlotCount = 8,
+  };
+
+  // Mixes the hash of |key| so that keys with patterned hashes, such as
+  // integers under std::hash, are spread over the slots.
+  std::uint32_t HashOf(const Key& key) const {
+    const std::uint64_t hash =
+        static_cast<std::uint64_t>(hash_(key)) * 0x9e3779b97f4a7c15ull;
+    return static_cast<std::uint32_t>(hash >> 32);
+  }
+
+  // Returns the number of slots to hold |count| elements at a load factor of
+  // at most 7/8.
+  static std::size_t SlotCountFor(std::size_t count) {
+    std::size_t slot_count = kMinSlotCount;
+    while (slot_count - slot_count / 8 < count)
+      slot_count *= 2;
+    return slot_count;
+  }
+
+  std::size_t FindSlot(const Key& key, std::uint32_t hash) const {
+    if (slots_.empty())
+      return kNotFound;
+
+    const std::size_t mask = slots_.size() - 1;
+    for (std::size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+      const Slot& entry = slots_[slot];
+      if (entry.index == 0)
+        return kNotFound;
+      else if (entry.hash == hash &&
+               key_equal_(elements_[entry.index - 1].first, key))
+        return slot;
+    }
+  }
+
+  // Places an element at |index| in the first free slot for |hash|.
+  void PlaceSlot(std::uint32_t index, std::uint32_t hash) {
+    const std::size_t mask = slots_.size() - 1;
+    std::size_t slot = hash & mask;
+    while (slots_[slot].index != 0)
+      slot = (slot + 1) & mask;
+    slots_[slot] = Slot{index + 1, hash};
+  }
+
+  // Empties |slot|, shifting back the slots after it in the same probe
+  // sequence so that lookups do not need tombstones.
+  void RemoveSlot(std::size_t slot) {
+    const std::size_t mask = slots_.size() - 1;
+    std::size_t next = (slot + 1) & mask;
+    while (slots_[next].index != 0) {
+      const std::size_t home = slots_[next].hash & mask;
+      if (((next - home) & mask) >= ((next - slot) & mask)) {
+        slots_[slot] = slots_[next];
+        slot = next;
+      }
+      next = (next + 1) & mask;
+    }
+    slots_[slot] = Slot{};
+  }
+
+  // Appends |element|, whose key is not in the map.
+  void Add(value_type&& element, std::uint32_t hash) {
+    if (SlotCountFor(size() + 1) > slots_.size())
+      Rehash(SlotCountFor(size() + 1) * 2);
+
+    elements_.push_back(std::move(element));
+    PlaceSlot(static_cast<std::uint32_t>(size() - 1), hash);
+  }
+
+  // Appends |element| unless its key is already in the map, as decoding
+  // std::unordered_map does. Returns true if the element was added.
+  bool Append(value_type&& element) {
+    const std::uint32_t hash = HashOf(element.first);
+    if (FindSlot(element.first, hash) != kNotFound)
+      return false;
+
+    Add(std::move(element), hash);
+    return true;
+  }
+
+  void Rehash(std::size_t slot_count) {
+    slots_.assign(slot_count, Slot{});
+    for (std::size_t i = 0; i < elements_.size(); i++)
+      PlaceSlot(static_cast<std::uint32_t>(i), HashOf(elements_[i].first));
+  }
+
+  container_type elements_;
+  std::vector<Slot, SlotAllocator> slots_;
+  Hash hash_;
+  KeyEqual key_equal_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_FLAT_HASH_MAP_H_
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_FLAT_MAP_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_FLAT_MAP_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace nop {
+
+// FlatMap is an associative container that keeps its elements in a vector
+// sorted by key. Lookups are binary searches over contiguous storage, which is
+// cache friendly for maps that are decoded once and then read many times.
+// Inserting into the middle of a FlatMap moves the elements after it, so it is
+// best suited to maps built in key order, such as by deserialization.
+//
+// FlatMap uses the same encoding as std::map, so the two may be used
+// interchangeably on either end of a protocol. Because std::map writes its
+// pairs in key order, decoding a FlatMap is a sequence of appends and a check
+// that each key is greater than the last; unsorted input is sorted once after
+// it has been read.
+//
+// Unlike std::map, insertion and erasure invalidate iterators and references
+// to other elements, and elements are stored as std::pair<Key, T> with a
+// mutable key, which must not be modified through iteration.
+//
+template <typename Key, typename T, typename Compare = std::less<Key>,
+          typename Allocator = std::allocator<std::pair<Key, T>>>
+class FlatMap {
+ public:
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<Key, T>;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using container_type = std::vector<value_type, Allocator>;
+  using size_type = std::size_t;
+  using iterator = typename container_type::iterator;
+  using const_iterator = typename container_type::const_iterator;
+
+  FlatMap() = default;
+  FlatMap(const FlatMap&) = default;
+  FlatMap(FlatMap&&) = default;
+  explicit FlatMap(const Allocator& allocator) : elements_{allocator} {}
+  FlatMap(std::initializer_list<value_type> elements,
+          const Compare& compare = Compare{})
+      : compare_{compare} {
+    for (const value_type& element : elements)
+      insert(element);
+  }
+
+  FlatMap& operator=(const FlatMap&) = default;
+  FlatMap& operator=(FlatMap&&) = default;
+
+  iterator begin() { return elements_.begin(); }
+  iterator end() { return elements_.end(); }
+  const_iterator begin() const { return elements_.begin(); }
+  const_iterator end() const { return elements_.end(); }
+  const_iterator cbegin() const { return elements_.cbegin(); }
+  const_iterator cend() const { return elements_.cend(); }
+
+  bool empty() const { return elements_.empty(); }
+  size_type size() const { return elements_.size(); }
+  void clear() { elements_.clear(); }
+  void reserve(size_type count) { elements_.reserve(count); }
+
+  iterator lower_bound(const Key& key) {
+    return std::lower_bound(elements_.begin(), elements_.end(), key,
+                            KeyCompare{compare_});
+  }
+  const_iterator lower_bound(const Key& key) const {
+    return std::lower_bound(elements_.begin(), elements_.end(), key,
+                            KeyCompare{compare_});
+  }
+
+  iterator find(const Key& key) {
+    iterator position = lower_bound(key);
+    return Matches(position, key) ? position : end();
+  }
+  const_iterator find(const Key& key) const {
+    const_iterator position = lower_bound(key);
+    return Matches(position, key) ? position : end();
+  }
+
+  size_type count(const Key& key) const { return find(key) != end() ? 1 : 0; }
+
+  // Inserts |element| unless an element with the same key exists. Returns the
+  // position of the element with the key and whether it was inserted.
+  std::pair<iterator, bool> insert(value_type element) {
+    iterator position = lower_bound(element.first);
+    if (Matches(position, element.first))
+      return {position, false};
+    return {elements_.insert(position, std::move(element)), true};
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return insert(value_type(std::forward<Args>(args)...));
+  }
+
+  T& operator[](const Key& key) {
+    iterator position = lower_bound(key);
+    if (!Matches(position, key))
+      position = elements_.insert(position, value_type{key, T{}});
+    return position->second;
+  }
+
+  size_type erase(const Key& key) {
+    iterator position = find(key);
+    if (position == end())
+      return 0;
+    elements_.erase(position);
+    return 1;
+  }
+  iterator erase(const_iterator position) { return elements_.erase(position); }
+
+  key_compare key_comp() const { return compare_; }
+  allocator_type get_allocator() const { return elements_.get_allocator(); }
+
+  // Returns the sorted elements.
+  const container_type& elements() const { return elements_; }
+
+  bool operator==(const FlatMap& other) const {
+    return elements_ == other.elements_;
+  }
+  bool operator!=(const FlatMap& other) const { return !(*this == other); }
+
+ private:
+  template <typename, typename>
+  friend struct Encoding;
+
+  struct KeyCompare {
+    const Compare& compare;
+
+    bool operator()(const value_type& element, const Key& key) const {
+      return compare(element.first, key);
+    }
+    bool operator()(const value_type& a, const value_type& b) const {
+      return compare(a.first, b.first);
+    }
+  };
+
+  template <typename Iterator>
+  bool Matches(Iterator position, const Key& key) const {
+    return position != elements_.end() && !compare_(key, position->first);
+  }
+
+  // Appends |element| after the existing elements, without ordering them.
+  // Returns true if the key of |element| is greater than the last key.
+  bool Append(value_type&& element) {
+    const bool ordered =
+        elements_.empty() || compare_(elements_.back().first, element.first);
+    elements_.push_back(std::move(element));
+    return ordered;
+  }
+
+  // Restores the order of elements added by Append(), keeping the first of
+  // any elements with equal keys, as std::map does when decoding.
+  void Sort() {
+    KeyCompare compare{compare_};
+    std::stable_sort(elements_.begin(), elements_.end(), compare);
+    auto last = std::unique(elements_.begin(), elements_.end(),
+                            [this](const value_type& a, const value_type& b) {
+                              return !compare_(a.first, b.first);
+                            });
+    elements_.erase(last, elements_.end());
+  }
+
+  container_type elements_;
+  Compare compare_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_FLAT_MAP_H_
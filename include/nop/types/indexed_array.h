@@ -0,0 +1,79 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_INDEXED_ARRAY_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_INDEXED_ARRAY_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// IndexedArray<T> holds a std::vector<T> that is serialized with the indexed
+// array encoding: the elements are preceded by a table of their byte offsets,
+// so that a reader holding the encoded array in memory may locate and decode
+// any element without decoding the elements before it. See IndexedArrayView
+// for random access and ArrayCursor::Seek() for skipping ahead on a stream.
+//
+// The indexed encoding is accepted wherever std::vector<T> is expected, so a
+// writer may switch a large array to IndexedArray<T> without changing readers
+// that decode it in order. Only non-integral element types are supported;
+// arrays of integral types are stored contiguously and are already randomly
+// accessible.
+//
+// Offsets are computed from the encoded size of each element, so element types
+// must not contain handles, whose encoding depends on the serializer.
+//
+// Example:
+//
+//  struct Archive {
+//    std::string name;
+//    IndexedArray<Record> records;
+//    NOP_STRUCTURE(Archive, name, records);
+//  };
+//
+template <typename T, typename Allocator = std::allocator<T>>
+class IndexedArray {
+  static_assert(!IsIntegral<T>::value,
+                "Arrays of integral types are already randomly accessible.");
+
+ public:
+  using VectorType = std::vector<T, Allocator>;
+
+  IndexedArray() = default;
+  IndexedArray(const IndexedArray&) = default;
+  IndexedArray(IndexedArray&&) = default;
+  IndexedArray(const VectorType& value) : value_{value} {}
+  IndexedArray(VectorType&& value) : value_{std::move(value)} {}
+
+  IndexedArray& operator=(const IndexedArray&) = default;
+  IndexedArray& operator=(IndexedArray&&) = default;
+
+  VectorType& get() { return value_; }
+  const VectorType& get() const { return value_; }
+
+  VectorType take() { return std::move(value_); }
+
+ private:
+  VectorType value_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_INDEXED_ARRAY_H_
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_INLINE_STRING_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_INLINE_STRING_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include <nop/types/inline_vector.h>
+
+namespace nop {
+
+// InlineString<N> is a string of char that keeps up to N characters inside the
+// object and moves them to the heap only when it grows longer, so that short
+// strings such as names and keys decode without allocating. The characters are
+// always terminated by a NUL, which is not counted in the size.
+//
+// InlineString<N> uses the same encoding as std::string, so the two may be used
+// interchangeably on either end of a protocol.
+//
+// Example:
+//
+//  struct Tag {
+//    InlineString<23> key;
+//    InlineString<23> value;
+//    NOP_STRUCTURE(Tag, key, value);
+//  };
+//
+template <std::size_t N>
+class InlineString {
+ public:
+  using value_type = char;
+  using size_type = std::size_t;
+  using iterator = char*;
+  using const_iterator = const char*;
+
+  enum : std::size_t { InlineCapacity = N };
+
+  InlineString() : chars_(1, '\0') {}
+  InlineString(const char* string, size_type length) : InlineString() {
+    assign(string, length);
+  }
+  InlineString(const char* string)
+      : InlineString(string, std::strlen(string)) {}
+  InlineString(const std::string& string)
+      : InlineString(string.data(), string.size()) {}
+
+  InlineString(const InlineString&) = default;
+  InlineString(InlineString&& other) : chars_{std::move(other.chars_)} {
+    other.chars_.push_back('\0');
+  }
+
+  InlineString& operator=(const InlineString&) = default;
+  InlineString& operator=(InlineString&& other) {
+    if (this != &other) {
+      chars_ = std::move(other.chars_);
+      other.chars_.push_back('\0');
+    }
+    return *this;
+  }
+  InlineString& operator=(const char* string) {
+    return assign(string, std::strlen(string));
+  }
+  InlineString& operator=(const std::string& string) {
+    return assign(string.data(), string.size());
+  }
+
+  char* data() { return chars_.data(); }
+  const char* data() const { return chars_.data(); }
+  const char* c_str() const { return chars_.data(); }
+
+  iterator begin() { return data(); }
+  iterator end() { return data() + size(); }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + size(); }
+
+  char& operator[](size_type index) { return chars_[index]; }
+  const char& operator[](size_type index) const { return chars_[index]; }
+
+  bool empty() const { return size() == 0; }
+  size_type size() const { return chars_.size() - 1; }
+  size_type length() const { return size(); }
+  size_type capacity() const { return chars_.capacity() - 1; }
+
+  // Returns true if the characters are stored inside the object.
+  bool is_inline() const { return chars_.is_inline(); }
+
+  void reserve(size_type length) { chars_.reserve(length + 1); }
+
+  void resize(size_type length, char value = '\0') {
+    chars_.back() = value;
+    chars_.resize(length + 1, value);
+    chars_.back() = '\0';
+  }
+
+  void clear() { resize(0); }
+
+  InlineString& assign(const char* string, size_type length) {
+    chars_.clear();
+    chars_.reserve(length + 1);
+    for (size_type i = 0; i < length; i++)
+      chars_.push_back(string[i]);
+    chars_.push_back('\0');
+    return *this;
+  }
+
+  InlineString& append(const char* string, size_type length) {
+    chars_.pop_back();
+    chars_.reserve(chars_.size() + length + 1);
+    for (size_type i = 0; i < length; i++)
+      chars_.push_back(string[i]);
+    chars_.push_back('\0');
+    return *this;
+  }
+
+  void push_back(char value) {
+    chars_.back() = value;
+    chars_.push_back('\0');
+  }
+
+  std::string str() const { return std::string(data(), size()); }
+
+  int compare(const char* string, size_type length) const {
+    const int result = std::char_traits<char>::compare(
+        data(), string, std::min(size(), length));
+    if (result != 0)
+      return result;
+    return size() < length ? -1 : size() > length ? 1 : 0;
+  }
+
+  bool operator==(const InlineString& other) const {
+    return compare(other.data(), other.size()) == 0;
+  }
+  bool operator!=(const InlineString& other) const { return !(*this == other); }
+  bool operator<(const InlineString& other) const {
+    return compare(other.data(), other.size()) < 0;
+  }
+
+  bool operator==(const std::string& other) const {
+    return compare(other.data(), other.size()) == 0;
+  }
+  bool operator!=(const std::string& other) const { return !(*this == other); }
+
+  bool operator==(const char* other) const {
+    return compare(other, std::strlen(other)) == 0;
+  }
+  bool operator!=(const char* other) const { return !(*this == other); }
+
+ private:
+  // Holds the characters followed by the NUL terminator.
+  InlineVector<char, N + 1> chars_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_INLINE_STRING_H_
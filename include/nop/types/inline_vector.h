@@ -0,0 +1,275 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_INLINE_VECTOR_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_INLINE_VECTOR_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace nop {
+
+// InlineVector<T, N> is a sequence container that keeps up to N elements in
+// storage inside the object and moves them to the heap only when it grows
+// beyond that. Messages whose lists are usually short then decode without
+// allocating, while longer lists still work.
+//
+// InlineVector<T, N> uses the same encoding as std::vector<T>, so the two may
+// be used interchangeably on either end of a protocol. The capacity N is not
+// part of the encoding.
+//
+// Moving an InlineVector moves its elements one by one unless they are on the
+// heap. Growing beyond the current capacity, including the first spill to the
+// heap, invalidates iterators and references to the elements. Once spilled,
+// the elements stay on the heap until the vector is destroyed or shrunk with
+// shrink_to_fit().
+//
+// Example:
+//
+//  struct Order {
+//    std::uint64_t id;
+//    InlineVector<LineItem, 8> items;
+//    NOP_STRUCTURE(Order, id, items);
+//  };
+//
+template <typename T, std::size_t N>
+class InlineVector {
+  static_assert(N > 0, "The inline capacity must be at least one element.");
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  enum : std::size_t { InlineCapacity = N };
+
+  InlineVector() = default;
+  explicit InlineVector(size_type count) { resize(count); }
+  InlineVector(size_type count, const T& value) { resize(count, value); }
+  InlineVector(std::initializer_list<T> elements) {
+    reserve(elements.size());
+    for (const T& element : elements)
+      emplace_back(element);
+  }
+
+  InlineVector(const InlineVector& other) {
+    reserve(other.size());
+    for (const T& element : other)
+      emplace_back(element);
+  }
+  InlineVector(InlineVector&& other) { Take(&other); }
+
+  ~InlineVector() { Release(); }
+
+  InlineVector& operator=(const InlineVector& other) {
+    if (this != &other) {
+      clear();
+      reserve(other.size());
+      for (const T& element : other)
+        emplace_back(element);
+    }
+    return *this;
+  }
+  InlineVector& operator=(InlineVector&& other) {
+    if (this != &other) {
+      Release();
+      Take(&other);
+    }
+    return *this;
+  }
+  InlineVector& operator=(std::initializer_list<T> elements) {
+    clear();
+    reserve(elements.size());
+    for (const T& element : elements)
+      emplace_back(element);
+    return *this;
+  }
+
+  T* data() { return heap_ ? heap_ : InlineData(); }
+  const T* data() const { return heap_ ? heap_ : InlineData(); }
+
+  iterator begin() { return data(); }
+  iterator end() { return data() + size_; }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + size_; }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  T& operator[](size_type index) { return data()[index]; }
+  const T& operator[](size_type index) const { return data()[index]; }
+  T& front() { return data()[0]; }
+  const T& front() const { return data()[0]; }
+  T& back() { return data()[size_ - 1]; }
+  const T& back() const { return data()[size_ - 1]; }
+
+  bool empty() const { return size_ == 0; }
+  size_type size() const { return size_; }
+  size_type capacity() const { return capacity_; }
+
+  // Returns true if the elements are stored inside the object.
+  bool is_inline() const { return heap_ == nullptr; }
+
+  void reserve(size_type count) {
+    if (count > capacity_)
+      Reallocate(count);
+  }
+
+  // Moves the elements back inside the object if they fit, or releases unused
+  // heap capacity otherwise.
+  void shrink_to_fit() {
+    if (heap_ && size_ < capacity_)
+      Reallocate(size_);
+  }
+
+  void resize(size_type count) {
+    Truncate(count);
+    reserve(count);
+    while (size_ < count)
+      emplace_back();
+  }
+  void resize(size_type count, const T& value) {
+    Truncate(count);
+    reserve(count);
+    while (size_ < count)
+      emplace_back(value);
+  }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    if (size_ == capacity_) {
+      // Construct the new element before moving the others, in case the
+      // arguments refer to one of them.
+      const size_type capacity = std::max<size_type>(2 * capacity_, 1);
+      T* storage = Allocate(capacity);
+      ::new (storage + size_) T(std::forward<Args>(args)...);
+      MoveTo(storage, capacity);
+    } else {
+      ::new (data() + size_) T(std::forward<Args>(args)...);
+    }
+    return data()[size_++];
+  }
+
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+  void pop_back() { data()[--size_].~T(); }
+
+  // Removes the elements in [first, last), returning the position after them.
+  iterator erase(const_iterator first, const_iterator last) {
+    T* begin_element = data() + (first - data());
+    T* end_element = data() + (last - data());
+    T* new_end = std::move(end_element, end(), begin_element);
+    Truncate(new_end - data());
+    return begin_element;
+  }
+  iterator erase(const_iterator position) {
+    return erase(position, position + 1);
+  }
+
+  // Destroys the elements, keeping the capacity.
+  void clear() { Truncate(0); }
+
+  bool operator==(const InlineVector& other) const {
+    return size_ == other.size_ && std::equal(begin(), end(), other.begin());
+  }
+  bool operator!=(const InlineVector& other) const { return !(*this == other); }
+
+ private:
+  using Storage = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+  T* InlineData() { return reinterpret_cast<T*>(inline_); }
+  const T* InlineData() const { return reinterpret_cast<const T*>(inline_); }
+
+  static T* Allocate(size_type capacity) {
+    return std::allocator<T>{}.allocate(capacity);
+  }
+
+  // Destroys the elements past the first |count|.
+  void Truncate(size_type count) {
+    while (size_ > count)
+      pop_back();
+  }
+
+  // Moves the elements into |storage|, which holds |capacity| elements, or
+  // inside the object if |storage| is null, and frees the current heap
+  // storage.
+  void MoveTo(T* storage, size_type capacity) {
+    T* destination = storage ? storage : InlineData();
+    T* source = data();
+    for (size_type i = 0; i < size_; i++) {
+      ::new (destination + i) T(std::move(source[i]));
+      source[i].~T();
+    }
+
+    if (heap_)
+      std::allocator<T>{}.deallocate(heap_, capacity_);
+    heap_ = storage;
+    capacity_ = storage ? capacity : N;
+  }
+
+  // Moves the elements to storage of |capacity| elements, inside the object
+  // if they fit.
+  void Reallocate(size_type capacity) {
+    if (capacity <= N)
+      MoveTo(nullptr, N);
+    else
+      MoveTo(Allocate(capacity), capacity);
+  }
+
+  // Destroys the elements and frees the heap storage.
+  void Release() {
+    clear();
+    if (heap_)
+      std::allocator<T>{}.deallocate(heap_, capacity_);
+    heap_ = nullptr;
+    capacity_ = N;
+  }
+
+  // Takes the elements of |other|, which must be released, leaving it empty.
+  void Take(InlineVector* other) {
+    if (other->heap_) {
+      heap_ = other->heap_;
+      size_ = other->size_;
+      capacity_ = other->capacity_;
+      other->heap_ = nullptr;
+      other->size_ = 0;
+      other->capacity_ = N;
+    } else {
+      for (T& element : *other)
+        emplace_back(std::move(element));
+      other->clear();
+    }
+  }
+
+  Storage inline_[N];
+  T* heap_{nullptr};
+  size_type size_{0};
+  size_type capacity_{N};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_INLINE_VECTOR_H_
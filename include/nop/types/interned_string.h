@@ -0,0 +1,90 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_INTERNED_STRING_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_INTERNED_STRING_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace nop {
+
+// InternedString is an immutable string that is written once per session and
+// then referred to by id. When written through a writer that carries a string
+// dictionary, such as StringDictionaryWriter, the first occurrence of each
+// string defines it in the dictionary and later occurrences are written as a
+// small reference. Readers that carry a matching dictionary decode references
+// to the same shared string instance, so repeated strings are allocated once.
+//
+// Without a dictionary an InternedString encodes exactly like std::string, and
+// plain strings are always accepted when reading an InternedString.
+//
+// Example:
+//
+//  struct Sample {
+//    InternedString host;
+//    InternedString metric;
+//    double value;
+//    NOP_STRUCTURE(Sample, host, metric, value);
+//  };
+//
+class InternedString {
+ public:
+  InternedString() : value_{Empty()} {}
+  InternedString(const InternedString&) = default;
+  InternedString(InternedString&&) = default;
+  InternedString(std::string value)
+      : value_{std::make_shared<const std::string>(std::move(value))} {}
+  InternedString(const char* value) : InternedString{std::string{value}} {}
+  InternedString(std::shared_ptr<const std::string> value)
+      : value_{value ? std::move(value) : Empty()} {}
+
+  InternedString& operator=(const InternedString&) = default;
+  InternedString& operator=(InternedString&&) = default;
+
+  const std::string& get() const { return *value_; }
+  const std::string& operator*() const { return *value_; }
+  const std::string* operator->() const { return value_.get(); }
+
+  // Returns the shared string, which other InternedString instances decoded
+  // from the same dictionary entry also refer to.
+  const std::shared_ptr<const std::string>& shared() const { return value_; }
+
+  bool operator==(const InternedString& other) const {
+    return value_ == other.value_ || *value_ == *other.value_;
+  }
+  bool operator!=(const InternedString& other) const {
+    return !(*this == other);
+  }
+  bool operator<(const InternedString& other) const {
+    return *value_ < *other.value_;
+  }
+
+ private:
+  static const std::shared_ptr<const std::string>& Empty() {
+    static const std::shared_ptr<const std::string> empty =
+        std::make_shared<const std::string>();
+    return empty;
+  }
+
+  std::shared_ptr<const std::string> value_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_INTERNED_STRING_H_
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_LAZY_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_LAZY_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+
+namespace nop {
+
+// Lazy<T> holds a value of type T that is decoded on first access. When a
+// Lazy<T> is deserialized the encoded bytes of the value are kept as they are
+// instead of being decoded, so that large nested values that most consumers
+// never look at cost only a copy of their bytes. The value is decoded the first
+// time get() is called.
+//
+// Serializing a Lazy<T> whose value has not been modified writes the original
+// encoded bytes, making it cheap to pass values through without knowing or
+// decoding their contents. Lazy<T> encodes exactly like T, so the two may be
+// used interchangeably on either end of a protocol.
+//
+// Values containing handles must not be wrapped in Lazy<T>: handle references
+// are only meaningful to the deserializer that received them.
+//
+// Example:
+//
+//  struct Envelope {
+//    std::string destination;
+//    Lazy<std::vector<Record>> records;
+//    NOP_STRUCTURE(Envelope, destination, records);
+//  };
+//
+//  // Routing reads |destination| and forwards |records| without decoding.
+//  auto records = envelope.records.get();
+//  if (records)
+//    Process(*records.get());
+//
+template <typename T>
+class Lazy {
+ public:
+  Lazy() = default;
+  Lazy(const Lazy&) = default;
+  Lazy(Lazy&&) = default;
+  Lazy(const T& value) : value_{value} {}
+  Lazy(T&& value) : value_{std::move(value)} {}
+
+  Lazy& operator=(const Lazy&) = default;
+  Lazy& operator=(Lazy&&) = default;
+  Lazy& operator=(const T& value) {
+    Set(T{value});
+    return *this;
+  }
+  Lazy& operator=(T&& value) {
+    Set(std::move(value));
+    return *this;
+  }
+
+  // Returns a pointer to the value, decoding it from the retained bytes if this
+  // is the first access. The bytes are kept, so serializing the value again
+  // still copies them. Returns an error if the bytes are not a valid encoding
+  // of type T.
+  Status<const T*> get() const {
+    auto status = Decode();
+    if (!status)
+      return status.error();
+
+    const T* value = &value_;
+    return value;
+  }
+
+  // Returns a pointer to the value for modification, decoding it if necessary.
+  // The retained bytes are discarded, since they may no longer match the value.
+  Status<T*> mutable_get() {
+    auto status = Decode();
+    if (!status)
+      return status.error();
+
+    encoding_.clear();
+    T* value = &value_;
+    return value;
+  }
+
+  // Returns true if the value has been decoded or was never encoded.
+  bool is_decoded() const { return decoded_; }
+
+  // Returns the retained encoding of the value, which is empty unless the value
+  // was deserialized and has not been modified since.
+  const std::vector<std::uint8_t>& encoding() const { return encoding_; }
+
+ private:
+  template <typename, typename>
+  friend struct Encoding;
+
+  void Set(T&& value) {
+    value_ = std::move(value);
+    decoded_ = true;
+    encoding_.clear();
+  }
+
+  // Takes |encoding| as the encoded value, which will be decoded on access.
+  void SetEncoding(std::vector<std::uint8_t>&& encoding) {
+    encoding_ = std::move(encoding);
+    decoded_ = false;
+  }
+
+  Status<void> Decode() const {
+    if (decoded_)
+      return {};
+
+    BufferReader reader{encoding_.data(), encoding_.size()};
+    auto status = Encoding<T>::Read(&value_, &reader);
+    if (!status)
+      return status;
+
+    decoded_ = true;
+    return {};
+  }
+
+  mutable T value_{};
+  mutable bool decoded_{true};
+  std::vector<std::uint8_t> encoding_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_LAZY_H_
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_PACKED_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_PACKED_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// Packed<T> holds a std::vector<T> of an integral type T that is serialized
+// with the packed array encoding: the differences between consecutive elements
+// are zigzag encoded and bit-packed in blocks, each using only as many bits as
+// its largest difference needs. Sorted ids, timestamps, and other slowly
+// changing sequences take a small fraction of the space of raw elements.
+//
+// The packed encoding is accepted wherever std::vector<T> of an integral type
+// is expected, so a writer may switch an array to Packed<T> without changing
+// the readers.
+//
+// Example:
+//
+//  struct Series {
+//    Packed<std::uint64_t> timestamps;
+//    std::vector<float> values;
+//    NOP_STRUCTURE(Series, timestamps, values);
+//  };
+//
+template <typename T, typename Allocator = std::allocator<T>>
+class Packed {
+  static_assert(IsIntegral<T>::value,
+                "Only arrays of integral types may be packed.");
+
+ public:
+  using VectorType = std::vector<T, Allocator>;
+
+  Packed() = default;
+  Packed(const Packed&) = default;
+  Packed(Packed&&) = default;
+  Packed(const VectorType& value) : value_{value} {}
+  Packed(VectorType&& value) : value_{std::move(value)} {}
+
+  Packed& operator=(const Packed&) = default;
+  Packed& operator=(Packed&&) = default;
+
+  VectorType& get() { return value_; }
+  const VectorType& get() const { return value_; }
+
+  VectorType take() { return std::move(value_); }
+
+ private:
+  VectorType value_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_PACKED_H_
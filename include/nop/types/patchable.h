@@ -0,0 +1,68 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_PATCHABLE_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_PATCHABLE_H_
+
+#include <cstddef>
+#include <type_traits>
+
+namespace nop {
+
+// Patchable<T, Index> holds an integer that is always encoded with the prefix
+// for the full width of T, so the encoded size of the value does not depend on
+// the value. Messages made of otherwise constant members may then be encoded
+// once, at compile time, into a MessageTemplate that records where the payload
+// of each Patchable member is; see utility/message_template.h. |Index|
+// identifies the field among the patchable fields of a message and must be
+// unique within it.
+//
+// On the receiving end Patchable<T, Index> decodes any encoding of T, and T
+// decodes the encoding of a Patchable<T, Index>, so the two may be used
+// interchangeably.
+template <typename T, std::size_t Index>
+class Patchable {
+  static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value,
+                "Patchable fields must be of an integer type.");
+
+ public:
+  using ValueType = T;
+  enum : std::size_t { FieldIndex = Index };
+
+  constexpr Patchable() = default;
+  constexpr Patchable(const Patchable&) = default;
+  constexpr Patchable(T value) : value_{value} {}
+
+  constexpr Patchable& operator=(const Patchable&) = default;
+  constexpr Patchable& operator=(T value) {
+    value_ = value;
+    return *this;
+  }
+
+  constexpr T get() const { return value_; }
+  constexpr operator T() const { return value_; }
+
+ private:
+  template <typename, typename>
+  friend struct Encoding;
+
+  T value_{};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_PATCHABLE_H_
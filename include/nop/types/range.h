@@ -0,0 +1,87 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_RANGE_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_RANGE_H_
+
+#include <cstddef>
+#include <iterator>
+
+namespace nop {
+
+// Non-owning view of a sequence of elements given by an iterator to the first
+// element and the number of elements. Ranges are write-only: they encode
+// exactly like a std::vector of the element type, so the receiver decodes them
+// into a vector, but let the sender write any sized sequence without first
+// copying it into one.
+//
+// Ranges of integral elements write the bytes of a binary container, in one
+// call when the iterators are pointers, and may use input iterators. Ranges of other elements
+// are traversed once to compute their size and again to write them, so they
+// require forward iterators.
+//
+// Example:
+//
+//  std::deque<Record> records = ...;
+//  auto page = MakeRange(records.begin() + offset, page_size);
+//  auto status = serializer.Write(page);
+//
+template <typename Iterator>
+class Range {
+ public:
+  using value_type = typename std::iterator_traits<Iterator>::value_type;
+  using const_iterator = Iterator;
+
+  constexpr Range() = default;
+  constexpr Range(Iterator begin, std::size_t size)
+      : begin_{begin}, size_{size} {}
+
+  constexpr Range(const Range&) = default;
+  constexpr Range& operator=(const Range&) = default;
+
+  constexpr std::size_t size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+
+  constexpr Iterator begin() const { return begin_; }
+
+ private:
+  Iterator begin_{};
+  std::size_t size_{0};
+};
+
+// Returns a Range over [begin, end).
+template <typename Iterator>
+Range<Iterator> MakeRange(Iterator begin, Iterator end) {
+  return {begin, static_cast<std::size_t>(std::distance(begin, end))};
+}
+
+// Returns a Range over the |size| elements starting at |begin|.
+template <typename Iterator>
+Range<Iterator> MakeRange(Iterator begin, std::size_t size) {
+  return {begin, size};
+}
+
+// Returns a Range over the elements of |container|.
+template <typename Container>
+auto MakeRange(const Container& container)
+    -> Range<decltype(std::begin(container))> {
+  return {std::begin(container), container.size()};
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_RANGE_H_
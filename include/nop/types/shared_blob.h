@@ -0,0 +1,224 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_SHARED_BLOB_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_SHARED_BLOB_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include <nop/status.h>
+#include <nop/types/file_handle.h>
+
+namespace nop {
+
+// SharedBlob holds a large byte payload in a sealed memfd, so that it can be
+// passed to another process on the same host as a file descriptor instead of
+// being copied through a socket. A SharedBlob serializes as the memfd handle
+// plus the offset and length of the payload within it; the receiver maps the
+// range read-only. Writing a 100 MB payload then costs one handle transfer
+// with a writer that supports handles, such as UnixSocketWriter.
+//
+// The sender creates a blob of the required size, fills it through
+// mutable_data(), and seals it, after which neither side can modify or
+// truncate the memfd. Only sealed blobs may be serialized, and the receiver
+// rejects memfds without write and shrink seals, which guarantees that the
+// mapped payload cannot change or disappear while it is being read.
+//
+// SharedBlob requires Linux memfd support. Its encoding is defined in
+// <nop/base/shared_blob.h>, which is not included by <nop/serializer.h>.
+//
+// Example:
+//
+//  auto blob = SharedBlob::Create(frame_size);
+//  if (!blob)
+//    return blob.error();
+//  RenderFrame(blob.get().mutable_data(), frame_size);
+//  auto status = blob.get().Seal();
+//  ...
+//  message.frame = blob.take();
+//  status = serializer.Write(message);
+//
+class SharedBlob {
+ public:
+  SharedBlob() = default;
+  SharedBlob(SharedBlob&& other) { *this = std::move(other); }
+  SharedBlob& operator=(SharedBlob&& other) {
+    if (this != &other) {
+      Unmap();
+      fd_ = std::move(other.fd_);
+      std::swap(offset_, other.offset_);
+      std::swap(size_, other.size_);
+      std::swap(mapping_, other.mapping_);
+      std::swap(mapping_size_, other.mapping_size_);
+      std::swap(data_, other.data_);
+      std::swap(sealed_, other.sealed_);
+    }
+    return *this;
+  }
+
+  SharedBlob(const SharedBlob&) = delete;
+  void operator=(const SharedBlob&) = delete;
+
+  ~SharedBlob() { Unmap(); }
+
+  // Creates an unsealed blob of |size| zero bytes in a new memfd, mapped for
+  // writing. |name| is shown in /proc for debugging.
+  static Status<SharedBlob> Create(std::size_t size,
+                                   const char* name = "nop_shared_blob") {
+    SharedBlob blob;
+    blob.fd_ = UniqueFileHandle{
+        ::memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING)};
+    if (!blob.fd_)
+      return ErrorStatus::SystemError;
+    else if (::ftruncate(blob.fd_.get(), size) < 0)
+      return ErrorStatus::SystemError;
+
+    blob.size_ = size;
+    auto status = blob.MapRange(PROT_READ | PROT_WRITE);
+    if (!status)
+      return status.error();
+
+    return {std::move(blob)};
+  }
+
+  // Creates a sealed blob holding a copy of |size| bytes at |data|.
+  static Status<SharedBlob> Copy(const void* data, std::size_t size) {
+    auto blob = Create(size);
+    if (!blob)
+      return blob;
+
+    if (size > 0)
+      std::memcpy(blob.get().mutable_data(), data, size);
+
+    auto status = blob.get().Seal();
+    if (!status)
+      return status.error();
+
+    return blob;
+  }
+
+  // Maps |size| bytes at |offset| in the memfd |fd| read-only. The memfd must
+  // be sealed against writing and shrinking and must hold the whole range.
+  static Status<SharedBlob> Map(UniqueFileHandle fd, std::uint64_t offset,
+                                std::uint64_t size) {
+    const int seals = ::fcntl(fd.get(), F_GET_SEALS);
+    if (seals < 0 || (seals & kRequiredSeals) != kRequiredSeals)
+      return ErrorStatus::InvalidHandleValue;
+
+    struct stat stat_buf;
+    if (::fstat(fd.get(), &stat_buf) < 0)
+      return ErrorStatus::InvalidHandleValue;
+
+    const std::uint64_t file_size = stat_buf.st_size;
+    if (offset > file_size || size > file_size - offset)
+      return ErrorStatus::InvalidContainerLength;
+
+    SharedBlob blob;
+    blob.fd_ = std::move(fd);
+    blob.offset_ = offset;
+    blob.size_ = size;
+    blob.sealed_ = true;
+    auto status = blob.MapRange(PROT_READ);
+    if (!status)
+      return status.error();
+
+    return {std::move(blob)};
+  }
+
+  // Seals the memfd against further modification and remaps the payload
+  // read-only. Pointers returned by mutable_data() become invalid.
+  Status<void> Seal() {
+    if (sealed_)
+      return {};
+    else if (!fd_)
+      return ErrorStatus::InvalidHandleValue;
+
+    // Writable shared mappings prevent the write seal.
+    Unmap();
+    if (::fcntl(fd_.get(), F_ADD_SEALS, kRequiredSeals | F_SEAL_GROW |
+                                            F_SEAL_SEAL) < 0) {
+      return ErrorStatus::SystemError;
+    }
+
+    sealed_ = true;
+    return MapRange(PROT_READ);
+  }
+
+  bool is_sealed() const { return sealed_; }
+
+  const std::uint8_t* data() const { return data_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Returns a writable pointer to the payload, or nullptr once sealed.
+  std::uint8_t* mutable_data() const { return sealed_ ? nullptr : data_; }
+
+  // Returns the memfd and the offset of the payload within it.
+  FileHandle handle() const { return FileHandle{fd_.get()}; }
+  std::uint64_t offset() const { return offset_; }
+
+ private:
+  enum : int { kRequiredSeals = F_SEAL_WRITE | F_SEAL_SHRINK };
+
+  // Maps the payload, widening the mapping to the enclosing pages.
+  Status<void> MapRange(int protection) {
+    if (size_ == 0)
+      return {};
+
+    const std::uint64_t page_size = ::sysconf(_SC_PAGESIZE);
+    const std::uint64_t base = offset_ & ~(page_size - 1);
+    const std::size_t length = size_ + (offset_ - base);
+
+    void* mapping =
+        ::mmap(nullptr, length, protection, MAP_SHARED, fd_.get(), base);
+    if (mapping == MAP_FAILED)
+      return ErrorStatus::SystemError;
+
+    mapping_ = mapping;
+    mapping_size_ = length;
+    data_ = static_cast<std::uint8_t*>(mapping) + (offset_ - base);
+    return {};
+  }
+
+  void Unmap() {
+    if (mapping_)
+      ::munmap(mapping_, mapping_size_);
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+    data_ = nullptr;
+  }
+
+  UniqueFileHandle fd_;
+  std::uint64_t offset_{0};
+  std::size_t size_{0};
+  void* mapping_{nullptr};
+  std::size_t mapping_size_{0};
+  std::uint8_t* data_{nullptr};
+  bool sealed_{false};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_SHARED_BLOB_H_
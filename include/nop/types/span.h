@@ -0,0 +1,68 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_SPAN_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_SPAN_H_
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace nop {
+
+// Non-owning, read-only view of a contiguous sequence of elements of type T.
+// When deserialized from a reader that supports borrowing, such as
+// BufferReader, the span points directly into the reader's buffer instead of
+// copying the elements; the buffer must outlive the span.
+template <typename T>
+class Span {
+ public:
+  using value_type = T;
+  using const_iterator = const T*;
+
+  constexpr Span() = default;
+  constexpr Span(const T* data, std::size_t size) : data_{data}, size_{size} {}
+  template <std::size_t Size>
+  constexpr Span(const T (&array)[Size]) : data_{array}, size_{Size} {}
+  template <std::size_t Size>
+  constexpr Span(const std::array<T, Size>& array)
+      : data_{array.data()}, size_{Size} {}
+  template <typename Allocator>
+  Span(const std::vector<T, Allocator>& vector)
+      : data_{vector.data()}, size_{vector.size()} {}
+
+  constexpr Span(const Span&) = default;
+  constexpr Span& operator=(const Span&) = default;
+
+  constexpr const T* data() const { return data_; }
+  constexpr std::size_t size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+
+  constexpr const_iterator begin() const { return data_; }
+  constexpr const_iterator end() const { return data_ + size_; }
+
+  constexpr const T& operator[](std::size_t index) const {
+    return data_[index];
+  }
+
+ private:
+  const T* data_{nullptr};
+  std::size_t size_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_SPAN_H_
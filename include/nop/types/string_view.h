@@ -0,0 +1,81 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_STRING_VIEW_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_STRING_VIEW_H_
+
+#include <cstddef>
+#include <string>
+
+namespace nop {
+
+// Non-owning, read-only view of a contiguous sequence of characters, similar to
+// C++17 std::basic_string_view. When deserialized from a reader that supports
+// borrowing, such as BufferReader, the view points directly into the reader's
+// buffer instead of copying the characters; the buffer must outlive the view.
+template <typename CharType, typename Traits = std::char_traits<CharType>>
+class BasicStringView {
+ public:
+  using value_type = CharType;
+  using traits_type = Traits;
+  using const_iterator = const CharType*;
+
+  constexpr BasicStringView() = default;
+  constexpr BasicStringView(const CharType* data, std::size_t size)
+      : data_{data}, size_{size} {}
+  BasicStringView(const CharType* string)
+      : data_{string}, size_{Traits::length(string)} {}
+  template <typename Allocator>
+  BasicStringView(const std::basic_string<CharType, Traits, Allocator>& string)
+      : data_{string.data()}, size_{string.size()} {}
+
+  constexpr BasicStringView(const BasicStringView&) = default;
+  constexpr BasicStringView& operator=(const BasicStringView&) = default;
+
+  constexpr const CharType* data() const { return data_; }
+  constexpr std::size_t size() const { return size_; }
+  constexpr std::size_t length() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+
+  constexpr const_iterator begin() const { return data_; }
+  constexpr const_iterator end() const { return data_ + size_; }
+
+  constexpr const CharType& operator[](std::size_t index) const {
+    return data_[index];
+  }
+
+  std::basic_string<CharType, Traits> to_string() const {
+    return {data_, size_};
+  }
+
+  bool operator==(const BasicStringView& other) const {
+    return size_ == other.size_ &&
+           (size_ == 0 || Traits::compare(data_, other.data_, size_) == 0);
+  }
+  bool operator!=(const BasicStringView& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  const CharType* data_{nullptr};
+  std::size_t size_{0};
+};
+
+using StringView = BasicStringView<char>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_STRING_VIEW_H_
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_TABLE_DELTA_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_TABLE_DELTA_H_
+
+#include <cstdint>
+
+#include <nop/base/encoding.h>
+
+namespace nop {
+
+// TableDelta<Table> describes the changes between two versions of a table, so
+// that a replica holding the previous version can be brought up to date
+// without sending the whole table. Only entries that were added, changed, or
+// cleared are encoded, along with the versions the delta applies between.
+//
+// To write a delta, construct a TableDelta from the previous and current
+// versions of the table. Entries whose value types have operator== are
+// compared to find changes; other active entries are always included.
+//
+// To apply a delta, construct a TableDelta from the replica and its version
+// and read it. The entries in the delta are updated in place and the version
+// is advanced. A delta for a different base version is skipped, leaving the
+// replica untouched, and reading it returns ErrorStatus::VersionMismatch so
+// that the receiver can request a full copy instead. If decoding fails part
+// way through, the replica may be partially updated.
+//
+// Example:
+//
+//  // Sender.
+//  auto status = serializer.Write(
+//      TableDelta<Config>{previous, previous_version, current, version});
+//
+//  // Receiver.
+//  TableDelta<Config> delta{&config, &config_version};
+//  auto status = deserializer.Read(&delta);
+//
+template <typename Table>
+class TableDelta {
+ public:
+  // Describes the changes from |previous| to |current| for writing.
+  TableDelta(const Table& previous, std::uint64_t previous_version,
+             const Table& current, std::uint64_t version)
+      : previous_{&previous},
+        current_{&current},
+        base_version_{previous_version},
+        version_{version} {}
+
+  // Applies the delta read into this object to |table|, which is at version
+  // |*version|.
+  TableDelta(Table* table, std::uint64_t* version)
+      : target_{table}, target_version_{version} {}
+
+  TableDelta(const TableDelta&) = default;
+  TableDelta& operator=(const TableDelta&) = default;
+
+  // Returns the version the delta applies to and the version it produces.
+  // After reading these are the versions found in the delta.
+  std::uint64_t base_version() const { return base_version_; }
+  std::uint64_t version() const { return version_; }
+
+ private:
+  template <typename, typename>
+  friend struct Encoding;
+
+  const Table* previous_{nullptr};
+  const Table* current_{nullptr};
+  Table* target_{nullptr};
+  std::uint64_t* target_version_{nullptr};
+  std::uint64_t base_version_{0};
+  std::uint64_t version_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_TABLE_DELTA_H_
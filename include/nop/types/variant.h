@@ -17,9 +17,11 @@
 #ifndef LIBNOP_INCLUDE_NOP_TYPES_VARIANT_H_
 #define LIBNOP_INCLUDE_NOP_TYPES_VARIANT_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 
 #include <nop/types/detail/variant.h>
 
@@ -59,6 +61,7 @@ class Variant {
   using EnableIfConvertible = detail::EnableIfConvertible<R, T, Types...>;
   template <typename R, typename T>
   using EnableIfAssignable = detail::EnableIfAssignable<R, T, Types...>;
+  using Dispatch = detail::UnionDispatch<std::decay_t<Types>...>;
 
   struct Direct {};
   struct Convert {};
@@ -158,21 +161,23 @@ class Variant {
   void Become(std::int32_t target_index, Args&&... args) {
     if (target_index != index()) {
       Destruct();
-      index_ = value_.Become(target_index, std::forward<Args>(args)...)
+      index_ = Dispatch::Become(value_, target_index,
+                                std::forward<Args>(args)...)
                    ? target_index
                    : kEmptyIndex;
     }
   }
 
   // Invokes |Op| on the active element. If the Variant is empty |Op| is invoked
-  // on EmptyVariant.
+  // on EmptyVariant. The active element is selected with a single indirect call
+  // rather than by testing each element type in turn.
   template <typename Op>
   decltype(auto) Visit(Op&& op) {
-    return value_.Visit(index_, std::forward<Op>(op));
+    return Dispatch::Visit(value_, index_, std::forward<Op>(op));
   }
   template <typename Op>
   decltype(auto) Visit(Op&& op) const {
-    return value_.Visit(index_, std::forward<Op>(op));
+    return Dispatch::Visit(value_, index_, std::forward<Op>(op));
   }
 
   // Index returned when the Variant is empty.
@@ -244,7 +249,7 @@ class Variant {
 
   // Destroys the active element of the Variant.
   void Destruct() {
-    value_.Destruct(index_);
+    Dispatch::Destruct(value_, index_);
     index_ = kEmptyIndex;
   }
 
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_VIEW_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_VIEW_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include <nop/base/fixed_structure.h>
+#include <nop/base/members.h>
+#include <nop/status.h>
+#include <nop/structure.h>
+#include <nop/utility/buffer_reader.h>
+
+namespace nop {
+
+// View<T> reads the members of a fixed structure T, defined with
+// NOP_FIXED_STRUCTURE, directly from its encoding without decoding the rest of
+// the value. Since every member of a fixed structure is at a constant offset,
+// each access reads only the bytes of that member. Nested fixed structures are
+// returned as views of their own.
+//
+// View::Create() checks the prefix of every member once, so that later accesses
+// need no checks. The view refers to the encoded bytes and must not outlive
+// them.
+//
+// Example:
+//
+//  struct Quote {
+//    std::uint64_t timestamp;
+//    std::int64_t bid;
+//    std::int64_t ask;
+//    NOP_FIXED_STRUCTURE(Quote, timestamp, bid, ask);
+//  };
+//
+//  auto view = View<Quote>::Create(data, size);
+//  if (view) {
+//    std::int64_t bid = view.get().Get<NOP_VIEW_MEMBER(Quote, bid)>();
+//    std::uint64_t timestamp = view.get().Get<0>();
+//  }
+//
+template <typename T>
+class View {
+  static_assert(IsFixedStructure<T>::value,
+                "View<T> requires a type defined with NOP_FIXED_STRUCTURE.");
+
+  using Fixed = FixedEncoding<T>;
+  using MemberList = typename Fixed::MemberList;
+
+ public:
+  // The number of bytes of the encoding of T.
+  enum : std::size_t { Size = Fixed::Size };
+
+  // Returns a view of the encoding of T at the start of the |size| bytes at
+  // |data|. Returns an error if the bytes are too short or are not a fixed
+  // width encoding of T.
+  static Status<View> Create(const std::uint8_t* data, std::size_t size) {
+    if (size < Size)
+      return ErrorStatus::ReadLimitReached;
+    else if (!Fixed::Match(data))
+      return ErrorStatus::UnexpectedEncodingType;
+    else
+      return View{data};
+  }
+
+  // Returns the value of the member at the given index, or a view of it if the
+  // member is a fixed structure.
+  template <std::size_t Index>
+  auto Get() const {
+    using Type = typename Fixed::template MemberType<Index>;
+    return Load<Type>(data_ + Fixed::template Offset<Index>(),
+                      IsFixedStructure<Type>{});
+  }
+
+  // Returns the value of the member given by MemberPointer, as produced by
+  // NOP_VIEW_MEMBER(), or a view of it if the member is a fixed structure.
+  template <typename MemberPointer>
+  auto Get() const {
+    constexpr std::size_t index =
+        IndexOf<MemberPointer>(std::make_index_sequence<MemberList::Count>{});
+    static_assert(index < MemberList::Count,
+                  "MemberPointer must be a member of the structure.");
+    return Get<index>();
+  }
+
+  // Decodes the complete value.
+  Status<void> Decode(T* value) const {
+    BufferReader reader{data_, Size};
+    return Encoding<T>::Read(value, &reader);
+  }
+
+  const std::uint8_t* data() const { return data_; }
+  std::size_t size() const { return Size; }
+
+ private:
+  template <typename>
+  friend class View;
+
+  explicit View(const std::uint8_t* data) : data_{data} {}
+
+  template <typename Type>
+  static View<Type> Load(const std::uint8_t* data, std::true_type) {
+    return View<Type>{data};
+  }
+
+  template <typename Type>
+  static Type Load(const std::uint8_t* data, std::false_type) {
+    return FixedEncoding<Type>::Load(data);
+  }
+
+  template <typename MemberPointer, std::size_t... Is>
+  static constexpr std::size_t IndexOf(std::index_sequence<Is...>) {
+    const bool matches[] = {
+        std::is_same<MemberPointer,
+                     typename MemberList::template At<Is>>::value...,
+        false};
+    std::size_t index = 0;
+    while (index < MemberList::Count && !matches[index])
+      index++;
+    return index;
+  }
+
+  const std::uint8_t* data_;
+};
+
+// Names a member of a fixed structure for View::Get().
+#define NOP_VIEW_MEMBER(type, member) _NOP_MEMBER_LIST(type, member)
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_VIEW_H_
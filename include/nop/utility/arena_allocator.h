@@ -0,0 +1,170 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_ARENA_ALLOCATOR_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_ARENA_ALLOCATOR_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <scoped_allocator>
+#include <vector>
+
+namespace nop {
+
+// Arena is a monotonic memory resource: allocations are carved out of large
+// blocks in sequence and individual deallocations are ignored. All of the
+// memory is reclaimed at once by Reset() or when the arena is destroyed,
+// making it cheap to free the whole object graph decoded for one request.
+//
+// Arena is not thread safe.
+class Arena {
+ public:
+  enum : std::size_t { kDefaultBlockSize = 4096 };
+
+  explicit Arena(std::size_t block_size = kDefaultBlockSize)
+      : block_size_{block_size} {}
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Returns |size| bytes aligned to |alignment|, which must be a power of two.
+  void* Allocate(std::size_t size, std::size_t alignment) {
+    std::uintptr_t begin = Align(position_, alignment);
+    if (blocks_.empty() || begin + size > end_) {
+      AddBlock(size + alignment);
+      begin = Align(position_, alignment);
+    }
+
+    position_ = begin + size;
+    allocated_ += size;
+    return reinterpret_cast<void*>(begin);
+  }
+
+  // Releases every allocation. The first block is kept for reuse, so an arena
+  // that is reset between requests of similar size allocates once.
+  void Reset() {
+    if (blocks_.empty())
+      return;
+
+    blocks_.resize(1);
+    SetBlock(blocks_.front().get(), first_block_size_);
+    allocated_ = 0;
+  }
+
+  // Returns the number of bytes allocated since construction or the last
+  // Reset().
+  std::size_t allocated() const { return allocated_; }
+
+  // Returns the number of blocks held by the arena.
+  std::size_t block_count() const { return blocks_.size(); }
+
+ private:
+  static std::uintptr_t Align(std::uintptr_t position, std::size_t alignment) {
+    return (position + alignment - 1) & ~(std::uintptr_t{alignment} - 1);
+  }
+
+  void AddBlock(std::size_t minimum_size) {
+    const std::size_t size = std::max(block_size_, minimum_size);
+    blocks_.emplace_back(new unsigned char[size]);
+    if (blocks_.size() == 1)
+      first_block_size_ = size;
+    SetBlock(blocks_.back().get(), size);
+  }
+
+  void SetBlock(unsigned char* block, std::size_t size) {
+    position_ = reinterpret_cast<std::uintptr_t>(block);
+    end_ = position_ + size;
+  }
+
+  std::size_t block_size_;
+  std::size_t first_block_size_{0};
+  std::vector<std::unique_ptr<unsigned char[]>> blocks_;
+  std::uintptr_t position_{0};
+  std::uintptr_t end_{0};
+  std::size_t allocated_{0};
+};
+
+// ArenaAllocator is a standard allocator that allocates from an Arena. Use
+// ScopedArenaAllocator for containers of containers or strings, so that the
+// nested elements allocate from the same arena; libnop constructs the elements
+// it decodes with the allocator of their container.
+//
+// A default constructed ArenaAllocator has no arena and allocates from the
+// heap, which keeps containers that use it default constructible as required
+// of serializable types.
+//
+// Example:
+//
+//  using String =
+//      std::basic_string<char, std::char_traits<char>,
+//                        ScopedArenaAllocator<char>>;
+//  using Strings = std::vector<String, ScopedArenaAllocator<String>>;
+//
+//  Arena arena;
+//  Strings strings{ScopedArenaAllocator<String>{&arena}};
+//  auto status = deserializer.Read(&strings);
+//  ...
+//  arena.Reset();  // After |strings| is destroyed.
+//
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  ArenaAllocator() noexcept = default;
+  ArenaAllocator(Arena* arena) noexcept : arena_{arena} {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+      : arena_{other.arena()} {}
+
+  T* allocate(std::size_t count) {
+    if (arena_ == nullptr)
+      return static_cast<T*>(::operator new(count * sizeof(T)));
+    return static_cast<T*>(arena_->Allocate(count * sizeof(T), alignof(T)));
+  }
+
+  // Arena memory is reclaimed by Arena::Reset().
+  void deallocate(T* pointer, std::size_t /*count*/) noexcept {
+    if (arena_ == nullptr)
+      ::operator delete(pointer);
+  }
+
+  Arena* arena() const { return arena_; }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return arena_ == other.arena();
+  }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const {
+    return arena_ != other.arena();
+  }
+
+ private:
+  Arena* arena_{nullptr};
+};
+
+// ArenaAllocator that passes itself on to the elements of its container.
+template <typename T>
+using ScopedArenaAllocator = std::scoped_allocator_adaptor<ArenaAllocator<T>>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_ARENA_ALLOCATOR_H_
@@ -0,0 +1,281 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_ARRAY_CURSOR_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_ARRAY_CURSOR_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/skip.h>
+#include <nop/base/utility.h>
+#include <nop/base/vector.h>
+#include <nop/status.h>
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+// ArrayCursor reads the elements of an encoded std::vector<T> one at a time,
+// or in batches, so that arrays too large to hold in memory may be processed
+// as they are read. The wire format is exactly that of std::vector<T>: an ARY
+// header followed by the elements for non-integral types, and a BIN header
+// followed by the raw little-endian elements for integral types. The indexed
+// array form written by IndexedArray<T> is also accepted.
+//
+// The cursor works with any reader type. Begin() reads the header, after which
+// Next() and Read() decode elements until remaining() reaches zero. Seek()
+// moves forward to a given element, skipping the elements in between with a
+// single bulk skip when the array is indexed or integral.
+//
+// Example:
+//
+//  ArrayCursor<Record> cursor;
+//  auto status = cursor.Begin(&reader);
+//  while (status && !cursor.done()) {
+//    Record record;
+//    status = cursor.Next(&record, &reader);
+//    if (status)
+//      Process(record);
+//  }
+//
+template <typename T>
+class ArrayCursor {
+ public:
+  ArrayCursor() = default;
+
+  // Reads the array header from |reader|. Returns
+  // ErrorStatus::UnexpectedEncodingType if the next value is not an encoded
+  // std::vector<T> and ErrorStatus::InvalidContainerLength if the length of a
+  // binary payload is not a multiple of the element size or an offset table is
+  // malformed.
+  template <typename Reader>
+  Status<void> Begin(Reader* reader) {
+    size_ = remaining_ = 0;
+    offsets_.clear();
+
+    std::uint8_t prefix_byte = 0;
+    auto status = reader->Read(&prefix_byte);
+    if (!status)
+      return status;
+
+    const EncodingByte prefix = static_cast<EncodingByte>(prefix_byte);
+    const bool indexed = !IsIntegral<T>::value &&
+                         prefix == EncodingByte::IndexedArray;
+    if (prefix != kPrefix && !indexed)
+      return ErrorStatus::UnexpectedEncodingType;
+
+    SizeType size = 0;
+    status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    if (indexed) {
+      status = ReadOffsets(size, reader);
+      if (!status)
+        return status;
+    }
+
+    if (IsIntegral<T>::value) {
+      if (size % sizeof(T) != 0)
+        return ErrorStatus::InvalidContainerLength;
+      size /= sizeof(T);
+    }
+
+    size_ = remaining_ = size;
+    return {};
+  }
+
+  // Reads the next element into |element|. Returns
+  // ErrorStatus::ReadLimitReached if every element has been read.
+  template <typename Reader>
+  Status<void> Next(T* element, Reader* reader) {
+    if (remaining_ == 0)
+      return ErrorStatus::ReadLimitReached;
+
+    auto status = ReadElements(element, element + 1, reader);
+    if (!status)
+      return status;
+
+    remaining_--;
+    return {};
+  }
+
+  // Reads up to |end - begin| elements into the given range, returning the
+  // number of elements read, which is less than the size of the range only
+  // when fewer elements remain.
+  template <typename Reader>
+  Status<std::size_t> Read(T* begin, T* end, Reader* reader) {
+    const std::size_t count = std::min<std::size_t>(end - begin, remaining_);
+    auto status = ReadElements(begin, begin + count, reader);
+    if (!status)
+      return status.error();
+
+    remaining_ -= count;
+    return count;
+  }
+
+  // Advances the cursor to the element at |index|, skipping the elements
+  // before it without decoding them. Returns ErrorStatus::InvalidContainerLength
+  // if |index| is before the next element or beyond the end of the array.
+  template <typename Reader>
+  Status<void> Seek(std::size_t index, Reader* reader) {
+    const std::size_t position = size_ - remaining_;
+    if (index < position || index > size_)
+      return ErrorStatus::InvalidContainerLength;
+    else if (index == position)
+      return {};
+
+    auto status = SkipElements(position, index, reader, IsIntegral<T>{});
+    if (!status)
+      return status;
+
+    remaining_ = size_ - index;
+    return {};
+  }
+
+  // Returns the number of elements in the array.
+  std::size_t size() const { return size_; }
+
+  // Returns the index of the next element to read.
+  std::size_t position() const { return size_ - remaining_; }
+
+  // Returns the number of elements not yet read.
+  std::size_t remaining() const { return remaining_; }
+
+  // Returns true when every element has been read.
+  bool done() const { return remaining_ == 0; }
+
+ private:
+  static constexpr EncodingByte kPrefix =
+      IsIntegral<T>::value ? EncodingByte::Binary : EncodingByte::Array;
+
+  template <typename Reader>
+  static Status<void> ReadElements(T* begin, T* end, Reader* reader) {
+    return ReadElements(begin, end, reader, IsIntegral<T>{});
+  }
+
+  // Integral elements are stored contiguously and read in one operation.
+  template <typename Reader>
+  static Status<void> ReadElements(T* begin, T* end, Reader* reader,
+                                   std::true_type /*is_integral*/) {
+    auto status = reader->Ensure((end - begin) * sizeof(T));
+    if (!status)
+      return status;
+
+    return reader->Read(begin, end);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadElements(T* begin, T* end, Reader* reader,
+                                   std::false_type /*is_integral*/) {
+    for (; begin != end; ++begin) {
+      auto status = Encoding<T>::Read(begin, reader);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  // Reads the offset table of an indexed array, checking that the offsets are
+  // non-decreasing so that Seek() may rely on them.
+  template <typename Reader>
+  Status<void> ReadOffsets(SizeType count, Reader* reader) {
+    auto width = detail::ReadOffsetTableHeader(count, reader);
+    if (!width)
+      return width.error();
+
+    auto status = reader->Ensure(count * width.get());
+    if (!status)
+      return status;
+
+    offsets_.resize(count);
+    for (std::size_t i = 0; i < offsets_.size(); i++) {
+      if (width.get() == sizeof(std::uint32_t)) {
+        std::uint32_t offset = 0;
+        status = reader->Read(&offset, &offset + 1);
+        offsets_[i] = HostEndian<std::uint32_t>::FromLittle(offset);
+      } else {
+        std::uint64_t offset = 0;
+        status = reader->Read(&offset, &offset + 1);
+        offsets_[i] = HostEndian<std::uint64_t>::FromLittle(offset);
+      }
+      if (!status)
+        return status;
+      else if (i > 0 && offsets_[i] < offsets_[i - 1])
+        return ErrorStatus::InvalidContainerLength;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  Status<void> SkipElements(std::size_t begin, std::size_t end, Reader* reader,
+                            std::true_type /*is_integral*/) {
+    const std::size_t size = (end - begin) * sizeof(T);
+    auto status = reader->Ensure(size);
+    if (!status)
+      return status;
+
+    return reader->Skip(size);
+  }
+
+  // Indexed arrays skip to the offset of the target element in one step. The
+  // last element has no following offset and is skipped structurally, as are
+  // all elements read with session state, so that the definitions in the
+  // skipped elements are added to it.
+  template <typename Reader>
+  Status<void> SkipElements(std::size_t begin, std::size_t end, Reader* reader,
+                            std::false_type /*is_integral*/) {
+    if (!offsets_.empty() && !detail::HasSessionState(reader)) {
+      const std::size_t last = std::min(end, offsets_.size() - 1);
+      if (last > begin) {
+        const std::size_t size = offsets_[last] - offsets_[begin];
+        auto status = reader->Ensure(size);
+        if (!status)
+          return status;
+
+        status = reader->Skip(size);
+        if (!status)
+          return status;
+        begin = last;
+      }
+    }
+
+    for (; begin != end; ++begin) {
+      auto status = SkipValue(reader);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  std::size_t size_{0};
+  std::size_t remaining_{0};
+  std::vector<std::uint64_t> offsets_;
+};
+
+template <typename T>
+constexpr EncodingByte ArrayCursor<T>::kPrefix;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_ARRAY_CURSOR_H_
@@ -0,0 +1,337 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_ASYNC_FD_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_ASYNC_FD_WRITER_H_
+
+#include <errno.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <nop/status.h>
+
+namespace nop {
+
+// What AsyncFdWriter does with a value when every buffer is waiting to be
+// written.
+enum class FullBufferPolicy {
+  // Wait for the background thread to free a buffer.
+  Block,
+  // Reject the value with ErrorStatus::WriteLimitReached.
+  Drop,
+};
+
+// Options for AsyncFdWriter.
+struct AsyncFdWriterOptions {
+  // Number of buffers, including the one being filled. At least two.
+  std::size_t buffer_count{2};
+
+  // Capacity of each buffer. A value larger than a buffer is collected in a
+  // buffer grown to fit it.
+  std::size_t buffer_size{64 * 1024};
+
+  FullBufferPolicy policy{FullBufferPolicy::Block};
+
+  // Interval at which the background thread asks for a partially filled
+  // buffer when it has nothing to write, bounding how long values wait in
+  // memory while the writer is in use.
+  std::chrono::milliseconds flush_interval{10};
+};
+
+// AsyncFdWriter is a writer type that collects output in memory and writes it
+// to a UNIX file descriptor from a background thread, so that slow writes do
+// not stall the writing thread. Values are appended to the current buffer with
+// plain copies; full buffers are handed to the background thread, which writes
+// them in order while the next buffer fills.
+//
+// The library-provided Serializer types call Flush() at the end of every
+// top-level Write(). Flush() only ends the value: the buffer is handed off once
+// it is full or the flush interval has passed, without waiting. Drain() is the
+// explicit point at which all output has been written to the fd, and Sync()
+// also waits for it to reach the storage device. Values written just before
+// the writer goes idle stay buffered until the next value, Drain(), or Sync().
+//
+// Values are never split across buffers, so the Drop policy rejects whole
+// values: with the Serializer types nothing of a rejected value is written.
+// Errors from the background thread are returned by the next call to
+// Prepare(), Flush(), Drain(), or Sync(), and further output is discarded.
+//
+// The writer must be used by one thread at a time. It takes ownership of the
+// fd, drains any pending output, and closes the fd when destroyed.
+//
+// Example:
+//
+//  AsyncFdWriterOptions options;
+//  options.buffer_count = 4;
+//  options.policy = FullBufferPolicy::Drop;
+//  Serializer<AsyncFdWriter> serializer{log_fd, options};
+//
+//  // Request handlers pay only for the copy into memory.
+//  auto status = serializer.Write(record);
+//
+//  // At a checkpoint, make everything written so far durable.
+//  status = serializer.writer().Sync();
+//
+class AsyncFdWriter {
+ public:
+  explicit AsyncFdWriter(int fd, const AsyncFdWriterOptions& options = {})
+      : fd_{fd},
+        buffer_size_{std::max<std::size_t>(options.buffer_size, 1)},
+        policy_{options.policy},
+        flush_interval_{options.flush_interval} {
+    const std::size_t buffer_count =
+        std::max<std::size_t>(options.buffer_count, 2);
+    current_.reserve(buffer_size_);
+    free_.resize(buffer_count - 1);
+    for (auto& buffer : free_)
+      buffer.reserve(buffer_size_);
+
+    thread_ = std::thread{&AsyncFdWriter::Run, this};
+  }
+
+  AsyncFdWriter(const AsyncFdWriter&) = delete;
+  void operator=(const AsyncFdWriter&) = delete;
+
+  ~AsyncFdWriter() {
+    Drain();
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      stop_ = true;
+    }
+    work_.notify_one();
+    thread_.join();
+    ::close(fd_);
+  }
+
+  // Starts a value of |size| bytes. Hands off the current buffer first if the
+  // value does not fit in what remains of it. Returns
+  // ErrorStatus::WriteLimitReached under the Drop policy if no buffer is free.
+  Status<void> Prepare(std::size_t size) {
+    const ErrorStatus error = error_.load(std::memory_order_relaxed);
+    if (error != ErrorStatus::None)
+      return error;
+
+    const bool at_value_start = current_.size() == value_start_;
+    if (at_value_start && !current_.empty() &&
+        current_.size() + size > buffer_size_) {
+      std::unique_lock<std::mutex> lock{mutex_};
+      if (!Handoff(&lock, policy_ == FullBufferPolicy::Block)) {
+        dropped_count_++;
+        return ErrorStatus::WriteLimitReached;
+      }
+    }
+
+    if (current_.size() + size > current_.capacity())
+      current_.reserve(current_.size() + size);
+    return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) {
+    current_.push_back(byte);
+    return {};
+  }
+
+  Status<void> Write(const void* begin, const void* end) {
+    const std::uint8_t* begin_byte = static_cast<const std::uint8_t*>(begin);
+    const std::uint8_t* end_byte = static_cast<const std::uint8_t*>(end);
+    current_.insert(current_.end(), begin_byte, end_byte);
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    current_.insert(current_.end(), padding_bytes, padding_value);
+    return {};
+  }
+
+  // Ends the current value. Hands off the current buffer, if a buffer is free,
+  // when it is full or the background thread has asked for it. Never waits.
+  Status<void> Flush() {
+    value_start_ = current_.size();
+    if (current_.size() >= buffer_size_ ||
+        flush_requested_.load(std::memory_order_relaxed)) {
+      std::unique_lock<std::mutex> lock{mutex_};
+      Handoff(&lock, false);
+    }
+
+    const ErrorStatus error = error_.load(std::memory_order_relaxed);
+    if (error != ErrorStatus::None)
+      return error;
+    else
+      return {};
+  }
+
+  // Hands off the current buffer and waits until all output has been written
+  // to the fd.
+  Status<void> Drain() {
+    value_start_ = current_.size();
+    std::unique_lock<std::mutex> lock{mutex_};
+    if (!current_.empty())
+      Handoff(&lock, true);
+    idle_.wait(lock, [this] { return full_.empty() && !writing_; });
+
+    const ErrorStatus error = error_.load(std::memory_order_relaxed);
+    if (error != ErrorStatus::None)
+      return error;
+    else
+      return {};
+  }
+
+  // Drains the writer and waits until the output is durable.
+  Status<void> Sync() {
+    auto status = Drain();
+    if (!status)
+      return status;
+
+    while (::fdatasync(fd_) < 0) {
+      if (errno != EINTR)
+        return ErrorStatus::IOError;
+    }
+    return {};
+  }
+
+  // Returns the number of values rejected under the Drop policy.
+  std::size_t dropped_count() const { return dropped_count_; }
+
+  // Returns the number of bytes in the current buffer.
+  std::size_t buffered() const { return current_.size(); }
+
+  // Returns the number of bytes the background thread has written to the fd.
+  std::uint64_t written_bytes() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return written_bytes_;
+  }
+
+  int fd() const { return fd_; }
+
+ private:
+  // Queues the current buffer for the background thread and takes a free one,
+  // waiting for one if |wait| is true. Returns false if no buffer is free.
+  bool Handoff(std::unique_lock<std::mutex>* lock, bool wait) {
+    if (free_.empty()) {
+      if (!wait)
+        return false;
+      idle_.wait(*lock, [this] { return !free_.empty(); });
+    }
+
+    full_.push_back(std::move(current_));
+    current_ = std::move(free_.back());
+    free_.pop_back();
+    current_.clear();
+    value_start_ = 0;
+    flush_requested_.store(false, std::memory_order_relaxed);
+
+    lock->unlock();
+    work_.notify_one();
+    lock->lock();
+    return true;
+  }
+
+  void Run() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (true) {
+      if (full_.empty()) {
+        if (stop_)
+          return;
+
+        const bool woken = work_.wait_for(lock, flush_interval_, [this] {
+          return !full_.empty() || stop_;
+        });
+        if (!woken)
+          flush_requested_.store(true, std::memory_order_relaxed);
+        continue;
+      }
+
+      std::vector<std::uint8_t> buffer = std::move(full_.front());
+      full_.pop_front();
+      writing_ = true;
+
+      // Output is discarded once a write has failed.
+      lock.unlock();
+      Status<void> status;
+      if (error_.load(std::memory_order_relaxed) == ErrorStatus::None)
+        status = WriteAll(buffer.data(), buffer.size());
+      lock.lock();
+
+      if (status)
+        written_bytes_ += buffer.size();
+      else
+        error_.store(status.error(), std::memory_order_relaxed);
+
+      buffer.clear();
+      free_.push_back(std::move(buffer));
+      writing_ = false;
+      idle_.notify_all();
+    }
+  }
+
+  Status<void> WriteAll(const std::uint8_t* data, std::size_t size) {
+    while (size > 0) {
+      const ssize_t ret = ::write(fd_, data, size);
+      if (ret > 0) {
+        data += ret;
+        size -= ret;
+      } else if (ret == 0) {
+        return ErrorStatus::WriteLimitReached;
+      } else if (errno != EINTR) {
+        return ErrorStatus::IOError;
+      }
+      // Otherwise interrupted by signal; retry.
+    }
+    return {};
+  }
+
+  const int fd_;
+  const std::size_t buffer_size_;
+  const FullBufferPolicy policy_;
+  const std::chrono::milliseconds flush_interval_;
+
+  // The buffer being filled and the offset of the value being written to it,
+  // owned by the writing thread.
+  std::vector<std::uint8_t> current_;
+  std::size_t value_start_{0};
+  std::size_t dropped_count_{0};
+
+  mutable std::mutex mutex_;
+  std::condition_variable work_;
+  std::condition_variable idle_;
+  std::deque<std::vector<std::uint8_t>> full_;
+  std::vector<std::vector<std::uint8_t>> free_;
+  bool writing_{false};
+  bool stop_{false};
+  std::uint64_t written_bytes_{0};
+
+  std::atomic<bool> flush_requested_{false};
+  std::atomic<ErrorStatus> error_{ErrorStatus::None};
+  std::thread thread_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_ASYNC_FD_WRITER_H_
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_BIT_PACKING_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_BIT_PACKING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+//
+// Utilities for the zigzag transform and for packing unsigned integers into a
+// little-endian bit stream with a fixed number of bits per value, as used by
+// the packed array encoding.
+//
+// UnpackBits() extracts each value with one unaligned 64-bit load, a shift, and
+// a mask; only values wider than 56 bits may need a second load. Compilers
+// vectorize this loop on targets with vector shifts, so there are no separate
+// SIMD code paths to keep in sync with the scalar one.
+//
+
+// Maps signed values to unsigned values so that values of small magnitude have
+// small encodings: 0, -1, 1, -2, ... map to 0, 1, 2, 3, ...
+constexpr std::uint64_t ZigZagEncode(std::int64_t value) {
+  return (static_cast<std::uint64_t>(value) << 1) ^
+         static_cast<std::uint64_t>(value >> 63);
+}
+
+constexpr std::int64_t ZigZagDecode(std::uint64_t value) {
+  return static_cast<std::int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+// Returns the number of bits needed to represent |value|.
+constexpr std::size_t BitWidth(std::uint64_t value) {
+  std::size_t width = 0;
+  while (value != 0) {
+    value >>= 1;
+    width++;
+  }
+  return width;
+}
+
+// Returns the number of bytes that |count| values of |width| bits pack into.
+constexpr std::size_t PackedSize(std::size_t count, std::size_t width) {
+  return (count * width + 7) / 8;
+}
+
+// Returns a mask of the low |width| bits.
+constexpr std::uint64_t LowBitMask(std::size_t width) {
+  return width >= 64 ? ~std::uint64_t{0}
+                     : (std::uint64_t{1} << width) - 1;
+}
+
+// Packs the low |width| bits of each of |count| values into |data|, which must
+// have room for PackedSize(count, width) bytes.
+inline void PackBits(const std::uint64_t* values, std::size_t count,
+                     std::size_t width, std::uint8_t* data) {
+  std::uint64_t buffer = 0;
+  std::size_t bits = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    std::uint64_t value = values[i] & LowBitMask(width);
+    std::size_t remaining = width;
+    while (remaining != 0) {
+      const std::size_t take = remaining < 64 - bits ? remaining : 64 - bits;
+      buffer |= (value & LowBitMask(take)) << bits;
+      value = take >= 64 ? 0 : value >> take;
+      bits += take;
+      remaining -= take;
+
+      if (bits == 64) {
+        const std::uint64_t word = HostEndian<std::uint64_t>::ToLittle(buffer);
+        std::memcpy(data, &word, sizeof(word));
+        data += sizeof(word);
+        buffer = 0;
+        bits = 0;
+      }
+    }
+  }
+
+  const std::uint64_t word = HostEndian<std::uint64_t>::ToLittle(buffer);
+  std::memcpy(data, &word, (bits + 7) / 8);
+}
+
+// Unpacks |count| values of |width| bits from |data| into |values|. The input
+// must hold PackedSize(count, width) bytes followed by at least eight bytes of
+// readable padding.
+inline void UnpackBits(const std::uint8_t* data, std::size_t count,
+                       std::size_t width, std::uint64_t* values) {
+  const std::uint64_t mask = LowBitMask(width);
+  for (std::size_t i = 0; i < count; i++) {
+    const std::size_t bit = i * width;
+    const std::size_t byte = bit / 8;
+    const std::size_t shift = bit % 8;
+
+    std::uint64_t word;
+    std::memcpy(&word, data + byte, sizeof(word));
+    std::uint64_t value = HostEndian<std::uint64_t>::FromLittle(word) >> shift;
+    if (shift + width > 64)
+      value |= static_cast<std::uint64_t>(data[byte + 8]) << (64 - shift);
+    values[i] = value & mask;
+  }
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_BIT_PACKING_H_
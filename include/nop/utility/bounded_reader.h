@@ -20,10 +20,13 @@
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
+#include <type_traits>
+#include <utility>
 
 #include <nop/base/encoding.h>
 #include <nop/base/handle.h>
 #include <nop/base/utility.h>
+#include <nop/traits/is_limit_reader.h>
 
 namespace nop {
 
@@ -92,6 +95,21 @@ class BoundedReader {
     return {};
   }
 
+  // Forwards borrowing to the underlying reader, when it supports it.
+  template <typename R = Reader>
+  constexpr auto Borrow(const void** data, std::size_t size)
+      -> decltype(std::declval<R&>().Borrow(data, size)) {
+    if (size > (size_ - index_))
+      return ErrorStatus::ReadLimitReached;
+
+    auto status = reader_->Borrow(data, size);
+    if (!status)
+      return status;
+
+    index_ += size;
+    return {};
+  }
+
   // Skips any bytes remaining in the limit set at construction.
   constexpr Status<void> ReadPadding() {
     const std::size_t padding_bytes = size_ - index_;
@@ -108,10 +126,46 @@ class BoundedReader {
     return reader_->GetHandle(handle_reference);
   }
 
+  // Forwards the string dictionary of the underlying reader, when it has one.
+  template <typename R = Reader>
+  constexpr auto string_dictionary() const
+      -> decltype(std::declval<R&>().string_dictionary()) {
+    return reader_->string_dictionary();
+  }
+
+  // Forwards the chunk store of the underlying reader, when it has one.
+  template <typename R = Reader>
+  constexpr auto chunk_store() const
+      -> decltype(std::declval<R&>().chunk_store()) {
+    return reader_->chunk_store();
+  }
+
+  // Forwards the shared object table of the underlying reader, when it has one.
+  template <typename R = Reader>
+  constexpr auto object_table() const
+      -> decltype(std::declval<R&>().object_table()) {
+    return reader_->object_table();
+  }
+
+  // Forwards the trusted property of the underlying reader.
+  template <typename R = Reader>
+  constexpr auto trusted() const
+      -> decltype(std::declval<const R&>().trusted()) {
+    return reader_->trusted();
+  }
+
+  // Forwards the UTF-8 validation property of the underlying reader.
+  template <typename R = Reader>
+  constexpr auto validates_utf8() const
+      -> decltype(std::declval<const R&>().validates_utf8()) {
+    return reader_->validates_utf8();
+  }
+
   constexpr bool empty() const { return index_ == size_; }
 
   constexpr std::size_t size() const { return index_; }
   constexpr std::size_t capacity() const { return size_; }
+  constexpr std::size_t remaining() const { return size_ - index_; }
 
  private:
   Reader* reader_{nullptr};
@@ -119,6 +173,36 @@ class BoundedReader {
   std::size_t index_{0};
 };
 
+// Reads a value of type T from the next |size| bytes of |reader| and skips any
+// padding that follows it within those bytes. Readers that support PushLimit()
+// are limited in place, so that nested sized values are checked against the
+// innermost limit only and share the instantiations of the reader itself;
+// other readers are wrapped in a BoundedReader.
+template <typename T, typename Reader>
+std::enable_if_t<IsLimitReader<Reader>::value, Status<void>> ReadBoundedValue(
+    T* value, std::size_t size, Reader* reader) {
+  auto previous = reader->PushLimit(size);
+  if (!previous)
+    return previous.error();
+
+  auto status = Encoding<T>::Read(value, reader);
+  if (!status)
+    return status;
+
+  return reader->PopLimit(previous.get());
+}
+
+template <typename T, typename Reader>
+std::enable_if_t<!IsLimitReader<Reader>::value, Status<void>>
+ReadBoundedValue(T* value, std::size_t size, Reader* reader) {
+  BoundedReader<Reader> bounded_reader{reader, size};
+  auto status = Encoding<T>::Read(value, &bounded_reader);
+  if (!status)
+    return status;
+
+  return bounded_reader.ReadPadding();
+}
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_UTILITY_BOUNDED_READER_H_
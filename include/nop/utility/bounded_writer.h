@@ -20,6 +20,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
+#include <utility>
 
 #include <nop/base/encoding.h>
 #include <nop/base/handle.h>
@@ -103,11 +104,69 @@ class BoundedWriter {
     return {};
   }
 
+  // Forwards borrowing to the underlying writer, when it supports it.
+  template <typename W = Writer>
+  constexpr auto Borrow(void** data, std::size_t size)
+      -> decltype(std::declval<W&>().Borrow(data, size)) {
+    if (size > (size_ - index_))
+      return ErrorStatus::WriteLimitReached;
+
+    auto status = writer_->Borrow(data, size);
+    if (!status)
+      return status;
+
+    index_ += size;
+    return {};
+  }
+
   template <typename HandleType>
   constexpr Status<HandleType> PushHandle(const HandleType& handle) {
     return writer_->PushHandle(handle);
   }
 
+  // Forwards the SizeCache of the underlying writer, when it has one.
+  template <typename W = Writer>
+  constexpr auto size_cache() const
+      -> decltype(std::declval<W&>().size_cache()) {
+    return writer_->size_cache();
+  }
+
+  // Forwards the canonical encoding request of the underlying writer.
+  template <typename W = Writer>
+  constexpr auto canonical() const
+      -> decltype(std::declval<const W&>().canonical()) {
+    return writer_->canonical();
+  }
+
+  // Forwards the positions of patchable fields to the underlying writer, when
+  // it records them.
+  template <typename W = Writer>
+  constexpr auto MarkField(std::size_t index, std::size_t width)
+      -> decltype(std::declval<W&>().MarkField(index, width)) {
+    return writer_->MarkField(index, width);
+  }
+
+  // Forwards the string dictionary of the underlying writer, when it has one.
+  template <typename W = Writer>
+  constexpr auto string_dictionary() const
+      -> decltype(std::declval<W&>().string_dictionary()) {
+    return writer_->string_dictionary();
+  }
+
+  // Forwards the chunk store of the underlying writer, when it has one.
+  template <typename W = Writer>
+  constexpr auto chunk_store() const
+      -> decltype(std::declval<W&>().chunk_store()) {
+    return writer_->chunk_store();
+  }
+
+  // Forwards the shared object table of the underlying writer, when it has one.
+  template <typename W = Writer>
+  constexpr auto object_table() const
+      -> decltype(std::declval<W&>().object_table()) {
+    return writer_->object_table();
+  }
+
   constexpr std::size_t size() const { return index_; }
   constexpr std::size_t capacity() const { return size_; }
 
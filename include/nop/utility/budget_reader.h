@@ -0,0 +1,256 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_BUDGET_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_BUDGET_READER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// Limits on the work done by a decode through a BudgetReader. Each limit is
+// unlimited by default.
+struct DecodeBudget {
+  using Clock = std::chrono::steady_clock;
+
+  enum : std::size_t { kUnlimited = static_cast<std::size_t>(-1) };
+
+  // Maximum number of bytes read or skipped.
+  std::size_t max_bytes{kUnlimited};
+
+  // Maximum number of values decoded, counting every element and member of
+  // containers and structures.
+  std::size_t max_values{kUnlimited};
+
+  // Maximum number of bytes of storage for decoded container lengths.
+  std::size_t max_allocation_bytes{kUnlimited};
+
+  // Time after which decoding stops.
+  Clock::time_point deadline{Clock::time_point::max()};
+};
+
+// BudgetReader is a reader type that wraps another reader pointer and stops
+// decoding when a DecodeBudget is used up, so that a single large or abusive
+// message cannot hold a thread for long. Exceeding a byte, value or allocation
+// limit fails the read with ErrorStatus::BudgetExceeded, and passing the
+// deadline fails it with ErrorStatus::DeadlineExceeded. Limits are checked
+// before each value is decoded and before containers grow their storage; the
+// deadline is checked every kDeadlineInterval values and whenever a container
+// charges storage, to keep clock reads off the path of small values. All other
+// operations are forwarded to the underlying reader. Work is counted when it is
+// requested, including reads that fail and attempts that are rewound.
+//
+// The storage charged for a container is the size of its decoded length times
+// the size of its element type, and covers strings, vectors and maps. Storage
+// owned by the elements themselves is charged when they are decoded.
+//
+// Large decodes may be time-sliced by combining a BudgetReader with a
+// ResumableReader, which rewinds to the start of an attempt that missed its
+// deadline, and an ArrayCursor that decodes an array in steps. Each slice sets
+// a new deadline with Reset() and decodes elements until one fails with
+// ErrorStatus::DeadlineExceeded, to be retried in the next slice. A byte or
+// value limit still bounds the total work, since an element that cannot be
+// decoded within a single slice is otherwise retried forever.
+//
+// Example:
+//
+//  DecodeBudget budget;
+//  budget.max_bytes = 1024 * 1024;
+//  budget.max_allocation_bytes = 16 * 1024 * 1024;
+//  budget.deadline = DecodeBudget::Clock::now() + std::chrono::milliseconds{5};
+//
+//  BufferReader buffer_reader{data, size};
+//  BudgetReader<BufferReader> reader{&buffer_reader, budget};
+//  Deserializer<BudgetReader<BufferReader>*> deserializer{&reader};
+//  auto status = deserializer.Read(&request);
+//
+template <typename Reader>
+class BudgetReader {
+ public:
+  using Clock = DecodeBudget::Clock;
+
+  enum : std::size_t { kDeadlineInterval = 64 };
+
+  constexpr BudgetReader() = default;
+  constexpr BudgetReader(const BudgetReader&) = default;
+  constexpr BudgetReader(Reader* reader, const DecodeBudget& budget = {})
+      : reader_{reader}, budget_{budget} {}
+
+  constexpr BudgetReader& operator=(const BudgetReader&) = default;
+
+  // Starts over with |budget|, discarding the work counted so far.
+  void Reset(const DecodeBudget& budget) {
+    budget_ = budget;
+    bytes_ = 0;
+    values_ = 0;
+    allocation_bytes_ = 0;
+  }
+
+  Status<void> Ensure(std::size_t size) { return reader_->Ensure(size); }
+
+  Status<void> Read(std::uint8_t* byte) {
+    auto status = ChargeBytes(1);
+    if (!status)
+      return status;
+    return reader_->Read(byte);
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    auto status = ChargeBytes((end - begin) * sizeof(T));
+    if (!status)
+      return status;
+    return reader_->Read(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    auto status = ChargeBytes(padding_bytes);
+    if (!status)
+      return status;
+    return reader_->Skip(padding_bytes);
+  }
+
+  // Forwards borrowing to the underlying reader, when it supports it.
+  template <typename R = Reader>
+  auto Borrow(const void** data, std::size_t size)
+      -> decltype(std::declval<R&>().Borrow(data, size)) {
+    auto status = ChargeBytes(size);
+    if (!status)
+      return status;
+    return reader_->Borrow(data, size);
+  }
+
+  // Forwards input limits to the underlying reader, when it supports them.
+  template <typename R = Reader>
+  constexpr auto PushLimit(std::size_t size)
+      -> decltype(std::declval<R&>().PushLimit(size)) {
+    return reader_->PushLimit(size);
+  }
+
+  template <typename R = Reader>
+  constexpr auto PopLimit(std::size_t previous)
+      -> decltype(std::declval<R&>().PopLimit(previous)) {
+    return reader_->PopLimit(previous);
+  }
+
+  template <typename HandleType>
+  constexpr Status<HandleType> GetHandle(HandleReference handle_reference) {
+    return reader_->template GetHandle<HandleType>(handle_reference);
+  }
+
+  // Forwards the string dictionary of the underlying reader, when it has one.
+  template <typename R = Reader>
+  constexpr auto string_dictionary() const
+      -> decltype(std::declval<const R&>().string_dictionary()) {
+    return reader_->string_dictionary();
+  }
+
+  // Forwards the chunk store of the underlying reader, when it has one.
+  template <typename R = Reader>
+  constexpr auto chunk_store() const
+      -> decltype(std::declval<R&>().chunk_store()) {
+    return reader_->chunk_store();
+  }
+
+  // Forwards the shared object table of the underlying reader, when it has one.
+  template <typename R = Reader>
+  constexpr auto object_table() const
+      -> decltype(std::declval<const R&>().object_table()) {
+    return reader_->object_table();
+  }
+
+  // Forwards the trusted property of the underlying reader.
+  template <typename R = Reader>
+  constexpr auto trusted() const
+      -> decltype(std::declval<const R&>().trusted()) {
+    return reader_->trusted();
+  }
+
+  // Forwards the UTF-8 validation property of the underlying reader.
+  template <typename R = Reader>
+  constexpr auto validates_utf8() const
+      -> decltype(std::declval<const R&>().validates_utf8()) {
+    return reader_->validates_utf8();
+  }
+
+  // Forwards the remaining input of the underlying reader, when it reports it.
+  template <typename R = Reader>
+  constexpr auto remaining() const
+      -> decltype(std::declval<const R&>().remaining()) {
+    return reader_->remaining();
+  }
+
+  Status<void> ChargeValue() {
+    if (values_ >= budget_.max_values)
+      return ErrorStatus::BudgetExceeded;
+    else if (++values_ % kDeadlineInterval == 0)
+      return CheckDeadline();
+    else
+      return {};
+  }
+
+  Status<void> ChargeAllocation(std::size_t bytes) {
+    if (bytes > budget_.max_allocation_bytes - allocation_bytes_)
+      return ErrorStatus::BudgetExceeded;
+
+    allocation_bytes_ += bytes;
+    return CheckDeadline();
+  }
+
+  const DecodeBudget& budget() const { return budget_; }
+
+  // Returns the work counted since construction or the last Reset().
+  std::size_t bytes_read() const { return bytes_; }
+  std::size_t value_count() const { return values_; }
+  std::size_t allocation_bytes() const { return allocation_bytes_; }
+
+  const Reader& reader() const { return *reader_; }
+  Reader& reader() { return *reader_; }
+
+ private:
+  Status<void> ChargeBytes(std::size_t size) {
+    if (size > budget_.max_bytes - bytes_)
+      return ErrorStatus::BudgetExceeded;
+
+    bytes_ += size;
+    return {};
+  }
+
+  Status<void> CheckDeadline() const {
+    if (budget_.deadline != Clock::time_point::max() &&
+        Clock::now() >= budget_.deadline) {
+      return ErrorStatus::DeadlineExceeded;
+    }
+    return {};
+  }
+
+  Reader* reader_{nullptr};
+  DecodeBudget budget_{};
+  std::size_t bytes_{0};
+  std::size_t values_{0};
+  std::size_t allocation_bytes_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_BUDGET_READER_H_
@@ -71,6 +71,36 @@ class BufferReader {
     return {};
   }
 
+  // Stores a pointer to the next |size| bytes of the buffer in |data| and
+  // advances past them, allowing borrowed types to reference the input.
+  Status<void> Borrow(const void** data, std::size_t size) {
+    *data = &buffer_[index_];
+    index_ += size;
+    return {};
+  }
+
+  // Limits reads to the next |size| bytes and returns the previous limit, for
+  // reading sized values in place without a BoundedReader.
+  Status<std::size_t> PushLimit(std::size_t size) {
+    if (size > (size_ - index_))
+      return ErrorStatus::ReadLimitReached;
+
+    const std::size_t previous = size_;
+    size_ = index_ + size;
+    return previous;
+  }
+
+  // Skips the bytes remaining within the current limit and restores the
+  // |previous| limit returned by PushLimit().
+  Status<void> PopLimit(std::size_t previous) {
+    if (index_ > size_)
+      return ErrorStatus::ReadLimitReached;
+
+    index_ = size_;
+    size_ = previous;
+    return {};
+  }
+
   bool empty() const { return index_ == size_; }
 
   std::size_t remaining() const { return size_ - index_; }
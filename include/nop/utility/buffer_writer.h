@@ -72,6 +72,21 @@ class BufferWriter {
     return {};
   }
 
+  // Stores a pointer to the next |size| bytes of the buffer in |data| and
+  // advances past them, for the caller to fill in directly.
+  Status<void> Borrow(void** data, std::size_t size) {
+    auto status = Prepare(size);
+    if (!status)
+      return status;
+
+    *data = &buffer_[index_];
+    index_ += size;
+    return {};
+  }
+
+  // Writes are only bounds checked by Prepare().
+  bool infallible() const { return true; }
+
   std::size_t size() const { return index_; }
   std::size_t capacity() const { return size_; }
 
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_BUFFERED_FD_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_BUFFERED_FD_READER_H_
+
+#include <errno.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include <nop/status.h>
+
+namespace nop {
+
+// BufferedFdReader is a reader type that wraps around a UNIX file descriptor
+// and serves reads from an internal read-ahead window of WindowSize bytes.
+// Calls to Ensure() are used as a hint to fill the window with as few read(2)
+// calls as possible, which the deserialization engine issues before reading
+// strings and integral arrays. Reads larger than the window bypass it and go
+// directly to the file descriptor to avoid an extra copy.
+//
+// Because the window may read past the end of the current message, the reader
+// should be used for all reads from the fd once constructed. The reader takes
+// ownership of the fd and automatically closes it when destroyed, unless it is
+// released. Data remaining in the window is discarded when the fd is released.
+template <std::size_t WindowSize = 4096>
+class BufferedFdReader {
+  static_assert(WindowSize > 0, "WindowSize must be greater than zero.");
+
+ public:
+  BufferedFdReader() = default;
+  BufferedFdReader(int fd) : fd_{fd} {}
+  BufferedFdReader(const BufferedFdReader&) = delete;
+  BufferedFdReader(BufferedFdReader&& other) { *this = std::move(other); }
+
+  ~BufferedFdReader() { Clear(); }
+
+  BufferedFdReader& operator=(const BufferedFdReader&) = delete;
+  BufferedFdReader& operator=(BufferedFdReader&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(fd_, other.fd_);
+
+      // Only the unread portion of the other window needs to be carried over.
+      end_ = other.end_ - other.begin_;
+      std::memcpy(&buffer_[0], &other.buffer_[other.begin_], end_);
+      other.begin_ = other.end_ = 0;
+    }
+    return *this;
+  }
+
+  void Clear() {
+    ::close(fd_);
+    fd_ = -1;
+    begin_ = end_ = 0;
+  }
+
+  int Release() {
+    const int released_fd = fd_;
+    fd_ = -1;
+    begin_ = end_ = 0;
+    return released_fd;
+  }
+
+  Status<void> Ensure(std::size_t size) {
+    // Requests larger than the window cannot be buffered; leave them for Read()
+    // to handle directly.
+    if (size > WindowSize)
+      return {};
+    else
+      return Fill(size);
+  }
+
+  Status<void> Read(std::uint8_t* byte) {
+    if (begin_ < end_) {
+      *byte = buffer_[begin_++];
+      return {};
+    } else {
+      return Read(byte, byte + 1);
+    }
+  }
+
+  Status<void> Read(void* begin, void* end) {
+    std::uint8_t* begin_byte = static_cast<std::uint8_t*>(begin);
+    std::uint8_t* end_byte = static_cast<std::uint8_t*>(end);
+    std::size_t length_bytes = end_byte - begin_byte;
+
+    // Serve as much of the request as possible from the window.
+    const std::size_t buffered_bytes = std::min(length_bytes, available());
+    std::memcpy(begin_byte, &buffer_[begin_], buffered_bytes);
+    begin_ += buffered_bytes;
+    begin_byte += buffered_bytes;
+    length_bytes -= buffered_bytes;
+
+    if (length_bytes == 0) {
+      return {};
+    } else if (length_bytes >= WindowSize) {
+      return ReadDirect(begin_byte, length_bytes);
+    } else {
+      auto status = Fill(length_bytes);
+      if (!status)
+        return status;
+
+      std::memcpy(begin_byte, &buffer_[begin_], length_bytes);
+      begin_ += length_bytes;
+      return {};
+    }
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    while (padding_bytes) {
+      if (begin_ == end_) {
+        auto status = Fill(std::min(padding_bytes, WindowSize));
+        if (!status)
+          return status;
+      }
+
+      const std::size_t skip_bytes = std::min(padding_bytes, available());
+      begin_ += skip_bytes;
+      padding_bytes -= skip_bytes;
+    }
+
+    return {};
+  }
+
+  // Returns the number of bytes read ahead and not yet consumed.
+  std::size_t available() const { return end_ - begin_; }
+
+ private:
+  // Reads from the fd until at least |size| bytes are available in the window.
+  // Each read(2) requests as much data as the window can hold.
+  Status<void> Fill(std::size_t size) {
+    if (available() >= size)
+      return {};
+
+    // Move the unread bytes to the front of the window to make room.
+    if (begin_ != 0) {
+      std::memmove(&buffer_[0], &buffer_[begin_], available());
+      end_ -= begin_;
+      begin_ = 0;
+    }
+
+    while (end_ < size) {
+      const ssize_t ret = ::read(fd_, &buffer_[end_], WindowSize - end_);
+      if (ret > 0)
+        end_ += ret;
+      else if (ret == 0)
+        return ErrorStatus::ReadLimitReached;
+      else if (errno != EINTR)
+        return ErrorStatus::IOError;
+      // Otherwise interrupted by signal; retry.
+    }
+
+    return {};
+  }
+
+  // Reads |length_bytes| from the fd directly into the given buffer.
+  Status<void> ReadDirect(std::uint8_t* buffer, std::size_t length_bytes) {
+    while (length_bytes) {
+      const ssize_t ret = ::read(fd_, buffer, length_bytes);
+      if (ret > 0) {
+        buffer += ret;
+        length_bytes -= ret;
+      } else if (ret == 0) {
+        return ErrorStatus::ReadLimitReached;
+      } else if (errno != EINTR) {
+        return ErrorStatus::IOError;
+      }
+      // Otherwise interrupted by signal; retry.
+    }
+
+    return {};
+  }
+
+  int fd_{-1};
+  std::size_t begin_{0};
+  std::size_t end_{0};
+  std::array<std::uint8_t, WindowSize> buffer_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_BUFFERED_FD_READER_H_
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_BUFFERED_FD_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_BUFFERED_FD_WRITER_H_
+
+#include <errno.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/utility/gather_writer.h>
+
+namespace nop {
+
+// BufferedFdWriter is a writer type that wraps around a UNIX file descriptor
+// and coalesces output until Flush() is called. Output is collected with a
+// GatherWriter: small writes are copied into a staging buffer that is reserved
+// from the size passed to Prepare(), while contiguous ranges of at least
+// GatherThreshold bytes are referenced instead of copied. Flush() sends all
+// pending output with a single writev(2) whenever the number of segments
+// allows.
+//
+// The library-provided Serializer types call Flush() at the end of every
+// top-level Write(), so each serialized value reaches the kernel in one call
+// and referenced ranges are never held past the end of the Write(). Code that
+// uses this writer directly must call Flush() before referenced data goes out
+// of scope.
+//
+// The writer takes ownership of the fd and automatically closes it when
+// destroyed, unless it is released. Pending output is discarded in either case.
+template <std::size_t GatherThreshold = 512>
+class BufferedFdWriter {
+ public:
+  BufferedFdWriter() = default;
+  BufferedFdWriter(int fd) : fd_{fd} {}
+  BufferedFdWriter(const BufferedFdWriter&) = delete;
+  BufferedFdWriter(BufferedFdWriter&& other) { *this = std::move(other); }
+
+  ~BufferedFdWriter() { Clear(); }
+
+  BufferedFdWriter& operator=(const BufferedFdWriter&) = delete;
+  BufferedFdWriter& operator=(BufferedFdWriter&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(fd_, other.fd_);
+      std::swap(output_, other.output_);
+    }
+    return *this;
+  }
+
+  void Clear() {
+    ::close(fd_);
+    fd_ = -1;
+    output_.Clear();
+  }
+
+  int Release() {
+    const int released_fd = fd_;
+    fd_ = -1;
+    output_.Clear();
+    return released_fd;
+  }
+
+  Status<void> Prepare(std::size_t size) { return output_.Prepare(size); }
+
+  Status<void> Write(std::uint8_t byte) { return output_.Write(byte); }
+
+  Status<void> Write(const void* begin, const void* end) {
+    return output_.Write(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return output_.Skip(padding_bytes, padding_value);
+  }
+
+  // Sends all pending output to the fd. Referenced ranges may be released by
+  // the caller after this method returns.
+  Status<void> Flush() {
+    auto status = WriteIovecs(output_.Gather());
+    output_.Clear();
+    return status;
+  }
+
+  // Returns the number of bytes waiting to be flushed.
+  std::size_t pending() const { return output_.size(); }
+
+ private:
+  // Writes the iovec list, handling partial writes and the IOV_MAX limit.
+  Status<void> WriteIovecs(std::vector<struct iovec>& iovecs) {
+    struct iovec* iov = iovecs.data();
+    std::size_t count = iovecs.size();
+
+    while (count) {
+      const int batch = static_cast<int>(std::min<std::size_t>(count, IOV_MAX));
+      const ssize_t ret = ::writev(fd_, iov, batch);
+      if (ret < 0) {
+        if (errno == EINTR)
+          continue;  // Interrupted by signal.
+        else
+          return ErrorStatus::IOError;
+      } else if (ret == 0) {
+        return ErrorStatus::WriteLimitReached;
+      }
+
+      // Advance past the bytes written, which may end mid-iovec.
+      std::size_t written = ret;
+      while (count && written >= iov->iov_len) {
+        written -= iov->iov_len;
+        iov++;
+        count--;
+      }
+      if (count) {
+        iov->iov_base = static_cast<std::uint8_t*>(iov->iov_base) + written;
+        iov->iov_len -= written;
+      }
+    }
+
+    return {};
+  }
+
+  int fd_{-1};
+  GatherWriter<GatherThreshold> output_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_BUFFERED_FD_WRITER_H_
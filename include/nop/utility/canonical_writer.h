@@ -0,0 +1,137 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CANONICAL_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CANONICAL_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// CanonicalWriter is a writer adapter that requests the canonical encoding of
+// every value written through it, so that equal values always produce identical
+// bytes. The encoded bytes may then be hashed or compared directly to find
+// equal values, without decoding them first.
+//
+// The canonical encoding differs from the default encoding in these ways:
+//
+//   1. The pairs of unordered maps are written in the order of the encoded
+//      bytes of their keys, rather than in hash table iteration order.
+//   2. Table entries are written in order of increasing id, rather than in
+//      the order they are declared in the table.
+//
+// Integers always use the smallest encoding that holds their value, and the
+// elements of ordered containers are written in container order, in either
+// mode. The output is a valid encoding that any reader accepts.
+//
+// Values whose bytes are retained from deserialization, such as Lazy<T> and
+// Cached<T>, are written as they were received and are only canonical if they
+// were written canonically in the first place. Floating point values are
+// written bit for bit, so -0.0 and 0.0 or NaNs with different payloads encode
+// differently even though some compare equal.
+//
+// Example:
+//
+//   Serializer<CanonicalWriter<VectorWriter>> serializer;
+//   auto status = serializer.Write(value);
+//   // Equal values produce equal bytes.
+//   const auto& bytes = serializer.writer().writer().data();
+//
+template <typename Writer>
+class CanonicalWriter {
+ public:
+  template <typename... Args>
+  CanonicalWriter(Args&&... args) : writer_{std::forward<Args>(args)...} {}
+  CanonicalWriter(CanonicalWriter&&) = default;
+  CanonicalWriter& operator=(CanonicalWriter&&) = default;
+
+  Status<void> Prepare(std::size_t size) { return writer_.Prepare(size); }
+
+  Status<void> Write(std::uint8_t byte) { return writer_.Write(byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    return writer_.Write(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return writer_.Skip(padding_bytes, padding_value);
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    return writer_.PushHandle(handle);
+  }
+
+  template <typename W = Writer>
+  auto Flush() -> decltype(std::declval<W&>().Flush()) {
+    return writer_.Flush();
+  }
+
+  // Forwards single-pass serialization when the wrapped writer supports it.
+  template <typename W = Writer>
+  auto ReserveSize() -> decltype(std::declval<W&>().ReserveSize()) {
+    return writer_.ReserveSize();
+  }
+
+  template <typename W = Writer>
+  auto PatchSize(std::size_t position)
+      -> decltype(std::declval<W&>().PatchSize(position)) {
+    return writer_.PatchSize(position);
+  }
+
+  bool canonical() const { return true; }
+
+  // Forwards the string dictionary of the wrapped writer, when it has one.
+  template <typename W = Writer>
+  auto string_dictionary() -> decltype(std::declval<W&>().string_dictionary()) {
+    return writer_.string_dictionary();
+  }
+
+  // Forwards the chunk store of the wrapped writer, when it has one.
+  template <typename W = Writer>
+  auto chunk_store() -> decltype(std::declval<W&>().chunk_store()) {
+    return writer_.chunk_store();
+  }
+
+  // Forwards the shared object table of the wrapped writer, when it has one.
+  template <typename W = Writer>
+  auto object_table() -> decltype(std::declval<W&>().object_table()) {
+    return writer_.object_table();
+  }
+
+  const Writer& writer() const { return writer_; }
+  Writer& writer() { return writer_; }
+  Writer&& take() { return std::move(writer_); }
+
+ private:
+  Writer writer_;
+
+  CanonicalWriter(const CanonicalWriter&) = delete;
+  CanonicalWriter& operator=(const CanonicalWriter&) = delete;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CANONICAL_WRITER_H_
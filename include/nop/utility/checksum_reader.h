@@ -0,0 +1,166 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CHECKSUM_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CHECKSUM_READER_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/utility.h>
+#include <nop/traits/is_borrowing_reader.h>
+#include <nop/utility/crc32c.h>
+
+namespace nop {
+
+// ChecksumReader is a reader type that wraps another reader pointer and
+// computes the CRC32C of every byte read, skipped, or borrowed as it passes
+// through. VerifyChecksum() reads the trailer written by
+// ChecksumWriter::WriteChecksum() and returns ErrorStatus::ChecksumMismatch if
+// it does not match the bytes read since construction or the last trailer.
+//
+// Example:
+//
+//  ChecksumReader<FdReader> reader{&fd_reader};
+//  Deserializer<ChecksumReader<FdReader>*> deserializer{&reader};
+//  auto status = deserializer.Read(&snapshot);
+//  if (status)
+//    status = reader.VerifyChecksum();
+//
+template <typename Reader>
+class ChecksumReader {
+ public:
+  enum : std::size_t { kChecksumSize = 4 };
+
+  constexpr ChecksumReader() = default;
+  constexpr ChecksumReader(const ChecksumReader&) = default;
+  constexpr ChecksumReader(Reader* reader) : reader_{reader} {}
+
+  constexpr ChecksumReader& operator=(const ChecksumReader&) = default;
+
+  Status<void> Ensure(std::size_t size) { return reader_->Ensure(size); }
+
+  Status<void> Read(std::uint8_t* byte) {
+    auto status = reader_->Read(byte);
+    if (!status)
+      return status;
+
+    crc_.Update(byte, 1);
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    auto status = reader_->Read(begin, end);
+    if (!status)
+      return status;
+
+    crc_.Update(begin, (end - begin) * sizeof(T));
+    return {};
+  }
+
+  // Skipped bytes are still checksummed, so they are borrowed when the
+  // underlying reader supports it and read into a scratch buffer otherwise.
+  Status<void> Skip(std::size_t padding_bytes) {
+    return Skip(padding_bytes, IsBorrowingReader<Reader>{});
+  }
+
+  // Forwards borrowing to the underlying reader, when it supports it.
+  template <typename R = Reader>
+  auto Borrow(const void** data, std::size_t size)
+      -> decltype(std::declval<R&>().Borrow(data, size)) {
+    auto status = reader_->Borrow(data, size);
+    if (!status)
+      return status;
+
+    crc_.Update(*data, size);
+    return {};
+  }
+
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference handle_reference) {
+    return reader_->template GetHandle<HandleType>(handle_reference);
+  }
+
+  // Forwards the remaining input of the underlying reader, when it reports it.
+  template <typename R = Reader>
+  constexpr auto remaining() const
+      -> decltype(std::declval<const R&>().remaining()) {
+    return reader_->remaining();
+  }
+
+  // Reads the checksum trailer and compares it with the checksum of the bytes
+  // read since construction or the last trailer, then starts a new checksum.
+  Status<void> VerifyChecksum() {
+    std::uint8_t trailer[kChecksumSize];
+    auto status = reader_->Read(trailer, trailer + kChecksumSize);
+    if (!status)
+      return status;
+
+    const std::uint32_t expected =
+        static_cast<std::uint32_t>(trailer[0]) |
+        static_cast<std::uint32_t>(trailer[1]) << 8 |
+        static_cast<std::uint32_t>(trailer[2]) << 16 |
+        static_cast<std::uint32_t>(trailer[3]) << 24;
+    const std::uint32_t actual = crc_.value();
+    crc_.Reset();
+
+    if (expected != actual)
+      return ErrorStatus::ChecksumMismatch;
+    else
+      return {};
+  }
+
+  // Returns the checksum of the bytes read since construction or the last
+  // trailer.
+  std::uint32_t checksum() const { return crc_.value(); }
+
+  const Reader& reader() const { return *reader_; }
+  Reader& reader() { return *reader_; }
+
+ private:
+  Status<void> Skip(std::size_t padding_bytes, std::true_type) {
+    const void* data = nullptr;
+    return Borrow(&data, padding_bytes);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes, std::false_type) {
+    std::array<std::uint8_t, 64> scratch;
+    while (padding_bytes > 0) {
+      const std::size_t length = std::min(padding_bytes, scratch.size());
+      auto status = Read(scratch.data(), scratch.data() + length);
+      if (!status)
+        return status;
+
+      padding_bytes -= length;
+    }
+    return {};
+  }
+
+  Reader* reader_{nullptr};
+  Crc32c crc_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CHECKSUM_READER_H_
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CHECKSUM_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CHECKSUM_WRITER_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/utility.h>
+#include <nop/utility/crc32c.h>
+
+namespace nop {
+
+// ChecksumWriter is a writer type that wraps another writer pointer and
+// computes the CRC32C of every byte written as it passes through, so checking
+// the integrity of the output costs no extra pass over it. WriteChecksum()
+// appends the checksum as a kChecksumSize byte little-endian trailer, which is
+// not itself part of the checksum, and starts a new checksum for the bytes
+// that follow. ChecksumReader verifies the trailer on the receiving end.
+//
+// Borrowing is not forwarded, since bytes written directly into borrowed
+// memory would not be checksummed.
+//
+// Example:
+//
+//  ChecksumWriter<FdWriter> writer{&fd_writer};
+//  Serializer<ChecksumWriter<FdWriter>*> serializer{&writer};
+//  auto status = serializer.Write(snapshot);
+//  if (status)
+//    status = writer.WriteChecksum();
+//
+template <typename Writer>
+class ChecksumWriter {
+ public:
+  enum : std::size_t { kChecksumSize = 4 };
+
+  constexpr ChecksumWriter() = default;
+  constexpr ChecksumWriter(const ChecksumWriter&) = default;
+  constexpr ChecksumWriter(Writer* writer) : writer_{writer} {}
+
+  constexpr ChecksumWriter& operator=(const ChecksumWriter&) = default;
+
+  Status<void> Prepare(std::size_t size) { return writer_->Prepare(size); }
+
+  Status<void> Write(std::uint8_t byte) {
+    auto status = writer_->Write(byte);
+    if (!status)
+      return status;
+
+    crc_.Update(&byte, 1);
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    auto status = writer_->Write(begin, end);
+    if (!status)
+      return status;
+
+    crc_.Update(begin, (end - begin) * sizeof(T));
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    auto status = writer_->Skip(padding_bytes, padding_value);
+    if (!status)
+      return status;
+
+    std::array<std::uint8_t, 64> padding;
+    padding.fill(padding_value);
+    while (padding_bytes > 0) {
+      const std::size_t length = std::min(padding_bytes, padding.size());
+      crc_.Update(padding.data(), length);
+      padding_bytes -= length;
+    }
+    return {};
+  }
+
+  template <typename HandleType>
+  Status<HandleType> PushHandle(const HandleType& handle) {
+    return writer_->PushHandle(handle);
+  }
+
+  // Forwards the SizeCache of the underlying writer, when it has one.
+  template <typename W = Writer>
+  constexpr auto size_cache() const
+      -> decltype(std::declval<W&>().size_cache()) {
+    return writer_->size_cache();
+  }
+
+  // Writes the checksum of the bytes written since construction or the last
+  // trailer and starts a new checksum.
+  Status<void> WriteChecksum() {
+    const std::uint32_t checksum = crc_.value();
+    const std::uint8_t trailer[kChecksumSize] = {
+        static_cast<std::uint8_t>(checksum),
+        static_cast<std::uint8_t>(checksum >> 8),
+        static_cast<std::uint8_t>(checksum >> 16),
+        static_cast<std::uint8_t>(checksum >> 24)};
+
+    auto status = writer_->Prepare(kChecksumSize);
+    if (!status)
+      return status;
+
+    status = writer_->Write(trailer, trailer + kChecksumSize);
+    if (!status)
+      return status;
+
+    crc_.Reset();
+    return {};
+  }
+
+  // Returns the checksum of the bytes written since construction or the last
+  // trailer.
+  std::uint32_t checksum() const { return crc_.value(); }
+
+  const Writer& writer() const { return *writer_; }
+  Writer& writer() { return *writer_; }
+
+ private:
+  Writer* writer_{nullptr};
+  Crc32c crc_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CHECKSUM_WRITER_H_
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CHUNK_STORE_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CHUNK_STORE_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/chunk_store.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// ChunkStoreReader is a reader adapter that carries a ChunkDecodeStore for the
+// ChunkedBlob values read through it. The store lasts as long as the reader and
+// must be limited, keyed, and reset at the same points in the stream as the
+// ChunkStoreWriter that produced it.
+//
+// Example:
+//
+//  Deserializer<ChunkStoreReader<StreamReader<std::stringstream>>>
+//      deserializer;
+//  deserializer.reader().store().set_limit(64 * 1024 * 1024);
+//  Snapshot snapshot;
+//  while (deserializer.Read(&snapshot))
+//    Process(snapshot);
+//
+template <typename Reader>
+class ChunkStoreReader {
+ public:
+  template <typename... Args>
+  ChunkStoreReader(Args&&... args)
+      : reader_{std::forward<Args>(args)...} {}
+  ChunkStoreReader(ChunkStoreReader&&) = default;
+  ChunkStoreReader& operator=(ChunkStoreReader&&) = default;
+
+  Status<void> Ensure(std::size_t size) { return reader_.Ensure(size); }
+
+  Status<void> Read(std::uint8_t* byte) { return reader_.Read(byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    return reader_.Read(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    return reader_.Skip(padding_bytes);
+  }
+
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference handle_reference) {
+    return reader_.template GetHandle<HandleType>(handle_reference);
+  }
+
+  // Forwards borrowing to the wrapped reader, when it supports it.
+  template <typename R = Reader>
+  auto Borrow(const void** data, std::size_t size)
+      -> decltype(std::declval<R&>().Borrow(data, size)) {
+    return reader_.Borrow(data, size);
+  }
+
+  // Forwards input limits to the wrapped reader, when it supports them.
+  template <typename R = Reader>
+  auto PushLimit(std::size_t size)
+      -> decltype(std::declval<R&>().PushLimit(size)) {
+    return reader_.PushLimit(size);
+  }
+
+  template <typename R = Reader>
+  auto PopLimit(std::size_t previous)
+      -> decltype(std::declval<R&>().PopLimit(previous)) {
+    return reader_.PopLimit(previous);
+  }
+
+  template <typename R = Reader>
+  auto remaining() const -> decltype(std::declval<const R&>().remaining()) {
+    return reader_.remaining();
+  }
+
+  // Forwards the object table of the wrapped reader, when it has one.
+  template <typename R = Reader>
+  auto object_table() -> decltype(std::declval<R&>().object_table()) {
+    return reader_.object_table();
+  }
+
+  // Forwards the string dictionary of the wrapped reader, when it has one.
+  template <typename R = Reader>
+  auto string_dictionary()
+      -> decltype(std::declval<R&>().string_dictionary()) {
+    return reader_.string_dictionary();
+  }
+
+  ChunkDecodeStore* chunk_store() { return &store_; }
+
+  const ChunkDecodeStore& store() const { return store_; }
+  ChunkDecodeStore& store() { return store_; }
+
+  const Reader& reader() const { return reader_; }
+  Reader& reader() { return reader_; }
+  Reader&& take() { return std::move(reader_); }
+
+ private:
+  Reader reader_;
+  ChunkDecodeStore store_;
+
+  ChunkStoreReader(const ChunkStoreReader&) = delete;
+  ChunkStoreReader& operator=(const ChunkStoreReader&) = delete;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CHUNK_STORE_READER_H_
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CHUNK_STORE_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CHUNK_STORE_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/chunk_store.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// ChunkStoreWriter is a writer adapter that carries a ChunkEncodeStore for the
+// ChunkedBlob values written through it. The store lasts as long as the
+// writer, spanning every value written to the same Serializer, and mirrors the
+// ChunkStoreReader on the receiving end; see nop/base/chunk_store.h.
+//
+// Chunk manifests keep their chunks when the receiver skips them, but a
+// ChunkedBlob sent as binary cannot be told apart from other binary data:
+// values containing ChunkedBlob should be decoded in full by the receiver, or
+// skipping a blob sent as binary leaves the stores out of step.
+//
+// Example:
+//
+//  Serializer<ChunkStoreWriter<StreamWriter<std::stringstream>>> serializer;
+//  serializer.writer().store().set_limit(64 * 1024 * 1024);
+//  for (const Snapshot& snapshot : snapshots)
+//    serializer.Write(snapshot);
+//
+template <typename Writer>
+class ChunkStoreWriter {
+ public:
+  template <typename... Args>
+  ChunkStoreWriter(Args&&... args)
+      : writer_{std::forward<Args>(args)...} {}
+  ChunkStoreWriter(ChunkStoreWriter&&) = default;
+  ChunkStoreWriter& operator=(ChunkStoreWriter&&) = default;
+
+  Status<void> Prepare(std::size_t size) { return writer_.Prepare(size); }
+
+  Status<void> Write(std::uint8_t byte) { return writer_.Write(byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    return writer_.Write(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return writer_.Skip(padding_bytes, padding_value);
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    return writer_.PushHandle(handle);
+  }
+
+  template <typename W = Writer>
+  auto Flush() -> decltype(std::declval<W&>().Flush()) {
+    return writer_.Flush();
+  }
+
+  // Forwards the object table of the wrapped writer, when it has one.
+  template <typename W = Writer>
+  auto object_table() -> decltype(std::declval<W&>().object_table()) {
+    return writer_.object_table();
+  }
+
+  // Forwards the string dictionary of the wrapped writer, when it has one.
+  template <typename W = Writer>
+  auto string_dictionary()
+      -> decltype(std::declval<W&>().string_dictionary()) {
+    return writer_.string_dictionary();
+  }
+
+  ChunkEncodeStore* chunk_store() { return &store_; }
+
+  const ChunkEncodeStore& store() const { return store_; }
+  ChunkEncodeStore& store() { return store_; }
+
+  const Writer& writer() const { return writer_; }
+  Writer& writer() { return writer_; }
+  Writer&& take() { return std::move(writer_); }
+
+ private:
+  Writer writer_;
+  ChunkEncodeStore store_;
+
+  ChunkStoreWriter(const ChunkStoreWriter&) = delete;
+  ChunkStoreWriter& operator=(const ChunkStoreWriter&) = delete;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CHUNK_STORE_WRITER_H_
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CHUNKED_ARRAY_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CHUNKED_ARRAY_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <nop/base/encoding.h>
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+// ChunkedArrayWriter writes an array of unknown length using the chunked
+// array encoding described in nop/base/vector.h, which may be read back as a
+// std::vector<T>. Elements are encoded into an internal buffer as they are
+// appended and written as one chunk whenever chunk_size elements have
+// accumulated, so memory use is bounded by the chunk size rather than by the
+// length of the array.
+//
+// The writer works with any writer type. A stream is started with
+// BeginStream(), elements are added with Append(), and the stream is finished
+// with End(), which writes any buffered elements and the terminator.
+//
+// The internal buffer is reused for the next chunk, so each chunk is followed
+// by a Flush() of the underlying writer when it supports flushing, releasing
+// any reference the writer kept to the chunk bytes, as BufferedFdWriter does.
+// GatherWriter keeps references until its iovecs are consumed and cannot be
+// used as the underlying writer.
+//
+// Example:
+//
+//  ChunkedArrayWriter<Record> stream{1024};
+//  auto status = stream.BeginStream(&writer);
+//  while (status && source.HasNext())
+//    status = stream.Append(source.Next(), &writer);
+//  if (status)
+//    status = stream.End(&writer);
+//
+template <typename T>
+class ChunkedArrayWriter {
+ public:
+  enum : std::size_t { DefaultChunkSize = 256 };
+
+  explicit ChunkedArrayWriter(std::size_t chunk_size = DefaultChunkSize)
+      : chunk_size_{chunk_size == 0 ? 1 : chunk_size} {}
+
+  // Writes the chunked array prefix, discarding any elements buffered from a
+  // previous stream.
+  template <typename Writer>
+  Status<void> BeginStream(Writer* writer) {
+    chunk_.clear();
+    count_ = 0;
+
+    auto status = writer->Prepare(1);
+    if (!status)
+      return status;
+
+    return writer->Write(static_cast<std::uint8_t>(EncodingByte::ChunkedArray));
+  }
+
+  // Adds |element| to the stream, writing a chunk if the buffer is full.
+  template <typename Writer>
+  Status<void> Append(const T& element, Writer* writer) {
+    auto status = Encoding<T>::Write(element, &chunk_);
+    if (!status)
+      return status;
+
+    if (++count_ >= chunk_size_)
+      return Flush(writer);
+    else
+      return {};
+  }
+
+  // Writes the buffered elements, if any, as one chunk.
+  template <typename Writer>
+  Status<void> Flush(Writer* writer) {
+    if (count_ == 0)
+      return {};
+
+    const SizeType count = count_;
+    auto status =
+        writer->Prepare(Encoding<SizeType>::Size(count) + chunk_.size());
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(count, writer);
+    if (!status)
+      return status;
+
+    status = writer->Write(chunk_.data().data(),
+                           chunk_.data().data() + chunk_.size());
+    if (!status)
+      return status;
+
+    // The writer may still refer to the chunk bytes, which are about to be
+    // overwritten by the next chunk.
+    status = FlushWriter(writer);
+    if (!status)
+      return status;
+
+    chunk_.clear();
+    count_ = 0;
+    return {};
+  }
+
+  // Writes the buffered elements and the terminator, finishing the stream.
+  template <typename Writer>
+  Status<void> End(Writer* writer) {
+    auto status = Flush(writer);
+    if (!status)
+      return status;
+
+    const SizeType terminator = 0;
+    status = writer->Prepare(Encoding<SizeType>::Size(terminator));
+    if (!status)
+      return status;
+
+    return Encoding<SizeType>::Write(terminator, writer);
+  }
+
+  // Returns the number of elements buffered for the next chunk.
+  std::size_t buffered_count() const { return count_; }
+
+  std::size_t chunk_size() const { return chunk_size_; }
+
+ private:
+  template <typename W>
+  static std::enable_if_t<IsDetected<WriterFlushTest, W>::value, Status<void>>
+  FlushWriter(W* writer) {
+    return writer->Flush();
+  }
+
+  template <typename W>
+  static std::enable_if_t<!IsDetected<WriterFlushTest, W>::value, Status<void>>
+  FlushWriter(W* /*writer*/) {
+    return {};
+  }
+
+  std::size_t chunk_size_;
+  std::size_t count_{0};
+  VectorWriter chunk_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CHUNKED_ARRAY_WRITER_H_
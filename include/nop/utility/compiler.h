@@ -34,4 +34,20 @@
 #define NOP_FALLTHROUGH
 #endif
 
+// Prevents inlining of functions that are meant to have a single copy.
+#if defined(__GNUC__) || defined(__clang__)
+#define NOP_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define NOP_NOINLINE __declspec(noinline)
+#else
+#define NOP_NOINLINE
+#endif
+
+// Test for C++20 coroutine support.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define NOP_HAS_COROUTINES 1
+#else
+#define NOP_HAS_COROUTINES 0
+#endif
+
 #endif  // LIBNOP_INCLUDE_NOP_UTILITY_COMPILER_H_
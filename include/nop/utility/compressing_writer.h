@@ -0,0 +1,204 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_COMPRESSING_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_COMPRESSING_WRITER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/serializer.h>
+#include <nop/base/utility.h>
+#include <nop/status.h>
+#include <nop/utility/lz_codec.h>
+
+namespace nop {
+
+//
+// Compressed stream format used by CompressingWriter and DecompressingReader:
+//
+// +---------+---------+---//----+-----+
+// | INT64:L | INT64:C | C BYTES | ... |
+// +---------+---------+---//----+-----+
+//
+// The stream is a sequence of blocks, each holding L bytes of uncompressed
+// output, where 0 < L <= the block size. C is the size of the compressed block
+// that follows. Blocks that do not get smaller when compressed are stored as
+// they are with C = 0, followed by the L uncompressed bytes.
+//
+
+// CompressingWriter is a writer type that wraps another writer pointer and
+// compresses the output in blocks of at most |block_size| bytes as it is
+// written, so serialized values are never held uncompressed in full. Output is
+// collected until a block fills up or Flush() is called; the library-provided
+// Serializer types call Flush() at the end of every top-level Write(), so each
+// value ends with a complete block and may be decoded as soon as it arrives.
+// The underlying writer is prepared for each block before it is written and
+// flushed after it when it supports flushing, since writers such as
+// BufferedFdWriter may keep a reference to the block bytes, which are reused
+// for the next block. GatherWriter keeps references until its iovecs are
+// consumed and cannot be used as the underlying writer. Handles are passed
+// through to the underlying writer unchanged.
+//
+// Codec is LzCodec by default; see lz_codec.h for the interface other codecs
+// implement.
+template <typename Writer, typename Codec = LzCodec>
+class CompressingWriter {
+ public:
+  enum : std::size_t { kDefaultBlockSize = 64 * 1024 };
+
+  CompressingWriter() = default;
+  CompressingWriter(Writer* writer, std::size_t block_size = kDefaultBlockSize)
+      : writer_{writer}, block_size_{std::max<std::size_t>(block_size, 1)} {}
+  CompressingWriter(const CompressingWriter&) = delete;
+  CompressingWriter(CompressingWriter&&) = default;
+
+  CompressingWriter& operator=(const CompressingWriter&) = delete;
+  CompressingWriter& operator=(CompressingWriter&&) = default;
+
+  // Output is buffered in bounded blocks, so any size may be written.
+  Status<void> Prepare(std::size_t /*size*/) { return {}; }
+
+  Status<void> Write(std::uint8_t byte) { return Write(&byte, &byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::uint8_t* data = reinterpret_cast<const std::uint8_t*>(begin);
+    std::size_t size = (end - begin) * sizeof(T);
+    while (size > 0) {
+      const std::size_t length = std::min(size, block_size_ - block_.size());
+      block_.insert(block_.end(), data, data + length);
+      data += length;
+      size -= length;
+
+      auto status = FlushFullBlock();
+      if (!status)
+        return status;
+    }
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    while (padding_bytes > 0) {
+      const std::size_t length =
+          std::min(padding_bytes, block_size_ - block_.size());
+      block_.insert(block_.end(), length, padding_value);
+      padding_bytes -= length;
+
+      auto status = FlushFullBlock();
+      if (!status)
+        return status;
+    }
+    return {};
+  }
+
+  template <typename HandleType>
+  Status<HandleType> PushHandle(const HandleType& handle) {
+    return writer_->PushHandle(handle);
+  }
+
+  // Compresses and writes any buffered output as a block and flushes the
+  // underlying writer, when it supports flushing.
+  Status<void> Flush() {
+    if (!block_.empty())
+      return WriteBlock();
+    else
+      return FlushWriter(writer_);
+  }
+
+  std::size_t block_size() const { return block_size_; }
+
+  const Writer& writer() const { return *writer_; }
+  Writer& writer() { return *writer_; }
+
+ private:
+  Status<void> FlushFullBlock() {
+    if (block_.size() < block_size_)
+      return {};
+    return WriteBlock();
+  }
+
+  Status<void> WriteBlock() {
+    const std::size_t size = block_.size();
+    compressed_.resize(Codec::MaxCompressedSize(size));
+    auto compressed_size = Codec::Compress(block_.data(), size,
+                                           compressed_.data(),
+                                           compressed_.size());
+    if (!compressed_size)
+      return compressed_size.error();
+
+    // Store the block as it is when compression does not make it smaller.
+    const bool stored = compressed_size.get() >= size;
+    const SizeType payload_size = stored ? 0 : compressed_size.get();
+    const std::uint8_t* payload = stored ? block_.data() : compressed_.data();
+    const std::size_t payload_bytes = stored ? size : payload_size;
+
+    auto status = writer_->Prepare(Encoding<SizeType>::Size(size) +
+                                   Encoding<SizeType>::Size(payload_size) +
+                                   payload_bytes);
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(size, writer_);
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(payload_size, writer_);
+    if (!status)
+      return status;
+
+    status = writer_->Write(payload, payload + payload_bytes);
+    if (!status)
+      return status;
+
+    // The writer may still refer to the payload, which is overwritten by the
+    // next block.
+    status = FlushWriter(writer_);
+    if (!status)
+      return status;
+
+    block_.clear();
+    return {};
+  }
+
+  template <typename W>
+  static std::enable_if_t<IsDetected<WriterFlushTest, W>::value, Status<void>>
+  FlushWriter(W* writer) {
+    return writer->Flush();
+  }
+
+  template <typename W>
+  static std::enable_if_t<!IsDetected<WriterFlushTest, W>::value, Status<void>>
+  FlushWriter(W* /*writer*/) {
+    return {};
+  }
+
+  Writer* writer_{nullptr};
+  std::size_t block_size_{kDefaultBlockSize};
+  std::vector<std::uint8_t> block_;
+  std::vector<std::uint8_t> compressed_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_COMPRESSING_WRITER_H_
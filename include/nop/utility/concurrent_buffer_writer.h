@@ -0,0 +1,166 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CONCURRENT_BUFFER_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CONCURRENT_BUFFER_WRITER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#include <nop/base/encoding.h>
+#include <nop/base/size_cache.h>
+#include <nop/status.h>
+#include <nop/utility/bounded_writer.h>
+#include <nop/utility/buffer_writer.h>
+
+namespace nop {
+
+// ConcurrentBufferWriter lets any number of threads serialize values into one
+// shared byte buffer without a lock. Each value is sized first, as Serializer
+// does, and Write() claims a span of exactly that size with a single atomic
+// fetch-add. The value is then encoded into the span concurrently with the
+// writes of other threads.
+//
+// Values are written as frames in the format of FrameWriter, so that the
+// buffer contents may be forwarded to a sink and split by FrameReader. Spans
+// are published in the order they were claimed: once its span is encoded, a
+// writer waits for the writers of earlier spans to publish theirs before it
+// publishes its own. committed() is the length of the prefix of the buffer in
+// which every frame is complete, which is always a whole number of frames.
+// Since publication is ordered, a writer that is descheduled mid-encode holds
+// up the publication, but not the encoding, of the spans after its own.
+//
+// Write() returns ErrorStatus::WriteLimitReached when the buffer has no room
+// for the frame; every later Write() fails as well until Reset(). When a value
+// fails to encode after its span is claimed, the span is still published with
+// a payload of NIL bytes, which fails to decode as any other type, so that
+// later frames are not held back.
+//
+// The buffer is not owned by the writer. Reset() must only be called when no
+// thread is writing, for example after the consumer has drained a full buffer.
+//
+// Example:
+//
+//  ConcurrentBufferWriter writer{buffer, sizeof(buffer)};
+//
+//  // On any thread.
+//  auto status = writer.Write(entry);
+//
+//  // On the consumer.
+//  const std::size_t end = writer.committed();
+//  Forward(buffer + forwarded, end - forwarded);
+//  forwarded = end;
+//
+class ConcurrentBufferWriter {
+ public:
+  ConcurrentBufferWriter(void* buffer, std::size_t size)
+      : buffer_{static_cast<std::uint8_t*>(buffer)}, size_{size} {}
+
+  ConcurrentBufferWriter(const ConcurrentBufferWriter&) = delete;
+  void operator=(const ConcurrentBufferWriter&) = delete;
+
+  // Writes |value| as a frame, returning the offset of the frame in the buffer.
+  template <typename T>
+  Status<std::size_t> Write(const T& value) {
+    SizeCache cache;
+    const SizeType size = CachedSize(value, &cache);
+    const std::size_t header_size = Encoding<SizeType>::Size(size);
+    const std::size_t frame_size = header_size + size;
+
+    const std::size_t begin =
+        reserved_.fetch_add(frame_size, std::memory_order_relaxed);
+    if (begin > size_ || size_ - begin < frame_size)
+      return ErrorStatus::WriteLimitReached;
+
+    BufferWriter buffer_writer{buffer_ + begin, frame_size};
+    auto status = Encoding<SizeType>::Write(size, &buffer_writer);
+    if (status)
+      status = WritePayload(value, size, &buffer_writer, &cache);
+    if (!status) {
+      std::memset(buffer_ + begin + header_size,
+                  static_cast<std::uint8_t>(EncodingByte::Nil), size);
+    }
+
+    Publish(begin, begin + frame_size);
+    if (!status)
+      return status.error();
+    else
+      return begin;
+  }
+
+  // Returns the number of bytes at the start of the buffer that hold complete
+  // frames. The bytes are safe to read once this returns.
+  std::size_t committed() const {
+    return committed_.load(std::memory_order_acquire);
+  }
+
+  // Returns true if a Write() has failed because the buffer is full.
+  bool full() const {
+    return reserved_.load(std::memory_order_relaxed) > size_;
+  }
+
+  // Empties the buffer. Must not be called concurrently with Write().
+  void Reset() {
+    reserved_.store(0, std::memory_order_relaxed);
+    committed_.store(0, std::memory_order_relaxed);
+  }
+
+  const std::uint8_t* data() const { return buffer_; }
+  std::size_t capacity() const { return size_; }
+
+ private:
+  enum : unsigned { kSpinCount = 64 };
+
+  template <typename T>
+  static Status<void> WritePayload(const T& value, SizeType size,
+                                   BufferWriter* writer, SizeCache* cache) {
+    SizeCacheWriter<BufferWriter> cache_writer{writer, cache};
+    BoundedWriter<SizeCacheWriter<BufferWriter>> bounded_writer{&cache_writer,
+                                                                size};
+    auto status = Encoding<T>::Write(value, &bounded_writer);
+    if (!status)
+      return status;
+
+    return bounded_writer.WritePadding();
+  }
+
+  // Waits for the spans before |begin| to be published and then publishes the
+  // span ending at |end|.
+  void Publish(std::size_t begin, std::size_t end) {
+    for (unsigned spins = 0;
+         committed_.load(std::memory_order_acquire) != begin; spins++) {
+      if (spins >= kSpinCount)
+        std::this_thread::yield();
+    }
+    committed_.store(end, std::memory_order_release);
+  }
+
+  std::uint8_t* const buffer_;
+  const std::size_t size_;
+
+  // Keep the two counters on separate cache lines; every writer updates the
+  // first once and the second once, and consumers poll the second.
+  alignas(64) std::atomic<std::size_t> reserved_{0};
+  alignas(64) std::atomic<std::size_t> committed_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CONCURRENT_BUFFER_WRITER_H_
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CONTENT_CHUNKER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CONTENT_CHUNKER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace nop {
+
+// ContentChunker splits byte buffers into chunks at positions chosen by their
+// content rather than by offset, using the FastCDC rolling gear hash with
+// normalized chunking. A boundary falls wherever the hash of the preceding
+// bytes matches a mask, so an insertion or deletion in one part of a buffer
+// moves only the boundaries near the edit; the chunks of the rest of the buffer
+// are unchanged and match the chunks of the previous version of the buffer.
+//
+// Chunks are at least min_size() and at most max_size() bytes, except for the
+// last chunk of a buffer, which may be shorter. Boundaries are harder to match
+// before avg_size() bytes and easier after, which keeps most chunks close to
+// the average. The average must be a power of two.
+//
+// The boundaries depend only on the bytes and the sizes, so every peer using
+// the same sizes splits the same buffer identically.
+//
+// Example:
+//
+//  ContentChunker chunker;
+//  chunker.ForEachChunk(data, size, [](const std::uint8_t* chunk,
+//                                      std::size_t chunk_size) {
+//    Store(chunk, chunk_size);
+//  });
+//
+class ContentChunker {
+ public:
+  enum : std::size_t {
+    kDefaultMinSize = 2 * 1024,
+    kDefaultAverageSize = 8 * 1024,
+    kDefaultMaxSize = 64 * 1024,
+  };
+
+  ContentChunker()
+      : ContentChunker{kDefaultMinSize, kDefaultAverageSize, kDefaultMaxSize} {}
+  ContentChunker(std::size_t min_size, std::size_t avg_size,
+                 std::size_t max_size)
+      : min_size_{std::max<std::size_t>(min_size, 1)},
+        avg_size_{std::max(avg_size, min_size_)},
+        max_size_{std::max(max_size, avg_size_)} {
+    const std::size_t bits = Log2(avg_size_);
+    small_mask_ = HighMask(bits + 2);
+    large_mask_ = HighMask(bits > 2 ? bits - 2 : 1);
+  }
+
+  // Returns the size of the chunk that starts at |data|, given |size| bytes.
+  std::size_t NextChunkSize(const std::uint8_t* data, std::size_t size) const {
+    if (size <= min_size_)
+      return size;
+
+    const std::size_t limit = std::min(size, max_size_);
+    const std::size_t normal = std::min(limit, avg_size_);
+    const std::uint64_t* gear = Gear();
+    std::uint64_t hash = 0;
+    std::size_t index = min_size_;
+    for (; index < normal; index++) {
+      hash = (hash << 1) + gear[data[index]];
+      if ((hash & small_mask_) == 0)
+        return index + 1;
+    }
+    for (; index < limit; index++) {
+      hash = (hash << 1) + gear[data[index]];
+      if ((hash & large_mask_) == 0)
+        return index + 1;
+    }
+    return limit;
+  }
+
+  // Calls |op| with the data and size of each chunk of |size| bytes at |data|,
+  // in order.
+  template <typename Op>
+  void ForEachChunk(const std::uint8_t* data, std::size_t size, Op&& op) const {
+    while (size > 0) {
+      const std::size_t chunk_size = NextChunkSize(data, size);
+      op(data, chunk_size);
+      data += chunk_size;
+      size -= chunk_size;
+    }
+  }
+
+  std::size_t min_size() const { return min_size_; }
+  std::size_t avg_size() const { return avg_size_; }
+  std::size_t max_size() const { return max_size_; }
+
+ private:
+  static std::size_t Log2(std::size_t value) {
+    std::size_t bits = 0;
+    while (value >>= 1)
+      bits++;
+    return bits;
+  }
+
+  // Returns a mask of the |bits| most significant bits. The low bits of the
+  // hash depend only on the last few bytes, while the high bits depend on up
+  // to 64 of them.
+  static std::uint64_t HighMask(std::size_t bits) {
+    bits = std::min<std::size_t>(bits, 63);
+    return ~std::uint64_t{0} << (64 - bits);
+  }
+
+  // Returns the table of random values for each byte, generated with
+  // SplitMix64 so that every peer uses the same table.
+  static const std::uint64_t* Gear() {
+    static const GearTable table;
+    return table.values;
+  }
+
+  struct GearTable {
+    GearTable() {
+      std::uint64_t state = 0;
+      for (std::uint64_t& value : values) {
+        state += 0x9e3779b97f4a7c15ULL;
+        std::uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        value = z ^ (z >> 31);
+      }
+    }
+
+    std::uint64_t values[256];
+  };
+
+  std::size_t min_size_;
+  std::size_t avg_size_;
+  std::size_t max_size_;
+  std::uint64_t small_mask_;
+  std::uint64_t large_mask_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CONTENT_CHUNKER_H_
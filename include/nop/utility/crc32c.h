@@ -0,0 +1,147 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CRC32C_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CRC32C_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace nop {
+
+//
+// Incremental CRC32C (Castagnoli) computation.
+//
+// When the target has CRC32C instructions, SSE4.2 on x86 or the CRC extension
+// on ARMv8, and the compiler is configured to use them, eight bytes are folded
+// in per instruction. Otherwise a portable slicing-by-8 table implementation
+// is used, which processes eight bytes per step with table lookups. Both
+// produce identical results.
+//
+class Crc32c {
+ public:
+  Crc32c() = default;
+
+  // Folds |size| bytes at |data| into the checksum.
+  void Update(const void* data, std::size_t size) {
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    state_ = Extend(state_, bytes, size);
+  }
+
+  // Returns the checksum of the bytes folded in so far.
+  std::uint32_t value() const { return ~state_; }
+
+  // Restarts the checksum.
+  void Reset() { state_ = kInitialState; }
+
+  // Returns the checksum of |size| bytes at |data|.
+  static std::uint32_t Compute(const void* data, std::size_t size) {
+    Crc32c crc;
+    crc.Update(data, size);
+    return crc.value();
+  }
+
+ private:
+  enum : std::uint32_t {
+    kInitialState = 0xffffffffu,
+    kPolynomial = 0x82f63b78u,  // Reversed Castagnoli polynomial.
+  };
+
+  using Table = std::array<std::array<std::uint32_t, 256>, 8>;
+
+  static std::uint64_t Load64(const std::uint8_t* data) {
+    std::uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+
+#if defined(__SSE4_2__) || defined(__ARM_FEATURE_CRC32)
+  static std::uint32_t Extend(std::uint32_t state, const std::uint8_t* data,
+                              std::size_t size) {
+#if defined(__SSE4_2__)
+    std::uint64_t state64 = state;
+    for (; size >= 8; size -= 8, data += 8)
+      state64 = _mm_crc32_u64(state64, Load64(data));
+    state = static_cast<std::uint32_t>(state64);
+    for (; size > 0; size--, data++)
+      state = _mm_crc32_u8(state, *data);
+#else
+    for (; size >= 8; size -= 8, data += 8)
+      state = __crc32cd(state, Load64(data));
+    for (; size > 0; size--, data++)
+      state = __crc32cb(state, *data);
+#endif
+    return state;
+  }
+#else
+  // Builds the slicing-by-8 tables: entry [k][b] is the CRC of byte b followed
+  // by k zero bytes.
+  static const Table& GetTable() {
+    static const Table table = [] {
+      Table result{};
+      for (std::uint32_t i = 0; i < 256; i++) {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+          crc = (crc >> 1) ^ (kPolynomial & (0u - (crc & 1)));
+        result[0][i] = crc;
+      }
+      for (std::uint32_t i = 0; i < 256; i++) {
+        for (std::size_t k = 1; k < 8; k++) {
+          const std::uint32_t previous = result[k - 1][i];
+          result[k][i] = (previous >> 8) ^ result[0][previous & 0xff];
+        }
+      }
+      return result;
+    }();
+    return table;
+  }
+
+  static std::uint32_t Extend(std::uint32_t state, const std::uint8_t* data,
+                              std::size_t size) {
+    const Table& table = GetTable();
+    for (; size >= 8; size -= 8, data += 8) {
+      // Combine the state with the first four bytes in little-endian order.
+      const std::uint32_t low =
+          state ^ (static_cast<std::uint32_t>(data[0]) |
+                   static_cast<std::uint32_t>(data[1]) << 8 |
+                   static_cast<std::uint32_t>(data[2]) << 16 |
+                   static_cast<std::uint32_t>(data[3]) << 24);
+      state = table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff] ^
+              table[5][(low >> 16) & 0xff] ^ table[4][low >> 24] ^
+              table[3][data[4]] ^ table[2][data[5]] ^ table[1][data[6]] ^
+              table[0][data[7]];
+    }
+    for (; size > 0; size--, data++)
+      state = (state >> 8) ^ table[0][(state ^ *data) & 0xff];
+    return state;
+  }
+#endif
+
+  std::uint32_t state_{kInitialState};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CRC32C_H_
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_DECODE_CACHE_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_DECODE_CACHE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <utility>
+
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/types/flat_hash_map.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/sip_hash.h>
+
+namespace nop {
+
+// Statistics of a DecodeCache.
+struct DecodeCacheStats {
+  // Number of lookups that found a decoded value, and that had to decode.
+  std::size_t hit_count{0};
+  std::size_t miss_count{0};
+
+  // Number of values evicted to stay within the capacity.
+  std::size_t eviction_count{0};
+
+  // Number of cached values and the total encoded size of them.
+  std::size_t entry_count{0};
+  std::size_t bytes_held{0};
+
+  // Returns the fraction of lookups that found a decoded value.
+  double hit_rate() const {
+    const std::size_t lookups = hit_count + miss_count;
+    return lookups ? static_cast<double>(hit_count) / lookups : 0.0;
+  }
+};
+
+namespace detail {
+
+// Reduces a content hash to a std::size_t for the index of a DecodeCache. The
+// content hash is already uniform, so any word of it will do.
+struct ContentHashIndex {
+  std::size_t operator()(std::uint64_t hash) const {
+    return static_cast<std::size_t>(hash);
+  }
+  std::size_t operator()(const std::array<std::uint64_t, 2>& hash) const {
+    return static_cast<std::size_t>(hash[0] ^ hash[1]);
+  }
+};
+
+}  // namespace detail
+
+// DecodeCache keeps decoded values of type T keyed by the content hash of
+// their encoding, so that payloads that are received over and over decode
+// once and then share one immutable object. Decode() hashes the encoding,
+// which is much cheaper than decoding it, and returns the cached object on a
+// hit; on a miss it decodes the encoding and caches the result.
+//
+// The cache holds values whose encodings total at most |capacity_bytes|,
+// evicting the least recently used values first. The encoded size stands in
+// for the decoded size of each value. Values larger than the capacity are
+// decoded but not cached. Evicted values stay alive for as long as callers
+// hold them.
+//
+// The hash is computed by Hasher, as for HashingWriter, and must be a
+// collision-resistant hash since equal hashes are taken to mean equal
+// encodings. The default is SipHasher<128>; give it a secret key when the
+// payloads come from untrusted peers, so that collisions cannot be forged.
+// A key computed by a HashingWriter with the same Hasher on the sending side
+// may be passed to Decode() to skip hashing on the receiving side, when the
+// sender is trusted.
+//
+// DecodeCache is not thread-safe; guard shared instances with a mutex.
+//
+// Example:
+//
+//  DecodeCache<ServiceConfig> configs{16 * 1024 * 1024};
+//  ...
+//  auto config = configs.Decode(payload.data(), payload.size());
+//  if (!config)
+//    return config.error();
+//  Apply(*config.get());
+//
+template <typename T, typename Hasher = SipHasher<128>>
+class DecodeCache {
+ public:
+  using HashType = decltype(std::declval<const Hasher&>().value());
+  using ValuePointer = std::shared_ptr<const T>;
+
+  explicit DecodeCache(std::size_t capacity_bytes,
+                       const Hasher& hasher = Hasher{})
+      : capacity_bytes_{capacity_bytes}, hasher_{hasher} {}
+
+  DecodeCache(const DecodeCache&) = delete;
+  void operator=(const DecodeCache&) = delete;
+
+  // Returns the value encoded in the |size| bytes at |data|, decoding it only
+  // if an identical encoding is not cached.
+  Status<ValuePointer> Decode(const void* data, std::size_t size) {
+    return Decode(Hash(data, size), data, size);
+  }
+
+  // Returns the value encoded in the |size| bytes at |data|, whose content
+  // hash is |key|, decoding it only if the key is not cached.
+  Status<ValuePointer> Decode(const HashType& key, const void* data,
+                              std::size_t size) {
+    ValuePointer cached = Find(key);
+    if (cached)
+      return {std::move(cached)};
+
+    auto value = std::make_shared<T>();
+    Deserializer<BufferReader> deserializer{data, size};
+    auto status = deserializer.Read(value.get());
+    if (!status)
+      return status.error();
+
+    ValuePointer decoded{std::move(value)};
+    Insert(key, decoded, size);
+    return {std::move(decoded)};
+  }
+
+  // Returns the cached value for |key|, or nullptr. Lookups count towards the
+  // hit rate whether or not they are followed by Decode().
+  ValuePointer Find(const HashType& key) {
+    auto search = index_.find(key);
+    if (search == index_.end()) {
+      stats_.miss_count++;
+      return nullptr;
+    }
+
+    stats_.hit_count++;
+    entries_.splice(entries_.begin(), entries_, search->second);
+    return search->second->value;
+  }
+
+  // Returns the content hash of the |size| bytes at |data|.
+  HashType Hash(const void* data, std::size_t size) const {
+    Hasher hasher{hasher_};
+    hasher.Reset();
+    hasher.Update(data, size);
+    return hasher.value();
+  }
+
+  // Evicts every value.
+  void Clear() {
+    entries_.clear();
+    index_.clear();
+    stats_.entry_count = 0;
+    stats_.bytes_held = 0;
+  }
+
+  std::size_t capacity_bytes() const { return capacity_bytes_; }
+  const DecodeCacheStats& stats() const { return stats_; }
+
+  // Resets the hit, miss, and eviction counts.
+  void ResetStats() {
+    stats_.hit_count = 0;
+    stats_.miss_count = 0;
+    stats_.eviction_count = 0;
+  }
+
+ private:
+  struct Entry {
+    HashType key;
+    ValuePointer value;
+    std::size_t size;
+  };
+
+  using EntryList = std::list<Entry>;
+
+  // Caches |value| under |key| as the most recently used value.
+  void Insert(const HashType& key, const ValuePointer& value,
+              std::size_t size) {
+    if (size > capacity_bytes_)
+      return;
+
+    while (stats_.bytes_held + size > capacity_bytes_)
+      Evict();
+
+    entries_.push_front(Entry{key, value, size});
+    index_.emplace(key, entries_.begin());
+    stats_.entry_count++;
+    stats_.bytes_held += size;
+  }
+
+  // Evicts the least recently used value.
+  void Evict() {
+    const Entry& entry = entries_.back();
+    index_.erase(entry.key);
+    stats_.entry_count--;
+    stats_.bytes_held -= entry.size;
+    stats_.eviction_count++;
+    entries_.pop_back();
+  }
+
+  std::size_t capacity_bytes_;
+  Hasher hasher_;
+  EntryList entries_;
+  FlatHashMap<HashType, typename EntryList::iterator, detail::ContentHashIndex>
+      index_;
+  DecodeCacheStats stats_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_DECODE_CACHE_H_
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_DECOMPRESSING_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_DECOMPRESSING_READER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/status.h>
+#include <nop/utility/lz_codec.h>
+
+namespace nop {
+
+// DecompressingReader is a reader type that wraps another reader pointer and
+// decompresses the block stream written by CompressingWriter one block at a
+// time as it is read; see compressing_writer.h for the format. Blocks larger
+// than |block_size| or whose compressed size exceeds the codec bound are
+// rejected with ErrorStatus::InvalidContainerLength before anything is
+// allocated, and blocks that do not decompress to their stated size are
+// rejected with ErrorStatus::ProtocolError. Handles are requested from the
+// underlying reader unchanged.
+//
+// Like other streaming readers, Ensure() cannot tell how much input remains
+// beyond the current block and only fails when the underlying reader does.
+template <typename Reader, typename Codec = LzCodec>
+class DecompressingReader {
+ public:
+  enum : std::size_t { kDefaultBlockSize = 64 * 1024 };
+
+  DecompressingReader() = default;
+  DecompressingReader(Reader* reader,
+                      std::size_t block_size = kDefaultBlockSize)
+      : reader_{reader}, block_size_{block_size} {}
+  DecompressingReader(const DecompressingReader&) = delete;
+  DecompressingReader(DecompressingReader&&) = default;
+
+  DecompressingReader& operator=(const DecompressingReader&) = delete;
+  DecompressingReader& operator=(DecompressingReader&&) = default;
+
+  Status<void> Ensure(std::size_t /*size*/) { return {}; }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    std::uint8_t* data = reinterpret_cast<std::uint8_t*>(begin);
+    std::size_t size = (end - begin) * sizeof(T);
+    while (size > 0) {
+      auto status = FillBlock();
+      if (!status)
+        return status;
+
+      const std::size_t length = std::min(size, block_.size() - index_);
+      std::memcpy(data, block_.data() + index_, length);
+      index_ += length;
+      data += length;
+      size -= length;
+    }
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    while (padding_bytes > 0) {
+      auto status = FillBlock();
+      if (!status)
+        return status;
+
+      const std::size_t length =
+          std::min(padding_bytes, block_.size() - index_);
+      index_ += length;
+      padding_bytes -= length;
+    }
+    return {};
+  }
+
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference handle_reference) {
+    return reader_->template GetHandle<HandleType>(handle_reference);
+  }
+
+  std::size_t block_size() const { return block_size_; }
+
+  const Reader& reader() const { return *reader_; }
+  Reader& reader() { return *reader_; }
+
+ private:
+  // Reads and decompresses the next block once the current one is consumed.
+  Status<void> FillBlock() {
+    if (index_ < block_.size())
+      return {};
+
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader_);
+    if (!status)
+      return status;
+
+    SizeType compressed_size = 0;
+    status = Encoding<SizeType>::Read(&compressed_size, reader_);
+    if (!status)
+      return status;
+
+    if (size == 0 || size > block_size_ ||
+        compressed_size > Codec::MaxCompressedSize(size)) {
+      return ErrorStatus::InvalidContainerLength;
+    }
+
+    const std::size_t payload_bytes = compressed_size ? compressed_size : size;
+    status = reader_->Ensure(payload_bytes);
+    if (!status)
+      return status;
+
+    index_ = 0;
+    block_.resize(size);
+    if (compressed_size == 0) {
+      status = reader_->Read(block_.data(), block_.data() + size);
+      if (!status) {
+        block_.clear();
+        return status;
+      }
+      return {};
+    }
+
+    compressed_.resize(compressed_size);
+    status = reader_->Read(compressed_.data(),
+                           compressed_.data() + compressed_size);
+    if (!status) {
+      block_.clear();
+      return status;
+    }
+
+    auto decompressed_size = Codec::Decompress(
+        compressed_.data(), compressed_size, block_.data(), size);
+    if (!decompressed_size || decompressed_size.get() != size) {
+      block_.clear();
+      return ErrorStatus::ProtocolError;
+    }
+    return {};
+  }
+
+  Reader* reader_{nullptr};
+  std::size_t block_size_{kDefaultBlockSize};
+  std::vector<std::uint8_t> block_;
+  std::vector<std::uint8_t> compressed_;
+  std::size_t index_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_DECOMPRESSING_READER_H_
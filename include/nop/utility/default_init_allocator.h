@@ -0,0 +1,95 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_DEFAULT_INIT_ALLOCATOR_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_DEFAULT_INIT_ALLOCATOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nop {
+
+// DefaultInitAllocator is an allocator adaptor that default-initializes
+// elements that a container would otherwise value-initialize. For trivial
+// types such as integers this leaves the elements uninitialized, so that
+// resizing a vector before reading into it does not first zero-fill the
+// whole buffer. Decoding a large binary field into a DefaultInitVector touches
+// each byte only once, when it is copied from the reader.
+//
+// Construction with arguments is passed on to the underlying allocator.
+//
+// Example:
+//
+//  struct Blob {
+//    std::string name;
+//    ByteBuffer contents;
+//    NOP_STRUCTURE(Blob, name, contents);
+//  };
+//
+// Note that std::basic_string does not construct its characters through its
+// allocator; strings avoid the extra pass with resize_and_overwrite() where
+// the standard library provides it.
+//
+template <typename T, typename Allocator = std::allocator<T>>
+class DefaultInitAllocator : public Allocator {
+  using Traits = std::allocator_traits<Allocator>;
+
+ public:
+  template <typename U>
+  struct rebind {
+    using other =
+        DefaultInitAllocator<U, typename Traits::template rebind_alloc<U>>;
+  };
+
+  using Allocator::Allocator;
+
+  DefaultInitAllocator() = default;
+  DefaultInitAllocator(const Allocator& allocator) noexcept
+      : Allocator{allocator} {}
+  template <typename U, typename OtherAllocator>
+  DefaultInitAllocator(
+      const DefaultInitAllocator<U, OtherAllocator>& other) noexcept
+      : Allocator{static_cast<const OtherAllocator&>(other)} {}
+
+  template <typename U>
+  void construct(U* pointer) noexcept(
+      std::is_nothrow_default_constructible<U>::value) {
+    ::new (static_cast<void*>(pointer)) U;
+  }
+
+  template <typename U, typename... Args>
+  void construct(U* pointer, Args&&... args) {
+    Traits::construct(static_cast<Allocator&>(*this), pointer,
+                      std::forward<Args>(args)...);
+  }
+};
+
+// Vector that leaves new trivial elements uninitialized when it grows.
+template <typename T>
+using DefaultInitVector = std::vector<T, DefaultInitAllocator<T>>;
+
+// Byte buffer for large binary fields, encoded the same as
+// std::vector<std::uint8_t>.
+using ByteBuffer = DefaultInitVector<std::uint8_t>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_DEFAULT_INIT_ALLOCATOR_H_
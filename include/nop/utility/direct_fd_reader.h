@@ -0,0 +1,274 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_DIRECT_FD_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_DIRECT_FD_READER_H_
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/utility/direct_io.h>
+#include <nop/utility/io_uring.h>
+
+namespace nop {
+
+// DirectFdReader is a reader type for streaming large files, such as
+// snapshots, from an fd opened with O_DIRECT (see OpenDirect()). The file is
+// read sequentially in block-aligned chunks of buffer_size bytes. Without an
+// IoUring chunks are read synchronously as they are needed; with an IoUring in
+// the options the reader keeps buffer_count chunks read ahead of the current
+// position so that decoding overlaps with the device.
+//
+// The size of the file is taken when the reader is constructed, making it the
+// limit for Ensure(). The reader reads from the beginning of the file, takes
+// ownership of the fd, and closes it when destroyed.
+//
+// Example:
+//
+//  auto fd = OpenDirect(path, O_RDONLY);
+//  ...
+//  Deserializer<DirectFdReader> deserializer{fd.get()};
+//  auto status = deserializer.Read(&snapshot);
+//
+class DirectFdReader {
+ public:
+  explicit DirectFdReader(int fd, const DirectIoOptions& options = {})
+      : fd_{fd},
+        buffer_size_{detail::AlignUp(
+            std::max(options.buffer_size, options.block_size),
+            options.block_size)},
+        ring_{options.ring} {
+    struct stat stat_buf;
+    if (::fstat(fd_, &stat_buf) < 0) {
+      error_ = ErrorStatus::IOError;
+    } else {
+      size_ = stat_buf.st_size;
+      chunk_count_ = (size_ + buffer_size_ - 1) / buffer_size_;
+    }
+
+    const std::size_t count =
+        ring_ ? std::max<std::size_t>(options.buffer_count, 1) : 1;
+    for (std::size_t i = 0; i < count; i++) {
+      buffers_.emplace_back(new Buffer{buffer_size_, options.block_size});
+      if (!buffers_.back()->memory)
+        error_ = ErrorStatus::SystemError;
+    }
+  }
+
+  DirectFdReader(const DirectFdReader&) = delete;
+  void operator=(const DirectFdReader&) = delete;
+
+  ~DirectFdReader() {
+    // The kernel may still be writing into the buffers.
+    for (auto& buffer : buffers_)
+      Wait(buffer.get());
+    ::close(fd_);
+  }
+
+  Status<void> Ensure(std::size_t size) {
+    if (error_ != ErrorStatus::None)
+      return error_;
+    else if (remaining() < size)
+      return ErrorStatus::ReadLimitReached;
+    else
+      return {};
+  }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  Status<void> Read(void* begin, void* end) {
+    std::uint8_t* data = static_cast<std::uint8_t*>(begin);
+    const std::size_t size = static_cast<std::uint8_t*>(end) - data;
+    return Consume(size, [&data](const std::uint8_t* source,
+                                 std::size_t length) {
+      std::memcpy(data, source, length);
+      data += length;
+    });
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    return Consume(padding_bytes, [](const std::uint8_t*, std::size_t) {});
+  }
+
+  // Returns the number of bytes left in the file.
+  std::uint64_t remaining() const { return size_ - position_; }
+  bool empty() const { return remaining() == 0; }
+
+  std::size_t buffer_size() const { return buffer_size_; }
+
+ private:
+  struct Buffer : IoUringOperation {
+    Buffer(std::size_t size, std::size_t alignment) : memory{size, alignment} {}
+
+    void Complete(int result) override {
+      busy = false;
+      this->result = result;
+    }
+
+    detail::AlignedBuffer memory;
+    std::uint64_t chunk{0};
+    int result{0};
+    bool busy{false};
+  };
+
+  template <typename Op>
+  Status<void> Consume(std::size_t size, Op&& op) {
+    auto status = Ensure(size);
+    if (!status)
+      return status;
+
+    while (size > 0) {
+      if (window_begin_ == window_end_) {
+        status = Fill();
+        if (!status)
+          return status;
+      }
+
+      const std::size_t length =
+          std::min<std::size_t>(size, window_end_ - window_begin_);
+      op(window_begin_, length);
+      window_begin_ += length;
+      position_ += length;
+      size -= length;
+    }
+    return {};
+  }
+
+  // Returns the number of bytes in |chunk|, which is short only at the end.
+  std::size_t ChunkSize(std::uint64_t chunk) const {
+    return std::min<std::uint64_t>(buffer_size_, size_ - chunk * buffer_size_);
+  }
+
+  // Makes the chunk containing the current position the window.
+  Status<void> Fill() {
+    const std::uint64_t chunk = position_ / buffer_size_;
+    const std::size_t expected = ChunkSize(chunk);
+    Buffer* buffer;
+
+    if (ring_) {
+      Status<void> status;
+
+      // Chunks are consumed in order. Start the read ahead on first use and
+      // replace the chunk just consumed with the next one not yet requested.
+      if (next_chunk_ == 0) {
+        for (std::size_t i = 0; i < buffers_.size(); i++) {
+          status = Request(buffers_[i].get());
+          if (!status)
+            return status;
+        }
+      } else {
+        status = Request(buffers_[head_].get());
+        if (!status)
+          return status;
+        head_ = (head_ + 1) % buffers_.size();
+      }
+
+      buffer = buffers_[head_].get();
+      status = Wait(buffer);
+      if (!status)
+        return status;
+
+      if (buffer->result < 0)
+        return error_ = ErrorStatus::IOError;
+      else if (static_cast<std::size_t>(buffer->result) != expected)
+        return error_ = ErrorStatus::ReadLimitReached;
+    } else {
+      buffer = buffers_.front().get();
+      auto status = ReadAt(buffer->memory.data(), expected,
+                           chunk * buffer_size_);
+      if (!status)
+        return error_ = status.error();
+    }
+
+    window_begin_ = buffer->memory.data() + position_ % buffer_size_;
+    window_end_ = buffer->memory.data() + expected;
+    return {};
+  }
+
+  // Queues a read of the next chunk into |buffer|, if there is one left.
+  Status<void> Request(Buffer* buffer) {
+    if (next_chunk_ >= chunk_count_)
+      return {};
+
+    buffer->chunk = next_chunk_++;
+    buffer->busy = true;
+    while (!ring_->PrepareReadAt(fd_, buffer->memory.data(), buffer_size_,
+                                 buffer->chunk * buffer_size_, buffer)) {
+      auto status = ring_->Submit();
+      if (!status)
+        return status;
+    }
+    return ring_->Submit();
+  }
+
+  // Waits for the read into |buffer|, if any, to complete.
+  Status<void> Wait(Buffer* buffer) {
+    while (buffer->busy) {
+      auto status = ring_->Submit(1);
+      if (!status)
+        return status;
+      ring_->ProcessCompletions();
+    }
+    return {};
+  }
+
+  // Reads |size| bytes at |offset|. Reads are whole buffers, which never go
+  // past the end of the block-aligned storage even when the file ends sooner.
+  Status<void> ReadAt(std::uint8_t* data, std::size_t size,
+                      std::uint64_t offset) {
+    std::size_t count = 0;
+    while (count < size) {
+      const ssize_t ret =
+          ::pread(fd_, data + count, buffer_size_ - count, offset + count);
+      if (ret > 0)
+        count += ret;
+      else if (ret == 0)
+        return ErrorStatus::ReadLimitReached;
+      else if (errno != EINTR)
+        return ErrorStatus::IOError;
+      // Otherwise interrupted by signal; retry.
+    }
+    return {};
+  }
+
+  int fd_;
+  const std::size_t buffer_size_;
+  IoUring* const ring_;
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+  std::size_t head_{0};
+  std::uint64_t next_chunk_{0};
+  std::uint64_t chunk_count_{0};
+  std::uint64_t size_{0};
+  std::uint64_t position_{0};
+  const std::uint8_t* window_begin_{nullptr};
+  const std::uint8_t* window_end_{nullptr};
+  ErrorStatus error_{ErrorStatus::None};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_DIRECT_FD_READER_H_
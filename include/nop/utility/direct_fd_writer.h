@@ -0,0 +1,293 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_DIRECT_FD_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_DIRECT_FD_WRITER_H_
+
+#include <errno.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/utility/direct_io.h>
+#include <nop/utility/io_uring.h>
+
+namespace nop {
+
+// DirectFdWriter is a writer type for streaming large files, such as
+// snapshots, to an fd opened with O_DIRECT (see OpenDirect()). Output is
+// collected in block-aligned buffers, and each full buffer is written at its
+// block-aligned file offset, either synchronously or, when an IoUring is given
+// in the options, asynchronously with up to buffer_count writes in flight.
+//
+// The library-provided Serializer types call Flush() at the end of every
+// top-level Write(); it only reports errors. Buffers are written as they fill.
+// Sync() writes the partial last buffer padded to a whole block, truncates the
+// file to the number of bytes written, and waits until the file is durable;
+// writing may continue afterwards, rewriting the padded block. Close() does the
+// same without waiting for durability and closes the fd. A file that is not
+// synced or closed may be missing its tail.
+//
+// The writer writes from the beginning of the file, takes ownership of the fd,
+// and closes it when destroyed.
+//
+// Example:
+//
+//  auto fd = OpenDirect(path, O_WRONLY | O_CREAT | O_TRUNC);
+//  ...
+//  Serializer<DirectFdWriter> serializer{fd.get()};
+//  auto status = serializer.Write(snapshot);
+//  if (status)
+//    status = serializer.writer().Sync();
+//
+class DirectFdWriter {
+ public:
+  explicit DirectFdWriter(int fd, const DirectIoOptions& options = {})
+      : fd_{fd},
+        block_size_{options.block_size},
+        buffer_size_{detail::AlignUp(
+            std::max(options.buffer_size, options.block_size),
+            options.block_size)},
+        ring_{options.ring} {
+    const std::size_t count =
+        ring_ ? std::max<std::size_t>(options.buffer_count, 1) : 1;
+    for (std::size_t i = 0; i < count; i++) {
+      buffers_.emplace_back(new Buffer{this, buffer_size_, block_size_});
+      if (!buffers_.back()->memory)
+        error_ = ErrorStatus::SystemError;
+    }
+  }
+
+  DirectFdWriter(const DirectFdWriter&) = delete;
+  void operator=(const DirectFdWriter&) = delete;
+
+  ~DirectFdWriter() { Close(); }
+
+  Status<void> Prepare(std::size_t /*size*/) { return GetError(); }
+
+  Status<void> Write(std::uint8_t byte) { return Write(&byte, &byte + 1); }
+
+  Status<void> Write(const void* begin, const void* end) {
+    const std::uint8_t* data = static_cast<const std::uint8_t*>(begin);
+    std::size_t size = static_cast<const std::uint8_t*>(end) - data;
+    while (size > 0) {
+      auto status = Reserve();
+      if (!status)
+        return status;
+
+      const std::size_t length = std::min(size, buffer_size_ - used_);
+      std::memcpy(current()->memory.data() + used_, data, length);
+      used_ += length;
+      data += length;
+      size -= length;
+    }
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    while (padding_bytes > 0) {
+      auto status = Reserve();
+      if (!status)
+        return status;
+
+      const std::size_t length = std::min(padding_bytes, buffer_size_ - used_);
+      std::memset(current()->memory.data() + used_, padding_value, length);
+      used_ += length;
+      padding_bytes -= length;
+    }
+    return {};
+  }
+
+  // Ends the current value. Buffers are written as they fill, so this only
+  // reports errors from earlier writes.
+  Status<void> Flush() { return GetError(); }
+
+  // Writes all output, truncates the file to size(), and waits until the file
+  // is durable.
+  Status<void> Sync() {
+    auto status = WriteTail();
+    if (!status)
+      return status;
+
+    while (::fdatasync(fd_) < 0) {
+      if (errno != EINTR)
+        return ErrorStatus::IOError;
+    }
+    return {};
+  }
+
+  // Writes all output, truncates the file to size(), and closes the fd.
+  Status<void> Close() {
+    if (fd_ < 0)
+      return {};
+
+    auto status = WriteTail();
+    ::close(fd_);
+    fd_ = -1;
+    return status;
+  }
+
+  // Returns the number of bytes written to the writer.
+  std::uint64_t size() const { return offset_ + used_; }
+
+  std::size_t block_size() const { return block_size_; }
+  std::size_t buffer_size() const { return buffer_size_; }
+
+ private:
+  struct Buffer : IoUringOperation {
+    Buffer(DirectFdWriter* writer, std::size_t size, std::size_t alignment)
+        : writer{writer}, memory{size, alignment} {}
+
+    void Complete(int result) override {
+      busy = false;
+      if (result < 0)
+        writer->error_ = ErrorStatus::IOError;
+      else if (static_cast<std::size_t>(result) != memory.size())
+        writer->error_ = ErrorStatus::WriteLimitReached;
+    }
+
+    DirectFdWriter* writer;
+    detail::AlignedBuffer memory;
+    bool busy{false};
+  };
+
+  Buffer* current() const { return buffers_[current_].get(); }
+
+  Status<void> GetError() const {
+    if (error_ != ErrorStatus::None)
+      return error_;
+    else
+      return {};
+  }
+
+  // Makes room in the current buffer, writing it out if it is full.
+  Status<void> Reserve() {
+    if (error_ != ErrorStatus::None)
+      return error_;
+    else if (used_ < buffer_size_)
+      return {};
+
+    Buffer* buffer = current();
+    if (ring_) {
+      buffer->busy = true;
+      while (!ring_->PrepareWriteAt(fd_, buffer->memory.data(), buffer_size_,
+                                    offset_, buffer)) {
+        auto status = ring_->Submit();
+        if (!status)
+          return status;
+      }
+      auto status = ring_->Submit();
+      if (!status)
+        return status;
+
+      current_ = (current_ + 1) % buffers_.size();
+      status = Wait(current());
+      if (!status)
+        return status;
+    } else {
+      auto status = WriteAt(buffer->memory.data(), buffer_size_, offset_);
+      if (!status)
+        return status;
+    }
+
+    offset_ += buffer_size_;
+    used_ = 0;
+    return GetError();
+  }
+
+  // Waits for the write of |buffer|, if any, to complete.
+  Status<void> Wait(Buffer* buffer) {
+    while (buffer->busy) {
+      auto status = ring_->Submit(1);
+      if (!status)
+        return status;
+      ring_->ProcessCompletions();
+    }
+    return {};
+  }
+
+  // Waits for every write in flight, then writes the partial current buffer
+  // padded to a whole block and truncates the file to the output size. The
+  // buffer keeps its contents, so the block is rewritten once it fills.
+  Status<void> WriteTail() {
+    Status<void> status;
+    for (auto& buffer : buffers_) {
+      status = Wait(buffer.get());
+      if (!status)
+        return status;
+    }
+
+    status = GetError();
+    if (!status)
+      return status;
+
+    if (used_ > 0) {
+      const std::size_t padded = detail::AlignUp(used_, block_size_);
+      std::uint8_t* data = current()->memory.data();
+      std::memset(data + used_, 0, padded - used_);
+      status = WriteAt(data, padded, offset_);
+      if (!status)
+        return status;
+    }
+
+    while (::ftruncate(fd_, size()) < 0) {
+      if (errno != EINTR)
+        return ErrorStatus::IOError;
+    }
+    return {};
+  }
+
+  Status<void> WriteAt(const std::uint8_t* data, std::size_t size,
+                       std::uint64_t offset) {
+    while (size > 0) {
+      const ssize_t ret = ::pwrite(fd_, data, size, offset);
+      if (ret > 0) {
+        data += ret;
+        size -= ret;
+        offset += ret;
+      } else if (ret == 0) {
+        return ErrorStatus::WriteLimitReached;
+      } else if (errno != EINTR) {
+        return ErrorStatus::IOError;
+      }
+      // Otherwise interrupted by signal; retry.
+    }
+    return {};
+  }
+
+  int fd_;
+  const std::size_t block_size_;
+  const std::size_t buffer_size_;
+  IoUring* const ring_;
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+  std::size_t current_{0};
+  std::size_t used_{0};
+  std::uint64_t offset_{0};
+  ErrorStatus error_{ErrorStatus::None};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_DIRECT_FD_WRITER_H_
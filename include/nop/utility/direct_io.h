@@ -0,0 +1,117 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_DIRECT_IO_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_DIRECT_IO_H_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+#include <nop/status.h>
+#include <nop/utility/io_uring.h>
+
+namespace nop {
+
+//
+// Direct I/O support shared by DirectFdWriter and DirectFdReader.
+//
+// Files opened with O_DIRECT transfer data between user memory and the device
+// without passing through the page cache, so that streaming large files does
+// not evict the working set of the host. The kernel then requires buffer
+// addresses, file offsets, and transfer sizes to be multiples of the logical
+// block size of the device. The direct writer and reader keep every transfer
+// aligned to the given block size; the writer pads the tail of the file to a
+// whole block and truncates the padding away when it finishes.
+//
+
+// Options for DirectFdWriter and DirectFdReader.
+struct DirectIoOptions {
+  // Alignment of buffer addresses, file offsets, and transfer sizes. Must be
+  // a power of two and a multiple of the logical block size of the device.
+  std::size_t block_size{4096};
+
+  // Size of each buffer, rounded up to a multiple of the block size.
+  std::size_t buffer_size{1024 * 1024};
+
+  // Number of buffers, which bounds the number of transfers in flight when
+  // an IoUring is given.
+  std::size_t buffer_count{4};
+
+  // Ring to submit transfers through, or nullptr to transfer synchronously
+  // with pwrite(2) and pread(2). The ring is not owned and must be driven only
+  // by the writer or reader while it has transfers in flight.
+  IoUring* ring{nullptr};
+};
+
+// Opens |path| with O_DIRECT plus |flags|, falling back to buffered I/O on file
+// systems that do not support direct I/O, such as tmpfs. Returns the fd or
+// ErrorStatus::IOError.
+inline Status<int> OpenDirect(const char* path, int flags,
+                              mode_t mode = 0644) {
+#ifdef O_DIRECT
+  int fd = ::open(path, flags | O_DIRECT | O_CLOEXEC, mode);
+  if (fd < 0 && errno == EINVAL)
+    fd = ::open(path, flags | O_CLOEXEC, mode);
+#else
+  const int fd = ::open(path, flags | O_CLOEXEC, mode);
+#endif
+  if (fd < 0)
+    return ErrorStatus::IOError;
+  else
+    return fd;
+}
+
+namespace detail {
+
+// Rounds |size| up to a multiple of |alignment|, which is a power of two.
+constexpr std::size_t AlignUp(std::size_t size, std::size_t alignment) {
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+struct AlignedDelete {
+  void operator()(std::uint8_t* data) const { std::free(data); }
+};
+
+// Block-aligned storage for direct transfers.
+class AlignedBuffer {
+ public:
+  AlignedBuffer(std::size_t size, std::size_t alignment) : size_{size} {
+    void* data = nullptr;
+    if (::posix_memalign(&data, alignment, size) == 0)
+      data_.reset(static_cast<std::uint8_t*>(data));
+  }
+
+  std::uint8_t* data() const { return data_.get(); }
+  std::size_t size() const { return size_; }
+  explicit operator bool() const { return static_cast<bool>(data_); }
+
+ private:
+  std::unique_ptr<std::uint8_t, AlignedDelete> data_;
+  std::size_t size_;
+};
+
+}  // namespace detail
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_DIRECT_IO_H_
@@ -0,0 +1,640 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_ENCODING_PROFILER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_ENCODING_PROFILER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/serializer.h>
+#include <nop/base/skip.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+//
+// Encoded size profiler.
+//
+// ProfileEncoding() walks an encoded value by its prefixes, without knowing
+// its C++ type, and breaks its bytes down by position within the value and by
+// encoding. The bytes of each value are split into:
+//
+//   prefix  - the encoding byte of the value.
+//   header  - count and length fields, table hashes, entry ids and sizes,
+//             variant indices, handle fields, and offset tables.
+//   padding - unused bytes at the end of sized table entries.
+//   payload - the data itself: integer, float, string, and binary bytes.
+//
+// Positions form a tree labeled the way the value nests:
+//
+//   .2       member 2 (in order of declaration) of a structure.
+//   #5       the entry with id 5 of a table.
+//   []       the elements of an array, all aggregated into one position.
+//   {key}    the keys of a map, and {value} the values.
+//   <1>      alternative 1 of a variant.
+//   !        the error of a Result.
+//
+// For example, "/.1/[]/#3" holds the total of the bytes of entry 3 in every
+// element of the vector that is the second member of the outer structure.
+//
+// Interned strings are profiled as they appear on the wire; extension and
+// reserved prefixes are rejected like SkipValue() rejects them.
+//
+
+struct ProfileBytes {
+  std::size_t prefix{0};
+  std::size_t header{0};
+  std::size_t padding{0};
+  std::size_t payload{0};
+
+  std::size_t total() const { return prefix + header + padding + payload; }
+
+  ProfileBytes& operator+=(const ProfileBytes& other) {
+    prefix += other.prefix;
+    header += other.header;
+    padding += other.padding;
+    payload += other.payload;
+    return *this;
+  }
+};
+
+namespace detail {
+template <typename Reader>
+class EncodingProfiler;
+}  // namespace detail
+
+// A position within an encoded value.
+struct ProfileNode {
+  // Number of values encountered at this position.
+  std::size_t count{0};
+
+  // Bytes of the values at this position, excluding nested values.
+  ProfileBytes self;
+
+  // Bytes of the values at this position, including nested values.
+  ProfileBytes total;
+
+  std::map<std::string, ProfileNode> children;
+};
+
+class EncodingProfile {
+ public:
+  // Returns the root position, whose total is the size of the value.
+  const ProfileNode& root() const { return root_; }
+
+  // Returns the bytes of the values of each kind of encoding, excluding nested
+  // values, keyed by the name of the encoding byte.
+  const std::map<std::string, ProfileBytes>& by_encoding() const {
+    return by_encoding_;
+  }
+
+  // Returns the node at |path|, such as "/.1/[]", or nullptr if no value was
+  // found at that position.
+  const ProfileNode* Find(const std::string& path) const {
+    const ProfileNode* node = &root_;
+    std::size_t begin = 0;
+    while (begin < path.size()) {
+      if (path[begin] == '/') {
+        begin++;
+        continue;
+      }
+
+      const std::size_t end = std::min(path.find('/', begin), path.size());
+      auto search = node->children.find(path.substr(begin, end - begin));
+      if (search == node->children.end())
+        return nullptr;
+      node = &search->second;
+      begin = end;
+    }
+    return node;
+  }
+
+  // Formats the profile as a table of positions, largest first within each
+  // level, followed by the breakdown by encoding. Positions deeper than
+  // |max_depth| are folded into their parents.
+  std::string Report(std::size_t max_depth = kMaxSkipDepth) const {
+    std::string report;
+    AppendLine(&report, "path", "count", "total", "prefix", "header",
+               "padding", "payload");
+    AppendNode(&report, "/", root_, max_depth);
+
+    report += "\n";
+    std::vector<std::pair<std::string, ProfileBytes>> encodings{
+        by_encoding_.begin(), by_encoding_.end()};
+    std::sort(encodings.begin(), encodings.end(),
+              [](const std::pair<std::string, ProfileBytes>& a,
+                 const std::pair<std::string, ProfileBytes>& b) {
+                return a.second.total() > b.second.total();
+              });
+    AppendLine(&report, "encoding", "", "total", "prefix", "header", "padding",
+               "payload");
+    for (const auto& encoding : encodings)
+      AppendBytes(&report, encoding.first, "", encoding.second);
+    return report;
+  }
+
+ private:
+  template <typename Reader>
+  friend Status<EncodingProfile> ProfileEncoding(Reader* reader);
+  template <typename Reader>
+  friend class detail::EncodingProfiler;
+
+  static void AppendLine(std::string* report, const std::string& path,
+                         const std::string& count, const std::string& total,
+                         const std::string& prefix, const std::string& header,
+                         const std::string& padding,
+                         const std::string& payload) {
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-40s %10s %12s %10s %10s %10s %12s\n",
+                  path.c_str(), count.c_str(), total.c_str(), prefix.c_str(),
+                  header.c_str(), padding.c_str(), payload.c_str());
+    *report += line;
+  }
+
+  static void AppendBytes(std::string* report, const std::string& path,
+                          const std::string& count,
+                          const ProfileBytes& bytes) {
+    AppendLine(report, path, count, std::to_string(bytes.total()),
+               std::to_string(bytes.prefix), std::to_string(bytes.header),
+               std::to_string(bytes.padding), std::to_string(bytes.payload));
+  }
+
+  static void AppendNode(std::string* report, const std::string& path,
+                         const ProfileNode& node, std::size_t depth) {
+    AppendBytes(report, path, std::to_string(node.count), node.total);
+    if (depth == 0)
+      return;
+
+    std::vector<const std::pair<const std::string, ProfileNode>*> children;
+    for (const auto& child : node.children)
+      children.push_back(&child);
+    std::stable_sort(
+        children.begin(), children.end(),
+        [](const std::pair<const std::string, ProfileNode>* a,
+           const std::pair<const std::string, ProfileNode>* b) {
+          return a->second.total.total() > b->second.total.total();
+        });
+
+    const std::string prefix = path == "/" ? path : path + "/";
+    for (const auto* child : children)
+      AppendNode(report, prefix + child->first, child->second, depth - 1);
+  }
+
+  static void Finish(ProfileNode* node) {
+    node->total = node->self;
+    for (auto& child : node->children) {
+      Finish(&child.second);
+      node->total += child.second.total;
+    }
+  }
+
+  ProfileNode root_;
+  std::map<std::string, ProfileBytes> by_encoding_;
+};
+
+namespace detail {
+
+inline const char* EncodingByteName(EncodingByte prefix) {
+  if (prefix >= EncodingByte::PositiveFixIntMin &&
+      prefix <= EncodingByte::PositiveFixIntMax)
+    return "FixInt";
+  if (prefix >= EncodingByte::NegativeFixIntMin &&
+      prefix <= EncodingByte::NegativeFixIntMax)
+    return "FixInt";
+
+  switch (prefix) {
+    case EncodingByte::U8:
+      return "U8";
+    case EncodingByte::U16:
+      return "U16";
+    case EncodingByte::U32:
+      return "U32";
+    case EncodingByte::U64:
+      return "U64";
+    case EncodingByte::I8:
+      return "I8";
+    case EncodingByte::I16:
+      return "I16";
+    case EncodingByte::I32:
+      return "I32";
+    case EncodingByte::I64:
+      return "I64";
+    case EncodingByte::F32:
+      return "F32";
+    case EncodingByte::F64:
+      return "F64";
+    case EncodingByte::StringReference:
+      return "StringReference";
+    case EncodingByte::StringDefinition:
+      return "StringDefinition";
+    case EncodingByte::ObjectReference:
+      return "ObjectReference";
+    case EncodingByte::ObjectDefinition:
+      return "ObjectDefinition";
+    case EncodingByte::PackedArray:
+      return "PackedArray";
+    case EncodingByte::BitArray:
+      return "BitArray";
+    case EncodingByte::ChunkManifest:
+      return "ChunkManifest";
+    case EncodingByte::IndexedArray:
+      return "IndexedArray";
+    case EncodingByte::ChunkedArray:
+      return "ChunkedArray";
+    case EncodingByte::Table:
+      return "Table";
+    case EncodingByte::Error:
+      return "Error";
+    case EncodingByte::Handle:
+      return "Handle";
+    case EncodingByte::Variant:
+      return "Variant";
+    case EncodingByte::Structure:
+      return "Structure";
+    case EncodingByte::Array:
+      return "Array";
+    case EncodingByte::Map:
+      return "Map";
+    case EncodingByte::Binary:
+      return "Binary";
+    case EncodingByte::String:
+      return "String";
+    case EncodingByte::Nil:
+      return "Nil";
+    case EncodingByte::Extension:
+      return "Extension";
+    default:
+      return "Reserved";
+  }
+}
+
+template <typename Reader>
+class EncodingProfiler {
+ public:
+  EncodingProfiler(Reader* reader, EncodingProfile* profile)
+      : reader_{reader}, profile_{profile} {}
+
+  Status<void> Walk(ProfileNode* node, std::size_t depth) {
+    if (depth >= kMaxSkipDepth)
+      return ErrorStatus::UnexpectedEncodingType;
+    depth++;
+
+    std::uint8_t prefix_byte = 0;
+    auto status = reader_->Read(&prefix_byte);
+    if (!status)
+      return status;
+
+    const EncodingByte prefix = static_cast<EncodingByte>(prefix_byte);
+    ProfileBytes& bytes = profile_->by_encoding_[EncodingByteName(prefix)];
+    Attribution self{node, &bytes};
+    node->count++;
+    self.Add(&ProfileBytes::prefix, 1);
+
+    SizeType count = 0;
+    switch (prefix) {
+      case EncodingByte::U8:
+      case EncodingByte::U16:
+      case EncodingByte::U32:
+      case EncodingByte::U64:
+      case EncodingByte::I8:
+      case EncodingByte::I16:
+      case EncodingByte::I32:
+      case EncodingByte::I64:
+      case EncodingByte::F32:
+      case EncodingByte::F64:
+        return SkipBytes(self, &ProfileBytes::payload,
+                         BaseEncodingSize(prefix) - 1);
+
+      case EncodingByte::Nil:
+        return {};
+
+      case EncodingByte::Binary:
+      case EncodingByte::String:
+      case EncodingByte::StringDefinition:
+        status = ReadSize(self, &count);
+        if (!status)
+          return status;
+        return SkipBytes(self, &ProfileBytes::payload, count);
+
+      case EncodingByte::StringReference:
+      case EncodingByte::ObjectReference:
+        return SkipHeaderValue(self, depth);
+
+      case EncodingByte::ObjectDefinition:
+        return Walk(Child(node, "&"), depth);
+
+      case EncodingByte::Error:
+        return Walk(Child(node, "!"), depth);
+
+      case EncodingByte::Handle:
+        status = SkipHeaderValue(self, depth);
+        if (!status)
+          return status;
+        return SkipHeaderValue(self, depth);
+
+      case EncodingByte::Variant: {
+        std::int32_t index = 0;
+        const std::size_t start = position();
+        status = Encoding<std::int32_t>::Read(&index, reader_);
+        if (!status)
+          return status;
+        self.Add(&ProfileBytes::header, position() - start);
+        return Walk(Child(node, "<" + std::to_string(index) + ">"), depth);
+      }
+
+      case EncodingByte::Structure:
+        status = ReadSize(self, &count);
+        if (!status)
+          return status;
+        for (SizeType i = 0; i < count; i++) {
+          status = Walk(Child(node, "." + std::to_string(i)), depth);
+          if (!status)
+            return status;
+        }
+        return {};
+
+      case EncodingByte::Array:
+        status = ReadSize(self, &count);
+        if (!status)
+          return status;
+        return WalkElements(node, count, depth);
+
+      case EncodingByte::Map:
+        status = ReadSize(self, &count);
+        if (!status)
+          return status;
+        for (SizeType i = 0; i < count; i++) {
+          status = Walk(Child(node, "{key}"), depth);
+          if (!status)
+            return status;
+          status = Walk(Child(node, "{value}"), depth);
+          if (!status)
+            return status;
+        }
+        return {};
+
+      case EncodingByte::IndexedArray: {
+        status = ReadSize(self, &count);
+        if (!status)
+          return status;
+
+        // The offset table is a binary container.
+        const std::size_t start = position();
+        status = SkipValue(reader_, depth);
+        if (!status)
+          return status;
+        self.Add(&ProfileBytes::header, position() - start);
+
+        return WalkElements(node, count, depth);
+      }
+
+      case EncodingByte::PackedArray: {
+        status = ReadSize(self, &count);
+        if (!status)
+          return status;
+        status = Walk(Child(node, "[]"), depth);
+        if (!status)
+          return status;
+
+        // The packed deltas are the payload of the array itself.
+        std::uint8_t binary_prefix = 0;
+        status = reader_->Read(&binary_prefix);
+        if (!status)
+          return status;
+        if (static_cast<EncodingByte>(binary_prefix) != EncodingByte::Binary)
+          return ErrorStatus::UnexpectedEncodingType;
+        self.Add(&ProfileBytes::header, 1);
+
+        SizeType size = 0;
+        status = ReadSize(self, &size);
+        if (!status)
+          return status;
+        return SkipBytes(self, &ProfileBytes::payload, size);
+      }
+
+      case EncodingByte::BitArray:
+        status = ReadSize(self, &count);
+        if (!status)
+          return status;
+        return SkipBytes(self, &ProfileBytes::payload,
+                         count / 8 + (count % 8 != 0));
+
+      case EncodingByte::ChunkManifest:
+        // The data length and entry count, then the chunk id words and chunk
+        // of each entry.
+        status = ReadSize(self, &count);
+        if (!status)
+          return status;
+        status = ReadSize(self, &count);
+        if (!status)
+          return status;
+        for (SizeType i = 0; i < count; i++) {
+          status = SkipHeaderValue(self, depth);
+          if (!status)
+            return status;
+          status = SkipHeaderValue(self, depth);
+          if (!status)
+            return status;
+          status = Walk(Child(node, "[]"), depth);
+          if (!status)
+            return status;
+        }
+        return {};
+
+      case EncodingByte::ChunkedArray:
+        while (true) {
+          status = ReadSize(self, &count);
+          if (!status)
+            return status;
+          else if (count == 0)
+            return {};
+
+          status = WalkElements(node, count, depth);
+          if (!status)
+            return status;
+        }
+
+      case EncodingByte::Table:
+        return WalkTable(self, depth);
+
+      default:
+        if ((prefix >= EncodingByte::PositiveFixIntMin &&
+             prefix <= EncodingByte::PositiveFixIntMax) ||
+            (prefix >= EncodingByte::NegativeFixIntMin &&
+             prefix <= EncodingByte::NegativeFixIntMax)) {
+          return {};
+        }
+        return ErrorStatus::UnexpectedEncodingType;
+    }
+  }
+
+ private:
+  // Adds bytes both to a node and to the breakdown by encoding.
+  struct Attribution {
+    ProfileNode* node;
+    ProfileBytes* encoding;
+
+    void Add(std::size_t ProfileBytes::*field, std::size_t size) {
+      node->self.*field += size;
+      encoding->*field += size;
+    }
+  };
+
+  std::size_t position() const {
+    return reader_->capacity() - reader_->remaining();
+  }
+
+  static ProfileNode* Child(ProfileNode* node, const std::string& label) {
+    return &node->children[label];
+  }
+
+  Status<void> ReadSize(Attribution self, SizeType* size) {
+    const std::size_t start = position();
+    auto status = Encoding<SizeType>::Read(size, reader_);
+    if (!status)
+      return status;
+    self.Add(&ProfileBytes::header, position() - start);
+    return {};
+  }
+
+  Status<void> SkipBytes(Attribution self, std::size_t ProfileBytes::*field,
+                         std::size_t size) {
+    auto status = reader_->Ensure(size);
+    if (!status)
+      return status;
+    status = reader_->Skip(size);
+    if (!status)
+      return status;
+    self.Add(field, size);
+    return {};
+  }
+
+  Status<void> SkipHeaderValue(Attribution self, std::size_t depth) {
+    const std::size_t start = position();
+    auto status = SkipValue(reader_, depth);
+    if (!status)
+      return status;
+    self.Add(&ProfileBytes::header, position() - start);
+    return {};
+  }
+
+  Status<void> WalkElements(ProfileNode* node, SizeType count,
+                            std::size_t depth) {
+    ProfileNode* elements = Child(node, "[]");
+    for (SizeType i = 0; i < count; i++) {
+      auto status = Walk(elements, depth);
+      if (!status)
+        return status;
+    }
+    return {};
+  }
+
+  Status<void> WalkTable(Attribution self, std::size_t depth) {
+    auto status = SkipHeaderValue(self, depth);
+    if (!status)
+      return status;
+
+    SizeType count = 0;
+    status = ReadSize(self, &count);
+    if (!status)
+      return status;
+
+    for (SizeType i = 0; i < count; i++) {
+      std::uint64_t id = 0;
+      const std::size_t start = position();
+      status = Encoding<std::uint64_t>::Read(&id, reader_);
+      if (!status)
+        return status;
+      self.Add(&ProfileBytes::header, position() - start);
+
+      SizeType size = 0;
+      status = ReadSize(self, &size);
+      if (!status)
+        return status;
+      else if (size == 0)
+        continue;
+
+      status = reader_->Ensure(size);
+      if (!status)
+        return status;
+
+      const std::size_t entry_start = position();
+      status = Walk(Child(self.node, "#" + std::to_string(id)), depth);
+      if (!status)
+        return status;
+
+      const std::size_t used = position() - entry_start;
+      if (used > size)
+        return ErrorStatus::InvalidContainerLength;
+      status = SkipBytes(self, &ProfileBytes::padding, size - used);
+      if (!status)
+        return status;
+    }
+    return {};
+  }
+
+  Reader* reader_;
+  EncodingProfile* profile_;
+};
+
+}  // namespace detail
+
+// Profiles one encoded value from |reader|, which must provide remaining() and
+// capacity() like PedanticBufferReader.
+template <typename Reader>
+Status<EncodingProfile> ProfileEncoding(Reader* reader) {
+  EncodingProfile profile;
+  detail::EncodingProfiler<Reader> profiler{reader, &profile};
+  auto status = profiler.Walk(&profile.root_, 0);
+  if (!status)
+    return status.error();
+
+  EncodingProfile::Finish(&profile.root_);
+  return {std::move(profile)};
+}
+
+// Profiles the encoded value in the given buffer.
+inline Status<EncodingProfile> ProfileEncoding(const void* data,
+                                               std::size_t size) {
+  PedanticBufferReader reader{data, size};
+  return ProfileEncoding(&reader);
+}
+
+// Serializes |value| and profiles its encoding.
+template <typename T>
+Status<EncodingProfile> ProfileValue(const T& value) {
+  Serializer<VectorWriter> serializer;
+  auto status = serializer.Write(value);
+  if (!status)
+    return status.error();
+
+  const std::vector<std::uint8_t>& data = serializer.writer().data();
+  return ProfileEncoding(data.data(), data.size());
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_ENCODING_PROFILER_H_
@@ -0,0 +1,530 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_ENCODING_TOKENIZER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_ENCODING_TOKENIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include <nop/base/encoding.h>
+#include <nop/base/skip.h>
+#include <nop/status.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+
+namespace nop {
+
+//
+// Schema-less pull tokenizer.
+//
+// EncodingTokenizer walks encoded values in a buffer by their prefixes, without
+// knowing their C++ types, and returns one token per call to Next(). Scalars
+// are returned as single tokens; containers and wrappers are returned as a
+// begin token, the tokens of their elements, and an end token. The tokenizer
+// does not allocate: container state is kept on a fixed stack of kMaxSkipDepth
+// levels, and string and binary tokens point into the buffer, which must
+// outlive them.
+//
+// Tokens are returned for each kind of encoding as follows:
+//
+//   Nil, Integer, UnsignedInteger, Float
+//       Scalars. Fixints and I8-I64 are Integer, U8-U64 are UnsignedInteger.
+//   String, Binary
+//       |data| and |size| hold the bytes. String definitions are String.
+//   StringReference, ObjectReference
+//       |id| holds the id of the referenced definition.
+//   ObjectDefinition
+//       Followed by the tokens of the defined object.
+//   BeginArray ... EndArray
+//       Arrays, indexed arrays, and chunked arrays. |count| holds the number of
+//       elements, or kUnknownCount for chunked arrays.
+//   BeginStructure ... EndStructure
+//       |count| holds the number of members.
+//   BeginMap ... EndMap
+//       |count| holds the number of entries, each a key followed by a value.
+//   BeginTable ... EndTable
+//       |id| holds the table hash and |count| the number of entries. Each entry
+//       is a TableEntry token, with the entry id in |id| and the entry bytes in
+//       |data| and |size|, followed by the tokens of its value unless |size| is
+//       zero.
+//   BeginVariant ... EndVariant
+//       The alternative index followed by the value.
+//   BeginHandle ... EndHandle
+//       The handle type followed by the handle reference.
+//   BeginError ... EndError
+//       The error code.
+//   PackedArray
+//       |count| holds the number of elements and |data| and |size| the encoded
+//       first element and packed deltas that follow the count.
+//   BitArray
+//       |count| holds the number of bits and |data| and |size| the packed bits.
+//   ChunkManifest
+//       |count| holds the length of the data and |data| and |size| the entry
+//       count and entries that follow it.
+//   End
+//       The end of the buffer, between top-level values.
+//
+// Extension and reserved prefixes are rejected with
+// ErrorStatus::UnexpectedEncodingType, as are values nested more deeply than
+// kMaxSkipDepth. The tokenizer must not be used after Next() returns an error.
+//
+// Example:
+//
+//  EncodingTokenizer tokenizer{data, size};
+//  Token token;
+//  while (tokenizer.Next(&token) && token.type != TokenType::End)
+//    Index(token);
+//
+
+enum class TokenType {
+  End,
+  Nil,
+  Integer,
+  UnsignedInteger,
+  Float,
+  String,
+  Binary,
+  StringReference,
+  ObjectDefinition,
+  ObjectReference,
+  BeginArray,
+  EndArray,
+  BeginStructure,
+  EndStructure,
+  BeginMap,
+  EndMap,
+  BeginTable,
+  TableEntry,
+  EndTable,
+  BeginVariant,
+  EndVariant,
+  BeginHandle,
+  EndHandle,
+  BeginError,
+  EndError,
+  PackedArray,
+  BitArray,
+  ChunkManifest,
+};
+
+struct Token {
+  enum : SizeType { kUnknownCount = std::numeric_limits<SizeType>::max() };
+
+  TokenType type{TokenType::End};
+
+  // Prefix of the value, for tokens that begin a value.
+  EncodingByte prefix{EncodingByte::Nil};
+
+  // Offset of the token from the start of the buffer and the number of
+  // containers enclosing it.
+  std::size_t offset{0};
+  std::size_t depth{0};
+
+  std::int64_t integer{0};
+  std::uint64_t unsigned_integer{0};
+  double real{0.0};
+
+  // Reference and entry ids and table hashes.
+  std::uint64_t id{0};
+
+  // Number of container elements.
+  SizeType count{0};
+
+  const std::uint8_t* data{nullptr};
+  std::size_t size{0};
+};
+
+class EncodingTokenizer {
+ public:
+  EncodingTokenizer(const void* data, std::size_t size)
+      : data_{static_cast<const std::uint8_t*>(data)}, reader_{data, size} {}
+
+  Status<void> Next(Token* token) {
+    *token = Token{};
+    token->offset = position();
+    token->depth = depth_;
+
+    // The value of an object definition belongs to the same container slot.
+    if (pending_object_) {
+      pending_object_ = false;
+      return ReadValue(token);
+    }
+
+    if (depth_ == 0) {
+      if (reader_.empty())
+        return {};
+      return ReadValue(token);
+    }
+
+    Frame& frame = stack_[depth_ - 1];
+    if (frame.end == TokenType::EndTable)
+      return NextTableEntry(&frame, token);
+
+    if (frame.chunked && frame.remaining == 0) {
+      SizeType count = 0;
+      auto status = Encoding<SizeType>::Read(&count, &reader_);
+      if (!status)
+        return status;
+      frame.remaining = count;
+    }
+
+    if (frame.remaining == 0)
+      return Pop(token);
+
+    frame.remaining--;
+    return ReadValue(token);
+  }
+
+  // Returns the number of containers enclosing the next token.
+  std::size_t depth() const { return depth_; }
+
+  // Returns the offset of the next token from the start of the buffer.
+  std::size_t position() const {
+    return reader_.capacity() - reader_.remaining();
+  }
+
+  std::size_t remaining() const { return reader_.remaining(); }
+
+ private:
+  enum class EntryState : std::uint8_t { Header, Value, Done };
+
+  struct Frame {
+    TokenType end;
+    SizeType remaining;
+    bool chunked;
+    EntryState entry_state;
+    std::size_t entry_end;
+  };
+
+  Status<void> Push(Token* token, TokenType begin, TokenType end,
+                    SizeType remaining, bool chunked = false) {
+    if (depth_ == kMaxSkipDepth)
+      return ErrorStatus::UnexpectedEncodingType;
+
+    stack_[depth_++] = {end, remaining, chunked, EntryState::Header, 0};
+    token->type = begin;
+    return {};
+  }
+
+  Status<void> Pop(Token* token) {
+    depth_--;
+    token->type = stack_[depth_].end;
+    token->depth = depth_;
+    return {};
+  }
+
+  Status<void> NextTableEntry(Frame* frame, Token* token) {
+    if (frame->entry_state == EntryState::Value) {
+      frame->entry_state = EntryState::Done;
+      return ReadValue(token);
+    } else if (frame->entry_state == EntryState::Done) {
+      // Skip any padding after the value of the previous entry.
+      const std::size_t used = position();
+      if (used > frame->entry_end)
+        return ErrorStatus::InvalidContainerLength;
+      auto status = reader_.Skip(frame->entry_end - used);
+      if (!status)
+        return status;
+      frame->entry_state = EntryState::Header;
+      token->offset = position();
+    }
+
+    if (frame->remaining == 0)
+      return Pop(token);
+    frame->remaining--;
+
+    auto status = Encoding<std::uint64_t>::Read(&token->id, &reader_);
+    if (!status)
+      return status;
+
+    SizeType size = 0;
+    status = Encoding<SizeType>::Read(&size, &reader_);
+    if (!status)
+      return status;
+
+    status = reader_.Ensure(size);
+    if (!status)
+      return status;
+
+    // The value of the entry is returned by the following calls.
+    token->data = data_ + position();
+    token->size = size;
+    if (size != 0) {
+      frame->entry_state = EntryState::Value;
+      frame->entry_end = position() + size;
+    }
+
+    token->type = TokenType::TableEntry;
+    return {};
+  }
+
+  Status<void> Borrow(Token* token, std::size_t size) {
+    const void* data = nullptr;
+    auto status = reader_.Borrow(&data, size);
+    if (!status)
+      return status;
+
+    token->data = static_cast<const std::uint8_t*>(data);
+    token->size = size;
+    return {};
+  }
+
+  template <typename T>
+  Status<void> ReadScalar(T* value) {
+    return reader_.Read(value, value + 1);
+  }
+
+  template <typename T>
+  Status<void> ReadInteger(Token* token) {
+    T value = 0;
+    auto status = ReadScalar(&value);
+    if (!status)
+      return status;
+
+    if (std::is_signed<T>::value) {
+      token->type = TokenType::Integer;
+      token->integer = value;
+    } else {
+      token->type = TokenType::UnsignedInteger;
+      token->unsigned_integer = value;
+    }
+    return {};
+  }
+
+  template <typename T>
+  Status<void> ReadFloat(Token* token) {
+    T value = 0;
+    auto status = ReadScalar(&value);
+    if (!status)
+      return status;
+
+    token->type = TokenType::Float;
+    token->real = value;
+    return {};
+  }
+
+  Status<void> ReadValue(Token* token) {
+    std::uint8_t prefix_byte = 0;
+    auto status = reader_.Read(&prefix_byte);
+    if (!status)
+      return status;
+
+    const EncodingByte prefix = static_cast<EncodingByte>(prefix_byte);
+    token->prefix = prefix;
+
+    SizeType count = 0;
+    switch (prefix) {
+      case EncodingByte::U8:
+        return ReadInteger<std::uint8_t>(token);
+      case EncodingByte::U16:
+        return ReadInteger<std::uint16_t>(token);
+      case EncodingByte::U32:
+        return ReadInteger<std::uint32_t>(token);
+      case EncodingByte::U64:
+        return ReadInteger<std::uint64_t>(token);
+      case EncodingByte::I8:
+        return ReadInteger<std::int8_t>(token);
+      case EncodingByte::I16:
+        return ReadInteger<std::int16_t>(token);
+      case EncodingByte::I32:
+        return ReadInteger<std::int32_t>(token);
+      case EncodingByte::I64:
+        return ReadInteger<std::int64_t>(token);
+      case EncodingByte::F32:
+        return ReadFloat<float>(token);
+      case EncodingByte::F64:
+        return ReadFloat<double>(token);
+
+      case EncodingByte::Nil:
+        token->type = TokenType::Nil;
+        return {};
+
+      case EncodingByte::Binary:
+      case EncodingByte::String:
+      case EncodingByte::StringDefinition:
+        status = Encoding<SizeType>::Read(&count, &reader_);
+        if (!status)
+          return status;
+        token->type = prefix == EncodingByte::Binary ? TokenType::Binary
+                                                     : TokenType::String;
+        return Borrow(token, count);
+
+      case EncodingByte::StringReference:
+      case EncodingByte::ObjectReference:
+        token->type = prefix == EncodingByte::StringReference
+                          ? TokenType::StringReference
+                          : TokenType::ObjectReference;
+        return Encoding<SizeType>::Read(&token->id, &reader_);
+
+      case EncodingByte::ObjectDefinition:
+        token->type = TokenType::ObjectDefinition;
+        pending_object_ = true;
+        return {};
+
+      case EncodingByte::Error:
+        return Push(token, TokenType::BeginError, TokenType::EndError, 1);
+
+      case EncodingByte::Variant:
+        return Push(token, TokenType::BeginVariant, TokenType::EndVariant, 2);
+
+      case EncodingByte::Handle:
+        return Push(token, TokenType::BeginHandle, TokenType::EndHandle, 2);
+
+      case EncodingByte::Array:
+      case EncodingByte::Structure:
+        status = Encoding<SizeType>::Read(&token->count, &reader_);
+        if (!status)
+          return status;
+        if (prefix == EncodingByte::Array) {
+          return Push(token, TokenType::BeginArray, TokenType::EndArray,
+                      token->count);
+        } else {
+          return Push(token, TokenType::BeginStructure,
+                      TokenType::EndStructure, token->count);
+        }
+
+      case EncodingByte::Map:
+        status = Encoding<SizeType>::Read(&token->count, &reader_);
+        if (!status)
+          return status;
+        else if (token->count > Token::kUnknownCount / 2)
+          return ErrorStatus::InvalidContainerLength;
+        return Push(token, TokenType::BeginMap, TokenType::EndMap,
+                    token->count * 2);
+
+      case EncodingByte::IndexedArray:
+        status = Encoding<SizeType>::Read(&token->count, &reader_);
+        if (!status)
+          return status;
+
+        // The offset table is a binary container.
+        status = SkipValue(&reader_);
+        if (!status)
+          return status;
+        return Push(token, TokenType::BeginArray, TokenType::EndArray,
+                    token->count);
+
+      case EncodingByte::ChunkedArray:
+        token->count = Token::kUnknownCount;
+        return Push(token, TokenType::BeginArray, TokenType::EndArray, 0,
+                    true);
+
+      case EncodingByte::Table:
+        status = Encoding<std::uint64_t>::Read(&token->id, &reader_);
+        if (!status)
+          return status;
+        status = Encoding<SizeType>::Read(&token->count, &reader_);
+        if (!status)
+          return status;
+        return Push(token, TokenType::BeginTable, TokenType::EndTable,
+                    token->count);
+
+      case EncodingByte::PackedArray: {
+        status = Encoding<SizeType>::Read(&token->count, &reader_);
+        if (!status)
+          return status;
+
+        // The first element is followed by the packed deltas in a binary
+        // container.
+        const std::size_t start = position();
+        status = SkipValue(&reader_);
+        if (!status)
+          return status;
+        status = SkipValue(&reader_);
+        if (!status)
+          return status;
+
+        token->type = TokenType::PackedArray;
+        token->data = data_ + start;
+        token->size = position() - start;
+        return {};
+      }
+
+      case EncodingByte::BitArray: {
+        status = Encoding<SizeType>::Read(&token->count, &reader_);
+        if (!status)
+          return status;
+
+        const SizeType size = token->count / 8 + (token->count % 8 != 0);
+        const std::size_t start = position();
+        status = reader_.Ensure(size);
+        if (!status)
+          return status;
+        status = reader_.Skip(size);
+        if (!status)
+          return status;
+
+        token->type = TokenType::BitArray;
+        token->data = data_ + start;
+        token->size = size;
+        return {};
+      }
+
+      case EncodingByte::ChunkManifest: {
+        status = Encoding<SizeType>::Read(&token->count, &reader_);
+        if (!status)
+          return status;
+
+        // Skip the entries, each an id of two words and the chunk or nil.
+        const std::size_t start = position();
+        SizeType entries = 0;
+        status = Encoding<SizeType>::Read(&entries, &reader_);
+        if (!status)
+          return status;
+        else if (entries > Token::kUnknownCount / 3)
+          return ErrorStatus::InvalidContainerLength;
+
+        for (SizeType i = 0; i < entries * 3; i++) {
+          status = SkipValue(&reader_);
+          if (!status)
+            return status;
+        }
+
+        token->type = TokenType::ChunkManifest;
+        token->data = data_ + start;
+        token->size = position() - start;
+        return {};
+      }
+
+      default:
+        if (prefix >= EncodingByte::PositiveFixIntMin &&
+            prefix <= EncodingByte::PositiveFixIntMax) {
+          token->type = TokenType::Integer;
+          token->integer = prefix_byte;
+          return {};
+        } else if (prefix >= EncodingByte::NegativeFixIntMin &&
+                   prefix <= EncodingByte::NegativeFixIntMax) {
+          token->type = TokenType::Integer;
+          token->integer = static_cast<std::int8_t>(prefix_byte);
+          return {};
+        }
+        return ErrorStatus::UnexpectedEncodingType;
+    }
+  }
+
+  const std::uint8_t* data_;
+  PedanticBufferReader reader_;
+  Frame stack_[kMaxSkipDepth];
+  std::size_t depth_{0};
+  bool pending_object_{false};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_ENCODING_TOKENIZER_H_
@@ -17,7 +17,9 @@
 #ifndef LIBNOP_INCLUDE_NOP_UTILITY_ENDIAN_H_
 #define LIBNOP_INCLUDE_NOP_UTILITY_ENDIAN_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
 #include <utility>
 
@@ -172,6 +174,69 @@ struct HostEndian<T, std::enable_if_t<std::is_floating_point<T>::value>> {
   using Integral = decltype(IntegralType(std::declval<T>()));
 };
 
+// Byte orders for converting ranges of values.
+enum class ByteOrder { Little, Big };
+
+// Returns the byte order of the host. Compilers fold this check to a constant.
+inline ByteOrder HostByteOrder() {
+  const std::uint16_t value = 1;
+  std::uint8_t first_byte = 0;
+  std::memcpy(&first_byte, &value, sizeof(first_byte));
+  return first_byte ? ByteOrder::Little : ByteOrder::Big;
+}
+
+namespace detail {
+
+// Unsigned integral type with the same size as T, used to reverse the bytes of
+// floating point values.
+template <std::size_t Size>
+struct ByteOrderWord;
+template <>
+struct ByteOrderWord<1> {
+  using Type = std::uint8_t;
+};
+template <>
+struct ByteOrderWord<2> {
+  using Type = std::uint16_t;
+};
+template <>
+struct ByteOrderWord<4> {
+  using Type = std::uint32_t;
+};
+template <>
+struct ByteOrderWord<8> {
+  using Type = std::uint64_t;
+};
+
+}  // namespace detail
+
+// Converts the arithmetic values in [begin, end) between host byte order and
+// |order|, storing the results at |out|, which may equal |begin|. The
+// conversion is symmetric, so the same call converts in either direction. When
+// the orders match the values are copied as they are; otherwise each value is
+// byte reversed with the shift-or idiom above in a simple loop that compilers
+// vectorize into byte shuffles on targets that have them.
+template <typename T>
+void ConvertByteOrder(ByteOrder order, const T* begin, const T* end, T* out) {
+  static_assert(std::is_arithmetic<T>::value,
+                "Only arithmetic types may be converted.");
+  const std::size_t count = end - begin;
+  if (sizeof(T) == 1 || order == HostByteOrder()) {
+    if (out != begin)
+      std::memmove(out, begin, count * sizeof(T));
+    return;
+  }
+
+  using Word = typename detail::ByteOrderWord<sizeof(T)>::Type;
+  for (std::size_t i = 0; i < count; i++) {
+    Word word;
+    std::memcpy(&word, &begin[i], sizeof(word));
+    word = order == ByteOrder::Little ? HostEndian<Word>::ToLittle(word)
+                                      : HostEndian<Word>::ToBig(word);
+    std::memcpy(&out[i], &word, sizeof(word));
+  }
+}
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_UTILITY_ENDIAN_H_
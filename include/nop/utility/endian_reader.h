@@ -0,0 +1,94 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_ENDIAN_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_ENDIAN_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/utility.h>
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+// EndianReader is a reader type that wraps another reader pointer and loads
+// multi-byte arithmetic values stored in the given byte order, little-endian by
+// default to match the wire format. Ranges of values are read into place and
+// converted in bulk with ConvertByteOrder(). On hosts that already match the
+// byte order every operation is passed through unchanged.
+//
+// Borrowing is not forwarded, since borrowed bytes would bypass the conversion.
+//
+// Example:
+//
+//  BufferReader buffer_reader{data, size};
+//  Deserializer<EndianReader<BufferReader>> deserializer{&buffer_reader};
+//  auto status = deserializer.Read(&samples);
+//
+template <typename Reader, ByteOrder Order = ByteOrder::Little>
+class EndianReader {
+ public:
+  constexpr EndianReader() = default;
+  constexpr EndianReader(const EndianReader&) = default;
+  constexpr EndianReader(Reader* reader) : reader_{reader} {}
+
+  constexpr EndianReader& operator=(const EndianReader&) = default;
+
+  Status<void> Ensure(std::size_t size) { return reader_->Ensure(size); }
+
+  Status<void> Read(std::uint8_t* byte) { return reader_->Read(byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    auto status = reader_->Read(begin, end);
+    if (!status)
+      return status;
+
+    ConvertByteOrder(Order, begin, end, begin);
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    return reader_->Skip(padding_bytes);
+  }
+
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference handle_reference) {
+    return reader_->template GetHandle<HandleType>(handle_reference);
+  }
+
+  // Forwards the remaining input of the underlying reader, when it reports it.
+  template <typename R = Reader>
+  constexpr auto remaining() const
+      -> decltype(std::declval<const R&>().remaining()) {
+    return reader_->remaining();
+  }
+
+  Reader& reader() { return *reader_; }
+  const Reader& reader() const { return *reader_; }
+
+ private:
+  Reader* reader_{nullptr};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_ENDIAN_READER_H_
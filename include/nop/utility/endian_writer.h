@@ -0,0 +1,112 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_ENDIAN_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_ENDIAN_WRITER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/utility.h>
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+// EndianWriter is a writer type that wraps another writer pointer and stores
+// multi-byte arithmetic values in the given byte order, little-endian by
+// default to match the wire format. Ranges of values, such as the elements of
+// integral vectors and arrays and the contents of logical buffers, are
+// converted in blocks of kBlockSize bytes with ConvertByteOrder() before being
+// passed to the underlying writer. On hosts that already match the byte order
+// every operation is passed through unchanged.
+//
+// Borrowing is not forwarded, since values written directly into borrowed
+// memory would bypass the conversion.
+//
+// Example:
+//
+//  VectorWriter vector_writer;
+//  Serializer<EndianWriter<VectorWriter>> serializer{&vector_writer};
+//  auto status = serializer.Write(samples);
+//
+template <typename Writer, ByteOrder Order = ByteOrder::Little>
+class EndianWriter {
+ public:
+  enum : std::size_t { kBlockSize = 256 };
+
+  constexpr EndianWriter() = default;
+  constexpr EndianWriter(const EndianWriter&) = default;
+  constexpr EndianWriter(Writer* writer) : writer_{writer} {}
+
+  constexpr EndianWriter& operator=(const EndianWriter&) = default;
+
+  Status<void> Prepare(std::size_t size) { return writer_->Prepare(size); }
+
+  Status<void> Write(std::uint8_t byte) { return writer_->Write(byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    if (sizeof(T) == 1 || Order == HostByteOrder())
+      return writer_->Write(begin, end);
+
+    enum : std::size_t { kBlockLength = kBlockSize / sizeof(T) };
+    T block[kBlockLength];
+    while (begin != end) {
+      const std::size_t length =
+          std::min<std::size_t>(end - begin, kBlockLength);
+      ConvertByteOrder(Order, begin, begin + length, block);
+
+      auto status = writer_->Write(block, block + length);
+      if (!status)
+        return status;
+
+      begin += length;
+    }
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return writer_->Skip(padding_bytes, padding_value);
+  }
+
+  template <typename HandleType>
+  Status<HandleType> PushHandle(const HandleType& handle) {
+    return writer_->PushHandle(handle);
+  }
+
+  // Forwards the SizeCache of the underlying writer, when it has one.
+  template <typename W = Writer>
+  constexpr auto size_cache() const
+      -> decltype(std::declval<W&>().size_cache()) {
+    return writer_->size_cache();
+  }
+
+  Writer& writer() { return *writer_; }
+  const Writer& writer() const { return *writer_; }
+
+ private:
+  Writer* writer_{nullptr};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_ENDIAN_WRITER_H_
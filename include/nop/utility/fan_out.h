@@ -0,0 +1,173 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_FAN_OUT_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_FAN_OUT_H_
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/types/flat_hash_map.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+//
+// Serialize-once fan-out.
+//
+// Publishers that send the same value to many subscribers can encode it once
+// into an EncodedBuffer and hand the buffer to each subscriber's writer with
+// WriteTo(). The buffer is immutable and reference counted, so queuing it for
+// many connections copies a pointer rather than the bytes. Writers that
+// gather, such as GatherWriter, reference the bytes instead of copying them,
+// so a subscriber's transport can send them straight from the shared buffer
+// with writev(2) or sendmsg(2). Each subscriber must hold its copy of the
+// buffer until its send completes.
+//
+// Protocols with per-connection encoder state, such as string dictionaries or
+// negotiated method ids, produce different bytes for connections in different
+// states. FanOutEncoder encodes a message once per state class: connections
+// whose state is the same share one encoding, which is made the first time
+// the class is requested.
+//
+// Example:
+//
+//  auto update = EncodeShared(market_update);
+//  if (!update)
+//    return update.error();
+//  for (Subscriber& subscriber : subscribers)
+//    subscriber.queue.push_back(update.get());
+//
+//  // In each subscriber's send loop.
+//  GatherWriter<> writer;
+//  status = subscriber.queue.front().WriteTo(&writer);
+//  ::writev(subscriber.fd, writer.Gather().data(), writer.Gather().size());
+//
+
+// EncodedBuffer holds an immutable, shared encoding of one or more values.
+// Copies share the same bytes.
+class EncodedBuffer {
+ public:
+  EncodedBuffer() = default;
+  explicit EncodedBuffer(std::vector<std::uint8_t> bytes)
+      : bytes_{std::make_shared<const std::vector<std::uint8_t>>(
+            std::move(bytes))} {}
+
+  const std::uint8_t* data() const { return bytes_ ? bytes_->data() : nullptr; }
+  std::size_t size() const { return bytes_ ? bytes_->size() : 0; }
+  bool empty() const { return size() == 0; }
+
+  const std::uint8_t* begin() const { return data(); }
+  const std::uint8_t* end() const { return data() + size(); }
+
+  // Returns the number of buffers sharing the bytes.
+  long use_count() const { return bytes_.use_count(); }
+
+  // Returns an iovec referring to the bytes, for writev(2) or sendmsg(2).
+  struct iovec iovec() const {
+    return {const_cast<std::uint8_t*>(data()), size()};
+  }
+
+  // Writes the bytes to |writer| as one contiguous range. The bytes must
+  // remain shared until writers that reference memory, such as GatherWriter,
+  // have been consumed.
+  template <typename Writer>
+  Status<void> WriteTo(Writer* writer) const {
+    if (empty())
+      return {};
+
+    auto status = writer->Prepare(size());
+    if (!status)
+      return status;
+
+    return writer->Write(begin(), end());
+  }
+
+ private:
+  std::shared_ptr<const std::vector<std::uint8_t>> bytes_;
+};
+
+// Encodes |value| once into a new EncodedBuffer sized to fit it exactly.
+template <typename T>
+Status<EncodedBuffer> EncodeShared(const T& value) {
+  std::vector<std::uint8_t> bytes;
+  bytes.reserve(Encoding<T>::Size(value));
+
+  VectorWriter writer{std::move(bytes)};
+  Serializer<VectorWriter*> serializer{&writer};
+  auto status = serializer.Write(value);
+  if (!status)
+    return status.error();
+
+  return EncodedBuffer{writer.take()};
+}
+
+// FanOutEncoder encodes a message once for each class of connection state it is
+// sent in, keyed by StateClass. Clear() forgets the encodings of the current
+// message before the next one is published.
+template <typename StateClass, typename Hash = std::hash<StateClass>>
+class FanOutEncoder {
+ public:
+  FanOutEncoder() = default;
+  FanOutEncoder(const FanOutEncoder&) = delete;
+  FanOutEncoder(FanOutEncoder&&) = default;
+
+  FanOutEncoder& operator=(const FanOutEncoder&) = delete;
+  FanOutEncoder& operator=(FanOutEncoder&&) = default;
+
+  // Returns the encoding of the current message for |state_class|. The first
+  // request for each class calls |encode| with the class and a VectorWriter*
+  // to produce it; |encode| returns Status<void> and is expected to advance
+  // the encoder state of the class, which every connection in the class must
+  // then share. Failed encodings are not kept.
+  template <typename Op>
+  Status<EncodedBuffer> Get(const StateClass& state_class, Op&& encode) {
+    auto search = encodings_.find(state_class);
+    if (search != encodings_.end())
+      return search->second;
+
+    VectorWriter writer;
+    auto status = std::forward<Op>(encode)(state_class, &writer);
+    if (!status)
+      return status.error();
+
+    EncodedBuffer buffer{writer.take()};
+    encodings_.emplace(state_class, buffer);
+    return buffer;
+  }
+
+  // Forgets the encodings of the current message. Subscribers still holding
+  // them keep their bytes alive.
+  void Clear() { encodings_.clear(); }
+
+  // Returns the number of encodings made for the current message.
+  std::size_t size() const { return encodings_.size(); }
+
+ private:
+  FlatHashMap<StateClass, EncodedBuffer, Hash> encodings_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_FAN_OUT_H_
@@ -23,6 +23,7 @@
 
 #include <utility>
 
+#include <nop/base/tracepoints.h>
 #include <nop/status.h>
 
 namespace nop {
@@ -64,6 +65,7 @@ class FdReader {
   Status<void> Read(std::uint8_t* byte) {
     while (true) {
       const int ret = ::read(fd_, byte, sizeof(*byte));
+      NOP_TRACE(fd_read, fd_, sizeof(*byte), ret);
       if (ret == 1)
         return {};
       else if (ret == 0)
@@ -88,6 +90,17 @@ class FdReader {
     return {};
   }
 
+  Status<void> Skip(std::size_t padding_bytes) {
+    std::uint8_t padding;
+    for (std::size_t i = 0; i < padding_bytes; i++) {
+      auto status = Read(&padding);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
  private:
   int fd_{-1};
 };
@@ -23,6 +23,7 @@
 
 #include <utility>
 
+#include <nop/base/tracepoints.h>
 #include <nop/status.h>
 
 namespace nop {
@@ -61,6 +62,7 @@ class FdWriter {
   Status<void> Write(std::uint8_t byte) {
     while (true) {
       const int ret = ::write(fd_, &byte, sizeof(byte));
+      NOP_TRACE(fd_write, fd_, sizeof(byte), ret);
       if (ret == 1)
         return {};
       else if (ret == 0)
@@ -85,6 +87,17 @@ class FdWriter {
     return {};
   }
 
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    for (std::size_t i = 0; i < padding_bytes; i++) {
+      auto status = Write(padding_value);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
  private:
   int fd_{-1};
 };
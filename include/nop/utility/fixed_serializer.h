@@ -0,0 +1,79 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_FIXED_SERIALIZER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_FIXED_SERIALIZER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <nop/base/encoding.h>
+#include <nop/base/max_encoded_size.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_writer.h>
+
+namespace nop {
+
+// FixedSerializer serializes values of a type with a bounded encoded size into
+// an internal std::array sized by MaxEncodedSize<T>. Since every value of T is
+// guaranteed to fit, the serializer skips the Size() pass and writes without
+// preparing the writer or checking bounds, and never allocates. This is useful
+// for fixed-shape structures on hot paths, such as telemetry records made of
+// integers, enums, and arrays.
+//
+// Example:
+//
+//   FixedSerializer<Sample> serializer;
+//   auto status = serializer.Write(sample);
+//   send(fd, serializer.data(), serializer.size(), 0);
+//
+template <typename T>
+class FixedSerializer {
+  static_assert(HasMaxEncodedSize<T>::value,
+                "FixedSerializer requires a type with a bounded encoded size. "
+                "See MaxEncodedSize<T> for the supported types.");
+
+ public:
+  enum : std::size_t { Capacity = MaxEncodedSize<T>::value };
+
+  FixedSerializer() = default;
+  FixedSerializer(const FixedSerializer&) = default;
+  FixedSerializer& operator=(const FixedSerializer&) = default;
+
+  // Serializes |value|, replacing the previous contents of the buffer.
+  Status<void> Write(const T& value) {
+    BufferWriter writer{buffer_.data(), buffer_.size()};
+    auto status = Encoding<T>::Write(value, &writer);
+    if (!status)
+      return status;
+
+    size_ = writer.size();
+    return {};
+  }
+
+  const std::uint8_t* data() const { return buffer_.data(); }
+  std::size_t size() const { return size_; }
+  const std::array<std::uint8_t, Capacity>& buffer() const { return buffer_; }
+
+ private:
+  std::array<std::uint8_t, Capacity> buffer_;
+  std::size_t size_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_FIXED_SERIALIZER_H_
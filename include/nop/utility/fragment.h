@@ -0,0 +1,88 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_FRAGMENT_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_FRAGMENT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <nop/base/encoding.h>
+#include <nop/status.h>
+
+namespace nop {
+
+//
+// Fragment format used by FragmentMultiplexer and FragmentDemultiplexer:
+//
+// +---------+----------+---------+---//----+
+// | INT64:L | INT64:ID | UINT8:F | N BYTES |
+// +---------+----------+---------+---//----+
+//
+// Each fragment is a frame in the format of FrameWriter, so that FrameReader
+// can split fragments out of a byte stream. The frame payload is the id of the
+// stream the fragment belongs to, the fragment flags, and the next N bytes of
+// the message being sent on the stream, where N is the rest of the L bytes of
+// the frame. The last fragment of each message has the FragmentLast flag set.
+// Messages are reassembled by concatenating the fragments of a stream in the
+// order they arrive.
+//
+
+// Type of the id that fragments of each stream are tagged with.
+using StreamId = std::uint64_t;
+
+enum FragmentFlags : std::uint8_t {
+  FragmentLast = 0x01,
+};
+
+// Header of a fragment, which precedes the fragment data in the frame payload.
+struct FragmentHeader {
+  StreamId stream;
+  std::uint8_t flags;
+
+  bool last() const { return (flags & FragmentLast) != 0; }
+
+  // Returns the encoded size of the header.
+  std::size_t Size() const {
+    return Encoding<StreamId>::Size(stream) +
+           Encoding<std::uint8_t>::Size(flags);
+  }
+
+  template <typename Writer>
+  Status<void> Write(Writer* writer) const {
+    auto status = Encoding<StreamId>::Write(stream, writer);
+    if (!status)
+      return status;
+
+    return Encoding<std::uint8_t>::Write(flags, writer);
+  }
+
+  // Reads the header from the start of a frame payload, leaving |reader| at
+  // the fragment data.
+  template <typename Reader>
+  Status<void> Read(Reader* reader) {
+    auto status = Encoding<StreamId>::Read(&stream, reader);
+    if (!status)
+      return status;
+
+    return Encoding<std::uint8_t>::Read(&flags, reader);
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_FRAGMENT_H_
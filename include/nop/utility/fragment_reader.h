@@ -0,0 +1,200 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_FRAGMENT_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_FRAGMENT_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <nop/base/utility.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/fragment.h>
+
+namespace nop {
+
+// FragmentDemultiplexer reassembles the messages of each stream from the
+// fragments sent by FragmentMultiplexer. Frames are split out of the channel
+// with FrameReader and passed to AddFragment(), which appends the fragment data
+// to the message of its stream. Complete messages are queued per stream until
+// taken with TakeMessage() or read with FragmentStreamReader.
+//
+// Streams that carry values too large to buffer whole may instead read each
+// FragmentHeader themselves and append the rest of the frame to a per-stream
+// ResumableReader, decoding the value as its fragments arrive.
+//
+// Example:
+//
+//  FrameReader frames;
+//  FragmentDemultiplexer demultiplexer;
+//  while (frames.ReadFrom(fd)) {
+//    BufferReader frame;
+//    while (frames.NextFrame(&frame).get()) {
+//      StreamId stream;
+//      auto complete = demultiplexer.AddFragment(&frame, &stream);
+//      if (complete && complete.get())
+//        HandleStream(stream);
+//    }
+//  }
+//
+class FragmentDemultiplexer {
+ public:
+  enum : std::size_t { DefaultMaxMessageSize = 64 * 1024 * 1024 };
+
+  // Constructs a demultiplexer that rejects messages larger than
+  // |max_message_size| bytes.
+  explicit FragmentDemultiplexer(
+      std::size_t max_message_size = DefaultMaxMessageSize)
+      : max_message_size_{max_message_size} {}
+
+  FragmentDemultiplexer(const FragmentDemultiplexer&) = delete;
+  void operator=(const FragmentDemultiplexer&) = delete;
+
+  // Adds the fragment in the frame payload |frame| to the message of its
+  // stream and stores the stream id in |stream|. Returns true if the fragment
+  // completes the message. Returns ErrorStatus::InvalidContainerLength if the
+  // message exceeds the maximum message size, in which case the partial
+  // message is discarded.
+  Status<bool> AddFragment(BufferReader* frame, StreamId* stream) {
+    FragmentHeader header;
+    auto status = header.Read(frame);
+    if (!status)
+      return status.error();
+
+    Stream& state = streams_[header.stream];
+    const std::size_t size = frame->remaining();
+    if (size > max_message_size_ - state.partial.size()) {
+      state.partial.clear();
+      return ErrorStatus::InvalidContainerLength;
+    }
+
+    const void* data = nullptr;
+    status = frame->Borrow(&data, size);
+    if (!status)
+      return status.error();
+
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    state.partial.insert(state.partial.end(), bytes, bytes + size);
+    *stream = header.stream;
+    if (!header.last())
+      return false;
+
+    state.complete.push_back(std::move(state.partial));
+    state.partial.clear();
+    return true;
+  }
+
+  // Moves the oldest complete message of |stream| into |message|. Returns
+  // false if the stream has no complete messages.
+  bool TakeMessage(StreamId stream, std::vector<std::uint8_t>* message) {
+    auto search = streams_.find(stream);
+    if (search == streams_.end() || search->second.complete.empty())
+      return false;
+
+    Stream& state = search->second;
+    *message = std::move(state.complete.front());
+    state.complete.pop_front();
+    if (state.complete.empty() && state.partial.empty())
+      streams_.erase(search);
+    return true;
+  }
+
+  // Returns true if |stream| has a complete message to take.
+  bool HasMessage(StreamId stream) const {
+    auto search = streams_.find(stream);
+    return search != streams_.end() && !search->second.complete.empty();
+  }
+
+  // Discards the partial and complete messages of |stream|.
+  void RemoveStream(StreamId stream) { streams_.erase(stream); }
+
+ private:
+  struct Stream {
+    std::vector<std::uint8_t> partial;
+    std::deque<std::vector<std::uint8_t>> complete;
+  };
+
+  std::size_t max_message_size_;
+  std::map<StreamId, Stream> streams_;
+};
+
+// FragmentStreamReader is a reader type that reads the complete messages of a
+// stream of a FragmentDemultiplexer, in order, as written by a Serializer with
+// FragmentStreamWriter. Each message holds whole values, so a value must be
+// read only once HasMessage() reports that its message has arrived; reads
+// return ErrorStatus::ReadLimitReached otherwise.
+class FragmentStreamReader {
+ public:
+  FragmentStreamReader(FragmentDemultiplexer* demultiplexer, StreamId stream)
+      : demultiplexer_{demultiplexer}, stream_{stream} {}
+
+  Status<void> Ensure(std::size_t size) {
+    if (index_ == message_.size() &&
+        demultiplexer_->TakeMessage(stream_, &message_)) {
+      index_ = 0;
+    }
+
+    if (message_.size() - index_ < size)
+      return ErrorStatus::ReadLimitReached;
+    else
+      return {};
+  }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    const std::size_t length_bytes = (end - begin) * sizeof(T);
+    auto status = Ensure(length_bytes);
+    if (!status)
+      return status;
+
+    std::memcpy(begin, &message_[index_], length_bytes);
+    index_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    auto status = Ensure(padding_bytes);
+    if (!status)
+      return status;
+
+    index_ += padding_bytes;
+    return {};
+  }
+
+  // Returns true if the current message has been read completely.
+  bool empty() const { return index_ == message_.size(); }
+
+  StreamId stream() const { return stream_; }
+
+ private:
+  FragmentDemultiplexer* demultiplexer_;
+  StreamId stream_;
+  std::vector<std::uint8_t> message_;
+  std::size_t index_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_FRAGMENT_READER_H_
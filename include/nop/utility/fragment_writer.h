@@ -0,0 +1,303 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_FRAGMENT_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_FRAGMENT_WRITER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/serializer.h>
+#include <nop/base/utility.h>
+#include <nop/status.h>
+#include <nop/utility/fragment.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+// FragmentMultiplexer splits the messages of many streams into fragments and
+// interleaves them on a single channel, so that a large message on one stream
+// does not hold up the small messages of the others. Messages are queued with
+// Enqueue() and sent one fragment at a time with WriteFragment(), in the
+// fragment format described in nop/utility/fragment.h.
+//
+// Fragments are scheduled by stream priority: a pending fragment of a stream
+// with a higher priority is always sent before those of streams with a lower
+// priority, and streams of the same priority take turns, one fragment each. A
+// small message queued behind a large one of the same priority therefore waits
+// for at most one fragment of each other busy stream, and one of a higher
+// priority for at most the fragment being written. Messages of one stream are
+// sent in order.
+//
+// FragmentMultiplexer is not thread safe; callers must serialize access.
+//
+// Example:
+//
+//  FragmentMultiplexer multiplexer;
+//  multiplexer.SetPriority(kControlStream, 1);
+//
+//  // Senders queue messages; see also FragmentStreamWriter.
+//  multiplexer.Enqueue(kBulkStream, std::move(bulk_bytes));
+//  multiplexer.Enqueue(kControlStream, std::move(control_bytes));
+//
+//  // The transport sends fragments whenever the channel is writable.
+//  FdWriter writer{socket_fd};
+//  Status<bool> sent;
+//  while ((sent = multiplexer.WriteFragment(&writer)) && sent.get()) {
+//  }
+//
+class FragmentMultiplexer {
+ public:
+  enum : std::size_t { DefaultFragmentSize = 16 * 1024 };
+  enum : int { DefaultPriority = 0 };
+
+  // Constructs a multiplexer that sends at most |fragment_size| bytes of
+  // message data in each fragment.
+  explicit FragmentMultiplexer(std::size_t fragment_size = DefaultFragmentSize)
+      : fragment_size_{std::max<std::size_t>(fragment_size, 1)} {}
+
+  FragmentMultiplexer(const FragmentMultiplexer&) = delete;
+  void operator=(const FragmentMultiplexer&) = delete;
+
+  // Sets the priority of |stream|, which takes effect from the next fragment.
+  // Streams have DefaultPriority until set otherwise.
+  void SetPriority(StreamId stream, int priority) {
+    Stream& state = streams_[stream];
+    if (state.priority == priority)
+      return;
+
+    if (!state.messages.empty()) {
+      Unschedule(stream, state.priority);
+      ready_[priority].push_back(stream);
+    }
+    state.priority = priority;
+  }
+
+  int GetPriority(StreamId stream) const {
+    auto search = streams_.find(stream);
+    return search != streams_.end() ? search->second.priority
+                                    : static_cast<int>(DefaultPriority);
+  }
+
+  // Queues |message| to be sent on |stream| after the messages already queued
+  // on it.
+  void Enqueue(StreamId stream, std::vector<std::uint8_t> message) {
+    Stream& state = streams_[stream];
+    if (state.messages.empty())
+      ready_[state.priority].push_back(stream);
+
+    queued_bytes_ += message.size();
+    state.messages.push_back(std::move(message));
+  }
+
+  // Queues a copy of the bytes in the range [begin, end) as a message.
+  void Enqueue(StreamId stream, const std::uint8_t* begin,
+               const std::uint8_t* end) {
+    Enqueue(stream, std::vector<std::uint8_t>(begin, end));
+  }
+
+  // Writes the next scheduled fragment to |writer| as one frame. Returns true
+  // if a fragment was written and false if no messages are queued. If writing
+  // fails the fragment stays queued, but the writer may have received part of
+  // the frame.
+  template <typename Writer>
+  Status<bool> WriteFragment(Writer* writer) {
+    if (ready_.empty())
+      return false;
+
+    auto level = ready_.begin();
+    const StreamId stream = level->second.front();
+    Stream& state = streams_.find(stream)->second;
+
+    const std::vector<std::uint8_t>& message = state.messages.front();
+    const std::size_t size =
+        std::min(fragment_size_, message.size() - state.offset);
+    const bool last = state.offset + size == message.size();
+    const FragmentHeader header{
+        stream, static_cast<std::uint8_t>(last ? FragmentLast : 0)};
+
+    const SizeType frame_size = header.Size() + size;
+    auto status =
+        writer->Prepare(Encoding<SizeType>::Size(frame_size) + frame_size);
+    if (!status)
+      return status.error();
+
+    status = Encoding<SizeType>::Write(frame_size, writer);
+    if (!status)
+      return status.error();
+
+    status = header.Write(writer);
+    if (!status)
+      return status.error();
+
+    const std::uint8_t* data = message.data() + state.offset;
+    status = writer->Write(data, data + size);
+    if (!status)
+      return status.error();
+
+    status = Flush(writer);
+    if (!status)
+      return status.error();
+
+    state.offset += size;
+    queued_bytes_ -= size;
+    if (last) {
+      state.messages.pop_front();
+      state.offset = 0;
+    }
+
+    // Move the stream to the back of its priority level so that streams of
+    // the same priority take turns.
+    level->second.pop_front();
+    if (!state.messages.empty())
+      level->second.push_back(stream);
+    else if (state.priority == DefaultPriority)
+      streams_.erase(stream);
+    if (level->second.empty())
+      ready_.erase(level);
+
+    return true;
+  }
+
+  // Discards the queued messages of |stream| and its priority. Fragments of a
+  // partially sent message are not completed, so streams should only be
+  // removed when they are closed at both ends.
+  void RemoveStream(StreamId stream) {
+    auto search = streams_.find(stream);
+    if (search == streams_.end())
+      return;
+
+    Stream& state = search->second;
+    if (!state.messages.empty()) {
+      Unschedule(stream, state.priority);
+      for (const auto& message : state.messages)
+        queued_bytes_ -= message.size();
+      queued_bytes_ += state.offset;
+    }
+    streams_.erase(search);
+  }
+
+  // Returns true if no messages are queued.
+  bool empty() const { return ready_.empty(); }
+
+  // Returns the number of message bytes queued and not yet sent.
+  std::size_t queued_bytes() const { return queued_bytes_; }
+
+  std::size_t fragment_size() const { return fragment_size_; }
+
+ private:
+  struct Stream {
+    int priority{DefaultPriority};
+    std::deque<std::vector<std::uint8_t>> messages;
+    // Bytes of the front message that have been sent.
+    std::size_t offset{0};
+  };
+
+  void Unschedule(StreamId stream, int priority) {
+    auto level = ready_.find(priority);
+    if (level == ready_.end())
+      return;
+
+    auto& queue = level->second;
+    queue.erase(std::remove(queue.begin(), queue.end(), stream), queue.end());
+    if (queue.empty())
+      ready_.erase(level);
+  }
+
+  // Gives buffering writers the chance to send the complete fragment at once.
+  template <typename Writer>
+  static std::enable_if_t<IsDetected<WriterFlushTest, Writer>::value,
+                          Status<void>>
+  Flush(Writer* writer) {
+    return writer->Flush();
+  }
+
+  template <typename Writer>
+  static std::enable_if_t<!IsDetected<WriterFlushTest, Writer>::value,
+                          Status<void>>
+  Flush(Writer* /*writer*/) {
+    return {};
+  }
+
+  std::size_t fragment_size_;
+  std::size_t queued_bytes_{0};
+  std::map<StreamId, Stream> streams_;
+  // Streams with queued messages, in turn order, by decreasing priority.
+  std::map<int, std::deque<StreamId>, std::greater<int>> ready_;
+};
+
+// FragmentStreamWriter is a writer type that queues each value written by a
+// Serializer as one message on a stream of a FragmentMultiplexer. The bytes of
+// each value are collected until the Serializer flushes the writer at the end
+// of the value, so that several serializers, for example those of the
+// SimpleMethodSender and SimpleMethodReceiver of different calls, may share
+// one channel through their own streams.
+//
+// Example:
+//
+//  Serializer<FragmentStreamWriter> serializer{&multiplexer, kControlStream};
+//  Deserializer<FragmentStreamReader> deserializer{&demultiplexer,
+//                                                  kControlStream};
+//  auto sender = MakeSimpleMethodSender(&serializer, &deserializer);
+//
+class FragmentStreamWriter {
+ public:
+  FragmentStreamWriter(FragmentMultiplexer* multiplexer, StreamId stream)
+      : multiplexer_{multiplexer}, stream_{stream} {}
+
+  Status<void> Prepare(std::size_t size) { return buffer_.Prepare(size); }
+
+  Status<void> Write(std::uint8_t byte) { return buffer_.Write(byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    return buffer_.Write(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return buffer_.Skip(padding_bytes, padding_value);
+  }
+
+  // Queues the bytes written since the last flush as one message.
+  Status<void> Flush() {
+    if (!buffer_.empty())
+      multiplexer_->Enqueue(stream_, buffer_.take());
+    return {};
+  }
+
+  StreamId stream() const { return stream_; }
+  const FragmentMultiplexer& multiplexer() const { return *multiplexer_; }
+  FragmentMultiplexer& multiplexer() { return *multiplexer_; }
+
+ private:
+  FragmentMultiplexer* multiplexer_;
+  StreamId stream_;
+  VectorWriter buffer_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_FRAGMENT_WRITER_H_
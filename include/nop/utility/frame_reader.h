@@ -0,0 +1,180 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_FRAME_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_FRAME_READER_H_
+
+#include <errno.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+
+namespace nop {
+
+// FrameReader splits a byte stream of frames written by FrameWriter into
+// individual frames. Bytes are pulled into a reusable buffer with as few reads
+// as possible, using ReadFrom() for file descriptors or Append() for other
+// transports, and each complete frame in the buffer is handed out by
+// NextFrame() as a BufferReader over the frame payload. Bytes of incomplete
+// frames are kept for the next read.
+//
+// Frames returned by NextFrame() remain valid until the next call to
+// ReadFrom() or Append(). Frames larger than the buffer grow it, up to the
+// maximum frame size given at construction.
+//
+// Example:
+//
+//  FrameReader frames;
+//  while (frames.ReadFrom(fd)) {
+//    BufferReader frame;
+//    Status<bool> next;
+//    while ((next = frames.NextFrame(&frame)) && next.get()) {
+//      Deserializer<BufferReader*> deserializer{&frame};
+//      ...
+//    }
+//    if (!next)
+//      break;
+//  }
+//
+class FrameReader {
+ public:
+  enum : std::size_t {
+    DefaultCapacity = 64 * 1024,
+    DefaultMaxFrameSize = 64 * 1024 * 1024,
+  };
+
+  explicit FrameReader(std::size_t capacity = DefaultCapacity,
+                       std::size_t max_frame_size = DefaultMaxFrameSize)
+      : buffer_(std::max<std::size_t>(capacity, kMaxHeaderSize)),
+        max_frame_size_{max_frame_size} {}
+
+  FrameReader(const FrameReader&) = delete;
+  void operator=(const FrameReader&) = delete;
+
+  // Performs one read(2) from |fd| into the free space of the buffer, returning
+  // the number of bytes read. Returns zero bytes when a non-blocking |fd| has
+  // no data available and ErrorStatus::ReadLimitReached at the end of the
+  // stream.
+  Status<std::size_t> ReadFrom(int fd) {
+    Compact();
+    while (true) {
+      const ssize_t ret = ::read(fd, &buffer_[end_], buffer_.size() - end_);
+      if (ret > 0) {
+        end_ += ret;
+        return static_cast<std::size_t>(ret);
+      } else if (ret == 0) {
+        return ErrorStatus::ReadLimitReached;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return 0;
+      } else if (errno != EINTR) {
+        return ErrorStatus::IOError;
+      }
+      // Otherwise interrupted by signal; retry.
+    }
+  }
+
+  // Copies |size| bytes received from some other transport into the buffer.
+  void Append(const void* data, std::size_t size) {
+    Compact();
+    if (buffer_.size() - end_ < size)
+      buffer_.resize(end_ + size);
+
+    std::memcpy(&buffer_[end_], data, size);
+    end_ += size;
+  }
+
+  // Points |frame| at the payload of the next complete frame in the buffer and
+  // returns true, or returns false if more bytes are needed. Returns
+  // ErrorStatus::UnexpectedEncodingType if the frame header is invalid and
+  // ErrorStatus::InvalidContainerLength if the frame exceeds the maximum frame
+  // size.
+  Status<bool> NextFrame(BufferReader* frame) {
+    if (available() == 0)
+      return false;
+
+    const EncodingByte prefix = static_cast<EncodingByte>(buffer_[begin_]);
+    if (!Encoding<SizeType>::Match(prefix))
+      return ErrorStatus::UnexpectedEncodingType;
+
+    const std::size_t header_size = BaseEncodingSize(prefix);
+    if (available() < header_size)
+      return false;
+
+    SizeType size = 0;
+    BufferReader header{&buffer_[begin_], header_size};
+    auto status = Encoding<SizeType>::Read(&size, &header);
+    if (!status)
+      return status.error();
+
+    if (size > max_frame_size_)
+      return ErrorStatus::InvalidContainerLength;
+
+    // Make sure the buffer can hold the whole frame on the next read.
+    needed_ = header_size + size;
+    if (available() < needed_)
+      return false;
+
+    *frame = BufferReader{&buffer_[begin_ + header_size],
+                          static_cast<std::size_t>(size)};
+    begin_ += needed_;
+    needed_ = 0;
+    return true;
+  }
+
+  // Returns the number of bytes buffered and not yet returned as frames.
+  std::size_t available() const { return end_ - begin_; }
+
+  std::size_t capacity() const { return buffer_.size(); }
+
+ private:
+  // Largest encoding of a frame size: a U64 prefix and eight bytes.
+  enum : std::size_t { kMaxHeaderSize = 9 };
+
+  // Moves unconsumed bytes to the front of the buffer and grows it to fit the
+  // pending frame, if it is larger than the buffer, or to leave room to read
+  // when the buffer is full of frames that have not been handed out yet.
+  void Compact() {
+    if (begin_ != 0) {
+      std::memmove(&buffer_[0], &buffer_[begin_], available());
+      end_ -= begin_;
+      begin_ = 0;
+    }
+
+    if (needed_ > buffer_.size())
+      buffer_.resize(needed_);
+    else if (end_ == buffer_.size())
+      buffer_.resize(buffer_.size() * 2);
+  }
+
+  std::vector<std::uint8_t> buffer_;
+  std::size_t max_frame_size_;
+  std::size_t begin_{0};
+  std::size_t end_{0};
+  std::size_t needed_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_FRAME_READER_H_
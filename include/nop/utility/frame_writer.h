@@ -0,0 +1,124 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_FRAME_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_FRAME_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <nop/base/encoding.h>
+#include <nop/base/serializer.h>
+#include <nop/base/size_cache.h>
+#include <nop/base/utility.h>
+#include <nop/status.h>
+#include <nop/utility/bounded_writer.h>
+
+namespace nop {
+
+//
+// Frame format used by FrameWriter and FrameReader:
+//
+// +---------+---//----+
+// | INT64:L | L BYTES |
+// +---------+---//----+
+//
+// Each frame is the size of the payload in bytes, encoded as an unsigned
+// integer, followed by the payload, which is a single encoded value padded out
+// to L bytes when the encoded size of the value is an over estimate.
+//
+
+// FrameWriter writes values to the given writer as frames that FrameReader can
+// split out of a byte stream without decoding them. The frame length is taken
+// from Encoding<T>::Size(), so each frame is written in one pass and the writer
+// is prepared for the whole frame at once.
+template <typename Writer>
+class FrameWriter {
+ public:
+  constexpr FrameWriter() : writer_{nullptr} {}
+  constexpr FrameWriter(Writer* writer) : writer_{writer} {}
+  constexpr FrameWriter(const FrameWriter&) = default;
+  constexpr FrameWriter& operator=(const FrameWriter&) = default;
+
+  // Writes |value| as one frame.
+  template <typename T>
+  Status<void> Write(const T& value) {
+    SizeCache cache;
+    const SizeType size = CachedSize(value, &cache);
+
+    auto status = writer_->Prepare(Encoding<SizeType>::Size(size) + size);
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(size, writer_);
+    if (!status)
+      return status;
+
+    SizeCacheWriter<Writer> cache_writer{writer_, &cache};
+    BoundedWriter<SizeCacheWriter<Writer>> bounded_writer{&cache_writer, size};
+    status = Encoding<T>::Write(value, &bounded_writer);
+    if (!status)
+      return status;
+
+    status = bounded_writer.WritePadding();
+    if (!status)
+      return status;
+
+    return Flush(writer_);
+  }
+
+  // Writes the already encoded bytes in the range [begin, end) as one frame.
+  Status<void> WriteFrame(const std::uint8_t* begin, const std::uint8_t* end) {
+    const SizeType size = end - begin;
+    auto status = writer_->Prepare(Encoding<SizeType>::Size(size) + size);
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(size, writer_);
+    if (!status)
+      return status;
+
+    status = writer_->Write(begin, end);
+    if (!status)
+      return status;
+
+    return Flush(writer_);
+  }
+
+  const Writer& writer() const { return *writer_; }
+  Writer& writer() { return *writer_; }
+
+ private:
+  // Gives buffering writers the chance to send the complete frame at once.
+  template <typename W>
+  static std::enable_if_t<IsDetected<WriterFlushTest, W>::value, Status<void>>
+  Flush(W* writer) {
+    return writer->Flush();
+  }
+
+  template <typename W>
+  static std::enable_if_t<!IsDetected<WriterFlushTest, W>::value, Status<void>>
+  Flush(W* /*writer*/) {
+    return {};
+  }
+
+  Writer* writer_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_FRAME_WRITER_H_
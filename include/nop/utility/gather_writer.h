@@ -0,0 +1,144 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_GATHER_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_GATHER_WRITER_H_
+
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <nop/status.h>
+
+namespace nop {
+
+// GatherWriter is a writer type that produces a list of iovecs suitable for
+// writev(2), sendmsg(2), or io_uring submission. Small writes, such as prefix
+// bytes and headers, are copied into an internal staging buffer. Contiguous
+// ranges of at least GatherThreshold bytes are not copied; instead the writer
+// records a reference to the caller's memory and emits it as a separate iovec.
+//
+// Referenced ranges must remain valid and unmodified until the iovecs returned
+// by Gather() have been consumed. Clear() returns the writer to zero length
+// while retaining allocated capacity for reuse.
+template <std::size_t GatherThreshold = 512>
+class GatherWriter {
+ public:
+  GatherWriter() = default;
+  GatherWriter(const GatherWriter&) = delete;
+  GatherWriter(GatherWriter&&) = default;
+
+  GatherWriter& operator=(const GatherWriter&) = delete;
+  GatherWriter& operator=(GatherWriter&&) = default;
+
+  Status<void> Prepare(std::size_t size) {
+    // Large values are likely to be dominated by referenced ranges; cap the
+    // reservation to avoid sizing the staging buffer for data it won't hold.
+    buffer_.reserve(buffer_.size() + std::min<std::size_t>(size, kMaxReserve));
+    return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) {
+    Stage(1);
+    buffer_.push_back(byte);
+    return {};
+  }
+
+  Status<void> Write(const void* begin, const void* end) {
+    const std::uint8_t* begin_byte = static_cast<const std::uint8_t*>(begin);
+    const std::uint8_t* end_byte = static_cast<const std::uint8_t*>(end);
+    const std::size_t length_bytes = end_byte - begin_byte;
+
+    if (length_bytes >= GatherThreshold) {
+      segments_.push_back({begin_byte, 0, length_bytes});
+    } else {
+      Stage(length_bytes);
+      buffer_.insert(buffer_.end(), begin_byte, end_byte);
+    }
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    Stage(padding_bytes);
+    buffer_.insert(buffer_.end(), padding_bytes, padding_value);
+    return {};
+  }
+
+  // Returns the output as a list of non-empty iovecs in output order. The list
+  // is rebuilt on each call, so callers may adjust the entries in place, for
+  // example to advance past a partial write.
+  std::vector<struct iovec>& Gather() {
+    iovecs_.clear();
+    for (const Segment& segment : segments_) {
+      if (segment.length == 0)
+        continue;
+
+      const std::uint8_t* data =
+          segment.data ? segment.data : &buffer_[segment.offset];
+      iovecs_.push_back({const_cast<std::uint8_t*>(data), segment.length});
+    }
+    return iovecs_;
+  }
+
+  // Drops all output while retaining allocated capacity.
+  void Clear() {
+    buffer_.clear();
+    segments_.clear();
+    iovecs_.clear();
+  }
+
+  // Returns the total number of bytes written, staged or referenced.
+  std::size_t size() const {
+    std::size_t size_bytes = 0;
+    for (const Segment& segment : segments_)
+      size_bytes += segment.length;
+    return size_bytes;
+  }
+
+  // Returns the number of bytes copied into the staging buffer.
+  std::size_t staged() const { return buffer_.size(); }
+
+ private:
+  enum : std::size_t { kMaxReserve = 64 * 1024 };
+
+  // A span of output. Segments with a null data pointer refer to the staging
+  // buffer by offset, since the buffer may relocate as it grows.
+  struct Segment {
+    const std::uint8_t* data;
+    std::size_t offset;
+    std::size_t length;
+  };
+
+  // Accounts for |length_bytes| about to be appended to the staging buffer,
+  // extending the last segment when it is also staged.
+  void Stage(std::size_t length_bytes) {
+    if (segments_.empty() || segments_.back().data != nullptr)
+      segments_.push_back({nullptr, buffer_.size(), 0});
+    segments_.back().length += length_bytes;
+  }
+
+  std::vector<std::uint8_t> buffer_;
+  std::vector<Segment> segments_;
+  std::vector<struct iovec> iovecs_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_GATHER_WRITER_H_
@@ -0,0 +1,263 @@
+/*
+ * Copyright 2019 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_GROWABLE_BUFFER_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_GROWABLE_BUFFER_WRITER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// A writer type that supports runtime serialization into a growable list of
+// byte chunks. Unlike BufferWriter this writer never returns
+// ErrorStatus::WriteLimitReached: when the current chunk is exhausted another
+// chunk is taken from the set of retained chunks or allocated using the given
+// Allocator, which may be any standard allocator type for bytes, including
+// arena-backed allocators and HugePageAllocator.
+//
+// Prepare() moves to a chunk large enough to hold the full value when the
+// current chunk does not have room, so a value serialized by the
+// library-provided Serializer types is usually stored contiguously. The output
+// is available either as a list of segments or as a single contiguous segment
+// using Linearize(). Reset() returns the writer to zero length while keeping
+// every chunk for reuse, so that repeated serialization of similarly sized
+// values settles into a state with no dynamic memory allocation.
+template <typename Allocator = std::allocator<std::uint8_t>>
+class GrowableBufferWriter {
+  using AllocatorTraits = std::allocator_traits<Allocator>;
+  static_assert(sizeof(typename AllocatorTraits::value_type) == 1,
+                "Allocator must allocate byte-sized elements.");
+
+ public:
+  // A contiguous range of output bytes.
+  struct Segment {
+    const std::uint8_t* data;
+    std::size_t size;
+  };
+
+  enum : std::size_t { kDefaultChunkSize = 4096 };
+
+  GrowableBufferWriter() = default;
+  explicit GrowableBufferWriter(std::size_t chunk_size,
+                                const Allocator& allocator = Allocator{})
+      : chunk_size_{std::max<std::size_t>(chunk_size, 1)},
+        allocator_{allocator},
+        chunks_{ChunkAllocator{allocator}} {}
+  GrowableBufferWriter(GrowableBufferWriter&& other) {
+    *this = std::move(other);
+  }
+
+  ~GrowableBufferWriter() { FreeChunks(); }
+
+  GrowableBufferWriter& operator=(GrowableBufferWriter&& other) {
+    if (this != &other) {
+      FreeChunks();
+      chunk_size_ = other.chunk_size_;
+      allocator_ = std::move(other.allocator_);
+      chunks_ = std::move(other.chunks_);
+      used_ = other.used_;
+      size_ = other.size_;
+
+      other.chunks_.clear();
+      other.used_ = 0;
+      other.size_ = 0;
+    }
+    return *this;
+  }
+
+  Status<void> Prepare(std::size_t size) {
+    Reserve(size);
+    return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) {
+    Reserve(1);
+    Chunk& chunk = chunks_[used_ - 1];
+    chunk.data[chunk.size++] = byte;
+    size_ += 1;
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::uint8_t* data = reinterpret_cast<const std::uint8_t*>(begin);
+    std::size_t length_bytes = (end - begin) * sizeof(T);
+
+    while (length_bytes) {
+      Reserve(1);
+      Chunk& chunk = chunks_[used_ - 1];
+      const std::size_t count = std::min(length_bytes, chunk.remaining());
+      std::memcpy(&chunk.data[chunk.size], data, count);
+      chunk.size += count;
+      size_ += count;
+      data += count;
+      length_bytes -= count;
+    }
+
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    while (padding_bytes) {
+      Reserve(1);
+      Chunk& chunk = chunks_[used_ - 1];
+      const std::size_t count = std::min(padding_bytes, chunk.remaining());
+      std::memset(&chunk.data[chunk.size], padding_value, count);
+      chunk.size += count;
+      size_ += count;
+      padding_bytes -= count;
+    }
+
+    return {};
+  }
+
+  // Returns the output to zero length, retaining all chunks for reuse.
+  void Reset() {
+    for (std::size_t i = 0; i < used_; i++)
+      chunks_[i].size = 0;
+    used_ = 0;
+    size_ = 0;
+  }
+
+  // Returns the number of non-empty segments holding the output.
+  std::size_t segment_count() const {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < used_; i++)
+      count += chunks_[i].size ? 1 : 0;
+    return count;
+  }
+
+  // Returns the non-empty segment at the given index, in output order.
+  Segment segment(std::size_t index) const {
+    for (std::size_t i = 0; i < used_; i++) {
+      if (chunks_[i].size && index-- == 0)
+        return {chunks_[i].data, chunks_[i].size};
+    }
+    return {nullptr, 0};
+  }
+
+  // Returns the output as a single contiguous segment, copying the output into
+  // one chunk first if it spans more than one segment. The chunk used for this
+  // copy is retained, making later copies of the same size allocation free.
+  Segment Linearize() {
+    if (segment_count() > 1) {
+      Chunk target = TakeChunk(size_);
+      for (std::size_t i = 0; i < used_; i++) {
+        std::memcpy(&target.data[target.size], chunks_[i].data,
+                    chunks_[i].size);
+        target.size += chunks_[i].size;
+        chunks_[i].size = 0;
+      }
+
+      chunks_.push_back(target);
+      std::swap(chunks_[0], chunks_.back());
+      used_ = 1;
+    }
+
+    return segment(0);
+  }
+
+  std::size_t size() const { return size_; }
+
+  // Returns the total number of bytes held in chunks, whether in use or not.
+  std::size_t capacity() const {
+    std::size_t capacity_bytes = 0;
+    for (const Chunk& chunk : chunks_)
+      capacity_bytes += chunk.capacity;
+    return capacity_bytes;
+  }
+
+ private:
+  struct Chunk {
+    std::uint8_t* data;
+    std::size_t capacity;
+    std::size_t size;
+
+    std::size_t remaining() const { return capacity - size; }
+  };
+
+  using ChunkAllocator =
+      typename AllocatorTraits::template rebind_alloc<Chunk>;
+
+  // Makes sure the current chunk has room for at least |size| bytes, moving to
+  // a retained or newly allocated chunk if necessary.
+  void Reserve(std::size_t size) {
+    if (used_ > 0) {
+      if (chunks_[used_ - 1].remaining() >= size)
+        return;
+
+      // An empty current chunk that is too small is given back to the pool.
+      if (chunks_[used_ - 1].size == 0)
+        used_--;
+    }
+
+    Chunk chunk = TakeChunk(size);
+    chunks_.push_back(chunk);
+    std::swap(chunks_[used_], chunks_.back());
+    used_++;
+  }
+
+  // Removes and returns a retained chunk with at least |size| bytes capacity,
+  // or allocates a new one if none is suitable.
+  Chunk TakeChunk(std::size_t size) {
+    for (std::size_t i = used_; i < chunks_.size(); i++) {
+      if (chunks_[i].capacity >= size) {
+        Chunk chunk = chunks_[i];
+        chunks_.erase(chunks_.begin() + i);
+        return chunk;
+      }
+    }
+
+    const std::size_t capacity = std::max(size, chunk_size_);
+    std::uint8_t* data =
+        reinterpret_cast<std::uint8_t*>(allocator_.allocate(capacity));
+    return {data, capacity, 0};
+  }
+
+  void FreeChunks() {
+    for (const Chunk& chunk : chunks_) {
+      allocator_.deallocate(
+          reinterpret_cast<typename AllocatorTraits::pointer>(chunk.data),
+          chunk.capacity);
+    }
+    chunks_.clear();
+    used_ = 0;
+    size_ = 0;
+  }
+
+  std::size_t chunk_size_{kDefaultChunkSize};
+  Allocator allocator_{};
+  std::vector<Chunk, ChunkAllocator> chunks_{};
+  std::size_t used_{0};
+  std::size_t size_{0};
+
+  GrowableBufferWriter(const GrowableBufferWriter&) = delete;
+  void operator=(const GrowableBufferWriter&) = delete;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_GROWABLE_BUFFER_WRITER_H_
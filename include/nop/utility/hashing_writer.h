@@ -0,0 +1,213 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_HASHING_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_HASHING_WRITER_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/utility.h>
+#include <nop/utility/sip_hash.h>
+
+namespace nop {
+
+namespace detail {
+
+// Folds |padding_bytes| copies of |padding_value| into |hasher|.
+template <typename Hasher>
+void HashPadding(Hasher* hasher, std::size_t padding_bytes,
+                 std::uint8_t padding_value) {
+  std::array<std::uint8_t, 64> padding;
+  padding.fill(padding_value);
+  while (padding_bytes > 0) {
+    const std::size_t length = std::min(padding_bytes, padding.size());
+    hasher->Update(padding.data(), length);
+    padding_bytes -= length;
+  }
+}
+
+}  // namespace detail
+
+// HashingWriter is a writer type that computes a content hash of every byte
+// written as it passes through to another writer, so hashing the output costs
+// no extra pass over it. With Writer = void there is no underlying writer and
+// the bytes are only hashed, which computes the hash of a value's encoding
+// without storing the encoding anywhere.
+//
+// The hash is computed by Hasher, which must provide the following methods:
+//
+//   void Update(const void* data, std::size_t size);
+//   ValueType value() const;
+//   void Reset();
+//
+// SipHasher<64> is used by default and SipHasher<128> gives a 128-bit hash.
+// Combine with CanonicalWriter so that equal values produce equal hashes.
+//
+// Borrowing is not forwarded, since bytes written directly into borrowed
+// memory would not be hashed.
+//
+// Example:
+//
+//  // Compute a cache key without keeping the encoded bytes.
+//  Serializer<CanonicalWriter<HashingWriter<>>> serializer;
+//  auto status = serializer.Write(request);
+//  if (status)
+//    cache_key = serializer.writer().writer().hash();
+//
+template <typename Writer = void, typename Hasher = SipHasher<64>>
+class HashingWriter {
+ public:
+  using HashType = decltype(std::declval<const Hasher&>().value());
+
+  HashingWriter() = default;
+  HashingWriter(const HashingWriter&) = default;
+  HashingWriter(Writer* writer, const Hasher& hasher = Hasher{})
+      : writer_{writer}, hasher_{hasher} {}
+
+  HashingWriter& operator=(const HashingWriter&) = default;
+
+  Status<void> Prepare(std::size_t size) { return writer_->Prepare(size); }
+
+  Status<void> Write(std::uint8_t byte) {
+    auto status = writer_->Write(byte);
+    if (!status)
+      return status;
+
+    hasher_.Update(&byte, 1);
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    auto status = writer_->Write(begin, end);
+    if (!status)
+      return status;
+
+    hasher_.Update(begin, (end - begin) * sizeof(T));
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    auto status = writer_->Skip(padding_bytes, padding_value);
+    if (!status)
+      return status;
+
+    detail::HashPadding(&hasher_, padding_bytes, padding_value);
+    return {};
+  }
+
+  template <typename HandleType>
+  Status<HandleType> PushHandle(const HandleType& handle) {
+    return writer_->PushHandle(handle);
+  }
+
+  // Forwards the SizeCache of the underlying writer, when it has one.
+  template <typename W = Writer>
+  constexpr auto size_cache() const
+      -> decltype(std::declval<W&>().size_cache()) {
+    return writer_->size_cache();
+  }
+
+  // Forwards the canonical encoding request of the underlying writer.
+  template <typename W = Writer>
+  constexpr auto canonical() const
+      -> decltype(std::declval<const W&>().canonical()) {
+    return writer_->canonical();
+  }
+
+  // Returns the hash of the bytes written since construction or the last call
+  // to Reset().
+  HashType hash() const { return hasher_.value(); }
+
+  // Starts a new hash for the bytes that follow.
+  void Reset() { hasher_.Reset(); }
+
+  const Writer& writer() const { return *writer_; }
+  Writer& writer() { return *writer_; }
+
+ private:
+  Writer* writer_{nullptr};
+  Hasher hasher_;
+};
+
+// HashingWriter without an underlying writer. Bytes are hashed and discarded,
+// and writes never fail. Handles are not sent anywhere; each handle is assigned
+// the next reference in sequence so that the hash is the same as it would be
+// for a writer that accepts every handle.
+template <typename Hasher>
+class HashingWriter<void, Hasher> {
+ public:
+  using HashType = decltype(std::declval<const Hasher&>().value());
+
+  HashingWriter() = default;
+  HashingWriter(const HashingWriter&) = default;
+  HashingWriter(const Hasher& hasher) : hasher_{hasher} {}
+
+  HashingWriter& operator=(const HashingWriter&) = default;
+
+  Status<void> Prepare(std::size_t /*size*/) { return {}; }
+
+  Status<void> Write(std::uint8_t byte) {
+    hasher_.Update(&byte, 1);
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    hasher_.Update(begin, (end - begin) * sizeof(T));
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    detail::HashPadding(&hasher_, padding_bytes, padding_value);
+    return {};
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    if (handle)
+      return handle_count_++;
+    else
+      return kEmptyHandleReference;
+  }
+
+  // Returns the hash of the bytes written since construction or the last call
+  // to Reset().
+  HashType hash() const { return hasher_.value(); }
+
+  // Starts a new hash for the bytes that follow.
+  void Reset() {
+    hasher_.Reset();
+    handle_count_ = 0;
+  }
+
+ private:
+  Hasher hasher_;
+  HandleReference handle_count_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_HASHING_WRITER_H_
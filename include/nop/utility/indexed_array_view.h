@@ -0,0 +1,152 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_INDEXED_ARRAY_VIEW_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_INDEXED_ARRAY_VIEW_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <nop/base/encoding.h>
+#include <nop/base/vector.h>
+#include <nop/status.h>
+#include <nop/utility/endian.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+
+namespace nop {
+
+// IndexedArrayView provides random access to the elements of an indexed array
+// written by IndexedArray<T> that is held in memory. Open() reads the header
+// and locates the offset table without decoding any elements, after which
+// Read() decodes any single element in constant time, independent of the
+// elements before it.
+//
+// Elements are decoded without session state, so arrays whose elements hold
+// string definitions or references, shared objects, or chunk references cannot
+// be read through a view.
+//
+// The view does not copy the buffer, which must outlive it. Read() does not
+// modify the view, so different elements may be decoded concurrently from
+// multiple threads, for example to decode a large array in parallel.
+//
+// Example:
+//
+//  IndexedArrayView<Record> view;
+//  auto status = view.Open(data, size);
+//  if (status) {
+//    Record record;
+//    status = view.Read(view.size() / 2, &record);
+//  }
+//
+template <typename T>
+class IndexedArrayView {
+ public:
+  IndexedArrayView() = default;
+
+  // Opens the indexed array encoded at the start of the given buffer. Returns
+  // ErrorStatus::UnexpectedEncodingType if the buffer does not start with an
+  // indexed array and ErrorStatus::InvalidContainerLength if the offset table
+  // is malformed.
+  Status<void> Open(const void* data, std::size_t size) {
+    count_ = 0;
+
+    PedanticBufferReader reader{data, size};
+    std::uint8_t prefix_byte = 0;
+    auto status = reader.Read(&prefix_byte);
+    if (!status)
+      return status;
+    else if (static_cast<EncodingByte>(prefix_byte) !=
+             EncodingByte::IndexedArray)
+      return ErrorStatus::UnexpectedEncodingType;
+
+    SizeType count = 0;
+    status = Encoding<SizeType>::Read(&count, &reader);
+    if (!status)
+      return status;
+
+    auto width = detail::ReadOffsetTableHeader(count, &reader);
+    if (!width)
+      return width.error();
+
+    const void* offsets = nullptr;
+    status = reader.Borrow(&offsets, count * width.get());
+    if (!status)
+      return status;
+
+    offsets_ = static_cast<const std::uint8_t*>(offsets);
+    width_ = width.get();
+    elements_ = static_cast<const std::uint8_t*>(data) +
+                (reader.capacity() - reader.remaining());
+    elements_size_ = reader.remaining();
+    count_ = count;
+    return {};
+  }
+
+  // Decodes the element at |index| into |value|. Returns
+  // ErrorStatus::InvalidContainerLength if |index| is out of range or the
+  // element does not occupy exactly the bytes given by the offset table.
+  Status<void> Read(std::size_t index, T* value) const {
+    if (index >= count_)
+      return ErrorStatus::InvalidContainerLength;
+
+    const bool last = index + 1 == count_;
+    const std::uint64_t begin = OffsetAt(index);
+    const std::uint64_t end = last ? elements_size_ : OffsetAt(index + 1);
+    if (begin > end || end > elements_size_)
+      return ErrorStatus::InvalidContainerLength;
+
+    PedanticBufferReader reader{elements_ + begin,
+                                static_cast<std::size_t>(end - begin)};
+    auto status = Encoding<T>::Read(value, &reader);
+    if (!status)
+      return status;
+    else if (!last && !reader.empty())
+      return ErrorStatus::InvalidContainerLength;
+
+    return {};
+  }
+
+  // Returns the number of elements in the array.
+  std::size_t size() const { return count_; }
+
+  // Returns true if the array has no elements or no array has been opened.
+  bool empty() const { return count_ == 0; }
+
+ private:
+  std::uint64_t OffsetAt(std::size_t index) const {
+    const std::uint8_t* data = offsets_ + index * width_;
+    if (width_ == sizeof(std::uint32_t)) {
+      std::uint32_t offset;
+      std::memcpy(&offset, data, sizeof(offset));
+      return HostEndian<std::uint32_t>::FromLittle(offset);
+    } else {
+      std::uint64_t offset;
+      std::memcpy(&offset, data, sizeof(offset));
+      return HostEndian<std::uint64_t>::FromLittle(offset);
+    }
+  }
+
+  const std::uint8_t* offsets_{nullptr};
+  std::size_t width_{0};
+  const std::uint8_t* elements_{nullptr};
+  std::size_t elements_size_{0};
+  std::size_t count_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_INDEXED_ARRAY_VIEW_H_
@@ -0,0 +1,326 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_H_
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include <nop/status.h>
+
+namespace nop {
+
+// Base type for operations submitted to an IoUring. The address of the
+// operation is used as the submission user data, and Complete() is called with
+// the completion result when the operation finishes: the number of bytes
+// transferred or a negative errno value. An operation must remain valid until
+// it is completed.
+class IoUringOperation {
+ public:
+  virtual void Complete(int result) = 0;
+
+ protected:
+  ~IoUringOperation() = default;
+};
+
+// IoUring is a minimal wrapper around a Linux io_uring instance, using the raw
+// system call interface so that no additional library is required. Operations
+// are queued with PrepareWrite() and PrepareRead() and handed to the kernel in
+// batches by Submit(). ProcessCompletions() dispatches finished operations to
+// their IoUringOperation. A single thread may drive any number of fds through
+// one ring.
+//
+// IoUring is not thread safe.
+class IoUring {
+ public:
+  IoUring() = default;
+  IoUring(const IoUring&) = delete;
+  IoUring(IoUring&& other) { *this = std::move(other); }
+
+  ~IoUring() { Clear(); }
+
+  IoUring& operator=(const IoUring&) = delete;
+  IoUring& operator=(IoUring&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(ring_fd_, other.ring_fd_);
+      std::swap(sq_, other.sq_);
+      std::swap(cq_, other.cq_);
+      std::swap(sqes_, other.sqes_);
+      std::swap(sq_ring_size_, other.sq_ring_size_);
+      std::swap(cq_ring_size_, other.cq_ring_size_);
+      std::swap(sqes_size_, other.sqes_size_);
+      std::swap(sqe_tail_, other.sqe_tail_);
+      std::swap(sqe_submitted_, other.sqe_submitted_);
+    }
+    return *this;
+  }
+
+  // Creates the ring with room for at least |entries| queued submissions.
+  Status<void> Setup(unsigned entries) {
+    Clear();
+
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    const int ring_fd = ::syscall(__NR_io_uring_setup, entries, &params);
+    if (ring_fd < 0)
+      return ErrorStatus::SystemError;
+    ring_fd_ = ring_fd;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+    void* sq_ring = Map(sq_ring_size_, IORING_OFF_SQ_RING);
+    if (!sq_ring)
+      return Fail();
+
+    void* cq_ring = sq_ring;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+      cq_ring = Map(cq_ring_size_, IORING_OFF_CQ_RING);
+      if (!cq_ring) {
+        ::munmap(sq_ring, sq_ring_size_);
+        return Fail();
+      }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = Map(sqes_size_, IORING_OFF_SQES);
+    if (!sqes) {
+      if (cq_ring != sq_ring)
+        ::munmap(cq_ring, cq_ring_size_);
+      ::munmap(sq_ring, sq_ring_size_);
+      return Fail();
+    }
+
+    std::uint8_t* sq_base = static_cast<std::uint8_t*>(sq_ring);
+    sq_.ring = sq_ring;
+    sq_.head = reinterpret_cast<unsigned*>(sq_base + params.sq_off.head);
+    sq_.tail = reinterpret_cast<unsigned*>(sq_base + params.sq_off.tail);
+    sq_.mask = *reinterpret_cast<unsigned*>(sq_base + params.sq_off.ring_mask);
+    sq_.entries = params.sq_entries;
+    sq_.array = reinterpret_cast<unsigned*>(sq_base + params.sq_off.array);
+
+    std::uint8_t* cq_base = static_cast<std::uint8_t*>(cq_ring);
+    cq_.ring = cq_ring;
+    cq_.head = reinterpret_cast<unsigned*>(cq_base + params.cq_off.head);
+    cq_.tail = reinterpret_cast<unsigned*>(cq_base + params.cq_off.tail);
+    cq_.mask = *reinterpret_cast<unsigned*>(cq_base + params.cq_off.ring_mask);
+    cq_.cqes =
+        reinterpret_cast<struct io_uring_cqe*>(cq_base + params.cq_off.cqes);
+
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+    sqe_tail_ = sqe_submitted_ = *sq_.tail;
+    return {};
+  }
+
+  void Clear() {
+    if (sqes_)
+      ::munmap(sqes_, sqes_size_);
+    if (cq_.ring && cq_.ring != sq_.ring)
+      ::munmap(cq_.ring, cq_ring_size_);
+    if (sq_.ring)
+      ::munmap(sq_.ring, sq_ring_size_);
+    if (ring_fd_ >= 0)
+      ::close(ring_fd_);
+
+    ring_fd_ = -1;
+    sq_ = {};
+    cq_ = {};
+    sqes_ = nullptr;
+    sqe_tail_ = sqe_submitted_ = 0;
+  }
+
+  // Queues a write of |size| bytes from |data| to |fd| at the current file
+  // position. Returns false when the submission queue is full; call Submit()
+  // and try again.
+  bool PrepareWrite(int fd, const void* data, std::size_t size,
+                    IoUringOperation* operation) {
+    return Prepare(IORING_OP_WRITE, fd, data, size, kCurrentPosition,
+                   operation);
+  }
+
+  // Queues a write of |size| bytes from |data| to |fd| at |offset|, leaving
+  // the file position unchanged. Returns false when the submission queue is
+  // full.
+  bool PrepareWriteAt(int fd, const void* data, std::size_t size,
+                      std::uint64_t offset, IoUringOperation* operation) {
+    return Prepare(IORING_OP_WRITE, fd, data, size, offset, operation);
+  }
+
+  // Queues a read of up to |size| bytes from |fd| into |data| at the current
+  // file position. Returns false when the submission queue is full.
+  bool PrepareRead(int fd, void* data, std::size_t size,
+                   IoUringOperation* operation) {
+    return Prepare(IORING_OP_READ, fd, data, size, kCurrentPosition,
+                   operation);
+  }
+
+  // Queues a read of up to |size| bytes from |fd| into |data| at |offset|,
+  // leaving the file position unchanged. Returns false when the submission
+  // queue is full.
+  bool PrepareReadAt(int fd, void* data, std::size_t size,
+                     std::uint64_t offset, IoUringOperation* operation) {
+    return Prepare(IORING_OP_READ, fd, data, size, offset, operation);
+  }
+
+  // Hands all queued operations to the kernel, optionally waiting until at
+  // least |wait_count| completions are available.
+  Status<void> Submit(unsigned wait_count = 0) {
+    __atomic_store_n(sq_.tail, sqe_tail_, __ATOMIC_RELEASE);
+
+    while (true) {
+      const unsigned submit_count = sqe_tail_ - sqe_submitted_;
+      const unsigned flags = wait_count ? IORING_ENTER_GETEVENTS : 0;
+      const int ret = ::syscall(__NR_io_uring_enter, ring_fd_, submit_count,
+                                wait_count, flags, nullptr, 0);
+      if (ret < 0) {
+        if (errno == EINTR)
+          continue;  // Interrupted by signal.
+        else
+          return ErrorStatus::SystemError;
+      }
+
+      sqe_submitted_ += ret;
+      return {};
+    }
+  }
+
+  // Dispatches every available completion to its operation and returns the
+  // number of completions processed.
+  std::size_t ProcessCompletions() {
+    std::size_t count = 0;
+    unsigned head = *cq_.head;
+
+    while (head != __atomic_load_n(cq_.tail, __ATOMIC_ACQUIRE)) {
+      const struct io_uring_cqe& cqe = cq_.cqes[head & cq_.mask];
+      IoUringOperation* operation =
+          reinterpret_cast<IoUringOperation*>(cqe.user_data);
+      const int result = cqe.res;
+
+      // Release the entry before dispatching so that operations may prepare
+      // follow-up submissions from Complete().
+      head++;
+      __atomic_store_n(cq_.head, head, __ATOMIC_RELEASE);
+      operation->Complete(result);
+      count++;
+    }
+
+    return count;
+  }
+
+  bool is_valid() const { return ring_fd_ >= 0; }
+
+  // Returns the number of operations queued but not yet submitted.
+  std::size_t queued() const { return sqe_tail_ - sqe_submitted_; }
+
+ private:
+  struct SubmissionQueue {
+    void* ring;
+    unsigned* head;
+    unsigned* tail;
+    unsigned mask;
+    unsigned entries;
+    unsigned* array;
+  };
+
+  struct CompletionQueue {
+    void* ring;
+    unsigned* head;
+    unsigned* tail;
+    unsigned mask;
+    struct io_uring_cqe* cqes;
+  };
+
+  void* Map(std::size_t size, off_t offset) {
+    void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+    return address == MAP_FAILED ? nullptr : address;
+  }
+
+  Status<void> Fail() {
+    ::close(ring_fd_);
+    ring_fd_ = -1;
+    return ErrorStatus::SystemError;
+  }
+
+  // Offset that selects the current file position.
+  static constexpr std::uint64_t kCurrentPosition = ~std::uint64_t{0};
+
+  bool Prepare(std::uint8_t opcode, int fd, const void* data, std::size_t size,
+               std::uint64_t offset, IoUringOperation* operation) {
+    const unsigned head = __atomic_load_n(sq_.head, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= sq_.entries)
+      return false;
+
+    const unsigned index = sqe_tail_ & sq_.mask;
+    struct io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<std::uint64_t>(data);
+    sqe->len = static_cast<std::uint32_t>(size);
+    sqe->user_data = reinterpret_cast<std::uint64_t>(operation);
+
+    sq_.array[index] = index;
+    sqe_tail_++;
+    return true;
+  }
+
+  int ring_fd_{-1};
+  SubmissionQueue sq_{};
+  CompletionQueue cq_{};
+  struct io_uring_sqe* sqes_{nullptr};
+  std::size_t sq_ring_size_{0};
+  std::size_t cq_ring_size_{0};
+  std::size_t sqes_size_{0};
+  unsigned sqe_tail_{0};
+  unsigned sqe_submitted_{0};
+};
+
+// Messages exchanged by IoUringWriter and IoUringReader are framed with a
+// little-endian 32-bit length header, so that a reader can hand back complete
+// messages without decoding them.
+enum : std::size_t { kIoUringFrameHeaderSize = 4 };
+
+inline void StoreIoUringFrameHeader(std::uint8_t* header, std::uint32_t size) {
+  for (std::size_t i = 0; i < kIoUringFrameHeaderSize; i++)
+    header[i] = static_cast<std::uint8_t>(size >> (8 * i));
+}
+
+inline std::uint32_t LoadIoUringFrameHeader(const std::uint8_t* header) {
+  std::uint32_t size = 0;
+  for (std::size_t i = 0; i < kIoUringFrameHeaderSize; i++)
+    size |= static_cast<std::uint32_t>(header[i]) << (8 * i);
+  return size;
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_H_
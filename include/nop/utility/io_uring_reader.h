@@ -0,0 +1,152 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_READER_H_
+
+#include <errno.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/io_uring.h>
+
+namespace nop {
+
+// IoUringReader receives framed messages, as sent by IoUringWriter, from a UNIX
+// file descriptor through an IoUring without blocking. Reads complete into a
+// buffer owned by the reader, and NextMessage() hands back each complete
+// message as a BufferReader ready for use with Deserializer<BufferReader*>.
+//
+// Typical use from an event loop:
+//
+//   IoUringReader reader{&ring, fd};
+//   ...
+//   ring.Submit(1);
+//   ring.ProcessCompletions();
+//
+//   BufferReader message;
+//   while (true) {
+//     auto status = reader.NextMessage(&message);
+//     if (!status || !status.get())
+//       break;
+//
+//     Deserializer<BufferReader*> deserializer{&message};
+//     ...
+//   }
+//
+// When no complete message is buffered, NextMessage() queues a read on the ring
+// that reaches the kernel on the next IoUring::Submit(). The memory referenced
+// by a returned message remains valid until the next call to NextMessage().
+//
+// The reader does not take ownership of the fd or the ring, and must outlive
+// any read it has in flight.
+class IoUringReader : public IoUringOperation {
+ public:
+  IoUringReader(IoUring* ring, int fd, std::size_t buffer_size = 64 * 1024)
+      : ring_{ring}, fd_{fd}, buffer_(buffer_size) {}
+  IoUringReader(const IoUringReader&) = delete;
+  IoUringReader& operator=(const IoUringReader&) = delete;
+
+  // Sets |message| to the next complete message and returns true, or returns
+  // false if no complete message has been received yet. Returns
+  // ErrorStatus::ReadLimitReached once the peer has closed the fd and all
+  // complete messages have been consumed.
+  Status<bool> NextMessage(BufferReader* message) {
+    if (error_ != ErrorStatus::None)
+      return error_;
+
+    const std::size_t available = end_ - begin_;
+    if (available >= kIoUringFrameHeaderSize) {
+      const std::size_t payload_size =
+          LoadIoUringFrameHeader(&buffer_[begin_]);
+      const std::size_t frame_size = kIoUringFrameHeaderSize + payload_size;
+      if (available >= frame_size) {
+        *message = BufferReader{&buffer_[begin_ + kIoUringFrameHeaderSize],
+                                payload_size};
+        begin_ += frame_size;
+        return true;
+      }
+
+      // Grow the buffer to fit frames larger than its current size. The buffer
+      // must not move while a read into it is in flight.
+      if (frame_size > buffer_.size() && !in_flight_)
+        buffer_.resize(frame_size);
+    }
+
+    if (closed_)
+      return ErrorStatus::ReadLimitReached;
+
+    if (!in_flight_) {
+      auto status = Arm();
+      if (!status)
+        return status.error();
+    }
+    return false;
+  }
+
+  void Complete(int result) override {
+    in_flight_ = false;
+    if (result > 0)
+      end_ += result;
+    else if (result == 0)
+      closed_ = true;
+    else if (result != -EINTR && result != -EAGAIN)
+      error_ = ErrorStatus::IOError;
+  }
+
+ private:
+  // Moves any partial message to the start of the buffer and queues a read to
+  // fill the remaining space. Called only between messages, so no message
+  // handed out remains in use.
+  Status<void> Arm() {
+    if (begin_ != 0) {
+      std::memmove(&buffer_[0], &buffer_[begin_], end_ - begin_);
+      end_ -= begin_;
+      begin_ = 0;
+    }
+
+    std::uint8_t* data = &buffer_[end_];
+    const std::size_t size = buffer_.size() - end_;
+    if (!ring_->PrepareRead(fd_, data, size, this)) {
+      auto status = ring_->Submit();
+      if (!status || !ring_->PrepareRead(fd_, data, size, this)) {
+        error_ = ErrorStatus::SystemError;
+        return error_;
+      }
+    }
+
+    in_flight_ = true;
+    return {};
+  }
+
+  IoUring* ring_;
+  int fd_;
+  std::vector<std::uint8_t> buffer_;
+  std::size_t begin_{0};
+  std::size_t end_{0};
+  bool in_flight_{false};
+  bool closed_{false};
+  ErrorStatus error_{ErrorStatus::None};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_READER_H_
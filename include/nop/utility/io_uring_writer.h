@@ -0,0 +1,179 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_WRITER_H_
+
+#include <errno.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/utility/io_uring.h>
+
+namespace nop {
+
+// IoUringWriter is a writer type that sends framed messages to a UNIX file
+// descriptor through an IoUring without blocking. Each top-level Write() by the
+// library-provided Serializer types produces one message: its bytes are
+// collected in a pending buffer and Flush() completes the frame header.
+//
+// At most one write per writer is in flight, which keeps messages in order on
+// stream sockets. Messages flushed while a write is in flight accumulate in the
+// pending buffer and are sent together by the next write, so a busy writer
+// coalesces many messages into each submission. Submissions are queued on the
+// ring and reach the kernel on the next IoUring::Submit().
+//
+// The writer does not take ownership of the fd or the ring, and must outlive
+// any write it has in flight. Errors reported by completions are returned from
+// subsequent calls to Flush().
+class IoUringWriter : public IoUringOperation {
+ public:
+  IoUringWriter(IoUring* ring, int fd) : ring_{ring}, fd_{fd} {}
+  IoUringWriter(const IoUringWriter&) = delete;
+  IoUringWriter& operator=(const IoUringWriter&) = delete;
+
+  Status<void> Prepare(std::size_t size) {
+    BeginFrame();
+    pending_.reserve(pending_.size() + size);
+    return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) {
+    BeginFrame();
+    pending_.push_back(byte);
+    return {};
+  }
+
+  Status<void> Write(const void* begin, const void* end) {
+    BeginFrame();
+    pending_.insert(pending_.end(), static_cast<const std::uint8_t*>(begin),
+                    static_cast<const std::uint8_t*>(end));
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    BeginFrame();
+    pending_.insert(pending_.end(), padding_bytes, padding_value);
+    return {};
+  }
+
+  // Completes the current message and queues it for sending.
+  Status<void> Flush() {
+    if (error_ != ErrorStatus::None)
+      return error_;
+
+    if (frame_open_) {
+      const std::size_t payload_size =
+          pending_.size() - frame_offset_ - kIoUringFrameHeaderSize;
+      StoreIoUringFrameHeader(&pending_[frame_offset_],
+                              static_cast<std::uint32_t>(payload_size));
+      frame_open_ = false;
+    }
+
+    if (!in_flight_ && !pending_.empty())
+      return Start();
+    else
+      return {};
+  }
+
+  void Complete(int result) override {
+    in_flight_ = false;
+    if (result < 0 && result != -EINTR && result != -EAGAIN) {
+      error_ = ErrorStatus::IOError;
+      return;
+    } else if (result == 0) {
+      error_ = ErrorStatus::WriteLimitReached;
+      return;
+    }
+
+    if (result > 0)
+      offset_ += result;
+    if (offset_ < sending_.size()) {
+      SubmitSending();
+      return;
+    }
+
+    sending_.clear();
+    offset_ = 0;
+
+    // Send messages that completed while the write was in flight.
+    if (!pending_.empty() && !frame_open_)
+      Start();
+  }
+
+  // Returns true when no output remains to be sent.
+  bool idle() const { return !in_flight_ && pending_.empty(); }
+
+  Status<void> status() const {
+    if (error_ != ErrorStatus::None)
+      return error_;
+    else
+      return {};
+  }
+
+ private:
+  void BeginFrame() {
+    if (!frame_open_) {
+      frame_offset_ = pending_.size();
+      pending_.insert(pending_.end(), kIoUringFrameHeaderSize, 0);
+      frame_open_ = true;
+    }
+  }
+
+  // Moves the pending output to the sending buffer and queues it. The buffers
+  // are swapped, rather than reallocated, so both keep their capacity.
+  Status<void> Start() {
+    std::swap(sending_, pending_);
+    offset_ = 0;
+    return SubmitSending();
+  }
+
+  Status<void> SubmitSending() {
+    const std::uint8_t* data = sending_.data() + offset_;
+    const std::size_t size = sending_.size() - offset_;
+
+    // Make room by handing queued operations to the kernel if necessary.
+    if (!ring_->PrepareWrite(fd_, data, size, this)) {
+      auto status = ring_->Submit();
+      if (!status || !ring_->PrepareWrite(fd_, data, size, this)) {
+        error_ = ErrorStatus::SystemError;
+        return error_;
+      }
+    }
+
+    in_flight_ = true;
+    return {};
+  }
+
+  IoUring* ring_;
+  int fd_;
+  std::vector<std::uint8_t> pending_;
+  std::vector<std::uint8_t> sending_;
+  std::size_t offset_{0};
+  std::size_t frame_offset_{0};
+  bool frame_open_{false};
+  bool in_flight_{false};
+  ErrorStatus error_{ErrorStatus::None};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_WRITER_H_
@@ -0,0 +1,419 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_JSON_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_JSON_WRITER_H_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <nop/base/skip.h>
+#include <nop/status.h>
+#include <nop/utility/encoding_tokenizer.h>
+
+namespace nop {
+
+//
+// Schema-less JSON transcoder.
+//
+// JsonWriter renders the tokens of an EncodingTokenizer as JSON, appending to a
+// string as the tokens arrive. Each top-level value is written on its own line,
+// so a buffer of several values becomes JSON Lines. Values are rendered as
+// follows:
+//
+//   Nil                  null
+//   Integers and floats  numbers; infinities and NaN are rendered as null
+//   String               a string; bytes are copied as they are, so strings
+//                        that are not valid UTF-8 produce invalid JSON
+//   Binary               a base64 string
+//   Array, Structure     an array
+//   Map                  an object; keys that are not strings are rendered as
+//                        JSON and then quoted
+//   Table                an object keyed by entry id; cleared entries are null
+//   Variant              {"variant": index, "value": value}
+//   Handle               {"type": type, "handle": reference}
+//   Error                {"error": code}
+//   String reference     {"$string": id}
+//   Object reference     {"$ref": id}
+//   Packed array         {"packed": count, "bytes": base64 encoding}
+//   Chunk manifest       {"chunked": length, "bytes": base64 encoding}
+//
+// Object definitions are rendered as the defined value.
+//
+
+namespace detail {
+
+// Returns true if any of the eight bytes at |data| must be escaped in a JSON
+// string: control characters, quotation marks, and reverse solidus.
+inline bool JsonEscapeInWord(const std::uint8_t* data) {
+  const std::uint64_t kOnes = 0x0101010101010101ull;
+  const std::uint64_t kHighs = 0x8080808080808080ull;
+
+  std::uint64_t word;
+  std::memcpy(&word, data, sizeof(word));
+  const std::uint64_t quotes = word ^ (kOnes * '"');
+  const std::uint64_t solidi = word ^ (kOnes * '\\');
+  return (((word - kOnes * 0x20) & ~word) | ((quotes - kOnes) & ~quotes) |
+          ((solidi - kOnes) & ~solidi)) &
+         kHighs;
+}
+
+inline bool JsonEscapeByte(std::uint8_t byte) {
+  return byte < 0x20 || byte == '"' || byte == '\\';
+}
+
+// Appends |size| bytes at |data| as a JSON string. Runs of bytes that need no
+// escaping are found eight bytes at a time and appended in one call.
+inline void AppendJsonString(std::string* json, const std::uint8_t* data,
+                             std::size_t size) {
+  json->push_back('"');
+  std::size_t begin = 0;
+  while (true) {
+    std::size_t end = begin;
+    while (size - end >= 8 && !JsonEscapeInWord(data + end))
+      end += 8;
+    while (end < size && !JsonEscapeByte(data[end]))
+      end++;
+
+    json->append(reinterpret_cast<const char*>(data + begin), end - begin);
+    if (end == size)
+      break;
+
+    const std::uint8_t byte = data[end];
+    switch (byte) {
+      case '"':
+        json->append("\\\"");
+        break;
+      case '\\':
+        json->append("\\\\");
+        break;
+      case '\b':
+        json->append("\\b");
+        break;
+      case '\f':
+        json->append("\\f");
+        break;
+      case '\n':
+        json->append("\\n");
+        break;
+      case '\r':
+        json->append("\\r");
+        break;
+      case '\t':
+        json->append("\\t");
+        break;
+      default: {
+        char escape[8];
+        std::snprintf(escape, sizeof(escape), "\\u%04x", byte);
+        json->append(escape);
+        break;
+      }
+    }
+    begin = end + 1;
+  }
+  json->push_back('"');
+}
+
+inline void AppendBase64(std::string* json, const std::uint8_t* data,
+                         std::size_t size) {
+  static const char kAlphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  json->push_back('"');
+  std::size_t i = 0;
+  for (; size - i >= 3; i += 3) {
+    const std::uint32_t bits = (data[i] << 16) | (data[i + 1] << 8) |
+                               data[i + 2];
+    const char group[4] = {kAlphabet[bits >> 18], kAlphabet[(bits >> 12) & 63],
+                           kAlphabet[(bits >> 6) & 63], kAlphabet[bits & 63]};
+    json->append(group, sizeof(group));
+  }
+  if (size - i == 1) {
+    const std::uint32_t bits = data[i] << 16;
+    const char group[4] = {kAlphabet[bits >> 18], kAlphabet[(bits >> 12) & 63],
+                           '=', '='};
+    json->append(group, sizeof(group));
+  } else if (size - i == 2) {
+    const std::uint32_t bits = (data[i] << 16) | (data[i + 1] << 8);
+    const char group[4] = {kAlphabet[bits >> 18], kAlphabet[(bits >> 12) & 63],
+                           kAlphabet[(bits >> 6) & 63], '='};
+    json->append(group, sizeof(group));
+  }
+  json->push_back('"');
+}
+
+}  // namespace detail
+
+class JsonWriter {
+ public:
+  explicit JsonWriter(std::string* json) : json_{json} {}
+
+  // Appends the JSON for |token|, which must be the next token returned by the
+  // tokenizer.
+  Status<void> Write(const Token& token) {
+    switch (token.type) {
+      case TokenType::End:
+      case TokenType::ObjectDefinition:
+        return {};
+
+      case TokenType::Nil:
+        BeginValue();
+        json_->append("null");
+        return EndValue();
+
+      case TokenType::Integer:
+        BeginValue();
+        json_->append(std::to_string(token.integer));
+        return EndValue();
+
+      case TokenType::UnsignedInteger:
+        BeginValue();
+        json_->append(std::to_string(token.unsigned_integer));
+        return EndValue();
+
+      case TokenType::Float:
+        BeginValue();
+        AppendFloat(token);
+        return EndValue();
+
+      case TokenType::String:
+        BeginValue();
+        if (depth_ != 0 && stack_[depth_ - 1].kind == Kind::Map &&
+            stack_[depth_ - 1].index % 2 == 0) {
+          stack_[depth_ - 1].key_is_string = true;
+        }
+        detail::AppendJsonString(json_, token.data, token.size);
+        return EndValue();
+
+      case TokenType::Binary:
+        BeginValue();
+        detail::AppendBase64(json_, token.data, token.size);
+        return EndValue();
+
+      case TokenType::StringReference:
+      case TokenType::ObjectReference:
+        BeginValue();
+        json_->append(token.type == TokenType::StringReference
+                          ? "{\"$string\":"
+                          : "{\"$ref\":");
+        json_->append(std::to_string(token.id));
+        json_->push_back('}');
+        return EndValue();
+
+      case TokenType::PackedArray:
+        BeginValue();
+        json_->append("{\"packed\":");
+        json_->append(std::to_string(token.count));
+        json_->append(",\"bytes\":");
+        detail::AppendBase64(json_, token.data, token.size);
+        json_->push_back('}');
+        return EndValue();
+
+      case TokenType::BitArray:
+        BeginValue();
+        json_->append("{\"bits\":");
+        json_->append(std::to_string(token.count));
+        json_->append(",\"bytes\":");
+        detail::AppendBase64(json_, token.data, token.size);
+        json_->push_back('}');
+        return EndValue();
+
+      case TokenType::ChunkManifest:
+        BeginValue();
+        json_->append("{\"chunked\":");
+        json_->append(std::to_string(token.count));
+        json_->append(",\"bytes\":");
+        detail::AppendBase64(json_, token.data, token.size);
+        json_->push_back('}');
+        return EndValue();
+
+      case TokenType::BeginArray:
+      case TokenType::BeginStructure:
+        return Push('[', Kind::Array);
+      case TokenType::BeginMap:
+        return Push('{', Kind::Map);
+      case TokenType::BeginTable:
+        return Push('{', Kind::Table);
+      case TokenType::BeginVariant:
+        return Push('{', Kind::Variant);
+      case TokenType::BeginHandle:
+        return Push('{', Kind::Handle);
+      case TokenType::BeginError:
+        return Push('{', Kind::Error);
+
+      case TokenType::TableEntry:
+        if (depth_ == 0 || stack_[depth_ - 1].kind != Kind::Table)
+          return ErrorStatus::ProtocolError;
+        if (stack_[depth_ - 1].index++ != 0)
+          json_->push_back(',');
+        json_->push_back('"');
+        json_->append(std::to_string(token.id));
+        json_->append("\":");
+        if (token.size == 0)
+          json_->append("null");
+        return {};
+
+      case TokenType::EndArray:
+      case TokenType::EndStructure:
+        return Pop(']');
+      case TokenType::EndMap:
+      case TokenType::EndTable:
+      case TokenType::EndVariant:
+      case TokenType::EndHandle:
+      case TokenType::EndError:
+        return Pop('}');
+    }
+    return ErrorStatus::ProtocolError;
+  }
+
+ private:
+  enum class Kind { Array, Map, Table, Variant, Handle, Error };
+
+  struct Frame {
+    Kind kind;
+    std::size_t index;
+    std::size_t key_start;
+    bool key_is_string;
+  };
+
+  // Writes the separator or label that precedes a value in the enclosing
+  // container.
+  void BeginValue() {
+    if (depth_ == 0)
+      return;
+
+    Frame& frame = stack_[depth_ - 1];
+    switch (frame.kind) {
+      case Kind::Array:
+        if (frame.index++ != 0)
+          json_->push_back(',');
+        break;
+
+      case Kind::Map:
+        if (frame.index % 2 == 0) {
+          if (frame.index != 0)
+            json_->push_back(',');
+          frame.key_start = json_->size();
+          frame.key_is_string = false;
+        }
+        break;
+
+      case Kind::Table:
+        break;
+
+      case Kind::Variant:
+        json_->append(frame.index++ == 0 ? "\"variant\":" : ",\"value\":");
+        break;
+
+      case Kind::Handle:
+        json_->append(frame.index++ == 0 ? "\"type\":" : ",\"handle\":");
+        break;
+
+      case Kind::Error:
+        frame.index++;
+        json_->append("\"error\":");
+        break;
+    }
+  }
+
+  // Finishes a value in the enclosing container.
+  Status<void> EndValue() {
+    if (depth_ == 0) {
+      json_->push_back('\n');
+      return {};
+    }
+
+    Frame& frame = stack_[depth_ - 1];
+    if (frame.kind == Kind::Map) {
+      if (frame.index % 2 == 0 && !frame.key_is_string) {
+        const std::string key = json_->substr(frame.key_start);
+        json_->resize(frame.key_start);
+        detail::AppendJsonString(
+            json_, reinterpret_cast<const std::uint8_t*>(key.data()),
+            key.size());
+      }
+      if (frame.index++ % 2 == 0)
+        json_->push_back(':');
+    }
+    return {};
+  }
+
+  Status<void> Push(char open, Kind kind) {
+    if (depth_ == kMaxSkipDepth)
+      return ErrorStatus::UnexpectedEncodingType;
+
+    BeginValue();
+    json_->push_back(open);
+    stack_[depth_++] = {kind, 0, 0, false};
+    return {};
+  }
+
+  Status<void> Pop(char close) {
+    if (depth_ == 0)
+      return ErrorStatus::ProtocolError;
+
+    depth_--;
+    json_->push_back(close);
+    return EndValue();
+  }
+
+  void AppendFloat(const Token& token) {
+    if (!std::isfinite(token.real)) {
+      json_->append("null");
+      return;
+    }
+
+    // Enough digits to round trip the original precision.
+    char number[32];
+    if (token.prefix == EncodingByte::F32)
+      std::snprintf(number, sizeof(number), "%.9g", token.real);
+    else
+      std::snprintf(number, sizeof(number), "%.17g", token.real);
+    json_->append(number);
+  }
+
+  std::string* json_;
+  Frame stack_[kMaxSkipDepth];
+  std::size_t depth_{0};
+};
+
+// Transcodes every value in the given buffer to JSON, one value per line,
+// appending to |json|.
+inline Status<void> EncodingToJson(const void* data, std::size_t size,
+                                   std::string* json) {
+  EncodingTokenizer tokenizer{data, size};
+  JsonWriter writer{json};
+  Token token;
+  do {
+    auto status = tokenizer.Next(&token);
+    if (!status)
+      return status;
+
+    status = writer.Write(token);
+    if (!status)
+      return status;
+  } while (token.type != TokenType::End);
+  return {};
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_JSON_WRITER_H_
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_KEY_INDEX_MAP_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_KEY_INDEX_MAP_H_
+
+#include <cstddef>
+
+namespace nop {
+
+// KeyIndexMap maps a fixed set of unique integral keys to their positions in
+// the list the map is constructed from. It is intended to be built at compile
+// time from the ids of a set of types, such as table entries or interface
+// methods, to find the type matching a runtime id without testing each one in
+// turn.
+//
+// The keys are sorted on construction. Find() indexes the sorted keys directly
+// when they are contiguous and performs a binary search otherwise.
+//
+// Example:
+//
+//  static constexpr KeyIndexMap<std::uint64_t, 3> kMap{{100, 7, 42}};
+//  static_assert(kMap.Find(42) == 2, "Wrong index!");
+//  static_assert(kMap.Find(8) == 3, "Unexpected key!");
+//
+template <typename Key, std::size_t Size>
+class KeyIndexMap {
+ public:
+  static_assert(Size > 0, "KeyIndexMap must have at least one key.");
+
+  constexpr KeyIndexMap(const Key (&keys)[Size])
+      : keys_{}, indices_{}, contiguous_{true} {
+    for (std::size_t i = 0; i < Size; i++) {
+      keys_[i] = keys[i];
+      indices_[i] = i;
+    }
+
+    for (std::size_t i = 1; i < Size; i++) {
+      for (std::size_t j = i; j > 0 && keys_[j] < keys_[j - 1]; j--) {
+        const Key key = keys_[j];
+        keys_[j] = keys_[j - 1];
+        keys_[j - 1] = key;
+
+        const std::size_t index = indices_[j];
+        indices_[j] = indices_[j - 1];
+        indices_[j - 1] = index;
+      }
+    }
+
+    for (std::size_t i = 1; i < Size; i++) {
+      if (keys_[i] != keys_[i - 1] + 1)
+        contiguous_ = false;
+    }
+  }
+
+  // Returns the position of |key| in the original key list, or Size if |key|
+  // is not in the map.
+  constexpr std::size_t Find(Key key) const {
+    if (contiguous_) {
+      if (key < keys_[0] || key > keys_[Size - 1])
+        return Size;
+      else
+        return indices_[static_cast<std::size_t>(key - keys_[0])];
+    }
+
+    std::size_t begin = 0;
+    std::size_t end = Size;
+    while (begin < end) {
+      const std::size_t middle = begin + (end - begin) / 2;
+      if (keys_[middle] < key)
+        begin = middle + 1;
+      else
+        end = middle;
+    }
+    return begin < Size && keys_[begin] == key ? indices_[begin] : Size;
+  }
+
+  // Returns true if the keys form a contiguous range.
+  constexpr bool contiguous() const { return contiguous_; }
+
+ private:
+  Key keys_[Size];
+  std::size_t indices_[Size];
+  bool contiguous_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_KEY_INDEX_MAP_H_
@@ -0,0 +1,236 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_LZ_CODEC_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_LZ_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <nop/status.h>
+
+namespace nop {
+
+//
+// LzCodec is a small, dependency free LZ77 block codec used by default with
+// CompressingWriter and DecompressingReader. It trades compression ratio for
+// speed in the same way as LZ4, whose block layout it follows:
+//
+// +-------+---//---+----------+---//---+----------+
+// | TOKEN | LITLEN | LITERALS | OFFSET | MATCHLEN | ...
+// +-------+---//---+----------+---//---+----------+
+//
+// The high nibble of the token is the literal count and the low nibble is the
+// match length minus kMinMatch. A nibble of 15 continues in extension bytes
+// that are summed until a byte other than 255. Each match copies from OFFSET
+// bytes back in the output, stored as two little-endian bytes. The last
+// sequence of a block has only literals.
+//
+// Other codecs, such as LZ4 or zstd, may be used with the adapters by providing
+// a type with the same three static methods. For example:
+//
+//  struct Lz4Codec {
+//    static std::size_t MaxCompressedSize(std::size_t size) {
+//      return LZ4_compressBound(size);
+//    }
+//    static Status<std::size_t> Compress(const std::uint8_t* source,
+//                                        std::size_t size,
+//                                        std::uint8_t* destination,
+//                                        std::size_t capacity) {
+//      const int result = LZ4_compress_default(...);
+//      if (result <= 0)
+//        return ErrorStatus::WriteLimitReached;
+//      return static_cast<std::size_t>(result);
+//    }
+//    static Status<std::size_t> Decompress(...);  // LZ4_decompress_safe().
+//  };
+//
+//  CompressingWriter<FdWriter, Lz4Codec> writer{&fd_writer};
+//
+struct LzCodec {
+  enum : std::size_t {
+    kMinMatch = 4,
+    kMaxOffset = 65535,
+    kHashBits = 12,
+  };
+
+  // Returns the largest possible compressed size of |size| input bytes.
+  static constexpr std::size_t MaxCompressedSize(std::size_t size) {
+    return size + size / 255 + 16;
+  }
+
+  // Compresses |size| bytes at |source| into |destination|, which must hold at
+  // least MaxCompressedSize(size) bytes. Returns the compressed size.
+  static Status<std::size_t> Compress(const std::uint8_t* source,
+                                      std::size_t size,
+                                      std::uint8_t* destination,
+                                      std::size_t capacity) {
+    if (capacity < MaxCompressedSize(size))
+      return ErrorStatus::WriteLimitReached;
+
+    std::uint32_t table[1 << kHashBits] = {};
+    std::uint8_t* out = destination;
+    std::size_t anchor = 0;
+    std::size_t index = 0;
+
+    // Matches are searched while a whole match key fits in the input; the
+    // input after the last match is emitted as literals.
+    while (size >= kMinMatch && index <= size - kMinMatch) {
+      const std::uint32_t key = Load32(source + index);
+      const std::uint32_t hash = (key * 2654435761u) >> (32 - kHashBits);
+      const std::size_t candidate = table[hash];
+      table[hash] = static_cast<std::uint32_t>(index);
+
+      if (candidate >= index || index - candidate > kMaxOffset ||
+          Load32(source + candidate) != key) {
+        index++;
+        continue;
+      }
+
+      std::size_t length = kMinMatch;
+      while (index + length < size &&
+             source[candidate + length] == source[index + length]) {
+        length++;
+      }
+
+      std::uint8_t* token = out;
+      out = WriteSequence(source + anchor, index - anchor, out);
+      const std::size_t offset = index - candidate;
+      *out++ = static_cast<std::uint8_t>(offset);
+      *out++ = static_cast<std::uint8_t>(offset >> 8);
+      *token |= Nibble(length - kMinMatch);
+      out = WriteLength(length - kMinMatch, out);
+
+      index += length;
+      anchor = index;
+    }
+
+    out = WriteSequence(source + anchor, size - anchor, out);
+    return static_cast<std::size_t>(out - destination);
+  }
+
+  // Decompresses |size| bytes at |source| into |destination|, never writing
+  // more than |capacity| bytes. Returns the decompressed size, or
+  // ErrorStatus::ProtocolError if the input is not a valid block.
+  static Status<std::size_t> Decompress(const std::uint8_t* source,
+                                        std::size_t size,
+                                        std::uint8_t* destination,
+                                        std::size_t capacity) {
+    const std::uint8_t* in = source;
+    const std::uint8_t* const in_end = source + size;
+    std::size_t produced = 0;
+
+    while (in != in_end) {
+      const std::uint8_t token = *in++;
+
+      std::size_t literals = token >> 4;
+      if (!ReadLength(&in, in_end, &literals))
+        return ErrorStatus::ProtocolError;
+      if (literals > static_cast<std::size_t>(in_end - in) ||
+          literals > capacity - produced) {
+        return ErrorStatus::ProtocolError;
+      }
+      std::memcpy(destination + produced, in, literals);
+      in += literals;
+      produced += literals;
+
+      // The last sequence ends after its literals.
+      if (in == in_end)
+        break;
+
+      if (in_end - in < 2)
+        return ErrorStatus::ProtocolError;
+      const std::size_t offset = in[0] | (static_cast<std::size_t>(in[1]) << 8);
+      in += 2;
+      if (offset == 0 || offset > produced)
+        return ErrorStatus::ProtocolError;
+
+      std::size_t length = token & 0x0f;
+      if (!ReadLength(&in, in_end, &length))
+        return ErrorStatus::ProtocolError;
+      length += kMinMatch;
+      if (length > capacity - produced)
+        return ErrorStatus::ProtocolError;
+
+      // Matches may overlap their own output, so copy forward byte by byte.
+      std::uint8_t* match = destination + produced;
+      const std::uint8_t* from = match - offset;
+      for (std::size_t i = 0; i < length; i++)
+        match[i] = from[i];
+      produced += length;
+    }
+
+    return produced;
+  }
+
+ private:
+  static std::uint32_t Load32(const std::uint8_t* data) {
+    std::uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+
+  // Returns the token nibble of |length|.
+  static std::uint8_t Nibble(std::size_t length) {
+    return static_cast<std::uint8_t>(length < 15 ? length : 15);
+  }
+
+  // Writes the extension bytes of |length| when it does not fit in a nibble.
+  static std::uint8_t* WriteLength(std::size_t length, std::uint8_t* out) {
+    if (length < 15)
+      return out;
+
+    length -= 15;
+    while (length >= 255) {
+      *out++ = 255;
+      length -= 255;
+    }
+    *out++ = static_cast<std::uint8_t>(length);
+    return out;
+  }
+
+  // Writes a token with the literal count followed by the literals. The match
+  // nibble of the token is filled in by the caller when a match follows.
+  static std::uint8_t* WriteSequence(const std::uint8_t* literals,
+                                     std::size_t count, std::uint8_t* out) {
+    *out++ = static_cast<std::uint8_t>(Nibble(count) << 4);
+    out = WriteLength(count, out);
+    std::memcpy(out, literals, count);
+    return out + count;
+  }
+
+  // Adds the extension bytes of a length to |length|.
+  static bool ReadLength(const std::uint8_t** in, const std::uint8_t* in_end,
+                         std::size_t* length) {
+    if (*length != 15)
+      return true;
+
+    std::uint8_t byte = 0;
+    do {
+      if (*in == in_end)
+        return false;
+      byte = *(*in)++;
+      *length += byte;
+    } while (byte == 255);
+    return true;
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_LZ_CODEC_H_
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_MAPPED_FILE_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_MAPPED_FILE_READER_H_
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/types/handle.h>
+
+namespace nop {
+
+// MappedFileReader is a reader type that supports runtime deserialization from
+// a memory-mapped file. Like BufferReader, this reader only performs bounds
+// checks in the Ensure() method, which makes it safe for use with the
+// library-provided Deserializer types.
+//
+// The mapping is advised for sequential access when it is created. Each call
+// to Ensure() that reaches past the region already prefetched advises the
+// kernel to read ahead at least PrefetchSize bytes from the current position,
+// so that most calls to Ensure() do not enter the kernel.
+//
+// The reader maps the file given by the fd and does not take ownership of the
+// fd, which may be closed once the reader is constructed. Use is_mapped() to
+// determine whether mapping succeeded; readers that failed to map report
+// ErrorStatus::IOError from Ensure().
+template <std::size_t PrefetchSize = 1024 * 1024>
+class MappedFileReader {
+ public:
+  MappedFileReader() = default;
+  MappedFileReader(int fd) { Map(fd); }
+  MappedFileReader(const MappedFileReader&) = delete;
+  MappedFileReader(MappedFileReader&& other) { *this = std::move(other); }
+
+  ~MappedFileReader() { Unmap(); }
+
+  MappedFileReader& operator=(const MappedFileReader&) = delete;
+  MappedFileReader& operator=(MappedFileReader&& other) {
+    if (this != &other) {
+      Unmap();
+      std::swap(buffer_, other.buffer_);
+      std::swap(size_, other.size_);
+      std::swap(index_, other.index_);
+      std::swap(advised_, other.advised_);
+      std::swap(mapped_, other.mapped_);
+    }
+    return *this;
+  }
+
+  Status<void> Ensure(std::size_t size) {
+    if (!mapped_)
+      return ErrorStatus::IOError;
+    else if (size_ - index_ < size)
+      return ErrorStatus::ReadLimitReached;
+
+    if (index_ + size > advised_)
+      Prefetch(size);
+    return {};
+  }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    const std::size_t element_size = sizeof(T);
+    const std::size_t length = end - begin;
+    const std::size_t length_bytes = length * element_size;
+
+    std::memcpy(begin, &buffer_[index_], length_bytes);
+    index_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    index_ += padding_bytes;
+    return {};
+  }
+
+  // Stores a pointer to the next |size| bytes of the buffer in |data| and
+  // advances past them, allowing borrowed types to reference the input.
+  Status<void> Borrow(const void** data, std::size_t size) {
+    *data = &buffer_[index_];
+    index_ += size;
+    return {};
+  }
+
+  // Files do not carry handles; any handle reference is invalid.
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference /*handle_reference*/) {
+    return ErrorStatus::InvalidHandleReference;
+  }
+
+  bool is_mapped() const { return mapped_; }
+  bool empty() const { return index_ == size_; }
+
+  std::size_t remaining() const { return size_ - index_; }
+  std::size_t capacity() const { return size_; }
+
+ private:
+  void Map(int fd) {
+    struct stat stat_buf;
+    if (::fstat(fd, &stat_buf) < 0)
+      return;
+
+    const std::size_t size = static_cast<std::size_t>(stat_buf.st_size);
+    if (size > 0) {
+      void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (address == MAP_FAILED)
+        return;
+
+      ::madvise(address, size, MADV_SEQUENTIAL);
+      buffer_ = static_cast<const std::uint8_t*>(address);
+    }
+
+    size_ = size;
+    mapped_ = true;
+  }
+
+  void Unmap() {
+    if (buffer_)
+      ::munmap(const_cast<std::uint8_t*>(buffer_), size_);
+    buffer_ = nullptr;
+    size_ = 0;
+    index_ = 0;
+    advised_ = 0;
+    mapped_ = false;
+  }
+
+  // Advises the kernel that the region starting at the current position and
+  // covering at least |size| bytes will be needed soon.
+  void Prefetch(std::size_t size) {
+    const std::size_t page_size = static_cast<std::size_t>(::getpagesize());
+    const std::size_t begin = (index_ / page_size) * page_size;
+    const std::size_t end =
+        std::min(size_, index_ + std::max<std::size_t>(size, PrefetchSize));
+
+    ::madvise(const_cast<std::uint8_t*>(buffer_) + begin, end - begin,
+              MADV_WILLNEED);
+    advised_ = end;
+  }
+
+  const std::uint8_t* buffer_{nullptr};
+  std::size_t size_{0};
+  std::size_t index_{0};
+  std::size_t advised_{0};
+  bool mapped_{false};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_MAPPED_FILE_READER_H_
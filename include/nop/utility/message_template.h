@@ -0,0 +1,202 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_MESSAGE_TEMPLATE_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_MESSAGE_TEMPLATE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+
+#include <nop/base/encoding.h>
+#include <nop/base/max_encoded_size.h>
+#include <nop/base/patchable.h>
+#include <nop/status.h>
+#include <nop/utility/constexpr_buffer_writer.h>
+
+namespace nop {
+
+//
+// MessageTemplate<T, FieldCount> holds the encoding of a value of type T made
+// at compile time together with the offsets of the payloads of its
+// Patchable<U, Index> members, with Index in [0, FieldCount). Since patchable
+// fields always take their full width, any value of the fields may be stored
+// in place in a copy of the template, so sending a message of a fixed layout
+// becomes a copy of the template and a few stores instead of an encoding pass.
+//
+// Capacity is MaxEncodedSize<T> by default and must be given for types with
+// unbounded encodings, such as structures with strings.
+//
+// Example:
+//
+//  struct Heartbeat {
+//    std::uint32_t protocol_version;
+//    Patchable<std::uint64_t, 0> sequence;
+//    Patchable<std::uint32_t, 1> load;
+//    NOP_STRUCTURE(Heartbeat, protocol_version, sequence, load);
+//  };
+//
+//  constexpr MessageTemplate<Heartbeat, 2> kHeartbeat{Heartbeat{3, 0, 0}};
+//  static_assert(kHeartbeat.ok(), "Invalid heartbeat template.");
+//
+//  std::uint8_t buffer[kHeartbeat.size()];
+//  kHeartbeat.Instantiate(buffer, sequence, load);
+//  send(fd, buffer, sizeof(buffer), 0);
+//
+// Patch() stores the low-order bytes of the value in the width of the field,
+// so values should be of the type of the field they are stored in.
+//
+
+namespace detail {
+
+template <typename T, typename Enable = void>
+struct MessageTemplateCapacity {
+  enum : std::size_t { value = 0 };
+};
+template <typename T>
+struct MessageTemplateCapacity<T, std::enable_if_t<HasMaxEncodedSize<T>::value>>
+    : MaxEncodedSize<T> {};
+
+}  // namespace detail
+
+template <typename T, std::size_t FieldCount,
+          std::size_t Capacity = detail::MessageTemplateCapacity<T>::value>
+class MessageTemplate {
+  static_assert(Capacity > 0,
+                "The capacity of the template must be given for types without "
+                "a bounded encoded size.");
+
+ public:
+  // Encodes |value| and records the positions of its patchable fields. Every
+  // field index in [0, FieldCount) must be used exactly once; otherwise ok()
+  // is false and error() is ErrorStatus::InvalidMemberCount.
+  constexpr MessageTemplate(const T& value) {
+    TemplateWriter writer{bytes_, Capacity, offsets_, widths_};
+    auto status = Encoding<T>::Write(value, &writer);
+    if (!status) {
+      error_ = status.error();
+      return;
+    }
+
+    for (std::size_t i = 0; i < FieldCount; i++) {
+      if (widths_[i] == 0) {
+        error_ = ErrorStatus::InvalidMemberCount;
+        return;
+      }
+    }
+    size_ = writer.size();
+  }
+
+  constexpr bool ok() const { return error_ == ErrorStatus::None; }
+  constexpr ErrorStatus error() const { return error_; }
+
+  constexpr const std::uint8_t* data() const { return bytes_; }
+  constexpr std::size_t size() const { return size_; }
+
+  // Returns the offset and the width in bytes of the payload of a field.
+  constexpr std::size_t offset(std::size_t index) const {
+    return offsets_[index];
+  }
+  constexpr std::size_t width(std::size_t index) const {
+    return widths_[index];
+  }
+
+  // Copies the template to |buffer|, which must hold size() bytes.
+  void CopyTo(std::uint8_t* buffer) const {
+    std::memcpy(buffer, bytes_, size_);
+  }
+
+  // Stores |value| in the field with the given index of a copy of the
+  // template at |buffer|.
+  template <typename U>
+  void Patch(std::uint8_t* buffer, std::size_t index, U value) const {
+    static_assert(std::is_integral<U>::value,
+                  "Patched values must be of an integer type.");
+    const std::uint64_t bits = static_cast<std::uint64_t>(value);
+    std::uint8_t* field = buffer + offsets_[index];
+    for (std::size_t i = 0; i < widths_[index]; i++)
+      field[i] = static_cast<std::uint8_t>(bits >> (8 * i));
+  }
+
+  // Copies the template to |buffer| and stores |values| in the fields in index
+  // order.
+  template <typename... Values>
+  void Instantiate(std::uint8_t* buffer, Values... values) const {
+    static_assert(sizeof...(Values) == FieldCount,
+                  "A value must be given for every field of the template.");
+    CopyTo(buffer);
+    std::size_t index = 0;
+    (void)std::initializer_list<bool>{
+        (Patch(buffer, index++, values), false)...};
+  }
+
+ private:
+  // Writes into the template buffer and records the fields as they are
+  // marked by the patchable encodings.
+  class TemplateWriter {
+   public:
+    constexpr TemplateWriter(std::uint8_t* buffer, std::size_t size,
+                             std::size_t* offsets, std::size_t* widths)
+        : writer_{buffer, size}, offsets_{offsets}, widths_{widths} {}
+
+    constexpr Status<void> Prepare(std::size_t size) {
+      return writer_.Prepare(size);
+    }
+
+    constexpr Status<void> Write(std::uint8_t byte) {
+      return writer_.Write(byte);
+    }
+
+    template <typename U, typename Enable = EnableIfArithmetic<U>>
+    constexpr Status<void> Write(const U* begin, const U* end) {
+      return writer_.Write(begin, end);
+    }
+
+    constexpr Status<void> Skip(std::size_t padding_bytes,
+                                std::uint8_t padding_value = 0x00) {
+      return writer_.Skip(padding_bytes, padding_value);
+    }
+
+    constexpr Status<void> MarkField(std::size_t index, std::size_t width) {
+      if (index >= FieldCount || widths_[index] != 0)
+        return ErrorStatus::InvalidMemberCount;
+
+      offsets_[index] = writer_.size();
+      widths_[index] = width;
+      return {};
+    }
+
+    constexpr std::size_t size() const { return writer_.size(); }
+
+   private:
+    ConstexprBufferWriter writer_;
+    std::size_t* offsets_;
+    std::size_t* widths_;
+  };
+
+  std::uint8_t bytes_[Capacity]{};
+  std::size_t offsets_[FieldCount > 0 ? FieldCount : 1]{};
+  std::size_t widths_[FieldCount > 0 ? FieldCount : 1]{};
+  std::size_t size_{0};
+  ErrorStatus error_{ErrorStatus::None};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_MESSAGE_TEMPLATE_H_
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_OBJECT_TABLE_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_OBJECT_TABLE_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/object_table.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// ObjectTableWriter is a writer adapter that carries an ObjectEncodeTable for
+// the std::shared_ptr<T> values written through it. The table lasts as long as
+// the writer, spanning every value written to the same Serializer, and is
+// shared with an ObjectTableReader on the receiving end; see
+// nop/base/object_table.h.
+//
+// Objects are kept alive by the table until it is reset, so long sessions
+// should reset the tables on both ends at agreed points in the stream.
+//
+// Example:
+//
+//  Serializer<ObjectTableWriter<VectorWriter>> serializer;
+//  serializer.Write(scene_graph);
+//  serializer.writer().table().Reset();
+//
+template <typename Writer>
+class ObjectTableWriter {
+ public:
+  template <typename... Args>
+  ObjectTableWriter(Args&&... args)
+      : writer_{std::forward<Args>(args)...} {}
+  ObjectTableWriter(ObjectTableWriter&&) = default;
+  ObjectTableWriter& operator=(ObjectTableWriter&&) = default;
+
+  Status<void> Prepare(std::size_t size) { return writer_.Prepare(size); }
+
+  Status<void> Write(std::uint8_t byte) { return writer_.Write(byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    return writer_.Write(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return writer_.Skip(padding_bytes, padding_value);
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    return writer_.PushHandle(handle);
+  }
+
+  template <typename W = Writer>
+  auto Flush() -> decltype(std::declval<W&>().Flush()) {
+    return writer_.Flush();
+  }
+
+  // Forwards the string dictionary of the wrapped writer, when it has one.
+  template <typename W = Writer>
+  auto string_dictionary() -> decltype(std::declval<W&>().string_dictionary()) {
+    return writer_.string_dictionary();
+  }
+
+  // Forwards the chunk store of the wrapped writer, when it has one.
+  template <typename W = Writer>
+  auto chunk_store() -> decltype(std::declval<W&>().chunk_store()) {
+    return writer_.chunk_store();
+  }
+
+  ObjectEncodeTable* object_table() { return &table_; }
+
+  const ObjectEncodeTable& table() const { return table_; }
+  ObjectEncodeTable& table() { return table_; }
+
+  const Writer& writer() const { return writer_; }
+  Writer& writer() { return writer_; }
+  Writer&& take() { return std::move(writer_); }
+
+ private:
+  Writer writer_;
+  ObjectEncodeTable table_;
+
+  ObjectTableWriter(const ObjectTableWriter&) = delete;
+  ObjectTableWriter& operator=(const ObjectTableWriter&) = delete;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_OBJECT_TABLE_WRITER_H_
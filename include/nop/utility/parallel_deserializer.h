@@ -0,0 +1,436 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_PARALLEL_DESERIALIZER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_PARALLEL_DESERIALIZER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/map.h>
+#include <nop/base/skip.h>
+#include <nop/base/utility.h>
+#include <nop/base/vector.h>
+#include <nop/status.h>
+#include <nop/traits/is_borrowing_reader.h>
+#include <nop/types/indexed_array.h>
+#include <nop/utility/endian.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/work_stealing_pool.h>
+
+namespace nop {
+
+// ParallelDeserializer reads a large top-level std::vector<T>, IndexedArray<T>,
+// std::map<Key, T>, or std::unordered_map<Key, T> using several threads. The
+// input is divided into chunks of elements, which are decoded concurrently.
+//
+// Chunk boundaries come from the offset table when the array uses the indexed
+// encoding. Otherwise a structural pre-scan with SkipValue() finds them on the
+// calling thread; skipping follows only prefixes and lengths, so it is much
+// cheaper than decoding. Arrays are decoded directly into their final slots of
+// the pre-sized vector. Map entries are decoded into pre-sized slots as well;
+// for std::map each chunk is sorted into a run on its thread and the runs are
+// merged before the map is built in one ordered pass. As with Deserializer,
+// the first of any duplicate keys is kept.
+//
+// The reader must hold the complete input in memory and support Borrow(), as
+// BufferReader, PedanticBufferReader, and MappedFileReader do; the pre-scan
+// advances the reader past the value. Each chunk is decoded with bounds checks.
+// Element types must not contain handles, or interned strings or shared
+// pointers read with session state. Values with fewer elements than
+// kMinChunkSize per thread are decoded on the calling thread.
+//
+// The deserializer either owns a WorkStealingPool with the given number of
+// threads or shares an existing pool. Read() must not be called from a thread
+// of the pool it uses.
+//
+// Example:
+//
+//  ParallelDeserializer deserializer{8};
+//  MappedFileReader reader{fd};
+//  auto status = deserializer.Read(&snapshot.records, &reader);
+//
+class ParallelDeserializer {
+ public:
+  enum : std::size_t {
+    // Minimum number of elements decoded by each task.
+    kMinChunkSize = 256,
+    // Number of tasks per thread, to balance ranges of uneven cost.
+    kChunksPerThread = 4,
+  };
+
+  explicit ParallelDeserializer(
+      std::size_t thread_count = WorkStealingPool::DefaultThreadCount())
+      : owned_pool_{new WorkStealingPool{thread_count}},
+        pool_{owned_pool_.get()} {}
+  explicit ParallelDeserializer(WorkStealingPool* pool) : pool_{pool} {}
+
+  ParallelDeserializer(const ParallelDeserializer&) = delete;
+  void operator=(const ParallelDeserializer&) = delete;
+
+  // Deserializes |value| from |reader|. Accepts every encoding of
+  // std::vector<T>; chunked arrays are decoded on the calling thread.
+  template <typename T, typename Allocator, typename Reader>
+  Status<void> Read(std::vector<T, Allocator>* value, Reader* reader) {
+    return ReadArray(value, reader, IsIntegral<T>{});
+  }
+
+  template <typename T, typename Allocator, typename Reader>
+  Status<void> Read(IndexedArray<T, Allocator>* value, Reader* reader) {
+    return Read(&value->get(), reader);
+  }
+
+  template <typename Key, typename T, typename Compare, typename Allocator,
+            typename Reader>
+  Status<void> Read(std::map<Key, T, Compare, Allocator>* value,
+                    Reader* reader) {
+    using Element = std::pair<Key, T>;
+    std::vector<Element> elements;
+    std::vector<std::size_t> chunk_begins;
+    auto compare = [value](const Element& a, const Element& b) {
+      return value->key_comp()(a.first, b.first);
+    };
+
+    // Decode and sort each chunk into a run on its thread.
+    auto status = ReadMapElements(&elements, &chunk_begins, reader,
+                                  [&](std::size_t begin, std::size_t end) {
+                                    std::stable_sort(elements.begin() + begin,
+                                                     elements.begin() + end,
+                                                     compare);
+                                  });
+    if (!status)
+      return status;
+
+    // Merge adjacent runs pairwise; merging is stable, so the first of any
+    // equal keys stays in front and is the one inserted below.
+    for (std::size_t width = 1; width < chunk_begins.size() - 1; width *= 2) {
+      for (std::size_t i = 0; i + width < chunk_begins.size() - 1;
+           i += 2 * width) {
+        const std::size_t end =
+            chunk_begins[std::min(i + 2 * width, chunk_begins.size() - 1)];
+        std::inplace_merge(elements.begin() + chunk_begins[i],
+                           elements.begin() + chunk_begins[i + width],
+                           elements.begin() + end, compare);
+      }
+    }
+
+    value->clear();
+    for (Element& element : elements)
+      value->emplace_hint(value->end(), std::move(element));
+    return {};
+  }
+
+  template <typename Key, typename T, typename Hash, typename KeyEqual,
+            typename Allocator, typename Reader>
+  Status<void> Read(
+      std::unordered_map<Key, T, Hash, KeyEqual, Allocator>* value,
+      Reader* reader) {
+    std::vector<std::pair<Key, T>> elements;
+    std::vector<std::size_t> chunk_begins;
+    auto status = ReadMapElements(&elements, &chunk_begins, reader,
+                                  [](std::size_t, std::size_t) {});
+    if (!status)
+      return status;
+
+    value->clear();
+    value->reserve(elements.size());
+    for (auto& element : elements)
+      value->emplace(std::move(element));
+    return {};
+  }
+
+  std::size_t thread_count() const { return pool_->thread_count(); }
+
+ private:
+  // The input bytes of a range of elements.
+  struct Chunk {
+    const std::uint8_t* data;
+    std::size_t size;
+  };
+
+  // Returns the number of chunks to divide |count| elements into.
+  std::size_t ChunkCount(std::size_t count) const {
+    return std::max<std::size_t>(
+        1, std::min<std::size_t>(count / kMinChunkSize,
+                                 thread_count() * kChunksPerThread));
+  }
+
+  // Returns the current position of |reader|.
+  template <typename Reader>
+  static Status<const std::uint8_t*> Position(Reader* reader) {
+    const void* data = nullptr;
+    auto status = reader->Borrow(&data, 0);
+    if (!status)
+      return status.error();
+    return static_cast<const std::uint8_t*>(data);
+  }
+
+  // Finds the chunks of |count| elements of |values_per_element| encoded values
+  // each by skipping over them, leaving |reader| after the last element.
+  template <typename Reader>
+  static Status<std::vector<Chunk>> ScanChunks(
+      const std::vector<std::size_t>& chunk_begins,
+      std::size_t values_per_element, Reader* reader) {
+    std::vector<Chunk> chunks(chunk_begins.size() - 1);
+    for (std::size_t chunk = 0; chunk < chunks.size(); chunk++) {
+      auto begin = Position(reader);
+      if (!begin)
+        return begin.error();
+
+      const std::size_t count =
+          (chunk_begins[chunk + 1] - chunk_begins[chunk]) * values_per_element;
+      for (std::size_t i = 0; i < count; i++) {
+        auto status = SkipValue(reader);
+        if (!status)
+          return status.error();
+      }
+
+      auto end = Position(reader);
+      if (!end)
+        return end.error();
+      chunks[chunk] = {begin.get(), static_cast<std::size_t>(end.get() -
+                                                             begin.get())};
+    }
+    return chunks;
+  }
+
+  // Finds the chunks of an indexed array using its offset table, leaving
+  // |reader| after the last element.
+  template <typename Reader>
+  static Status<std::vector<Chunk>> IndexChunks(
+      const std::vector<std::size_t>& chunk_begins, Reader* reader) {
+    const SizeType count = chunk_begins.back();
+    auto width = detail::ReadOffsetTableHeader(count, reader);
+    if (!width)
+      return width.error();
+
+    const std::size_t table_size = count * width.get();
+    auto status = reader->Ensure(table_size);
+    if (!status)
+      return status.error();
+
+    const void* table = nullptr;
+    status = reader->Borrow(&table, table_size);
+    if (!status)
+      return status.error();
+
+    auto elements = Position(reader);
+    if (!elements)
+      return elements.error();
+
+    auto offset_at = [&](std::size_t index) -> std::uint64_t {
+      const std::uint8_t* data =
+          static_cast<const std::uint8_t*>(table) + index * width.get();
+      if (width.get() == sizeof(std::uint32_t)) {
+        std::uint32_t offset;
+        std::memcpy(&offset, data, sizeof(offset));
+        return HostEndian<std::uint32_t>::FromLittle(offset);
+      } else {
+        std::uint64_t offset;
+        std::memcpy(&offset, data, sizeof(offset));
+        return HostEndian<std::uint64_t>::FromLittle(offset);
+      }
+    };
+
+    // Skip to the last element, which has no following offset, and over it to
+    // find the end of the array.
+    const std::uint64_t last_offset = count == 0 ? 0 : offset_at(count - 1);
+    status = reader->Ensure(last_offset);
+    if (!status)
+      return status.error();
+
+    status = reader->Skip(last_offset);
+    if (!status)
+      return status.error();
+
+    if (count != 0) {
+      status = SkipValue(reader);
+      if (!status)
+        return status.error();
+    }
+
+    auto end = Position(reader);
+    if (!end)
+      return end.error();
+
+    const std::uint64_t size = end.get() - elements.get();
+    std::vector<Chunk> chunks(chunk_begins.size() - 1);
+    for (std::size_t chunk = 0; chunk < chunks.size(); chunk++) {
+      const std::uint64_t begin_offset = offset_at(chunk_begins[chunk]);
+      const std::uint64_t end_offset = chunk + 1 == chunks.size()
+                                           ? size
+                                           : offset_at(chunk_begins[chunk + 1]);
+      if (begin_offset > end_offset || end_offset > size)
+        return ErrorStatus::InvalidContainerLength;
+
+      chunks[chunk] = {elements.get() + begin_offset,
+                       static_cast<std::size_t>(end_offset - begin_offset)};
+    }
+    return chunks;
+  }
+
+  // Returns the index of the first element of each chunk of |count| elements,
+  // followed by |count|.
+  std::vector<std::size_t> ChunkBegins(std::size_t count) const {
+    const std::size_t chunk_count = ChunkCount(count);
+    const std::size_t chunk_size = (count + chunk_count - 1) / chunk_count;
+    std::vector<std::size_t> chunk_begins(chunk_count + 1);
+    for (std::size_t chunk = 0; chunk <= chunk_count; chunk++)
+      chunk_begins[chunk] = std::min(chunk * chunk_size, count);
+    return chunk_begins;
+  }
+
+  // Calls |function| for each chunk on the pool, or on the calling thread when
+  // there is only one, and returns the first error, if any.
+  template <typename Function>
+  Status<void> RunChunks(const std::vector<Chunk>& chunks, Function function) {
+    if (chunks.size() == 1)
+      return function(0);
+
+    std::vector<Status<void>> results(chunks.size());
+    pool_->ForEach(chunks.size(), [&](std::size_t chunk) {
+      results[chunk] = function(chunk);
+    });
+
+    for (auto& result : results) {
+      if (!result)
+        return result;
+    }
+    return {};
+  }
+
+  template <typename T, typename Allocator, typename Reader>
+  Status<void> ReadArray(std::vector<T, Allocator>* value, Reader* reader,
+                         std::true_type /*is_integral*/) {
+    return Encoding<std::vector<T, Allocator>>::Read(value, reader);
+  }
+
+  template <typename T, typename Allocator, typename Reader>
+  Status<void> ReadArray(std::vector<T, Allocator>* value, Reader* reader,
+                         std::false_type /*is_integral*/) {
+    static_assert(IsBorrowingReader<Reader>::value,
+                  "ParallelDeserializer requires a reader that supports "
+                  "Borrow(), such as BufferReader.");
+    using Type = std::vector<T, Allocator>;
+
+    std::uint8_t prefix_byte = 0;
+    auto status = reader->Read(&prefix_byte);
+    if (!status)
+      return status;
+
+    const EncodingByte prefix = static_cast<EncodingByte>(prefix_byte);
+    if (!Encoding<Type>::Match(prefix))
+      return ErrorStatus::UnexpectedEncodingType;
+    else if (prefix == EncodingByte::ChunkedArray)
+      return Encoding<Type>::ReadPayload(prefix, value, reader);
+
+    SizeType count = 0;
+    status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+
+    const std::vector<std::size_t> chunk_begins = ChunkBegins(count);
+    auto chunks = prefix == EncodingByte::IndexedArray
+                      ? IndexChunks(chunk_begins, reader)
+                      : ScanChunks(chunk_begins, 1, reader);
+    if (!chunks)
+      return chunks.error();
+
+    // The pre-scan validated the element count, so the vector may be sized
+    // without trusting it.
+    value->resize(count);
+    return RunChunks(chunks.get(), [&](std::size_t chunk) -> Status<void> {
+      PedanticBufferReader chunk_reader{chunks.get()[chunk].data,
+                                        chunks.get()[chunk].size};
+      const std::size_t end = chunk_begins[chunk + 1];
+      for (std::size_t i = chunk_begins[chunk]; i < end; i++) {
+        auto status = Encoding<T>::Read(&(*value)[i], &chunk_reader);
+        if (!status)
+          return status;
+      }
+
+      if (!chunk_reader.empty())
+        return ErrorStatus::InvalidContainerLength;
+      return {};
+    });
+  }
+
+  // Decodes the entries of an encoded map into |elements|, calling
+  // |finish(begin, end)| on the decoding thread after each chunk of entries.
+  template <typename Key, typename T, typename Reader, typename Finish>
+  Status<void> ReadMapElements(std::vector<std::pair<Key, T>>* elements,
+                               std::vector<std::size_t>* chunk_begins,
+                               Reader* reader, Finish finish) {
+    static_assert(IsBorrowingReader<Reader>::value,
+                  "ParallelDeserializer requires a reader that supports "
+                  "Borrow(), such as BufferReader.");
+
+    std::uint8_t prefix_byte = 0;
+    auto status = reader->Read(&prefix_byte);
+    if (!status)
+      return status;
+    else if (static_cast<EncodingByte>(prefix_byte) != EncodingByte::Map)
+      return ErrorStatus::UnexpectedEncodingType;
+
+    SizeType count = 0;
+    status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+
+    *chunk_begins = ChunkBegins(count);
+    auto chunks = ScanChunks(*chunk_begins, 2, reader);
+    if (!chunks)
+      return chunks.error();
+
+    elements->resize(count);
+    return RunChunks(chunks.get(), [&](std::size_t chunk) -> Status<void> {
+      PedanticBufferReader chunk_reader{chunks.get()[chunk].data,
+                                        chunks.get()[chunk].size};
+      const std::size_t begin = (*chunk_begins)[chunk];
+      const std::size_t end = (*chunk_begins)[chunk + 1];
+      for (std::size_t i = begin; i < end; i++) {
+        auto status = Encoding<Key>::Read(&(*elements)[i].first, &chunk_reader);
+        if (!status)
+          return status;
+
+        status = Encoding<T>::Read(&(*elements)[i].second, &chunk_reader);
+        if (!status)
+          return status;
+      }
+
+      if (!chunk_reader.empty())
+        return ErrorStatus::InvalidContainerLength;
+
+      finish(begin, end);
+      return {};
+    });
+  }
+
+  std::unique_ptr<WorkStealingPool> owned_pool_;
+  WorkStealingPool* pool_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_PARALLEL_DESERIALIZER_H_
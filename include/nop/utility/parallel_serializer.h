@@ -0,0 +1,227 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_PARALLEL_SERIALIZER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_PARALLEL_SERIALIZER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/indexed_array.h>
+#include <nop/base/serializer.h>
+#include <nop/base/utility.h>
+#include <nop/base/vector.h>
+#include <nop/status.h>
+#include <nop/traits/is_borrowing_writer.h>
+#include <nop/types/indexed_array.h>
+#include <nop/utility/buffer_writer.h>
+#include <nop/utility/work_stealing_pool.h>
+
+namespace nop {
+
+// ParallelSerializer writes a large top-level std::vector<T> or IndexedArray<T>
+// using several threads. The encoded size of every element is computed first,
+// in parallel, and a prefix sum gives the position of each range of elements in
+// the output. The writer then lends out the whole element region with Borrow()
+// and the worker threads encode disjoint ranges directly into their slots. The
+// result is byte-for-byte identical to the output of Serializer.
+//
+// The writer must support Borrow(), as BufferWriter, PedanticBufferWriter, and
+// VectorWriter do. Element types must not contain handles, which must be
+// written in order by a single serializer. Arrays with fewer elements than
+// kMinChunkSize per thread, and arrays of integral types, which are a single
+// copy, are written on the calling thread.
+//
+// The serializer either owns a WorkStealingPool with the given number of
+// threads or shares an existing pool. Write() must not be called from a thread
+// of the pool it uses.
+//
+// Example:
+//
+//  ParallelSerializer serializer{8};
+//  VectorWriter writer;
+//  auto status = serializer.Write(snapshot.records, &writer);
+//
+class ParallelSerializer {
+ public:
+  enum : std::size_t {
+    // Minimum number of elements encoded by each task.
+    kMinChunkSize = 256,
+    // Number of tasks per thread, to balance ranges of uneven cost.
+    kChunksPerThread = 4,
+  };
+
+  explicit ParallelSerializer(
+      std::size_t thread_count = WorkStealingPool::DefaultThreadCount())
+      : owned_pool_{new WorkStealingPool{thread_count}},
+        pool_{owned_pool_.get()} {}
+  explicit ParallelSerializer(WorkStealingPool* pool) : pool_{pool} {}
+
+  ParallelSerializer(const ParallelSerializer&) = delete;
+  void operator=(const ParallelSerializer&) = delete;
+
+  // Serializes |value| to |writer|.
+  template <typename T, typename Allocator, typename Writer>
+  Status<void> Write(const std::vector<T, Allocator>& value, Writer* writer) {
+    return WriteArray(value, value, /*indexed=*/false, writer, IsIntegral<T>{});
+  }
+
+  // Serializes |value| to |writer| with the indexed array encoding.
+  template <typename T, typename Allocator, typename Writer>
+  Status<void> Write(const IndexedArray<T, Allocator>& value, Writer* writer) {
+    return WriteArray(value, value.get(), /*indexed=*/true, writer,
+                      std::false_type{});
+  }
+
+  std::size_t thread_count() const { return pool_->thread_count(); }
+
+ private:
+  template <typename Value, typename T, typename Allocator, typename Writer>
+  Status<void> WriteArray(const Value& value,
+                          const std::vector<T, Allocator>& /*elements*/,
+                          bool /*indexed*/, Writer* writer,
+                          std::true_type /*is_integral*/) {
+    return Serializer<Writer*>{writer}.Write(value);
+  }
+
+  template <typename Value, typename T, typename Allocator, typename Writer>
+  Status<void> WriteArray(const Value& value,
+                          const std::vector<T, Allocator>& elements,
+                          bool indexed, Writer* writer,
+                          std::false_type /*is_integral*/) {
+    static_assert(IsBorrowingWriter<Writer>::value,
+                  "ParallelSerializer requires a writer that supports "
+                  "Borrow(), such as BufferWriter.");
+
+    const std::size_t element_count = elements.size();
+    const std::size_t chunk_count = std::max<std::size_t>(
+        1, std::min<std::size_t>(element_count / kMinChunkSize,
+                                 thread_count() * kChunksPerThread));
+    if (chunk_count == 1)
+      return Serializer<Writer*>{writer}.Write(value);
+
+    const std::size_t chunk_size =
+        (element_count + chunk_count - 1) / chunk_count;
+    auto chunk_begin = [&](std::size_t chunk) {
+      return std::min(chunk * chunk_size, element_count);
+    };
+
+    // Compute the offset of each element from the start of its chunk and the
+    // size of each chunk.
+    std::vector<std::uint64_t> offsets(element_count);
+    std::vector<std::uint64_t> chunk_sizes(chunk_count);
+    RunChunks(chunk_count, [&](std::size_t chunk) -> Status<void> {
+      const std::size_t end = chunk_begin(chunk + 1);
+      std::uint64_t offset = 0;
+      for (std::size_t i = chunk_begin(chunk); i < end; i++) {
+        offsets[i] = offset;
+        offset += Encoding<T>::Size(elements[i]);
+      }
+      chunk_sizes[chunk] = offset;
+      return {};
+    });
+
+    // A prefix sum of the chunk sizes gives the position of each chunk.
+    std::vector<std::uint64_t> chunk_offsets(chunk_count + 1);
+    for (std::size_t chunk = 0; chunk < chunk_count; chunk++)
+      chunk_offsets[chunk + 1] = chunk_offsets[chunk] + chunk_sizes[chunk];
+    const std::uint64_t elements_size = chunk_offsets[chunk_count];
+
+    std::size_t header_size = BaseEncodingSize(EncodingByte::Array) +
+                              Encoding<SizeType>::Size(element_count);
+    if (indexed) {
+      for (std::size_t chunk = 1; chunk < chunk_count; chunk++) {
+        const std::size_t end = chunk_begin(chunk + 1);
+        for (std::size_t i = chunk_begin(chunk); i < end; i++)
+          offsets[i] += chunk_offsets[chunk];
+      }
+      header_size += detail::OffsetTableSize(element_count, offsets.back());
+    }
+
+    auto status = writer->Prepare(header_size + elements_size);
+    if (!status)
+      return status;
+
+    status = writer->Write(static_cast<std::uint8_t>(
+        indexed ? EncodingByte::IndexedArray : EncodingByte::Array));
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(element_count, writer);
+    if (!status)
+      return status;
+
+    if (indexed) {
+      status = detail::WriteOffsetTable(offsets, writer);
+      if (!status)
+        return status;
+    }
+
+    void* data = nullptr;
+    status = writer->Borrow(&data, elements_size);
+    if (!status)
+      return status;
+
+    // Encode each chunk directly into its slot of the borrowed region.
+    std::uint8_t* region = static_cast<std::uint8_t*>(data);
+    return RunChunks(chunk_count, [&](std::size_t chunk) -> Status<void> {
+      BufferWriter slot_writer{region + chunk_offsets[chunk],
+                               chunk_sizes[chunk]};
+      Serializer<BufferWriter*> serializer{&slot_writer};
+
+      const std::size_t end = chunk_begin(chunk + 1);
+      for (std::size_t i = chunk_begin(chunk); i < end; i++) {
+        auto status = serializer.Write(elements[i]);
+        if (!status)
+          return status;
+      }
+
+      // Slots are sized by Size(); a short slot would leave stale bytes in the
+      // output, so treat it as an error like overrunning the slot.
+      if (slot_writer.size() != chunk_sizes[chunk])
+        return ErrorStatus::WriteLimitReached;
+      return {};
+    });
+  }
+
+  // Runs |function| for each chunk index on the pool, returning the first
+  // error, if any, once every chunk has finished.
+  template <typename Function>
+  Status<void> RunChunks(std::size_t chunk_count, Function function) {
+    std::vector<Status<void>> results(chunk_count);
+    pool_->ForEach(chunk_count, [&](std::size_t chunk) {
+      results[chunk] = function(chunk);
+    });
+
+    for (auto& result : results) {
+      if (!result)
+        return result;
+    }
+    return {};
+  }
+
+  std::unique_ptr<WorkStealingPool> owned_pool_;
+  WorkStealingPool* pool_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_PARALLEL_SERIALIZER_H_
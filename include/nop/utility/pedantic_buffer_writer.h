@@ -82,6 +82,31 @@ class PedanticBufferWriter {
     return {};
   }
 
+  // Stores a pointer to the next |size| bytes of the buffer in |data| and
+  // advances past them, for the caller to fill in directly.
+  Status<void> Borrow(void** data, std::size_t size) {
+    auto status = Prepare(size);
+    if (!status)
+      return status;
+
+    *data = &buffer_[index_];
+    index_ += size;
+    return {};
+  }
+
+  // Returns the position of the next byte to be written.
+  Status<std::size_t> Tell() const { return {index_}; }
+
+  // Overwrites |size| bytes already written at |position| with |data|.
+  Status<void> Patch(std::size_t position, const void* data,
+                     std::size_t size) {
+    if (position > index_ || size > (index_ - position))
+      return ErrorStatus::WriteLimitReached;
+
+    std::memcpy(&buffer_[position], data, size);
+    return {};
+  }
+
   std::size_t size() const { return index_; }
   std::size_t capacity() const { return size_; }
 
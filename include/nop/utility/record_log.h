@@ -0,0 +1,162 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_RECORD_LOG_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_RECORD_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/structure.h>
+#include <nop/utility/crc32c.h>
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+//
+// Record log file format used by RecordLogWriter and RecordLogReader:
+//
+// +---//----+-----+---//----+---//---+---------+
+// | BLOCK 0 | ... | BLOCK N |  INDEX  | TRAILER |
+// +---//----+-----+---//----+---//---+---------+
+//
+// The file is a sequence of blocks, each a multiple of the block size and
+// starting at a multiple of the block size. A block is a fixed size header
+// followed by frames, one per record, and zero padding to the end of the
+// block:
+//
+// +--------+--------+--------+--------+--------+---//---+---//----+
+// | U32:CRC| U32:BS | U32:N  | U32:C  | U64:R  | FRAMES | PADDING |
+// +--------+--------+--------+--------+--------+---//---+---//----+
+//
+// The header fields are stored as raw little-endian integers: CRC is the
+// CRC32C of the rest of the header and the frames, BS is the block size, N is
+// the number of bytes of frames, C is the number of records in the block, and
+// R is the record number of the first record in the block. Records normally
+// share blocks; a record too large for one block gets a block of its own that
+// spans as many block sizes as needed.
+//
+// Each frame uses the format of FrameWriter, with a payload of the record key,
+// encoded as a std::string, followed by the encoded record value:
+//
+// +---------+-----+-----//-----+
+// | INT64:L | KEY | VALUE BYTES |
+// +---------+-----+-----//-----+
+//
+// When the log is closed, a sparse index of the blocks, the encoded
+// RecordLogIndex below, is written after the last block, followed by a trailer
+// of raw little-endian integers giving its location:
+//
+// +-----------+-------------+-----------+-----------+
+// | U64:MAGIC | U64:OFFSET  | U32:SIZE  | U32:CRC   |
+// +-----------+-------------+-----------+-----------+
+//
+// Logs that were not closed, because the writer stopped before Close(), have
+// no trailer. Readers recover them by scanning the blocks from the start,
+// stopping at the first block that is incomplete or fails its checksum.
+//
+
+enum : std::size_t {
+  kRecordLogBlockHeaderSize = 24,
+  kRecordLogTrailerSize = 24,
+  kRecordLogMinBlockSize = 64,
+};
+
+enum : std::uint64_t { kRecordLogMagic = 0x31474f4c504f4e00 };  // "\0NOPLOG1"
+
+// Index entry for one block of a record log.
+struct RecordLogIndexEntry {
+  // Record number of the first record in the block.
+  std::uint64_t record;
+  // Offset of the block from the start of the file.
+  std::uint64_t offset;
+  // Key of the first record in the block.
+  std::string key;
+
+  NOP_STRUCTURE(RecordLogIndexEntry, record, offset, key);
+};
+
+// Sparse index of a record log, with one entry per block.
+struct RecordLogIndex {
+  std::uint64_t block_size;
+  std::uint64_t record_count;
+  std::vector<RecordLogIndexEntry> blocks;
+
+  NOP_STRUCTURE(RecordLogIndex, block_size, record_count, blocks);
+};
+
+namespace detail {
+
+template <typename T>
+inline void StoreLittle(std::uint8_t* data, T value) {
+  value = HostEndian<T>::ToLittle(value);
+  std::memcpy(data, &value, sizeof(T));
+}
+
+template <typename T>
+inline T LoadLittle(const std::uint8_t* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return HostEndian<T>::FromLittle(value);
+}
+
+// Header of a record log block.
+struct RecordLogBlockHeader {
+  std::uint32_t checksum;
+  std::uint32_t block_size;
+  std::uint32_t used;
+  std::uint32_t count;
+  std::uint64_t first_record;
+
+  void Store(std::uint8_t* data) const {
+    StoreLittle(data, checksum);
+    StoreLittle(data + 4, block_size);
+    StoreLittle(data + 8, used);
+    StoreLittle(data + 12, count);
+    StoreLittle(data + 16, first_record);
+  }
+
+  static RecordLogBlockHeader Load(const std::uint8_t* data) {
+    return {LoadLittle<std::uint32_t>(data),
+            LoadLittle<std::uint32_t>(data + 4),
+            LoadLittle<std::uint32_t>(data + 8),
+            LoadLittle<std::uint32_t>(data + 12),
+            LoadLittle<std::uint64_t>(data + 16)};
+  }
+
+  // Returns the number of bytes the block occupies in the file.
+  std::size_t extent() const {
+    const std::size_t size = kRecordLogBlockHeaderSize + used;
+    return (size + block_size - 1) / block_size * block_size;
+  }
+
+  // Returns the checksum of the block starting at |data|, whose header has
+  // already been stored.
+  std::uint32_t Compute(const std::uint8_t* data) const {
+    return Crc32c::Compute(data + sizeof(checksum),
+                           kRecordLogBlockHeaderSize - sizeof(checksum) + used);
+  }
+};
+
+}  // namespace detail
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_RECORD_LOG_H_
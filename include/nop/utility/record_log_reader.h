@@ -0,0 +1,401 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_RECORD_LOG_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_RECORD_LOG_READER_H_
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/skip.h>
+#include <nop/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/crc32c.h>
+#include <nop/utility/record_log.h>
+
+namespace nop {
+
+// RecordLogReader maps a record log file written by RecordLogWriter and loads
+// its block index, for use by RecordLogCursor. The index is read from the end
+// of the file when the log was closed. Otherwise the reader recovers the log by
+// scanning the block headers from the start of the file, keeping the records
+// of every complete block before the first block that is truncated or fails
+// its checksum.
+//
+// The reader does not take ownership of the fd, which may be closed once the
+// log is opened.
+class RecordLogReader {
+ public:
+  RecordLogReader() = default;
+  RecordLogReader(const RecordLogReader&) = delete;
+  void operator=(const RecordLogReader&) = delete;
+
+  ~RecordLogReader() { Unmap(); }
+
+  // Maps the log in |fd| and loads its index. Returns ErrorStatus::IOError if
+  // the file cannot be mapped.
+  Status<void> Open(int fd) {
+    Unmap();
+
+    struct stat stat_buf;
+    if (::fstat(fd, &stat_buf) < 0)
+      return ErrorStatus::IOError;
+
+    const std::size_t size = static_cast<std::size_t>(stat_buf.st_size);
+    if (size > 0) {
+      void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (address == MAP_FAILED)
+        return ErrorStatus::IOError;
+
+      ::madvise(address, size, MADV_RANDOM);
+      data_ = static_cast<const std::uint8_t*>(address);
+      size_ = size;
+    }
+
+    if (!LoadIndex())
+      Recover();
+    return {};
+  }
+
+  // Returns the number of records in the log.
+  std::uint64_t record_count() const { return record_count_; }
+
+  // Returns the index of the blocks of the log.
+  const std::vector<RecordLogIndexEntry>& index() const { return blocks_; }
+
+  // Returns true if the log had no valid index and was recovered by scanning.
+  bool recovered() const { return recovered_; }
+
+  const std::uint8_t* data() const { return data_; }
+  std::size_t size() const { return size_; }
+
+ private:
+  void Unmap() {
+    if (data_)
+      ::munmap(const_cast<std::uint8_t*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+    record_count_ = 0;
+    blocks_.clear();
+    recovered_ = false;
+  }
+
+  // Loads the index written by RecordLogWriter::Close(), returning false if it
+  // is missing or invalid.
+  bool LoadIndex() {
+    if (size_ < kRecordLogTrailerSize)
+      return false;
+
+    const std::uint8_t* trailer = data_ + size_ - kRecordLogTrailerSize;
+    const auto offset = detail::LoadLittle<std::uint64_t>(trailer + 8);
+    const auto index_size = detail::LoadLittle<std::uint32_t>(trailer + 16);
+    const auto checksum = detail::LoadLittle<std::uint32_t>(trailer + 20);
+    if (detail::LoadLittle<std::uint64_t>(trailer) != kRecordLogMagic ||
+        offset > size_ - kRecordLogTrailerSize ||
+        index_size != size_ - kRecordLogTrailerSize - offset ||
+        Crc32c::Compute(data_ + offset, index_size) != checksum) {
+      return false;
+    }
+
+    RecordLogIndex index;
+    Deserializer<BufferReader> deserializer{data_ + offset, index_size};
+    if (!deserializer.Read(&index))
+      return false;
+
+    // Make sure the index agrees with itself so that cursors may rely on it.
+    for (std::size_t i = 0; i < index.blocks.size(); i++) {
+      const RecordLogIndexEntry& entry = index.blocks[i];
+      if (entry.offset >= offset || entry.record >= index.record_count ||
+          (i > 0 && (entry.offset <= index.blocks[i - 1].offset ||
+                     entry.record <= index.blocks[i - 1].record))) {
+        return false;
+      }
+    }
+
+    record_count_ = index.record_count;
+    blocks_ = std::move(index.blocks);
+    return true;
+  }
+
+  // Rebuilds the index by scanning the blocks of the file.
+  void Recover() {
+    recovered_ = true;
+    std::size_t offset = 0;
+    std::uint32_t block_size = 0;
+    while (size_ - offset >= kRecordLogBlockHeaderSize) {
+      const std::uint8_t* block = data_ + offset;
+      const auto header = detail::RecordLogBlockHeader::Load(block);
+      if (header.block_size < kRecordLogMinBlockSize ||
+          (block_size != 0 && header.block_size != block_size) ||
+          header.used > size_ - offset - kRecordLogBlockHeaderSize ||
+          header.count == 0 || header.first_record != record_count_ ||
+          header.Compute(block) != header.checksum) {
+        break;
+      }
+
+      std::string key;
+      BufferReader reader{block + kRecordLogBlockHeaderSize, header.used};
+      SizeType frame_size = 0;
+      if (!Encoding<SizeType>::Read(&frame_size, &reader) ||
+          !Encoding<std::string>::Read(&key, &reader)) {
+        break;
+      }
+
+      blocks_.push_back({header.first_record, offset, std::move(key)});
+      record_count_ += header.count;
+      block_size = header.block_size;
+      offset += std::min(header.extent(), size_ - offset);
+    }
+  }
+
+  const std::uint8_t* data_{nullptr};
+  std::size_t size_{0};
+  std::uint64_t record_count_{0};
+  std::vector<RecordLogIndexEntry> blocks_;
+  bool recovered_{false};
+};
+
+// RecordLogCursor iterates over the records of a RecordLogReader in the style
+// of ArrayCursor. Next() decodes records in order and Seek() and SeekKey() use
+// the block index to move directly to the block holding the target record,
+// skipping the frames before it without decoding them. Each block checksum is
+// checked when the cursor enters the block, and ErrorStatus::ChecksumMismatch
+// is returned if it does not match.
+//
+// Example:
+//
+//  RecordLogReader log;
+//  auto status = log.Open(fd);
+//  RecordLogCursor cursor{&log};
+//  status = cursor.Seek(1000);
+//  while (status && !cursor.done()) {
+//    Message message;
+//    status = cursor.Next(&message);
+//    ...
+//  }
+//
+class RecordLogCursor {
+ public:
+  explicit RecordLogCursor(const RecordLogReader* log) : log_{log} {}
+
+  // Reads the next record into |value|, skipping its key. Returns
+  // ErrorStatus::ReadLimitReached if every record has been read.
+  template <typename T>
+  Status<void> Next(T* value) {
+    BufferReader frame;
+    auto status = NextFrame(&frame);
+    if (!status)
+      return status;
+
+    status = SkipValue(&frame);
+    if (!status)
+      return status;
+
+    return Encoding<T>::Read(value, &frame);
+  }
+
+  // Reads the key and value of the next record. Returns
+  // ErrorStatus::ReadLimitReached if every record has been read.
+  template <typename T>
+  Status<void> Next(std::string* key, T* value) {
+    BufferReader frame;
+    auto status = NextFrame(&frame);
+    if (!status)
+      return status;
+
+    status = Encoding<std::string>::Read(key, &frame);
+    if (!status)
+      return status;
+
+    return Encoding<T>::Read(value, &frame);
+  }
+
+  // Moves the cursor to the record with the given number, which may be before
+  // or after the current position. Returns ErrorStatus::InvalidContainerLength
+  // if |record| is beyond the end of the log.
+  Status<void> Seek(std::uint64_t record) {
+    if (record > size())
+      return ErrorStatus::InvalidContainerLength;
+    else if (record == size())
+      return End();
+
+    const auto& blocks = log_->index();
+    const auto next = std::upper_bound(
+        blocks.begin(), blocks.end(), record,
+        [](std::uint64_t record, const RecordLogIndexEntry& entry) {
+          return record < entry.record;
+        });
+    auto status = EnterBlock(next - blocks.begin() - 1);
+    if (!status)
+      return status;
+
+    while (position_ < record) {
+      BufferReader frame;
+      status = NextFrame(&frame);
+      if (!status)
+        return status;
+    }
+    return {};
+  }
+
+  // Moves the cursor to the first record with a key that is not less than
+  // |key|, or to the end of the log if there is none. Requires that the keys
+  // of the log are in non-decreasing order.
+  Status<void> SeekKey(const std::string& key) {
+    const auto& blocks = log_->index();
+    const auto next = std::lower_bound(
+        blocks.begin(), blocks.end(), key,
+        [](const RecordLogIndexEntry& entry, const std::string& key) {
+          return entry.key < key;
+        });
+    if (blocks.empty())
+      return End();
+
+    // Records equal to |key| may end the block before the first block that
+    // starts with a key not less than |key|.
+    const std::size_t block =
+        next == blocks.begin() ? 0 : next - blocks.begin() - 1;
+    auto status = EnterBlock(block);
+    if (!status)
+      return status;
+
+    std::string record_key;
+    while (!done()) {
+      const BufferReader saved_reader = reader_;
+      const std::size_t saved_block = block_;
+      const std::size_t saved_remaining = block_remaining_;
+
+      BufferReader frame;
+      status = NextFrame(&frame);
+      if (!status)
+        return status;
+
+      status = Encoding<std::string>::Read(&record_key, &frame);
+      if (!status)
+        return status;
+
+      if (!(record_key < key)) {
+        reader_ = saved_reader;
+        block_ = saved_block;
+        block_remaining_ = saved_remaining;
+        position_--;
+        return {};
+      }
+    }
+    return {};
+  }
+
+  // Returns the number of records in the log.
+  std::uint64_t size() const { return log_->record_count(); }
+
+  // Returns the number of the next record to read.
+  std::uint64_t position() const { return position_; }
+
+  // Returns true when every record has been read.
+  bool done() const { return position_ == size(); }
+
+ private:
+  Status<void> End() {
+    position_ = size();
+    block_ = log_->index().size();
+    block_remaining_ = 0;
+    return {};
+  }
+
+  // Positions the cursor at the first record of the given block after checking
+  // the block header and checksum.
+  Status<void> EnterBlock(std::size_t block) {
+    const RecordLogIndexEntry& entry = log_->index()[block];
+    if (log_->size() - entry.offset < kRecordLogBlockHeaderSize)
+      return ErrorStatus::ReadLimitReached;
+
+    const std::uint8_t* data = log_->data() + entry.offset;
+    const auto header = detail::RecordLogBlockHeader::Load(data);
+    if (header.used >
+        log_->size() - entry.offset - kRecordLogBlockHeaderSize) {
+      return ErrorStatus::ReadLimitReached;
+    } else if (header.Compute(data) != header.checksum) {
+      return ErrorStatus::ChecksumMismatch;
+    } else if (header.first_record != entry.record ||
+               header.count > size() - entry.record) {
+      return ErrorStatus::InvalidContainerLength;
+    }
+
+    reader_ = BufferReader{data + kRecordLogBlockHeaderSize, header.used};
+    block_ = block;
+    block_remaining_ = header.count;
+    position_ = entry.record;
+    entered_ = true;
+    return {};
+  }
+
+  // Points |frame| at the payload of the next record and advances past it.
+  Status<void> NextFrame(BufferReader* frame) {
+    if (done())
+      return ErrorStatus::ReadLimitReached;
+
+    while (block_remaining_ == 0) {
+      const std::size_t next = entered_ ? block_ + 1 : 0;
+      if (next >= log_->index().size())
+        return ErrorStatus::ReadLimitReached;
+
+      auto status = EnterBlock(next);
+      if (!status)
+        return status;
+    }
+
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, &reader_);
+    if (!status)
+      return status;
+
+    status = reader_.Ensure(size);
+    if (!status)
+      return status;
+
+    const void* data = nullptr;
+    status = reader_.Borrow(&data, size);
+    if (!status)
+      return status;
+
+    *frame = BufferReader{data, size};
+    block_remaining_--;
+    position_++;
+    return {};
+  }
+
+  const RecordLogReader* log_;
+  BufferReader reader_;
+  std::size_t block_{0};
+  std::size_t block_remaining_{0};
+  std::uint64_t position_{0};
+  bool entered_{false};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_RECORD_LOG_READER_H_
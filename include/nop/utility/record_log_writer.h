@@ -0,0 +1,338 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_RECORD_LOG_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_RECORD_LOG_WRITER_H_
+
+#include <errno.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/size_cache.h>
+#include <nop/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/bounded_writer.h>
+#include <nop/utility/buffer_writer.h>
+#include <nop/utility/crc32c.h>
+#include <nop/utility/record_log.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+// RecordLogWriter writes values to a record log file, described in
+// nop/utility/record_log.h, which RecordLogReader can iterate and seek
+// without scanning the whole file.
+//
+// Append() encodes a record into the current block in memory and returns its
+// record number; records become durable when Commit() returns. Append() and
+// Commit() may be called from any number of threads. Commits are grouped: a
+// commit writes and syncs every record appended up to that point, including
+// those of other threads, and threads that call Commit() while another commit
+// is in progress wait for it and then share at most one more write and sync
+// between them.
+//
+// A commit ends the current block, so that blocks are never rewritten once
+// they have been written; a committed record cannot be lost to a later torn
+// write. The block size therefore trades the padding left by frequent commits
+// against the number of index entries.
+//
+// Records may have a key, used by RecordLogCursor::SeekKey(). Keys must be
+// appended in non-decreasing order.
+//
+// The writer writes a new log starting at the beginning of the given fd and
+// does not take ownership of the fd. Close() writes the index and trailer;
+// logs that are not closed are recovered by RecordLogReader.
+//
+// Example:
+//
+//  RecordLogWriter log{fd};
+//  for (const auto& message : messages) {
+//    auto status = log.Append(message.id, message);
+//    ...
+//  }
+//  auto status = log.Commit();
+//  ...
+//  status = log.Close();
+//
+class RecordLogWriter {
+ public:
+  enum : std::size_t { DefaultBlockSize = 32 * 1024 };
+
+  explicit RecordLogWriter(int fd, std::size_t block_size = DefaultBlockSize)
+      : fd_{fd},
+        block_size_{std::max<std::size_t>(block_size, kRecordLogMinBlockSize)},
+        block_(kRecordLogBlockHeaderSize) {}
+
+  RecordLogWriter(const RecordLogWriter&) = delete;
+  void operator=(const RecordLogWriter&) = delete;
+
+  // Appends |value| as a record without a key, returning its record number.
+  template <typename T>
+  Status<std::uint64_t> Append(const T& value) {
+    return AppendRecord(std::string{}, value, false);
+  }
+
+  // Appends |value| as a record with the given key, returning its record
+  // number. Returns ErrorStatus::ProtocolError if |key| is less than the key of
+  // the previous keyed record.
+  template <typename T>
+  Status<std::uint64_t> Append(const std::string& key, const T& value) {
+    return AppendRecord(key, value, true);
+  }
+
+  // Writes every record appended before the call and waits until they are
+  // durable. Returns ErrorStatus::IOError if a write or sync fails, after
+  // which the writer fails every call.
+  Status<void> Commit() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    const std::uint64_t count = next_record_;
+    while (committed_ < count && error_ == ErrorStatus::None) {
+      if (committing_)
+        condition_.wait(lock);
+      else
+        WriteBlocks(&lock);
+    }
+
+    if (error_ != ErrorStatus::None)
+      return error_;
+    else
+      return {};
+  }
+
+  // Commits every record, then writes the index and trailer. No records may be
+  // appended after the log is closed.
+  Status<void> Close() {
+    auto status = Commit();
+    if (!status)
+      return status;
+
+    std::unique_lock<std::mutex> lock{mutex_};
+    if (closed_)
+      return {};
+
+    Serializer<VectorWriter> serializer;
+    status = serializer.Write(
+        RecordLogIndex{block_size_, next_record_, std::move(index_)});
+    if (!status)
+      return status;
+
+    std::vector<std::uint8_t> data = serializer.writer().take();
+    const std::size_t index_size = data.size();
+    data.resize(index_size + kRecordLogTrailerSize);
+    std::uint8_t* trailer = &data[index_size];
+    detail::StoreLittle<std::uint64_t>(trailer, kRecordLogMagic);
+    detail::StoreLittle<std::uint64_t>(trailer + 8, end_offset_);
+    detail::StoreLittle<std::uint32_t>(trailer + 16, index_size);
+    const std::uint32_t checksum = Crc32c::Compute(data.data(), index_size);
+    detail::StoreLittle<std::uint32_t>(trailer + 20, checksum);
+
+    closed_ = true;
+    status = WriteAt(data.data(), data.size(), end_offset_);
+    if (status)
+      status = Sync();
+    if (!status)
+      error_ = status.error();
+    return status;
+  }
+
+  // Returns the number of records appended.
+  std::uint64_t record_count() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return next_record_;
+  }
+
+  // Returns the number of records known to be durable.
+  std::uint64_t committed_count() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return committed_;
+  }
+
+  std::size_t block_size() const { return block_size_; }
+
+ private:
+  template <typename T>
+  Status<std::uint64_t> AppendRecord(const std::string& key, const T& value,
+                                     bool keyed) {
+    SizeCache cache;
+    const SizeType size =
+        Encoding<std::string>::Size(key) + CachedSize(value, &cache);
+    const std::size_t frame_size = Encoding<SizeType>::Size(size) + size;
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (error_ != ErrorStatus::None)
+      return error_;
+    else if (closed_)
+      return ErrorStatus::WriteLimitReached;
+    else if (keyed && key < last_key_)
+      return ErrorStatus::ProtocolError;
+
+    if (block_count_ > 0 && block_.size() + frame_size > block_size_)
+      SealBlock();
+    if (block_count_ == 0)
+      block_key_ = key;
+
+    const std::size_t offset = block_.size();
+    block_.resize(offset + frame_size);
+    auto status = WriteFrame(key, value, size, &block_[offset], frame_size,
+                             &cache);
+    if (!status) {
+      block_.resize(offset);
+      return status.error();
+    }
+
+    if (keyed)
+      last_key_ = key;
+    block_count_++;
+    return next_record_++;
+  }
+
+  template <typename T>
+  static Status<void> WriteFrame(const std::string& key, const T& value,
+                                 SizeType size, std::uint8_t* data,
+                                 std::size_t frame_size, SizeCache* cache) {
+    BufferWriter buffer_writer{data, frame_size};
+    SizeCacheWriter<BufferWriter> cache_writer{&buffer_writer, cache};
+    auto status = Encoding<SizeType>::Write(size, &cache_writer);
+    if (!status)
+      return status;
+
+    BoundedWriter<SizeCacheWriter<BufferWriter>> bounded_writer{&cache_writer,
+                                                                size};
+    status = Encoding<std::string>::Write(key, &bounded_writer);
+    if (!status)
+      return status;
+
+    status = Encoding<T>::Write(value, &bounded_writer);
+    if (!status)
+      return status;
+
+    return bounded_writer.WritePadding();
+  }
+
+  // Finishes the current block and queues it to be written by the next commit.
+  // Called with the mutex held.
+  void SealBlock() {
+    const std::size_t used = block_.size() - kRecordLogBlockHeaderSize;
+    detail::RecordLogBlockHeader header{
+        0, static_cast<std::uint32_t>(block_size_),
+        static_cast<std::uint32_t>(used),
+        static_cast<std::uint32_t>(block_count_), next_record_ - block_count_};
+    header.Store(block_.data());
+    header.checksum = header.Compute(block_.data());
+    header.Store(block_.data());
+
+    index_.push_back({header.first_record, end_offset_, block_key_});
+    end_offset_ += header.extent();
+
+    block_.resize(header.extent());
+    pending_.insert(pending_.end(), block_.begin(), block_.end());
+    block_.assign(kRecordLogBlockHeaderSize, 0);
+    block_count_ = 0;
+  }
+
+  // Writes the pending blocks as the leader of a group commit. The mutex is
+  // released while writing, so that other threads may continue to append.
+  void WriteBlocks(std::unique_lock<std::mutex>* lock) {
+    committing_ = true;
+    if (block_count_ > 0)
+      SealBlock();
+
+    const std::uint64_t count = next_record_;
+    const std::uint64_t offset = written_offset_;
+    writing_.clear();
+    std::swap(writing_, pending_);
+
+    lock->unlock();
+    auto status = WriteAt(writing_.data(), writing_.size(), offset);
+    if (status)
+      status = Sync();
+    lock->lock();
+
+    committing_ = false;
+    if (status) {
+      written_offset_ += writing_.size();
+      committed_ = count;
+    } else {
+      error_ = status.error();
+    }
+    condition_.notify_all();
+  }
+
+  Status<void> WriteAt(const std::uint8_t* data, std::size_t size,
+                       std::uint64_t offset) {
+    while (size > 0) {
+      const ssize_t ret = ::pwrite(fd_, data, size, offset);
+      if (ret > 0) {
+        data += ret;
+        size -= ret;
+        offset += ret;
+      } else if (ret == 0 || errno != EINTR) {
+        return ErrorStatus::IOError;
+      }
+      // Otherwise interrupted by signal; retry.
+    }
+    return {};
+  }
+
+  Status<void> Sync() {
+    while (::fdatasync(fd_) < 0) {
+      if (errno != EINTR)
+        return ErrorStatus::IOError;
+    }
+    return {};
+  }
+
+  const int fd_;
+  const std::size_t block_size_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+
+  // The block being filled, starting with space for its header.
+  std::vector<std::uint8_t> block_;
+  std::size_t block_count_{0};
+  std::string block_key_;
+  std::string last_key_;
+
+  // Sealed blocks waiting for the next commit, and the blocks being written by
+  // the current commit.
+  std::vector<std::uint8_t> pending_;
+  std::vector<std::uint8_t> writing_;
+
+  std::vector<RecordLogIndexEntry> index_;
+  std::uint64_t next_record_{0};
+  std::uint64_t committed_{0};
+  std::uint64_t end_offset_{0};
+  std::uint64_t written_offset_{0};
+  bool committing_{false};
+  bool closed_{false};
+  ErrorStatus error_{ErrorStatus::None};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_RECORD_LOG_WRITER_H_
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_RESUMABLE_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_RESUMABLE_READER_H_
+
+#include <errno.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <nop/base/utility.h>
+#include <nop/status.h>
+
+namespace nop {
+
+// ResumableReader is a reader type for decoding from non-blocking sources,
+// where a value may arrive in several pieces. Bytes are fed to the reader with
+// Append() or ReadFrom() as they arrive, and decoding is attempted with
+// Attempt(). When a decode runs out of bytes every read operation returns
+// ErrorStatus::NeedMoreData, Attempt() rewinds the reader to where the decode
+// started, and the decode may be attempted again once more bytes are fed.
+// Successful decodes release the bytes they consumed.
+//
+// Only the bytes of the value currently being decoded are held by the reader.
+// Large arrays may be decoded an element at a time with ArrayCursor, each step
+// in its own Attempt(), so that memory use is bounded by the size of the
+// largest element rather than that of the whole array.
+//
+// Reads that would require more than the maximum buffer size given at
+// construction return ErrorStatus::ReadLimitReached, so that an abusive length
+// cannot make the reader buffer without bound.
+//
+// Example:
+//
+//  ResumableReader reader;
+//  Deserializer<ResumableReader*> deserializer{&reader};
+//  Message message;
+//
+//  // Called whenever the socket is readable.
+//  auto status = reader.ReadFrom(socket_fd);
+//  if (status) {
+//    status = reader.Attempt(
+//        [&](ResumableReader*) { return deserializer.Read(&message); });
+//  }
+//  if (status)
+//    HandleMessage(message);
+//  else if (status.error() != ErrorStatus::NeedMoreData)
+//    HandleError(status.error());
+//
+class ResumableReader {
+ public:
+  enum : std::size_t { DefaultMaxBufferSize = 64 * 1024 * 1024 };
+
+  explicit ResumableReader(std::size_t max_buffer_size = DefaultMaxBufferSize)
+      : max_buffer_size_{max_buffer_size} {}
+
+  ResumableReader(const ResumableReader&) = delete;
+  void operator=(const ResumableReader&) = delete;
+
+  // Copies |size| bytes received from the source into the reader.
+  void Append(const void* data, std::size_t size) {
+    Compact();
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    buffer_.insert(buffer_.end(), bytes, bytes + size);
+  }
+
+  // Performs one read(2) of up to |size| bytes from |fd|, returning the number
+  // of bytes read. Returns zero bytes when a non-blocking |fd| has no data
+  // available and ErrorStatus::ReadLimitReached at the end of the stream.
+  Status<std::size_t> ReadFrom(int fd, std::size_t size = 4096) {
+    Compact();
+    const std::size_t end = buffer_.size();
+    buffer_.resize(end + size);
+
+    while (true) {
+      const ssize_t ret = ::read(fd, &buffer_[end], size);
+      if (ret >= 0)
+        buffer_.resize(end + ret);
+
+      if (ret > 0) {
+        return static_cast<std::size_t>(ret);
+      } else if (ret == 0) {
+        return ErrorStatus::ReadLimitReached;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        buffer_.resize(end);
+        return 0;
+      } else if (errno != EINTR) {
+        buffer_.resize(end);
+        return ErrorStatus::IOError;
+      }
+      // Otherwise interrupted by signal; retry.
+    }
+  }
+
+  // Invokes |op| with this reader to decode from the current position. If
+  // |op| returns ErrorStatus::NeedMoreData the reader is rewound so that |op|
+  // may be attempted again after more bytes are fed, and likewise for
+  // ErrorStatus::DeadlineExceeded from a BudgetReader, so that |op| may be
+  // attempted again later; otherwise the bytes read by |op| are released, even
+  // on error.
+  template <typename Op>
+  Status<void> Attempt(Op&& op) {
+    auto status = std::forward<Op>(op)(this);
+    if (!status && (status.error() == ErrorStatus::NeedMoreData ||
+                    status.error() == ErrorStatus::DeadlineExceeded))
+      Rollback();
+    else
+      Commit();
+    return status;
+  }
+
+  // Releases the bytes read since the last commit.
+  void Commit() { checkpoint_ = index_; }
+
+  // Rewinds the reader to the last commit.
+  void Rollback() { index_ = checkpoint_; }
+
+  Status<void> Ensure(std::size_t size) { return Require(size); }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    const std::size_t length_bytes = (end - begin) * sizeof(T);
+    auto status = Require(length_bytes);
+    if (!status)
+      return status;
+
+    std::memcpy(begin, &buffer_[index_], length_bytes);
+    index_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    auto status = Require(padding_bytes);
+    if (!status)
+      return status;
+
+    index_ += padding_bytes;
+    return {};
+  }
+
+  // Returns the number of bytes fed and not yet read.
+  std::size_t remaining() const { return buffer_.size() - index_; }
+
+  // Returns the number of bytes held for the decode in progress, including
+  // those not yet read.
+  std::size_t buffered() const { return buffer_.size() - checkpoint_; }
+
+ private:
+  Status<void> Require(std::size_t size) {
+    const std::size_t held = index_ - checkpoint_;
+    if (size > max_buffer_size_ || held > max_buffer_size_ - size)
+      return ErrorStatus::ReadLimitReached;
+    else if (remaining() < size)
+      return ErrorStatus::NeedMoreData;
+    else
+      return {};
+  }
+
+  // Drops the committed bytes from the front of the buffer.
+  void Compact() {
+    if (checkpoint_ != 0) {
+      buffer_.erase(buffer_.begin(), buffer_.begin() + checkpoint_);
+      index_ -= checkpoint_;
+      checkpoint_ = 0;
+    }
+  }
+
+  std::vector<std::uint8_t> buffer_;
+  std::size_t max_buffer_size_;
+  std::size_t checkpoint_{0};
+  std::size_t index_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_RESUMABLE_READER_H_
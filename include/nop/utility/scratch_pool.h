@@ -0,0 +1,340 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_SCRATCH_POOL_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_SCRATCH_POOL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <nop/base/utility.h>
+#include <nop/status.h>
+#include <nop/types/thread_local.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+//
+// Per-thread pool of serialization buffers.
+//
+// ScratchPool keeps a small free list of byte buffers for each thread, so that
+// a thread that serializes one message after another reuses the same memory
+// instead of allocating a fresh buffer per message. ScratchWriter and
+// ScratchBuffer acquire a buffer from the pool of the calling thread when they
+// are constructed and return it when they are destroyed.
+//
+// The pool records the largest buffer returned to it, its high-water mark, and
+// sizes newly allocated buffers to match, so that a thread converges on
+// buffers that fit its largest messages. ScratchTrimPolicy bounds the memory
+// retained by each thread: buffers that grew beyond |max_capacity| are freed
+// instead of being kept, and at most |max_buffers| buffers are kept at once.
+//
+// Buffers are returned to the pool of the thread that destroys their owner,
+// which need not be the thread that acquired them. Owners must not outlive the
+// thread that destroys them. Distinct pools are created by passing distinct
+// Slot types; see nop/types/thread_local.h. The buffers are allocated with the
+// given Allocator, for example a HugePageAllocator to keep large buffers on
+// huge pages local to the NUMA node of each thread; pools with different
+// allocators are distinct.
+//
+// stats() reports the memory held by the pool of the calling thread and how
+// often acquired buffers are reused, for tuning the trim policy.
+//
+// Example:
+//
+//   nop::Serializer<nop::ScratchWriter<>> serializer;
+//   auto status = serializer.Write(message);
+//   if (status)
+//     Send(serializer.writer().data());
+//   // The buffer returns to the pool when |serializer| goes out of scope.
+//
+
+struct ScratchTrimPolicy {
+  enum : std::size_t {
+    kDefaultMaxBuffers = 4,
+    kDefaultMaxCapacity = 1024 * 1024,
+  };
+
+  // Maximum number of idle buffers kept per thread.
+  std::size_t max_buffers{kDefaultMaxBuffers};
+
+  // Buffers whose capacity exceeds this are freed when they are released.
+  std::size_t max_capacity{kDefaultMaxCapacity};
+};
+
+// Statistics of the pool of one thread.
+struct ScratchPoolStats {
+  // Total capacity of the idle buffers in the pool.
+  std::size_t bytes_held{0};
+
+  // The capacity given to newly allocated buffers.
+  std::size_t high_water_mark{0};
+
+  // Number of buffers acquired, and how many of those came from the pool
+  // rather than being allocated.
+  std::size_t acquire_count{0};
+  std::size_t reuse_count{0};
+
+  // Returns the fraction of acquired buffers that were reused.
+  double reuse_rate() const {
+    return acquire_count ? static_cast<double>(reuse_count) / acquire_count
+                         : 0.0;
+  }
+};
+
+namespace detail {
+
+template <typename Allocator>
+struct ScratchState {
+  explicit ScratchState(const ScratchTrimPolicy& policy) : policy{policy} {}
+
+  ScratchTrimPolicy policy;
+  std::vector<std::vector<std::uint8_t, Allocator>> buffers;
+  std::size_t high_water_mark{0};
+  std::size_t acquire_count{0};
+  std::size_t reuse_count{0};
+};
+
+}  // namespace detail
+
+template <typename Slot = ThreadLocalIndexSlot<0>,
+          typename Allocator = std::allocator<std::uint8_t>>
+class ScratchPool {
+ public:
+  using Buffer = std::vector<std::uint8_t, Allocator>;
+
+  // Returns an empty buffer from the pool of the calling thread, or a new
+  // buffer with capacity for the high-water mark if the pool is empty.
+  static Buffer Acquire() {
+    State& state = GetState();
+    Buffer buffer;
+    state.acquire_count++;
+    if (state.buffers.empty()) {
+      buffer.reserve(state.high_water_mark);
+    } else {
+      buffer = std::move(state.buffers.back());
+      state.buffers.pop_back();
+      state.reuse_count++;
+    }
+    return buffer;
+  }
+
+  // Returns |buffer| to the pool of the calling thread, subject to the trim
+  // policy of the thread.
+  static void Release(Buffer&& buffer) {
+    State& state = GetState();
+    const std::size_t capacity = buffer.capacity();
+    if (capacity > state.policy.max_capacity) {
+      state.high_water_mark = state.policy.max_capacity;
+      return;
+    }
+
+    state.high_water_mark = std::max(state.high_water_mark, capacity);
+    if (state.buffers.size() < state.policy.max_buffers && capacity > 0) {
+      buffer.clear();
+      state.buffers.push_back(std::move(buffer));
+    }
+  }
+
+  // Frees every idle buffer of the calling thread and resets its high-water
+  // mark.
+  static void Trim() {
+    State& state = GetState();
+    state.buffers.clear();
+    state.buffers.shrink_to_fit();
+    state.high_water_mark = 0;
+  }
+
+  // Sets the trim policy of the calling thread. Idle buffers that exceed the
+  // new limits are freed.
+  static void SetTrimPolicy(const ScratchTrimPolicy& policy) {
+    State& state = GetState();
+    state.policy = policy;
+    state.high_water_mark =
+        std::min(state.high_water_mark, state.policy.max_capacity);
+    state.buffers.erase(
+        std::remove_if(state.buffers.begin(), state.buffers.end(),
+                       [&policy](const Buffer& buffer) {
+                         return buffer.capacity() > policy.max_capacity;
+                       }),
+        state.buffers.end());
+    if (state.buffers.size() > state.policy.max_buffers)
+      state.buffers.resize(state.policy.max_buffers);
+  }
+
+  static ScratchTrimPolicy trim_policy() { return GetState().policy; }
+
+  // Returns the number of idle buffers in the pool of the calling thread.
+  static std::size_t idle_count() { return GetState().buffers.size(); }
+
+  // Returns the capacity given to newly allocated buffers.
+  static std::size_t high_water_mark() { return GetState().high_water_mark; }
+
+  // Returns the statistics of the pool of the calling thread.
+  static ScratchPoolStats stats() {
+    const State& state = GetState();
+    ScratchPoolStats stats;
+    for (const Buffer& buffer : state.buffers)
+      stats.bytes_held += buffer.capacity();
+    stats.high_water_mark = state.high_water_mark;
+    stats.acquire_count = state.acquire_count;
+    stats.reuse_count = state.reuse_count;
+    return stats;
+  }
+
+  // Resets the acquire and reuse counts of the calling thread, for example to
+  // measure the reuse rate over an interval.
+  static void ResetStats() {
+    State& state = GetState();
+    state.acquire_count = 0;
+    state.reuse_count = 0;
+  }
+
+ private:
+  using State = detail::ScratchState<Allocator>;
+
+  ScratchPool() = delete;
+
+  static State& GetState() {
+    ThreadLocal<State, Slot> state{ScratchTrimPolicy{}};
+    return state.Get();
+  }
+};
+
+// ScratchWriter is a VectorWriter whose buffer comes from a ScratchPool. The
+// buffer is returned to the pool when the writer is destroyed or Release() is
+// called, after which the writer is empty and acquires a new buffer as needed.
+template <typename Slot = ThreadLocalIndexSlot<0>,
+          typename Allocator = std::allocator<std::uint8_t>>
+class ScratchWriter {
+  using Pool = ScratchPool<Slot, Allocator>;
+  using Writer = BasicVectorWriter<Allocator>;
+
+ public:
+  ScratchWriter() : writer_{Pool::Acquire()} {}
+  ScratchWriter(ScratchWriter&& other) : writer_{std::move(other.writer_)} {
+    other.writer_ = Writer{};
+  }
+  ~ScratchWriter() { Release(); }
+
+  ScratchWriter& operator=(ScratchWriter&& other) {
+    if (this != &other) {
+      Release();
+      writer_ = std::move(other.writer_);
+      other.writer_ = Writer{};
+    }
+    return *this;
+  }
+
+  Status<void> Prepare(std::size_t size) { return writer_.Prepare(size); }
+
+  Status<void> Write(std::uint8_t byte) { return writer_.Write(byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    return writer_.Write(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return writer_.Skip(padding_bytes, padding_value);
+  }
+
+  Status<void> Borrow(void** data, std::size_t size) {
+    return writer_.Borrow(data, size);
+  }
+
+  void Truncate(std::size_t size) { writer_.Truncate(size); }
+
+  // Returns the buffer to the pool of the calling thread.
+  void Release() {
+    typename Pool::Buffer buffer = writer_.take();
+    writer_ = Writer{};
+    if (buffer.capacity() > 0)
+      Pool::Release(std::move(buffer));
+  }
+
+  void clear() { writer_.clear(); }
+
+  const typename Pool::Buffer& data() const { return writer_.data(); }
+  std::size_t size() const { return writer_.size(); }
+  bool empty() const { return writer_.empty(); }
+
+ private:
+  Writer writer_;
+
+  ScratchWriter(const ScratchWriter&) = delete;
+  ScratchWriter& operator=(const ScratchWriter&) = delete;
+};
+
+// ScratchBuffer is scratch space for readers, such as the destination of a
+// frame before it is decoded with a BufferReader. The buffer comes from a
+// ScratchPool and is returned to it when the ScratchBuffer is destroyed.
+template <typename Slot = ThreadLocalIndexSlot<0>,
+          typename Allocator = std::allocator<std::uint8_t>>
+class ScratchBuffer {
+  using Pool = ScratchPool<Slot, Allocator>;
+
+ public:
+  explicit ScratchBuffer(std::size_t size = 0) : buffer_{Pool::Acquire()} {
+    buffer_.resize(size);
+  }
+  ScratchBuffer(ScratchBuffer&& other) : buffer_{std::move(other.buffer_)} {
+    other.buffer_.clear();
+  }
+  ~ScratchBuffer() { Release(); }
+
+  ScratchBuffer& operator=(ScratchBuffer&& other) {
+    if (this != &other) {
+      Release();
+      buffer_ = std::move(other.buffer_);
+      other.buffer_.clear();
+    }
+    return *this;
+  }
+
+  // Resizes the buffer to |size| bytes. The contents of the buffer are
+  // unspecified afterwards.
+  void resize(std::size_t size) { buffer_.resize(size); }
+
+  // Returns the buffer to the pool of the calling thread.
+  void Release() {
+    typename Pool::Buffer buffer = std::move(buffer_);
+    buffer_ = typename Pool::Buffer{};
+    if (buffer.capacity() > 0)
+      Pool::Release(std::move(buffer));
+  }
+
+  std::uint8_t* data() { return buffer_.data(); }
+  const std::uint8_t* data() const { return buffer_.data(); }
+  std::size_t size() const { return buffer_.size(); }
+  bool empty() const { return buffer_.empty(); }
+
+ private:
+  typename Pool::Buffer buffer_;
+
+  ScratchBuffer(const ScratchBuffer&) = delete;
+  ScratchBuffer& operator=(const ScratchBuffer&) = delete;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_SCRATCH_POOL_H_
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_SEGMENTED_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_SEGMENTED_READER_H_
+
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <nop/base/utility.h>
+#include <nop/status.h>
+
+namespace nop {
+
+// SegmentedReader is a reader type that reads from a chain of non-contiguous
+// buffers, such as the packet buffers of a network stack or the iovecs filled
+// by readv(2), without first coalescing them into one buffer. Reads that fall
+// within one segment are a single copy out of the segment; only reads that
+// straddle a segment boundary take the slower path across segments.
+//
+// Borrow() lends out the segment memory directly when the borrowed range lies
+// within one segment, so borrowed types such as StringView and Span reference
+// the input without copying. Ranges that straddle a boundary are coalesced
+// into storage owned by the reader, which remains valid for the lifetime of
+// the reader.
+//
+// Every read is bounds checked, so unlike BufferReader this type is safe for
+// use directly without Ensure(). The segment array and the memory it refers to
+// must outlive the reader.
+//
+// Example:
+//
+//  struct iovec segments[kMaxSegments];
+//  const std::size_t count = FillSegments(packet_chain, segments);
+//  Deserializer<SegmentedReader> deserializer{segments, count};
+//  auto status = deserializer.Read(&message);
+//
+class SegmentedReader {
+ public:
+  SegmentedReader() = default;
+  SegmentedReader(const struct iovec* segments, std::size_t count)
+      : segments_{segments}, count_{count} {
+    for (std::size_t i = 0; i < count_; i++)
+      remaining_ += segments_[i].iov_len;
+
+    if (count_ > 0)
+      Load(0);
+  }
+
+  SegmentedReader(const SegmentedReader&) = delete;
+  SegmentedReader(SegmentedReader&&) = default;
+  SegmentedReader& operator=(const SegmentedReader&) = delete;
+  SegmentedReader& operator=(SegmentedReader&&) = default;
+
+  Status<void> Ensure(std::size_t size) {
+    if (remaining_ < size)
+      return ErrorStatus::ReadLimitReached;
+    else
+      return {};
+  }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    const std::size_t length_bytes = (end - begin) * sizeof(T);
+    if (length_bytes <= contiguous()) {
+      std::memcpy(begin, data_ + offset_, length_bytes);
+      Consume(length_bytes);
+      return {};
+    }
+
+    return ReadSegments(reinterpret_cast<std::uint8_t*>(begin), length_bytes);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    if (padding_bytes > remaining_)
+      return ErrorStatus::ReadLimitReached;
+
+    while (padding_bytes > 0) {
+      const std::size_t size = std::min(padding_bytes, contiguous());
+      Consume(size);
+      padding_bytes -= size;
+    }
+    return {};
+  }
+
+  // Stores a pointer to the next |size| bytes in |data| and advances past
+  // them. The pointer refers to the segment when the bytes lie within one
+  // segment and to a coalesced copy otherwise.
+  Status<void> Borrow(const void** data, std::size_t size) {
+    if (size <= contiguous()) {
+      *data = data_ + offset_;
+      Consume(size);
+      return {};
+    }
+
+    if (size > remaining_)
+      return ErrorStatus::ReadLimitReached;
+
+    coalesced_.emplace_back(size);
+    std::uint8_t* copy = coalesced_.back().data();
+    auto status = ReadSegments(copy, size);
+    if (!status)
+      return status;
+
+    *data = copy;
+    return {};
+  }
+
+  bool empty() const { return remaining_ == 0; }
+
+  // Returns the total number of bytes left in all of the segments.
+  std::size_t remaining() const { return remaining_; }
+
+  // Returns the number of bytes left in the current segment, which may be read
+  // or borrowed without crossing a segment boundary.
+  std::size_t contiguous() const { return size_ - offset_; }
+
+ private:
+  // Makes segment |index| current, skipping empty segments.
+  void Load(std::size_t index) {
+    while (index + 1 < count_ && segments_[index].iov_len == 0)
+      index++;
+
+    index_ = index;
+    data_ = static_cast<const std::uint8_t*>(segments_[index].iov_base);
+    size_ = segments_[index].iov_len;
+    offset_ = 0;
+  }
+
+  // Advances by |size| bytes, which must not exceed contiguous().
+  void Consume(std::size_t size) {
+    offset_ += size;
+    remaining_ -= size;
+    if (offset_ == size_ && index_ + 1 < count_)
+      Load(index_ + 1);
+  }
+
+  Status<void> ReadSegments(std::uint8_t* destination, std::size_t size) {
+    if (size > remaining_)
+      return ErrorStatus::ReadLimitReached;
+
+    while (size > 0) {
+      const std::size_t length = std::min(size, contiguous());
+      std::memcpy(destination, data_ + offset_, length);
+      Consume(length);
+      destination += length;
+      size -= length;
+    }
+    return {};
+  }
+
+  const struct iovec* segments_{nullptr};
+  std::size_t count_{0};
+  std::size_t index_{0};
+  const std::uint8_t* data_{nullptr};
+  std::size_t size_{0};
+  std::size_t offset_{0};
+  std::size_t remaining_{0};
+
+  // Copies of borrowed ranges that straddle segment boundaries.
+  std::vector<std::vector<std::uint8_t>> coalesced_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_SEGMENTED_READER_H_
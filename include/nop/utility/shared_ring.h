@@ -0,0 +1,151 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_SHARED_RING_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_SHARED_RING_H_
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+namespace nop {
+
+// SharedRing describes a lock-free single-producer/single-consumer ring buffer
+// of variable-length records inside a shared memory region, such as one
+// obtained from shm_open(3) or memfd_create(2) and mapped with MAP_SHARED in
+// both processes. SharedRingWriter and SharedRingReader use this type to
+// exchange messages; it is a non-owning view of the region and is cheap to
+// copy.
+//
+// The region starts with a control block followed by the record area, whose
+// size is the largest power of two that fits. Each record is a header holding
+// the payload length followed by the payload, padded to a multiple of
+// kAlignment. A record never wraps around the end of the record area: when it
+// does not fit, the writer fills the rest of the area with a padding record and
+// starts again at the beginning.
+//
+// Exactly one process must call Initialize() before the ring is used.
+class SharedRing {
+ public:
+  enum : std::size_t { kAlignment = 8, kRecordHeaderSize = 8 };
+  enum : std::uint32_t { kPaddingRecord = 1 };
+
+  struct RecordHeader {
+    std::uint32_t length;
+    std::uint32_t flags;
+  };
+
+  struct alignas(64) Control {
+    // Position of the next record to read. Written only by the consumer.
+    alignas(64) std::atomic<std::uint64_t> head;
+    // Position past the last published record. Written only by the producer.
+    alignas(64) std::atomic<std::uint64_t> tail;
+    // Futex word bumped by the producer to wake an idle consumer.
+    alignas(64) std::atomic<std::uint32_t> wake_sequence;
+    std::atomic<std::uint32_t> consumer_waiting;
+    std::atomic<std::uint32_t> closed;
+  };
+
+  static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+                "SharedRing requires lock-free 64-bit atomics.");
+  static_assert(sizeof(RecordHeader) == kRecordHeaderSize,
+                "RecordHeader must be kRecordHeaderSize bytes.");
+
+  SharedRing() = default;
+  SharedRing(void* memory, std::size_t size)
+      : control_{static_cast<Control*>(memory)},
+        data_{static_cast<std::uint8_t*>(memory) + sizeof(Control)},
+        capacity_{FloorPowerOfTwo(size < sizeof(Control)
+                                      ? 0
+                                      : size - sizeof(Control))} {}
+
+  // Constructs the control block in the region and returns false if the region
+  // is too small to hold a ring.
+  bool Initialize() {
+    if (capacity_ < 2 * kRecordHeaderSize)
+      return false;
+
+    new (control_) Control{};
+    control_->head.store(0, std::memory_order_relaxed);
+    control_->tail.store(0, std::memory_order_relaxed);
+    control_->wake_sequence.store(0, std::memory_order_relaxed);
+    control_->consumer_waiting.store(0, std::memory_order_relaxed);
+    control_->closed.store(0, std::memory_order_release);
+    return true;
+  }
+
+  // Returns the region size needed for a record area of |capacity| bytes.
+  static constexpr std::size_t RegionSize(std::size_t capacity) {
+    return sizeof(Control) + capacity;
+  }
+
+  static constexpr std::size_t RecordSize(std::size_t length) {
+    return kRecordHeaderSize + (length + kAlignment - 1) / kAlignment *
+                                   kAlignment;
+  }
+
+  Control* control() const { return control_; }
+  std::uint8_t* data() const { return data_; }
+  std::size_t capacity() const { return capacity_; }
+  bool is_valid() const { return control_ && capacity_ > 0; }
+
+  // Returns the offset into the record area of |position|.
+  std::size_t Offset(std::uint64_t position) const {
+    return static_cast<std::size_t>(position & (capacity_ - 1));
+  }
+
+  // Wakes the consumer if it is idle.
+  void WakeConsumer() const {
+    if (control_->consumer_waiting.load(std::memory_order_seq_cst)) {
+      control_->wake_sequence.fetch_add(1, std::memory_order_seq_cst);
+      Futex(FUTEX_WAKE, 1);
+    }
+  }
+
+  // Blocks the consumer until the producer bumps the wake sequence from
+  // |sequence|.
+  void WaitConsumer(std::uint32_t sequence) const {
+    Futex(FUTEX_WAIT, sequence);
+  }
+
+ private:
+  static constexpr std::size_t FloorPowerOfTwo(std::size_t value) {
+    std::size_t power = 1;
+    while (value && power <= value / 2)
+      power *= 2;
+    return value ? power : 0;
+  }
+
+  void Futex(int operation, std::uint32_t value) const {
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(
+                             &control_->wake_sequence),
+              operation, value, nullptr, nullptr, 0);
+  }
+
+  Control* control_{nullptr};
+  std::uint8_t* data_{nullptr};
+  std::size_t capacity_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_SHARED_RING_H_
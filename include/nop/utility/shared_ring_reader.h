@@ -0,0 +1,185 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_SHARED_RING_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_SHARED_RING_READER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/utility/shared_ring.h>
+
+namespace nop {
+
+// SharedRingReader is a reader type that deserializes directly from the record
+// area of a SharedRing, acting as its single consumer. Each record published by
+// SharedRingWriter holds one value; a value may not span records. The space of
+// a record is returned to the producer as soon as the last byte is read.
+//
+// When no record is available the reader spins briefly before sleeping on a
+// futex, so that a busy consumer does not enter the kernel and an idle one does
+// not burn a core. Once the writer closes the ring and every published record
+// has been consumed the reader returns ErrorStatus::ReadLimitReached.
+class SharedRingReader {
+ public:
+  enum : std::size_t { kDefaultSpinCount = 1000 };
+
+  SharedRingReader() = default;
+  SharedRingReader(const SharedRing& ring,
+                   std::size_t spin_count = kDefaultSpinCount)
+      : ring_{ring}, spin_count_{spin_count} {}
+  SharedRingReader(const SharedRingReader&) = delete;
+  SharedRingReader(SharedRingReader&&) = default;
+
+  SharedRingReader& operator=(const SharedRingReader&) = delete;
+  SharedRingReader& operator=(SharedRingReader&&) = default;
+
+  Status<void> Ensure(std::size_t size) {
+    // Empty reads, such as the payload of an empty string, must not wait for
+    // the next record once the current one has been released.
+    if (size == 0)
+      return {};
+
+    if (!open_) {
+      auto status = Open();
+      if (!status)
+        return status;
+    }
+
+    if (length_ - index_ < size)
+      return ErrorStatus::ReadLimitReached;
+    else
+      return {};
+  }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    const std::size_t element_size = sizeof(T);
+    const std::size_t length = end - begin;
+    const std::size_t length_bytes = length * element_size;
+
+    auto status = Ensure(length_bytes);
+    if (!status)
+      return status;
+
+    std::memcpy(begin, record_ + index_, length_bytes);
+    Advance(length_bytes);
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    auto status = Ensure(padding_bytes);
+    if (!status)
+      return status;
+
+    Advance(padding_bytes);
+    return {};
+  }
+
+  // Returns the number of unread bytes in the current record.
+  std::size_t remaining() const { return length_ - index_; }
+
+ private:
+  void Advance(std::size_t size) {
+    index_ += size;
+    if (open_ && index_ == length_)
+      Release(position_ + SharedRing::RecordSize(length_));
+  }
+
+  void Release(std::uint64_t head) {
+    position_ = head;
+    ring_.control()->head.store(head, std::memory_order_release);
+    open_ = false;
+  }
+
+  // Opens the next data record, skipping padding records and waiting for the
+  // producer as necessary.
+  Status<void> Open() {
+    if (!ring_.is_valid())
+      return ErrorStatus::ReadLimitReached;
+
+    SharedRing::Control* control = ring_.control();
+    while (true) {
+      if (control->tail.load(std::memory_order_acquire) == position_) {
+        auto status = Wait();
+        if (!status)
+          return status;
+        continue;
+      }
+
+      const std::uint8_t* record = ring_.data() + ring_.Offset(position_);
+      SharedRing::RecordHeader header;
+      std::memcpy(&header, record, sizeof(header));
+
+      if (header.flags & SharedRing::kPaddingRecord) {
+        Release(position_ + SharedRing::kRecordHeaderSize + header.length);
+      } else if (header.length == 0) {
+        Release(position_ + SharedRing::kRecordHeaderSize);
+      } else {
+        record_ = record + SharedRing::kRecordHeaderSize;
+        length_ = header.length;
+        index_ = 0;
+        open_ = true;
+        return {};
+      }
+    }
+  }
+
+  // Waits for the producer to publish more data or close the ring.
+  Status<void> Wait() {
+    SharedRing::Control* control = ring_.control();
+    for (std::size_t i = 0; i < spin_count_; i++) {
+      if (control->tail.load(std::memory_order_acquire) != position_)
+        return {};
+    }
+
+    const std::uint32_t sequence =
+        control->wake_sequence.load(std::memory_order_seq_cst);
+    control->consumer_waiting.store(1, std::memory_order_seq_cst);
+
+    // Check for closure before emptiness: the writer publishes its last
+    // record before closing, so a closed ring that is empty here stays empty.
+    const bool closed = control->closed.load(std::memory_order_seq_cst);
+    const bool empty =
+        control->tail.load(std::memory_order_seq_cst) == position_;
+    if (empty && !closed)
+      ring_.WaitConsumer(sequence);
+
+    control->consumer_waiting.store(0, std::memory_order_relaxed);
+    if (empty && closed)
+      return ErrorStatus::ReadLimitReached;
+    else
+      return {};
+  }
+
+  SharedRing ring_;
+  std::size_t spin_count_{kDefaultSpinCount};
+  std::uint64_t position_{0};
+  const std::uint8_t* record_{nullptr};
+  std::size_t length_{0};
+  std::size_t index_{0};
+  bool open_{false};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_SHARED_RING_READER_H_
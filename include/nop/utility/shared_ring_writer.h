@@ -0,0 +1,196 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_SHARED_RING_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_SHARED_RING_WRITER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/utility/shared_ring.h>
+
+namespace nop {
+
+// SharedRingWriter is a writer type that serializes directly into the record
+// area of a SharedRing, acting as its single producer. Prepare() reserves a
+// contiguous record for the value, wrapping to the start of the ring with a
+// padding record when necessary, and Flush() publishes the record to the
+// consumer. The library-provided Serializer types call Flush() at the end of
+// every top-level Write(), so each serialized value becomes one record.
+//
+// The writer never blocks: when the ring does not have room for a record the
+// writer returns ErrorStatus::WriteLimitReached without writing anything, and
+// the caller may try again after the consumer catches up. The consumer is only
+// woken by a system call when it is idle.
+//
+// Destroying the writer or calling Close() marks the ring closed, after which
+// the reader reports ErrorStatus::ReadLimitReached once it has consumed every
+// published record.
+class SharedRingWriter {
+ public:
+  SharedRingWriter() = default;
+  SharedRingWriter(const SharedRing& ring) : ring_{ring} {}
+  SharedRingWriter(const SharedRingWriter&) = delete;
+  SharedRingWriter(SharedRingWriter&& other) { *this = std::move(other); }
+
+  ~SharedRingWriter() { Close(); }
+
+  SharedRingWriter& operator=(const SharedRingWriter&) = delete;
+  SharedRingWriter& operator=(SharedRingWriter&& other) {
+    if (this != &other) {
+      Close();
+      std::swap(ring_, other.ring_);
+      std::swap(position_, other.position_);
+      std::swap(reserved_, other.reserved_);
+      std::swap(written_, other.written_);
+      std::swap(open_, other.open_);
+    }
+    return *this;
+  }
+
+  // Publishes any open record and marks the ring closed.
+  void Close() {
+    if (!ring_.is_valid())
+      return;
+
+    Flush();
+    ring_.control()->closed.store(1, std::memory_order_seq_cst);
+    ring_.WakeConsumer();
+    ring_ = {};
+  }
+
+  Status<void> Prepare(std::size_t size) { return Reserve(size); }
+
+  Status<void> Write(std::uint8_t byte) { return Write(&byte, &byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::size_t element_size = sizeof(T);
+    const std::size_t length = end - begin;
+    const std::size_t length_bytes = length * element_size;
+
+    if (written_ + length_bytes > reserved_ || !open_) {
+      auto status = Reserve(length_bytes);
+      if (!status)
+        return status;
+    }
+
+    std::memcpy(Payload() + written_, begin, length_bytes);
+    written_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    if (written_ + padding_bytes > reserved_ || !open_) {
+      auto status = Reserve(padding_bytes);
+      if (!status)
+        return status;
+    }
+
+    std::memset(Payload() + written_, padding_value, padding_bytes);
+    written_ += padding_bytes;
+    return {};
+  }
+
+  // Publishes the open record, if any, and wakes the consumer if it is idle.
+  Status<void> Flush() {
+    if (!open_)
+      return {};
+
+    const SharedRing::RecordHeader header{
+        static_cast<std::uint32_t>(written_), 0};
+    std::memcpy(ring_.data() + ring_.Offset(position_), &header,
+                sizeof(header));
+    Publish(position_ + SharedRing::RecordSize(written_));
+
+    reserved_ = written_ = 0;
+    open_ = false;
+    return {};
+  }
+
+ private:
+  std::uint8_t* Payload() const {
+    return ring_.data() + ring_.Offset(position_) +
+           SharedRing::kRecordHeaderSize;
+  }
+
+  void Publish(std::uint64_t tail) {
+    ring_.control()->tail.store(tail, std::memory_order_seq_cst);
+    ring_.WakeConsumer();
+  }
+
+  // Makes sure the open record, or a new one, has room for |size| more bytes.
+  Status<void> Reserve(std::size_t size) {
+    if (!ring_.is_valid())
+      return ErrorStatus::WriteLimitReached;
+
+    const std::size_t capacity = ring_.capacity();
+    const std::size_t record_size = SharedRing::RecordSize(written_ + size);
+    if (record_size > capacity)
+      return ErrorStatus::WriteLimitReached;
+
+    SharedRing::Control* control = ring_.control();
+    const std::uint64_t head = control->head.load(std::memory_order_acquire);
+    std::uint64_t tail =
+        open_ ? position_ : control->tail.load(std::memory_order_relaxed);
+
+    // Records are contiguous; when this one would cross the end of the ring,
+    // pad out the remainder and start over at the beginning.
+    const std::size_t offset = ring_.Offset(tail);
+    const std::size_t padding_size =
+        offset + record_size > capacity ? capacity - offset : 0;
+    if (tail + padding_size + record_size - head > capacity)
+      return ErrorStatus::WriteLimitReached;
+
+    if (padding_size) {
+      const std::uint8_t* payload = Payload();
+      const SharedRing::RecordHeader header{
+          static_cast<std::uint32_t>(padding_size -
+                                     SharedRing::kRecordHeaderSize),
+          SharedRing::kPaddingRecord};
+      std::memcpy(ring_.data() + offset, &header, sizeof(header));
+      tail += padding_size;
+
+      // Move any bytes already written to the new location of the record.
+      if (open_ && written_) {
+        std::memmove(ring_.data() + SharedRing::kRecordHeaderSize, payload,
+                     written_);
+      }
+      Publish(tail);
+    }
+
+    position_ = tail;
+    reserved_ = record_size - SharedRing::kRecordHeaderSize;
+    open_ = true;
+    return {};
+  }
+
+  SharedRing ring_;
+  std::uint64_t position_{0};
+  std::size_t reserved_{0};
+  std::size_t written_{0};
+  bool open_{false};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_SHARED_RING_WRITER_H_
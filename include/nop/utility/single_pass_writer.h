@@ -0,0 +1,122 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_SINGLE_PASS_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_SINGLE_PASS_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// SinglePassWriter is a writer adapter that opts a seekable writer into
+// single-pass serialization. The library-provided Serializer types skip the
+// Size() walk that normally precedes each top-level Write(), and table entries
+// are written with a reserved, fixed-width size field that is patched once the
+// entry has been written instead of computing the size of each entry up front.
+//
+// The output is a valid encoding that any reader accepts, but table entry sizes
+// always take nine bytes. The wrapped writer must check bounds on every write,
+// since it is no longer prepared with the size of each value, and must support
+// seeking back with the following methods:
+//
+//   Status<std::size_t> Tell();
+//   Status<void> Patch(std::size_t position, const void* data,
+//                      std::size_t size);
+//
+// PedanticBufferWriter and StreamWriter over seekable streams meet these
+// requirements.
+template <typename Writer>
+class SinglePassWriter {
+ public:
+  enum : std::size_t { kSizeFieldSize = 1 + sizeof(SizeType) };
+
+  template <typename... Args>
+  SinglePassWriter(Args&&... args) : writer_{std::forward<Args>(args)...} {}
+  SinglePassWriter(SinglePassWriter&&) = default;
+  SinglePassWriter& operator=(SinglePassWriter&&) = default;
+
+  Status<void> Prepare(std::size_t size) { return writer_.Prepare(size); }
+
+  Status<void> Write(std::uint8_t byte) { return writer_.Write(byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    return writer_.Write(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return writer_.Skip(padding_bytes, padding_value);
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    return writer_.PushHandle(handle);
+  }
+
+  template <typename W = Writer>
+  auto Flush() -> decltype(std::declval<W&>().Flush()) {
+    return writer_.Flush();
+  }
+
+  // Writes a placeholder size field and returns its position for PatchSize().
+  Status<std::size_t> ReserveSize() {
+    auto position = writer_.Tell();
+    if (!position)
+      return position;
+
+    auto status = Write(static_cast<std::uint8_t>(EncodingByte::U64));
+    if (!status)
+      return status.error();
+
+    status = Encoding<SizeType>::WritePayload(EncodingByte::U64, 0, this);
+    if (!status)
+      return status.error();
+
+    return position;
+  }
+
+  // Fills in the size field at |position| with the number of bytes written
+  // since it was reserved.
+  Status<void> PatchSize(std::size_t position) {
+    auto end = writer_.Tell();
+    if (!end)
+      return end.error();
+
+    const SizeType size = end.get() - position - kSizeFieldSize;
+    return writer_.Patch(position + 1, &size, sizeof(size));
+  }
+
+  const Writer& writer() const { return writer_; }
+  Writer& writer() { return writer_; }
+  Writer&& take() { return std::move(writer_); }
+
+ private:
+  Writer writer_;
+
+  SinglePassWriter(const SinglePassWriter&) = delete;
+  SinglePassWriter& operator=(const SinglePassWriter&) = delete;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_SINGLE_PASS_WRITER_H_
@@ -18,7 +18,10 @@
 #define LIBNOP_INCLUDE_NOP_UTILITY_SIP_HASH_H_
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 #include <nop/utility/compiler.h>
 
@@ -28,6 +31,8 @@
 //
 // This version supports compile-time constexpr hash computation when provided
 // with a byte container that supports constexpr size() and operator[] methods.
+// SipHasher computes the same hash incrementally at runtime, optionally with
+// the 128-bit output of SipHash-2-4-128.
 //
 
 namespace nop {
@@ -64,6 +69,9 @@ struct HashValue {
   enum : std::uint64_t { Value = Hash_ };
 };
 
+template <std::size_t Bits>
+class SipHasher;
+
 struct SipHash {
   template <typename T, std::size_t Size>
   static constexpr std::uint64_t Compute(const T (&buffer)[Size],
@@ -139,6 +147,9 @@ struct SipHash {
   }
 
  private:
+  template <std::size_t>
+  friend class SipHasher;
+
   template <typename BufferType>
   static constexpr std::uint64_t ReadBlock(const BufferType buffer,
                                            const std::size_t offset) {
@@ -178,6 +189,140 @@ struct SipHash {
   }
 };
 
+// Incremental SipHash-2-4 over bytes supplied in any number of pieces. Whole
+// blocks are loaded with a single word access rather than byte by byte, making
+// this the faster choice for hashing data at runtime. With Bits = 64 value()
+// equals SipHash::Compute() over the same bytes and key; with Bits = 128 it
+// returns the two words of SipHash-2-4-128, low word first.
+template <std::size_t Bits = 64>
+class SipHasher {
+  static_assert(Bits == 64 || Bits == 128,
+                "SipHasher supports 64 and 128 bit output.");
+
+ public:
+  using ValueType = std::conditional_t<Bits == 64, std::uint64_t,
+                                       std::array<std::uint64_t, 2>>;
+
+  SipHasher() : SipHasher{0, 0} {}
+  SipHasher(std::uint64_t k0, std::uint64_t k1) : k0_{k0}, k1_{k1} { Reset(); }
+
+  // Folds |size| bytes at |data| into the hash.
+  void Update(const void* data, std::size_t size) {
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    length_ += size;
+
+    if (tail_size_ > 0) {
+      while (size > 0 && tail_size_ < kBlockSize) {
+        tail_[tail_size_++] = *bytes++;
+        size--;
+      }
+      if (tail_size_ < kBlockSize)
+        return;
+
+      Compress(Load(tail_));
+      tail_size_ = 0;
+    }
+
+    for (; size >= kBlockSize; size -= kBlockSize, bytes += kBlockSize)
+      Compress(Load(bytes));
+
+    if (size > 0)
+      std::memcpy(tail_, bytes, size);
+    tail_size_ = size;
+  }
+
+  // Returns the hash of the bytes folded in so far. More bytes may be folded
+  // in afterwards.
+  ValueType value() const {
+    std::uint64_t v[4] = {v_[0], v_[1], v_[2], v_[3]};
+    std::uint64_t b = static_cast<std::uint64_t>(length_) << 56;
+    for (std::size_t i = 0; i < tail_size_; i++)
+      b |= static_cast<std::uint64_t>(tail_[i]) << (8 * i);
+
+    v[3] ^= b;
+    SipHash::Round(v);
+    SipHash::Round(v);
+    v[0] ^= b;
+
+    return Finalize(v, std::integral_constant<bool, Bits == 128>{});
+  }
+
+  // Restarts the hash with the same key.
+  void Reset() {
+    v_[0] = 0x736f6d6570736575ULL ^ k0_;
+    v_[1] = 0x646f72616e646f6dULL ^ k1_;
+    v_[2] = 0x6c7967656e657261ULL ^ k0_;
+    v_[3] = 0x7465646279746573ULL ^ k1_;
+    if (Bits == 128)
+      v_[1] ^= 0xee;
+
+    length_ = 0;
+    tail_size_ = 0;
+  }
+
+  // Returns the hash of |size| bytes at |data| with the given key.
+  static ValueType Compute(const void* data, std::size_t size,
+                           std::uint64_t k0 = 0, std::uint64_t k1 = 0) {
+    SipHasher hasher{k0, k1};
+    hasher.Update(data, size);
+    return hasher.value();
+  }
+
+ private:
+  enum : std::size_t { kBlockSize = sizeof(std::uint64_t) };
+
+  // Loads a little-endian block. Compilers reduce this to a single load on
+  // little-endian targets.
+  static std::uint64_t Load(const std::uint8_t* data) {
+    std::uint8_t b[kBlockSize];
+    std::memcpy(b, data, kBlockSize);
+    return (static_cast<std::uint64_t>(b[0]) << 0) |
+           (static_cast<std::uint64_t>(b[1]) << 8) |
+           (static_cast<std::uint64_t>(b[2]) << 16) |
+           (static_cast<std::uint64_t>(b[3]) << 24) |
+           (static_cast<std::uint64_t>(b[4]) << 32) |
+           (static_cast<std::uint64_t>(b[5]) << 40) |
+           (static_cast<std::uint64_t>(b[6]) << 48) |
+           (static_cast<std::uint64_t>(b[7]) << 56);
+  }
+
+  void Compress(std::uint64_t m) {
+    v_[3] ^= m;
+    SipHash::Round(v_);
+    SipHash::Round(v_);
+    v_[0] ^= m;
+  }
+
+  static std::uint64_t Finalize(std::uint64_t (&v)[4], std::false_type) {
+    v[2] ^= 0xff;
+    for (int i = 0; i < 4; i++)
+      SipHash::Round(v);
+    return v[0] ^ v[1] ^ v[2] ^ v[3];
+  }
+
+  static std::array<std::uint64_t, 2> Finalize(std::uint64_t (&v)[4],
+                                               std::true_type) {
+    v[2] ^= 0xee;
+    for (int i = 0; i < 4; i++)
+      SipHash::Round(v);
+    const std::uint64_t low = v[0] ^ v[1] ^ v[2] ^ v[3];
+
+    v[1] ^= 0xdd;
+    for (int i = 0; i < 4; i++)
+      SipHash::Round(v);
+    const std::uint64_t high = v[0] ^ v[1] ^ v[2] ^ v[3];
+
+    return {{low, high}};
+  }
+
+  std::uint64_t k0_;
+  std::uint64_t k1_;
+  std::uint64_t v_[4];
+  std::uint64_t length_;
+  std::uint8_t tail_[kBlockSize];
+  std::size_t tail_size_;
+};
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_UTILITY_SIP_HASH_H_
@@ -17,7 +17,9 @@
 #ifndef LIBNOP_INLCUDE_NOP_UTILITY_STREAM_READER_H_
 #define LIBNOP_INLCUDE_NOP_UTILITY_STREAM_READER_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <ios>
 #include <istream>
 
 #include <nop/status.h>
@@ -59,7 +61,16 @@ class StreamReader {
   }
 
   Status<void> Skip(std::size_t padding_bytes) {
+    // Seek when the stream supports it, otherwise discard the padding in bulk.
+    // A failed seek leaves the position unchanged.
     stream_.seekg(padding_bytes, std::ios_base::cur);
+    if (stream_.fail() && !stream_.bad()) {
+      stream_.clear(stream_.rdstate() & ~std::ios_base::failbit);
+      stream_.ignore(padding_bytes);
+      if (static_cast<std::size_t>(stream_.gcount()) != padding_bytes)
+        return ErrorStatus::StreamError;
+    }
+
     return ReturnStatus();
   }
 
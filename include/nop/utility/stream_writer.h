@@ -17,7 +17,10 @@
 #ifndef LIBNOP_INLCUDE_NOP_UTILITY_STREAM_WRITER_H_
 #define LIBNOP_INLCUDE_NOP_UTILITY_STREAM_WRITER_H_
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <ostream>
 
 #include <nop/status.h>
@@ -58,21 +61,58 @@ class StreamWriter {
 
   Status<void> Skip(std::size_t padding_bytes,
                     std::uint8_t padding_value = 0x00) {
-    for (std::size_t i = 0; i < padding_bytes; i++) {
-      stream_.put(padding_value);
+    using CharType = typename OStream::char_type;
+    CharType block[kSkipBlockSize];
+    std::memset(block, padding_value,
+                std::min<std::size_t>(padding_bytes, kSkipBlockSize));
+
+    // Write the padding in blocks rather than one character at a time.
+    while (padding_bytes) {
+      const std::size_t count =
+          std::min<std::size_t>(padding_bytes, kSkipBlockSize);
+      stream_.write(block, count);
       auto status = ReturnStatus();
       if (!status)
         return status;
+
+      padding_bytes -= count;
     }
 
     return {};
   }
 
+  // Returns the position of the next byte to be written. Fails on streams that
+  // do not support seeking.
+  Status<std::size_t> Tell() {
+    const auto position = stream_.tellp();
+    if (position < 0)
+      return ErrorStatus::StreamError;
+    else
+      return {static_cast<std::size_t>(position)};
+  }
+
+  // Overwrites |size| bytes already written at |position| with |data| and
+  // returns to the end of the output.
+  Status<void> Patch(std::size_t position, const void* data,
+                     std::size_t size) {
+    using CharType = typename OStream::char_type;
+    const auto end = stream_.tellp();
+    if (end < 0)
+      return ErrorStatus::StreamError;
+
+    stream_.seekp(position);
+    stream_.write(static_cast<const CharType*>(data), size);
+    stream_.seekp(end);
+    return ReturnStatus();
+  }
+
   const OStream& stream() const { return stream_; }
   OStream& stream() { return stream_; }
   OStream&& take() { return std::move(stream_); }
 
  private:
+  enum : std::size_t { kSkipBlockSize = 256 };
+
   Status<void> ReturnStatus() {
     if (stream_.bad() || stream_.eof())
       return ErrorStatus::StreamError;
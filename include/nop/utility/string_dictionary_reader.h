@@ -0,0 +1,129 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_STRING_DICTIONARY_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_STRING_DICTIONARY_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/string_dictionary.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// StringDictionaryReader is a reader adapter that carries a
+// StringDecodeDictionary for the InternedString values read through it. The
+// dictionary lasts as long as the reader and must be limited and reset at the
+// same points in the stream as the StringDictionaryWriter that produced it.
+//
+// Example:
+//
+//  Deserializer<StringDictionaryReader<StreamReader<std::stringstream>>>
+//      deserializer;
+//  deserializer.reader().dictionary().set_limit(1024);
+//  Sample sample;
+//  while (deserializer.Read(&sample))
+//    Process(sample);
+//
+template <typename Reader>
+class StringDictionaryReader {
+ public:
+  template <typename... Args>
+  StringDictionaryReader(Args&&... args)
+      : reader_{std::forward<Args>(args)...} {}
+  StringDictionaryReader(StringDictionaryReader&&) = default;
+  StringDictionaryReader& operator=(StringDictionaryReader&&) = default;
+
+  Status<void> Ensure(std::size_t size) { return reader_.Ensure(size); }
+
+  Status<void> Read(std::uint8_t* byte) { return reader_.Read(byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    return reader_.Read(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    return reader_.Skip(padding_bytes);
+  }
+
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference handle_reference) {
+    return reader_.template GetHandle<HandleType>(handle_reference);
+  }
+
+  // Forwards borrowing to the wrapped reader, when it supports it.
+  template <typename R = Reader>
+  auto Borrow(const void** data, std::size_t size)
+      -> decltype(std::declval<R&>().Borrow(data, size)) {
+    return reader_.Borrow(data, size);
+  }
+
+  // Forwards input limits to the wrapped reader, when it supports them.
+  template <typename R = Reader>
+  auto PushLimit(std::size_t size)
+      -> decltype(std::declval<R&>().PushLimit(size)) {
+    return reader_.PushLimit(size);
+  }
+
+  template <typename R = Reader>
+  auto PopLimit(std::size_t previous)
+      -> decltype(std::declval<R&>().PopLimit(previous)) {
+    return reader_.PopLimit(previous);
+  }
+
+  template <typename R = Reader>
+  auto remaining() const -> decltype(std::declval<const R&>().remaining()) {
+    return reader_.remaining();
+  }
+
+  // Forwards the object table of the wrapped reader, when it has one.
+  template <typename R = Reader>
+  auto object_table() -> decltype(std::declval<R&>().object_table()) {
+    return reader_.object_table();
+  }
+
+  // Forwards the chunk store of the wrapped reader, when it has one.
+  template <typename R = Reader>
+  auto chunk_store() -> decltype(std::declval<R&>().chunk_store()) {
+    return reader_.chunk_store();
+  }
+
+  StringDecodeDictionary* string_dictionary() { return &dictionary_; }
+
+  const StringDecodeDictionary& dictionary() const { return dictionary_; }
+  StringDecodeDictionary& dictionary() { return dictionary_; }
+
+  const Reader& reader() const { return reader_; }
+  Reader& reader() { return reader_; }
+  Reader&& take() { return std::move(reader_); }
+
+ private:
+  Reader reader_;
+  StringDecodeDictionary dictionary_;
+
+  StringDictionaryReader(const StringDictionaryReader&) = delete;
+  StringDictionaryReader& operator=(const StringDictionaryReader&) = delete;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_STRING_DICTIONARY_READER_H_
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_STRING_DICTIONARY_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_STRING_DICTIONARY_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/string_dictionary.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// StringDictionaryWriter is a writer adapter that carries a
+// StringEncodeDictionary for the InternedString values written through it.
+// The dictionary lasts as long as the writer, spanning every value written
+// to the same Serializer, and is shared with a StringDictionaryReader on the
+// receiving end; see nop/base/string_dictionary.h.
+//
+// Values containing InternedString must be decoded in full by the receiver:
+// skipping a value, such as an unknown table entry, skips its definitions and
+// leaves the dictionaries out of step.
+//
+// Example:
+//
+//  Serializer<StringDictionaryWriter<StreamWriter<std::stringstream>>>
+//      serializer;
+//  serializer.writer().dictionary().set_limit(1024);
+//  for (const Sample& sample : samples)
+//    serializer.Write(sample);
+//
+template <typename Writer>
+class StringDictionaryWriter {
+ public:
+  template <typename... Args>
+  StringDictionaryWriter(Args&&... args)
+      : writer_{std::forward<Args>(args)...} {}
+  StringDictionaryWriter(StringDictionaryWriter&&) = default;
+  StringDictionaryWriter& operator=(StringDictionaryWriter&&) = default;
+
+  Status<void> Prepare(std::size_t size) { return writer_.Prepare(size); }
+
+  Status<void> Write(std::uint8_t byte) { return writer_.Write(byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    return writer_.Write(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return writer_.Skip(padding_bytes, padding_value);
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    return writer_.PushHandle(handle);
+  }
+
+  template <typename W = Writer>
+  auto Flush() -> decltype(std::declval<W&>().Flush()) {
+    return writer_.Flush();
+  }
+
+  // Forwards the object table of the wrapped writer, when it has one.
+  template <typename W = Writer>
+  auto object_table() -> decltype(std::declval<W&>().object_table()) {
+    return writer_.object_table();
+  }
+
+  // Forwards the chunk store of the wrapped writer, when it has one.
+  template <typename W = Writer>
+  auto chunk_store() -> decltype(std::declval<W&>().chunk_store()) {
+    return writer_.chunk_store();
+  }
+
+  StringEncodeDictionary* string_dictionary() { return &dictionary_; }
+
+  const StringEncodeDictionary& dictionary() const { return dictionary_; }
+  StringEncodeDictionary& dictionary() { return dictionary_; }
+
+  const Writer& writer() const { return writer_; }
+  Writer& writer() { return writer_; }
+  Writer&& take() { return std::move(writer_); }
+
+ private:
+  Writer writer_;
+  StringEncodeDictionary dictionary_;
+
+  StringDictionaryWriter(const StringDictionaryWriter&) = delete;
+  StringDictionaryWriter& operator=(const StringDictionaryWriter&) = delete;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_STRING_DICTIONARY_WRITER_H_
@@ -0,0 +1,394 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_TABLE_TRANSCODER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_TABLE_TRANSCODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/table.h>
+#include <nop/base/utility.h>
+#include <nop/status.h>
+#include <nop/table.h>
+#include <nop/utility/bounded_reader.h>
+#include <nop/utility/bounded_writer.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/key_index_map.h>
+
+namespace nop {
+
+//
+// TranscodeTable<From, To>() migrates an encoded table from the definition
+// From to the definition To without decoding the whole table. Each entry of
+// the input is handled according to the two definitions:
+//
+//   * Entries that To does not define, or defines as DeletedEntry, are dropped.
+//   * Entries whose value type is the same in both definitions, or that From
+//     does not define, are copied verbatim with their size prefix.
+//   * Entries whose value type changed are decoded as the From type, passed to
+//     the converter, and encoded as the To type.
+//
+// The output carries the hash of To and the number of entries written, and
+// entries keep their input order. Migrating a table whose types did not change
+// therefore costs little more than copying its bytes.
+//
+// The converter is called with the entry id, the decoded value, and the value
+// to fill in. DefaultEntryConverter assigns between implicitly convertible
+// types; derive from it to handle other changes:
+//
+//  struct RecordConverter : DefaultEntryConverter {
+//    using DefaultEntryConverter::operator();
+//    Status<void> operator()(EntryId<2>, const std::string& name,
+//                            Name* to) const {
+//      return SplitName(name, to);
+//    }
+//  };
+//
+//  auto consumed = TranscodeTable<RecordV1, RecordV2>(data, size, &writer,
+//                                                     RecordConverter{});
+//
+
+// Tag type identifying an entry id for converters.
+template <std::uint64_t Id>
+using EntryId = std::integral_constant<std::uint64_t, Id>;
+
+// Converts between entry types that are implicitly convertible.
+struct DefaultEntryConverter {
+  template <std::uint64_t Id, typename From, typename To>
+  Status<void> operator()(EntryId<Id>, const From& from, To* to) const {
+    static_assert(std::is_convertible<From, To>::value,
+                  "Entries whose type changed to an unrelated type require a "
+                  "converter for their id.");
+    *to = from;
+    return {};
+  }
+};
+
+namespace detail {
+
+enum class TranscodeAction { Drop, Copy, Convert };
+
+template <typename EntryType>
+struct TranscoderEntry;
+
+template <typename T, std::uint64_t Id_, typename Storage>
+struct TranscoderEntry<Entry<T, Id_, Storage>> {
+  using Value = T;
+  enum : std::uint64_t { Id = Id_ };
+  static constexpr bool kDeleted = std::is_same<Storage, DeletedEntry>::value;
+};
+
+// Evaluates to the entry type in |EntryList| with |Id|, or void if there is
+// none.
+template <typename EntryList, std::uint64_t Id,
+          std::size_t index = EntryList::Count>
+struct FindEntryById {
+  using Candidate = typename EntryList::template At<index - 1>::Type;
+  using Type = std::conditional_t<
+      Candidate::Id == Id, Candidate,
+      typename FindEntryById<EntryList, Id, index - 1>::Type>;
+};
+
+template <typename EntryList, std::uint64_t Id>
+struct FindEntryById<EntryList, Id, 0> {
+  using Type = void;
+};
+
+template <typename From, typename To>
+class TableTranscoder {
+ public:
+  template <typename Writer, typename Converter>
+  static Status<std::size_t> Transcode(const void* data, std::size_t size,
+                                       Writer* writer,
+                                       const Converter& converter) {
+    BufferReader reader{data, size};
+    auto status = ReadHeader(&reader);
+    if (!status)
+      return status.error();
+
+    // Count the entries to write, which precedes them in the output.
+    BufferReader count_reader = reader;
+    SizeType output_count = 0;
+    for (SizeType i = 0; i < status.get(); i++) {
+      std::uint64_t id = 0;
+      SizeType entry_size = 0;
+      auto entry_status = ReadEntryHeader(&count_reader, &id, &entry_size);
+      if (!entry_status)
+        return entry_status.error();
+
+      count_reader.Skip(entry_size);
+      if (ActionForId(id, Indices{}) != TranscodeAction::Drop)
+        output_count++;
+    }
+
+    auto write_status = WriteHeader(output_count, writer);
+    if (!write_status)
+      return write_status.error();
+
+    for (SizeType i = 0; i < status.get(); i++) {
+      std::uint64_t id = 0;
+      SizeType entry_size = 0;
+      auto entry_status = ReadEntryHeader(&reader, &id, &entry_size);
+      if (!entry_status)
+        return entry_status.error();
+
+      entry_status = TranscodeEntryForId(id, entry_size, &reader, writer,
+                                         converter, Indices{});
+      if (!entry_status)
+        return entry_status.error();
+    }
+
+    return size - reader.remaining();
+  }
+
+ private:
+  using FromList = typename EntryListTraits<From>::EntryList;
+  using ToList = typename EntryListTraits<To>::EntryList;
+
+  enum : std::size_t { Count = ToList::Count };
+  using Indices = std::make_index_sequence<Count>;
+
+  template <std::size_t index>
+  using ToEntryAt = typename ToList::template At<index>::Type;
+
+  template <std::size_t index>
+  using FromEntryAt =
+      typename FindEntryById<FromList, ToEntryAt<index>::Id>::Type;
+
+  template <std::size_t index>
+  static constexpr TranscodeAction ActionAt(std::true_type /*from_defined*/) {
+    using ToEntry = TranscoderEntry<ToEntryAt<index>>;
+    using FromEntry = TranscoderEntry<FromEntryAt<index>>;
+    return ToEntry::kDeleted ? TranscodeAction::Drop
+           : FromEntry::kDeleted ||
+                   std::is_same<typename FromEntry::Value,
+                                typename ToEntry::Value>::value
+               ? TranscodeAction::Copy
+               : TranscodeAction::Convert;
+  }
+
+  template <std::size_t index>
+  static constexpr TranscodeAction ActionAt(std::false_type /*from_defined*/) {
+    return TranscoderEntry<ToEntryAt<index>>::kDeleted ? TranscodeAction::Drop
+                                                       : TranscodeAction::Copy;
+  }
+
+  template <std::size_t index>
+  static constexpr TranscodeAction ActionAt() {
+    return ActionAt<index>(
+        std::integral_constant<bool,
+                               !std::is_void<FromEntryAt<index>>::value>{});
+  }
+
+  template <std::size_t... Is>
+  static TranscodeAction ActionForId(std::uint64_t id,
+                                     std::index_sequence<Is...>) {
+    static constexpr TranscodeAction kActions[] = {ActionAt<Is>()...};
+    static constexpr KeyIndexMap<std::uint64_t, Count> kIdMap{
+        {ToEntryAt<Is>::Id...}};
+
+    const std::size_t index = kIdMap.Find(id);
+    return index == Count ? TranscodeAction::Drop : kActions[index];
+  }
+
+  // Reads the table prefix and hash of From and returns the entry count.
+  static Status<SizeType> ReadHeader(BufferReader* reader) {
+    auto status = reader->Ensure(1);
+    if (!status)
+      return status.error();
+
+    std::uint8_t prefix = 0;
+    reader->Read(&prefix);
+    if (static_cast<EncodingByte>(prefix) != EncodingByte::Table)
+      return ErrorStatus::UnexpectedEncodingType;
+
+    std::uint64_t hash = 0;
+    status = Encoding<std::uint64_t>::Read(&hash, reader);
+    if (!status)
+      return status.error();
+    else if (hash != FromList::Hash)
+      return ErrorStatus::InvalidTableHash;
+
+    SizeType count = 0;
+    status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status.error();
+
+    return count;
+  }
+
+  static Status<void> ReadEntryHeader(BufferReader* reader, std::uint64_t* id,
+                                      SizeType* size) {
+    auto status = Encoding<std::uint64_t>::Read(id, reader);
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Read(size, reader);
+    if (!status)
+      return status;
+
+    return reader->Ensure(*size);
+  }
+
+  template <typename Writer>
+  static Status<void> WriteHeader(SizeType count, Writer* writer) {
+    auto status =
+        writer->Prepare(BaseEncodingSize(EncodingByte::Table) +
+                        Encoding<std::uint64_t>::Size(ToList::Hash) +
+                        Encoding<SizeType>::Size(count));
+    if (!status)
+      return status;
+
+    status = writer->Write(static_cast<std::uint8_t>(EncodingByte::Table));
+    if (!status)
+      return status;
+
+    status = Encoding<std::uint64_t>::Write(ToList::Hash, writer);
+    if (!status)
+      return status;
+
+    return Encoding<SizeType>::Write(count, writer);
+  }
+
+  template <typename Writer>
+  static Status<void> WriteEntryHeader(std::uint64_t id, SizeType size,
+                                       Writer* writer) {
+    auto status = writer->Prepare(Encoding<std::uint64_t>::Size(id) +
+                                  Encoding<SizeType>::Size(size) + size);
+    if (!status)
+      return status;
+
+    status = Encoding<std::uint64_t>::Write(id, writer);
+    if (!status)
+      return status;
+
+    return Encoding<SizeType>::Write(size, writer);
+  }
+
+  // Copies the entry bytes and size prefix verbatim.
+  template <std::size_t index, typename Writer, typename Converter>
+  static Status<void> TranscodeEntry(
+      SizeType size, BufferReader* reader, Writer* writer,
+      const Converter& /*converter*/,
+      std::integral_constant<TranscodeAction, TranscodeAction::Copy>) {
+    const void* data = nullptr;
+    reader->Borrow(&data, size);
+
+    auto status = WriteEntryHeader(ToEntryAt<index>::Id, size, writer);
+    if (!status)
+      return status;
+
+    const std::uint8_t* begin = static_cast<const std::uint8_t*>(data);
+    return writer->Write(begin, begin + size);
+  }
+
+  template <std::size_t index, typename Writer, typename Converter>
+  static Status<void> TranscodeEntry(
+      SizeType size, BufferReader* reader, Writer* /*writer*/,
+      const Converter& /*converter*/,
+      std::integral_constant<TranscodeAction, TranscodeAction::Drop>) {
+    return reader->Skip(size);
+  }
+
+  // Decodes the entry as the From type and encodes the converted value.
+  template <std::size_t index, typename Writer, typename Converter>
+  static Status<void> TranscodeEntry(
+      SizeType size, BufferReader* reader, Writer* writer,
+      const Converter& converter,
+      std::integral_constant<TranscodeAction, TranscodeAction::Convert>) {
+    using ToEntry = TranscoderEntry<ToEntryAt<index>>;
+    using FromValue = typename TranscoderEntry<FromEntryAt<index>>::Value;
+    using ToValue = typename ToEntry::Value;
+
+    FromValue from{};
+    auto status = ReadBoundedValue(&from, size, reader);
+    if (!status)
+      return status;
+
+    ToValue to{};
+    status = converter(EntryId<ToEntry::Id>{}, from, &to);
+    if (!status)
+      return status;
+
+    const SizeType to_size = Encoding<ToValue>::Size(to);
+    status = WriteEntryHeader(ToEntry::Id, to_size, writer);
+    if (!status)
+      return status;
+
+    // Pad out any overestimate of the size, as table entries do.
+    BoundedWriter<Writer> bounded_writer{writer, to_size};
+    status = Encoding<ToValue>::Write(to, &bounded_writer);
+    if (!status)
+      return status;
+
+    return bounded_writer.WritePadding();
+  }
+
+  template <std::size_t index, typename Writer, typename Converter>
+  static Status<void> TranscodeEntryAt(SizeType size, BufferReader* reader,
+                                       Writer* writer,
+                                       const Converter& converter) {
+    return TranscodeEntry<index>(
+        size, reader, writer, converter,
+        std::integral_constant<TranscodeAction, ActionAt<index>()>{});
+  }
+
+  // Dispatches on the entry id through a compile-time map of the ids of To,
+  // as table decoding does. Ids unknown to To are dropped.
+  template <typename Writer, typename Converter, std::size_t... Is>
+  static Status<void> TranscodeEntryForId(std::uint64_t id, SizeType size,
+                                          BufferReader* reader,
+                                          Writer* writer,
+                                          const Converter& converter,
+                                          std::index_sequence<Is...>) {
+    using Thunk = Status<void> (*)(SizeType, BufferReader*, Writer*,
+                                   const Converter&);
+    static constexpr Thunk kTranscoders[] = {
+        &TranscodeEntryAt<Is, Writer, Converter>...};
+    static constexpr KeyIndexMap<std::uint64_t, Count> kIdMap{
+        {ToEntryAt<Is>::Id...}};
+
+    const std::size_t index = kIdMap.Find(id);
+    if (index == Count)
+      return reader->Skip(size);
+    else
+      return kTranscoders[index](size, reader, writer, converter);
+  }
+};
+
+}  // namespace detail
+
+// Transcodes the table of type From encoded at the start of the |size| bytes at
+// |data| to the definition of type To, writing the result to |writer|. Returns
+// the number of input bytes consumed, so that a sequence of tables can be
+// migrated in turn.
+template <typename From, typename To, typename Writer,
+          typename Converter = DefaultEntryConverter>
+Status<std::size_t> TranscodeTable(const void* data, std::size_t size,
+                                   Writer* writer,
+                                   const Converter& converter = {}) {
+  return detail::TableTranscoder<From, To>::Transcode(data, size, writer,
+                                                      converter);
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_TABLE_TRANSCODER_H_
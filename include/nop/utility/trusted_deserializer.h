@@ -0,0 +1,205 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_TRUSTED_DESERIALIZER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_TRUSTED_DESERIALIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/utility.h>
+#include <nop/schema_fingerprint.h>
+#include <nop/status.h>
+
+namespace nop {
+
+// TrustedReader is a reader type that wraps another reader pointer and marks
+// its input as trusted, so that encodings skip validating the prefix of each
+// value and the member counts of structures. All other operations are
+// forwarded unchanged, including Ensure(), so truncated input is still
+// rejected. Reading untrusted input through this reader may produce
+// arbitrary values; use TrustedDeserializer to enable it only after the peer
+// has confirmed it uses the same definitions.
+template <typename Reader>
+class TrustedReader {
+ public:
+  constexpr TrustedReader() = default;
+  constexpr TrustedReader(const TrustedReader&) = default;
+  constexpr TrustedReader(Reader* reader) : reader_{reader} {}
+
+  constexpr TrustedReader& operator=(const TrustedReader&) = default;
+
+  constexpr Status<void> Ensure(std::size_t size) {
+    return reader_->Ensure(size);
+  }
+
+  constexpr Status<void> Read(std::uint8_t* byte) {
+    return reader_->Read(byte);
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  constexpr Status<void> Read(T* begin, T* end) {
+    return reader_->Read(begin, end);
+  }
+
+  constexpr Status<void> Skip(std::size_t padding_bytes) {
+    return reader_->Skip(padding_bytes);
+  }
+
+  // Forwards borrowing to the underlying reader, when it supports it.
+  template <typename R = Reader>
+  constexpr auto Borrow(const void** data, std::size_t size)
+      -> decltype(std::declval<R&>().Borrow(data, size)) {
+    return reader_->Borrow(data, size);
+  }
+
+  // Forwards input limits to the underlying reader, when it supports them.
+  template <typename R = Reader>
+  constexpr auto PushLimit(std::size_t size)
+      -> decltype(std::declval<R&>().PushLimit(size)) {
+    return reader_->PushLimit(size);
+  }
+
+  template <typename R = Reader>
+  constexpr auto PopLimit(std::size_t previous)
+      -> decltype(std::declval<R&>().PopLimit(previous)) {
+    return reader_->PopLimit(previous);
+  }
+
+  template <typename HandleType>
+  constexpr Status<HandleType> GetHandle(HandleReference handle_reference) {
+    return reader_->template GetHandle<HandleType>(handle_reference);
+  }
+
+  // Forwards the string dictionary of the underlying reader, when it has one.
+  template <typename R = Reader>
+  constexpr auto string_dictionary() const
+      -> decltype(std::declval<const R&>().string_dictionary()) {
+    return reader_->string_dictionary();
+  }
+
+  // Forwards the chunk store of the underlying reader, when it has one.
+  template <typename R = Reader>
+  constexpr auto chunk_store() const
+      -> decltype(std::declval<R&>().chunk_store()) {
+    return reader_->chunk_store();
+  }
+
+  // Forwards the shared object table of the underlying reader, when it has one.
+  template <typename R = Reader>
+  constexpr auto object_table() const
+      -> decltype(std::declval<const R&>().object_table()) {
+    return reader_->object_table();
+  }
+
+  // Forwards the UTF-8 validation property of the underlying reader.
+  template <typename R = Reader>
+  constexpr auto validates_utf8() const
+      -> decltype(std::declval<const R&>().validates_utf8()) {
+    return reader_->validates_utf8();
+  }
+
+  constexpr bool trusted() const { return true; }
+
+  const Reader& reader() const { return *reader_; }
+  Reader& reader() { return *reader_; }
+
+ private:
+  Reader* reader_{nullptr};
+};
+
+// TrustedDeserializer reads values of type T from an internal instance of
+// Reader. It starts out using the regular validating decode path. Once the
+// fingerprint of T received from the peer has been passed to Trust() and found
+// to be equal to the local SchemaFingerprint<T>::Value, values are read through
+// a TrustedReader, skipping the per-value prefix and member count checks.
+//
+// The fingerprint only establishes that both peers were built from the same
+// definitions; it does not authenticate the peer. Use the trusted path only
+// for connections between cooperating services.
+//
+// Example:
+//
+//  TrustedDeserializer<Request, BufferReader> deserializer{data, size};
+//  auto status = deserializer.Trust(hello.request_fingerprint);
+//  if (!status)
+//    LogVersionMismatch();  // Continues to use the validating path.
+//
+//  Request request;
+//  status = deserializer.Read(&request);
+//
+template <typename T, typename Reader>
+class TrustedDeserializer {
+  static_assert(HasSchemaFingerprint<T>::value,
+                "TrustedDeserializer requires a type with a schema "
+                "fingerprint. See SchemaFingerprint<T> for the supported "
+                "types.");
+
+ public:
+  enum : std::uint64_t { Fingerprint = SchemaFingerprint<T>::Value };
+
+  template <typename... Args>
+  constexpr TrustedDeserializer(Args&&... args)
+      : reader_{std::forward<Args>(args)...} {}
+
+  constexpr TrustedDeserializer(TrustedDeserializer&&) = default;
+  constexpr TrustedDeserializer& operator=(TrustedDeserializer&&) = default;
+
+  // Enables the trusted decode path if |peer_fingerprint| matches the local
+  // fingerprint of T. Returns ErrorStatus::VersionMismatch and disables the
+  // trusted path otherwise.
+  Status<void> Trust(std::uint64_t peer_fingerprint) {
+    trusted_ = peer_fingerprint == Fingerprint;
+    if (trusted_)
+      return {};
+    else
+      return ErrorStatus::VersionMismatch;
+  }
+
+  // Returns to the validating decode path.
+  void Distrust() { trusted_ = false; }
+
+  bool trusted() const { return trusted_; }
+
+  // Deserializes a value of type T from the reader.
+  Status<void> Read(T* value) {
+    if (trusted_) {
+      TrustedReader<Reader> reader{&reader_};
+      return Encoding<T>::Read(value, &reader);
+    } else {
+      return Encoding<T>::Read(value, &reader_);
+    }
+  }
+
+  const Reader& reader() const { return reader_; }
+  Reader& reader() { return reader_; }
+  Reader&& take() { return std::move(reader_); }
+
+ private:
+  Reader reader_;
+  bool trusted_{false};
+
+  TrustedDeserializer(const TrustedDeserializer&) = delete;
+  TrustedDeserializer& operator=(const TrustedDeserializer&) = delete;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_TRUSTED_DESERIALIZER_H_
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_UNIX_SOCKET_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_UNIX_SOCKET_READER_H_
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/types/handle.h>
+#include <nop/utility/unix_socket_writer.h>
+
+namespace nop {
+
+// UnixSocketReader is a reader type that receives messages with file handles,
+// as sent by UnixSocketWriter, from a UNIX domain socket of type SOCK_SEQPACKET
+// or SOCK_DGRAM. Each message and all of its fds are received by a single
+// recvmsg(2) into a buffer of |max_message_size| bytes; messages that do not
+// fit are reported as ErrorStatus::ReadLimitReached. A value may not span
+// messages.
+//
+// Handle references read from the stream are resolved against the fds received
+// with the current message. Each fd is transferred to the caller through the
+// handle returned by GetHandle(), and the caller becomes responsible for
+// closing it, for example by wrapping it in a UniqueFileHandle. Fds that are
+// not claimed are closed when the next message is received or the reader is
+// destroyed.
+//
+// The reader takes ownership of the socket fd and automatically closes it when
+// destroyed, unless it is released.
+class UnixSocketReader {
+ public:
+  UnixSocketReader() = default;
+  UnixSocketReader(int fd, std::size_t max_message_size = 64 * 1024)
+      : fd_{fd}, buffer_(max_message_size) {}
+  UnixSocketReader(const UnixSocketReader&) = delete;
+  UnixSocketReader(UnixSocketReader&& other) { *this = std::move(other); }
+
+  ~UnixSocketReader() { Clear(); }
+
+  UnixSocketReader& operator=(const UnixSocketReader&) = delete;
+  UnixSocketReader& operator=(UnixSocketReader&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(fd_, other.fd_);
+      std::swap(buffer_, other.buffer_);
+      std::swap(handles_, other.handles_);
+      std::swap(control_, other.control_);
+      std::swap(index_, other.index_);
+      std::swap(size_, other.size_);
+    }
+    return *this;
+  }
+
+  void Clear() {
+    ::close(fd_);
+    fd_ = -1;
+    CloseHandles();
+    index_ = size_ = 0;
+  }
+
+  int Release() {
+    const int released_fd = fd_;
+    fd_ = -1;
+    CloseHandles();
+    index_ = size_ = 0;
+    return released_fd;
+  }
+
+  Status<void> Ensure(std::size_t size) {
+    if (index_ == size_ && size > 0) {
+      auto status = Receive();
+      if (!status)
+        return status;
+    }
+
+    if (size_ - index_ < size)
+      return ErrorStatus::ReadLimitReached;
+    else
+      return {};
+  }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  Status<void> Read(void* begin, void* end) {
+    const std::size_t length_bytes = static_cast<std::uint8_t*>(end) -
+                                     static_cast<std::uint8_t*>(begin);
+    auto status = Ensure(length_bytes);
+    if (!status)
+      return status;
+
+    std::memcpy(begin, &buffer_[index_], length_bytes);
+    index_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    auto status = Ensure(padding_bytes);
+    if (!status)
+      return status;
+
+    index_ += padding_bytes;
+    return {};
+  }
+
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference handle_reference) {
+    if (handle_reference < 0)
+      return {HandleType{}};
+    else if (handle_reference >= static_cast<HandleReference>(handles_.size()))
+      return ErrorStatus::InvalidHandleReference;
+
+    int& fd = handles_[handle_reference];
+    if (fd < 0)
+      return ErrorStatus::InvalidHandleReference;
+
+    HandleType handle{fd};
+    fd = -1;
+    return {std::move(handle)};
+  }
+
+  // Returns the number of bytes remaining in the current message.
+  std::size_t remaining() const { return size_ - index_; }
+
+ private:
+  // Receives the next message and its fds, replacing the current message.
+  Status<void> Receive() {
+    CloseHandles();
+    index_ = size_ = 0;
+
+    struct iovec iov;
+    iov.iov_base = buffer_.data();
+    iov.iov_len = buffer_.size();
+
+    control_.assign(CMSG_SPACE(kMaxUnixSocketHandles * sizeof(int)), 0);
+
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control_.data();
+    msg.msg_controllen = control_.size();
+
+    ssize_t ret;
+    do {
+      ret = ::recvmsg(fd_, &msg, MSG_CMSG_CLOEXEC);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0)
+      return ErrorStatus::IOError;
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        const std::size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const std::size_t offset = handles_.size();
+        handles_.resize(offset + count);
+        std::memcpy(&handles_[offset], CMSG_DATA(cmsg), count * sizeof(int));
+      }
+    }
+
+    if (ret == 0 && handles_.empty())
+      return ErrorStatus::ReadLimitReached;
+    else if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+      return ErrorStatus::ReadLimitReached;
+
+    size_ = ret;
+    return {};
+  }
+
+  void CloseHandles() {
+    for (int fd : handles_) {
+      if (fd >= 0)
+        ::close(fd);
+    }
+    handles_.clear();
+  }
+
+  int fd_{-1};
+  std::vector<std::uint8_t> buffer_;
+  std::vector<int> handles_;
+  std::vector<std::uint8_t> control_;
+  std::size_t index_{0};
+  std::size_t size_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_UNIX_SOCKET_READER_H_
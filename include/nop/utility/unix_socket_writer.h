@@ -0,0 +1,178 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_UNIX_SOCKET_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_UNIX_SOCKET_WRITER_H_
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/types/handle.h>
+
+namespace nop {
+
+// The maximum number of fds the kernel accepts in one SCM_RIGHTS message.
+enum : std::size_t { kMaxUnixSocketHandles = 253 };
+
+// UnixSocketWriter is a writer type that sends messages with file handles over
+// a UNIX domain socket of type SOCK_SEQPACKET or SOCK_DGRAM. The bytes and the
+// fds pushed between calls to Flush() are collected and sent together by a
+// single sendmsg(2), with the fds in SCM_RIGHTS ancillary data. Handle
+// references written to the stream are indices into the fds of the message.
+//
+// The library-provided Serializer types call Flush() at the end of every
+// top-level Write(), so each serialized value becomes one message. Pushed fds
+// are not duplicated and must remain open until the message is flushed.
+//
+// The writer takes ownership of the socket fd and automatically closes it when
+// destroyed, unless it is released.
+class UnixSocketWriter {
+ public:
+  UnixSocketWriter() = default;
+  UnixSocketWriter(int fd) : fd_{fd} {}
+  UnixSocketWriter(const UnixSocketWriter&) = delete;
+  UnixSocketWriter(UnixSocketWriter&& other) { *this = std::move(other); }
+
+  ~UnixSocketWriter() { Clear(); }
+
+  UnixSocketWriter& operator=(const UnixSocketWriter&) = delete;
+  UnixSocketWriter& operator=(UnixSocketWriter&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(fd_, other.fd_);
+      std::swap(buffer_, other.buffer_);
+      std::swap(handles_, other.handles_);
+      std::swap(control_, other.control_);
+    }
+    return *this;
+  }
+
+  void Clear() {
+    ::close(fd_);
+    fd_ = -1;
+    Discard();
+  }
+
+  int Release() {
+    const int released_fd = fd_;
+    fd_ = -1;
+    Discard();
+    return released_fd;
+  }
+
+  Status<void> Prepare(std::size_t size) {
+    buffer_.reserve(buffer_.size() + size);
+    return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) {
+    buffer_.push_back(byte);
+    return {};
+  }
+
+  Status<void> Write(const void* begin, const void* end) {
+    buffer_.insert(buffer_.end(), static_cast<const std::uint8_t*>(begin),
+                   static_cast<const std::uint8_t*>(end));
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    buffer_.insert(buffer_.end(), padding_bytes, padding_value);
+    return {};
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    if (!handle)
+      return {kEmptyHandleReference};
+    else if (handles_.size() >= kMaxUnixSocketHandles)
+      return ErrorStatus::WriteLimitReached;
+
+    const HandleReference handle_reference = handles_.size();
+    handles_.push_back(handle.get());
+    return {handle_reference};
+  }
+
+  // Sends the pending bytes and fds as one message.
+  Status<void> Flush() {
+    if (buffer_.empty() && handles_.empty())
+      return {};
+
+    struct iovec iov;
+    iov.iov_base = buffer_.data();
+    iov.iov_len = buffer_.size();
+
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (!handles_.empty()) {
+      const std::size_t handles_size = handles_.size() * sizeof(int);
+      control_.assign(CMSG_SPACE(handles_size), 0);
+      msg.msg_control = control_.data();
+      msg.msg_controllen = control_.size();
+
+      struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type = SCM_RIGHTS;
+      cmsg->cmsg_len = CMSG_LEN(handles_size);
+      std::memcpy(CMSG_DATA(cmsg), handles_.data(), handles_size);
+    }
+
+    while (true) {
+      const ssize_t ret = ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+      if (ret < 0 && errno == EINTR)
+        continue;  // Interrupted by signal.
+
+      Discard();
+      if (ret < 0)
+        return ErrorStatus::IOError;
+      else
+        return {};
+    }
+  }
+
+  // Returns the number of bytes waiting to be flushed.
+  std::size_t pending() const { return buffer_.size(); }
+
+ private:
+  // Drops pending output while retaining allocated capacity.
+  void Discard() {
+    buffer_.clear();
+    handles_.clear();
+  }
+
+  int fd_{-1};
+  std::vector<std::uint8_t> buffer_;
+  std::vector<int> handles_;
+  std::vector<std::uint8_t> control_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_UNIX_SOCKET_WRITER_H_
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_UTF8_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_UTF8_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace nop {
+
+//
+// UTF-8 validation.
+//
+// ValidateUtf8() returns true if the given bytes are well-formed UTF-8 as
+// defined by the Unicode standard: no overlong forms, no surrogates, and no
+// code points above U+10FFFF. Runs of ASCII are skipped a vector at a time,
+// using AVX2 or SSE2 on x86 and NEON on ARMv8 when the compiler is configured
+// to use them, and eight bytes at a time otherwise. Multi-byte sequences are
+// checked with a scalar decoder. All paths produce identical results.
+//
+
+namespace detail {
+
+#if defined(__AVX2__)
+enum : std::size_t { kUtf8AsciiBlockSize = 32 };
+
+inline bool IsAsciiBlock(const std::uint8_t* data) {
+  const __m256i block =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+  return _mm256_movemask_epi8(block) == 0;
+}
+#elif defined(__SSE2__)
+enum : std::size_t { kUtf8AsciiBlockSize = 16 };
+
+inline bool IsAsciiBlock(const std::uint8_t* data) {
+  const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+  return _mm_movemask_epi8(block) == 0;
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+enum : std::size_t { kUtf8AsciiBlockSize = 16 };
+
+inline bool IsAsciiBlock(const std::uint8_t* data) {
+  return vmaxvq_u8(vld1q_u8(data)) < 0x80;
+}
+#else
+enum : std::size_t { kUtf8AsciiBlockSize = 8 };
+
+inline bool IsAsciiBlock(const std::uint8_t* data) {
+  std::uint64_t block;
+  std::memcpy(&block, data, sizeof(block));
+  return (block & 0x8080808080808080ull) == 0;
+}
+#endif
+
+// Validates the sequence starting at |data|, which has a lead byte of 0x80 or
+// above. Returns the length of the sequence, or zero if it is malformed or
+// truncated.
+inline std::size_t ValidateUtf8Sequence(const std::uint8_t* data,
+                                        std::size_t size) {
+  const std::uint8_t lead = data[0];
+  std::size_t length;
+  std::uint8_t low = 0x80;
+  std::uint8_t high = 0xbf;
+
+  if (lead >= 0xc2 && lead <= 0xdf) {
+    length = 2;
+  } else if (lead >= 0xe0 && lead <= 0xef) {
+    length = 3;
+    if (lead == 0xe0)
+      low = 0xa0;  // Overlong.
+    else if (lead == 0xed)
+      high = 0x9f;  // Surrogates.
+  } else if (lead >= 0xf0 && lead <= 0xf4) {
+    length = 4;
+    if (lead == 0xf0)
+      low = 0x90;  // Overlong.
+    else if (lead == 0xf4)
+      high = 0x8f;  // Above U+10FFFF.
+  } else {
+    return 0;
+  }
+
+  if (size < length)
+    return 0;
+  if (data[1] < low || data[1] > high)
+    return 0;
+  for (std::size_t i = 2; i < length; i++) {
+    if (data[i] < 0x80 || data[i] > 0xbf)
+      return 0;
+  }
+  return length;
+}
+
+}  // namespace detail
+
+// Returns true if the |size| bytes at |data| are well-formed UTF-8.
+inline bool ValidateUtf8(const void* data, std::size_t size) {
+  const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+  std::size_t index = 0;
+
+  while (index < size) {
+    if (size - index >= detail::kUtf8AsciiBlockSize &&
+        detail::IsAsciiBlock(bytes + index)) {
+      index += detail::kUtf8AsciiBlockSize;
+    } else if (bytes[index] < 0x80) {
+      index++;
+    } else {
+      const std::size_t length =
+          detail::ValidateUtf8Sequence(bytes + index, size - index);
+      if (length == 0)
+        return false;
+      index += length;
+    }
+  }
+  return true;
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_UTF8_H_
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_UTF8_VALIDATING_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_UTF8_VALIDATING_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// Utf8ValidatingReader is a reader type that wraps another reader pointer and
+// requires every decoded string of single-byte characters to be well-formed
+// UTF-8. Each string is validated as soon as its bytes have been read, so the
+// check costs no separate pass over the decoded object; malformed strings fail
+// the read with ErrorStatus::InvalidUtf8. All operations are forwarded to the
+// underlying reader.
+//
+// Example:
+//
+//  BufferReader buffer_reader{data, size};
+//  Utf8ValidatingReader<BufferReader> reader{&buffer_reader};
+//  Deserializer<Utf8ValidatingReader<BufferReader>*> deserializer{&reader};
+//  auto status = deserializer.Read(&request);
+//
+template <typename Reader>
+class Utf8ValidatingReader {
+ public:
+  constexpr Utf8ValidatingReader() = default;
+  constexpr Utf8ValidatingReader(const Utf8ValidatingReader&) = default;
+  constexpr Utf8ValidatingReader(Reader* reader) : reader_{reader} {}
+
+  constexpr Utf8ValidatingReader& operator=(const Utf8ValidatingReader&) =
+      default;
+
+  constexpr Status<void> Ensure(std::size_t size) {
+    return reader_->Ensure(size);
+  }
+
+  constexpr Status<void> Read(std::uint8_t* byte) {
+    return reader_->Read(byte);
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  constexpr Status<void> Read(T* begin, T* end) {
+    return reader_->Read(begin, end);
+  }
+
+  constexpr Status<void> Skip(std::size_t padding_bytes) {
+    return reader_->Skip(padding_bytes);
+  }
+
+  // Forwards borrowing to the underlying reader, when it supports it.
+  template <typename R = Reader>
+  constexpr auto Borrow(const void** data, std::size_t size)
+      -> decltype(std::declval<R&>().Borrow(data, size)) {
+    return reader_->Borrow(data, size);
+  }
+
+  // Forwards input limits to the underlying reader, when it supports them.
+  template <typename R = Reader>
+  constexpr auto PushLimit(std::size_t size)
+      -> decltype(std::declval<R&>().PushLimit(size)) {
+    return reader_->PushLimit(size);
+  }
+
+  template <typename R = Reader>
+  constexpr auto PopLimit(std::size_t previous)
+      -> decltype(std::declval<R&>().PopLimit(previous)) {
+    return reader_->PopLimit(previous);
+  }
+
+  template <typename HandleType>
+  constexpr Status<HandleType> GetHandle(HandleReference handle_reference) {
+    return reader_->template GetHandle<HandleType>(handle_reference);
+  }
+
+  // Forwards the string dictionary of the underlying reader, when it has one.
+  template <typename R = Reader>
+  constexpr auto string_dictionary() const
+      -> decltype(std::declval<const R&>().string_dictionary()) {
+    return reader_->string_dictionary();
+  }
+
+  // Forwards the chunk store of the underlying reader, when it has one.
+  template <typename R = Reader>
+  constexpr auto chunk_store() const
+      -> decltype(std::declval<R&>().chunk_store()) {
+    return reader_->chunk_store();
+  }
+
+  // Forwards the shared object table of the underlying reader, when it has one.
+  template <typename R = Reader>
+  constexpr auto object_table() const
+      -> decltype(std::declval<const R&>().object_table()) {
+    return reader_->object_table();
+  }
+
+  // Forwards the trusted property of the underlying reader.
+  template <typename R = Reader>
+  constexpr auto trusted() const
+      -> decltype(std::declval<const R&>().trusted()) {
+    return reader_->trusted();
+  }
+
+  constexpr bool validates_utf8() const { return true; }
+
+  // Forwards the remaining input of the underlying reader, when it reports it.
+  template <typename R = Reader>
+  constexpr auto remaining() const
+      -> decltype(std::declval<const R&>().remaining()) {
+    return reader_->remaining();
+  }
+
+  const Reader& reader() const { return *reader_; }
+  Reader& reader() { return *reader_; }
+
+ private:
+  Reader* reader_{nullptr};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_UTF8_VALIDATING_READER_H_
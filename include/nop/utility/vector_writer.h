@@ -0,0 +1,120 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_VECTOR_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_VECTOR_WRITER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// A writer type that appends to a std::vector of bytes, growing it as needed.
+// The vector keeps its capacity when cleared, so a writer that is reused for
+// similar values stops allocating after the first few. The vector uses the
+// given Allocator, which VectorWriter leaves as std::allocator.
+template <typename Allocator = std::allocator<std::uint8_t>>
+class BasicVectorWriter {
+ public:
+  using Buffer = std::vector<std::uint8_t, Allocator>;
+
+  BasicVectorWriter() = default;
+  BasicVectorWriter(const BasicVectorWriter&) = default;
+  BasicVectorWriter(BasicVectorWriter&&) = default;
+
+  // Takes the storage of |data| for reuse. Any bytes it holds are discarded.
+  explicit BasicVectorWriter(Buffer&& data) : data_{std::move(data)} {
+    data_.clear();
+  }
+
+  BasicVectorWriter& operator=(const BasicVectorWriter&) = default;
+  BasicVectorWriter& operator=(BasicVectorWriter&&) = default;
+
+  Status<void> Prepare(std::size_t size) {
+    // Grow geometrically: reserving exactly the requested size on every call
+    // would reallocate for each value appended to a long buffer.
+    const std::size_t required = data_.size() + size;
+    if (required > data_.capacity())
+      data_.reserve(std::max(required, 2 * data_.capacity()));
+    return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) {
+    data_.push_back(byte);
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(begin);
+    data_.insert(data_.end(), bytes, bytes + (end - begin) * sizeof(T));
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    data_.insert(data_.end(), padding_bytes, padding_value);
+    return {};
+  }
+
+  // Grows the vector by |size| bytes and stores a pointer to them in |data| for
+  // the caller to fill in directly. The pointer is invalidated by the next
+  // operation that grows the vector.
+  Status<void> Borrow(void** data, std::size_t size) {
+    auto status = Prepare(size);
+    if (!status)
+      return status;
+
+    const std::size_t offset = data_.size();
+    data_.resize(offset + size);
+    *data = data_.data() + offset;
+    return {};
+  }
+
+  // Discards every byte written after the first |size| bytes, for example to
+  // back out a value that failed part way through writing.
+  void Truncate(std::size_t size) {
+    if (size < data_.size())
+      data_.resize(size);
+  }
+
+  // Removes the written bytes, keeping the capacity of the vector.
+  void clear() { data_.clear(); }
+
+  const Buffer& data() const { return data_; }
+  Buffer take() { return std::move(data_); }
+  std::size_t size() const { return data_.size(); }
+  bool empty() const { return data_.empty(); }
+
+  // Writes always succeed, growing the vector as needed.
+  bool infallible() const { return true; }
+
+ private:
+  Buffer data_;
+};
+
+using VectorWriter = BasicVectorWriter<>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_VECTOR_WRITER_H_
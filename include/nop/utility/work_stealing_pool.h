@@ -0,0 +1,219 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_WORK_STEALING_POOL_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_WORK_STEALING_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace nop {
+
+// WorkStealingPool is a fixed-size thread pool in which each worker thread has
+// its own task queue. Tasks submitted from outside the pool are distributed
+// across the queues round robin, and tasks submitted by a worker go to its own
+// queue. A worker runs tasks from the back of its own queue and, when that is
+// empty, steals from the front of the other queues, so that a burst of work
+// queued behind one long task is picked up by idle workers.
+//
+// Submitting, taking, and finishing a task only lock the queue involved; the
+// pool-wide lock is taken to put an idle worker to sleep or to wake one, and
+// when the last unfinished task completes.
+//
+// Destroying the pool runs every task that has been submitted and then joins
+// the worker threads.
+class WorkStealingPool {
+ public:
+  using Task = std::function<void()>;
+
+  explicit WorkStealingPool(std::size_t thread_count = DefaultThreadCount()) {
+    if (thread_count == 0)
+      thread_count = 1;
+
+    for (std::size_t i = 0; i < thread_count; i++)
+      queues_.emplace_back(new Queue);
+    for (std::size_t i = 0; i < thread_count; i++)
+      threads_.emplace_back([this, i] { Run(i); });
+  }
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  void operator=(const WorkStealingPool&) = delete;
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      stop_ = true;
+    }
+    wake_.notify_all();
+
+    for (auto& thread : threads_)
+      thread.join();
+  }
+
+  // Queues |task| to run on one of the worker threads.
+  void Submit(Task task) {
+    const std::size_t index = CurrentWorker().pool == this
+                                  ? CurrentWorker().index
+                                  : next_queue_++ % queues_.size();
+    unfinished_++;
+    {
+      // Count the task in the same critical section that queues it, so that
+      // the count never falls behind the queues.
+      std::lock_guard<std::mutex> queue_lock{queues_[index]->mutex};
+      queues_[index]->tasks.push_back(std::move(task));
+      queued_++;
+    }
+
+    // A worker counts itself as sleeping before it checks queued_ under
+    // mutex_, so either it sees the task or it is seen here and woken.
+    if (sleeping_ > 0) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      wake_.notify_one();
+    }
+  }
+
+  // Blocks until every submitted task has finished running. Must not be called
+  // from a worker thread.
+  void Wait() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    idle_.wait(lock, [this] { return unfinished_ == 0; });
+  }
+
+  // Runs |function(i)| for each i in [0, count) on the worker threads and
+  // blocks until every call has returned. Unlike Wait(), this does not wait for
+  // tasks submitted by others. Must not be called from a worker thread.
+  template <typename Function>
+  void ForEach(std::size_t count, Function function) {
+    std::mutex mutex;
+    std::condition_variable done;
+    std::size_t remaining = count;
+
+    for (std::size_t i = 0; i < count; i++) {
+      Submit([&, i] {
+        function(i);
+
+        std::lock_guard<std::mutex> lock{mutex};
+        if (--remaining == 0)
+          done.notify_one();
+      });
+    }
+
+    std::unique_lock<std::mutex> lock{mutex};
+    done.wait(lock, [&] { return remaining == 0; });
+  }
+
+  std::size_t thread_count() const { return threads_.size(); }
+
+  static std::size_t DefaultThreadCount() {
+    return std::thread::hardware_concurrency();
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  struct Worker {
+    const WorkStealingPool* pool;
+    std::size_t index;
+  };
+
+  static Worker& CurrentWorker() {
+    static thread_local Worker worker{nullptr, 0};
+    return worker;
+  }
+
+  void Run(std::size_t index) {
+    CurrentWorker() = {this, index};
+
+    while (true) {
+      Task task;
+      if (Take(index, &task)) {
+        task();
+
+        if (--unfinished_ == 0) {
+          std::lock_guard<std::mutex> lock{mutex_};
+          idle_.notify_all();
+        }
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock{mutex_};
+      sleeping_++;
+      wake_.wait(lock, [this] { return stop_ || queued_ > 0; });
+      sleeping_--;
+      if (stop_ && queued_ == 0)
+        return;
+    }
+  }
+
+  // Takes a task from the back of the given worker's queue, or steals one from
+  // the front of another queue.
+  bool Take(std::size_t index, Task* task) {
+    if (Pop(index, task, /*steal=*/false))
+      return true;
+
+    for (std::size_t i = 1; i < queues_.size(); i++) {
+      if (Pop((index + i) % queues_.size(), task, /*steal=*/true))
+        return true;
+    }
+    return false;
+  }
+
+  bool Pop(std::size_t index, Task* task, bool steal) {
+    Queue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    if (queue.tasks.empty())
+      return false;
+
+    if (steal) {
+      *task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    } else {
+      *task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+    queued_--;
+    return true;
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<std::size_t> next_queue_{0};
+
+  std::atomic<std::size_t> queued_{0};
+  std::atomic<std::size_t> unfinished_{0};
+  std::atomic<std::size_t> sleeping_{0};
+
+  // Guards stop_ and the sleep and wake handshake of idle workers and Wait().
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  bool stop_{false};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_WORK_STEALING_POOL_H_
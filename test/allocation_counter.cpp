@@ -0,0 +1,82 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Trivially constructed, so that reaching it from operator new never
+// allocates.
+thread_local nop::AllocationStats g_stats{0, 0, 0};
+
+void* Allocate(std::size_t size) {
+  g_stats.allocations++;
+  g_stats.bytes += size;
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void Deallocate(void* pointer) {
+  if (pointer) {
+    g_stats.deallocations++;
+    std::free(pointer);
+  }
+}
+
+}  // anonymous namespace
+
+namespace nop {
+
+AllocationStats ThreadAllocationStats() { return g_stats; }
+
+}  // namespace nop
+
+void* operator new(std::size_t size) {
+  void* pointer = Allocate(size);
+  if (!pointer)
+    throw std::bad_alloc{};
+  return pointer;
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+
+void operator delete(void* pointer) noexcept { Deallocate(pointer); }
+void operator delete[](void* pointer) noexcept { Deallocate(pointer); }
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+  Deallocate(pointer);
+}
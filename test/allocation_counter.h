@@ -0,0 +1,99 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_TEST_ALLOCATION_COUNTER_H_
+#define LIBNOP_TEST_ALLOCATION_COUNTER_H_
+
+#include <cstddef>
+
+namespace nop {
+
+//
+// Allocation accounting for tests and benchmarks.
+//
+// allocation_counter.cpp replaces the global operator new and operator delete
+// of the binary it is linked into with versions that count the calls made by
+// each thread. AllocationCounter reports the allocations made by the current
+// thread since it was constructed, so allocations on other threads, such as
+// background writers started by other tests, are never attributed to the code
+// under test. The EXPECT and ASSERT macros below expand to gtest assertions
+// and may only be used where gtest/gtest.h is included.
+//
+// Example:
+//
+//  Status<void> status;
+//  EXPECT_NO_ALLOCATIONS(status = serializer.Write(value));
+//  ASSERT_TRUE(status);
+//
+
+// Running totals of the global allocations made by a thread.
+struct AllocationStats {
+  std::size_t allocations;
+  std::size_t deallocations;
+  std::size_t bytes;
+};
+
+// Returns the totals for the calling thread.
+AllocationStats ThreadAllocationStats();
+
+// Counts the allocations made by the current thread during its lifetime.
+class AllocationCounter {
+ public:
+  AllocationCounter() : start_{ThreadAllocationStats()} {}
+
+  std::size_t allocations() const {
+    return ThreadAllocationStats().allocations - start_.allocations;
+  }
+  std::size_t deallocations() const {
+    return ThreadAllocationStats().deallocations - start_.deallocations;
+  }
+  std::size_t bytes() const {
+    return ThreadAllocationStats().bytes - start_.bytes;
+  }
+
+ private:
+  AllocationStats start_;
+};
+
+}  // namespace nop
+
+// Evaluates |statement| and checks that it makes exactly |count| global
+// allocations. The check is non-fatal, like EXPECT_EQ.
+#define EXPECT_ALLOCATIONS(count, statement)                             \
+  do {                                                                   \
+    ::nop::AllocationCounter _nop_counter;                               \
+    statement;                                                           \
+    const std::size_t _nop_allocations = _nop_counter.allocations();     \
+    const std::size_t _nop_bytes = _nop_counter.bytes();                 \
+    EXPECT_EQ(static_cast<std::size_t>(count), _nop_allocations)         \
+        << #statement << " allocated " << _nop_bytes << " bytes";        \
+  } while (false)
+
+// Evaluates |statement| and checks that it makes no global allocations.
+#define EXPECT_NO_ALLOCATIONS(statement) EXPECT_ALLOCATIONS(0, statement)
+
+// Like EXPECT_NO_ALLOCATIONS, but returns from the test on failure.
+#define ASSERT_NO_ALLOCATIONS(statement)                                 \
+  do {                                                                   \
+    ::nop::AllocationCounter _nop_counter;                               \
+    statement;                                                           \
+    const std::size_t _nop_allocations = _nop_counter.allocations();     \
+    const std::size_t _nop_bytes = _nop_counter.bytes();                 \
+    ASSERT_EQ(0u, _nop_allocations)                                      \
+        << #statement << " allocated " << _nop_bytes << " bytes";        \
+  } while (false)
+
+#endif  // LIBNOP_TEST_ALLOCATION_COUNTER_H_
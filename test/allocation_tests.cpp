@@ -0,0 +1,181 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/types/inline_string.h>
+#include <nop/types/inline_vector.h>
+#include <nop/types/optional.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffer_writer.h>
+
+#include "allocation_counter.h"
+
+using nop::AllocationCounter;
+using nop::BufferReader;
+using nop::BufferWriter;
+using nop::Deserializer;
+using nop::InlineString;
+using nop::InlineVector;
+using nop::Optional;
+using nop::Serializer;
+using nop::Status;
+
+namespace {
+
+enum class Color : std::uint8_t { Red, Green, Blue };
+
+struct Point {
+  std::int32_t x;
+  std::int32_t y;
+
+  bool operator==(const Point& other) const {
+    return x == other.x && y == other.y;
+  }
+
+  NOP_STRUCTURE(Point, x, y);
+};
+
+struct Sample {
+  std::uint64_t id;
+  Point position;
+  std::array<float, 3> weights;
+  Color color;
+  bool valid;
+  Optional<std::int16_t> offset;
+
+  bool operator==(const Sample& other) const {
+    return id == other.id && position == other.position &&
+           weights == other.weights && color == other.color &&
+           valid == other.valid && offset == other.offset;
+  }
+
+  NOP_STRUCTURE(Sample, id, position, weights, color, valid, offset);
+};
+
+// Writes |value| to a fixed buffer and reads it back, checking that neither
+// direction allocates.
+template <typename T>
+void ExpectRoundTripWithoutAllocations(const T& value) {
+  std::uint8_t buffer[1024];
+  Serializer<BufferWriter> serializer{buffer, sizeof(buffer)};
+  Status<void> status;
+  EXPECT_NO_ALLOCATIONS(status = serializer.Write(value));
+  ASSERT_TRUE(status);
+
+  Deserializer<BufferReader> deserializer{buffer,
+                                          serializer.writer().size()};
+  T decoded{};
+  EXPECT_NO_ALLOCATIONS(status = deserializer.Read(&decoded));
+  ASSERT_TRUE(status);
+  EXPECT_TRUE(value == decoded);
+  EXPECT_TRUE(deserializer.reader().empty());
+}
+
+}  // anonymous namespace
+
+TEST(AllocationCounter, Counts) {
+  AllocationCounter counter;
+  std::unique_ptr<int> value{new int{1}};
+  EXPECT_EQ(1u, counter.allocations());
+  EXPECT_LE(sizeof(int), counter.bytes());
+  value.reset();
+  EXPECT_EQ(1u, counter.deallocations());
+
+  EXPECT_ALLOCATIONS(2, std::make_unique<int>(2); std::make_unique<int>(3));
+
+  // Allocations on other threads are not counted.
+  AllocationCounter thread_counter;
+  std::thread thread{[] { std::unique_ptr<int> other{new int{4}}; }};
+  const std::size_t allocations = thread_counter.allocations();
+  thread.join();
+  // Starting the thread may allocate its state on this thread, but not the
+  // value allocated by the thread itself.
+  EXPECT_EQ(allocations, thread_counter.allocations());
+}
+
+TEST(Allocations, Primitives) {
+  ExpectRoundTripWithoutAllocations(true);
+  ExpectRoundTripWithoutAllocations('c');
+  ExpectRoundTripWithoutAllocations(std::int8_t{-100});
+  ExpectRoundTripWithoutAllocations(std::uint8_t{200});
+  ExpectRoundTripWithoutAllocations(std::int16_t{-30000});
+  ExpectRoundTripWithoutAllocations(std::uint16_t{60000});
+  ExpectRoundTripWithoutAllocations(std::int32_t{-2000000000});
+  ExpectRoundTripWithoutAllocations(std::uint32_t{4000000000u});
+  ExpectRoundTripWithoutAllocations(-(std::int64_t{1} << 40));
+  ExpectRoundTripWithoutAllocations(~std::uint64_t{0});
+  ExpectRoundTripWithoutAllocations(1.5f);
+  ExpectRoundTripWithoutAllocations(-2.25);
+  ExpectRoundTripWithoutAllocations(Color::Blue);
+}
+
+TEST(Allocations, Arrays) {
+  std::array<std::uint8_t, 100> bytes;
+  bytes.fill(0xaa);
+  ExpectRoundTripWithoutAllocations(bytes);
+
+  std::array<std::int32_t, 16> integers;
+  for (std::size_t i = 0; i < integers.size(); i++)
+    integers[i] = static_cast<std::int32_t>(i * 1000) - 8000;
+  ExpectRoundTripWithoutAllocations(integers);
+
+  ExpectRoundTripWithoutAllocations(std::array<double, 4>{{1, -2, 3.5, 0}});
+  ExpectRoundTripWithoutAllocations(
+      std::array<std::array<std::uint16_t, 2>, 3>{{{{1, 2}}, {{3, 4}}}});
+  ExpectRoundTripWithoutAllocations(std::array<Point, 2>{{{1, 2}, {-3, -4}}});
+
+  // C arrays are written and read in place.
+  std::uint8_t buffer[256];
+  std::int64_t values[8] = {1, -1, 1 << 20, -(1 << 20), 0, 7, 8, 9};
+  Serializer<BufferWriter> serializer{buffer, sizeof(buffer)};
+  Status<void> status;
+  EXPECT_NO_ALLOCATIONS(status = serializer.Write(values));
+  ASSERT_TRUE(status);
+
+  std::int64_t decoded[8] = {};
+  Deserializer<BufferReader> deserializer{buffer, serializer.writer().size()};
+  EXPECT_NO_ALLOCATIONS(status = deserializer.Read(&decoded));
+  ASSERT_TRUE(status);
+  EXPECT_TRUE(std::equal(std::begin(values), std::end(values), decoded));
+}
+
+TEST(Allocations, Structures) {
+  ExpectRoundTripWithoutAllocations(Point{-1, 1});
+  ExpectRoundTripWithoutAllocations(Sample{
+      1ull << 50, {10, -20}, {{0.5f, 1.5f, -1}}, Color::Green, true, {}});
+  ExpectRoundTripWithoutAllocations(
+      Sample{7, {0, 0}, {{0, 0, 0}}, Color::Red, false, std::int16_t{-5}});
+  ExpectRoundTripWithoutAllocations(std::make_pair(1, 2.5));
+  ExpectRoundTripWithoutAllocations(std::make_tuple(Color::Red, 'x', 3u));
+}
+
+TEST(Allocations, InlineContainers) {
+  ExpectRoundTripWithoutAllocations(InlineString<15>{"short key"});
+  ExpectRoundTripWithoutAllocations(InlineVector<std::int32_t, 8>{1, -2, 3});
+  ExpectRoundTripWithoutAllocations(
+      InlineVector<Point, 4>{{1, 2}, {-3, -4}, {5, 6}, {-7, -8}});
+  ExpectRoundTripWithoutAllocations(InlineVector<InlineString<7>, 2>{
+      InlineString<7>{"a"}, InlineString<7>{"bcdefgh"}});
+}
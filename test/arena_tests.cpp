@@ -0,0 +1,133 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/utility/arena_allocator.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Arena;
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::Encode;
+using nop::ScopedArenaAllocator;
+
+namespace {
+
+using String = std::basic_string<char, std::char_traits<char>,
+                                 ScopedArenaAllocator<char>>;
+using Strings = std::vector<String, ScopedArenaAllocator<String>>;
+using Values = std::vector<int, ScopedArenaAllocator<int>>;
+using Map = std::map<String, Strings, std::less<String>,
+                     ScopedArenaAllocator<std::pair<const String, Strings>>>;
+
+// The standard library only hashes strings with the default allocator.
+struct StringHash {
+  std::size_t operator()(const String& value) const {
+    return std::hash<std::string>{}(std::string{value.begin(), value.end()});
+  }
+};
+
+template <typename Allocator>
+bool UsesArena(const Allocator& allocator, Arena* arena) {
+  return allocator.outer_allocator().arena() == arena;
+}
+
+}  // anonymous namespace
+
+TEST(Arena, Allocate) {
+  Arena arena{64};
+  EXPECT_EQ(0u, arena.block_count());
+
+  void* a = arena.Allocate(10, 1);
+  void* b = arena.Allocate(8, 8);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(b) % 8);
+  EXPECT_EQ(18u, arena.allocated());
+  EXPECT_EQ(1u, arena.block_count());
+
+  // Large allocations get a block of their own.
+  arena.Allocate(1000, 16);
+  EXPECT_EQ(2u, arena.block_count());
+
+  arena.Reset();
+  EXPECT_EQ(0u, arena.allocated());
+  EXPECT_EQ(1u, arena.block_count());
+  EXPECT_EQ(a, arena.Allocate(10, 1));
+
+  // Without an arena the allocator uses the heap.
+  nop::ArenaAllocator<int> heap;
+  EXPECT_EQ(nullptr, heap.arena());
+  int* value = heap.allocate(4);
+  heap.deallocate(value, 4);
+  EXPECT_NE(heap, nop::ArenaAllocator<int>{&arena});
+}
+
+TEST(Arena, Decode) {
+  const std::vector<std::uint8_t> bytes =
+      Encode(std::map<std::string, std::vector<std::string>>{
+          {"hosts", {std::string(40, 'a'), std::string(50, 'b')}},
+          {std::string(30, 'k'), {"x"}}});
+
+  Arena arena;
+  {
+    Map map{ScopedArenaAllocator<std::pair<const String, Strings>>{&arena}};
+    Deserializer<BufferReader> deserializer{bytes.data(), bytes.size()};
+    ASSERT_TRUE(deserializer.Read(&map));
+    ASSERT_EQ(2u, map.size());
+
+    // Every nested container allocates from the arena of the map.
+    for (const auto& element : map) {
+      EXPECT_TRUE(UsesArena(element.first.get_allocator(), &arena));
+      EXPECT_TRUE(UsesArena(element.second.get_allocator(), &arena));
+      for (const String& string : element.second)
+        EXPECT_TRUE(UsesArena(string.get_allocator(), &arena));
+    }
+    const Strings& hosts = map.at(String{"hosts", map.get_allocator()});
+    ASSERT_EQ(2u, hosts.size());
+    EXPECT_EQ(String(40, 'a', map.get_allocator()), hosts[0]);
+
+    EXPECT_LT(40u + 50u + 30u, arena.allocated());
+  }
+  arena.Reset();
+  EXPECT_EQ(0u, arena.allocated());
+
+  // Unordered maps and vectors of integers decode the same way.
+  using Buckets = std::unordered_map<
+      String, Values, StringHash, std::equal_to<String>,
+      ScopedArenaAllocator<std::pair<const String, Values>>>;
+  const std::vector<std::uint8_t> bucket_bytes =
+      Encode(std::unordered_map<std::string, std::vector<int>>{
+          {std::string(20, 'z'), {1, 2, 3}}});
+  Buckets buckets{0, StringHash{}, std::equal_to<String>{},
+                  ScopedArenaAllocator<std::pair<const String, Values>>{
+                      &arena}};
+  Deserializer<BufferReader> deserializer{bucket_bytes.data(),
+                                          bucket_bytes.size()};
+  ASSERT_TRUE(deserializer.Read(&buckets));
+  ASSERT_EQ(1u, buckets.size());
+  EXPECT_TRUE(UsesArena(buckets.begin()->first.get_allocator(), &arena));
+  EXPECT_TRUE(UsesArena(buckets.begin()->second.get_allocator(), &arena));
+  EXPECT_EQ(3u, buckets.begin()->second.size());
+}
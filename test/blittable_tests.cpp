@@ -0,0 +1,191 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <nop/base/skip.h>
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/traits/is_blittable.h>
+#include <nop/types/blittable_array.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BlittableArray;
+using nop::BlittableLayout;
+using nop::Decode;
+using nop::Encode;
+using nop::EncodingByte;
+using nop::ErrorStatus;
+using nop::IsBlittable;
+using nop::PedanticBufferReader;
+using nop::SkipValue;
+using nop::Status;
+
+namespace {
+
+enum class Kind : std::uint16_t { Point, Normal };
+
+struct Vertex {
+  std::uint32_t id;
+  float x, y, z;
+
+  bool operator==(const Vertex& other) const {
+    return id == other.id && x == other.x && y == other.y && z == other.z;
+  }
+
+  NOP_STRUCTURE(Vertex, id, x, y, z);
+};
+
+// Same members as Vertex in a different order.
+struct ReorderedVertex {
+  float x, y, z;
+  std::uint32_t id;
+  NOP_STRUCTURE(ReorderedVertex, x, y, z, id);
+};
+
+struct Sample {
+  Kind kind;
+  std::uint16_t channel;
+  std::array<std::int32_t, 3> values;
+  Vertex origin;
+  NOP_STRUCTURE(Sample, kind, channel, values, origin);
+};
+
+struct Padded {
+  std::uint8_t tag;
+  std::uint32_t value;
+  NOP_STRUCTURE(Padded, tag, value);
+};
+
+struct WithBool {
+  bool flag;
+  std::uint8_t value;
+  NOP_STRUCTURE(WithBool, flag, value);
+};
+
+struct WithString {
+  std::uint32_t id;
+  std::string name;
+  NOP_STRUCTURE(WithString, id, name);
+};
+
+std::vector<Vertex> MakeVertices() {
+  return {{1, 0.5f, -1.0f, 2.0f}, {2, 3.0f, 4.0f, -5.5f}, {3, 0, 0, 0}};
+}
+
+}  // anonymous namespace
+
+TEST(BlittableArray, IsBlittable) {
+  EXPECT_TRUE(IsBlittable<std::uint64_t>::value);
+  EXPECT_TRUE(IsBlittable<double>::value);
+  EXPECT_TRUE(IsBlittable<Kind>::value);
+  EXPECT_TRUE(IsBlittable<Vertex>::value);
+  EXPECT_TRUE(IsBlittable<Sample>::value);
+  EXPECT_TRUE(IsBlittable<float[4]>::value);
+
+  EXPECT_FALSE(IsBlittable<bool>::value);
+  EXPECT_FALSE(IsBlittable<Padded>::value);
+  EXPECT_FALSE(IsBlittable<WithBool>::value);
+  EXPECT_FALSE(IsBlittable<WithString>::value);
+  EXPECT_FALSE(IsBlittable<std::vector<int>>::value);
+}
+
+TEST(BlittableArray, Format) {
+  const std::vector<Vertex> vertices = MakeVertices();
+  const std::vector<std::uint8_t> bytes =
+      Encode(BlittableArray<Vertex>{vertices});
+
+  // One binary container holding the fingerprint and the raw elements.
+  const std::size_t payload_size = 8 + vertices.size() * sizeof(Vertex);
+  ASSERT_EQ(2 + payload_size, bytes.size());
+  EXPECT_EQ(static_cast<std::uint8_t>(EncodingByte::Binary), bytes[0]);
+  EXPECT_EQ(payload_size, bytes[1]);
+  EXPECT_EQ(bytes.size(), nop::Encoding<BlittableArray<Vertex>>::Size(
+                              BlittableArray<Vertex>{vertices}));
+
+  std::uint64_t fingerprint = 0;
+  std::memcpy(&fingerprint, &bytes[2], sizeof(fingerprint));
+  EXPECT_EQ(BlittableLayout<Vertex>::Fingerprint, fingerprint);
+  EXPECT_EQ(0, std::memcmp(&bytes[10], vertices.data(),
+                           vertices.size() * sizeof(Vertex)));
+  EXPECT_NE(BlittableLayout<Vertex>::Fingerprint,
+            BlittableLayout<ReorderedVertex>::Fingerprint);
+
+  PedanticBufferReader reader{bytes.data(), bytes.size()};
+  ASSERT_TRUE(SkipValue(&reader));
+  EXPECT_TRUE(reader.empty());
+}
+
+TEST(BlittableArray, RoundTrip) {
+  BlittableArray<Vertex> decoded;
+  ASSERT_TRUE(Decode<PedanticBufferReader>(
+      Encode(BlittableArray<Vertex>{MakeVertices()}), &decoded));
+  EXPECT_EQ(MakeVertices(), decoded.get());
+
+  std::vector<Sample> samples(100);
+  for (std::size_t i = 0; i < samples.size(); i++) {
+    const std::int32_t value = static_cast<std::int32_t>(i);
+    samples[i] = {Kind::Normal,
+                  static_cast<std::uint16_t>(i),
+                  {{value, -value, value * value}},
+                  {static_cast<std::uint32_t>(i), 1.0f, 2.0f, 3.0f}};
+  }
+
+  BlittableArray<Sample> decoded_samples;
+  ASSERT_TRUE(Decode<PedanticBufferReader>(
+      Encode(BlittableArray<Sample>{samples}), &decoded_samples));
+  ASSERT_EQ(samples.size(), decoded_samples.get().size());
+  EXPECT_EQ(samples[99].values, decoded_samples.get()[99].values);
+  EXPECT_EQ(samples[99].origin, decoded_samples.get()[99].origin);
+
+  // The regular vector encoding is accepted too.
+  ASSERT_TRUE(Decode<PedanticBufferReader>(Encode(MakeVertices()), &decoded));
+  EXPECT_EQ(MakeVertices(), decoded.get());
+}
+
+TEST(BlittableArray, Errors) {
+  std::vector<std::uint8_t> bytes =
+      Encode(BlittableArray<Vertex>{MakeVertices()});
+
+  // A different layout is rejected.
+  BlittableArray<ReorderedVertex> reordered;
+  Status<void> status = Decode<PedanticBufferReader>(bytes, &reordered);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::VersionMismatch, status.error());
+
+  // The length must hold the fingerprint and whole elements.
+  BlittableArray<Vertex> decoded;
+  std::vector<std::uint8_t> short_bytes = bytes;
+  short_bytes[1] -= 1;
+  short_bytes.pop_back();
+  status = Decode<PedanticBufferReader>(short_bytes, &decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+
+  // Truncated input is rejected before decoding.
+  bytes.pop_back();
+  status = Decode<PedanticBufferReader>(bytes, &decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
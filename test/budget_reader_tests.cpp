@@ -0,0 +1,209 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/traits/is_budget_reader.h>
+#include <nop/utility/array_cursor.h>
+#include <nop/utility/budget_reader.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/resumable_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::ArrayCursor;
+using nop::BudgetReader;
+using nop::BufferReader;
+using nop::DecodeBudget;
+using nop::Deserializer;
+using nop::Encode;
+using nop::ErrorStatus;
+using nop::IsBudgetReader;
+using nop::ResumableReader;
+using nop::Status;
+
+namespace {
+
+struct Record {
+  int id;
+  std::string name;
+
+  bool operator==(const Record& other) const {
+    return id == other.id && name == other.name;
+  }
+
+  NOP_STRUCTURE(Record, id, name);
+};
+
+std::vector<Record> MakeRecords(std::size_t count) {
+  std::vector<Record> records;
+  for (std::size_t i = 0; i < count; i++)
+    records.push_back({static_cast<int>(i), std::string(i % 7, 'r')});
+  return records;
+}
+
+template <typename T>
+Status<void> Decode(const std::vector<std::uint8_t>& bytes,
+                    const DecodeBudget& budget, T* value) {
+  BufferReader buffer_reader{bytes.data(), bytes.size()};
+  BudgetReader<BufferReader> reader{&buffer_reader, budget};
+  Deserializer<BudgetReader<BufferReader>*> deserializer{&reader};
+  return deserializer.Read(value);
+}
+
+}  // anonymous namespace
+
+TEST(BudgetReader, Unlimited) {
+  static_assert(IsBudgetReader<BudgetReader<BufferReader>>::value, "");
+  static_assert(!IsBudgetReader<BufferReader>::value, "");
+
+  const std::vector<Record> expected = MakeRecords(100);
+  const std::vector<std::uint8_t> bytes = Encode(expected);
+
+  BufferReader buffer_reader{bytes.data(), bytes.size()};
+  BudgetReader<BufferReader> reader{&buffer_reader};
+  Deserializer<BudgetReader<BufferReader>*> deserializer{&reader};
+  std::vector<Record> records;
+  ASSERT_TRUE(deserializer.Read(&records));
+  EXPECT_EQ(expected, records);
+
+  EXPECT_EQ(bytes.size(), reader.bytes_read());
+  EXPECT_LT(300u, reader.value_count());
+  EXPECT_LE(100 * sizeof(Record), reader.allocation_bytes());
+
+  reader.Reset(DecodeBudget{});
+  EXPECT_EQ(0u, reader.bytes_read());
+  EXPECT_EQ(0u, reader.value_count());
+  EXPECT_EQ(0u, reader.allocation_bytes());
+}
+
+TEST(BudgetReader, Limits) {
+  const std::vector<std::uint8_t> bytes = Encode(MakeRecords(100));
+  std::vector<Record> records;
+
+  DecodeBudget budget;
+  budget.max_bytes = bytes.size();
+  EXPECT_TRUE(Decode(bytes, budget, &records));
+  budget.max_bytes = bytes.size() - 1;
+  Status<void> status = Decode(bytes, budget, &records);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::BudgetExceeded, status.error());
+
+  budget = DecodeBudget{};
+  budget.max_values = 50;
+  status = Decode(bytes, budget, &records);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::BudgetExceeded, status.error());
+
+  budget = DecodeBudget{};
+  budget.max_allocation_bytes = 10 * sizeof(Record);
+  status = Decode(bytes, budget, &records);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::BudgetExceeded, status.error());
+
+  // Lengths are charged before the storage for them is allocated, however
+  // few bytes back them.
+  const std::vector<std::uint8_t> claim = {
+      0xba,  // Array.
+      0x83, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,  // 2^40 elements.
+      0xb9, 0x02, 0x00, 0xbd, 0x00};
+  budget = DecodeBudget{};
+  budget.max_allocation_bytes = 1024 * 1024;
+  status = Decode(claim, budget, &records);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::BudgetExceeded, status.error());
+
+  std::map<int, std::string> map;
+  std::string string;
+  budget.max_allocation_bytes = 100;
+  status = Decode(Encode(std::string(101, 's')), budget, &string);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::BudgetExceeded, status.error());
+  EXPECT_TRUE(Decode(Encode(std::string(100, 's')), budget, &string));
+
+  status =
+      Decode(Encode(std::map<int, std::string>{{1, "a"}, {2, "b"}, {3, "c"}}),
+             budget, &map);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::BudgetExceeded, status.error());
+}
+
+TEST(BudgetReader, Deadline) {
+  const std::vector<std::uint8_t> bytes = Encode(MakeRecords(100));
+  std::vector<Record> records;
+
+  DecodeBudget budget;
+  budget.deadline = DecodeBudget::Clock::now() - std::chrono::seconds{1};
+  Status<void> status = Decode(bytes, budget, &records);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::DeadlineExceeded, status.error());
+
+  // Values without container storage check the deadline periodically.
+  std::vector<int> integers;
+  for (int i = 0; i < 100; i++)
+    integers.push_back(i * 1000);
+  const std::vector<std::uint8_t> integer_bytes =
+      Encode(std::vector<std::vector<int>>(200, integers));
+  std::vector<std::vector<int>> nested;
+  status = Decode(integer_bytes, budget, &nested);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::DeadlineExceeded, status.error());
+
+  budget.deadline = DecodeBudget::Clock::now() + std::chrono::hours{1};
+  EXPECT_TRUE(Decode(bytes, budget, &records));
+}
+
+TEST(BudgetReader, TimeSlices) {
+  const std::vector<Record> expected = MakeRecords(20);
+  const std::vector<std::uint8_t> bytes = Encode(expected);
+
+  ResumableReader resumable_reader;
+  resumable_reader.Append(bytes.data(), bytes.size());
+  BudgetReader<ResumableReader> reader{&resumable_reader};
+
+  ArrayCursor<Record> cursor;
+  ASSERT_TRUE(resumable_reader.Attempt(
+      [&](ResumableReader*) { return cursor.Begin(&reader); }));
+
+  // Alternate slices whose deadline has passed with slices that have time to
+  // decode one element. Missed deadlines rewind to the start of the element.
+  DecodeBudget expired;
+  expired.deadline = DecodeBudget::Clock::now() - std::chrono::seconds{1};
+  std::vector<Record> records;
+  while (!cursor.done()) {
+    Record record;
+    reader.Reset(expired);
+    Status<void> status = resumable_reader.Attempt(
+        [&](ResumableReader*) { return cursor.Next(&record, &reader); });
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::DeadlineExceeded, status.error());
+
+    reader.Reset(DecodeBudget{});
+    status = resumable_reader.Attempt(
+        [&](ResumableReader*) { return cursor.Next(&record, &reader); });
+    ASSERT_TRUE(status);
+    records.push_back(record);
+  }
+  EXPECT_EQ(expected, records);
+}
@@ -0,0 +1,726 @@
+// Copyright 2019 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/traits/is_limit_reader.h>
+#include <nop/types/enum_flags.h>
+#include <nop/utility/array_cursor.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/default_init_allocator.h>
+#include <nop/utility/fixed_serializer.h>
+#include <nop/utility/gather_writer.h>
+#include <nop/utility/growable_buffer_writer.h>
+#include <nop/utility/huge_page_allocator.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/resumable_reader.h>
+#include <nop/utility/segmented_reader.h>
+
+#include "test_writer.h"
+
+using nop::ArrayCursor;
+using nop::BufferReader;
+using nop::ByteBuffer;
+using nop::DefaultInitVector;
+using nop::Deserializer;
+using nop::EncodingByte;
+using nop::ErrorStatus;
+using nop::FixedSerializer;
+using nop::GatherWriter;
+using nop::GrowableBufferWriter;
+using nop::HasMaxEncodedSize;
+using nop::HugePageAllocator;
+using nop::IsLimitReader;
+using nop::MakeRange;
+using nop::MaxEncodedSize;
+using nop::MinEncodedSize;
+using nop::PedanticBufferReader;
+using nop::ResumableReader;
+using nop::SegmentedReader;
+using nop::Serializer;
+using nop::Span;
+using nop::Status;
+using nop::StringView;
+using nop::TestWriter;
+
+namespace {
+
+struct Message {
+  int a;
+  std::string b;
+  std::vector<std::uint8_t> c;
+
+  bool operator==(const Message& other) const {
+    return a == other.a && b == other.b && c == other.c;
+  }
+
+  NOP_STRUCTURE(Message, a, b, c);
+};
+
+enum class SampleFlags : std::uint32_t {
+  None = 0,
+  Valid = 1,
+  Overflow = 0x80000000,
+};
+NOP_ENUM_FLAGS(SampleFlags);
+
+// Fixed-shape structure with a bounded encoded size.
+struct Sample {
+  std::uint8_t channel;
+  std::int64_t timestamp;
+  SampleFlags flags;
+  std::array<std::uint16_t, 4> values;
+  float gain;
+
+  NOP_STRUCTURE(Sample, channel, timestamp, flags, values, gain);
+};
+
+// Borrowing counterpart of Message with the same encoding.
+struct MessageView {
+  int a;
+  StringView b;
+  Span<std::uint8_t> c;
+
+  NOP_STRUCTURE(MessageView, a, b, c);
+};
+
+// Allocator that counts the allocations made through it.
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+
+  CountingAllocator(std::size_t* count) : count{count} {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>& other) : count{other.count} {}
+
+  T* allocate(std::size_t n) {
+    ++*count;
+    return std::allocator<T>{}.allocate(n);
+  }
+  void deallocate(T* p, std::size_t n) { std::allocator<T>{}.deallocate(p, n); }
+
+  bool operator==(const CountingAllocator& other) const {
+    return count == other.count;
+  }
+  bool operator!=(const CountingAllocator& other) const {
+    return count != other.count;
+  }
+
+  std::size_t* count;
+};
+
+// Splits |data| into segments of |size| bytes, with an empty segment between
+// each pair.
+std::vector<struct iovec> Split(const std::vector<std::uint8_t>& data,
+                                std::size_t size) {
+  std::vector<struct iovec> segments;
+  for (std::size_t offset = 0; offset < data.size(); offset += size) {
+    std::uint8_t* begin = const_cast<std::uint8_t*>(data.data()) + offset;
+    segments.push_back({begin, std::min(size, data.size() - offset)});
+    segments.push_back({begin, 0});
+  }
+  return segments;
+}
+
+template <typename Writer>
+std::vector<std::uint8_t> Collect(const Writer& writer) {
+  std::vector<std::uint8_t> data;
+  for (std::size_t i = 0; i < writer.segment_count(); i++) {
+    auto segment = writer.segment(i);
+    data.insert(data.end(), segment.data, segment.data + segment.size);
+  }
+  return data;
+}
+
+}  // anonymous namespace
+
+TEST(GrowableBufferWriter, Write) {
+  const Message message{10, std::string(100, 'x'),
+                        std::vector<std::uint8_t>(300, 0x55)};
+
+  Serializer<TestWriter> expected;
+  ASSERT_TRUE(expected.Write(message));
+  ASSERT_TRUE(expected.Write(message));
+
+  // Use chunks smaller than the message to force growth.
+  Serializer<GrowableBufferWriter<>> serializer{std::size_t{16}};
+  ASSERT_TRUE(serializer.Write(message));
+  ASSERT_TRUE(serializer.Write(message));
+  EXPECT_EQ(expected.writer().data().size(), serializer.writer().size());
+  EXPECT_EQ(expected.writer().data(), Collect(serializer.writer()));
+
+  // Prepare() keeps each value contiguous.
+  EXPECT_EQ(2u, serializer.writer().segment_count());
+
+  auto segment = serializer.writer().Linearize();
+  EXPECT_EQ(1u, serializer.writer().segment_count());
+  ASSERT_EQ(expected.writer().data().size(), segment.size);
+  EXPECT_EQ(expected.writer().data(), std::vector<std::uint8_t>(
+                                         segment.data,
+                                         segment.data + segment.size));
+
+  Deserializer<BufferReader> deserializer{segment.data, segment.size};
+  Message result;
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(message, result);
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(message, result);
+}
+
+TEST(GrowableBufferWriter, WriteWithoutPrepare) {
+  GrowableBufferWriter<> writer{std::size_t{4}};
+  const std::vector<std::uint8_t> data{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+  ASSERT_TRUE(writer.Write(&*data.begin(), &*data.end()));
+  ASSERT_TRUE(writer.Skip(3, 0xff));
+  ASSERT_TRUE(writer.Write(0x20));
+
+  std::vector<std::uint8_t> expected = data;
+  expected.insert(expected.end(), {0xff, 0xff, 0xff, 0x20});
+  EXPECT_EQ(expected.size(), writer.size());
+  EXPECT_EQ(expected, Collect(writer));
+  EXPECT_LT(1u, writer.segment_count());
+}
+
+TEST(GrowableBufferWriter, Reset) {
+  using Allocator = CountingAllocator<std::uint8_t>;
+  const Message message{-1, "foo", std::vector<std::uint8_t>(200, 0x11)};
+
+  std::size_t allocations = 0;
+  Serializer<GrowableBufferWriter<Allocator>> serializer{
+      std::size_t{64}, Allocator{&allocations}};
+
+  ASSERT_TRUE(serializer.Write(message));
+  ASSERT_TRUE(serializer.Write(message));
+  serializer.writer().Linearize();
+
+  const std::size_t capacity = serializer.writer().capacity();
+  const std::size_t steady_allocations = allocations;
+  EXPECT_LT(0u, steady_allocations);
+
+  for (int i = 0; i < 10; i++) {
+    serializer.writer().Reset();
+    EXPECT_EQ(0u, serializer.writer().size());
+    EXPECT_EQ(0u, serializer.writer().segment_count());
+
+    ASSERT_TRUE(serializer.Write(message));
+    ASSERT_TRUE(serializer.Write(message));
+    serializer.writer().Linearize();
+  }
+
+  // Reusing the writer does not allocate or free chunks.
+  EXPECT_EQ(steady_allocations, allocations);
+  EXPECT_EQ(capacity, serializer.writer().capacity());
+}
+
+TEST(GrowableBufferWriter, HugePages) {
+  using Allocator = HugePageAllocator<std::uint8_t>;
+  const Message message{7, "bar", std::vector<std::uint8_t>(1 << 20, 0x22)};
+
+  Serializer<GrowableBufferWriter<Allocator>> serializer{
+      std::size_t{Allocator::kHugePageSize}};
+  for (int i = 0; i < 3; i++)
+    ASSERT_TRUE(serializer.Write(message));
+  EXPECT_EQ(0u, serializer.writer().capacity() % Allocator::kHugePageSize);
+
+  auto segment = serializer.writer().Linearize();
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(segment.data) %
+                    Allocator::kHugePageSize);
+
+  Deserializer<BufferReader> deserializer{segment.data, segment.size};
+  Message result;
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(deserializer.Read(&result));
+    EXPECT_EQ(message, result);
+  }
+}
+
+TEST(GatherWriter, Write) {
+  const Message message{10, "foo", std::vector<std::uint8_t>(1000, 0x55)};
+
+  Serializer<TestWriter> expected;
+  ASSERT_TRUE(expected.Write(message));
+
+  Serializer<GatherWriter<64>> serializer;
+  ASSERT_TRUE(serializer.Write(message));
+  EXPECT_EQ(expected.writer().data().size(), serializer.writer().size());
+
+  // The payload is referenced in place; only the headers are copied.
+  EXPECT_EQ(expected.writer().data().size() - message.c.size(),
+            serializer.writer().staged());
+
+  const auto& iovecs = serializer.writer().Gather();
+  ASSERT_EQ(2u, iovecs.size());
+  EXPECT_EQ(message.c.data(), iovecs[1].iov_base);
+  EXPECT_EQ(message.c.size(), iovecs[1].iov_len);
+
+  std::vector<std::uint8_t> data;
+  for (const auto& iov : iovecs) {
+    const std::uint8_t* base = static_cast<const std::uint8_t*>(iov.iov_base);
+    data.insert(data.end(), base, base + iov.iov_len);
+  }
+  EXPECT_EQ(expected.writer().data(), data);
+
+  serializer.writer().Clear();
+  EXPECT_EQ(0u, serializer.writer().size());
+  EXPECT_TRUE(serializer.writer().Gather().empty());
+}
+
+TEST(BufferReader, Borrow) {
+  const Message message{10, "foo", std::vector<std::uint8_t>(100, 0x55)};
+
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(message));
+  const std::vector<std::uint8_t>& data = serializer.writer().data();
+
+  // Views serialize to the same bytes as the owning types.
+  Serializer<TestWriter> view_serializer;
+  ASSERT_TRUE(view_serializer.Write(
+      MessageView{message.a, message.b, message.c}));
+  EXPECT_EQ(data, view_serializer.writer().data());
+
+  Deserializer<BufferReader> deserializer{data.data(), data.size()};
+  MessageView view;
+  ASSERT_TRUE(deserializer.Read(&view));
+
+  EXPECT_EQ(message.a, view.a);
+  EXPECT_EQ(message.b, view.b.to_string());
+  EXPECT_EQ(message.c,
+            std::vector<std::uint8_t>(view.c.begin(), view.c.end()));
+
+  // The views reference the input buffer instead of copies.
+  const auto* begin = reinterpret_cast<const char*>(data.data());
+  const auto* end = begin + data.size();
+  EXPECT_TRUE(view.b.data() >= begin && view.b.data() < end);
+  EXPECT_TRUE(reinterpret_cast<const char*>(view.c.data()) >= begin &&
+              reinterpret_cast<const char*>(view.c.data()) < end);
+
+  // Owning and borrowing types are interchangeable on the wire.
+  Deserializer<BufferReader> copy_deserializer{data.data(), data.size()};
+  Message copy;
+  ASSERT_TRUE(copy_deserializer.Read(&copy));
+  EXPECT_EQ(message, copy);
+}
+
+TEST(BufferReader, Limits) {
+  static_assert(IsLimitReader<BufferReader>::value, "");
+  static_assert(IsLimitReader<PedanticBufferReader>::value, "");
+  static_assert(!IsLimitReader<ResumableReader>::value, "");
+
+  const std::uint8_t data[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  PedanticBufferReader reader{data, sizeof(data)};
+  ASSERT_TRUE(reader.Skip(1));
+
+  // Limits nest and each read is checked against the innermost one.
+  auto outer = reader.PushLimit(5);
+  ASSERT_TRUE(outer);
+  EXPECT_EQ(sizeof(data), outer.get());
+  EXPECT_EQ(5u, reader.remaining());
+
+  std::uint8_t byte = 0;
+  ASSERT_TRUE(reader.Read(&byte));
+  EXPECT_EQ(2u, byte);
+
+  auto inner = reader.PushLimit(2);
+  ASSERT_TRUE(inner);
+  EXPECT_EQ(6u, inner.get());
+  std::uint8_t bytes[3] = {};
+  Status<void> status = reader.Read(bytes, bytes + 3);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+  ASSERT_TRUE(reader.Read(&byte));
+  EXPECT_EQ(3u, byte);
+
+  // Popping skips the rest of the limit.
+  ASSERT_TRUE(reader.PopLimit(inner.get()));
+  EXPECT_EQ(2u, reader.remaining());
+  ASSERT_TRUE(reader.PopLimit(outer.get()));
+  EXPECT_EQ(2u, reader.remaining());
+  ASSERT_TRUE(reader.Read(&byte));
+  EXPECT_EQ(7u, byte);
+
+  // Limits may not extend past the input.
+  auto too_large = reader.PushLimit(2);
+  ASSERT_FALSE(too_large);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, too_large.error());
+}
+
+TEST(SegmentedReader, Read) {
+  const Message message{-1000, std::string(100, 'x'),
+                        std::vector<std::uint8_t>(50, 0x55)};
+  const std::vector<int> values = {1, 2, 3, -4, 5, 1000000, 6, 7, 8, 9, 10};
+
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(message));
+  ASSERT_TRUE(serializer.Write(values));
+  ASSERT_TRUE(serializer.Write(2.5));
+  const std::vector<std::uint8_t>& data = serializer.writer().data();
+
+  for (std::size_t size : {1, 3, 7, 64, 1024}) {
+    const std::vector<struct iovec> segments = Split(data, size);
+    Deserializer<SegmentedReader> deserializer{segments.data(),
+                                               segments.size()};
+    EXPECT_EQ(data.size(), deserializer.reader().remaining());
+
+    Message message_copy;
+    std::vector<int> values_copy;
+    double value = 0.0;
+    ASSERT_TRUE(deserializer.Read(&message_copy)) << size;
+    ASSERT_TRUE(deserializer.Read(&values_copy)) << size;
+    ASSERT_TRUE(deserializer.Read(&value)) << size;
+    EXPECT_EQ(message, message_copy);
+    EXPECT_EQ(values, values_copy);
+    EXPECT_EQ(2.5, value);
+    EXPECT_TRUE(deserializer.reader().empty());
+
+    Status<void> status = deserializer.Read(&value);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+  }
+
+  // Reads and skips are bounds checked.
+  const std::vector<struct iovec> segments = Split(data, 5);
+  SegmentedReader reader{segments.data(), segments.size()};
+  std::vector<std::uint8_t> bytes(data.size() + 1);
+  Status<void> status = reader.Read(&bytes.front(), &bytes.back() + 1);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+  status = reader.Skip(data.size() + 1);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+
+  ASSERT_TRUE(reader.Skip(3));
+  ASSERT_TRUE(reader.Read(&bytes.front(), &bytes.front() + data.size() - 3));
+  EXPECT_TRUE(std::equal(data.begin() + 3, data.end(), bytes.begin()));
+  EXPECT_TRUE(reader.empty());
+
+  SegmentedReader empty_reader;
+  EXPECT_TRUE(empty_reader.empty());
+  status = empty_reader.Read(&bytes.front());
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
+
+TEST(SegmentedReader, Borrow) {
+  const Message message{10, "foo", std::vector<std::uint8_t>(100, 0x55)};
+
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(message));
+  const std::vector<std::uint8_t>& data = serializer.writer().data();
+  const auto* begin = reinterpret_cast<const char*>(data.data());
+  const auto* end = begin + data.size();
+
+  // Views within one segment reference the segment.
+  std::vector<struct iovec> segments = Split(data, data.size());
+  Deserializer<SegmentedReader> deserializer{segments.data(),
+                                             segments.size()};
+  MessageView view;
+  ASSERT_TRUE(deserializer.Read(&view));
+  EXPECT_EQ(message.b, view.b.to_string());
+  EXPECT_TRUE(view.b.data() >= begin && view.b.data() < end);
+  EXPECT_TRUE(reinterpret_cast<const char*>(view.c.data()) >= begin &&
+              reinterpret_cast<const char*>(view.c.data()) < end);
+
+  // Views that straddle segments reference coalesced copies.
+  segments = Split(data, 16);
+  Deserializer<SegmentedReader> split_deserializer{segments.data(),
+                                                   segments.size()};
+  ASSERT_TRUE(split_deserializer.Read(&view));
+  EXPECT_EQ(message.a, view.a);
+  EXPECT_EQ(message.b, view.b.to_string());
+  EXPECT_EQ(message.c,
+            std::vector<std::uint8_t>(view.c.begin(), view.c.end()));
+  EXPECT_FALSE(reinterpret_cast<const char*>(view.c.data()) >= begin &&
+               reinterpret_cast<const char*>(view.c.data()) < end);
+}
+
+TEST(FixedSerializer, Write) {
+  // STC, N, U8, I64, U32, BIN + L + 8 bytes, F32.
+  static_assert(MaxEncodedSize<Sample>::value == 2 + 2 + 9 + 5 + 10 + 5, "");
+  static_assert(HasMaxEncodedSize<std::array<Sample, 2>>::value, "");
+  static_assert(!HasMaxEncodedSize<Message>::value, "");
+
+  const Sample samples[] = {
+      {1, 2, SampleFlags::Valid, {{1, 2, 3, 4}}, 1.0f},
+      {0xff, std::numeric_limits<std::int64_t>::min(), SampleFlags::Overflow,
+       {{0xffff, 0xffff, 0xffff, 0xffff}}, 2.0f},
+  };
+
+  FixedSerializer<Sample> serializer;
+  for (const Sample& sample : samples) {
+    ASSERT_TRUE(serializer.Write(sample));
+
+    Serializer<TestWriter> expected;
+    ASSERT_TRUE(expected.Write(sample));
+    EXPECT_EQ(expected.writer().data(),
+              std::vector<std::uint8_t>(
+                  serializer.data(), serializer.data() + serializer.size()));
+  }
+
+  // The widest values take exactly the maximum size.
+  EXPECT_EQ(MaxEncodedSize<Sample>::value, serializer.size());
+}
+
+TEST(BufferReader, ReserveVector) {
+  static_assert(MinEncodedSize<Sample>::value == 2 + 1 + 1 + 1 + 10 + 1, "");
+
+  const std::vector<Message> messages(100, Message{1, "foo", {1, 2, 3}});
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(messages));
+  const std::vector<std::uint8_t>& data = serializer.writer().data();
+
+  // Storage for every element is reserved up front.
+  Deserializer<BufferReader> deserializer{data.data(), data.size()};
+  std::vector<Message> value;
+  ASSERT_TRUE(deserializer.Read(&value));
+  EXPECT_EQ(messages, value);
+  EXPECT_EQ(messages.size(), value.capacity());
+
+  // A hostile length does not reserve more than the input could hold.
+  const std::uint8_t hostile[] = {
+      static_cast<std::uint8_t>(EncodingByte::Array),
+      static_cast<std::uint8_t>(EncodingByte::U32),
+      0xff,
+      0xff,
+      0xff,
+      0x7f,
+      static_cast<std::uint8_t>(EncodingByte::Structure),
+      3};
+  Deserializer<PedanticBufferReader> hostile_deserializer{hostile,
+                                                         sizeof(hostile)};
+  std::vector<Message> hostile_value;
+  EXPECT_FALSE(hostile_deserializer.Read(&hostile_value));
+  EXPECT_GE(sizeof(hostile), hostile_value.capacity());
+}
+
+TEST(BufferReader, ReuseVector) {
+  const std::string long_string(100, 'x');
+  std::vector<Message> value(3, Message{0, long_string, {}});
+  const char* storage = value[0].b.data();
+
+  const std::vector<Message> messages{{1, "foo", {1}}, {2, "bar", {2}}};
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(messages));
+  const std::vector<std::uint8_t>& data = serializer.writer().data();
+
+  // Existing elements are decoded in place and trailing elements truncated.
+  Deserializer<BufferReader> deserializer{data.data(), data.size()};
+  ASSERT_TRUE(deserializer.Read(&value));
+  EXPECT_EQ(messages, value);
+  EXPECT_EQ(storage, value[0].b.data());
+
+  // The vector grows when the encoding has more elements.
+  const std::vector<Message> more(4, Message{3, long_string, {3, 4}});
+  serializer.writer().clear();
+  ASSERT_TRUE(serializer.Write(more));
+
+  Deserializer<BufferReader> more_deserializer{data.data(), data.size()};
+  ASSERT_TRUE(more_deserializer.Read(&value));
+  EXPECT_EQ(more, value);
+  EXPECT_EQ(storage, value[0].b.data());
+}
+
+TEST(Serializer, WriteSlices) {
+  const std::vector<Message> messages{{1, "one", {1}},
+                                      {2, "two", {2, 2}},
+                                      {3, "three", {3, 3, 3}},
+                                      {4, "four", {}}};
+  const std::vector<Message> page{messages.begin() + 1, messages.begin() + 3};
+  const std::vector<std::uint32_t> words{1, 0x10000, 0xffffffff};
+
+  Serializer<TestWriter> expected;
+  ASSERT_TRUE(expected.Write(page));
+  ASSERT_TRUE(expected.Write(words));
+  ASSERT_TRUE(expected.Write(messages));
+
+  // Spans, ranges, and references to const containers encode like vectors.
+  Serializer<TestWriter> spans;
+  ASSERT_TRUE(spans.Write(Span<Message>{messages.data() + 1, 2}));
+  ASSERT_TRUE(spans.Write(Span<std::uint32_t>{words}));
+  ASSERT_TRUE(spans.Write(std::cref(messages)));
+  EXPECT_EQ(expected.writer().data(), spans.writer().data());
+
+  const std::deque<Message> message_deque{messages.begin(), messages.end()};
+  const std::deque<std::uint32_t> word_deque{words.begin(), words.end()};
+  Serializer<TestWriter> ranges;
+  ASSERT_TRUE(ranges.Write(MakeRange(message_deque.begin() + 1, 2)));
+  ASSERT_TRUE(ranges.Write(MakeRange(word_deque)));
+  ASSERT_TRUE(ranges.Write(MakeRange(messages.begin(), messages.end())));
+  EXPECT_EQ(expected.writer().data(), ranges.writer().data());
+
+  // Pointer and input iterator ranges of integral elements.
+  Serializer<TestWriter> inputs;
+  std::istringstream stream{"1 65536 4294967295"};
+  ASSERT_TRUE(inputs.Write(MakeRange(words.data(), words.size())));
+  ASSERT_TRUE(inputs.Write(
+      MakeRange(std::istream_iterator<std::uint32_t>{stream}, 3)));
+  Serializer<TestWriter> expected_words;
+  ASSERT_TRUE(expected_words.Write(words));
+  ASSERT_TRUE(expected_words.Write(words));
+  EXPECT_EQ(expected_words.writer().data(), inputs.writer().data());
+
+  // The receiver decodes the slices into vectors.
+  const std::vector<std::uint8_t>& data = ranges.writer().data();
+  Deserializer<BufferReader> deserializer{data.data(), data.size()};
+  std::vector<Message> decoded;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(page, decoded);
+}
+
+TEST(BufferReader, ByteBuffer) {
+  std::vector<std::uint8_t> bytes(1000);
+  for (std::size_t i = 0; i < bytes.size(); i++)
+    bytes[i] = static_cast<std::uint8_t>(i * 7);
+
+  // ByteBuffer encodes the same as std::vector<std::uint8_t>.
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(bytes));
+  const std::vector<std::uint8_t>& data = serializer.writer().data();
+
+  Deserializer<BufferReader> deserializer{data.data(), data.size()};
+  ByteBuffer value(10, 0xff);
+  ASSERT_TRUE(deserializer.Read(&value));
+  EXPECT_TRUE(std::equal(bytes.begin(), bytes.end(), value.begin(),
+                         value.end()));
+
+  Serializer<TestWriter> buffer_serializer;
+  ASSERT_TRUE(buffer_serializer.Write(value));
+  EXPECT_EQ(data, buffer_serializer.writer().data());
+
+  // Explicit values are still used to construct elements.
+  DefaultInitVector<int> ints(3, 5);
+  ints.resize(5, 7);
+  EXPECT_EQ((std::vector<int>{5, 5, 5, 7, 7}),
+            std::vector<int>(ints.begin(), ints.end()));
+}
+
+TEST(BufferReader, ReuseVariant) {
+  using Event = nop::Variant<int, std::vector<Message>>;
+  const std::string long_string(100, 'x');
+
+  Event value{std::vector<Message>(2, Message{0, long_string, {}})};
+  const Message* elements = value.get<std::vector<Message>>()->data();
+  const char* storage = (*value.get<std::vector<Message>>())[0].b.data();
+
+  const Event event{std::vector<Message>{{1, "foo", {1}}, {2, "bar", {2}}}};
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(event));
+  const std::vector<std::uint8_t>& data = serializer.writer().data();
+
+  // Decoding the active alternative reuses its storage.
+  Deserializer<BufferReader> deserializer{data.data(), data.size()};
+  ASSERT_TRUE(deserializer.Read(&value));
+  ASSERT_EQ(event.index(), value.index());
+  EXPECT_EQ(*event.get<std::vector<Message>>(),
+            *value.get<std::vector<Message>>());
+  EXPECT_EQ(elements, value.get<std::vector<Message>>()->data());
+  EXPECT_EQ(storage, (*value.get<std::vector<Message>>())[0].b.data());
+}
+
+TEST(ResumableReader, Attempt) {
+  const Message message_a{10, "foo", {1, 2, 3}};
+  const Message message_b{-20, std::string(100, 'x'), {}};
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(message_a));
+  ASSERT_TRUE(serializer.Write(message_b));
+  const std::vector<std::uint8_t>& data = serializer.writer().data();
+
+  // Feed the input a byte at a time; each message decodes once complete.
+  ResumableReader reader;
+  Deserializer<ResumableReader*> deserializer{&reader};
+  std::vector<Message> messages;
+  Message message;
+  for (std::uint8_t byte : data) {
+    reader.Append(&byte, 1);
+    auto status = reader.Attempt(
+        [&](ResumableReader*) { return deserializer.Read(&message); });
+    if (status) {
+      messages.push_back(message);
+    } else {
+      ASSERT_EQ(ErrorStatus::NeedMoreData, status.error());
+    }
+  }
+  EXPECT_EQ((std::vector<Message>{message_a, message_b}), messages);
+  EXPECT_EQ(0u, reader.buffered());
+}
+
+TEST(ResumableReader, ArrayCursor) {
+  const std::vector<Message> messages(50, Message{1, "foo", {1, 2, 3}});
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(messages));
+  const std::vector<std::uint8_t>& data = serializer.writer().data();
+
+  // Decoding an element at a time holds at most one element of input.
+  ResumableReader reader;
+  ArrayCursor<Message> cursor;
+  bool started = false;
+  std::vector<Message> value;
+  std::size_t max_buffered = 0;
+  for (std::size_t offset = 0; offset < data.size(); offset += 4) {
+    const std::size_t size = std::min<std::size_t>(4, data.size() - offset);
+    reader.Append(&data[offset], size);
+    max_buffered = std::max(max_buffered, reader.buffered());
+
+    Status<void> status;
+    if (!started) {
+      status = reader.Attempt(
+          [&](ResumableReader* reader) { return cursor.Begin(reader); });
+      started = static_cast<bool>(status);
+    }
+    while (started && !cursor.done()) {
+      Message element;
+      status = reader.Attempt([&](ResumableReader* reader) {
+        return cursor.Next(&element, reader);
+      });
+      if (!status)
+        break;
+      value.push_back(element);
+    }
+    if (!status) {
+      ASSERT_EQ(ErrorStatus::NeedMoreData, status.error());
+    }
+  }
+  EXPECT_EQ(messages, value);
+  EXPECT_GT(data.size() / 10, max_buffered);
+}
+
+TEST(ResumableReader, Limit) {
+  // A length larger than the buffer limit fails instead of waiting for data.
+  const std::uint8_t hostile[] = {
+      static_cast<std::uint8_t>(EncodingByte::String),
+      static_cast<std::uint8_t>(EncodingByte::U16), 0x00, 0x10};
+  ResumableReader reader{1024};
+  reader.Append(hostile, sizeof(hostile));
+  Deserializer<ResumableReader*> deserializer{&reader};
+  std::string value;
+  auto status = reader.Attempt(
+      [&](ResumableReader*) { return deserializer.Read(&value); });
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
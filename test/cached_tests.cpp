@@ -0,0 +1,158 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/cached.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+#include "mock_writer.h"
+
+using nop::Cached;
+using nop::Decode;
+using nop::Encode;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::Serializer;
+using nop::Status;
+using nop::testing::MockWriter;
+using ::testing::_;
+using ::testing::InSequence;
+using ::testing::StrictMock;
+
+namespace {
+
+struct Route {
+  std::string destination;
+  std::uint32_t next_hop;
+  std::vector<std::uint32_t> metrics;
+
+  bool operator==(const Route& other) const {
+    return destination == other.destination && next_hop == other.next_hop &&
+           metrics == other.metrics;
+  }
+
+  NOP_STRUCTURE(Route, destination, next_hop, metrics);
+};
+
+using RoutingTable = std::vector<Route>;
+
+struct Announcement {
+  std::uint64_t sequence;
+  Cached<RoutingTable> routes;
+
+  NOP_STRUCTURE(Announcement, sequence, routes);
+};
+
+struct PlainAnnouncement {
+  std::uint64_t sequence;
+  RoutingTable routes;
+
+  NOP_STRUCTURE(PlainAnnouncement, sequence, routes);
+};
+
+struct CachedTable {
+  Entry<int, 0> version;
+  Entry<Cached<RoutingTable>, 1> routes;
+
+  NOP_TABLE_NS("CachedTable", CachedTable, version, routes);
+};
+
+RoutingTable MakeRoutes() {
+  return {{"10.0.0.0/8", 1, {10, 20}},
+          {"192.168.0.0/16", 2, {}},
+          {"0.0.0.0/0", 300000, {1, 2, 3, 4}}};
+}
+
+}  // anonymous namespace
+
+TEST(Cached, Basic) {
+  Cached<RoutingTable> empty;
+  EXPECT_TRUE(empty.get().empty());
+  EXPECT_EQ(Encode(RoutingTable{}), empty.encoding());
+
+  // The bytes are encoded once and match the encoding of the plain value.
+  Cached<RoutingTable> routes{MakeRoutes()};
+  EXPECT_EQ(MakeRoutes(), *routes);
+  EXPECT_EQ(Encode(MakeRoutes()), routes.encoding());
+  EXPECT_EQ(Encode(MakeRoutes()), Encode(routes));
+  EXPECT_EQ(MakeRoutes().size(), routes->size());
+
+  // Modifications and assignment refresh the bytes.
+  routes.Modify([](RoutingTable* table) { table->pop_back(); });
+  RoutingTable expected = MakeRoutes();
+  expected.pop_back();
+  EXPECT_EQ(expected, routes.get());
+  EXPECT_EQ(Encode(expected), Encode(routes));
+
+  routes = RoutingTable{};
+  EXPECT_EQ(Encode(RoutingTable{}), Encode(routes));
+}
+
+TEST(Cached, SingleWrite) {
+  // The payload of the value is passed to the writer in one call.
+  Cached<RoutingTable> routes{MakeRoutes()};
+  const std::vector<std::uint8_t>& bytes = routes.encoding();
+
+  StrictMock<MockWriter> writer;
+  Serializer<MockWriter*> serializer{&writer};
+  InSequence sequence;
+  EXPECT_CALL(writer, Prepare(bytes.size()));
+  EXPECT_CALL(writer, Write(bytes[0]));
+  EXPECT_CALL(writer, Write(_, _)).Times(1);
+  EXPECT_TRUE(serializer.Write(routes));
+}
+
+TEST(Cached, Members) {
+  Announcement announcement{7, MakeRoutes()};
+  const std::vector<std::uint8_t> bytes = Encode(announcement);
+  EXPECT_EQ(Encode(PlainAnnouncement{7, MakeRoutes()}), bytes);
+
+  // Decoding keeps the bytes that were read along with the value.
+  Announcement decoded;
+  ASSERT_TRUE(Decode(bytes, &decoded));
+  EXPECT_EQ(7u, decoded.sequence);
+  EXPECT_EQ(MakeRoutes(), decoded.routes.get());
+  EXPECT_EQ(announcement.routes.encoding(), decoded.routes.encoding());
+  EXPECT_EQ(bytes, Encode(decoded));
+
+  CachedTable table;
+  table.version = 2;
+  table.routes = Cached<RoutingTable>{MakeRoutes()};
+  CachedTable decoded_table;
+  ASSERT_TRUE(Decode(Encode(table), &decoded_table));
+  ASSERT_TRUE(decoded_table.routes);
+  EXPECT_EQ(MakeRoutes(), decoded_table.routes.get().get());
+  EXPECT_EQ(Encode(table), Encode(decoded_table));
+}
+
+TEST(Cached, Errors) {
+  // The wrapped type determines which encodings are accepted.
+  Cached<RoutingTable> value;
+  Status<void> status = Decode(Encode(std::string{"routes"}), &value);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+}
@@ -0,0 +1,144 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/canonical_writer.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BufferReader;
+using nop::CanonicalWriter;
+using nop::Deserializer;
+using nop::Encode;
+using nop::Entry;
+using nop::Serializer;
+using nop::VectorWriter;
+
+namespace {
+
+// Entries are declared out of id order.
+struct Settings {
+  Entry<std::string, 7> name;
+  Entry<std::unordered_map<std::string, int>, 2> limits;
+  Entry<int, 4> version;
+
+  NOP_TABLE_NS("Settings", Settings, name, limits, version);
+};
+
+struct Catalog {
+  std::unordered_map<std::int64_t, std::vector<std::string>> buckets;
+  Settings settings;
+
+  NOP_STRUCTURE(Catalog, buckets, settings);
+};
+
+template <typename T>
+std::vector<std::uint8_t> EncodeCanonical(const T& value) {
+  Serializer<CanonicalWriter<VectorWriter>> serializer;
+  EXPECT_TRUE(serializer.Write(value));
+  return serializer.writer().writer().data();
+}
+
+template <typename T>
+T Decode(const std::vector<std::uint8_t>& bytes) {
+  T value;
+  Deserializer<BufferReader> deserializer{bytes.data(), bytes.size()};
+  EXPECT_TRUE(deserializer.Read(&value));
+  return value;
+}
+
+}  // anonymous namespace
+
+TEST(Canonical, UnorderedMap) {
+  // Build equal maps with different insertion orders and bucket counts, so
+  // that they are likely to iterate in different orders.
+  std::unordered_map<std::string, int> a;
+  std::unordered_map<std::string, int> b(1024);
+  for (int i = 0; i < 100; i++)
+    a.emplace(std::to_string(i), i);
+  for (int i = 99; i >= 0; i--)
+    b.emplace(std::to_string(i), i);
+  ASSERT_EQ(a, b);
+
+  const std::vector<std::uint8_t> bytes = EncodeCanonical(a);
+  EXPECT_EQ(bytes, EncodeCanonical(b));
+  EXPECT_EQ(Encode(a).size(), bytes.size());
+  using Map = std::unordered_map<std::string, int>;
+  EXPECT_EQ(a, Decode<Map>(bytes));
+
+  // Keys are ordered by their encoded bytes: fixints, then I16.
+  std::unordered_map<int, int> numbers{{200, 0}, {1, 1}, {100, 2}, {-1, 3}};
+  const std::vector<std::uint8_t> expected{
+      0xbb, 0x04, 0x01, 0x01, 0x64, 0x02, 0x85, 0xc8, 0x00, 0x00, 0xff, 0x03};
+  EXPECT_EQ(expected, EncodeCanonical(numbers));
+}
+
+TEST(Canonical, Table) {
+  Settings settings;
+  settings.name = std::string{"main"};
+  settings.limits = std::unordered_map<std::string, int>{{"cpu", 4}};
+  settings.version = 1;
+
+  const std::vector<std::uint8_t> bytes = EncodeCanonical(settings);
+  EXPECT_EQ(Encode(settings).size(), bytes.size());
+
+  // The entries follow the table header in increasing id order.
+  const std::size_t header = 1 + 9 + 1;
+  ASSERT_LT(header, bytes.size());
+  EXPECT_EQ(2, bytes[header]);
+  EXPECT_EQ(7, Encode(settings)[header]);
+
+  const Settings decoded = Decode<Settings>(bytes);
+  ASSERT_TRUE(decoded.name && decoded.limits && decoded.version);
+  EXPECT_EQ("main", decoded.name.get());
+  EXPECT_EQ(settings.limits.get(), decoded.limits.get());
+  EXPECT_EQ(1, decoded.version.get());
+
+  // Only the order of the entries differs from the default encoding.
+  std::vector<std::uint8_t> sorted = bytes;
+  std::vector<std::uint8_t> unsorted = Encode(settings);
+  std::sort(sorted.begin(), sorted.end());
+  std::sort(unsorted.begin(), unsorted.end());
+  EXPECT_EQ(unsorted, sorted);
+}
+
+TEST(Canonical, Nested) {
+  Catalog a;
+  Catalog b;
+  for (std::int64_t i = 0; i < 50; i++) {
+    a.buckets[i * 1000] = {std::to_string(i)};
+    b.buckets[(49 - i) * 1000] = {std::to_string(49 - i)};
+  }
+  a.settings.limits = std::unordered_map<std::string, int>{};
+  b.settings.limits = std::unordered_map<std::string, int>(64);
+  for (int i = 0; i < 20; i++) {
+    a.settings.limits.get()["limit" + std::to_string(i)] = i;
+    b.settings.limits.get()["limit" + std::to_string(19 - i)] = 19 - i;
+  }
+
+  // Maps nested in table entries are also written canonically.
+  EXPECT_EQ(EncodeCanonical(a), EncodeCanonical(b));
+}
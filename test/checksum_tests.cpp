@@ -0,0 +1,138 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/checksum_reader.h>
+#include <nop/utility/checksum_writer.h>
+#include <nop/utility/crc32c.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_reader.h"
+
+using nop::BufferReader;
+using nop::ChecksumReader;
+using nop::ChecksumWriter;
+using nop::Crc32c;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::PedanticBufferReader;
+using nop::Serializer;
+using nop::TestReader;
+using nop::VectorWriter;
+
+TEST(Checksum, Crc32c) {
+  // Standard check values for CRC32C.
+  EXPECT_EQ(0x00000000u, Crc32c::Compute("", 0));
+  EXPECT_EQ(0xe3069283u, Crc32c::Compute("123456789", 9));
+
+  std::uint8_t zeros[32] = {};
+  EXPECT_EQ(0x8a9136aau, Crc32c::Compute(zeros, sizeof(zeros)));
+  std::uint8_t ones[32];
+  std::memset(ones, 0xff, sizeof(ones));
+  EXPECT_EQ(0x62a8ab43u, Crc32c::Compute(ones, sizeof(ones)));
+
+  // Incremental updates match a single pass at any split.
+  const std::string text = "The quick brown fox jumps over the lazy dog";
+  const std::uint32_t expected = Crc32c::Compute(text.data(), text.size());
+  for (std::size_t split = 0; split <= text.size(); split++) {
+    Crc32c crc;
+    crc.Update(text.data(), split);
+    crc.Update(text.data() + split, text.size() - split);
+    EXPECT_EQ(expected, crc.value()) << split;
+  }
+}
+
+TEST(Checksum, WriterAndReader) {
+  const std::vector<std::string> value{"alpha", "beta", std::string(300, 'x')};
+
+  VectorWriter vector_writer;
+  ChecksumWriter<VectorWriter> writer{&vector_writer};
+  Serializer<ChecksumWriter<VectorWriter>*> serializer{&writer};
+  ASSERT_TRUE(serializer.Write(value));
+  ASSERT_TRUE(writer.Skip(100, 0x5a));
+  EXPECT_EQ(Crc32c::Compute(vector_writer.data().data(), vector_writer.size()),
+            writer.checksum());
+  ASSERT_TRUE(writer.WriteChecksum());
+  ASSERT_TRUE(serializer.Write(std::string{"second"}));
+  ASSERT_TRUE(writer.WriteChecksum());
+  const std::vector<std::uint8_t> data = vector_writer.data();
+
+  // Borrowing readers checksum skipped bytes without copying them.
+  {
+    PedanticBufferReader buffer_reader{data.data(), data.size()};
+    ChecksumReader<PedanticBufferReader> reader{&buffer_reader};
+    Deserializer<ChecksumReader<PedanticBufferReader>*> deserializer{&reader};
+    std::vector<std::string> decoded;
+    ASSERT_TRUE(deserializer.Read(&decoded));
+    EXPECT_EQ(value, decoded);
+    ASSERT_TRUE(reader.Skip(100));
+    ASSERT_TRUE(reader.VerifyChecksum());
+
+    std::string second;
+    ASSERT_TRUE(deserializer.Read(&second));
+    EXPECT_EQ("second", second);
+    ASSERT_TRUE(reader.VerifyChecksum());
+    EXPECT_TRUE(buffer_reader.empty());
+  }
+
+  // Other readers read skipped bytes into a scratch buffer.
+  {
+    TestReader test_reader;
+    test_reader.Set(data);
+    ChecksumReader<TestReader> reader{&test_reader};
+    Deserializer<ChecksumReader<TestReader>*> deserializer{&reader};
+    std::vector<std::string> decoded;
+    ASSERT_TRUE(deserializer.Read(&decoded));
+    ASSERT_TRUE(reader.Skip(100));
+    ASSERT_TRUE(reader.VerifyChecksum());
+  }
+
+  // Any corrupted byte is detected by one of the trailers. The second value is
+  // the string prefix, its length, and six characters.
+  const std::size_t second_size = 8;
+  const std::size_t first_size = data.size() - second_size - 2 * 4;
+  for (std::size_t i = 0; i < data.size(); i += 37) {
+    std::vector<std::uint8_t> corrupt = data;
+    corrupt[i] ^= 0x10;
+    BufferReader buffer_reader{corrupt.data(), corrupt.size()};
+    ChecksumReader<BufferReader> reader{&buffer_reader};
+    ASSERT_TRUE(reader.Skip(first_size));
+    ASSERT_FALSE(reader.VerifyChecksum() && reader.Skip(second_size) &&
+                 reader.VerifyChecksum())
+        << "byte " << i;
+  }
+
+  // Missing trailers run out of input.
+  PedanticBufferReader buffer_reader{data.data(), 3};
+  ChecksumReader<PedanticBufferReader> reader{&buffer_reader};
+  auto status = reader.VerifyChecksum();
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+
+  // Mismatches are reported with their own error.
+  PedanticBufferReader empty_reader{data.data(), 4};
+  ChecksumReader<PedanticBufferReader> mismatch_reader{&empty_reader};
+  status = mismatch_reader.VerifyChecksum();
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ChecksumMismatch, status.error());
+}
@@ -0,0 +1,363 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/chunked_blob.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/chunk_store_reader.h>
+#include <nop/utility/chunk_store_writer.h>
+#include <nop/utility/content_chunker.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BufferReader;
+using nop::ChunkedBlob;
+using nop::ChunkStoreReader;
+using nop::ChunkStoreWriter;
+using nop::ContentChunker;
+using nop::Deserializer;
+using nop::EncodingByte;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::Serializer;
+using nop::SkipValue;
+using nop::Status;
+using nop::VectorWriter;
+
+namespace {
+
+struct Artifact {
+  std::string name;
+  ChunkedBlob contents;
+
+  NOP_STRUCTURE(Artifact, name, contents);
+};
+
+struct PlainArtifact {
+  std::string name;
+  std::vector<std::uint8_t> contents;
+
+  NOP_STRUCTURE(PlainArtifact, name, contents);
+};
+
+// Versions of a table where the reader does not know the blob entry.
+struct BlobTable {
+  Entry<ChunkedBlob, 0> blob;
+  Entry<std::string, 1> name;
+
+  NOP_TABLE_NS("BlobTable", BlobTable, blob, name);
+};
+
+struct NameTable {
+  Entry<std::string, 1> name;
+
+  NOP_TABLE_NS("BlobTable", NameTable, name);
+};
+
+using Writer = ChunkStoreWriter<VectorWriter>;
+using Reader = ChunkStoreReader<BufferReader>;
+
+std::vector<std::uint8_t> MakeData(std::size_t size, std::uint32_t seed) {
+  std::mt19937 engine{seed};
+  std::vector<std::uint8_t> data(size);
+  for (std::uint8_t& byte : data)
+    byte = static_cast<std::uint8_t>(engine());
+  return data;
+}
+
+std::vector<std::vector<std::uint8_t>> Split(
+    const ContentChunker& chunker, const std::vector<std::uint8_t>& data) {
+  std::vector<std::vector<std::uint8_t>> chunks;
+  chunker.ForEachChunk(data.data(), data.size(),
+                       [&chunks](const std::uint8_t* chunk, std::size_t size) {
+                         chunks.emplace_back(chunk, chunk + size);
+                       });
+  return chunks;
+}
+
+// Writes |value| to |serializer| and returns the number of bytes written.
+template <typename T>
+std::size_t WriteValue(Serializer<Writer>* serializer, const T& value) {
+  const std::size_t start = serializer->writer().writer().size();
+  EXPECT_TRUE(serializer->Write(value));
+  return serializer->writer().writer().size() - start;
+}
+
+}  // anonymous namespace
+
+TEST(ContentChunker, Boundaries) {
+  const ContentChunker chunker;
+  const std::vector<std::uint8_t> data = MakeData(1024 * 1024, 1);
+
+  const auto chunks = Split(chunker, data);
+  ASSERT_GT(chunks.size(), 1u);
+  std::vector<std::uint8_t> joined;
+  for (std::size_t i = 0; i < chunks.size(); i++) {
+    EXPECT_LE(chunks[i].size(), chunker.max_size());
+    if (i + 1 < chunks.size()) {
+      EXPECT_GE(chunks[i].size(), chunker.min_size());
+    }
+    joined.insert(joined.end(), chunks[i].begin(), chunks[i].end());
+  }
+  EXPECT_EQ(data, joined);
+
+  // Chunks stay close to the average size.
+  const std::size_t average = data.size() / chunks.size();
+  EXPECT_GT(average, chunker.avg_size() / 2);
+  EXPECT_LT(average, chunker.avg_size() * 2);
+
+  // Splitting is deterministic.
+  EXPECT_EQ(chunks, Split(chunker, data));
+
+  // Buffers smaller than the minimum are a single chunk.
+  EXPECT_EQ(100u, chunker.NextChunkSize(data.data(), 100));
+  EXPECT_EQ(0u, chunker.NextChunkSize(data.data(), 0));
+}
+
+TEST(ContentChunker, EditLocality) {
+  const ContentChunker chunker;
+  std::vector<std::uint8_t> data = MakeData(1024 * 1024, 2);
+  const auto chunks = Split(chunker, data);
+
+  // Insert bytes in the middle of the buffer and delete some near the end.
+  const std::vector<std::uint8_t> insert = MakeData(100, 3);
+  data.insert(data.begin() + data.size() / 2, insert.begin(), insert.end());
+  data.erase(data.end() - 50000, data.end() - 49000);
+  const auto edited = Split(chunker, data);
+
+  const std::set<std::vector<std::uint8_t>> original{chunks.begin(),
+                                                     chunks.end()};
+  std::size_t shared = 0;
+  for (const auto& chunk : edited)
+    shared += original.count(chunk);
+  EXPECT_GE(shared + 6, edited.size());
+}
+
+TEST(ChunkedBlob, Basic) {
+  ChunkedBlob empty;
+  EXPECT_TRUE(empty.empty());
+
+  const std::vector<std::uint8_t> data = MakeData(100000, 4);
+  const ChunkedBlob blob{data};
+  EXPECT_EQ(data.size(), blob.size());
+  EXPECT_EQ(data, blob.get());
+
+  // Without a chunk store blobs encode exactly like byte vectors.
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(Artifact{"a", blob}));
+  Serializer<VectorWriter> plain_serializer;
+  ASSERT_TRUE(plain_serializer.Write(PlainArtifact{"a", data}));
+  EXPECT_EQ(plain_serializer.writer().data(), serializer.writer().data());
+
+  const std::vector<std::uint8_t>& bytes = serializer.writer().data();
+  Artifact artifact;
+  Deserializer<BufferReader> deserializer{bytes.data(), bytes.size()};
+  ASSERT_TRUE(deserializer.Read(&artifact));
+  EXPECT_EQ("a", artifact.name);
+  EXPECT_EQ(blob, artifact.contents);
+
+  // Plain binary data is accepted by a reader with a chunk store.
+  Artifact stored;
+  Deserializer<Reader> store_deserializer{bytes.data(), bytes.size()};
+  ASSERT_TRUE(store_deserializer.Read(&stored));
+  EXPECT_EQ(blob, stored.contents);
+}
+
+TEST(ChunkedBlob, Dedup) {
+  std::vector<std::uint8_t> data = MakeData(512 * 1024, 5);
+  const ChunkedBlob first{data};
+  data[1000] ^= 0xff;
+  const std::vector<std::uint8_t> insert = MakeData(300, 6);
+  data.insert(data.begin() + 300000, insert.begin(), insert.end());
+  const ChunkedBlob second{data};
+
+  Serializer<Writer> serializer;
+  const std::size_t first_size = WriteValue(&serializer, Artifact{"x", first});
+  const std::size_t second_size =
+      WriteValue(&serializer, Artifact{"x", second});
+  const std::size_t third_size =
+      WriteValue(&serializer, Artifact{"x", second});
+
+  // The first copy is sent as binary, later copies mostly as references.
+  EXPECT_GT(first_size, first.size());
+  EXPECT_LT(second_size, second.size() / 10);
+  EXPECT_LT(third_size, second.size() / 50);
+  EXPECT_LE(serializer.writer().store().bytes(),
+            first.size() + second.size());
+
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+  Deserializer<Reader> deserializer{bytes.data(), bytes.size()};
+  Artifact artifact;
+  ASSERT_TRUE(deserializer.Read(&artifact));
+  EXPECT_EQ(first, artifact.contents);
+  ASSERT_TRUE(deserializer.Read(&artifact));
+  EXPECT_EQ(second, artifact.contents);
+  ASSERT_TRUE(deserializer.Read(&artifact));
+  EXPECT_EQ(second, artifact.contents);
+  EXPECT_EQ(serializer.writer().store().size(),
+            deserializer.reader().store().size());
+  EXPECT_EQ(serializer.writer().store().bytes(),
+            deserializer.reader().store().bytes());
+
+  // Byte vectors accept the binary encoding but not manifests.
+  Deserializer<Reader> plain_deserializer{bytes.data(), bytes.size()};
+  PlainArtifact plain;
+  ASSERT_TRUE(plain_deserializer.Read(&plain));
+  ASSERT_FALSE(plain_deserializer.Read(&plain));
+}
+
+TEST(ChunkedBlob, Limit) {
+  const ChunkedBlob blob{MakeData(256 * 1024, 7)};
+
+  Serializer<Writer> serializer;
+  serializer.writer().store().set_limit(64 * 1024);
+  WriteValue(&serializer, blob);
+  const std::size_t second_size = WriteValue(&serializer, blob);
+  EXPECT_LE(serializer.writer().store().bytes(), 64u * 1024);
+  EXPECT_GT(second_size, blob.size() / 2);
+  EXPECT_LT(second_size, blob.size());
+
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+  Deserializer<Reader> deserializer{bytes.data(), bytes.size()};
+  deserializer.reader().store().set_limit(64 * 1024);
+  ChunkedBlob decoded;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(blob, decoded);
+
+  // A reader that keeps fewer chunks cannot resolve the references.
+  Deserializer<Reader> limited{bytes.data(), bytes.size()};
+  limited.reader().store().set_limit(16 * 1024);
+  ASSERT_TRUE(limited.Read(&decoded));
+  Status<void> status = limited.Read(&decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidChunkReference, status.error());
+}
+
+TEST(ChunkedBlob, Errors) {
+  const ChunkedBlob blob{MakeData(64 * 1024, 8)};
+  Serializer<Writer> serializer;
+  WriteValue(&serializer, blob);
+  const std::size_t start = serializer.writer().writer().size();
+  WriteValue(&serializer, blob);
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+  const std::vector<std::uint8_t> manifest{bytes.begin() + start, bytes.end()};
+  ASSERT_EQ(static_cast<std::uint8_t>(EncodingByte::ChunkManifest),
+            manifest[0]);
+
+  // References require a store that holds the chunks.
+  ChunkedBlob decoded;
+  Deserializer<BufferReader> plain{manifest.data(), manifest.size()};
+  Status<void> status = plain.Read(&decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidChunkReference, status.error());
+
+  Deserializer<Reader> empty{manifest.data(), manifest.size()};
+  status = empty.Read(&decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidChunkReference, status.error());
+
+  // Chunks whose bytes do not match their id are rejected.
+  const std::vector<std::uint8_t> data = MakeData(100, 9);
+  Serializer<VectorWriter> forged;
+  ASSERT_TRUE(forged.writer().Write(
+      static_cast<std::uint8_t>(EncodingByte::ChunkManifest)));
+  ASSERT_TRUE(forged.Write(data.size()));
+  ASSERT_TRUE(forged.Write(1u));
+  ASSERT_TRUE(forged.Write(std::uint64_t{1}));
+  ASSERT_TRUE(forged.Write(std::uint64_t{2}));
+  ASSERT_TRUE(forged.Write(data));
+  const std::vector<std::uint8_t>& forged_bytes = forged.writer().data();
+  Deserializer<Reader> checked{forged_bytes.data(), forged_bytes.size()};
+  status = checked.Read(&decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ChecksumMismatch, status.error());
+  EXPECT_EQ(0u, checked.reader().store().size());
+
+  // The chunks must add up to the stated length.
+  std::vector<std::uint8_t> short_bytes = forged_bytes;
+  short_bytes[1] = 101;
+  Deserializer<BufferReader> short_reader{short_bytes.data(),
+                                          short_bytes.size()};
+  status = short_reader.Read(&decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+}
+
+TEST(ChunkedBlob, SkipValue) {
+  const ChunkedBlob blob{MakeData(64 * 1024, 10)};
+  Serializer<Writer> serializer;
+  WriteValue(&serializer, blob);
+  WriteValue(&serializer, blob);
+  WriteValue(&serializer, std::string{"end"});
+
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+  BufferReader reader{bytes.data(), bytes.size()};
+  ASSERT_TRUE(SkipValue(&reader));
+  ASSERT_TRUE(SkipValue(&reader));
+
+  std::string end;
+  Deserializer<BufferReader*> deserializer{&reader};
+  ASSERT_TRUE(deserializer.Read(&end));
+  EXPECT_EQ("end", end);
+}
+
+TEST(ChunkedBlob, SkippedEntry) {
+  // Data that repeats within itself is sent as a manifest the first time,
+  // padded out to the size of the binary encoding in the table entry.
+  const std::vector<std::uint8_t> block = MakeData(64 * 1024, 11);
+  std::vector<std::uint8_t> data = block;
+  data.insert(data.end(), block.begin(), block.end());
+
+  BlobTable table;
+  table.blob = ChunkedBlob{data};
+  table.name = std::string{"repeated"};
+
+  Serializer<Writer> serializer;
+  WriteValue(&serializer, table);
+  const ChunkedBlob reused{block};
+  const std::size_t reused_size = WriteValue(&serializer, reused);
+  EXPECT_LT(reused_size, block.size() / 10);
+
+  // The chunks sent in the unknown entry are kept while it is skipped, so the
+  // blob that follows can refer to them.
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+  Deserializer<Reader> deserializer{bytes.data(), bytes.size()};
+  NameTable decoded;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  ASSERT_TRUE(decoded.name);
+  EXPECT_EQ("repeated", decoded.name.get());
+  EXPECT_EQ(serializer.writer().store().size(),
+            deserializer.reader().store().size());
+
+  ChunkedBlob blob;
+  ASSERT_TRUE(deserializer.Read(&blob));
+  EXPECT_EQ(reused, blob);
+
+  // Skipping the table directly keeps the chunks as well.
+  Deserializer<Reader> skipping{bytes.data(), bytes.size()};
+  ASSERT_TRUE(skipping.Skip());
+  ASSERT_TRUE(skipping.Read(&blob));
+  EXPECT_EQ(reused, blob);
+}
@@ -0,0 +1,144 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/codec.h>
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffer_writer.h>
+#include <nop/utility/vector_writer.h>
+
+namespace codec_test {
+
+struct Point {
+  std::int32_t x;
+  std::int32_t y;
+
+  bool operator==(const Point& other) const {
+    return x == other.x && y == other.y;
+  }
+
+  NOP_STRUCTURE(Point, x, y);
+};
+
+struct Path {
+  std::string name;
+  std::vector<Point> points;
+
+  bool operator==(const Path& other) const {
+    return name == other.name && points == other.points;
+  }
+
+  NOP_STRUCTURE(Path, name, points);
+};
+
+}  // namespace codec_test
+
+NOP_DECLARE_CODEC(::codec_test::Point, ::nop::BufferWriter,
+                  ::nop::BufferReader);
+NOP_DECLARE_CODEC(::codec_test::Path, ::nop::BufferWriter,
+                  ::nop::BufferReader);
+
+using codec_test::Path;
+using codec_test::Point;
+using nop::BufferReader;
+using nop::BufferWriter;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::HasOutOfLineDecoder;
+using nop::HasOutOfLineEncoder;
+using nop::OutOfLineDecoder;
+using nop::OutOfLineEncoder;
+using nop::Serializer;
+using nop::Status;
+using nop::VectorWriter;
+
+namespace {
+
+Path MakePath() {
+  return {"path", {{1, 2}, {-3, 4}, {500000, -600000}}};
+}
+
+}  // anonymous namespace
+
+TEST(Codec, Declarations) {
+  EXPECT_TRUE((HasOutOfLineEncoder<Point, BufferWriter>::value));
+  EXPECT_TRUE((HasOutOfLineDecoder<Point, BufferReader>::value));
+  EXPECT_TRUE((HasOutOfLineEncoder<Path, BufferWriter>::value));
+  EXPECT_TRUE((HasOutOfLineDecoder<Path, BufferReader>::value));
+
+  // Other writers and readers keep the inline encoders.
+  EXPECT_FALSE((HasOutOfLineEncoder<Point, VectorWriter>::value));
+  EXPECT_FALSE((HasOutOfLineDecoder<Point, BufferWriter>::value));
+  EXPECT_FALSE((HasOutOfLineEncoder<Path, BufferReader>::value));
+}
+
+TEST(Codec, RoundTrip) {
+  // The out-of-line encoder produces the same bytes as the inline one.
+  Serializer<VectorWriter> inline_serializer;
+  ASSERT_TRUE(inline_serializer.Write(MakePath()));
+  const std::vector<std::uint8_t>& expected = inline_serializer.writer().data();
+
+  std::array<std::uint8_t, 64> buffer;
+  Serializer<BufferWriter> serializer{buffer.data(), buffer.size()};
+  ASSERT_TRUE(serializer.Write(MakePath()));
+  ASSERT_EQ(expected.size(), serializer.writer().size());
+  EXPECT_EQ(expected, std::vector<std::uint8_t>(
+                          buffer.begin(),
+                          buffer.begin() + serializer.writer().size()));
+
+  Path path;
+  Deserializer<BufferReader> deserializer{buffer.data(),
+                                          serializer.writer().size()};
+  ASSERT_TRUE(deserializer.Read(&path));
+  EXPECT_EQ(MakePath(), path);
+
+  // The out-of-line functions may also be called directly.
+  Point point;
+  BufferWriter writer{buffer.data(), buffer.size()};
+  ASSERT_TRUE((OutOfLineEncoder<Point, BufferWriter>::Write({7, -8}, &writer)));
+  BufferReader reader{buffer.data(), writer.size()};
+  ASSERT_TRUE((OutOfLineDecoder<Point, BufferReader>::Read(&point, &reader)));
+  EXPECT_EQ((Point{7, -8}), point);
+}
+
+TEST(Codec, Errors) {
+  // Errors pass through the out-of-line functions.
+  std::array<std::uint8_t, 4> buffer;
+  Serializer<BufferWriter> serializer{buffer.data(), buffer.size()};
+  Status<void> status = serializer.Write(MakePath());
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, status.error());
+
+  const std::vector<std::uint8_t> bytes = {0xbd, 0x01, 'x'};
+  Path path;
+  Deserializer<BufferReader> deserializer{bytes.data(), bytes.size()};
+  status = deserializer.Read(&path);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+}
+
+// The definitions would usually live in the source file of the type.
+NOP_DEFINE_CODEC(::codec_test::Point, ::nop::BufferWriter,
+                 ::nop::BufferReader);
+NOP_DEFINE_CODEC(::codec_test::Path, ::nop::BufferWriter,
+                 ::nop::BufferReader);
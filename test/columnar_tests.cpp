@@ -0,0 +1,181 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/projection.h>
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/types/columnar.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BufferReader;
+using nop::Columnar;
+using nop::Compose;
+using nop::Decode;
+using nop::Deserializer;
+using nop::Encode;
+using nop::EncodingByte;
+using nop::ErrorStatus;
+using nop::Integer;
+using nop::PedanticBufferReader;
+using nop::SkipValue;
+using nop::Status;
+
+namespace {
+
+enum class Quality : std::uint8_t { Good, Suspect, Bad };
+
+struct Sample {
+  std::uint64_t timestamp;
+  std::int32_t sensor;
+  float value;
+  Quality quality;
+  bool valid;
+  std::string label;
+
+  bool operator==(const Sample& other) const {
+    return timestamp == other.timestamp && sensor == other.sensor &&
+           value == other.value && quality == other.quality &&
+           valid == other.valid && label == other.label;
+  }
+
+  NOP_STRUCTURE(Sample, timestamp, sensor, value, quality, valid, label);
+};
+
+std::vector<Sample> MakeSamples(std::size_t count) {
+  std::vector<Sample> samples;
+  for (std::size_t i = 0; i < count; i++) {
+    samples.push_back({1000000 + i * 10, static_cast<std::int32_t>(i % 5) - 2,
+                       0.5f * i, static_cast<Quality>(i % 3), i % 2 == 0,
+                       std::string(i % 4, 'x')});
+  }
+  return samples;
+}
+
+}  // anonymous namespace
+
+TEST(Columnar, Format) {
+  const Columnar<Sample> empty;
+  EXPECT_EQ(Compose(EncodingByte::Structure, 6, EncodingByte::Binary, 0,
+                    EncodingByte::Binary, 0, EncodingByte::Binary, 0,
+                    EncodingByte::Binary, 0, EncodingByte::Array, 0,
+                    EncodingByte::Array, 0),
+            Encode(empty));
+
+  const Columnar<Sample> samples{
+      {{1, -1, 2.0f, Quality::Bad, true, "a"},
+       {2, 3, -1.0f, Quality::Good, false, ""}}};
+  const std::vector<std::uint8_t> expected = Compose(
+      EncodingByte::Structure, 6,
+      EncodingByte::Binary, 16, Integer<std::uint64_t>(1),
+      Integer<std::uint64_t>(2),
+      EncodingByte::Binary, 8, Integer<std::int32_t>(-1),
+      Integer<std::int32_t>(3),
+      EncodingByte::Binary, 8, nop::Float(2.0f), nop::Float(-1.0f),
+      EncodingByte::Binary, 2, 2, 0,
+      EncodingByte::Array, 2, EncodingByte::True, EncodingByte::False,
+      EncodingByte::Array, 2, EncodingByte::String, 1, "a",
+      EncodingByte::String, 0);
+  EXPECT_EQ(expected, Encode(samples));
+  EXPECT_EQ(expected.size(), nop::Encoding<Columnar<Sample>>::Size(samples));
+
+  // Columns of the encoding may be skipped like any other value.
+  PedanticBufferReader reader{expected.data(), expected.size()};
+  ASSERT_TRUE(SkipValue(&reader));
+  EXPECT_TRUE(reader.empty());
+}
+
+TEST(Columnar, RoundTrip) {
+  const std::vector<Sample> samples = MakeSamples(1000);
+  const std::vector<std::uint8_t> bytes = Encode(Columnar<Sample>{samples});
+
+  Columnar<Sample> decoded{MakeSamples(3)};
+  ASSERT_TRUE(Decode<PedanticBufferReader>(bytes, &decoded));
+  EXPECT_EQ(samples, decoded.get());
+
+  // Decoding a shorter encoding truncates the rows.
+  ASSERT_TRUE(Decode<PedanticBufferReader>(
+      Encode(Columnar<Sample>{MakeSamples(10)}), &decoded));
+  EXPECT_EQ(MakeSamples(10), decoded.get());
+}
+
+TEST(Columnar, Projection) {
+  const std::vector<Sample> samples = MakeSamples(100);
+  const std::vector<std::uint8_t> bytes = Encode(Columnar<Sample>{samples});
+
+  using Series = NOP_PROJECTION(Sample, timestamp, value);
+  Columnar<Sample> decoded;
+  Deserializer<BufferReader> deserializer{bytes.data(), bytes.size()};
+  ASSERT_TRUE(deserializer.ReadProjected<Series>(&decoded));
+  EXPECT_TRUE(deserializer.reader().empty());
+
+  ASSERT_EQ(samples.size(), decoded.get().size());
+  for (std::size_t i = 0; i < samples.size(); i++) {
+    EXPECT_EQ(samples[i].timestamp, decoded.get()[i].timestamp);
+    EXPECT_EQ(samples[i].value, decoded.get()[i].value);
+    EXPECT_EQ(0, decoded.get()[i].sensor);
+    EXPECT_EQ("", decoded.get()[i].label);
+  }
+
+  // Non-raw columns may be projected alone.
+  using Labels = NOP_PROJECTION(Sample, label);
+  deserializer = Deserializer<BufferReader>{bytes.data(), bytes.size()};
+  ASSERT_TRUE(deserializer.ReadProjected<Labels>(&decoded));
+  ASSERT_EQ(samples.size(), decoded.get().size());
+  EXPECT_EQ(samples[3].label, decoded.get()[3].label);
+  EXPECT_EQ(0u, decoded.get()[3].timestamp);
+}
+
+TEST(Columnar, Errors) {
+  Columnar<Sample> decoded;
+
+  // Rows are not accepted in place of columns.
+  Status<void> status =
+      Decode<PedanticBufferReader>(Encode(MakeSamples(2)), &decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+
+  // Every column must have the same number of elements.
+  std::vector<std::uint8_t> bytes = Compose(
+      EncodingByte::Structure, 6, EncodingByte::Binary, 8,
+      Integer<std::uint64_t>(1), EncodingByte::Binary, 8,
+      Integer<std::int32_t>(-1), Integer<std::int32_t>(3));
+  status = Decode<PedanticBufferReader>(bytes, &decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+
+  // Raw columns must hold whole values.
+  bytes = Compose(EncodingByte::Structure, 6, EncodingByte::Binary, 7,
+                  Integer<std::uint32_t>(1), 0, 0, 0);
+  status = Decode<PedanticBufferReader>(bytes, &decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+
+  // Truncated columns are detected before the rows are sized.
+  bytes = Encode(Columnar<Sample>{MakeSamples(100)});
+  bytes.resize(20);
+  status = Decode<PedanticBufferReader>(bytes, &decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
@@ -0,0 +1,223 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/compressing_writer.h>
+#include <nop/utility/decompressing_reader.h>
+#include <nop/utility/lz_codec.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::CompressingWriter;
+using nop::DecompressingReader;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::LzCodec;
+using nop::PedanticBufferReader;
+using nop::Serializer;
+using nop::Status;
+using nop::VectorWriter;
+
+namespace {
+
+struct Snapshot {
+  std::string name;
+  std::vector<std::uint32_t> samples;
+  std::vector<std::string> labels;
+
+  bool operator==(const Snapshot& other) const {
+    return name == other.name && samples == other.samples &&
+           labels == other.labels;
+  }
+
+  NOP_STRUCTURE(Snapshot, name, samples, labels);
+};
+
+Snapshot MakeSnapshot() {
+  Snapshot snapshot{"snapshot", {}, {}};
+  for (std::uint32_t i = 0; i < 5000; i++)
+    snapshot.samples.push_back(i % 64);
+  for (int i = 0; i < 200; i++)
+    snapshot.labels.push_back("label-" + std::to_string(i % 10));
+  return snapshot;
+}
+
+std::vector<std::uint8_t> Compress(const std::vector<std::uint8_t>& data) {
+  std::vector<std::uint8_t> compressed(LzCodec::MaxCompressedSize(data.size()));
+  auto size = LzCodec::Compress(data.data(), data.size(), compressed.data(),
+                                compressed.size());
+  EXPECT_TRUE(size);
+  compressed.resize(size.get());
+  return compressed;
+}
+
+Status<std::vector<std::uint8_t>> Decompress(
+    const std::vector<std::uint8_t>& compressed, std::size_t capacity) {
+  std::vector<std::uint8_t> data(capacity);
+  auto size = LzCodec::Decompress(compressed.data(), compressed.size(),
+                                  data.data(), data.size());
+  if (!size)
+    return size.error();
+
+  data.resize(size.get());
+  return {std::move(data)};
+}
+
+}  // anonymous namespace
+
+TEST(Compression, LzCodec) {
+  std::vector<std::vector<std::uint8_t>> inputs;
+  inputs.push_back({});
+  inputs.push_back({1, 2, 3});
+  inputs.push_back(std::vector<std::uint8_t>(100000, 7));
+
+  // Literal runs and matches long enough to need extension bytes.
+  std::vector<std::uint8_t> mixed;
+  std::uint32_t state = 1;
+  for (int i = 0; i < 3000; i++) {
+    state = state * 1103515245u + 12345u;
+    mixed.push_back(static_cast<std::uint8_t>(state >> 24));
+  }
+  mixed.insert(mixed.end(), mixed.begin(), mixed.begin() + 1000);
+  mixed.insert(mixed.end(), 20, 0xaa);
+  inputs.push_back(mixed);
+
+  for (const auto& input : inputs) {
+    const std::vector<std::uint8_t> compressed = Compress(input);
+    EXPECT_LE(compressed.size(), LzCodec::MaxCompressedSize(input.size()));
+    auto decompressed = Decompress(compressed, input.size());
+    ASSERT_TRUE(decompressed);
+    EXPECT_EQ(input, decompressed.get());
+  }
+
+  // Repetitive input compresses well.
+  EXPECT_LT(Compress(inputs[2]).size(), 1000u);
+  EXPECT_LT(Compress(mixed).size(), 3100u);
+
+  // Output beyond the capacity is rejected.
+  auto status = Decompress(Compress(inputs[2]), 99999);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ProtocolError, status.error());
+
+  // Matches must refer to output that has already been produced.
+  status = Decompress({0x10, 'a', 0x02, 0x00}, 100);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ProtocolError, status.error());
+
+  // Truncated sequences are rejected.
+  status = Decompress({0x30, 'a', 'b'}, 100);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ProtocolError, status.error());
+  status = Decompress({0x10, 'a', 0x01}, 100);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ProtocolError, status.error());
+}
+
+TEST(Compression, RoundTrip) {
+  const Snapshot snapshot = MakeSnapshot();
+
+  Serializer<VectorWriter> plain_serializer;
+  ASSERT_TRUE(plain_serializer.Write(snapshot));
+  const std::size_t plain_size = plain_serializer.writer().size();
+
+  // Small blocks force the value across many blocks.
+  for (std::size_t block_size : {std::size_t{1024}, std::size_t{64 * 1024}}) {
+    VectorWriter vector_writer;
+    CompressingWriter<VectorWriter> writer{&vector_writer, block_size};
+    Serializer<CompressingWriter<VectorWriter>*> serializer{&writer};
+    ASSERT_TRUE(serializer.Write(snapshot));
+    ASSERT_TRUE(serializer.Write(std::string{"end"}));
+    EXPECT_LT(vector_writer.size(), plain_size / 3) << block_size;
+
+    PedanticBufferReader buffer_reader{vector_writer.data().data(),
+                                       vector_writer.size()};
+    DecompressingReader<PedanticBufferReader> reader{&buffer_reader,
+                                                     block_size};
+    Deserializer<DecompressingReader<PedanticBufferReader>*> deserializer{
+        &reader};
+    Snapshot decoded;
+    ASSERT_TRUE(deserializer.Read(&decoded));
+    EXPECT_EQ(snapshot, decoded);
+
+    std::string end;
+    ASSERT_TRUE(deserializer.Read(&end));
+    EXPECT_EQ("end", end);
+    EXPECT_TRUE(buffer_reader.empty());
+  }
+
+  // Incompressible blocks are stored with only the block header.
+  std::vector<std::uint8_t> noise;
+  std::uint32_t state = 7;
+  for (int i = 0; i < 4000; i++) {
+    state = state * 1103515245u + 12345u;
+    noise.push_back(static_cast<std::uint8_t>(state >> 24));
+  }
+  VectorWriter vector_writer;
+  CompressingWriter<VectorWriter> writer{&vector_writer};
+  Serializer<CompressingWriter<VectorWriter>*> serializer{&writer};
+  ASSERT_TRUE(serializer.Write(noise));
+  EXPECT_GE(noise.size() + 10, vector_writer.size());
+}
+
+TEST(Compression, Errors) {
+  VectorWriter vector_writer;
+  CompressingWriter<VectorWriter> writer{&vector_writer, 1024};
+  Serializer<CompressingWriter<VectorWriter>*> serializer{&writer};
+  ASSERT_TRUE(serializer.Write(MakeSnapshot()));
+  std::vector<std::uint8_t> data = vector_writer.data();
+
+  // Blocks larger than the reader accepts are rejected.
+  {
+    PedanticBufferReader buffer_reader{data.data(), data.size()};
+    DecompressingReader<PedanticBufferReader> reader{&buffer_reader, 512};
+    Deserializer<DecompressingReader<PedanticBufferReader>*> deserializer{
+        &reader};
+    Snapshot decoded;
+    auto status = deserializer.Read(&decoded);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+  }
+
+  // Truncated streams run out of input.
+  {
+    PedanticBufferReader buffer_reader{data.data(), data.size() - 1};
+    DecompressingReader<PedanticBufferReader> reader{&buffer_reader, 1024};
+    Deserializer<DecompressingReader<PedanticBufferReader>*> deserializer{
+        &reader};
+    Snapshot decoded;
+    auto status = deserializer.Read(&decoded);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+  }
+
+  // Corrupt compressed blocks are rejected.
+  {
+    std::vector<std::uint8_t> corrupt = data;
+    corrupt[4] ^= 0xff;
+    PedanticBufferReader buffer_reader{corrupt.data(), corrupt.size()};
+    DecompressingReader<PedanticBufferReader> reader{&buffer_reader, 1024};
+    Deserializer<DecompressingReader<PedanticBufferReader>*> deserializer{
+        &reader};
+    Snapshot decoded;
+    auto status = deserializer.Read(&decoded);
+    ASSERT_FALSE(status);
+  }
+}
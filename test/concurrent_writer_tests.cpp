@@ -0,0 +1,144 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/concurrent_buffer_writer.h>
+#include <nop/utility/frame_reader.h>
+
+using nop::BufferReader;
+using nop::ConcurrentBufferWriter;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::FrameReader;
+using nop::Status;
+
+namespace {
+
+struct Entry {
+  int thread;
+  int sequence;
+  std::string text;
+
+  NOP_STRUCTURE(Entry, thread, sequence, text);
+};
+
+// Splits the committed frames of |writer| into entries.
+std::vector<Entry> ReadEntries(const ConcurrentBufferWriter& writer) {
+  FrameReader frames;
+  frames.Append(writer.data(), writer.committed());
+
+  std::vector<Entry> entries;
+  BufferReader frame;
+  Status<bool> next;
+  while ((next = frames.NextFrame(&frame)) && next.get()) {
+    Deserializer<BufferReader*> deserializer{&frame};
+    Entry entry;
+    EXPECT_TRUE(deserializer.Read(&entry));
+    entries.push_back(entry);
+  }
+  EXPECT_TRUE(next);
+  EXPECT_EQ(0u, frames.available());
+  return entries;
+}
+
+}  // anonymous namespace
+
+TEST(ConcurrentBufferWriter, Write) {
+  std::vector<std::uint8_t> buffer(64);
+  ConcurrentBufferWriter writer{buffer.data(), buffer.size()};
+
+  Status<std::size_t> offset = writer.Write(Entry{0, 1, "one"});
+  ASSERT_TRUE(offset);
+  EXPECT_EQ(0u, offset.get());
+  const std::size_t first_size = writer.committed();
+
+  offset = writer.Write(Entry{0, 2, "two"});
+  ASSERT_TRUE(offset);
+  EXPECT_EQ(first_size, offset.get());
+
+  std::vector<Entry> entries = ReadEntries(writer);
+  ASSERT_EQ(2u, entries.size());
+  EXPECT_EQ(1, entries[0].sequence);
+  EXPECT_EQ("two", entries[1].text);
+
+  // Frames that do not fit fail without being published.
+  const std::size_t committed = writer.committed();
+  offset = writer.Write(Entry{0, 3, std::string(64, 'x')});
+  ASSERT_FALSE(offset);
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, offset.error());
+  EXPECT_TRUE(writer.full());
+  EXPECT_EQ(committed, writer.committed());
+
+  offset = writer.Write(Entry{0, 4, ""});
+  ASSERT_FALSE(offset);
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, offset.error());
+
+  writer.Reset();
+  EXPECT_FALSE(writer.full());
+  EXPECT_EQ(0u, writer.committed());
+  ASSERT_TRUE(writer.Write(Entry{0, 5, "five"}));
+  entries = ReadEntries(writer);
+  ASSERT_EQ(1u, entries.size());
+  EXPECT_EQ(5, entries[0].sequence);
+}
+
+TEST(ConcurrentBufferWriter, Threads) {
+  const int kThreads = 8;
+  const int kEntries = 2000;
+  std::vector<std::uint8_t> buffer(4 * 1024 * 1024);
+  ConcurrentBufferWriter writer{buffer.data(), buffer.size()};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&writer, i] {
+      for (int j = 0; j < kEntries; j++) {
+        // Vary the sizes so that spans are claimed at uneven offsets.
+        Entry entry{i, j, std::string((i * 7 + j) % 50, 'a' + i)};
+        EXPECT_TRUE(writer.Write(entry));
+      }
+    });
+  }
+
+  // Committed frames are complete even while the writers are running.
+  std::size_t polls = 0;
+  while (writer.committed() == 0 || polls++ < 100)
+    ReadEntries(writer);
+
+  for (auto& thread : threads)
+    thread.join();
+
+  const std::vector<Entry> entries = ReadEntries(writer);
+  ASSERT_EQ(static_cast<std::size_t>(kThreads * kEntries), entries.size());
+
+  // Each thread's entries appear in the order it wrote them.
+  std::vector<int> next(kThreads, 0);
+  for (const Entry& entry : entries) {
+    ASSERT_LE(0, entry.thread);
+    ASSERT_GT(kThreads, entry.thread);
+    EXPECT_EQ(next[entry.thread]++, entry.sequence);
+    EXPECT_EQ(std::string((entry.thread * 7 + entry.sequence) % 50,
+                          'a' + entry.thread),
+              entry.text);
+  }
+}
@@ -20,16 +20,25 @@
 #include <nop/serializer.h>
 #include <nop/structure.h>
 #include <nop/table.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffer_writer.h>
 #include <nop/utility/constexpr_buffer_writer.h>
+#include <nop/utility/message_template.h>
 #include <nop/value.h>
 
 #include "test_utilities.h"
 
+using nop::BufferReader;
+using nop::BufferWriter;
 using nop::ConstexprBufferWriter;
+using nop::Deserializer;
 using nop::Encoding;
 using nop::EncodingByte;
 using nop::Entry;
+using nop::ErrorStatus;
 using nop::Integer;
+using nop::MessageTemplate;
+using nop::Patchable;
 using nop::Serializer;
 
 namespace {
@@ -139,6 +148,47 @@ constexpr auto SerializeBasicTableArray() {
 
 constexpr auto kSerializedBasicTableArray = SerializeBasicTableArray();
 
+struct Heartbeat {
+  std::uint32_t protocol_version;
+  Patchable<std::uint64_t, 0> sequence;
+  std::int8_t flags;
+  Patchable<std::int16_t, 1> load;
+  NOP_STRUCTURE(Heartbeat, protocol_version, sequence, flags, load);
+};
+
+struct PlainHeartbeat {
+  std::uint32_t protocol_version;
+  std::uint64_t sequence;
+  std::int8_t flags;
+  std::int16_t load;
+  NOP_STRUCTURE(PlainHeartbeat, protocol_version, sequence, flags, load);
+};
+
+constexpr MessageTemplate<Heartbeat, 2> kHeartbeat{Heartbeat{3, 0, -1, 0}};
+static_assert(kHeartbeat.ok(), "");
+static_assert(kHeartbeat.size() == 16, "");
+static_assert(kHeartbeat.offset(0) == 4 && kHeartbeat.width(0) == 8, "");
+static_assert(kHeartbeat.offset(1) == 14 && kHeartbeat.width(1) == 2, "");
+
+// Field indices must be used exactly once.
+constexpr MessageTemplate<Heartbeat, 3> kMissingField{Heartbeat{}};
+static_assert(kMissingField.error() == ErrorStatus::InvalidMemberCount, "");
+constexpr MessageTemplate<Heartbeat, 1> kExtraField{Heartbeat{}};
+static_assert(kExtraField.error() == ErrorStatus::InvalidMemberCount, "");
+
+// Patchable fields in table entries are recorded through the entry writer.
+struct HeartbeatTable {
+  Entry<std::uint32_t, 0> protocol_version;
+  Entry<Patchable<std::uint64_t, 0>, 1> sequence;
+
+  NOP_TABLE(HeartbeatTable, protocol_version, sequence);
+};
+
+constexpr MessageTemplate<HeartbeatTable, 1, 32> kHeartbeatTable{
+    HeartbeatTable{3, Patchable<std::uint64_t, 0>{0}}};
+static_assert(kHeartbeatTable.ok(), "");
+static_assert(kHeartbeatTable.width(0) == 8, "");
+
 }  // anonymous namespace
 
 TEST(Constexpr, SerializedData) {
@@ -192,3 +242,58 @@ TEST(Constexpr, SerializedData) {
     EXPECT_EQ(expected, actual);
   }
 }
+
+TEST(Constexpr, MessageTemplate) {
+  std::vector<std::uint8_t> expected =
+      Compose(EncodingByte::Structure, 4, 3, EncodingByte::U64,
+              Integer<std::uint64_t>(0), -1, EncodingByte::I16,
+              Integer<std::int16_t>(0));
+  std::vector<std::uint8_t> actual{kHeartbeat.data(),
+                                   kHeartbeat.data() + kHeartbeat.size()};
+  EXPECT_EQ(expected, actual);
+
+  // Instances patch the fields in place and decode as ordinary integers.
+  std::uint8_t buffer[kHeartbeat.size()];
+  kHeartbeat.Instantiate(buffer, std::uint64_t{0x0102030405060708},
+                         std::int16_t{-300});
+  expected = Compose(EncodingByte::Structure, 4, 3, EncodingByte::U64,
+                     Integer<std::uint64_t>(0x0102030405060708), -1,
+                     EncodingByte::I16, Integer<std::int16_t>(-300));
+  actual = {std::begin(buffer), std::end(buffer)};
+  EXPECT_EQ(expected, actual);
+
+  PlainHeartbeat plain;
+  Deserializer<BufferReader> deserializer{buffer, sizeof(buffer)};
+  ASSERT_TRUE(deserializer.Read(&plain));
+  EXPECT_EQ(3u, plain.protocol_version);
+  EXPECT_EQ(0x0102030405060708u, plain.sequence);
+  EXPECT_EQ(-1, plain.flags);
+  EXPECT_EQ(-300, plain.load);
+
+  // Patchable fields accept the compact encodings of the plain type.
+  Heartbeat heartbeat;
+  Serializer<BufferWriter> serializer{buffer, sizeof(buffer)};
+  ASSERT_TRUE(serializer.Write(PlainHeartbeat{3, 7, 0, -5}));
+  Deserializer<BufferReader> plain_deserializer{buffer, sizeof(buffer)};
+  ASSERT_TRUE(plain_deserializer.Read(&heartbeat));
+  EXPECT_EQ(7u, heartbeat.sequence.get());
+  EXPECT_EQ(-5, heartbeat.load.get());
+
+  // Patching a single field leaves the rest of the copy alone.
+  kHeartbeat.CopyTo(buffer);
+  kHeartbeat.Patch(buffer, 1, std::int16_t{42});
+  Deserializer<BufferReader> patched_deserializer{buffer, sizeof(buffer)};
+  ASSERT_TRUE(patched_deserializer.Read(&plain));
+  EXPECT_EQ(0u, plain.sequence);
+  EXPECT_EQ(42, plain.load);
+
+  // Fields inside table entries are patched in place as well.
+  std::uint8_t table_buffer[kHeartbeatTable.size()];
+  kHeartbeatTable.Instantiate(table_buffer, std::uint64_t{1} << 40);
+  HeartbeatTable table;
+  Deserializer<BufferReader> table_deserializer{table_buffer,
+                                                sizeof(table_buffer)};
+  ASSERT_TRUE(table_deserializer.Read(&table));
+  EXPECT_EQ(3u, table.protocol_version.get());
+  EXPECT_EQ(std::uint64_t{1} << 40, table.sequence.get().get());
+}
@@ -0,0 +1,148 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/decode_cache.h>
+#include <nop/utility/hashing_writer.h>
+#include <nop/utility/sip_hash.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::DecodeCache;
+using nop::Encode;
+using nop::ErrorStatus;
+using nop::HashingWriter;
+using nop::Serializer;
+using nop::SipHasher;
+using nop::VectorWriter;
+
+namespace {
+
+struct Config {
+  std::string name;
+  std::map<std::string, std::string> settings;
+  std::vector<std::uint32_t> shards;
+
+  NOP_STRUCTURE(Config, name, settings, shards);
+};
+
+Config MakeConfig(const std::string& name) {
+  return {name, {{"region", "west"}, {"mode", "fast"}}, {1, 2, 3, 4}};
+}
+
+}  // anonymous namespace
+
+TEST(DecodeCache, HitsShareValues) {
+  const std::vector<std::uint8_t> a = Encode(MakeConfig("a"));
+  const std::vector<std::uint8_t> b = Encode(MakeConfig("b"));
+  DecodeCache<Config> cache{1024};
+
+  auto first = cache.Decode(a.data(), a.size());
+  ASSERT_TRUE(first);
+  EXPECT_EQ("a", first.get()->name);
+  EXPECT_EQ(0u, cache.stats().hit_count);
+  EXPECT_EQ(1u, cache.stats().miss_count);
+
+  // A separate copy of the same bytes returns the same object.
+  const std::vector<std::uint8_t> copy = a;
+  auto second = cache.Decode(copy.data(), copy.size());
+  ASSERT_TRUE(second);
+  EXPECT_EQ(first.get().get(), second.get().get());
+
+  auto other = cache.Decode(b.data(), b.size());
+  ASSERT_TRUE(other);
+  EXPECT_EQ("b", other.get()->name);
+  EXPECT_NE(first.get().get(), other.get().get());
+
+  EXPECT_EQ(1u, cache.stats().hit_count);
+  EXPECT_EQ(2u, cache.stats().miss_count);
+  EXPECT_EQ(2u, cache.stats().entry_count);
+  EXPECT_EQ(a.size() + b.size(), cache.stats().bytes_held);
+  EXPECT_DOUBLE_EQ(1.0 / 3.0, cache.stats().hit_rate());
+
+  // A key computed by a HashingWriter while encoding matches.
+  VectorWriter writer;
+  Serializer<HashingWriter<VectorWriter, SipHasher<128>>> serializer{&writer};
+  ASSERT_TRUE(serializer.Write(MakeConfig("a")));
+  EXPECT_EQ(cache.Hash(a.data(), a.size()), serializer.writer().hash());
+  auto keyed = cache.Decode(serializer.writer().hash(), writer.data().data(),
+                            writer.size());
+  ASSERT_TRUE(keyed);
+  EXPECT_EQ(first.get().get(), keyed.get().get());
+
+  cache.ResetStats();
+  EXPECT_EQ(0u, cache.stats().hit_count);
+  EXPECT_EQ(2u, cache.stats().entry_count);
+}
+
+TEST(DecodeCache, Eviction) {
+  std::vector<std::vector<std::uint8_t>> payloads;
+  for (char name = 'a'; name <= 'e'; name++)
+    payloads.push_back(Encode(MakeConfig(std::string(1, name))));
+  const std::size_t size = payloads[0].size();
+
+  // Room for three values.
+  DecodeCache<Config> cache{3 * size};
+  for (int i = 0; i < 3; i++)
+    ASSERT_TRUE(cache.Decode(payloads[i].data(), size));
+
+  // Using "a" makes "b" the least recently used value.
+  auto a = cache.Decode(payloads[0].data(), size);
+  ASSERT_TRUE(a);
+  ASSERT_TRUE(cache.Decode(payloads[3].data(), size));
+  EXPECT_EQ(1u, cache.stats().eviction_count);
+  EXPECT_EQ(3u, cache.stats().entry_count);
+  EXPECT_TRUE(cache.Find(cache.Hash(payloads[0].data(), size)));
+  EXPECT_FALSE(cache.Find(cache.Hash(payloads[1].data(), size)));
+  EXPECT_TRUE(cache.Find(cache.Hash(payloads[2].data(), size)));
+
+  // Evicted values stay alive while held.
+  cache.Clear();
+  EXPECT_EQ(0u, cache.stats().entry_count);
+  EXPECT_EQ(0u, cache.stats().bytes_held);
+  EXPECT_EQ("a", a.get()->name);
+
+  // Values larger than the capacity are decoded but not cached.
+  DecodeCache<Config> small{size - 1};
+  auto decoded = small.Decode(payloads[4].data(), size);
+  ASSERT_TRUE(decoded);
+  EXPECT_EQ("e", decoded.get()->name);
+  EXPECT_EQ(0u, small.stats().entry_count);
+}
+
+TEST(DecodeCache, Errors) {
+  std::vector<std::uint8_t> payload = Encode(MakeConfig("a"));
+  payload.pop_back();
+
+  DecodeCache<Config> cache{1024};
+  auto status = cache.Decode(payload.data(), payload.size());
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+  EXPECT_EQ(0u, cache.stats().entry_count);
+
+  // Failures are not cached.
+  status = cache.Decode(payload.data(), payload.size());
+  ASSERT_FALSE(status);
+  EXPECT_EQ(2u, cache.stats().miss_count);
+}
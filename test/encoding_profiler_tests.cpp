@@ -0,0 +1,164 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/variant.h>
+#include <nop/utility/encoding_profiler.h>
+
+using nop::Entry;
+using nop::EncodingProfile;
+using nop::ErrorStatus;
+using nop::ProfileBytes;
+using nop::ProfileEncoding;
+using nop::ProfileNode;
+using nop::ProfileValue;
+using nop::Status;
+using nop::Variant;
+
+namespace {
+
+struct Sample {
+  std::uint32_t time;
+  std::string label;
+  NOP_STRUCTURE(Sample, time, label);
+};
+
+struct Series {
+  std::string name;
+  std::vector<Sample> samples;
+  NOP_STRUCTURE(Series, name, samples);
+};
+
+struct Config {
+  Entry<std::uint32_t, 1> version;
+  Entry<std::map<std::string, int>, 4> limits;
+  NOP_TABLE_NS("Config", Config, version, limits);
+};
+
+void ExpectBytes(const ProfileBytes& bytes, std::size_t prefix,
+                 std::size_t header, std::size_t padding,
+                 std::size_t payload) {
+  EXPECT_EQ(prefix, bytes.prefix);
+  EXPECT_EQ(header, bytes.header);
+  EXPECT_EQ(padding, bytes.padding);
+  EXPECT_EQ(payload, bytes.payload);
+}
+
+}  // anonymous namespace
+
+TEST(EncodingProfiler, Structure) {
+  Series series{"temperature", {{1, "a"}, {1000, "bcd"}, {100000, ""}}};
+  Status<EncodingProfile> profile = ProfileValue(series);
+  ASSERT_TRUE(profile);
+
+  // STU 2 | STR 11 "temperature" | ARY 3 [STU 2 | INT | STR N ...] x 3
+  const ProfileNode& root = profile.get().root();
+  EXPECT_EQ(1u, root.count);
+  ExpectBytes(root.self, 1, 1, 0, 0);
+  EXPECT_EQ(42u, root.total.total());
+
+  const ProfileNode* name = profile.get().Find("/.0");
+  ASSERT_NE(nullptr, name);
+  ExpectBytes(name->total, 1, 1, 0, 11);
+
+  // Elements of an array are aggregated.
+  const ProfileNode* samples = profile.get().Find("/.1/[]");
+  ASSERT_NE(nullptr, samples);
+  EXPECT_EQ(3u, samples->count);
+  ExpectBytes(samples->self, 3, 3, 0, 0);
+
+  const ProfileNode* times = profile.get().Find("/.1/[]/.0");
+  ASSERT_NE(nullptr, times);
+  EXPECT_EQ(3u, times->count);
+  ExpectBytes(times->total, 3, 0, 0, 2 + 4);
+
+  const ProfileNode* labels = profile.get().Find("/.1/[]/.1");
+  ASSERT_NE(nullptr, labels);
+  ExpectBytes(labels->total, 3, 3, 0, 4);
+
+  EXPECT_EQ(nullptr, profile.get().Find("/.2"));
+  EXPECT_EQ(&root, profile.get().Find("/"));
+
+  // The breakdown by encoding excludes nested values.
+  const auto& strings = profile.get().by_encoding().at("String");
+  ExpectBytes(strings, 4, 4, 0, 15);
+  const auto& structures = profile.get().by_encoding().at("Structure");
+  EXPECT_EQ(4u, structures.prefix);
+}
+
+TEST(EncodingProfiler, Table) {
+  Config config;
+  config.version = 3;
+  config.limits = std::map<std::string, int>{{"cpu", 4}, {"memory", 4096}};
+  Status<EncodingProfile> profile = ProfileValue(config);
+  ASSERT_TRUE(profile);
+
+  const ProfileNode* version = profile.get().Find("/#1");
+  ASSERT_NE(nullptr, version);
+  EXPECT_EQ(1u, version->total.total());
+
+  const ProfileNode* keys = profile.get().Find("/#4/{key}");
+  ASSERT_NE(nullptr, keys);
+  EXPECT_EQ(2u, keys->count);
+  ExpectBytes(keys->total, 2, 2, 0, 9);
+
+  const ProfileNode* values = profile.get().Find("/#4/{value}");
+  ASSERT_NE(nullptr, values);
+  ExpectBytes(values->total, 2, 0, 0, 2);
+
+  const std::string report = profile.get().Report();
+  EXPECT_NE(std::string::npos, report.find("/#4/{key}"));
+  EXPECT_NE(std::string::npos, report.find("Table"));
+
+  // Reports may be limited in depth.
+  EXPECT_EQ(std::string::npos, profile.get().Report(1).find("{key}"));
+}
+
+TEST(EncodingProfiler, Variant) {
+  using Value = Variant<int, std::string>;
+  std::vector<Value> values{Value{1}, Value{std::string{"two"}}, Value{3}};
+  Status<EncodingProfile> profile = ProfileValue(values);
+  ASSERT_TRUE(profile);
+
+  const ProfileNode* ints = profile.get().Find("/[]/<0>");
+  ASSERT_NE(nullptr, ints);
+  EXPECT_EQ(2u, ints->count);
+
+  const ProfileNode* strings = profile.get().Find("/[]/<1>");
+  ASSERT_NE(nullptr, strings);
+  EXPECT_EQ(1u, strings->count);
+  EXPECT_EQ(3u, strings->total.payload);
+}
+
+TEST(EncodingProfiler, Errors) {
+  const std::uint8_t truncated[] = {0xbd, 0x05, 'a', 'b'};
+  Status<EncodingProfile> profile =
+      ProfileEncoding(truncated, sizeof(truncated));
+  ASSERT_FALSE(profile);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, profile.error());
+
+  const std::uint8_t reserved[] = {0x8a};
+  profile = ProfileEncoding(reserved, sizeof(reserved));
+  ASSERT_FALSE(profile);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, profile.error());
+}
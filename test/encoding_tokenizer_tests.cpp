@@ -0,0 +1,245 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/optional.h>
+#include <nop/types/variant.h>
+#include <nop/utility/encoding_tokenizer.h>
+#include <nop/utility/json_writer.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Encode;
+using nop::EncodingByte;
+using nop::EncodingToJson;
+using nop::EncodingTokenizer;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::Optional;
+using nop::Serializer;
+using nop::Status;
+using nop::Token;
+using nop::TokenType;
+using nop::Variant;
+using nop::VectorWriter;
+
+namespace {
+
+struct Record {
+  int id;
+  std::string name;
+  std::vector<std::string> tags;
+  std::map<int, float> weights;
+
+  NOP_STRUCTURE(Record, id, name, tags, weights);
+};
+
+struct Settings {
+  Entry<int, 0> level;
+  Entry<std::string, 1> label;
+  Entry<Variant<int, std::string>, 2> choice;
+
+  NOP_TABLE_NS("Settings", Settings, level, label, choice);
+};
+
+template <typename T>
+std::string ToJson(const T& value) {
+  const std::vector<std::uint8_t> bytes = Encode(value);
+  std::string json;
+  EXPECT_TRUE(EncodingToJson(bytes.data(), bytes.size(), &json));
+  return json;
+}
+
+Status<void> ToJson(const std::vector<std::uint8_t>& bytes,
+                    std::string* json) {
+  return EncodingToJson(bytes.data(), bytes.size(), json);
+}
+
+}  // anonymous namespace
+
+TEST(EncodingTokenizer, Tokens) {
+  const std::vector<std::uint8_t> bytes =
+      Encode(Record{7, "name", {"a", "bc"}, {{-1, 0.5f}}});
+
+  EncodingTokenizer tokenizer{bytes.data(), bytes.size()};
+  std::vector<Token> tokens;
+  Token token;
+  do {
+    ASSERT_TRUE(tokenizer.Next(&token));
+    tokens.push_back(token);
+  } while (token.type != TokenType::End);
+
+  const std::vector<TokenType> expected_types = {
+      TokenType::BeginStructure, TokenType::Integer,  TokenType::String,
+      TokenType::BeginArray,     TokenType::String,   TokenType::String,
+      TokenType::EndArray,       TokenType::BeginMap, TokenType::Integer,
+      TokenType::Float,          TokenType::EndMap,   TokenType::EndStructure,
+      TokenType::End};
+  const std::vector<std::size_t> expected_depths = {0, 1, 1, 1, 2, 2, 1,
+                                                    1, 2, 2, 1, 0, 0};
+  ASSERT_EQ(expected_types.size(), tokens.size());
+  for (std::size_t i = 0; i < tokens.size(); i++) {
+    EXPECT_EQ(expected_types[i], tokens[i].type) << "token " << i;
+    EXPECT_EQ(expected_depths[i], tokens[i].depth) << "token " << i;
+  }
+
+  EXPECT_EQ(4u, tokens[0].count);
+  EXPECT_EQ(7, tokens[1].integer);
+  EXPECT_EQ("name", std::string(reinterpret_cast<const char*>(tokens[2].data),
+                                tokens[2].size));
+  EXPECT_EQ(2u, tokens[3].count);
+  EXPECT_EQ("bc", std::string(reinterpret_cast<const char*>(tokens[5].data),
+                              tokens[5].size));
+  EXPECT_EQ(1u, tokens[7].count);
+  EXPECT_EQ(-1, tokens[8].integer);
+  EXPECT_EQ(EncodingByte::F32, tokens[9].prefix);
+  EXPECT_EQ(0.5, tokens[9].real);
+  EXPECT_EQ(bytes.size(), tokens.back().offset);
+
+  // String tokens point into the buffer.
+  EXPECT_EQ(bytes.data() + tokens[1].offset + 3, tokens[2].data);
+}
+
+TEST(EncodingTokenizer, TableEntries) {
+  Settings settings;
+  settings.level = 3;
+  settings.choice = Variant<int, std::string>{std::string{"x"}};
+  const std::vector<std::uint8_t> bytes = Encode(settings);
+
+  EncodingTokenizer tokenizer{bytes.data(), bytes.size()};
+  Token token;
+  ASSERT_TRUE(tokenizer.Next(&token));
+  ASSERT_EQ(TokenType::BeginTable, token.type);
+  EXPECT_EQ(2u, token.count);
+
+  ASSERT_TRUE(tokenizer.Next(&token));
+  ASSERT_EQ(TokenType::TableEntry, token.type);
+  EXPECT_EQ(0u, token.id);
+  EXPECT_EQ(1u, token.size);
+  ASSERT_TRUE(tokenizer.Next(&token));
+  EXPECT_EQ(TokenType::Integer, token.type);
+  EXPECT_EQ(3, token.integer);
+
+  ASSERT_TRUE(tokenizer.Next(&token));
+  ASSERT_EQ(TokenType::TableEntry, token.type);
+  EXPECT_EQ(2u, token.id);
+  ASSERT_TRUE(tokenizer.Next(&token));
+  EXPECT_EQ(TokenType::BeginVariant, token.type);
+  ASSERT_TRUE(tokenizer.Next(&token));
+  EXPECT_EQ(1, token.integer);
+  ASSERT_TRUE(tokenizer.Next(&token));
+  EXPECT_EQ(TokenType::String, token.type);
+  ASSERT_TRUE(tokenizer.Next(&token));
+  EXPECT_EQ(TokenType::EndVariant, token.type);
+  ASSERT_TRUE(tokenizer.Next(&token));
+  EXPECT_EQ(TokenType::EndTable, token.type);
+  ASSERT_TRUE(tokenizer.Next(&token));
+  EXPECT_EQ(TokenType::End, token.type);
+}
+
+TEST(EncodingTokenizer, Errors) {
+  Token token;
+
+  // Reserved prefixes.
+  const std::uint8_t reserved[] = {0x8a};
+  EncodingTokenizer reserved_tokenizer{reserved, sizeof(reserved)};
+  Status<void> status = reserved_tokenizer.Next(&token);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+
+  // Truncated input.
+  std::vector<std::uint8_t> bytes = Encode(std::string{"truncated"});
+  bytes.pop_back();
+  EncodingTokenizer truncated_tokenizer{bytes.data(), bytes.size()};
+  status = truncated_tokenizer.Next(&token);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+
+  // Deeply nested input.
+  std::vector<std::uint8_t> nested;
+  for (int i = 0; i < 1000; i++) {
+    nested.push_back(0xba);  // Array.
+    nested.push_back(0x01);  // One element.
+  }
+  nested.push_back(0x00);
+  EncodingTokenizer nested_tokenizer{nested.data(), nested.size()};
+  do {
+    status = nested_tokenizer.Next(&token);
+  } while (status && token.type != TokenType::End);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+}
+
+TEST(JsonWriter, Values) {
+  EXPECT_EQ("[7,\"name\",[\"a\",\"bc\"],{\"-1\":0.5}]\n",
+            ToJson(Record{7, "name", {"a", "bc"}, {{-1, 0.5f}}}));
+
+  Settings settings;
+  settings.level = 3;
+  settings.choice = Variant<int, std::string>{std::string{"x"}};
+  EXPECT_EQ("{\"0\":3,\"2\":{\"variant\":1,\"value\":\"x\"}}\n",
+            ToJson(settings));
+
+  EXPECT_EQ("\"AQID\"\n", ToJson(std::vector<std::uint8_t>{1, 2, 3}));
+  EXPECT_EQ("{\"bits\":9,\"bytes\":\"DQE=\"}\n",
+            ToJson(std::vector<bool>{true, false, true, true, false, false,
+                                     false, false, true}));
+  EXPECT_EQ("[null,1.25,18446744073709551615,-9000000000]\n",
+            ToJson(std::make_tuple(Optional<int>{}, 1.25, ~std::uint64_t{0},
+                                   std::int64_t{-9000000000})));
+
+  using PairKeys = std::map<std::pair<int, int>, std::string>;
+  EXPECT_EQ("{\"[1,2]\":\"a\",\"[3,4]\":\"b\"}\n",
+            ToJson(PairKeys{{{1, 2}, "a"}, {{3, 4}, "b"}}));
+}
+
+TEST(JsonWriter, Escaping) {
+  EXPECT_EQ(
+      "\"say \\\"hi\\\"\\n\\ta\\\\b and some longer plain text\\u0001\"\n",
+      ToJson(std::string{"say \"hi\"\n\ta\\b and some longer plain text\x01"}));
+
+  const std::string plain(100, 'x');
+  EXPECT_EQ("\"" + plain + "\"\n", ToJson(plain));
+}
+
+TEST(JsonWriter, Lines) {
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(1));
+  ASSERT_TRUE(serializer.Write(std::string{"two"}));
+  ASSERT_TRUE(serializer.Write(std::vector<std::string>{}));
+
+  std::string json;
+  ASSERT_TRUE(ToJson(serializer.writer().data(), &json));
+  EXPECT_EQ("1\n\"two\"\n[]\n", json);
+
+  // Errors stop the transcoder.
+  std::vector<std::uint8_t> bytes = serializer.writer().data();
+  bytes.push_back(0x8a);
+  json.clear();
+  Status<void> status = ToJson(bytes, &json);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+}
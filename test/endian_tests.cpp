@@ -17,10 +17,25 @@
 #include <algorithm>
 #include <cstdint>
 #include <type_traits>
+#include <vector>
 
+#include <nop/serializer.h>
+#include <nop/utility/buffer_reader.h>
 #include <nop/utility/endian.h>
+#include <nop/utility/endian_reader.h>
+#include <nop/utility/endian_writer.h>
+#include <nop/utility/vector_writer.h>
 
+using nop::BufferReader;
+using nop::ByteOrder;
+using nop::ConvertByteOrder;
+using nop::Deserializer;
+using nop::EndianReader;
+using nop::EndianWriter;
+using nop::HostByteOrder;
 using nop::HostEndian;
+using nop::Serializer;
+using nop::VectorWriter;
 
 namespace {
 
@@ -166,3 +181,78 @@ TEST(EndianTests, Big) {
               HostEndian<std::int64_t>::ToBig(0x7766554433221100LL));
   }
 }
+
+TEST(EndianTests, ConvertByteOrder) {
+  const std::uint32_t values[] = {0x33221100u, 0x77665544u, 0xbbaa9988u};
+  std::uint32_t little[3];
+  std::uint32_t big[3];
+  ConvertByteOrder(ByteOrder::Little, values, values + 3, little);
+  ConvertByteOrder(ByteOrder::Big, values, values + 3, big);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(HostEndian<std::uint32_t>::ToLittle(values[i]), little[i]);
+    EXPECT_EQ(HostEndian<std::uint32_t>::ToBig(values[i]), big[i]);
+  }
+
+  // Conversion in place reverses the previous conversion.
+  ConvertByteOrder(ByteOrder::Big, big, big + 3, big);
+  EXPECT_TRUE(std::equal(values, values + 3, big));
+
+  // Floating point values are converted through their bit patterns.
+  const double doubles[] = {1.5, -0.25};
+  double converted[2];
+  const ByteOrder foreign = HostByteOrder() == ByteOrder::Little
+                                ? ByteOrder::Big
+                                : ByteOrder::Little;
+  ConvertByteOrder(foreign, doubles, doubles + 2, converted);
+  const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(doubles);
+  const std::uint8_t* converted_bytes =
+      reinterpret_cast<const std::uint8_t*>(converted);
+  for (int i = 0; i < 8; i++)
+    EXPECT_EQ(bytes[i], converted_bytes[7 - i]);
+  ConvertByteOrder(foreign, converted, converted + 2, converted);
+  EXPECT_TRUE(std::equal(doubles, doubles + 2, converted));
+}
+
+TEST(EndianTests, EndianWriterAndReader) {
+  std::vector<std::uint32_t> values(300);
+  for (std::size_t i = 0; i < values.size(); i++)
+    values[i] = static_cast<std::uint32_t>(i * 0x01020304u);
+
+  // The default byte order produces the standard little-endian encoding.
+  Serializer<VectorWriter> plain_serializer;
+  ASSERT_TRUE(plain_serializer.Write(values));
+
+  VectorWriter little_writer;
+  Serializer<EndianWriter<VectorWriter>> little_serializer{&little_writer};
+  ASSERT_TRUE(little_serializer.Write(values));
+  EXPECT_EQ(plain_serializer.writer().data(), little_writer.data());
+
+  // Other byte orders convert the elements in blocks and read back with a
+  // reader of the same order.
+  VectorWriter big_writer;
+  Serializer<EndianWriter<VectorWriter, ByteOrder::Big>> big_serializer{
+      &big_writer};
+  ASSERT_TRUE(big_serializer.Write(values));
+  ASSERT_EQ(little_writer.size(), big_writer.size());
+
+  const std::size_t header_size = little_writer.size() - values.size() * 4;
+  const std::uint8_t* little_bytes = little_writer.data().data() + header_size;
+  const std::uint8_t* big_bytes = big_writer.data().data() + header_size;
+  for (std::size_t i = 0; i < values.size() * 4; i += 4) {
+    for (std::size_t j = 0; j < 4; j++)
+      ASSERT_EQ(little_bytes[i + j], big_bytes[i + 3 - j]) << "byte " << i;
+  }
+
+  BufferReader little_reader{little_writer.data().data(), little_writer.size()};
+  Deserializer<EndianReader<BufferReader>> little_deserializer{&little_reader};
+  std::vector<std::uint32_t> decoded;
+  ASSERT_TRUE(little_deserializer.Read(&decoded));
+  EXPECT_EQ(values, decoded);
+
+  BufferReader big_reader{big_writer.data().data(), big_writer.size()};
+  Deserializer<EndianReader<BufferReader, ByteOrder::Big>> big_deserializer{
+      &big_reader};
+  decoded.clear();
+  ASSERT_TRUE(big_deserializer.Read(&decoded));
+  EXPECT_EQ(values, decoded);
+}
@@ -0,0 +1,151 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/fan_out.h>
+#include <nop/utility/gather_writer.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BufferReader;
+using nop::Decode;
+using nop::Deserializer;
+using nop::EncodeShared;
+using nop::EncodedBuffer;
+using nop::ErrorStatus;
+using nop::FanOutEncoder;
+using nop::GatherWriter;
+using nop::Serializer;
+using nop::Status;
+using nop::VectorWriter;
+
+namespace {
+
+struct Update {
+  std::uint64_t sequence;
+  std::string symbol;
+  std::vector<std::uint32_t> levels;
+
+  bool operator==(const Update& other) const {
+    return sequence == other.sequence && symbol == other.symbol &&
+           levels == other.levels;
+  }
+
+  NOP_STRUCTURE(Update, sequence, symbol, levels);
+};
+
+Update MakeUpdate() { return {42, "NOP", std::vector<std::uint32_t>(256, 7)}; }
+
+}  // anonymous namespace
+
+TEST(FanOut, EncodeShared) {
+  auto encoded = EncodeShared(MakeUpdate());
+  ASSERT_TRUE(encoded);
+  const EncodedBuffer& buffer = encoded.get();
+
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(MakeUpdate()));
+  EXPECT_EQ(serializer.writer().data(),
+            std::vector<std::uint8_t>(buffer.begin(), buffer.end()));
+
+  // Copies share the bytes.
+  std::vector<EncodedBuffer> queues(8, buffer);
+  EXPECT_EQ(9, buffer.use_count());
+  EXPECT_EQ(buffer.data(), queues.back().data());
+  EXPECT_EQ(buffer.data(), buffer.iovec().iov_base);
+  EXPECT_EQ(buffer.size(), buffer.iovec().iov_len);
+
+  // Gathering writers reference the shared bytes instead of copying them.
+  for (const EncodedBuffer& queued : queues) {
+    GatherWriter<> writer;
+    ASSERT_TRUE(queued.WriteTo(&writer));
+    EXPECT_EQ(0u, writer.staged());
+    ASSERT_EQ(1u, writer.Gather().size());
+    EXPECT_EQ(buffer.data(), writer.Gather()[0].iov_base);
+  }
+
+  // Other writers receive a copy.
+  VectorWriter writer;
+  ASSERT_TRUE(buffer.WriteTo(&writer));
+  Update update;
+  ASSERT_TRUE(Decode(writer.data(), &update));
+  EXPECT_EQ(MakeUpdate(), update);
+
+  EncodedBuffer empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_TRUE(empty.WriteTo(&writer));
+}
+
+TEST(FanOut, StateClasses) {
+  // Connections in the same state class share an encoding; here the class
+  // decides whether a header is written before the update.
+  FanOutEncoder<int> encoder;
+  int encode_count = 0;
+  auto encode = [&encode_count](int state_class, VectorWriter* writer) {
+    encode_count++;
+    Serializer<VectorWriter*> serializer{writer};
+    auto status = serializer.Write(state_class);
+    if (!status)
+      return status;
+    return serializer.Write(MakeUpdate());
+  };
+
+  const std::vector<int> connections = {0, 1, 1, 0, 2, 1, 0};
+  std::vector<EncodedBuffer> sent;
+  for (int state_class : connections) {
+    auto buffer = encoder.Get(state_class, encode);
+    ASSERT_TRUE(buffer);
+    sent.push_back(buffer.get());
+  }
+  EXPECT_EQ(3, encode_count);
+  EXPECT_EQ(3u, encoder.size());
+  EXPECT_EQ(sent[1].data(), sent[2].data());
+  EXPECT_NE(sent[0].data(), sent[1].data());
+
+  for (std::size_t i = 0; i < sent.size(); i++) {
+    BufferReader reader{sent[i].data(), sent[i].size()};
+    Deserializer<BufferReader*> deserializer{&reader};
+    int state_class = -1;
+    Update update;
+    ASSERT_TRUE(deserializer.Read(&state_class));
+    ASSERT_TRUE(deserializer.Read(&update));
+    EXPECT_EQ(connections[i], state_class);
+    EXPECT_EQ(MakeUpdate(), update);
+  }
+
+  // The next message encodes again, while sent buffers stay valid.
+  encoder.Clear();
+  EXPECT_EQ(0u, encoder.size());
+  ASSERT_TRUE(encoder.Get(0, encode));
+  EXPECT_EQ(4, encode_count);
+  EXPECT_EQ(3, sent[1].use_count());
+
+  // Failed encodings are returned and not kept.
+  auto failed = encoder.Get(5, [](int, VectorWriter*) -> Status<void> {
+    return ErrorStatus::WriteLimitReached;
+  });
+  ASSERT_FALSE(failed);
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, failed.error());
+  EXPECT_EQ(1u, encoder.size());
+}
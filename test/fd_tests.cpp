@@ -0,0 +1,849 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/base/shared_blob.h>
+#include <nop/structure.h>
+#include <nop/types/file_handle.h>
+#include <nop/types/shared_blob.h>
+#include <nop/utility/async_fd_writer.h>
+#include <nop/utility/buffered_fd_reader.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffered_fd_writer.h>
+#include <nop/utility/chunked_array_writer.h>
+#include <nop/utility/compressing_writer.h>
+#include <nop/utility/direct_fd_reader.h>
+#include <nop/utility/direct_fd_writer.h>
+#include <nop/utility/frame_reader.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/io_uring.h>
+#include <nop/utility/io_uring_reader.h>
+#include <nop/utility/io_uring_writer.h>
+#include <nop/utility/mapped_file_reader.h>
+#include <nop/utility/unix_socket_reader.h>
+#include <nop/utility/unix_socket_writer.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_writer.h"
+
+using nop::AsyncFdWriter;
+using nop::AsyncFdWriterOptions;
+using nop::BufferReader;
+using nop::BufferedFdReader;
+using nop::BufferedFdWriter;
+using nop::ChunkedArrayWriter;
+using nop::CompressingWriter;
+using nop::Deserializer;
+using nop::DirectFdReader;
+using nop::DirectFdWriter;
+using nop::DirectIoOptions;
+using nop::ErrorStatus;
+using nop::FileHandle;
+using nop::FrameReader;
+using nop::FrameWriter;
+using nop::FullBufferPolicy;
+using nop::IoUring;
+using nop::IoUringReader;
+using nop::IoUringWriter;
+using nop::MappedFileReader;
+using nop::OpenDirect;
+using nop::Serializer;
+using nop::SharedBlob;
+using nop::Status;
+using nop::TestWriter;
+using nop::UniqueFileHandle;
+using nop::UnixSocketReader;
+using nop::UnixSocketWriter;
+using nop::VectorWriter;
+
+namespace {
+
+struct Message {
+  int a;
+  std::string b;
+  std::vector<std::uint8_t> c;
+
+  bool operator==(const Message& other) const {
+    return a == other.a && b == other.b && c == other.c;
+  }
+
+  NOP_STRUCTURE(Message, a, b, c);
+};
+
+// Writes the given bytes to the fd, returning false on any error.
+bool WriteAll(int fd, const std::vector<std::uint8_t>& data) {
+  std::size_t offset = 0;
+  while (offset < data.size()) {
+    const ssize_t ret = ::write(fd, &data[offset], data.size() - offset);
+    if (ret <= 0)
+      return false;
+    offset += ret;
+  }
+  return true;
+}
+
+// Returns the size of the file at |path|, or -1 on error.
+off_t FileSize(const char* path) {
+  struct stat stat_buf;
+  return ::stat(path, &stat_buf) < 0 ? -1 : stat_buf.st_size;
+}
+
+// Writes |count| numbered messages to the file at |path| with a direct writer
+// and reads them back with a direct reader, checking the file size after
+// syncing and closing.
+void WriteReadDirect(const char* path, const DirectIoOptions& options,
+                     int count) {
+  auto fd = OpenDirect(path, O_WRONLY | O_CREAT | O_TRUNC);
+  ASSERT_TRUE(fd);
+  {
+    Serializer<DirectFdWriter> serializer{fd.get(), options};
+    for (int i = 0; i < count; i++) {
+      const Message message{i, std::string(i % 50, 'x'),
+                            std::vector<std::uint8_t>(i % 300, 0x55)};
+      ASSERT_TRUE(serializer.Write(message));
+      if (i == count / 2) {
+        // The padded tail is truncated away, and writing continues after it.
+        ASSERT_TRUE(serializer.writer().Sync());
+        EXPECT_EQ(static_cast<off_t>(serializer.writer().size()),
+                  FileSize(path));
+      }
+    }
+    ASSERT_TRUE(serializer.writer().Close());
+    EXPECT_EQ(static_cast<off_t>(serializer.writer().size()), FileSize(path));
+    EXPECT_NE(0u, serializer.writer().size() % options.block_size);
+  }
+
+  fd = OpenDirect(path, O_RDONLY);
+  ASSERT_TRUE(fd);
+  Deserializer<DirectFdReader> deserializer{fd.get(), options};
+  Message message;
+  for (int i = 0; i < count; i++) {
+    ASSERT_TRUE(deserializer.Read(&message));
+    EXPECT_EQ(i, message.a);
+    EXPECT_EQ(static_cast<std::size_t>(i % 50), message.b.size());
+    EXPECT_EQ(static_cast<std::size_t>(i % 300), message.c.size());
+  }
+  EXPECT_TRUE(deserializer.reader().empty());
+
+  Status<void> status = deserializer.Read(&message);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
+
+struct HandleMessage {
+  std::string name;
+  std::vector<FileHandle> handles;
+
+  NOP_STRUCTURE(HandleMessage, name, handles);
+};
+
+struct BlobMessage {
+  std::string name;
+  SharedBlob blob;
+
+  NOP_STRUCTURE(BlobMessage, name, blob);
+};
+
+}  // anonymous namespace
+
+TEST(BufferedFdReader, Read) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+
+  const Message message_a{10, "foo", std::vector<std::uint8_t>(4, 0xaa)};
+  const Message message_b{-20, std::string(100, 'x'),
+                          std::vector<std::uint8_t>(1000, 0x55)};
+
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(message_a));
+  ASSERT_TRUE(serializer.Write(message_b));
+  ASSERT_TRUE(WriteAll(pipe_fds[1], serializer.writer().data()));
+  ::close(pipe_fds[1]);
+
+  // Use a window smaller than the second message to exercise both the
+  // buffered and the direct read paths.
+  Deserializer<BufferedFdReader<64>> deserializer{pipe_fds[0]};
+
+  Message message;
+  ASSERT_TRUE(deserializer.Read(&message));
+  EXPECT_EQ(message_a, message);
+
+  ASSERT_TRUE(deserializer.Read(&message));
+  EXPECT_EQ(message_b, message);
+
+  EXPECT_EQ(0u, deserializer.reader().available());
+
+  Status<void> status = deserializer.Read(&message);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
+
+TEST(FrameReader, ReadFrom) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+
+  const Message message_a{10, "foo", std::vector<std::uint8_t>(4, 0xaa)};
+  const Message message_b{-20, std::string(100, 'x'),
+                          std::vector<std::uint8_t>(1000, 0x55)};
+
+  TestWriter writer;
+  FrameWriter<TestWriter> frame_writer{&writer};
+  ASSERT_TRUE(frame_writer.Write(message_a));
+  ASSERT_TRUE(frame_writer.Write(message_b));
+  ASSERT_TRUE(frame_writer.Write(message_a));
+  ASSERT_TRUE(WriteAll(pipe_fds[1], writer.data()));
+  ::close(pipe_fds[1]);
+
+  // Start with a buffer smaller than the second frame so that it must grow.
+  FrameReader frame_reader{64};
+  std::vector<Message> messages;
+  Status<std::size_t> read;
+  while ((read = frame_reader.ReadFrom(pipe_fds[0]))) {
+    BufferReader frame;
+    Status<bool> next;
+    while ((next = frame_reader.NextFrame(&frame)) && next.get()) {
+      Deserializer<BufferReader*> deserializer{&frame};
+      Message message;
+      ASSERT_TRUE(deserializer.Read(&message));
+      EXPECT_EQ(0u, frame.remaining());
+      messages.push_back(message);
+    }
+    ASSERT_TRUE(next);
+  }
+  ::close(pipe_fds[0]);
+
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, read.error());
+  EXPECT_EQ(0u, frame_reader.available());
+  EXPECT_EQ((std::vector<Message>{message_a, message_b, message_a}), messages);
+}
+
+TEST(FrameReader, Append) {
+  TestWriter writer;
+  FrameWriter<TestWriter> frame_writer{&writer};
+  ASSERT_TRUE(frame_writer.Write(std::string("foo")));
+  ASSERT_TRUE(frame_writer.Write(std::string(200, 'x')));
+  // The first frame is the length 5 followed by STR, 3, "foo".
+  ASSERT_EQ(5u, writer.data()[0]);
+
+  // Feed the stream a byte at a time; frames appear once complete.
+  FrameReader frame_reader{16};
+  std::vector<std::string> strings;
+  for (std::uint8_t byte : writer.data()) {
+    frame_reader.Append(&byte, 1);
+
+    BufferReader frame;
+    auto next = frame_reader.NextFrame(&frame);
+    ASSERT_TRUE(next);
+    if (next.get()) {
+      Deserializer<BufferReader*> deserializer{&frame};
+      std::string string;
+      ASSERT_TRUE(deserializer.Read(&string));
+      strings.push_back(string);
+    }
+  }
+  EXPECT_EQ((std::vector<std::string>{"foo", std::string(200, 'x')}), strings);
+
+  // Frames larger than the limit and invalid headers are rejected.
+  FrameReader limited_reader{16, 100};
+  limited_reader.Append(writer.data().data() + 6, writer.data().size() - 6);
+  BufferReader frame;
+  auto next = limited_reader.NextFrame(&frame);
+  ASSERT_FALSE(next);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, next.error());
+
+  const std::uint8_t invalid[] = {0xbd, 0x00};
+  FrameReader invalid_reader;
+  invalid_reader.Append(invalid, sizeof(invalid));
+  next = invalid_reader.NextFrame(&frame);
+  ASSERT_FALSE(next);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, next.error());
+}
+
+TEST(BufferedFdReader, Skip) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+
+  std::vector<std::uint8_t> data(300);
+  for (std::size_t i = 0; i < data.size(); i++)
+    data[i] = static_cast<std::uint8_t>(i);
+  ASSERT_TRUE(WriteAll(pipe_fds[1], data));
+  ::close(pipe_fds[1]);
+
+  BufferedFdReader<16> reader{pipe_fds[0]};
+  std::uint8_t byte = 0;
+
+  ASSERT_TRUE(reader.Ensure(8));
+  EXPECT_LE(8u, reader.available());
+
+  ASSERT_TRUE(reader.Skip(5));
+  ASSERT_TRUE(reader.Read(&byte));
+  EXPECT_EQ(5u, byte);
+
+  ASSERT_TRUE(reader.Skip(250));
+  ASSERT_TRUE(reader.Read(&byte));
+  EXPECT_EQ(static_cast<std::uint8_t>(256), byte);
+
+  Status<void> status = reader.Skip(100);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
+
+TEST(BufferedFdWriter, Write) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+
+  // The second message carries a payload large enough to be gathered by
+  // reference instead of copied into the staging buffer.
+  const Message message_a{10, "foo", std::vector<std::uint8_t>(4, 0xaa)};
+  const Message message_b{-20, std::string(100, 'x'),
+                          std::vector<std::uint8_t>(1000, 0x55)};
+
+  {
+    Serializer<BufferedFdWriter<64>> serializer{pipe_fds[1]};
+    ASSERT_TRUE(serializer.Write(message_a));
+    EXPECT_EQ(0u, serializer.writer().pending());
+
+    ASSERT_TRUE(serializer.Write(message_b));
+    EXPECT_EQ(0u, serializer.writer().pending());
+  }
+
+  Deserializer<BufferedFdReader<>> deserializer{pipe_fds[0]};
+
+  Message message;
+  ASSERT_TRUE(deserializer.Read(&message));
+  EXPECT_EQ(message_a, message);
+
+  ASSERT_TRUE(deserializer.Read(&message));
+  EXPECT_EQ(message_b, message);
+
+  Status<void> status = deserializer.Read(&message);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
+
+TEST(BufferedFdWriter, Flush) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+
+  const std::vector<std::uint8_t> large(200, 0x11);
+  BufferedFdWriter<16> writer{pipe_fds[1]};
+
+  // Output is held until Flush() when the writer is used directly.
+  ASSERT_TRUE(writer.Write(0x01));
+  ASSERT_TRUE(writer.Write(&*large.begin(), &*large.end()));
+  ASSERT_TRUE(writer.Skip(3, 0x22));
+  EXPECT_EQ(204u, writer.pending());
+
+  ASSERT_TRUE(writer.Flush());
+  EXPECT_EQ(0u, writer.pending());
+  writer.Clear();
+
+  std::vector<std::uint8_t> expected{0x01};
+  expected.insert(expected.end(), large.begin(), large.end());
+  expected.insert(expected.end(), 3, 0x22);
+
+  std::vector<std::uint8_t> data(expected.size() + 1);
+  BufferedFdReader<> reader{pipe_fds[0]};
+  ASSERT_TRUE(reader.Read(&data[0], &data[expected.size()]));
+  data.resize(expected.size());
+  EXPECT_EQ(expected, data);
+  EXPECT_FALSE(reader.Read(&data[0]));
+}
+
+TEST(BufferedFdWriter, ChunkedArrayWriter) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+
+  // Each chunk is large enough to be gathered by reference, so the stream must
+  // flush the writer before reusing its buffer for the next chunk.
+  std::vector<int> value;
+  for (int i = 0; i < 1024; i++)
+    value.push_back(1000 + i);
+
+  VectorWriter expected;
+  {
+    ChunkedArrayWriter<int> stream{256};
+    ASSERT_TRUE(stream.BeginStream(&expected));
+    for (int element : value)
+      ASSERT_TRUE(stream.Append(element, &expected));
+    ASSERT_TRUE(stream.End(&expected));
+  }
+
+  {
+    BufferedFdWriter<> writer{pipe_fds[1]};
+    ChunkedArrayWriter<int> stream{256};
+    ASSERT_TRUE(stream.BeginStream(&writer));
+    for (int element : value)
+      ASSERT_TRUE(stream.Append(element, &writer));
+    ASSERT_TRUE(stream.End(&writer));
+    ASSERT_TRUE(writer.Flush());
+  }
+
+  std::vector<std::uint8_t> data(expected.size() + 1);
+  BufferedFdReader<> reader{pipe_fds[0]};
+  ASSERT_TRUE(reader.Read(&data[0], &data[expected.size()]));
+  data.resize(expected.size());
+  EXPECT_EQ(expected.data(), data);
+  EXPECT_FALSE(reader.Read(&data[0]));
+}
+
+TEST(BufferedFdWriter, CompressingWriter) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+
+  // Incompressible blocks are stored as they are and gathered by reference, so
+  // the compressing writer must flush the writer before reusing its block.
+  std::vector<std::uint8_t> noise;
+  std::uint32_t state = 7;
+  for (int i = 0; i < 8 * 1024; i++) {
+    state = state * 1103515245u + 12345u;
+    noise.push_back(static_cast<std::uint8_t>(state >> 24));
+  }
+
+  VectorWriter expected;
+  {
+    CompressingWriter<VectorWriter> writer{&expected, 1024};
+    Serializer<CompressingWriter<VectorWriter>*> serializer{&writer};
+    ASSERT_TRUE(serializer.Write(noise));
+  }
+
+  {
+    BufferedFdWriter<> fd_writer{pipe_fds[1]};
+    CompressingWriter<BufferedFdWriter<>> writer{&fd_writer, 1024};
+    Serializer<CompressingWriter<BufferedFdWriter<>>*> serializer{&writer};
+    ASSERT_TRUE(serializer.Write(noise));
+    EXPECT_EQ(0u, fd_writer.pending());
+  }
+
+  std::vector<std::uint8_t> data(expected.size() + 1);
+  BufferedFdReader<> reader{pipe_fds[0]};
+  ASSERT_TRUE(reader.Read(&data[0], &data[expected.size()]));
+  data.resize(expected.size());
+  EXPECT_EQ(expected.data(), data);
+  EXPECT_FALSE(reader.Read(&data[0]));
+}
+
+TEST(AsyncFdWriter, Write) {
+  std::FILE* file = std::tmpfile();
+  ASSERT_NE(nullptr, file);
+
+  // Small buffers make the writer hand off buffers and wait for free ones.
+  AsyncFdWriterOptions options;
+  options.buffer_count = 3;
+  options.buffer_size = 256;
+  const std::size_t kCount = 1000;
+  {
+    Serializer<AsyncFdWriter> serializer{::dup(fileno(file)), options};
+    for (std::size_t i = 0; i < kCount; i++) {
+      const Message message{static_cast<int>(i), std::string(i % 50, 'x'),
+                            std::vector<std::uint8_t>(i % 7, 0x55)};
+      ASSERT_TRUE(serializer.Write(message));
+    }
+
+    // A value larger than a buffer is collected in one grown buffer.
+    ASSERT_TRUE(serializer.Write(Message{-1, std::string(1000, 'y'), {}}));
+
+    ASSERT_TRUE(serializer.writer().Sync());
+    EXPECT_EQ(0u, serializer.writer().buffered());
+    EXPECT_EQ(0u, serializer.writer().dropped_count());
+    EXPECT_LT(0u, serializer.writer().written_bytes());
+  }
+
+  ::lseek(fileno(file), 0, SEEK_SET);
+  Deserializer<BufferedFdReader<>> deserializer{::dup(fileno(file))};
+  Message message;
+  for (std::size_t i = 0; i < kCount; i++) {
+    ASSERT_TRUE(deserializer.Read(&message));
+    EXPECT_EQ(static_cast<int>(i), message.a);
+    EXPECT_EQ(i % 50, message.b.size());
+  }
+  ASSERT_TRUE(deserializer.Read(&message));
+  EXPECT_EQ(-1, message.a);
+  EXPECT_EQ(std::string(1000, 'y'), message.b);
+
+  Status<void> status = deserializer.Read(&message);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+  std::fclose(file);
+}
+
+TEST(AsyncFdWriter, Drop) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+
+  // The pipe is not read until every value has been written, so the
+  // background thread stalls once the pipe is full and values are dropped.
+  AsyncFdWriterOptions options;
+  options.buffer_size = 1024;
+  options.policy = FullBufferPolicy::Drop;
+  std::vector<int> written;
+  std::vector<std::uint8_t> output;
+  std::thread reader;
+  {
+    Serializer<AsyncFdWriter> serializer{pipe_fds[1], options};
+    std::size_t dropped = 0;
+    for (int i = 0; i < 1000; i++) {
+      auto status = serializer.Write(Message{i, std::string(500, 'x'), {}});
+      if (status) {
+        written.push_back(i);
+      } else {
+        EXPECT_EQ(ErrorStatus::WriteLimitReached, status.error());
+        dropped++;
+      }
+    }
+    EXPECT_LT(0u, dropped);
+    EXPECT_EQ(dropped, serializer.writer().dropped_count());
+
+    reader = std::thread{[&output, fd = pipe_fds[0]] {
+      std::uint8_t buffer[4096];
+      ssize_t ret;
+      while ((ret = ::read(fd, buffer, sizeof(buffer))) > 0)
+        output.insert(output.end(), buffer, buffer + ret);
+    }};
+    EXPECT_TRUE(serializer.writer().Drain());
+  }
+
+  // Destroying the writer closed the pipe, ending the reader.
+  reader.join();
+  ::close(pipe_fds[0]);
+
+  // Only whole values are dropped.
+  Deserializer<BufferReader> deserializer{output.data(), output.size()};
+  Message message;
+  for (int index : written) {
+    ASSERT_TRUE(deserializer.Read(&message));
+    EXPECT_EQ(index, message.a);
+  }
+  EXPECT_TRUE(deserializer.reader().empty());
+}
+
+TEST(AsyncFdWriter, Errors) {
+  // Writes to a read-only fd fail in the background thread.
+  const int fd = ::open("/dev/null", O_RDONLY);
+  ASSERT_LE(0, fd);
+
+  Serializer<AsyncFdWriter> serializer{fd};
+  ASSERT_TRUE(serializer.Write(Message{1, "foo", {}}));
+
+  Status<void> status = serializer.writer().Sync();
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::IOError, status.error());
+
+  status = serializer.Write(Message{2, "bar", {}});
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::IOError, status.error());
+}
+
+TEST(MappedFileReader, Read) {
+  char path[] = "/tmp/nop_mapped_file_XXXXXX";
+  const int fd = ::mkstemp(path);
+  ASSERT_LE(0, fd);
+  ::unlink(path);
+
+  const Message message_a{10, "foo", std::vector<std::uint8_t>(4, 0xaa)};
+  const Message message_b{-20, std::string(100, 'x'),
+                          std::vector<std::uint8_t>(10000, 0x55)};
+
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(message_a));
+  ASSERT_TRUE(serializer.Write(message_b));
+  ASSERT_TRUE(WriteAll(fd, serializer.writer().data()));
+
+  // Use a prefetch size smaller than the file to advise in several steps.
+  Deserializer<MappedFileReader<4096>> deserializer{fd};
+  ::close(fd);
+  ASSERT_TRUE(deserializer.reader().is_mapped());
+  EXPECT_EQ(serializer.writer().data().size(),
+            deserializer.reader().capacity());
+
+  Message message;
+  ASSERT_TRUE(deserializer.Read(&message));
+  EXPECT_EQ(message_a, message);
+
+  ASSERT_TRUE(deserializer.Read(&message));
+  EXPECT_EQ(message_b, message);
+  EXPECT_TRUE(deserializer.reader().empty());
+
+  Status<void> status = deserializer.reader().Ensure(1);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
+
+TEST(MappedFileReader, Invalid) {
+  MappedFileReader<> reader{-1};
+  EXPECT_FALSE(reader.is_mapped());
+
+  Status<void> status = reader.Ensure(1);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::IOError, status.error());
+}
+
+TEST(DirectIo, WriteRead) {
+  char path[] = "/tmp/nop_direct_file_XXXXXX";
+  const int fd = ::mkstemp(path);
+  ASSERT_LE(0, fd);
+  ::close(fd);
+
+  // Small buffers make the writer and reader cycle through them many times.
+  DirectIoOptions options;
+  options.block_size = 4096;
+  options.buffer_size = 16384;
+  options.buffer_count = 3;
+  WriteReadDirect(path, options, 1000);
+
+  IoUring ring;
+  if (ring.Setup(8)) {
+    options.ring = &ring;
+    WriteReadDirect(path, options, 1000);
+  }
+  ::unlink(path);
+}
+
+TEST(DirectIo, Errors) {
+  DirectFdReader reader{-1};
+  Status<void> status = reader.Ensure(1);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::IOError, status.error());
+
+  char path[] = "/tmp/nop_direct_file_XXXXXX";
+  const int fd = ::mkstemp(path);
+  ASSERT_LE(0, fd);
+  ::close(fd);
+
+  // Writes to a read-only fd fail once the first buffer fills, and every
+  // later write returns the same error.
+  auto read_fd = OpenDirect(path, O_RDONLY);
+  ASSERT_TRUE(read_fd);
+  DirectIoOptions options;
+  options.buffer_size = 4096;
+  Serializer<DirectFdWriter> serializer{read_fd.get(), options};
+  status = serializer.Write(std::vector<std::uint8_t>(10000, 0xaa));
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::IOError, status.error());
+  status = serializer.Write(1);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::IOError, status.error());
+  status = serializer.writer().Close();
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::IOError, status.error());
+  ::unlink(path);
+}
+
+TEST(IoUring, Messages) {
+  IoUring ring;
+  if (!ring.Setup(8))
+    GTEST_SKIP() << "io_uring is not available.";
+
+  int socket_fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds));
+
+  const Message message_a{10, "foo", std::vector<std::uint8_t>(4, 0xaa)};
+  const Message message_b{-20, std::string(100, 'x'),
+                          std::vector<std::uint8_t>(100000, 0x55)};
+
+  Serializer<IoUringWriter> serializer{&ring, socket_fds[0]};
+  // Use a buffer smaller than the second message to force the reader to grow.
+  IoUringReader reader{&ring, socket_fds[1], 64};
+
+  ASSERT_TRUE(serializer.Write(message_a));
+  ASSERT_TRUE(serializer.Write(message_b));
+  ASSERT_TRUE(serializer.Write(message_a));
+
+  std::vector<Message> messages;
+  BufferReader message_reader;
+  while (messages.size() < 3) {
+    auto status = reader.NextMessage(&message_reader);
+    ASSERT_TRUE(status);
+    if (status.get()) {
+      Deserializer<BufferReader*> deserializer{&message_reader};
+      Message message;
+      ASSERT_TRUE(deserializer.Read(&message));
+      EXPECT_TRUE(message_reader.empty());
+      messages.push_back(std::move(message));
+    } else {
+      ASSERT_TRUE(ring.Submit(1));
+      ring.ProcessCompletions();
+      ASSERT_TRUE(serializer.writer().status());
+    }
+  }
+
+  EXPECT_EQ(message_a, messages[0]);
+  EXPECT_EQ(message_b, messages[1]);
+  EXPECT_EQ(message_a, messages[2]);
+
+  while (!serializer.writer().idle()) {
+    ASSERT_TRUE(ring.Submit(1));
+    ring.ProcessCompletions();
+  }
+
+  // Closing the peer ends the message stream.
+  ::close(socket_fds[0]);
+  while (true) {
+    auto status = reader.NextMessage(&message_reader);
+    if (!status) {
+      EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+      break;
+    }
+    ASSERT_FALSE(status.get());
+    ASSERT_TRUE(ring.Submit(1));
+    ring.ProcessCompletions();
+  }
+  ::close(socket_fds[1]);
+}
+
+TEST(UnixSocket, Handles) {
+  int socket_fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, socket_fds));
+
+  // Send the write ends of several pipes in one message.
+  const std::size_t kPipeCount = 4;
+  std::vector<UniqueFileHandle> read_ends;
+  HandleMessage message{"pipes", {}};
+  for (std::size_t i = 0; i < kPipeCount; i++) {
+    int pipe_fds[2];
+    ASSERT_EQ(0, pipe(pipe_fds));
+    read_ends.emplace_back(pipe_fds[0]);
+    message.handles.emplace_back(pipe_fds[1]);
+  }
+
+  Serializer<UnixSocketWriter> serializer{socket_fds[0]};
+  ASSERT_TRUE(serializer.Write(message));
+  EXPECT_EQ(0u, serializer.writer().pending());
+  ASSERT_TRUE(serializer.Write(HandleMessage{"empty", {}}));
+
+  // The sent fds may be closed once the message is flushed.
+  for (FileHandle& handle : message.handles)
+    ::close(handle.get());
+
+  Deserializer<UnixSocketReader> deserializer{socket_fds[1]};
+  HandleMessage result;
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ("pipes", result.name);
+  ASSERT_EQ(kPipeCount, result.handles.size());
+
+  for (std::size_t i = 0; i < kPipeCount; i++) {
+    const std::uint8_t byte = static_cast<std::uint8_t>(i);
+    ASSERT_TRUE(result.handles[i]);
+    UniqueFileHandle write_end{result.handles[i].get()};
+    ASSERT_EQ(1, ::write(write_end.get(), &byte, 1));
+
+    std::uint8_t received = 0xff;
+    ASSERT_EQ(1, ::read(read_ends[i].get(), &received, 1));
+    EXPECT_EQ(byte, received);
+  }
+
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ("empty", result.name);
+  EXPECT_TRUE(result.handles.empty());
+
+  ::close(serializer.writer().Release());
+  Status<void> status = deserializer.Read(&result);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
+
+TEST(UnixSocket, SharedBlob) {
+  int socket_fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, socket_fds));
+
+  // The payload is far larger than the largest message the reader accepts.
+  const std::size_t kSize = 4 * 1024 * 1024 + 123;
+  auto blob = SharedBlob::Create(kSize);
+  ASSERT_TRUE(blob);
+  ASSERT_NE(nullptr, blob.get().mutable_data());
+  for (std::size_t i = 0; i < kSize; i++)
+    blob.get().mutable_data()[i] = static_cast<std::uint8_t>(i * 7);
+
+  BlobMessage message{"frame", blob.take()};
+
+  // Unsealed blobs are rejected.
+  Serializer<TestWriter> test_serializer;
+  Status<void> status = test_serializer.Write(message);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidHandleValue, status.error());
+
+  ASSERT_TRUE(message.blob.Seal());
+  EXPECT_EQ(nullptr, message.blob.mutable_data());
+  Serializer<UnixSocketWriter> serializer{socket_fds[0]};
+  ASSERT_TRUE(serializer.Write(message));
+  ASSERT_TRUE(serializer.Write(BlobMessage{"empty", {}}));
+
+  Deserializer<UnixSocketReader> deserializer{socket_fds[1], 1024u};
+  BlobMessage result;
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ("frame", result.name);
+  ASSERT_EQ(kSize, result.blob.size());
+  EXPECT_TRUE(result.blob.is_sealed());
+  EXPECT_EQ(0, std::memcmp(message.blob.data(), result.blob.data(), kSize));
+
+  // Neither side can modify the payload.
+  const std::uint8_t byte = 0;
+  EXPECT_GT(0, ::pwrite(result.blob.handle().get(), &byte, 1, 0));
+  EXPECT_GT(0, ::ftruncate(message.blob.handle().get(), 0));
+
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ("empty", result.name);
+  EXPECT_TRUE(result.blob.empty());
+  EXPECT_FALSE(result.blob.handle());
+}
+
+TEST(SharedBlob, Map) {
+  const std::string payload(10000, 'x');
+  auto blob = SharedBlob::Copy(payload.data(), payload.size());
+  ASSERT_TRUE(blob);
+  ASSERT_TRUE(blob.get().is_sealed());
+
+  // Ranges at any offset are mapped from the enclosing pages.
+  auto range = SharedBlob::Map(
+      UniqueFileHandle::AsDuplicate(blob.get().handle()), 5000, 100);
+  ASSERT_TRUE(range);
+  EXPECT_EQ(5000u, range.get().offset());
+  EXPECT_EQ(std::string(100, 'x'),
+            std::string(range.get().data(),
+                        range.get().data() + range.get().size()));
+
+  range = SharedBlob::Map(UniqueFileHandle::AsDuplicate(blob.get().handle()),
+                          5000, 6000);
+  ASSERT_FALSE(range);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, range.error());
+
+  // Memfds that may still change are rejected.
+  auto unsealed = SharedBlob::Create(100);
+  ASSERT_TRUE(unsealed);
+  range = SharedBlob::Map(
+      UniqueFileHandle::AsDuplicate(unsealed.get().handle()), 0, 100);
+  ASSERT_FALSE(range);
+  EXPECT_EQ(ErrorStatus::InvalidHandleValue, range.error());
+
+  char path[] = "/tmp/nop_shared_blob_XXXXXX";
+  UniqueFileHandle file{::mkstemp(path)};
+  ASSERT_TRUE(file);
+  ::unlink(path);
+  range = SharedBlob::Map(std::move(file), 0, 0);
+  ASSERT_FALSE(range);
+  EXPECT_EQ(ErrorStatus::InvalidHandleValue, range.error());
+}
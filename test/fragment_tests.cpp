@@ -0,0 +1,269 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <nop/rpc/simple_method_receiver.h>
+#include <nop/rpc/simple_method_sender.h>
+#include <nop/serializer.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/fragment.h>
+#include <nop/utility/fragment_reader.h>
+#include <nop/utility/fragment_writer.h>
+#include <nop/utility/frame_reader.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::FragmentDemultiplexer;
+using nop::FragmentHeader;
+using nop::FragmentMultiplexer;
+using nop::FragmentStreamReader;
+using nop::FragmentStreamWriter;
+using nop::FrameReader;
+using nop::Serializer;
+using nop::SimpleMethodReceiver;
+using nop::SimpleMethodSender;
+using nop::Status;
+using nop::StreamId;
+using nop::VectorWriter;
+
+namespace {
+
+enum : StreamId {
+  kBulkStream = 1,
+  kControlStream = 2,
+  kOtherStream = 3,
+};
+
+std::vector<std::uint8_t> MakeMessage(std::size_t size, std::uint8_t seed) {
+  std::vector<std::uint8_t> message(size);
+  for (std::size_t i = 0; i < size; i++)
+    message[i] = static_cast<std::uint8_t>(seed + i);
+  return message;
+}
+
+// Writes the next fragment and returns its header.
+FragmentHeader NextFragment(FragmentMultiplexer* multiplexer) {
+  VectorWriter writer;
+  EXPECT_TRUE(multiplexer->WriteFragment(&writer).get());
+
+  FrameReader frames;
+  frames.Append(writer.data().data(), writer.size());
+  BufferReader frame;
+  EXPECT_TRUE(frames.NextFrame(&frame).get());
+
+  FragmentHeader header{0, 0};
+  EXPECT_TRUE(header.Read(&frame));
+  return header;
+}
+
+// Moves every queued fragment from |multiplexer| to |demultiplexer| through a
+// byte stream, returning the streams in the order their messages completed.
+std::vector<StreamId> Transfer(FragmentMultiplexer* multiplexer,
+                               FragmentDemultiplexer* demultiplexer) {
+  VectorWriter channel;
+  Status<bool> sent;
+  while ((sent = multiplexer->WriteFragment(&channel)) && sent.get()) {
+  }
+  EXPECT_TRUE(sent);
+
+  FrameReader frames{64};
+  frames.Append(channel.data().data(), channel.size());
+
+  std::vector<StreamId> completed;
+  BufferReader frame;
+  Status<bool> next;
+  while ((next = frames.NextFrame(&frame)) && next.get()) {
+    StreamId stream;
+    auto complete = demultiplexer->AddFragment(&frame, &stream);
+    EXPECT_TRUE(complete);
+    if (complete && complete.get())
+      completed.push_back(stream);
+  }
+  EXPECT_TRUE(next);
+  EXPECT_EQ(0u, frames.available());
+  return completed;
+}
+
+}  // anonymous namespace
+
+TEST(Fragment, Reassemble) {
+  FragmentMultiplexer multiplexer{100};
+  FragmentDemultiplexer demultiplexer;
+
+  multiplexer.Enqueue(kBulkStream, MakeMessage(1000, 1));
+  multiplexer.Enqueue(kBulkStream, MakeMessage(250, 2));
+  multiplexer.Enqueue(kControlStream, MakeMessage(0, 3));
+  multiplexer.Enqueue(kOtherStream, MakeMessage(100, 4));
+  EXPECT_EQ(1350u, multiplexer.queued_bytes());
+
+  std::vector<StreamId> expected_order = {kControlStream, kOtherStream,
+                                          kBulkStream, kBulkStream};
+  EXPECT_EQ(expected_order, Transfer(&multiplexer, &demultiplexer));
+  EXPECT_TRUE(multiplexer.empty());
+  EXPECT_EQ(0u, multiplexer.queued_bytes());
+
+  std::vector<std::uint8_t> message;
+  ASSERT_TRUE(demultiplexer.TakeMessage(kBulkStream, &message));
+  EXPECT_EQ(MakeMessage(1000, 1), message);
+  ASSERT_TRUE(demultiplexer.TakeMessage(kBulkStream, &message));
+  EXPECT_EQ(MakeMessage(250, 2), message);
+  EXPECT_FALSE(demultiplexer.TakeMessage(kBulkStream, &message));
+
+  ASSERT_TRUE(demultiplexer.TakeMessage(kControlStream, &message));
+  EXPECT_TRUE(message.empty());
+  ASSERT_TRUE(demultiplexer.TakeMessage(kOtherStream, &message));
+  EXPECT_EQ(MakeMessage(100, 4), message);
+  EXPECT_FALSE(demultiplexer.HasMessage(kOtherStream));
+}
+
+TEST(Fragment, Scheduling) {
+  FragmentMultiplexer multiplexer{1024};
+  multiplexer.Enqueue(kBulkStream, MakeMessage(64 * 1024, 0));
+
+  // A message on a stream of higher priority is sent before the rest of a
+  // large message that is already being sent.
+  EXPECT_EQ(kBulkStream, NextFragment(&multiplexer).stream);
+  multiplexer.SetPriority(kControlStream, 1);
+  multiplexer.Enqueue(kControlStream, MakeMessage(10, 0));
+  FragmentHeader header = NextFragment(&multiplexer);
+  EXPECT_EQ(kControlStream, header.stream);
+  EXPECT_TRUE(header.last());
+
+  // Streams of the same priority take turns.
+  multiplexer.Enqueue(kOtherStream, MakeMessage(3000, 0));
+  EXPECT_EQ(kBulkStream, NextFragment(&multiplexer).stream);
+  EXPECT_EQ(kOtherStream, NextFragment(&multiplexer).stream);
+  EXPECT_EQ(kBulkStream, NextFragment(&multiplexer).stream);
+  EXPECT_EQ(kOtherStream, NextFragment(&multiplexer).stream);
+
+  // Changing the priority of a busy stream reschedules it.
+  multiplexer.SetPriority(kOtherStream, 2);
+  EXPECT_EQ(2, multiplexer.GetPriority(kOtherStream));
+  header = NextFragment(&multiplexer);
+  EXPECT_EQ(kOtherStream, header.stream);
+  EXPECT_TRUE(header.last());
+  EXPECT_EQ(kBulkStream, NextFragment(&multiplexer).stream);
+
+  // Removing a stream drops its queued messages.
+  multiplexer.RemoveStream(kBulkStream);
+  EXPECT_TRUE(multiplexer.empty());
+  EXPECT_EQ(0u, multiplexer.queued_bytes());
+  VectorWriter writer;
+  auto sent = multiplexer.WriteFragment(&writer);
+  ASSERT_TRUE(sent);
+  EXPECT_FALSE(sent.get());
+  EXPECT_TRUE(writer.empty());
+}
+
+TEST(Fragment, Methods) {
+  FragmentMultiplexer multiplexer{256};
+  FragmentDemultiplexer demultiplexer;
+
+  using Sender = SimpleMethodSender<Serializer<FragmentStreamWriter>,
+                                    Deserializer<FragmentStreamReader>>;
+  using Receiver = SimpleMethodReceiver<Serializer<FragmentStreamWriter>,
+                                        Deserializer<FragmentStreamReader>>;
+
+  // Each call is made on its own stream, with the control stream taking
+  // priority over the bulk stream.
+  Serializer<FragmentStreamWriter> bulk_serializer{&multiplexer, kBulkStream};
+  Deserializer<FragmentStreamReader> bulk_deserializer{&demultiplexer,
+                                                       kBulkStream};
+  Serializer<FragmentStreamWriter> control_serializer{&multiplexer,
+                                                      kControlStream};
+  Deserializer<FragmentStreamReader> control_deserializer{&demultiplexer,
+                                                          kControlStream};
+  multiplexer.SetPriority(kControlStream, 1);
+
+  const std::string bulk(100000, 'b');
+  Status<void> status;
+  Sender bulk_sender{&bulk_serializer, &bulk_deserializer};
+  bulk_sender.SendMethod(1, &status, std::make_tuple(bulk));
+  ASSERT_TRUE(status);
+  Sender control_sender{&control_serializer, &control_deserializer};
+  control_sender.SendMethod(2, &status, std::make_tuple(10, 20));
+  ASSERT_TRUE(status);
+
+  // Both messages of the control call complete first.
+  std::vector<StreamId> completed = Transfer(&multiplexer, &demultiplexer);
+  ASSERT_EQ(4u, completed.size());
+  EXPECT_EQ(kControlStream, completed[0]);
+  EXPECT_EQ(kControlStream, completed[1]);
+
+  Receiver control_receiver{&control_serializer, &control_deserializer};
+  int selector = 0;
+  std::tuple<int, int> control_args;
+  ASSERT_TRUE(control_receiver.GetMethodSelector(&selector));
+  EXPECT_EQ(2, selector);
+  ASSERT_TRUE(control_receiver.GetArgs(&control_args));
+  EXPECT_EQ(std::make_tuple(10, 20), control_args);
+
+  Receiver bulk_receiver{&bulk_serializer, &bulk_deserializer};
+  std::tuple<std::string> bulk_args;
+  ASSERT_TRUE(bulk_receiver.GetMethodSelector(&selector));
+  EXPECT_EQ(1, selector);
+  ASSERT_TRUE(bulk_receiver.GetArgs(&bulk_args));
+  EXPECT_EQ(bulk, std::get<0>(bulk_args));
+
+  // Nothing more has arrived on either stream.
+  status = control_receiver.GetMethodSelector(&selector);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
+
+TEST(Fragment, Errors) {
+  FragmentMultiplexer multiplexer{100};
+  multiplexer.Enqueue(kBulkStream, MakeMessage(1000, 0));
+  multiplexer.Enqueue(kControlStream, MakeMessage(10, 0));
+
+  // Messages larger than the maximum message size are rejected without
+  // affecting the other streams.
+  FragmentDemultiplexer demultiplexer{500};
+  VectorWriter channel;
+  Status<bool> sent;
+  while ((sent = multiplexer.WriteFragment(&channel)) && sent.get()) {
+  }
+
+  FrameReader frames;
+  frames.Append(channel.data().data(), channel.size());
+  BufferReader frame;
+  std::size_t errors = 0;
+  while (frames.NextFrame(&frame).get()) {
+    StreamId stream;
+    auto complete = demultiplexer.AddFragment(&frame, &stream);
+    if (!complete) {
+      EXPECT_EQ(ErrorStatus::InvalidContainerLength, complete.error());
+      errors++;
+    }
+  }
+  EXPECT_LT(0u, errors);
+  EXPECT_TRUE(demultiplexer.HasMessage(kControlStream));
+
+  // Fragments with an invalid header are rejected.
+  const std::vector<std::uint8_t> invalid = {0xbd, 0x00};
+  BufferReader invalid_frame{invalid.data(), invalid.size()};
+  StreamId stream;
+  auto complete = demultiplexer.AddFragment(&invalid_frame, &stream);
+  ASSERT_FALSE(complete);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, complete.error());
+}
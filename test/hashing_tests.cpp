@@ -0,0 +1,113 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/canonical_writer.h>
+#include <nop/utility/hashing_writer.h>
+#include <nop/utility/sip_hash.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::CanonicalWriter;
+using nop::HashingWriter;
+using nop::Serializer;
+using nop::SipHasher;
+using nop::VectorWriter;
+
+namespace {
+
+struct Request {
+  std::string path;
+  std::unordered_map<std::string, std::string> headers;
+  std::vector<std::uint8_t> body;
+
+  NOP_STRUCTURE(Request, path, headers, body);
+};
+
+Request MakeRequest(std::size_t buckets) {
+  Request request{"/index.html",
+                  std::unordered_map<std::string, std::string>(buckets),
+                  std::vector<std::uint8_t>(1000, 0xaa)};
+  for (int i = 0; i < 30; i++)
+    request.headers["header" + std::to_string(i)] = std::to_string(i * i);
+  return request;
+}
+
+}  // anonymous namespace
+
+TEST(HashingWriter, PassThrough) {
+  const Request request = MakeRequest(0);
+
+  VectorWriter vector_writer;
+  HashingWriter<VectorWriter> writer{&vector_writer};
+  Serializer<HashingWriter<VectorWriter>*> serializer{&writer};
+  ASSERT_TRUE(serializer.Write(request));
+
+  const std::vector<std::uint8_t>& bytes = vector_writer.data();
+  EXPECT_EQ(SipHasher<64>::Compute(bytes.data(), bytes.size()), writer.hash());
+
+  // Padding written with Skip() is hashed too.
+  ASSERT_TRUE(writer.Skip(100, 0x5a));
+  EXPECT_EQ(SipHasher<64>::Compute(bytes.data(), bytes.size()), writer.hash());
+
+  writer.Reset();
+  EXPECT_EQ(SipHasher<64>::Compute(nullptr, 0), writer.hash());
+}
+
+TEST(HashingWriter, NullSink) {
+  const Request request = MakeRequest(0);
+
+  Serializer<VectorWriter> vector_serializer;
+  ASSERT_TRUE(vector_serializer.Write(request));
+  const std::vector<std::uint8_t>& bytes = vector_serializer.writer().data();
+
+  Serializer<HashingWriter<>> serializer;
+  ASSERT_TRUE(serializer.Write(request));
+  EXPECT_EQ(SipHasher<64>::Compute(bytes.data(), bytes.size()),
+            serializer.writer().hash());
+
+  // A keyed, 128-bit hasher may be supplied instead.
+  using WideWriter = HashingWriter<void, SipHasher<128>>;
+  Serializer<WideWriter> wide_serializer{SipHasher<128>{1, 2}};
+  ASSERT_TRUE(wide_serializer.Write(request));
+  EXPECT_EQ(SipHasher<128>::Compute(bytes.data(), bytes.size(), 1, 2),
+            wide_serializer.writer().hash());
+}
+
+TEST(HashingWriter, Canonical) {
+  const Request a = MakeRequest(0);
+  const Request b = MakeRequest(1024);
+
+  Serializer<CanonicalWriter<HashingWriter<>>> serializer_a;
+  Serializer<CanonicalWriter<HashingWriter<>>> serializer_b;
+  ASSERT_TRUE(serializer_a.Write(a));
+  ASSERT_TRUE(serializer_b.Write(b));
+  EXPECT_EQ(serializer_a.writer().writer().hash(),
+            serializer_b.writer().writer().hash());
+
+  Request c = MakeRequest(0);
+  c.headers["header0"] = "1";
+  Serializer<CanonicalWriter<HashingWriter<>>> serializer_c;
+  ASSERT_TRUE(serializer_c.Write(c));
+  EXPECT_NE(serializer_a.writer().writer().hash(),
+            serializer_c.writer().writer().hash());
+}
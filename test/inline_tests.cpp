@@ -0,0 +1,190 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/types/indexed_array.h>
+#include <nop/types/inline_string.h>
+#include <nop/types/inline_vector.h>
+#include <nop/types/packed.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Decode;
+using nop::Encode;
+using nop::ErrorStatus;
+using nop::IndexedArray;
+using nop::InlineString;
+using nop::InlineVector;
+using nop::Packed;
+using nop::Status;
+
+namespace {
+
+struct LineItem {
+  std::string sku;
+  std::uint32_t quantity;
+
+  bool operator==(const LineItem& other) const {
+    return sku == other.sku && quantity == other.quantity;
+  }
+
+  NOP_STRUCTURE(LineItem, sku, quantity);
+};
+
+struct Order {
+  InlineString<15> customer;
+  InlineVector<LineItem, 4> items;
+  InlineVector<std::int16_t, 8> codes;
+
+  NOP_STRUCTURE(Order, customer, items, codes);
+};
+
+struct HeapOrder {
+  std::string customer;
+  std::vector<LineItem> items;
+  std::vector<std::int16_t> codes;
+
+  NOP_STRUCTURE(HeapOrder, customer, items, codes);
+};
+
+}  // anonymous namespace
+
+TEST(InlineVector, Basic) {
+  InlineVector<std::string, 2> value;
+  EXPECT_TRUE(value.empty());
+  EXPECT_TRUE(value.is_inline());
+  EXPECT_EQ(2u, value.capacity());
+
+  value.push_back("a");
+  value.emplace_back(3, 'b');
+  EXPECT_TRUE(value.is_inline());
+  EXPECT_EQ((InlineVector<std::string, 2>{"a", "bbb"}), value);
+
+  // Growing past the inline capacity moves the elements to the heap, even
+  // when the new element refers to one of them.
+  value.push_back(value[0]);
+  EXPECT_FALSE(value.is_inline());
+  EXPECT_LE(3u, value.capacity());
+  EXPECT_EQ((InlineVector<std::string, 2>{"a", "bbb", "a"}), value);
+
+  // Moving a spilled vector takes its storage.
+  const std::string* data = value.data();
+  InlineVector<std::string, 2> moved{std::move(value)};
+  EXPECT_EQ(data, moved.data());
+  EXPECT_TRUE(value.empty());
+  EXPECT_TRUE(value.is_inline());
+
+  moved.erase(moved.begin());
+  moved.shrink_to_fit();
+  EXPECT_TRUE(moved.is_inline());
+  EXPECT_EQ((InlineVector<std::string, 2>{"bbb", "a"}), moved);
+
+  InlineVector<std::string, 2> copy{moved};
+  EXPECT_EQ(moved, copy);
+  copy.resize(1);
+  EXPECT_NE(moved, copy);
+  copy = std::move(moved);
+  EXPECT_EQ((InlineVector<std::string, 2>{"bbb", "a"}), copy);
+}
+
+TEST(InlineString, Basic) {
+  InlineString<7> value;
+  EXPECT_TRUE(value.empty());
+  EXPECT_STREQ("", value.c_str());
+
+  value = "abcdefg";
+  EXPECT_TRUE(value.is_inline());
+  EXPECT_EQ(7u, value.size());
+  EXPECT_STREQ("abcdefg", value.c_str());
+
+  value.push_back('h');
+  EXPECT_FALSE(value.is_inline());
+  EXPECT_EQ("abcdefgh", value.str());
+
+  value.resize(2);
+  value.append("xyz", 3);
+  EXPECT_TRUE(value == "abxyz");
+  EXPECT_TRUE(value == std::string{"abxyz"});
+  EXPECT_TRUE(InlineString<7>{"abc"} < value);
+
+  InlineString<7> moved{std::move(value)};
+  EXPECT_TRUE(value.empty());
+  EXPECT_STREQ("", value.c_str());
+  EXPECT_STREQ("abxyz", moved.c_str());
+}
+
+TEST(InlineVector, Encoding) {
+  Order order;
+  order.customer = "ACME";
+  order.items = {{"widget", 2}, {"gadget", 1}};
+  order.codes = {-1, 2, 300};
+
+  HeapOrder heap_order{"ACME", {{"widget", 2}, {"gadget", 1}}, {-1, 2, 300}};
+  const std::vector<std::uint8_t> bytes = Encode(order);
+  EXPECT_EQ(Encode(heap_order), bytes);
+
+  Order decoded;
+  ASSERT_TRUE(Decode(bytes, &decoded));
+  EXPECT_TRUE(decoded.customer == "ACME");
+  EXPECT_EQ(order.items, decoded.items);
+  EXPECT_EQ(order.codes, decoded.codes);
+  EXPECT_TRUE(decoded.items.is_inline());
+
+  // Longer values than the inline capacity spill to the heap.
+  heap_order.customer = std::string(40, 'c');
+  heap_order.items.resize(10, LineItem{"part", 5});
+  heap_order.codes.resize(20, 7);
+  ASSERT_TRUE(Decode(Encode(heap_order), &decoded));
+  EXPECT_FALSE(decoded.customer.is_inline());
+  EXPECT_FALSE(decoded.items.is_inline());
+  EXPECT_FALSE(decoded.codes.is_inline());
+  EXPECT_EQ(heap_order.customer, decoded.customer.str());
+  EXPECT_EQ(10u, decoded.items.size());
+  EXPECT_EQ(20u, decoded.codes.size());
+
+  HeapOrder round_trip;
+  ASSERT_TRUE(Decode(Encode(decoded), &round_trip));
+  EXPECT_EQ(heap_order.items, round_trip.items);
+  EXPECT_EQ(heap_order.codes, round_trip.codes);
+}
+
+TEST(InlineVector, AlternateForms) {
+  // The decoders accept the same forms as std::vector.
+  InlineVector<LineItem, 4> items;
+  IndexedArray<LineItem> indexed{{{"a", 1}, {"b", 2}}};
+  ASSERT_TRUE(Decode(Encode(indexed), &items));
+  EXPECT_EQ((InlineVector<LineItem, 4>{{"a", 1}, {"b", 2}}), items);
+
+  InlineVector<std::int32_t, 4> values;
+  Packed<std::int32_t> packed{{10, 11, 12, 13, 14, 15}};
+  ASSERT_TRUE(Decode(Encode(packed), &values));
+  EXPECT_EQ((InlineVector<std::int32_t, 4>{10, 11, 12, 13, 14, 15}), values);
+
+  // Malformed lengths are rejected.
+  std::vector<std::uint8_t> bytes = Encode(std::vector<std::uint8_t>{1, 2, 3});
+  Status<void> status = Decode(bytes, &values);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+}
@@ -0,0 +1,129 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+// This file is built into its own test binary with NOP_ENABLE_INSTRUMENTATION
+// defined to 1; see the Makefile.
+static_assert(NOP_ENABLE_INSTRUMENTATION,
+              "Instrumentation tests require NOP_ENABLE_INSTRUMENTATION.");
+
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::Encode;
+using nop::GetInstrumentationCounters;
+using nop::InstrumentationCounters;
+using nop::InstrumentationEvent;
+using nop::InstrumentationOp;
+using nop::ResetInstrumentationCounters;
+using nop::SetInstrumentationHandler;
+using nop::TypeName;
+
+namespace {
+
+struct Point {
+  std::int32_t x;
+  std::int32_t y;
+  NOP_STRUCTURE(Point, x, y);
+};
+
+struct Path {
+  std::string name;
+  std::vector<Point> points;
+  NOP_STRUCTURE(Path, name, points);
+};
+
+Path MakePath() { return {"route", {{1, 2}, {300, -4}, {5, 600000}}}; }
+
+std::vector<InstrumentationEvent> events;
+
+void RecordEvent(const InstrumentationEvent& event) { events.push_back(event); }
+
+}  // anonymous namespace
+
+TEST(Instrumentation, TypeName) {
+  EXPECT_EQ(std::string{"int"}, TypeName<int>());
+  EXPECT_EQ(std::string{"{anonymous}::Point"}, TypeName<Point>());
+  EXPECT_EQ(TypeName<Point>(), TypeName<Point>());
+  EXPECT_NE(TypeName<Point>(), TypeName<Path>());
+}
+
+TEST(Instrumentation, Counters) {
+  ResetInstrumentationCounters();
+  const std::vector<std::uint8_t> bytes = Encode(MakePath());
+
+  const InstrumentationCounters& path =
+      GetInstrumentationCounters()[TypeName<Path>()];
+  EXPECT_EQ(1u, path.encode_count);
+  EXPECT_EQ(bytes.size(), path.encode_bytes);
+  EXPECT_GT(path.encode_cycles, 0u);
+
+  // Nested values are counted individually.
+  const InstrumentationCounters& point =
+      GetInstrumentationCounters()[TypeName<Point>()];
+  EXPECT_EQ(3u, point.encode_count);
+  EXPECT_EQ(0u, point.decode_count);
+
+  Path decoded;
+  Deserializer<BufferReader> deserializer{bytes.data(), bytes.size()};
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(1u, path.decode_count);
+  EXPECT_EQ(bytes.size(), path.decode_bytes);
+  EXPECT_EQ(3u, point.decode_count);
+  EXPECT_EQ(0u, path.error_count);
+
+  // Failures are counted as errors.
+  Point wrong;
+  Deserializer<BufferReader> wrong_deserializer{bytes.data(), bytes.size()};
+  ASSERT_FALSE(wrong_deserializer.Read(&wrong));
+  EXPECT_EQ(1u, point.error_count);
+  EXPECT_EQ(3u, point.decode_count);
+
+  ResetInstrumentationCounters();
+  EXPECT_TRUE(GetInstrumentationCounters().empty());
+}
+
+TEST(Instrumentation, Handler) {
+  ResetInstrumentationCounters();
+  events.clear();
+  auto previous = SetInstrumentationHandler(&RecordEvent);
+  const std::vector<std::uint8_t> bytes = Encode(MakePath());
+
+  // Nested values finish before the values that contain them.
+  ASSERT_FALSE(events.empty());
+  EXPECT_EQ(InstrumentationOp::Encode, events.back().op);
+  EXPECT_EQ(TypeName<Path>(), events.back().type_name);
+  EXPECT_EQ(bytes.size(), events.back().bytes);
+  EXPECT_TRUE(events.back().ok);
+  EXPECT_TRUE(GetInstrumentationCounters().empty());
+
+  // Events stop when the handler is removed.
+  SetInstrumentationHandler(nullptr);
+  events.clear();
+  Encode(MakePath());
+  EXPECT_TRUE(events.empty());
+
+  SetInstrumentationHandler(previous);
+}
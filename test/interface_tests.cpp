@@ -12,40 +12,90 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <arpa/inet.h>
 #include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <map>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <type_traits>
 #include <vector>
 
+#include <nop/rpc/awaitable_method.h>
+#include <nop/rpc/batch_method_receiver.h>
+#include <nop/rpc/batching_method_sender.h>
+#include <nop/rpc/concurrent_method_receiver.h>
+#include <nop/rpc/epoll_server.h>
+#include <nop/rpc/framed_method_sender.h>
 #include <nop/rpc/interface.h>
+#include <nop/rpc/method_ids.h>
+#include <nop/rpc/pipelined_method_receiver.h>
+#include <nop/rpc/pipelined_method_sender.h>
+#include <nop/rpc/shared_memory_channel.h>
 #include <nop/rpc/simple_method_receiver.h>
 #include <nop/rpc/simple_method_sender.h>
 #include <nop/serializer.h>
 #include <nop/structure.h>
+#include <nop/types/span.h>
+#include <nop/types/string_view.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffered_fd_reader.h>
+#include <nop/utility/buffered_fd_writer.h>
+#include <nop/utility/frame_reader.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/vector_writer.h>
 
 #include "test_reader.h"
 #include "test_utilities.h"
 #include "test_writer.h"
 
+using nop::BatchLimits;
+using nop::BatchMethodReceiver;
+using nop::BatchingMethodSender;
 using nop::BindInterface;
+using nop::BufferReader;
+using nop::BufferedFdReader;
+using nop::BufferedFdWriter;
 using nop::Compose;
+using nop::CompactMethodSender;
+using nop::ConcurrentMethodReceiver;
 using nop::Deserializer;
 using nop::EncodingByte;
+using nop::EpollServer;
+using nop::EpollServerOptions;
 using nop::ErrorStatus;
 using nop::Float;
+using nop::FrameReader;
+using nop::FrameWriter;
+using nop::FramedMethodSender;
 using nop::Integer;
 using nop::Interface;
 using nop::InterfaceDispatcher;
 using nop::InterfaceType;
+using nop::MethodIds;
+using nop::PipelinedMethodSender;
 using nop::Serializer;
+using nop::SharedBlock;
+using nop::SharedMemoryChannel;
+using nop::SharedMemoryEndpoint;
 using nop::SimpleMethodReceiver;
 using nop::SimpleMethodSender;
 using nop::Status;
 using nop::TestReader;
 using nop::TestWriter;
 using nop::Variant;
+using nop::VectorWriter;
+using nop::WorkStealingPool;
 
 namespace {
 
@@ -132,6 +182,11 @@ TEST(InterfaceTests, Interface) {
             TestInterface::GetMethodSelector<2>());
   EXPECT_EQ(TestInterface::Match::Selector,
             TestInterface::GetMethodSelector<3>());
+
+  EXPECT_EQ(4u, TestInterface::GetMethodCount());
+  EXPECT_STREQ("Sum", TestInterface::Sum::GetName());
+  EXPECT_STREQ("Product", TestInterface::GetMethodName<1>());
+  EXPECT_STREQ("Match", TestInterface::GetMethodName<3>());
 }
 
 TEST(InterfaceTests, AbstractClass) {
@@ -210,6 +265,71 @@ TEST(InterfaceTests, Bind) {
   writer.clear();
 }
 
+TEST(InterfaceTests, Match) {
+  auto binding = BindInterface(
+      TestInterface::Match::Bind(
+          [](const Variant<MessageA, MessageB>&) { return true; }),
+      TestInterface::Sum::Bind([](int a, int b) { return a + b; }),
+      TestInterface::Length::Bind(
+          [](const std::string& string) { return string.size(); }));
+  EXPECT_EQ(3u, binding.Count);
+
+  EXPECT_TRUE(binding.Match(TestInterface::Sum::Selector));
+  EXPECT_TRUE(binding.Match(TestInterface::Length::Selector));
+  EXPECT_TRUE(binding.Match(TestInterface::Match::Selector));
+  EXPECT_FALSE(binding.Match(TestInterface::Product::Selector));
+  EXPECT_FALSE(binding.Match(TestInterface::Sum::Selector + 1));
+}
+
+TEST(InterfaceTests, MoveAndBorrowArgs) {
+  static_assert(nop::IsFungible<std::string, nop::StringView>::value,
+                "StringView should be fungible with std::string.");
+  static_assert(nop::IsFungible<std::vector<int>, nop::Span<int>>::value,
+                "Span<int> should be fungible with std::vector<int>.");
+  static_assert(!nop::IsFungible<std::vector<int>, nop::Span<char>>::value,
+                "Span<char> should not be fungible with std::vector<int>.");
+
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+  const std::vector<std::uint8_t> request =
+      Compose(MethodSelectorEncoding,
+              Integer<MethodSelectorType>(TestInterface::Length::Selector),
+              EncodingByte::Array, 1, EncodingByte::String, 6, "foobar");
+
+  // Arguments are moved into handlers that take rvalue references.
+  {
+    Deserializer<BufferReader> deserializer{request.data(), request.size()};
+    auto receiver = MakeSimpleMethodReceiver(&serializer, &deserializer);
+    auto binding =
+        BindInterface(TestInterface::Length::Bind([](std::string&& string) {
+          std::string moved{std::move(string)};
+          return moved.size();
+        }));
+
+    ASSERT_TRUE(binding(&receiver));
+    EXPECT_EQ(Compose(6), writer.data());
+    writer.clear();
+  }
+
+  // Handlers taking a StringView borrow the argument from the receive buffer.
+  {
+    Deserializer<BufferReader> deserializer{request.data(), request.size()};
+    auto receiver = MakeSimpleMethodReceiver(&serializer, &deserializer);
+    const void* borrowed = nullptr;
+    auto binding = BindInterface(
+        TestInterface::Length::Bind([&borrowed](nop::StringView string) {
+          borrowed = string.data();
+          return string.size();
+        }));
+
+    ASSERT_TRUE(binding(&receiver));
+    EXPECT_EQ(Compose(6), writer.data());
+    EXPECT_EQ(static_cast<const void*>(request.data() + request.size() - 6),
+              borrowed);
+    writer.clear();
+  }
+}
+
 TEST(InterfaceTests, Invoke) {
   std::vector<std::uint8_t> expected;
   TestReader reader;
@@ -267,3 +387,717 @@ TEST(InterfaceTests, Invoke) {
     writer.clear();
   }
 }
+
+TEST(InterfaceTests, CompactMethodIds) {
+  auto binding = BindInterface(
+      TestInterface::Sum::Bind([](int a, int b) { return a + b; }),
+      TestInterface::Length::Bind(
+          [](const std::string& string) { return string.size(); }));
+
+  // The handshake table lists the selectors in binding order.
+  const std::vector<MethodSelectorType> table = binding.GetMethodIdTable();
+  ASSERT_EQ(2u, table.size());
+  EXPECT_EQ(TestInterface::Sum::Selector, table[0]);
+  EXPECT_EQ(TestInterface::Length::Selector, table[1]);
+
+  auto ids = MethodIds<MethodSelectorType>::Create(table);
+  ASSERT_TRUE(ids);
+  EXPECT_EQ(2u, ids.get().size());
+  ASSERT_TRUE(ids.get().Find(TestInterface::Length::Selector));
+  EXPECT_EQ(1u, ids.get().Find(TestInterface::Length::Selector).get());
+  EXPECT_EQ(TestInterface::Length::Selector, ids.get().selector(1));
+
+  // Duplicate selectors are rejected.
+  auto duplicate = MethodIds<MethodSelectorType>::Create(
+      {TestInterface::Sum::Selector, TestInterface::Sum::Selector});
+  ASSERT_FALSE(duplicate);
+  EXPECT_EQ(ErrorStatus::InvalidInterfaceMethod, duplicate.error());
+
+  TestReader reader;
+  TestWriter writer;
+  Deserializer<TestReader*> deserializer{&reader};
+  Serializer<TestWriter*> serializer{&writer};
+  auto sender = MakeSimpleMethodSender(&serializer, &deserializer);
+  CompactMethodSender<decltype(sender), MethodSelectorType> compact{
+      &sender, &ids.get()};
+
+  // Calls carry the one byte id in place of the selector.
+  reader.Set(Compose(3));
+  auto length = TestInterface::Length::Invoke(&compact, "foo");
+  ASSERT_TRUE(length);
+  EXPECT_EQ(3u, length.get());
+  const std::vector<std::uint8_t> request =
+      Compose(1, EncodingByte::Array, 1, EncodingByte::String, 3, "foo");
+  EXPECT_EQ(request, writer.data());
+  writer.clear();
+
+  // Methods missing from the table fail without being sent.
+  auto product = TestInterface::Product::Invoke(&compact, 2, 3);
+  ASSERT_FALSE(product);
+  EXPECT_EQ(ErrorStatus::InvalidInterfaceMethod, product.error());
+  EXPECT_TRUE(writer.data().empty());
+
+  // The receiver dispatches by id.
+  auto receiver = MakeSimpleMethodReceiver(&serializer, &deserializer);
+  reader.Set(request);
+  ASSERT_TRUE(binding.DispatchById(&receiver));
+  EXPECT_EQ(Compose(3), writer.data());
+  writer.clear();
+
+  reader.Set(Compose(0, EncodingByte::Array, 2, 10, 20));
+  ASSERT_TRUE(binding.DispatchById(&receiver));
+  EXPECT_EQ(Compose(30), writer.data());
+  writer.clear();
+
+  reader.Set(Compose(2, EncodingByte::Array, 2, 10, 20));
+  Status<void> status = binding.DispatchById(&receiver);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidInterfaceMethod, status.error());
+}
+
+TEST(InterfaceTests, PipelinedInvoke) {
+  std::vector<std::uint8_t> expected;
+  TestReader reader;
+  TestWriter writer;
+  Deserializer<TestReader*> deserializer{&reader};
+  Serializer<TestWriter*> serializer{&writer};
+  PipelinedMethodSender<decltype(serializer), decltype(deserializer)> sender{
+      &serializer, &deserializer};
+
+  // Send several calls before any return value arrives.
+  std::vector<int> sums;
+  std::vector<std::size_t> lengths;
+  auto id = TestInterface::Sum::InvokeAsync(
+      &sender, [&sums](Status<int> value) { sums.push_back(value.get()); }, 10,
+      20);
+  ASSERT_TRUE(id);
+  EXPECT_EQ(0u, id.get());
+
+  id = TestInterface::Length::InvokeAsync(
+      &sender,
+      [&lengths](Status<std::size_t> value) { lengths.push_back(value.get()); },
+      "foo");
+  ASSERT_TRUE(id);
+  EXPECT_EQ(1u, id.get());
+
+  id = TestInterface::Sum::InvokeAsync(
+      &sender, [&sums](Status<int> value) { sums.push_back(value.get()); }, 1,
+      2);
+  ASSERT_TRUE(id);
+  EXPECT_EQ(2u, id.get());
+  EXPECT_EQ(3u, sender.pending_count());
+
+  expected = Compose(
+      0, MethodSelectorEncoding,
+      Integer<MethodSelectorType>(TestInterface::Sum::Selector),
+      EncodingByte::Array, 2, 10, 20, 1, MethodSelectorEncoding,
+      Integer<MethodSelectorType>(TestInterface::Length::Selector),
+      EncodingByte::Array, 1, EncodingByte::String, 3, "foo", 2,
+      MethodSelectorEncoding,
+      Integer<MethodSelectorType>(TestInterface::Sum::Selector),
+      EncodingByte::Array, 2, 1, 2);
+  EXPECT_EQ(expected, writer.data());
+  writer.clear();
+
+  // Return values complete their calls in the order they arrive.
+  reader.Set(Compose(2, 3, 0, 30, 1, 3));
+  ASSERT_TRUE(sender.ReceiveReturn());
+  ASSERT_TRUE(sender.ReceiveReturn());
+  ASSERT_TRUE(sender.ReceiveReturn());
+  EXPECT_EQ((std::vector<int>{3, 30}), sums);
+  EXPECT_EQ((std::vector<std::size_t>{3}), lengths);
+  EXPECT_EQ(0u, sender.pending_count());
+
+  // Unknown request ids are a protocol error.
+  reader.Set(Compose(7, 30));
+  auto status = sender.ReceiveReturn();
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ProtocolError, status.error());
+
+  // Synchronous calls complete other calls in flight while waiting.
+  id = TestInterface::Sum::InvokeAsync(
+      &sender, [&sums](Status<int> value) { sums.push_back(value.get()); }, 5,
+      5);
+  ASSERT_TRUE(id);
+  EXPECT_EQ(3u, id.get());
+
+  reader.Set(Compose(3, 10, 4, 7));
+  auto sum = TestInterface::Sum::Invoke(&sender, 3, 4);
+  ASSERT_TRUE(sum);
+  EXPECT_EQ(7, sum.get());
+  EXPECT_EQ((std::vector<int>{3, 30, 10}), sums);
+  writer.clear();
+
+  // Outstanding calls may be cancelled.
+  Status<int> cancelled;
+  id = TestInterface::Sum::InvokeAsync(
+      &sender, [&cancelled](Status<int> value) { cancelled = value; }, 1, 1);
+  ASSERT_TRUE(id);
+  sender.CancelPending(ErrorStatus::ReadLimitReached);
+  ASSERT_FALSE(cancelled);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, cancelled.error());
+  EXPECT_EQ(0u, sender.pending_count());
+}
+
+TEST(InterfaceTests, PipelinedDispatch) {
+  std::vector<std::uint8_t> expected;
+  TestReader reader;
+  TestWriter writer;
+  Deserializer<TestReader*> deserializer{&reader};
+  Serializer<TestWriter*> serializer{&writer};
+  auto receiver = MakePipelinedMethodReceiver(&serializer, &deserializer);
+
+  auto binding = BindInterface(
+      TestInterface::Sum::Bind([](int a, int b) { return a + b; }));
+
+  reader.Set(Compose(9, MethodSelectorEncoding,
+                     Integer<MethodSelectorType>(TestInterface::Sum::Selector),
+                     EncodingByte::Array, 2, 10, 20));
+  ASSERT_TRUE(binding(&receiver));
+  EXPECT_EQ(9u, receiver.request_id());
+
+  expected = Compose(9, 30);
+  EXPECT_EQ(expected, writer.data());
+}
+
+TEST(InterfaceTests, BatchedInvokeAndDispatch) {
+  TestReader request_reader;
+  TestWriter request_writer;
+  TestReader response_reader;
+  TestWriter response_writer;
+  Deserializer<TestReader*> request_deserializer{&request_reader};
+  Serializer<TestWriter*> request_serializer{&request_writer};
+  Deserializer<TestReader*> response_deserializer{&response_reader};
+  Serializer<TestWriter*> response_serializer{&response_writer};
+
+  BatchLimits limits;
+  limits.max_calls = 3;
+  BatchingMethodSender<decltype(request_serializer),
+                       decltype(response_deserializer)>
+      sender{&request_serializer, &response_deserializer, limits};
+  BatchMethodReceiver<decltype(response_serializer),
+                      decltype(request_deserializer)>
+      receiver{&response_serializer, &request_deserializer};
+
+  auto binding = BindInterface(
+      TestInterface::Sum::Bind([](int a, int b) { return a + b; }),
+      TestInterface::Length::Bind(
+          [](const std::string& string) { return string.size(); }));
+
+  // Calls are held until the batch is full.
+  std::vector<int> sums;
+  std::vector<std::size_t> lengths;
+  ASSERT_TRUE(TestInterface::Sum::InvokeAsync(
+      &sender, [&sums](Status<int> value) { sums.push_back(value.get()); }, 10,
+      20));
+  ASSERT_TRUE(TestInterface::Length::InvokeAsync(
+      &sender,
+      [&lengths](Status<std::size_t> value) { lengths.push_back(value.get()); },
+      "foo"));
+  EXPECT_EQ(2u, sender.batch_count());
+  EXPECT_TRUE(request_writer.data().empty());
+
+  ASSERT_TRUE(TestInterface::Sum::InvokeAsync(
+      &sender, [&sums](Status<int> value) { sums.push_back(value.get()); }, 1,
+      2));
+  EXPECT_EQ(0u, sender.batch_count());
+  EXPECT_EQ(3u, sender.pending_count());
+
+  // The whole batch is one binary value.
+  std::vector<std::uint8_t> calls = Compose(
+      0, MethodSelectorEncoding,
+      Integer<MethodSelectorType>(TestInterface::Sum::Selector),
+      EncodingByte::Array, 2, 10, 20, 1, MethodSelectorEncoding,
+      Integer<MethodSelectorType>(TestInterface::Length::Selector),
+      EncodingByte::Array, 1, EncodingByte::String, 3, "foo", 2,
+      MethodSelectorEncoding,
+      Integer<MethodSelectorType>(TestInterface::Sum::Selector),
+      EncodingByte::Array, 2, 1, 2);
+  std::vector<std::uint8_t> expected =
+      Compose(EncodingByte::Binary, calls.size(), calls);
+  EXPECT_EQ(expected, request_writer.data());
+
+  // Every call in the frame is dispatched and answered in one response.
+  request_reader.Set(request_writer.data());
+  ASSERT_TRUE(binding.DispatchBatch(&receiver));
+  std::vector<std::uint8_t> returns = Compose(0, 30, 1, 3, 2, 3);
+  expected = Compose(EncodingByte::Binary, returns.size(), returns);
+  EXPECT_EQ(expected, response_writer.data());
+
+  response_reader.Set(response_writer.data());
+  ASSERT_TRUE(sender.ReceiveReturn());
+  EXPECT_EQ((std::vector<int>{30, 3}), sums);
+  EXPECT_EQ((std::vector<std::size_t>{3}), lengths);
+  EXPECT_EQ(0u, sender.pending_count());
+
+  // Partial batches are sent by Flush() and by synchronous calls.
+  request_writer.clear();
+  response_writer.clear();
+  ASSERT_TRUE(TestInterface::Sum::InvokeAsync(
+      &sender, [&sums](Status<int> value) { sums.push_back(value.get()); }, 5,
+      5));
+  ASSERT_TRUE(sender.Flush());
+  request_reader.Set(request_writer.data());
+  ASSERT_TRUE(binding.DispatchBatch(&receiver));
+  response_reader.Set(response_writer.data());
+  ASSERT_TRUE(sender.ReceiveReturn());
+  EXPECT_EQ((std::vector<int>{30, 3, 10}), sums);
+
+  // Unknown selectors stop the batch after answering the earlier calls.
+  calls = Compose(7, MethodSelectorEncoding,
+                  Integer<MethodSelectorType>(TestInterface::Sum::Selector),
+                  EncodingByte::Array, 2, 1, 1, 8, MethodSelectorEncoding,
+                  Integer<MethodSelectorType>(TestInterface::Product::Selector),
+                  EncodingByte::Array, 2, 1, 1);
+  request_reader.Set(Compose(EncodingByte::Binary, calls.size(), calls));
+  response_writer.clear();
+  auto status = binding.DispatchBatch(&receiver);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidInterfaceMethod, status.error());
+  returns = Compose(7, 2);
+  expected = Compose(EncodingByte::Binary, returns.size(), returns);
+  EXPECT_EQ(expected, response_writer.data());
+
+  // The sender fails the calls that a short response does not answer.
+  request_writer.clear();
+  response_writer.clear();
+  Status<int> sum;
+  Status<int> product;
+  Status<int> skipped;
+  ASSERT_TRUE(TestInterface::Sum::InvokeAsync(
+      &sender, [&sum](Status<int> value) { sum = value; }, 2, 2));
+  ASSERT_TRUE(TestInterface::Product::InvokeAsync(
+      &sender, [&product](Status<int> value) { product = value; }, 2, 3));
+  ASSERT_TRUE(TestInterface::Sum::InvokeAsync(
+      &sender, [&skipped](Status<int> value) { skipped = value; }, 3, 3));
+  ASSERT_TRUE(sender.Flush());
+
+  request_reader.Set(request_writer.data());
+  status = binding.DispatchBatch(&receiver);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidInterfaceMethod, status.error());
+
+  response_reader.Set(response_writer.data());
+  ASSERT_TRUE(sender.ReceiveReturn());
+  ASSERT_TRUE(sum);
+  EXPECT_EQ(4, sum.get());
+  ASSERT_FALSE(product);
+  EXPECT_EQ(ErrorStatus::ProtocolError, product.error());
+  ASSERT_FALSE(skipped);
+  EXPECT_EQ(ErrorStatus::ProtocolError, skipped.error());
+  EXPECT_EQ(0u, sender.pending_count());
+}
+
+TEST(InterfaceTests, BatchedConcurrentInvoke) {
+  int request_fds[2];
+  int response_fds[2];
+  ASSERT_EQ(0, pipe(request_fds));
+  ASSERT_EQ(0, pipe(response_fds));
+
+  auto binding = BindInterface(
+      TestInterface::Sum::Bind([](int a, int b) { return a + b; }));
+
+  // The receiver answers batches until the request pipe is closed.
+  std::thread server_thread{[&binding, &request_fds, &response_fds] {
+    Serializer<BufferedFdWriter<>> serializer{response_fds[1]};
+    Deserializer<BufferedFdReader<>> deserializer{request_fds[0]};
+    BatchMethodReceiver<decltype(serializer), decltype(deserializer)> receiver{
+        &serializer, &deserializer};
+    while (binding.DispatchBatch(&receiver)) {
+    }
+  }};
+
+  Serializer<BufferedFdWriter<>> serializer{request_fds[1]};
+  Deserializer<BufferedFdReader<>> deserializer{response_fds[0]};
+  BatchingMethodSender<decltype(serializer), decltype(deserializer)> sender{
+      &serializer, &deserializer};
+
+  // Synchronous calls from several threads share the response stream, so
+  // each thread may receive the return values of the others.
+  std::vector<std::thread> clients;
+  std::vector<int> failures(4, 0);
+  for (std::size_t i = 0; i < failures.size(); i++) {
+    clients.emplace_back([&sender, &failures, i] {
+      for (int j = 0; j < 200; j++) {
+        auto sum = TestInterface::Sum::Invoke(&sender, j, static_cast<int>(i));
+        if (!sum || sum.get() != j + static_cast<int>(i))
+          failures[i]++;
+      }
+    });
+  }
+  for (auto& client : clients)
+    client.join();
+  EXPECT_EQ((std::vector<int>(4, 0)), failures);
+  EXPECT_EQ(0u, sender.pending_count());
+
+  ::close(request_fds[1]);
+  server_thread.join();
+  ::close(request_fds[0]);
+  ::close(response_fds[0]);
+  ::close(response_fds[1]);
+}
+
+namespace {
+
+// Connects a blocking TCP socket to the loopback address on |port|.
+int ConnectLoopback(std::uint16_t port) {
+  const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) <
+      0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+}  // anonymous namespace
+
+TEST(InterfaceTests, EpollServer) {
+  auto bindings = BindInterface(
+      TestInterface::Sum::Bind([](int a, int b) { return a + b; }),
+      TestInterface::Length::Bind(
+          [](const std::string& string) { return string.size(); }));
+
+  EpollServerOptions options;
+  options.thread_count = 2;
+  options.max_output_bytes = 16;
+  EpollServer<decltype(bindings)> server{&bindings, options};
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_TRUE(server.Listen(reinterpret_cast<sockaddr*>(&address),
+                            sizeof(address)));
+  auto port = server.port();
+  ASSERT_TRUE(port);
+  ASSERT_TRUE(server.Start());
+
+  // Several clients make calls concurrently.
+  std::vector<std::thread> clients;
+  std::vector<int> failures(4, 0);
+  for (std::size_t i = 0; i < failures.size(); i++) {
+    clients.emplace_back([&failures, i, port] {
+      const int fd = ConnectLoopback(port.get());
+      FramedMethodSender sender{fd};
+      for (int j = 0; j < 50; j++) {
+        auto sum = TestInterface::Sum::Invoke(&sender, j, 1);
+        auto length = TestInterface::Length::Invoke(&sender, "foo");
+        if (!sum || sum.get() != j + 1 || !length || length.get() != 3)
+          failures[i]++;
+      }
+      ::close(fd);
+    });
+  }
+  for (auto& client : clients)
+    client.join();
+  EXPECT_EQ((std::vector<int>(4, 0)), failures);
+
+  // A client that sends faster than it reads is paused rather than buffered
+  // without bound, and every request is still answered in order.
+  {
+    const int fd = ConnectLoopback(port.get());
+    ASSERT_LE(0, fd);
+
+    const int kRequestCount = 50000;
+    VectorWriter requests;
+    FrameWriter<VectorWriter> frame_writer{&requests};
+    for (int i = 0; i < kRequestCount; i++) {
+      VectorWriter payload;
+      Serializer<VectorWriter*> serializer{&payload};
+      ASSERT_TRUE(serializer.Write(
+          static_cast<MethodSelectorType>(TestInterface::Sum::Selector)));
+      ASSERT_TRUE(serializer.Write(std::make_tuple(i, i)));
+      ASSERT_TRUE(frame_writer.WriteFrame(
+          payload.data().data(), payload.data().data() + payload.size()));
+    }
+
+    std::thread writer{[fd, &requests] {
+      std::size_t offset = 0;
+      while (offset < requests.size()) {
+        const ssize_t ret = ::send(fd, requests.data().data() + offset,
+                                   requests.size() - offset, MSG_NOSIGNAL);
+        if (ret <= 0)
+          return;
+        offset += ret;
+      }
+    }};
+
+    // Let the responses back up before reading any of them.
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+
+    FrameReader frames;
+    int count = 0;
+    int mismatches = 0;
+    while (count < kRequestCount) {
+      BufferReader frame;
+      auto next = frames.NextFrame(&frame);
+      ASSERT_TRUE(next);
+      if (!next.get()) {
+        ASSERT_TRUE(frames.ReadFrom(fd));
+        continue;
+      }
+
+      Deserializer<BufferReader*> deserializer{&frame};
+      int sum = 0;
+      ASSERT_TRUE(deserializer.Read(&sum));
+      if (sum != 2 * count)
+        mismatches++;
+      count++;
+    }
+    writer.join();
+    EXPECT_EQ(0, mismatches);
+    ::close(fd);
+  }
+
+  // Unknown methods close the connection.
+  {
+    const int fd = ConnectLoopback(port.get());
+    ASSERT_LE(0, fd);
+    FramedMethodSender sender{fd};
+    auto product = TestInterface::Product::Invoke(&sender, 2, 3);
+    ASSERT_FALSE(product);
+    EXPECT_EQ(ErrorStatus::ReadLimitReached, product.error());
+    ::close(fd);
+  }
+
+  server.Stop();
+}
+
+namespace {
+
+struct BulkInterface : Interface<BulkInterface> {
+  NOP_INTERFACE("io.github.eieio.BulkInterface");
+
+  NOP_METHOD(Sum, int(int a, int b));
+  NOP_METHOD(Checksum, std::uint32_t(const SharedBlock& block));
+  NOP_METHOD(Fill, SharedBlock(std::uint8_t value, std::size_t size));
+
+  NOP_INTERFACE_API(Sum, Checksum, Fill);
+};
+
+}  // anonymous namespace
+
+TEST(InterfaceTests, SharedMemoryChannel) {
+  const std::size_t kRingCapacity = 4096;
+  const std::size_t kBulkCapacity = 1 << 16;
+  const std::size_t region_size =
+      SharedMemoryChannel::RegionSize(kRingCapacity, kBulkCapacity);
+  void* memory = ::mmap(nullptr, region_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(MAP_FAILED, memory);
+
+  SharedMemoryChannel channel{memory, kRingCapacity, kBulkCapacity};
+  ASSERT_TRUE(channel.Initialize());
+
+  std::thread server_thread{[&channel] {
+    SharedMemoryEndpoint server{channel, SharedMemoryEndpoint::Side::Server};
+    auto bindings = BindInterface(
+        BulkInterface::Sum::Bind([](int a, int b) { return a + b; }),
+        BulkInterface::Checksum::Bind(
+            [&server](const SharedBlock& block) -> std::uint32_t {
+              auto data = server.Resolve(block);
+              if (!data)
+                return 0;
+              std::uint32_t checksum = 0;
+              for (std::size_t i = 0; i < block.size; i++)
+                checksum += data.get()[i];
+              return checksum;
+            }),
+        BulkInterface::Fill::Bind(
+            [&server](std::uint8_t value, std::size_t size) {
+              server.Reset();
+              std::uint8_t* data = nullptr;
+              auto block = server.Allocate(size, &data);
+              if (!block)
+                return SharedBlock{};
+              std::memset(data, value, size);
+              return block.get();
+            }));
+
+    while (server.Dispatch(bindings)) {
+    }
+  }};
+
+  {
+    SharedMemoryEndpoint client{channel, SharedMemoryEndpoint::Side::Client};
+    for (int i = 0; i < 1000; i++) {
+      auto sum = BulkInterface::Sum::Invoke(client.sender(), i, 1);
+      ASSERT_TRUE(sum);
+      EXPECT_EQ(i + 1, sum.get());
+    }
+
+    // Arguments larger than the ring are passed by reference.
+    std::vector<std::uint8_t> bytes(2 * kRingCapacity, 3);
+    auto block = client.Copy(bytes.data(), bytes.size());
+    ASSERT_TRUE(block);
+    auto checksum = BulkInterface::Checksum::Invoke(client.sender(),
+                                                    block.get());
+    ASSERT_TRUE(checksum);
+    EXPECT_EQ(3 * bytes.size(), checksum.get());
+    client.Reset();
+    EXPECT_EQ(0u, client.bulk_used());
+
+    // Blocks outside the bulk area are rejected by the receiving side.
+    checksum = BulkInterface::Checksum::Invoke(
+        client.sender(), SharedBlock{kBulkCapacity, 1});
+    ASSERT_TRUE(checksum);
+    EXPECT_EQ(0u, checksum.get());
+
+    // Return values may refer to the bulk area too.
+    auto filled = BulkInterface::Fill::Invoke(client.sender(), 7, 100);
+    ASSERT_TRUE(filled);
+    auto data = client.Resolve(filled.get());
+    ASSERT_TRUE(data);
+    EXPECT_EQ(100u, filled.get().size);
+    EXPECT_EQ(std::vector<std::uint8_t>(100, 7),
+              std::vector<std::uint8_t>(data.get(), data.get() + 100));
+
+    std::uint8_t* destination = nullptr;
+    EXPECT_FALSE(client.Allocate(kBulkCapacity + 1, &destination));
+  }
+
+  // Closing the client stops the server.
+  server_thread.join();
+  ::munmap(memory, region_size);
+}
+
+TEST(InterfaceTests, ConcurrentDispatch) {
+  TestReader reader;
+  TestWriter writer;
+  Deserializer<TestReader*> deserializer{&reader};
+  Serializer<TestWriter*> serializer{&writer};
+  WorkStealingPool pool{4};
+  ConcurrentMethodReceiver<decltype(serializer), decltype(deserializer)>
+      receiver{&serializer, &deserializer, &pool};
+
+  // The first call blocks until the second has run, which requires the calls
+  // to be dispatched concurrently.
+  std::promise<void> second_ran;
+  std::shared_future<void> second_ran_future = second_ran.get_future();
+  auto binding = BindInterface(
+      TestInterface::Sum::Bind([second_ran_future](int a, int b) {
+        second_ran_future.wait_for(std::chrono::seconds{10});
+        return a + b;
+      }),
+      TestInterface::Product::Bind([&second_ran](int a, int b) {
+        second_ran.set_value();
+        return a * b;
+      }));
+
+  reader.Set(Compose(
+      0, MethodSelectorEncoding,
+      Integer<MethodSelectorType>(TestInterface::Sum::Selector),
+      EncodingByte::Array, 2, 10, 20, 1, MethodSelectorEncoding,
+      Integer<MethodSelectorType>(TestInterface::Product::Selector),
+      EncodingByte::Array, 2, 3, 4));
+  ASSERT_TRUE(receiver.Dispatch(binding));
+  ASSERT_TRUE(receiver.Dispatch(binding));
+
+  // Unbound methods are reported on the I/O thread.
+  reader.Set(Compose(
+      2, MethodSelectorEncoding,
+      Integer<MethodSelectorType>(TestInterface::Length::Selector)));
+  auto status = receiver.Dispatch(binding);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidInterfaceMethod, status.error());
+
+  pool.Wait();
+  ASSERT_TRUE(receiver.status());
+
+  // The product finishes first, but either order is valid.
+  TestReader results_reader;
+  Deserializer<TestReader*> results{&results_reader};
+  results_reader.Set(writer.data());
+  std::map<std::uint64_t, int> returns;
+  for (int i = 0; i < 2; i++) {
+    std::uint64_t request_id;
+    int value;
+    ASSERT_TRUE(results.Read(&request_id));
+    ASSERT_TRUE(results.Read(&value));
+    returns[request_id] = value;
+  }
+  EXPECT_EQ((std::map<std::uint64_t, int>{{0, 30}, {1, 12}}), returns);
+}
+
+TEST(InterfaceTests, ConcurrentDispatchMethod) {
+  TestReader reader;
+  TestWriter writer;
+  Deserializer<TestReader*> deserializer{&reader};
+  Serializer<TestWriter*> serializer{&writer};
+  WorkStealingPool pool{2};
+  ConcurrentMethodReceiver<decltype(serializer), decltype(deserializer)>
+      receiver{&serializer, &deserializer, &pool};
+
+  ConcreteClass concrete;
+  auto binding = AbstractClass::Bind();
+
+  reader.Set(
+      Compose(5, MethodSelectorEncoding,
+              Integer<MethodSelectorType>(
+                  AbstractClass::GetLengthMethodSelector()),
+              EncodingByte::Array, 1, EncodingByte::String, 3, "foo"));
+  ASSERT_TRUE(receiver.Dispatch(binding, &concrete));
+
+  pool.Wait();
+  ASSERT_TRUE(receiver.status());
+  EXPECT_EQ(Compose(5, 3), writer.data());
+}
+
+#if NOP_HAS_COROUTINES
+
+namespace {
+
+// Minimal eagerly started coroutine type for testing awaitable methods.
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() {}
+  };
+};
+
+template <typename Sender>
+DetachedTask SumThenLength(Sender* sender, std::vector<int>* results) {
+  Status<int> sum = co_await nop::AwaitMethod<TestInterface::Sum>(sender, 1, 2);
+  results->push_back(sum.get());
+
+  Status<std::size_t> length =
+      co_await nop::AwaitMethod<TestInterface::Length>(sender, "four");
+  results->push_back(static_cast<int>(length.get()));
+}
+
+}  // anonymous namespace
+
+TEST(InterfaceTests, AwaitMethod) {
+  TestReader reader;
+  TestWriter writer;
+  Deserializer<TestReader*> deserializer{&reader};
+  Serializer<TestWriter*> serializer{&writer};
+  PipelinedMethodSender<decltype(serializer), decltype(deserializer)> sender{
+      &serializer, &deserializer};
+
+  // Two coroutines suspend on their first calls.
+  std::vector<int> results_a;
+  std::vector<int> results_b;
+  SumThenLength(&sender, &results_a);
+  SumThenLength(&sender, &results_b);
+  EXPECT_EQ(2u, sender.pending_count());
+  EXPECT_TRUE(results_a.empty());
+  EXPECT_TRUE(results_b.empty());
+
+  // Complete the second coroutine's calls first, then the first's.
+  reader.Set(Compose(1, 3, 2, 4, 0, 3, 3, 4));
+  while (sender.pending_count())
+    ASSERT_TRUE(sender.ReceiveReturn());
+
+  EXPECT_EQ((std::vector<int>{3, 4}), results_a);
+  EXPECT_EQ((std::vector<int>{3, 4}), results_b);
+}
+
+#endif  // NOP_HAS_COROUTINES
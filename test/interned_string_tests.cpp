@@ -0,0 +1,359 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/cached.h>
+#include <nop/types/indexed_array.h>
+#include <nop/types/interned_string.h>
+#include <nop/types/lazy.h>
+#include <nop/utility/array_cursor.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/string_dictionary_reader.h>
+#include <nop/utility/string_dictionary_writer.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::ArrayCursor;
+using nop::BufferReader;
+using nop::Cached;
+using nop::Deserializer;
+using nop::EncodingByte;
+using nop::Entry;
+using nop::IndexedArray;
+using nop::ErrorStatus;
+using nop::InternedString;
+using nop::Lazy;
+using nop::Serializer;
+using nop::SkipValue;
+using nop::Status;
+using nop::StringDictionaryReader;
+using nop::StringDictionaryWriter;
+using nop::VectorWriter;
+
+namespace {
+
+struct Sample {
+  InternedString host;
+  InternedString metric;
+  int value;
+
+  NOP_STRUCTURE(Sample, host, metric, value);
+};
+
+struct PlainSample {
+  std::string host;
+  std::string metric;
+  int value;
+
+  NOP_STRUCTURE(PlainSample, host, metric, value);
+};
+
+struct SampleTable {
+  Entry<InternedString, 0> host;
+  Entry<std::vector<Sample>, 1> samples;
+
+  NOP_TABLE_NS("SampleTable", SampleTable, host, samples);
+};
+
+// A later version of SampleTable with an entry that SampleTable skips.
+struct RegionSampleTable {
+  Entry<InternedString, 0> host;
+  Entry<std::vector<Sample>, 1> samples;
+  Entry<InternedString, 2> region;
+
+  NOP_TABLE_NS("SampleTable", RegionSampleTable, host, samples, region);
+};
+
+using Writer = StringDictionaryWriter<VectorWriter>;
+using Reader = StringDictionaryReader<BufferReader>;
+
+std::vector<Sample> MakeSamples(int count) {
+  std::vector<Sample> samples;
+  for (int i = 0; i < count; i++) {
+    samples.push_back({"host-" + std::to_string(i % 4) + ".example.com",
+                       "cpu.utilization", i});
+  }
+  return samples;
+}
+
+}  // anonymous namespace
+
+TEST(InternedString, Basic) {
+  InternedString empty;
+  EXPECT_EQ("", empty.get());
+
+  InternedString a{"metric"};
+  InternedString b{std::string{"metric"}};
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a.shared(), b.shared());
+  EXPECT_NE(a, InternedString{"other"});
+  EXPECT_EQ(6u, a->size());
+
+  // Without a dictionary interned strings encode exactly like strings.
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(Sample{"host", "metric", 1}));
+  Serializer<VectorWriter> plain_serializer;
+  ASSERT_TRUE(plain_serializer.Write(PlainSample{"host", "metric", 1}));
+  EXPECT_EQ(plain_serializer.writer().data(), serializer.writer().data());
+
+  const std::vector<std::uint8_t>& bytes = serializer.writer().data();
+  Sample sample;
+  Deserializer<BufferReader> deserializer{bytes.data(), bytes.size()};
+  ASSERT_TRUE(deserializer.Read(&sample));
+  EXPECT_EQ("host", sample.host.get());
+  EXPECT_EQ("metric", sample.metric.get());
+}
+
+TEST(InternedString, Dictionary) {
+  const std::vector<Sample> samples = MakeSamples(100);
+
+  Serializer<Writer> serializer;
+  Serializer<VectorWriter> plain_serializer;
+  for (const Sample& sample : samples) {
+    ASSERT_TRUE(serializer.Write(sample));
+    ASSERT_TRUE(plain_serializer.Write(sample));
+  }
+  EXPECT_EQ(5u, serializer.writer().dictionary().size());
+
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+  EXPECT_LT(bytes.size(), plain_serializer.writer().data().size() / 3);
+
+  // The first string in the stream is a definition.
+  EXPECT_EQ(static_cast<std::uint8_t>(EncodingByte::StringDefinition),
+            bytes[2]);
+
+  Deserializer<Reader> deserializer{bytes.data(), bytes.size()};
+  std::vector<Sample> decoded(samples.size());
+  for (Sample& sample : decoded)
+    ASSERT_TRUE(deserializer.Read(&sample));
+  EXPECT_EQ(5u, deserializer.reader().dictionary().size());
+
+  for (std::size_t i = 0; i < samples.size(); i++) {
+    EXPECT_EQ(samples[i].host, decoded[i].host);
+    EXPECT_EQ(samples[i].metric, decoded[i].metric);
+    EXPECT_EQ(samples[i].value, decoded[i].value);
+  }
+
+  // Repeated strings share one instance.
+  EXPECT_EQ(decoded[0].metric.shared(), decoded[99].metric.shared());
+  EXPECT_EQ(decoded[1].host.shared(), decoded[5].host.shared());
+
+  // Plain strings are accepted in place of interned strings.
+  const std::vector<std::uint8_t>& plain = plain_serializer.writer().data();
+  Deserializer<Reader> plain_deserializer{plain.data(), plain.size()};
+  Sample sample;
+  ASSERT_TRUE(plain_deserializer.Read(&sample));
+  EXPECT_EQ(samples[0].host, sample.host);
+  EXPECT_EQ(0u, plain_deserializer.reader().dictionary().size());
+}
+
+TEST(InternedString, LimitAndReset) {
+  const std::vector<Sample> samples = MakeSamples(8);
+
+  Serializer<Writer> serializer;
+  serializer.writer().dictionary().set_limit(2);
+  for (std::size_t i = 0; i < 4; i++)
+    ASSERT_TRUE(serializer.Write(samples[i]));
+  EXPECT_EQ(2u, serializer.writer().dictionary().size());
+
+  serializer.writer().dictionary().Reset();
+  for (std::size_t i = 4; i < samples.size(); i++)
+    ASSERT_TRUE(serializer.Write(samples[i]));
+
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+  Deserializer<Reader> deserializer{bytes.data(), bytes.size()};
+  deserializer.reader().dictionary().set_limit(2);
+  Sample sample;
+  for (std::size_t i = 0; i < samples.size(); i++) {
+    if (i == 4)
+      deserializer.reader().dictionary().Reset();
+    ASSERT_TRUE(deserializer.Read(&sample)) << i;
+    EXPECT_EQ(samples[i].host, sample.host);
+    EXPECT_EQ(samples[i].metric, sample.metric);
+  }
+
+  // A reader with a smaller limit rejects the extra definitions.
+  Deserializer<Reader> limited{bytes.data(), bytes.size()};
+  limited.reader().dictionary().set_limit(1);
+  Status<void> status = limited.Read(&sample);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ProtocolError, status.error());
+}
+
+TEST(InternedString, Table) {
+  SampleTable table;
+  table.host = InternedString{"host-0.example.com"};
+  table.samples = MakeSamples(10);
+
+  Serializer<Writer> serializer;
+  ASSERT_TRUE(serializer.Write(table));
+
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+  Deserializer<Reader> deserializer{bytes.data(), bytes.size()};
+  SampleTable decoded;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  ASSERT_TRUE(decoded.host && decoded.samples);
+  EXPECT_EQ(table.host.get(), decoded.host.get());
+  ASSERT_EQ(10u, decoded.samples.get().size());
+  EXPECT_EQ(decoded.host.get().shared(),
+            decoded.samples.get()[0].host.shared());
+}
+
+TEST(InternedString, Errors) {
+  Serializer<Writer> serializer;
+  ASSERT_TRUE(serializer.Write(Sample{"host", "host", 1}));
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+
+  // Definitions and references require a dictionary.
+  Sample sample;
+  Deserializer<BufferReader> plain{bytes.data(), bytes.size()};
+  Status<void> status = plain.Read(&sample);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidStringReference, status.error());
+
+  // References must name a defined string.
+  std::vector<std::uint8_t> dangling{
+      static_cast<std::uint8_t>(EncodingByte::StringReference), 0x03};
+  InternedString value;
+  Deserializer<Reader> deserializer{dangling.data(), dangling.size()};
+  status = deserializer.Read(&value);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidStringReference, status.error());
+}
+
+TEST(InternedString, SkipValue) {
+  Serializer<Writer> serializer;
+  ASSERT_TRUE(serializer.Write(Sample{"host", "host", 1}));
+  ASSERT_TRUE(serializer.Write(std::vector<Sample>{{"host", "cpu", 2}}));
+  ASSERT_TRUE(serializer.Write(std::string{"end"}));
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+
+  // Definitions and references are skipped like any other value.
+  BufferReader reader{bytes.data(), bytes.size()};
+  ASSERT_TRUE(SkipValue(&reader));
+  ASSERT_TRUE(SkipValue(&reader));
+
+  std::string end;
+  Deserializer<BufferReader*> deserializer{&reader};
+  ASSERT_TRUE(deserializer.Read(&end));
+  EXPECT_EQ("end", end);
+  EXPECT_TRUE(reader.empty());
+}
+
+TEST(InternedString, SkippedEntry) {
+  RegionSampleTable table;
+  table.host = InternedString{"host-0.example.com"};
+  table.region = InternedString{"us-east"};
+
+  Serializer<Writer> serializer;
+  ASSERT_TRUE(serializer.Write(table));
+  ASSERT_TRUE(serializer.Write(Sample{"us-east", "cpu", 1}));
+  ASSERT_TRUE(serializer.Write(Sample{"host-0.example.com", "us-east", 2}));
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+
+  // The definition in the unknown entry is registered while it is skipped, so
+  // the references that follow resolve to the right strings.
+  Deserializer<Reader> deserializer{bytes.data(), bytes.size()};
+  SampleTable decoded;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  ASSERT_TRUE(decoded.host);
+  EXPECT_FALSE(decoded.samples);
+  EXPECT_EQ(2u, deserializer.reader().dictionary().size());
+
+  Sample sample;
+  ASSERT_TRUE(deserializer.Read(&sample));
+  EXPECT_EQ("us-east", sample.host.get());
+  EXPECT_EQ("cpu", sample.metric.get());
+  ASSERT_TRUE(deserializer.Read(&sample));
+  EXPECT_EQ("host-0.example.com", sample.host.get());
+  EXPECT_EQ("us-east", sample.metric.get());
+}
+
+TEST(InternedString, LazyAndCached) {
+  Serializer<Writer> serializer;
+  ASSERT_TRUE(serializer.Write(Sample{"host", "cpu", 1}));
+  ASSERT_TRUE(serializer.Write(Sample{"host", "cpu", 2}));
+  ASSERT_TRUE(serializer.Write(Sample{"host", "cpu", 3}));
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+
+  Deserializer<Reader> deserializer{bytes.data(), bytes.size()};
+  Lazy<Sample> lazy;
+  ASSERT_TRUE(deserializer.Read(&lazy));
+  Cached<Sample> cached;
+  ASSERT_TRUE(deserializer.Read(&cached));
+  Sample sample;
+  ASSERT_TRUE(deserializer.Read(&sample));
+  EXPECT_EQ("host", sample.host.get());
+  EXPECT_EQ(3, sample.value);
+
+  // Values read with a dictionary are decoded at once.
+  EXPECT_TRUE(lazy.is_decoded());
+  auto lazy_sample = lazy.get();
+  ASSERT_TRUE(lazy_sample);
+  EXPECT_EQ("host", lazy_sample.get()->host.get());
+  EXPECT_EQ("cpu", lazy_sample.get()->metric.get());
+
+  // Cached values retain an encoding that stands on its own.
+  EXPECT_EQ("host", cached.get().host.get());
+  Serializer<VectorWriter> plain_serializer;
+  ASSERT_TRUE(plain_serializer.Write(cached));
+  const std::vector<std::uint8_t>& plain = plain_serializer.writer().data();
+  Deserializer<BufferReader> plain_deserializer{plain.data(), plain.size()};
+  ASSERT_TRUE(plain_deserializer.Read(&sample));
+  EXPECT_EQ("host", sample.host.get());
+  EXPECT_EQ("cpu", sample.metric.get());
+  EXPECT_EQ(2, sample.value);
+}
+
+TEST(InternedString, IndexedArray) {
+  const IndexedArray<InternedString> value{{"aaaa", "aaaa", "bbbb"}};
+  Serializer<Writer> serializer;
+  ASSERT_TRUE(serializer.Write(value));
+
+  // The offsets give where the definitions and reference were written rather
+  // than the computed sizes of the strings.
+  const std::uint8_t kSDF =
+      static_cast<std::uint8_t>(EncodingByte::StringDefinition);
+  const std::uint8_t kSRF =
+      static_cast<std::uint8_t>(EncodingByte::StringReference);
+  const std::vector<std::uint8_t> expected{
+      static_cast<std::uint8_t>(EncodingByte::IndexedArray), 3,
+      static_cast<std::uint8_t>(EncodingByte::Binary), 12,
+      0, 0, 0, 0, 6, 0, 0, 0, 8, 0, 0, 0,
+      kSDF, 4, 'a', 'a', 'a', 'a', kSRF, 0, kSDF, 4, 'b', 'b', 'b', 'b'};
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+  EXPECT_EQ(expected, bytes);
+
+  Deserializer<Reader> deserializer{bytes.data(), bytes.size()};
+  IndexedArray<InternedString> decoded;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(value.get(), decoded.get());
+
+  // Seeking walks the skipped elements to find their definitions.
+  Reader reader{bytes.data(), bytes.size()};
+  ArrayCursor<InternedString> cursor;
+  ASSERT_TRUE(cursor.Begin(&reader));
+  ASSERT_TRUE(cursor.Seek(2, &reader));
+  InternedString last;
+  ASSERT_TRUE(cursor.Next(&last, &reader));
+  EXPECT_EQ("bbbb", last.get());
+  EXPECT_EQ(2u, reader.dictionary().size());
+}
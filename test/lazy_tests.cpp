@@ -0,0 +1,222 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/lazy.h>
+#include <nop/types/optional.h>
+#include <nop/types/variant.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Decode;
+using nop::Deserializer;
+using nop::Encode;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::Lazy;
+using nop::Optional;
+using nop::PedanticBufferReader;
+using nop::Serializer;
+using nop::SkipValue;
+using nop::Status;
+using nop::Variant;
+using nop::VectorWriter;
+
+namespace {
+
+struct Record {
+  int id;
+  std::string name;
+  std::map<std::string, int> attributes;
+
+  bool operator==(const Record& other) const {
+    return id == other.id && name == other.name &&
+           attributes == other.attributes;
+  }
+
+  NOP_STRUCTURE(Record, id, name, attributes);
+};
+
+struct LazyEnvelope {
+  std::string destination;
+  Lazy<std::vector<Record>> records;
+
+  NOP_STRUCTURE(LazyEnvelope, destination, records);
+};
+
+struct Envelope {
+  std::string destination;
+  std::vector<Record> records;
+
+  NOP_STRUCTURE(Envelope, destination, records);
+};
+
+struct LazyTable {
+  Entry<int, 0> version;
+  Entry<Lazy<std::vector<Record>>, 1> records;
+
+  NOP_TABLE_NS("LazyTable", LazyTable, version, records);
+};
+
+std::vector<Record> MakeRecords() {
+  return {{1, "one", {{"a", 1}, {"b", 2}}},
+          {-2, "two", {}},
+          {300000, std::string(100, 'x'), {{"c", -70000}}}};
+}
+
+}  // anonymous namespace
+
+TEST(Lazy, Basic) {
+  Lazy<std::vector<Record>> empty;
+  EXPECT_TRUE(empty.is_decoded());
+  EXPECT_TRUE(empty.encoding().empty());
+  ASSERT_TRUE(empty.get());
+  EXPECT_TRUE(empty.get().get()->empty());
+
+  Lazy<std::vector<Record>> value{MakeRecords()};
+  EXPECT_TRUE(value.is_decoded());
+  EXPECT_EQ(MakeRecords(), *value.get().get());
+  EXPECT_EQ(Encode(MakeRecords()), Encode(value));
+
+  value = std::vector<Record>{};
+  EXPECT_TRUE(value.get().get()->empty());
+}
+
+TEST(Lazy, DecodeOnAccess) {
+  const std::vector<std::uint8_t> bytes =
+      Encode(Envelope{"somewhere", MakeRecords()});
+
+  LazyEnvelope envelope;
+  ASSERT_TRUE(Decode(bytes, &envelope));
+  EXPECT_EQ("somewhere", envelope.destination);
+  EXPECT_FALSE(envelope.records.is_decoded());
+  EXPECT_FALSE(envelope.records.encoding().empty());
+
+  // Passing the value through writes the original bytes.
+  EXPECT_EQ(bytes, Encode(envelope));
+
+  auto records = envelope.records.get();
+  ASSERT_TRUE(records);
+  EXPECT_TRUE(envelope.records.is_decoded());
+  EXPECT_EQ(MakeRecords(), *records.get());
+
+  // Reading the value keeps the original bytes.
+  EXPECT_FALSE(envelope.records.encoding().empty());
+  EXPECT_EQ(bytes, Encode(envelope));
+
+  // Modifying the value discards them.
+  auto mutable_records = envelope.records.mutable_get();
+  ASSERT_TRUE(mutable_records);
+  mutable_records.get()->pop_back();
+  EXPECT_TRUE(envelope.records.encoding().empty());
+
+  Envelope decoded;
+  ASSERT_TRUE(Decode(Encode(envelope), &decoded));
+  std::vector<Record> expected = MakeRecords();
+  expected.pop_back();
+  EXPECT_EQ(expected, decoded.records);
+}
+
+TEST(Lazy, Table) {
+  LazyTable table;
+  table.version = 3;
+  table.records = Lazy<std::vector<Record>>{MakeRecords()};
+  const std::vector<std::uint8_t> bytes = Encode(table);
+
+  LazyTable decoded;
+  ASSERT_TRUE(Decode(bytes, &decoded));
+  ASSERT_TRUE(decoded.version);
+  EXPECT_EQ(3, decoded.version.get());
+  ASSERT_TRUE(decoded.records);
+  EXPECT_FALSE(decoded.records.get().is_decoded());
+  EXPECT_EQ(bytes, Encode(decoded));
+
+  auto records = decoded.records.get().get();
+  ASSERT_TRUE(records);
+  EXPECT_EQ(MakeRecords(), *records.get());
+}
+
+TEST(Lazy, Errors) {
+  // The wrapped type determines which encodings are accepted.
+  Lazy<std::vector<Record>> value;
+  Status<void> status = Decode(Encode(std::string{"records"}), &value);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+
+  // Structurally valid encodings may still fail to decode on access.
+  std::vector<std::vector<int>> wrong_records{{1, 2}, {3}};
+  ASSERT_TRUE(Decode(Encode(wrong_records), &value));
+  auto records = value.get();
+  ASSERT_FALSE(records);
+  EXPECT_FALSE(value.is_decoded());
+
+  // Truncated input is rejected while skipping.
+  std::vector<std::uint8_t> bytes = Encode(MakeRecords());
+  bytes.pop_back();
+  Deserializer<PedanticBufferReader> deserializer{bytes.data(), bytes.size()};
+  status = deserializer.Read(&value);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
+
+TEST(Lazy, SkipValue) {
+  LazyTable table;
+  table.version = 1;
+  table.records = Lazy<std::vector<Record>>{MakeRecords()};
+
+  VectorWriter writer;
+  Serializer<VectorWriter*> serializer{&writer};
+  ASSERT_TRUE(serializer.Write(-1));
+  ASSERT_TRUE(serializer.Write(1.5));
+  ASSERT_TRUE(serializer.Write(Optional<int>{}));
+  ASSERT_TRUE(serializer.Write(Variant<int, std::string>{"variant"}));
+  ASSERT_TRUE(serializer.Write(std::vector<std::uint32_t>{1, 2, 3}));
+  ASSERT_TRUE(serializer.Write(MakeRecords()));
+  ASSERT_TRUE(serializer.Write(table));
+  ASSERT_TRUE(serializer.Write(std::string{"end"}));
+
+  PedanticBufferReader reader{writer.data().data(), writer.size()};
+  for (int i = 0; i < 7; i++)
+    ASSERT_TRUE(SkipValue(&reader)) << "value " << i;
+
+  std::string end;
+  Deserializer<PedanticBufferReader*> deserializer{&reader};
+  ASSERT_TRUE(deserializer.Read(&end));
+  EXPECT_EQ("end", end);
+  EXPECT_TRUE(reader.empty());
+
+  // Deeply nested input is rejected instead of recursing without bound.
+  std::vector<std::uint8_t> nested;
+  for (int i = 0; i < 1000; i++) {
+    nested.push_back(0xba);  // Array.
+    nested.push_back(0x01);  // One element.
+  }
+  nested.push_back(0x00);
+  PedanticBufferReader nested_reader{nested.data(), nested.size()};
+  Status<void> status = SkipValue(&nested_reader);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+}
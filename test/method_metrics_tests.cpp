@@ -0,0 +1,233 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/rpc/interface.h>
+#include <nop/rpc/method_metrics.h>
+#include <nop/rpc/simple_method_receiver.h>
+#include <nop/rpc/simple_method_sender.h>
+#include <nop/serializer.h>
+
+#include "test_reader.h"
+#include "test_utilities.h"
+#include "test_writer.h"
+
+using nop::BindInterface;
+using nop::Compose;
+using nop::Deserializer;
+using nop::EncodingByte;
+using nop::ErrorStatus;
+using nop::Integer;
+using nop::Interface;
+using nop::LatencyHistogram;
+using nop::MakeInstrumentedReceiver;
+using nop::MakeInstrumentedSender;
+using nop::MakeSimpleMethodReceiver;
+using nop::MakeSimpleMethodSender;
+using nop::MethodMetrics;
+using nop::MethodStatistics;
+using nop::Serializer;
+using nop::TestReader;
+using nop::TestWriter;
+
+namespace {
+
+struct Calculator : Interface<Calculator> {
+  NOP_INTERFACE("io.github.eieio.Calculator");
+
+  NOP_METHOD(Sum, int(int a, int b));
+  NOP_METHOD(Concat, std::string(const std::string& a, const std::string& b));
+
+  NOP_INTERFACE_API(Sum, Concat);
+};
+
+using Selector = nop::InterfaceType<Calculator>::MethodSelector;
+
+}  // anonymous namespace
+
+TEST(LatencyHistogram, Buckets) {
+  // Small values have exact buckets.
+  for (std::uint64_t value = 0; value < 16; value++) {
+    EXPECT_EQ(value, LatencyHistogram::BucketIndex(value));
+    EXPECT_EQ(value, LatencyHistogram::BucketLowerBound(value));
+    EXPECT_EQ(value, LatencyHistogram::BucketUpperBound(value));
+  }
+
+  // Larger values share buckets that span at most 1/8 of their lower bound.
+  for (std::uint64_t value : {16u, 17u, 31u, 32u, 1000u, 123456789u}) {
+    const std::size_t index = LatencyHistogram::BucketIndex(value);
+    const std::uint64_t lower = LatencyHistogram::BucketLowerBound(index);
+    const std::uint64_t upper = LatencyHistogram::BucketUpperBound(index);
+    EXPECT_LE(lower, value);
+    EXPECT_GE(upper, value);
+    EXPECT_LE(upper - lower + 1, lower / 8 + 1) << value;
+    EXPECT_EQ(index + 1, LatencyHistogram::BucketIndex(upper + 1));
+  }
+
+  // Out of range values are counted in the last bucket.
+  EXPECT_EQ(LatencyHistogram::kBucketCount - 1,
+            LatencyHistogram::BucketIndex(~std::uint64_t{0}));
+}
+
+TEST(LatencyHistogram, Percentile) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0u, histogram.Percentile(0.5));
+
+  for (std::uint64_t value = 1; value <= 100; value++)
+    histogram.Record(value * 1000);
+
+  EXPECT_EQ(100u, histogram.count());
+  EXPECT_EQ(100000u, histogram.max());
+  EXPECT_DOUBLE_EQ(50500.0, histogram.mean());
+  EXPECT_EQ(100000u, histogram.Percentile(1.0));
+
+  const std::uint64_t median = histogram.Percentile(0.5);
+  EXPECT_GE(median, 50000u);
+  EXPECT_LE(median, 50000u + 50000u / 8);
+
+  LatencyHistogram other;
+  other.Record(5);
+  histogram.Merge(other);
+  EXPECT_EQ(101u, histogram.count());
+  EXPECT_EQ(5u, histogram.Percentile(0.0));
+}
+
+TEST(MethodMetrics, Dispatch) {
+  TestReader reader;
+  TestWriter writer;
+  Deserializer<TestReader*> deserializer{&reader};
+  Serializer<TestWriter*> serializer{&writer};
+  auto simple_receiver = MakeSimpleMethodReceiver(&serializer, &deserializer);
+
+  MethodMetrics metrics;
+  metrics.RegisterInterface<Calculator>();
+  auto receiver = MakeInstrumentedReceiver(&simple_receiver, &metrics);
+
+  auto bindings = BindInterface(
+      Calculator::Sum::Bind([](int a, int b) { return a + b; }),
+      Calculator::Concat::Bind(
+          [](const std::string& a, const std::string& b) { return a + b; }));
+
+  for (int i = 0; i < 3; i++) {
+    reader.Set(Compose(EncodingByte::U64,
+                       Integer<Selector>(Calculator::Sum::Selector),
+                       EncodingByte::Array, 2, 10, 20));
+    ASSERT_TRUE(bindings(&receiver));
+    EXPECT_EQ(Compose(30), writer.data());
+    writer.clear();
+  }
+
+  // Arguments that fail to decode are counted as errors.
+  reader.Set(Compose(EncodingByte::U64,
+                     Integer<Selector>(Calculator::Concat::Selector),
+                     EncodingByte::Array, 2, 10));
+  auto status = bindings(&receiver);
+  ASSERT_FALSE(status);
+
+  const auto snapshot = metrics.Snapshot();
+  ASSERT_EQ(2u, snapshot.methods.size());
+
+  const MethodStatistics* sum = snapshot.Find("Sum");
+  ASSERT_NE(nullptr, sum);
+  EXPECT_EQ(Calculator::Sum::Selector, sum->selector);
+  EXPECT_EQ(3u, sum->calls);
+  EXPECT_EQ(0u, sum->errors);
+  EXPECT_EQ(3u * 4u, sum->argument_bytes);
+  EXPECT_EQ(3u, sum->return_bytes);
+  EXPECT_EQ(3u, sum->decode.count());
+  EXPECT_EQ(3u, sum->handler.count());
+  EXPECT_EQ(3u, sum->encode.count());
+  EXPECT_EQ(0u, sum->round_trip.count());
+
+  const MethodStatistics* concat = snapshot.Find(Calculator::Concat::Selector);
+  ASSERT_NE(nullptr, concat);
+  EXPECT_EQ("Concat", concat->name);
+  EXPECT_EQ(1u, concat->calls);
+  EXPECT_EQ(1u, concat->errors);
+  EXPECT_EQ(0u, concat->decode.count());
+}
+
+TEST(MethodMetrics, Send) {
+  TestReader reader;
+  TestWriter writer;
+  Deserializer<TestReader*> deserializer{&reader};
+  Serializer<TestWriter*> serializer{&writer};
+  auto simple_sender = MakeSimpleMethodSender(&serializer, &deserializer);
+
+  MethodMetrics metrics;
+  auto sender = MakeInstrumentedSender(&simple_sender, &metrics);
+
+  reader.Set(Compose(EncodingByte::String, 6, "foobar"));
+  auto result = Calculator::Concat::Invoke(&sender, "foo", "bar");
+  ASSERT_TRUE(result);
+  EXPECT_EQ("foobar", result.get());
+
+  // A truncated return value is counted as an error.
+  reader.Set(Compose(EncodingByte::String, 6, "foo"));
+  result = Calculator::Concat::Invoke(&sender, "foo", "bar");
+  ASSERT_FALSE(result);
+
+  const auto snapshot = metrics.Snapshot();
+  ASSERT_EQ(1u, snapshot.methods.size());
+  const MethodStatistics& concat = snapshot.methods[0];
+  EXPECT_EQ(Calculator::Concat::Selector, concat.selector);
+  EXPECT_EQ("", concat.name);
+  EXPECT_EQ(2u, concat.calls);
+  EXPECT_EQ(1u, concat.errors);
+  EXPECT_EQ(2u * 12u, concat.argument_bytes);
+  EXPECT_EQ(8u, concat.return_bytes);
+  EXPECT_EQ(2u, concat.round_trip.count());
+  EXPECT_EQ(0u, concat.handler.count());
+}
+
+TEST(MethodMetrics, Threads) {
+  MethodMetrics metrics;
+  const std::size_t kThreads = 4;
+  const std::size_t kCalls = 1000;
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < kThreads; i++) {
+    threads.emplace_back([&metrics, i] {
+      for (std::size_t j = 0; j < kCalls; j++)
+        metrics.RecordSend(1 + j % 2, true, 4, 1, 100 * (i + 1));
+    });
+  }
+
+  // Snapshots may be taken while other threads record.
+  for (int i = 0; i < 10; i++) {
+    const auto snapshot = metrics.Snapshot();
+    for (const auto& method : snapshot.methods)
+      EXPECT_LE(method.calls, kThreads * kCalls / 2);
+  }
+
+  for (auto& thread : threads)
+    thread.join();
+
+  const auto snapshot = metrics.Snapshot();
+  ASSERT_EQ(2u, snapshot.methods.size());
+  for (const auto& method : snapshot.methods) {
+    EXPECT_EQ(kThreads * kCalls / 2, method.calls);
+    EXPECT_EQ(kThreads * kCalls / 2 * 4, method.argument_bytes);
+    EXPECT_EQ(kThreads * kCalls / 2, method.round_trip.count());
+    EXPECT_EQ(400u, method.round_trip.max());
+  }
+}
@@ -0,0 +1,180 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <nop/base/skip.h>
+#include <nop/serializer.h>
+#include <nop/types/packed.h>
+#include <nop/utility/bit_packing.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BitWidth;
+using nop::Compose;
+using nop::Decode;
+using nop::Encode;
+using nop::EncodingByte;
+using nop::ErrorStatus;
+using nop::Integer;
+using nop::PackBits;
+using nop::Packed;
+using nop::PackedSize;
+using nop::PedanticBufferReader;
+using nop::SkipValue;
+using nop::Status;
+using nop::UnpackBits;
+using nop::ZigZagDecode;
+using nop::ZigZagEncode;
+
+namespace {
+
+template <typename T>
+void ExpectRoundTrip(const std::vector<T>& value) {
+  const std::vector<std::uint8_t> bytes = Encode(Packed<T>{value});
+  EXPECT_EQ(bytes.size(), nop::Encoding<Packed<T>>::Size(Packed<T>{value}));
+
+  // Packed arrays decode as plain vectors and as Packed<T>.
+  std::vector<T> decoded{1, 2, 3};
+  ASSERT_TRUE(Decode<PedanticBufferReader>(bytes, &decoded));
+  EXPECT_EQ(value, decoded);
+
+  Packed<T> packed;
+  ASSERT_TRUE(Decode<PedanticBufferReader>(bytes, &packed));
+  EXPECT_EQ(value, packed.get());
+
+  PedanticBufferReader reader{bytes.data(), bytes.size()};
+  ASSERT_TRUE(SkipValue(&reader));
+  EXPECT_TRUE(reader.empty());
+}
+
+}  // anonymous namespace
+
+TEST(Packed, BitPacking) {
+  EXPECT_EQ(0u, ZigZagEncode(0));
+  EXPECT_EQ(1u, ZigZagEncode(-1));
+  EXPECT_EQ(2u, ZigZagEncode(1));
+  EXPECT_EQ(std::numeric_limits<std::uint64_t>::max(),
+            ZigZagEncode(std::numeric_limits<std::int64_t>::min()));
+  for (std::int64_t value : {std::int64_t{0}, std::int64_t{-5},
+                             std::int64_t{123456789},
+                             std::numeric_limits<std::int64_t>::max(),
+                             std::numeric_limits<std::int64_t>::min()}) {
+    EXPECT_EQ(value, ZigZagDecode(ZigZagEncode(value)));
+  }
+
+  EXPECT_EQ(0u, BitWidth(0));
+  EXPECT_EQ(1u, BitWidth(1));
+  EXPECT_EQ(8u, BitWidth(255));
+  EXPECT_EQ(64u, BitWidth(~std::uint64_t{0}));
+
+  // Every width round trips, including values that straddle nine bytes.
+  for (std::size_t width = 0; width <= 64; width++) {
+    std::vector<std::uint64_t> values;
+    for (std::uint64_t i = 0; i < 37; i++)
+      values.push_back((i * 0x9e3779b97f4a7c15) & nop::LowBitMask(width));
+
+    std::vector<std::uint8_t> data(PackedSize(values.size(), width) + 8);
+    PackBits(values.data(), values.size(), width, data.data());
+
+    std::vector<std::uint64_t> unpacked(values.size());
+    UnpackBits(data.data(), values.size(), width, unpacked.data());
+    EXPECT_EQ(values, unpacked) << "width " << width;
+  }
+
+  // Bits are packed least significant first.
+  const std::uint64_t values[] = {1, 2, 3};
+  std::uint8_t data[2] = {};
+  PackBits(values, 3, 3, data);
+  EXPECT_EQ(0xd1, data[0]);
+  EXPECT_EQ(0x00, data[1]);
+}
+
+TEST(Packed, Format) {
+  EXPECT_EQ(Compose(EncodingByte::PackedArray, 0, 0, EncodingByte::Binary, 0),
+            Encode(Packed<std::uint64_t>{}));
+
+  // Deltas 1, 1, -3 zigzag to 2, 2, 5, packed three bits each.
+  EXPECT_EQ(Compose(EncodingByte::PackedArray, 4, 10, EncodingByte::Binary, 3,
+                    3, 0x52, 0x01),
+            Encode(Packed<std::uint32_t>{{10, 11, 12, 9}}));
+}
+
+TEST(Packed, RoundTrip) {
+  ExpectRoundTrip(std::vector<std::uint64_t>{});
+  ExpectRoundTrip(std::vector<std::uint64_t>{42});
+  ExpectRoundTrip(std::vector<std::int8_t>{-128, 127, 0, -1, 1, -128});
+  ExpectRoundTrip(std::vector<std::uint64_t>{
+      0, std::numeric_limits<std::uint64_t>::max(), 1,
+      std::numeric_limits<std::uint64_t>::max() / 2});
+  ExpectRoundTrip(std::vector<std::int64_t>{
+      std::numeric_limits<std::int64_t>::min(),
+      std::numeric_limits<std::int64_t>::max(), -1});
+
+  // Timestamps a second apart pack into 11 bits per element instead of 64.
+  std::vector<std::uint64_t> timestamps;
+  for (std::uint64_t i = 0; i < 1000; i++)
+    timestamps.push_back(1500000000000 + i * 1000 + (i % 3));
+  ExpectRoundTrip(timestamps);
+
+  const std::size_t packed_size =
+      Encode(Packed<std::uint64_t>{timestamps}).size();
+  EXPECT_LT(packed_size, Encode(timestamps).size() / 5);
+}
+
+TEST(Packed, Errors) {
+  std::vector<std::uint32_t> decoded;
+
+  // Values out of range of the element type are rejected.
+  Status<void> status = Decode<PedanticBufferReader>(
+      Encode(Packed<std::uint64_t>{{1, 1ull << 40}}), &decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+
+  // Counts that the blocks cannot hold are rejected before allocating.
+  std::vector<std::uint8_t> bytes =
+      Compose(EncodingByte::PackedArray, EncodingByte::U32,
+              Integer<std::uint32_t>(0x7fffffff), 0, EncodingByte::Binary, 1,
+              0);
+  status = Decode<PedanticBufferReader>(bytes, &decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+
+  // Widths above 64 bits and leftover bytes are invalid.
+  bytes = Compose(EncodingByte::PackedArray, 2, 0, EncodingByte::Binary, 2,
+                  65, 0);
+  status = Decode<PedanticBufferReader>(bytes, &decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+
+  bytes = Compose(EncodingByte::PackedArray, 2, 0, EncodingByte::Binary, 3,
+                  1, 1, 0);
+  status = Decode<PedanticBufferReader>(bytes, &decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+
+  // Truncated input fails in the reader.
+  bytes = Encode(Packed<std::uint32_t>{{1, 2, 3, 4}});
+  bytes.pop_back();
+  status = Decode<PedanticBufferReader>(bytes, &decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
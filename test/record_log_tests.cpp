@@ -0,0 +1,309 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/structure.h>
+#include <nop/utility/record_log_reader.h>
+#include <nop/utility/record_log_writer.h>
+
+using nop::ErrorStatus;
+using nop::RecordLogCursor;
+using nop::RecordLogReader;
+using nop::RecordLogWriter;
+using nop::Status;
+
+namespace {
+
+struct Message {
+  int id;
+  std::string text;
+
+  NOP_STRUCTURE(Message, id, text);
+};
+
+// Creates an unlinked temporary file, returning its fd.
+int MakeTempFile() {
+  char path[] = "/tmp/nop_record_log_XXXXXX";
+  const int fd = ::mkstemp(path);
+  if (fd >= 0)
+    ::unlink(path);
+  return fd;
+}
+
+std::string MakeKey(int id) {
+  std::string key = std::to_string(id);
+  return std::string(6 - key.size(), '0') + key;
+}
+
+// Appends |count| keyed messages with a commit every |commit_interval| records.
+void WriteMessages(RecordLogWriter* log, int count, int commit_interval) {
+  for (int i = 0; i < count; i++) {
+    auto record = log->Append(MakeKey(i), Message{i, "message"});
+    ASSERT_TRUE(record);
+    EXPECT_EQ(static_cast<std::uint64_t>(i), record.get());
+    if ((i + 1) % commit_interval == 0) {
+      ASSERT_TRUE(log->Commit());
+    }
+  }
+  ASSERT_TRUE(log->Commit());
+}
+
+}  // anonymous namespace
+
+TEST(RecordLog, WriteRead) {
+  const int fd = MakeTempFile();
+  ASSERT_LE(0, fd);
+
+  RecordLogWriter writer{fd, 256};
+  WriteMessages(&writer, 1000, 100);
+  EXPECT_EQ(1000u, writer.committed_count());
+  ASSERT_TRUE(writer.Close());
+
+  Status<std::uint64_t> status = writer.Append(Message{});
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, status.error());
+
+  RecordLogReader log;
+  ASSERT_TRUE(log.Open(fd));
+  ::close(fd);
+  EXPECT_FALSE(log.recovered());
+  EXPECT_EQ(1000u, log.record_count());
+  EXPECT_LT(10u, log.index().size());
+
+  RecordLogCursor cursor{&log};
+  for (int i = 0; i < 1000; i++) {
+    std::string key;
+    Message message;
+    ASSERT_TRUE(cursor.Next(&key, &message)) << i;
+    EXPECT_EQ(MakeKey(i), key);
+    EXPECT_EQ(i, message.id);
+    EXPECT_EQ("message", message.text);
+  }
+  EXPECT_TRUE(cursor.done());
+
+  Message message;
+  Status<void> next = cursor.Next(&message);
+  ASSERT_FALSE(next);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, next.error());
+}
+
+TEST(RecordLog, Seek) {
+  const int fd = MakeTempFile();
+  ASSERT_LE(0, fd);
+
+  RecordLogWriter writer{fd, 256};
+  WriteMessages(&writer, 1000, 1000);
+  ASSERT_TRUE(writer.Close());
+
+  RecordLogReader log;
+  ASSERT_TRUE(log.Open(fd));
+  ::close(fd);
+
+  RecordLogCursor cursor{&log};
+  Message message;
+  ASSERT_TRUE(cursor.Seek(500));
+  EXPECT_EQ(500u, cursor.position());
+  ASSERT_TRUE(cursor.Next(&message));
+  EXPECT_EQ(500, message.id);
+
+  // Seeking backwards and to the start of a block.
+  const std::uint64_t block_start = log.index()[3].record;
+  ASSERT_TRUE(cursor.Seek(block_start));
+  ASSERT_TRUE(cursor.Next(&message));
+  EXPECT_EQ(static_cast<int>(block_start), message.id);
+
+  ASSERT_TRUE(cursor.Seek(999));
+  ASSERT_TRUE(cursor.Next(&message));
+  EXPECT_EQ(999, message.id);
+  EXPECT_TRUE(cursor.done());
+
+  ASSERT_TRUE(cursor.Seek(1000));
+  EXPECT_TRUE(cursor.done());
+  Status<void> status = cursor.Seek(1001);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+
+  // Keys seek to the first record not less than the key.
+  std::string key;
+  ASSERT_TRUE(cursor.SeekKey(MakeKey(737)));
+  EXPECT_EQ(737u, cursor.position());
+  ASSERT_TRUE(cursor.Next(&key, &message));
+  EXPECT_EQ(MakeKey(737), key);
+  EXPECT_EQ(737, message.id);
+
+  ASSERT_TRUE(cursor.SeekKey(MakeKey(block_start)));
+  EXPECT_EQ(block_start, cursor.position());
+  ASSERT_TRUE(cursor.SeekKey(MakeKey(42) + "x"));
+  EXPECT_EQ(43u, cursor.position());
+  ASSERT_TRUE(cursor.SeekKey(""));
+  EXPECT_EQ(0u, cursor.position());
+  ASSERT_TRUE(cursor.SeekKey("z"));
+  EXPECT_TRUE(cursor.done());
+}
+
+TEST(RecordLog, LargeRecords) {
+  const int fd = MakeTempFile();
+  ASSERT_LE(0, fd);
+
+  RecordLogWriter writer{fd, 256};
+  ASSERT_TRUE(writer.Append(Message{1, "small"}));
+  ASSERT_TRUE(writer.Append(Message{2, std::string(1000, 'x')}));
+  ASSERT_TRUE(writer.Append(Message{3, "small"}));
+  ASSERT_TRUE(writer.Close());
+
+  RecordLogReader log;
+  ASSERT_TRUE(log.Open(fd));
+  ::close(fd);
+  ASSERT_EQ(3u, log.index().size());
+  EXPECT_EQ(256u, log.index()[1].offset);
+  EXPECT_EQ(256u + 1280u, log.index()[2].offset);
+
+  RecordLogCursor cursor{&log};
+  Message message;
+  ASSERT_TRUE(cursor.Seek(1));
+  ASSERT_TRUE(cursor.Next(&message));
+  EXPECT_EQ(std::string(1000, 'x'), message.text);
+  ASSERT_TRUE(cursor.Next(&message));
+  EXPECT_EQ(3, message.id);
+}
+
+TEST(RecordLog, Recovery) {
+  const int fd = MakeTempFile();
+  ASSERT_LE(0, fd);
+
+  // Blocks are written by each commit; the log is never closed.
+  RecordLogWriter writer{fd, 256};
+  WriteMessages(&writer, 100, 10);
+  ASSERT_TRUE(writer.Append(MakeKey(100), Message{100, "uncommitted"}));
+
+  RecordLogReader log;
+  ASSERT_TRUE(log.Open(fd));
+  EXPECT_TRUE(log.recovered());
+  EXPECT_EQ(100u, log.record_count());
+
+  RecordLogCursor cursor{&log};
+  Message message;
+  ASSERT_TRUE(cursor.SeekKey(MakeKey(55)));
+  ASSERT_TRUE(cursor.Next(&message));
+  EXPECT_EQ(55, message.id);
+
+  // A torn write of the last block loses only that block.
+  const std::uint64_t last_block = log.index().back().offset;
+  const std::uint64_t last_record = log.index().back().record;
+  ASSERT_EQ(0, ::ftruncate(fd, last_block + 100));
+  ASSERT_TRUE(log.Open(fd));
+  EXPECT_TRUE(log.recovered());
+  EXPECT_EQ(last_record, log.record_count());
+
+  // Corruption within a block is reported when the cursor reaches it.
+  const std::uint8_t byte = 0xff;
+  ASSERT_EQ(1, ::pwrite(fd, &byte, 1, log.index()[1].offset + 30));
+  ASSERT_TRUE(log.Open(fd));
+  ::close(fd);
+  EXPECT_EQ(log.index()[1].record, log.record_count());
+
+  cursor = RecordLogCursor{&log};
+  ASSERT_TRUE(cursor.Next(&message));
+  EXPECT_EQ(0, message.id);
+}
+
+TEST(RecordLog, Checksum) {
+  const int fd = MakeTempFile();
+  ASSERT_LE(0, fd);
+
+  RecordLogWriter writer{fd, 256};
+  WriteMessages(&writer, 100, 100);
+  ASSERT_TRUE(writer.Close());
+
+  RecordLogReader log;
+  ASSERT_TRUE(log.Open(fd));
+  const std::uint64_t offset = log.index()[2].offset;
+  const std::uint8_t byte = 0xff;
+  ASSERT_EQ(1, ::pwrite(fd, &byte, 1, offset + 30));
+
+  ASSERT_TRUE(log.Open(fd));
+  ::close(fd);
+  EXPECT_FALSE(log.recovered());
+
+  RecordLogCursor cursor{&log};
+  Status<void> status = cursor.Seek(log.index()[2].record);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ChecksumMismatch, status.error());
+
+  ASSERT_TRUE(cursor.Seek(log.index()[3].record));
+}
+
+TEST(RecordLog, KeyOrder) {
+  const int fd = MakeTempFile();
+  ASSERT_LE(0, fd);
+
+  RecordLogWriter writer{fd};
+  ASSERT_TRUE(writer.Append("b", Message{}));
+  ASSERT_TRUE(writer.Append("b", Message{}));
+  ASSERT_TRUE(writer.Append(Message{}));
+  Status<std::uint64_t> status = writer.Append("a", Message{});
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ProtocolError, status.error());
+  EXPECT_EQ(3u, writer.record_count());
+  ::close(fd);
+}
+
+TEST(RecordLog, GroupCommit) {
+  const int fd = MakeTempFile();
+  ASSERT_LE(0, fd);
+
+  const int kThreads = 4;
+  const int kRecords = 200;
+  RecordLogWriter writer{fd, 512};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&writer, i] {
+      for (int j = 0; j < kRecords; j++) {
+        EXPECT_TRUE(writer.Append(Message{i * kRecords + j, "thread"}));
+        EXPECT_TRUE(writer.Commit());
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  EXPECT_EQ(static_cast<std::uint64_t>(kThreads * kRecords),
+            writer.committed_count());
+  ASSERT_TRUE(writer.Close());
+
+  RecordLogReader log;
+  ASSERT_TRUE(log.Open(fd));
+  ::close(fd);
+  ASSERT_EQ(static_cast<std::uint64_t>(kThreads * kRecords),
+            log.record_count());
+
+  std::set<int> ids;
+  RecordLogCursor cursor{&log};
+  while (!cursor.done()) {
+    Message message;
+    ASSERT_TRUE(cursor.Next(&message));
+    ids.insert(message.id);
+  }
+  EXPECT_EQ(static_cast<std::size_t>(kThreads * kRecords), ids.size());
+}
@@ -0,0 +1,244 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/types/thread_local.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/huge_page_allocator.h>
+#include <nop/utility/scratch_pool.h>
+
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::HugePageAllocator;
+using nop::HugePageMode;
+using nop::ScratchBuffer;
+using nop::ScratchPool;
+using nop::ScratchPoolStats;
+using nop::ScratchTrimPolicy;
+using nop::ScratchWriter;
+using nop::Serializer;
+using nop::ThreadLocalIndexSlot;
+
+namespace {
+
+// Each test uses its own slot so that the pools start out empty.
+template <std::size_t Index>
+using Slot = ThreadLocalIndexSlot<1000 + Index>;
+
+}  // anonymous namespace
+
+TEST(ScratchPool, Reuse) {
+  using Pool = ScratchPool<Slot<0>>;
+  EXPECT_EQ(0u, Pool::idle_count());
+
+  const std::uint8_t* first = nullptr;
+  {
+    Serializer<ScratchWriter<Slot<0>>> serializer;
+    ASSERT_TRUE(serializer.Write(std::string(1000, 'x')));
+    first = serializer.writer().data().data();
+
+    std::string value;
+    Deserializer<BufferReader> deserializer{serializer.writer().data().data(),
+                                            serializer.writer().size()};
+    ASSERT_TRUE(deserializer.Read(&value));
+    EXPECT_EQ(std::string(1000, 'x'), value);
+  }
+  EXPECT_EQ(1u, Pool::idle_count());
+  EXPECT_LE(1000u, Pool::high_water_mark());
+
+  // The next writer picks up the same buffer, already large enough.
+  {
+    ScratchWriter<Slot<0>> writer;
+    EXPECT_EQ(0u, Pool::idle_count());
+    EXPECT_TRUE(writer.empty());
+    ASSERT_TRUE(writer.Prepare(1000));
+    EXPECT_EQ(first, writer.data().data());
+  }
+  EXPECT_EQ(1u, Pool::idle_count());
+
+  // Readers share the same buffers.
+  {
+    ScratchBuffer<Slot<0>> buffer{16};
+    EXPECT_EQ(0u, Pool::idle_count());
+    EXPECT_EQ(16u, buffer.size());
+    EXPECT_EQ(first, buffer.data());
+  }
+  EXPECT_EQ(1u, Pool::idle_count());
+
+  // Moving a writer transfers its buffer without returning it.
+  {
+    ScratchWriter<Slot<0>> writer;
+    ScratchWriter<Slot<0>> other{std::move(writer)};
+    EXPECT_EQ(0u, Pool::idle_count());
+    other.Release();
+    EXPECT_EQ(1u, Pool::idle_count());
+  }
+  EXPECT_EQ(1u, Pool::idle_count());
+
+  Pool::Trim();
+  EXPECT_EQ(0u, Pool::idle_count());
+  EXPECT_EQ(0u, Pool::high_water_mark());
+}
+
+TEST(ScratchPool, HighWaterMark) {
+  using Pool = ScratchPool<Slot<1>>;
+  {
+    ScratchBuffer<Slot<1>> small{100};
+    ScratchBuffer<Slot<1>> large{5000};
+  }
+  EXPECT_EQ(2u, Pool::idle_count());
+  EXPECT_LE(5000u, Pool::high_water_mark());
+
+  // Buffers allocated once the pool is empty start at the high-water mark.
+  ScratchBuffer<Slot<1>> a;
+  ScratchBuffer<Slot<1>> b;
+  ScratchWriter<Slot<1>> writer;
+  EXPECT_EQ(0u, Pool::idle_count());
+  EXPECT_LE(5000u, writer.data().capacity());
+}
+
+TEST(ScratchPool, TrimPolicy) {
+  using Pool = ScratchPool<Slot<2>>;
+  EXPECT_EQ(ScratchTrimPolicy::kDefaultMaxBuffers,
+            Pool::trim_policy().max_buffers);
+
+  ScratchTrimPolicy policy;
+  policy.max_buffers = 2;
+  policy.max_capacity = 1024;
+  Pool::SetTrimPolicy(policy);
+
+  // Oversized buffers are freed and cap the high-water mark.
+  { ScratchBuffer<Slot<2>> buffer{4096}; }
+  EXPECT_EQ(0u, Pool::idle_count());
+  EXPECT_EQ(1024u, Pool::high_water_mark());
+
+  // At most max_buffers are kept.
+  {
+    ScratchBuffer<Slot<2>> a{10};
+    ScratchBuffer<Slot<2>> b{10};
+    ScratchBuffer<Slot<2>> c{10};
+  }
+  EXPECT_EQ(2u, Pool::idle_count());
+
+  policy.max_buffers = 1;
+  Pool::SetTrimPolicy(policy);
+  EXPECT_EQ(1u, Pool::idle_count());
+}
+
+TEST(ScratchPool, Threads) {
+  using Pool = ScratchPool<Slot<3>>;
+  { ScratchBuffer<Slot<3>> buffer{64}; }
+  EXPECT_EQ(1u, Pool::idle_count());
+
+  // Every thread has its own pool.
+  std::size_t thread_count = 1;
+  std::thread thread{[&thread_count] {
+    thread_count = Pool::idle_count();
+    ScratchBuffer<Slot<3>> buffer{64};
+  }};
+  thread.join();
+  EXPECT_EQ(0u, thread_count);
+  EXPECT_EQ(1u, Pool::idle_count());
+}
+
+TEST(ScratchPool, Stats) {
+  using Pool = ScratchPool<Slot<4>>;
+  ScratchPoolStats stats = Pool::stats();
+  EXPECT_EQ(0u, stats.bytes_held);
+  EXPECT_EQ(0u, stats.acquire_count);
+  EXPECT_EQ(0.0, stats.reuse_rate());
+
+  { ScratchBuffer<Slot<4>> buffer{1000}; }
+  for (int i = 0; i < 3; i++) {
+    Serializer<ScratchWriter<Slot<4>>> serializer;
+    ASSERT_TRUE(serializer.Write(std::string(500, 'x')));
+  }
+
+  stats = Pool::stats();
+  EXPECT_LE(1000u, stats.bytes_held);
+  EXPECT_EQ(Pool::high_water_mark(), stats.high_water_mark);
+  EXPECT_EQ(4u, stats.acquire_count);
+  EXPECT_EQ(3u, stats.reuse_count);
+  EXPECT_EQ(0.75, stats.reuse_rate());
+
+  Pool::ResetStats();
+  stats = Pool::stats();
+  EXPECT_EQ(0u, stats.acquire_count);
+  EXPECT_EQ(0u, stats.reuse_count);
+  EXPECT_LE(1000u, stats.bytes_held);
+
+  Pool::Trim();
+  EXPECT_EQ(0u, Pool::stats().bytes_held);
+}
+
+TEST(ScratchPool, HugePages) {
+  using Allocator = HugePageAllocator<std::uint8_t>;
+  using Pool = ScratchPool<Slot<5>, Allocator>;
+  enum : std::size_t { kSize = Allocator::kHugePageSize + 1 };
+
+  // Buffers with a different allocator come from a distinct pool.
+  { ScratchBuffer<Slot<5>> buffer{16}; }
+  EXPECT_EQ(0u, Pool::idle_count());
+
+  ScratchTrimPolicy policy;
+  policy.max_capacity = 4 * Allocator::kHugePageSize;
+  Pool::SetTrimPolicy(policy);
+
+  const std::uint8_t* first = nullptr;
+  {
+    Serializer<ScratchWriter<Slot<5>, Allocator>> serializer;
+    ASSERT_TRUE(serializer.Write(std::string(kSize, 'x')));
+    first = serializer.writer().data().data();
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(first) %
+                      Allocator::kHugePageSize);
+
+    std::string value;
+    Deserializer<BufferReader> deserializer{serializer.writer().data().data(),
+                                            serializer.writer().size()};
+    ASSERT_TRUE(deserializer.Read(&value));
+    EXPECT_EQ(std::string(kSize, 'x'), value);
+  }
+  EXPECT_EQ(1u, Pool::idle_count());
+
+  {
+    ScratchBuffer<Slot<5>, Allocator> buffer{kSize};
+    EXPECT_EQ(first, buffer.data());
+  }
+  EXPECT_EQ(0.5, Pool::stats().reuse_rate());
+  Pool::Trim();
+
+  // Small and explicit huge page allocations work whether or not the system
+  // provides huge pages.
+  HugePageAllocator<int, HugePageMode::Explicit> allocator;
+  int* small = allocator.allocate(4);
+  small[3] = 3;
+  allocator.deallocate(small, 4);
+
+  const std::size_t count = Allocator::kHugePageSize / sizeof(int);
+  int* large = allocator.allocate(count);
+  large[0] = 1;
+  large[count - 1] = 2;
+  EXPECT_EQ(3, large[0] + large[count - 1]);
+  allocator.deallocate(large, count);
+
+  EXPECT_EQ(0u, Allocator::mapped_size(16));
+  EXPECT_EQ(2 * Allocator::kHugePageSize, Allocator::mapped_size(kSize));
+}
@@ -16,18 +16,40 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <array>
+#include <bitset>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
+#include <iterator>
 #include <limits>
+#include <map>
 #include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <nop/base/utility.h>
+#include <nop/projection.h>
 #include <nop/serializer.h>
 #include <nop/structure.h>
 #include <nop/table.h>
+#include <nop/utility/array_cursor.h>
+#include <nop/utility/bounded_writer.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffer_writer.h>
+#include <nop/utility/chunked_array_writer.h>
+#include <nop/utility/indexed_array_view.h>
+#include <nop/utility/parallel_deserializer.h>
+#include <nop/utility/parallel_serializer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/pedantic_buffer_writer.h>
+#include <nop/utility/single_pass_writer.h>
+#include <nop/utility/stream_writer.h>
+#include <nop/utility/vector_writer.h>
+#include <nop/utility/work_stealing_pool.h>
 #include <nop/value.h>
 
 #include "mock_reader.h"
@@ -37,6 +59,11 @@
 #include "test_writer.h"
 
 using nop::Append;
+using nop::ArrayCursor;
+using nop::BoundedWriter;
+using nop::BufferReader;
+using nop::BufferWriter;
+using nop::ChunkedArrayWriter;
 using nop::Compose;
 using nop::DefaultHandlePolicy;
 using nop::DeletedEntry;
@@ -46,14 +73,28 @@ using nop::Encoding;
 using nop::EncodingByte;
 using nop::Entry;
 using nop::ErrorStatus;
+using nop::FlatHashMap;
+using nop::FlatMap;
 using nop::Float;
 using nop::Handle;
+using nop::IndexedArray;
+using nop::IndexedArrayView;
+using nop::IndirectEntry;
+using nop::IsInfallibleWriter;
 using nop::Integer;
+using nop::ParallelDeserializer;
+using nop::ParallelSerializer;
+using nop::PedanticBufferReader;
+using nop::PedanticBufferWriter;
 using nop::Serializer;
+using nop::SinglePassWriter;
 using nop::Status;
+using nop::StreamWriter;
 using nop::TestReader;
 using nop::TestWriter;
 using nop::Variant;
+using nop::VectorWriter;
+using nop::WorkStealingPool;
 
 using nop::testing::MockReader;
 using nop::testing::MockWriter;
@@ -179,6 +220,15 @@ struct TestI {
   NOP_STRUCTURE(TestI, (names, size));
 };
 
+struct TestInvalidMember {
+  int before;
+  std::uint8_t data[4];
+  std::size_t size;
+  int after;
+
+  NOP_STRUCTURE(TestInvalidMember, before, (data, size), after);
+};
+
 // A special rule allows data to be read/written past the end of the structure
 // when a logical buffer pair has an array part of size 1 at the end of the
 // structure. This permits serialization of the common dynamically sized buffer
@@ -242,6 +292,31 @@ struct TableA2 {
   NOP_TABLE_HASH(15, TableA2, name, attributes, address);
 };
 
+// Same as TableA1 with entries stored out-of-line.
+struct TableIndirect {
+  bool operator==(const TableIndirect& other) const {
+    return name == other.name && attributes == other.attributes;
+  }
+
+  Entry<std::string, 0, IndirectEntry> name;
+  Entry<std::vector<std::string>, 1, IndirectEntry> attributes;
+
+  NOP_TABLE_HASH(15, TableIndirect, name, attributes);
+};
+
+// Table with sparse entry ids that are not declared in sorted order.
+struct TableSparse {
+  bool operator==(const TableSparse& other) const {
+    return a == other.a && b == other.b && c == other.c;
+  }
+
+  Entry<int, 100> a;
+  Entry<std::string, 7> b;
+  Entry<int, 42> c;
+
+  NOP_TABLE_HASH(16, TableSparse, a, b, c);
+};
+
 template <typename T>
 struct ValueWrapper {
   T value;
@@ -282,6 +357,79 @@ auto MakeCDynamicArray(const T (&data)[Size]) {
 
 }  // anonymous namespace
 
+namespace {
+
+// Integer wrapper that counts how many times its encoded size is computed.
+struct SizeCounted {
+  int value;
+  static std::size_t size_count;
+
+  bool operator==(const SizeCounted& other) const {
+    return value == other.value;
+  }
+};
+
+std::size_t SizeCounted::size_count = 0;
+
+}  // anonymous namespace
+
+namespace nop {
+
+template <>
+struct Encoding<SizeCounted> : EncodingIO<SizeCounted> {
+  static constexpr EncodingByte Prefix(const SizeCounted& value) {
+    return Encoding<int>::Prefix(value.value);
+  }
+
+  static std::size_t Size(const SizeCounted& value) {
+    SizeCounted::size_count++;
+    return Encoding<int>::Size(value.value);
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<int>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte prefix,
+                                             const SizeCounted& value,
+                                             Writer* writer) {
+    return Encoding<int>::WritePayload(prefix, value.value, writer);
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix,
+                                            SizeCounted* value,
+                                            Reader* reader) {
+    return Encoding<int>::ReadPayload(prefix, &value->value, reader);
+  }
+};
+
+}  // namespace nop
+
+namespace {
+
+struct InnerTable {
+  bool operator==(const InnerTable& other) const {
+    return counted == other.counted;
+  }
+
+  Entry<SizeCounted, 0> counted;
+  NOP_TABLE(InnerTable, counted);
+};
+
+struct OuterTable {
+  bool operator==(const OuterTable& other) const {
+    return inner == other.inner && list == other.list;
+  }
+
+  Entry<InnerTable, 0> inner;
+  Entry<std::vector<InnerTable>, 1> list;
+  NOP_TABLE(OuterTable, inner, list);
+};
+
+}  // anonymous namespace
+
 #if 0
 // This test verifies that the compiler outputs a custom error message when an
 // unsupported type is pass to the serializer.
@@ -837,6 +985,141 @@ TEST(Deserializer, Vector) {
   }
 }
 
+TEST(Serializer, BitArray) {
+  std::vector<std::uint8_t> expected;
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+  Status<void> status;
+
+  {
+    std::vector<bool> value;
+
+    status = serializer.Write(value);
+    ASSERT_TRUE(status);
+
+    expected = Compose(EncodingByte::BitArray, 0);
+    EXPECT_EQ(expected, writer.data());
+    writer.clear();
+  }
+
+  {
+    std::vector<bool> value = {true,  false, true,  true, false,
+                               false, false, false, true};
+
+    status = serializer.Write(value);
+    ASSERT_TRUE(status);
+
+    expected = Compose(EncodingByte::BitArray, 9, 0x0d, 0x01);
+    EXPECT_EQ(expected, writer.data());
+    EXPECT_EQ(expected.size(), Encoding<std::vector<bool>>::Size(value));
+    writer.clear();
+  }
+
+  {
+    std::bitset<12> value;
+    value.set(0);
+    value.set(3);
+    value.set(11);
+
+    status = serializer.Write(value);
+    ASSERT_TRUE(status);
+
+    expected = Compose(EncodingByte::BitArray, 12, 0x09, 0x08);
+    EXPECT_EQ(expected, writer.data());
+    EXPECT_EQ(expected.size(), Encoding<std::bitset<12>>::Size(value));
+    writer.clear();
+  }
+}
+
+TEST(Deserializer, BitArray) {
+  TestReader reader;
+  Deserializer<TestReader*> deserializer{&reader};
+  Status<void> status;
+
+  {
+    reader.Set(Compose(EncodingByte::BitArray, 9, 0x0d, 0x01));
+
+    std::vector<bool> value(100, true);
+    status = deserializer.Read(&value);
+    ASSERT_TRUE(status);
+
+    std::vector<bool> expected = {true,  false, true,  true, false,
+                                  false, false, false, true};
+    EXPECT_EQ(expected, value);
+  }
+
+  {
+    reader.Set(Compose(EncodingByte::BitArray, 12, 0x09, 0x08));
+
+    std::bitset<12> value;
+    status = deserializer.Read(&value);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(0x809u, value.to_ulong());
+  }
+
+  // Bit arrays spanning several staging blocks round trip.
+  {
+    std::vector<bool> expected(10007);
+    for (std::size_t i = 0; i < expected.size(); i++)
+      expected[i] = (i * 2654435761u) % 7 < 3;
+    std::bitset<5000> expected_bitset;
+    for (std::size_t i = 0; i < expected_bitset.size(); i++)
+      expected_bitset[i] = i % 3 == 0;
+
+    TestWriter writer;
+    Serializer<TestWriter*> serializer{&writer};
+    ASSERT_TRUE(serializer.Write(expected));
+    ASSERT_TRUE(serializer.Write(expected_bitset));
+    reader.Set(writer.data());
+
+    std::vector<bool> value;
+    std::bitset<5000> value_bitset;
+    ASSERT_TRUE(deserializer.Read(&value));
+    ASSERT_TRUE(deserializer.Read(&value_bitset));
+    EXPECT_EQ(expected, value);
+    EXPECT_EQ(expected_bitset, value_bitset);
+  }
+
+  {
+    // Bitsets require the exact number of bits.
+    reader.Set(Compose(EncodingByte::BitArray, 11, 0x09, 0x04));
+
+    std::bitset<12> value;
+    status = deserializer.Read(&value);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+  }
+
+  {
+    // The unused bits of the last byte must be zero.
+    reader.Set(Compose(EncodingByte::BitArray, 9, 0x0d, 0x03));
+
+    std::vector<bool> value;
+    status = deserializer.Read(&value);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+  }
+
+  {
+    reader.Set(Compose(EncodingByte::BitArray, 17, 0x0d, 0x03));
+
+    std::vector<bool> value;
+    status = deserializer.Read(&value);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+  }
+
+  {
+    // Bit arrays are not integer arrays.
+    reader.Set(Compose(EncodingByte::Binary, 2, 0x0d, 0x01));
+
+    std::vector<bool> value;
+    status = deserializer.Read(&value);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+  }
+}
+
 TEST(Serializer, IntegerStdArrayFailOnPrepare) {
   MockWriter writer;
   Serializer<MockWriter*> serializer{&writer};
@@ -4534,6 +4817,156 @@ TEST(Deserializer, Map) {
   }
 }
 
+TEST(Deserializer, MapUnordered) {
+  TestReader reader;
+  Deserializer<TestReader*> deserializer{&reader};
+
+  // Keys out of order are inserted in place and the first of any duplicate
+  // keys is kept.
+  std::map<int, std::string> value;
+  reader.Set(Compose(EncodingByte::Map, 4, 2, EncodingByte::String, 1, "c", 0,
+                     EncodingByte::String, 1, "a", 1, EncodingByte::String, 1,
+                     "b", 0, EncodingByte::String, 1, "x"));
+  ASSERT_TRUE(deserializer.Read(&value));
+
+  std::map<int, std::string> expected = {{{0, "a"}, {1, "b"}, {2, "c"}}};
+  EXPECT_EQ(expected, value);
+}
+
+TEST(Serializer, FlatMap) {
+  FlatMap<int, std::string> value = {{1, "123"}, {0, "abc"}};
+  EXPECT_EQ(2u, value.size());
+  EXPECT_EQ(0, value.begin()->first);
+
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+  ASSERT_TRUE(serializer.Write(value));
+
+  std::vector<std::uint8_t> expected =
+      Compose(EncodingByte::Map, 2, 0, EncodingByte::String, 3, "abc", 1,
+              EncodingByte::String, 3, "123");
+  EXPECT_EQ(expected, writer.data());
+
+  // FlatMap encodes the same as std::map.
+  writer.clear();
+  ASSERT_TRUE(serializer.Write(std::map<int, std::string>{
+      value.begin(), value.end()}));
+  EXPECT_EQ(expected, writer.data());
+}
+
+TEST(Deserializer, FlatMap) {
+  TestReader reader;
+  Deserializer<TestReader*> deserializer{&reader};
+
+  FlatMap<int, std::string> value;
+  reader.Set(Compose(EncodingByte::Map, 2, 0, EncodingByte::String, 3, "abc",
+                     1, EncodingByte::String, 3, "123"));
+  ASSERT_TRUE(deserializer.Read(&value));
+
+  FlatMap<int, std::string> expected = {{0, "abc"}, {1, "123"}};
+  EXPECT_EQ(expected, value);
+  ASSERT_NE(value.end(), value.find(1));
+  EXPECT_EQ("123", value.find(1)->second);
+  EXPECT_EQ(value.end(), value.find(2));
+
+  // Unsorted input is sorted after decoding, keeping the first of any
+  // duplicate keys like std::map.
+  reader.Set(Compose(EncodingByte::Map, 4, 2, EncodingByte::String, 1, "c", 0,
+                     EncodingByte::String, 1, "a", 1, EncodingByte::String, 1,
+                     "b", 0, EncodingByte::String, 1, "x"));
+  ASSERT_TRUE(deserializer.Read(&value));
+
+  expected = {{0, "a"}, {1, "b"}, {2, "c"}};
+  EXPECT_EQ(expected, value);
+
+  value[3] = "d";
+  value[1] = "B";
+  EXPECT_EQ(1u, value.erase(0));
+  expected = {{1, "B"}, {2, "c"}, {3, "d"}};
+  EXPECT_EQ(expected, value);
+}
+
+TEST(Serializer, FlatHashMap) {
+  FlatHashMap<int, std::string> value = {{1, "123"}, {0, "abc"}};
+  EXPECT_EQ(2u, value.size());
+
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+  ASSERT_TRUE(serializer.Write(value));
+
+  // Elements are written in insertion order.
+  std::vector<std::uint8_t> expected =
+      Compose(EncodingByte::Map, 2, 1, EncodingByte::String, 3, "123", 0,
+              EncodingByte::String, 3, "abc");
+  EXPECT_EQ(expected, writer.data());
+
+  // FlatHashMap decodes as std::unordered_map.
+  std::unordered_map<int, std::string> decoded;
+  TestReader reader;
+  Deserializer<TestReader*> deserializer{&reader};
+  reader.Set(writer.data());
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(
+      (std::unordered_map<int, std::string>{{0, "abc"}, {1, "123"}}),
+      decoded);
+}
+
+TEST(Deserializer, FlatHashMap) {
+  TestReader reader;
+  Deserializer<TestReader*> deserializer{&reader};
+
+  // Duplicate keys keep the first pair like std::unordered_map.
+  FlatHashMap<int, std::string> value;
+  reader.Set(Compose(EncodingByte::Map, 4, 2, EncodingByte::String, 1, "c", 0,
+                     EncodingByte::String, 1, "a", 1, EncodingByte::String, 1,
+                     "b", 0, EncodingByte::String, 1, "x"));
+  ASSERT_TRUE(deserializer.Read(&value));
+
+  FlatHashMap<int, std::string> expected = {{0, "a"}, {1, "b"}, {2, "c"}};
+  EXPECT_EQ(expected, value);
+  ASSERT_NE(value.end(), value.find(1));
+  EXPECT_EQ("b", value.find(1)->second);
+  EXPECT_EQ(value.end(), value.find(3));
+
+  // Counts larger than the input do not reserve beyond it.
+  reader.Set(Compose(EncodingByte::Map, 1000000, 0, EncodingByte::String, 1,
+                     "a"));
+  Status<void> status = deserializer.Read(&value);
+  ASSERT_FALSE(status);
+  EXPECT_GT(1000u, value.bucket_count());
+  EXPECT_EQ(1u, value.size());
+
+  // Inserting and erasing many keys matches std::unordered_map.
+  FlatHashMap<std::uint32_t, std::uint32_t> map;
+  std::unordered_map<std::uint32_t, std::uint32_t> reference;
+  std::uint32_t key = 1;
+  for (std::uint32_t i = 0; i < 20000; i++) {
+    key = key * 1103515245u + 12345u;
+    const std::uint32_t bucket = (key >> 16) % 4096;
+    if (key & 0x8000) {
+      EXPECT_EQ(reference.erase(bucket), map.erase(bucket));
+    } else {
+      map[bucket] = i;
+      reference[bucket] = i;
+    }
+  }
+  ASSERT_EQ(reference.size(), map.size());
+  for (const auto& element : reference) {
+    auto position = map.find(element.first);
+    ASSERT_NE(map.end(), position);
+    EXPECT_EQ(element.second, position->second);
+  }
+
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+  ASSERT_TRUE(serializer.Write(map));
+  reader.Set(writer.data());
+
+  FlatHashMap<std::uint32_t, std::uint32_t> decoded;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(map, decoded);
+}
+
 TEST(Serializer, UnorderedMapFailOnPrepare) {
   MockWriter writer;
   Serializer<MockWriter*> serializer{&writer};
@@ -7012,6 +7445,96 @@ TEST(Serializer, Table) {
   }
 }
 
+TEST(Serializer, TableSinglePass) {
+  TableA1 value{"Ron Swanson", {{"snarky", "male", "attitude"}}};
+  const std::vector<std::uint8_t> expected = Compose(
+      EncodingByte::Table, 15, 2, 0, EncodingByte::U64,
+      Integer<std::uint64_t>(13), EncodingByte::String, 11, "Ron Swanson", 1,
+      EncodingByte::U64, Integer<std::uint64_t>(26), EncodingByte::Array, 3,
+      EncodingByte::String, 6, "snarky", EncodingByte::String, 4, "male",
+      EncodingByte::String, 8, "attitude");
+  Status<void> status;
+
+  {
+    std::uint8_t buffer[128];
+    Serializer<SinglePassWriter<PedanticBufferWriter>> serializer{
+        buffer, sizeof(buffer)};
+    status = serializer.Write(value);
+    ASSERT_TRUE(status);
+
+    const std::size_t size = serializer.writer().writer().size();
+    EXPECT_EQ(expected, std::vector<std::uint8_t>(buffer, buffer + size));
+
+    // Patched size fields are valid encodings for any reader.
+    Deserializer<nop::BufferReader> deserializer{buffer, size};
+    TableA1 read_value;
+    status = deserializer.Read(&read_value);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(value, read_value);
+  }
+
+  {
+    Serializer<SinglePassWriter<StreamWriter<std::stringstream>>> serializer;
+    status = serializer.Write(value);
+    ASSERT_TRUE(status);
+
+    const std::string data = serializer.writer().writer().stream().str();
+    EXPECT_EQ(expected, std::vector<std::uint8_t>(data.begin(), data.end()));
+  }
+
+  {
+    // Without a Size() walk the writer catches overflow as it goes.
+    std::uint8_t buffer[32];
+    Serializer<SinglePassWriter<PedanticBufferWriter>> serializer{
+        buffer, sizeof(buffer)};
+    status = serializer.Write(value);
+    EXPECT_EQ(ErrorStatus::WriteLimitReached, status.error());
+  }
+}
+
+TEST(Serializer, TableSizeCache) {
+  OuterTable value;
+  value.inner = InnerTable{};
+  value.inner.get().counted = SizeCounted{1};
+  value.list = std::vector<InnerTable>(2);
+  value.list.get()[0].counted = SizeCounted{2};
+  value.list.get()[1].counted = SizeCounted{3};
+  Status<void> status;
+
+  // Each nested entry is sized once rather than once per level of nesting.
+  Serializer<TestWriter> serializer;
+  SizeCounted::size_count = 0;
+  status = serializer.Write(value);
+  ASSERT_TRUE(status);
+  EXPECT_EQ(3u, SizeCounted::size_count);
+
+  // The same bytes are produced with sizes computed on demand.
+  Serializer<TestWriter> expected_serializer;
+  ASSERT_TRUE(nop::Encoding<OuterTable>::Write(value,
+                                               &expected_serializer.writer()));
+  EXPECT_EQ(expected_serializer.writer().data(), serializer.writer().data());
+
+  {
+    // Entries beyond the capacity of the cache fall back to being sized on
+    // demand.
+    OuterTable large;
+    large.list = std::vector<InnerTable>(nop::SizeCache::kCapacity * 2);
+    for (std::size_t i = 0; i < large.list.get().size(); i++)
+      large.list.get()[i].counted = SizeCounted{static_cast<int>(i * 100)};
+
+    serializer.writer().clear();
+    status = serializer.Write(large);
+    ASSERT_TRUE(status);
+
+    Deserializer<TestReader> deserializer;
+    deserializer.reader().Set(serializer.writer().data());
+    OuterTable read_value;
+    status = deserializer.Read(&read_value);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(large, read_value);
+  }
+}
+
 TEST(Deserializer, Table) {
   TestReader reader;
   Deserializer<TestReader*> deserializer{&reader};
@@ -7072,6 +7595,85 @@ TEST(Deserializer, Table) {
   }
 }
 
+TEST(Deserializer, TableSparseIds) {
+  TestReader reader;
+  Deserializer<TestReader*> deserializer{&reader};
+  Status<void> status;
+
+  {
+    TableSparse value;
+
+    // Entries in an arbitrary order, including an unknown id (50) between
+    // known ones that must be skipped.
+    reader.Set(Compose(EncodingByte::Table, 16, 4, 42, 1, 3, 50, 1, 9, 7, 4,
+                       EncodingByte::String, 2, "ok", 100, 1, 5));
+    status = deserializer.Read(&value);
+    ASSERT_TRUE(status);
+
+    TableSparse expected;
+    expected.a = 5;
+    expected.b = std::string{"ok"};
+    expected.c = 3;
+    EXPECT_EQ(expected, value);
+  }
+
+  {
+    TableSparse value;
+
+    // Ids below, between and above the known ids.
+    reader.Set(Compose(EncodingByte::Table, 16, 4, 0, 1, 1, 8, 1, 2, 101, 1,
+                       3, EncodingByte::U64, 0, 1, 2, 3, 4, 5, 6, 7, 1, 4));
+    status = deserializer.Read(&value);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(TableSparse{}, value);
+  }
+}
+
+TEST(Serializer, TableIndirectEntries) {
+  static_assert(sizeof(Entry<std::string, 0, IndirectEntry>) ==
+                    sizeof(std::string*),
+                "Indirect entries should be the size of a pointer.");
+
+  TableA1 direct{"Ron Swanson", {{"snarky", "male", "attitude"}}};
+  TableIndirect value;
+  EXPECT_TRUE(value.name.empty());
+  value.name = "Ron Swanson";
+  value.attributes = std::vector<std::string>{"snarky", "male", "attitude"};
+
+  // Indirect entries encode the same as direct entries.
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(value));
+  Serializer<TestWriter> direct_serializer;
+  ASSERT_TRUE(direct_serializer.Write(direct));
+  EXPECT_EQ(direct_serializer.writer().data(), serializer.writer().data());
+
+  Deserializer<TestReader> deserializer;
+  deserializer.reader().Set(serializer.writer().data());
+  TableIndirect read_value;
+  read_value.attributes = std::vector<std::string>{"stale"};
+  ASSERT_TRUE(deserializer.Read(&read_value));
+  EXPECT_EQ(value, read_value);
+
+  // Copies are deep and clearing releases the value.
+  TableIndirect copy = read_value;
+  copy.name.get() = "Leslie Knope";
+  EXPECT_EQ("Ron Swanson", read_value.name.get());
+  copy.attributes.clear();
+  EXPECT_FALSE(copy.attributes);
+  EXPECT_TRUE(read_value.attributes);
+  copy = read_value;
+  EXPECT_EQ(read_value, copy);
+
+  // Empty entries are not encoded.
+  copy.name.clear();
+  serializer.writer().clear();
+  ASSERT_TRUE(serializer.Write(copy));
+  deserializer.reader().Set(serializer.writer().data());
+  ASSERT_TRUE(deserializer.Read(&read_value));
+  EXPECT_FALSE(read_value.name);
+  EXPECT_EQ(copy, read_value);
+}
+
 TEST(Serializer, VariantFailOnPrepare) {
   MockWriter writer;
   Serializer<MockWriter*> serializer{&writer};
@@ -7815,3 +8417,1028 @@ TEST(Deserializer, reference_wrapper) {
     EXPECT_EQ(expected, value);
   }
 }
+
+TEST(Deserializer, ArrayCursor) {
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+
+  // Non-integral elements are read one at a time or in batches.
+  {
+    const std::vector<std::string> value{"a", "bc", "def", "ghij", "klmno"};
+    writer.clear();
+    ASSERT_TRUE(serializer.Write(value));
+
+    BufferReader reader{writer.data().data(), writer.data().size()};
+    ArrayCursor<std::string> cursor;
+    ASSERT_TRUE(cursor.Begin(&reader));
+    EXPECT_EQ(5u, cursor.size());
+
+    std::string element;
+    ASSERT_TRUE(cursor.Next(&element, &reader));
+    EXPECT_EQ("a", element);
+    EXPECT_EQ(4u, cursor.remaining());
+
+    std::string batch[3];
+    auto count = cursor.Read(std::begin(batch), std::end(batch), &reader);
+    ASSERT_TRUE(count);
+    EXPECT_EQ(3u, count.get());
+    EXPECT_EQ("bc", batch[0]);
+    EXPECT_EQ("ghij", batch[2]);
+
+    count = cursor.Read(std::begin(batch), std::end(batch), &reader);
+    ASSERT_TRUE(count);
+    EXPECT_EQ(1u, count.get());
+    EXPECT_EQ("klmno", batch[0]);
+    EXPECT_TRUE(cursor.done());
+    EXPECT_EQ(0u, reader.remaining());
+
+    auto status = cursor.Next(&element, &reader);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+  }
+
+  // Integral elements are read from the binary payload.
+  {
+    const std::vector<std::uint32_t> value{1, 2, 3, 0xdeadbeef};
+    writer.clear();
+    ASSERT_TRUE(serializer.Write(value));
+
+    BufferReader reader{writer.data().data(), writer.data().size()};
+    ArrayCursor<std::uint32_t> cursor;
+    ASSERT_TRUE(cursor.Begin(&reader));
+    EXPECT_EQ(4u, cursor.size());
+
+    std::uint32_t batch[3];
+    auto count = cursor.Read(std::begin(batch), std::end(batch), &reader);
+    ASSERT_TRUE(count);
+    EXPECT_EQ(3u, count.get());
+    EXPECT_EQ(3u, batch[2]);
+
+    std::uint32_t element = 0;
+    ASSERT_TRUE(cursor.Next(&element, &reader));
+    EXPECT_EQ(0xdeadbeef, element);
+    EXPECT_TRUE(cursor.done());
+  }
+
+  // The header must match the encoding of std::vector<T>.
+  {
+    const std::vector<std::uint8_t> bytes =
+        Compose(EncodingByte::Array, 1, EncodingByte::String, 1, "a");
+    BufferReader reader{bytes.data(), bytes.size()};
+    ArrayCursor<std::uint32_t> cursor;
+    auto status = cursor.Begin(&reader);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+  }
+  {
+    const std::vector<std::uint8_t> bytes =
+        Compose(EncodingByte::Binary, 3, 1, 2, 3);
+    BufferReader reader{bytes.data(), bytes.size()};
+    ArrayCursor<std::uint16_t> cursor;
+    auto status = cursor.Begin(&reader);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+  }
+
+  // A truncated payload is an error.
+  {
+    const std::vector<std::uint8_t> bytes =
+        Compose(EncodingByte::Binary, 8, Integer<std::uint32_t>(1));
+    BufferReader reader{bytes.data(), bytes.size()};
+    ArrayCursor<std::uint32_t> cursor;
+    ASSERT_TRUE(cursor.Begin(&reader));
+
+    std::uint32_t batch[2];
+    auto count = cursor.Read(std::begin(batch), std::end(batch), &reader);
+    ASSERT_FALSE(count);
+    EXPECT_EQ(ErrorStatus::ReadLimitReached, count.error());
+  }
+}
+
+TEST(Deserializer, IndexedArray) {
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+
+  // Offsets are relative to the first element and are four bytes wide.
+  const IndexedArray<std::string> value{{"a", "bc", "def"}};
+  std::vector<std::uint8_t> expected =
+      Compose(EncodingByte::IndexedArray, 3, EncodingByte::Binary, 12,
+              Integer<std::uint32_t>(0), Integer<std::uint32_t>(3),
+              Integer<std::uint32_t>(7), EncodingByte::String, 1, "a",
+              EncodingByte::String, 2, "bc", EncodingByte::String, 3, "def");
+  ASSERT_TRUE(serializer.Write(value));
+  EXPECT_EQ(expected, writer.data());
+  EXPECT_EQ(expected.size(), Encoding<IndexedArray<std::string>>::Size(value));
+
+  // The indexed form decodes as std::vector<T> and IndexedArray<T>, and can be
+  // skipped without knowing its type.
+  {
+    Deserializer<PedanticBufferReader> deserializer{expected.data(),
+                                                    expected.size()};
+    std::vector<std::string> decoded;
+    ASSERT_TRUE(deserializer.Read(&decoded));
+    EXPECT_EQ(value.get(), decoded);
+  }
+  {
+    Deserializer<PedanticBufferReader> deserializer{expected.data(),
+                                                    expected.size()};
+    IndexedArray<std::string> decoded;
+    ASSERT_TRUE(deserializer.Read(&decoded));
+    EXPECT_EQ(value.get(), decoded.get());
+  }
+  {
+    Deserializer<PedanticBufferReader> deserializer{expected.data(),
+                                                    expected.size()};
+    ASSERT_TRUE(deserializer.Skip());
+    EXPECT_TRUE(deserializer.reader().empty());
+  }
+
+  // Elements are decoded in any order through the view.
+  {
+    IndexedArrayView<std::string> view;
+    ASSERT_TRUE(view.Open(expected.data(), expected.size()));
+    EXPECT_EQ(3u, view.size());
+
+    std::string element;
+    ASSERT_TRUE(view.Read(2, &element));
+    EXPECT_EQ("def", element);
+    ASSERT_TRUE(view.Read(0, &element));
+    EXPECT_EQ("a", element);
+    ASSERT_TRUE(view.Read(1, &element));
+    EXPECT_EQ("bc", element);
+
+    auto status = view.Read(3, &element);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+  }
+
+  // The cursor seeks forward using the offsets.
+  for (std::size_t index = 0; index <= 3; index++) {
+    PedanticBufferReader reader{expected.data(), expected.size()};
+    ArrayCursor<std::string> cursor;
+    ASSERT_TRUE(cursor.Begin(&reader));
+    ASSERT_TRUE(cursor.Seek(index, &reader));
+    EXPECT_EQ(index, cursor.position());
+
+    std::string element;
+    if (index < 3) {
+      ASSERT_TRUE(cursor.Next(&element, &reader));
+      EXPECT_EQ(value.get()[index], element);
+    } else {
+      EXPECT_TRUE(cursor.done());
+      EXPECT_TRUE(reader.empty());
+    }
+
+    // Seeking backwards is not supported.
+    auto status = cursor.Seek(0, &reader);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+  }
+
+  // Plain arrays seek by skipping each element.
+  {
+    const std::vector<std::string> plain = value.get();
+    writer.clear();
+    ASSERT_TRUE(serializer.Write(plain));
+
+    PedanticBufferReader reader{writer.data().data(), writer.data().size()};
+    ArrayCursor<std::string> cursor;
+    ASSERT_TRUE(cursor.Begin(&reader));
+    ASSERT_TRUE(cursor.Seek(2, &reader));
+    std::string element;
+    ASSERT_TRUE(cursor.Next(&element, &reader));
+    EXPECT_EQ("def", element);
+  }
+
+  // Empty arrays have an empty offset table.
+  {
+    writer.clear();
+    ASSERT_TRUE(serializer.Write(IndexedArray<std::string>{}));
+    EXPECT_EQ(Compose(EncodingByte::IndexedArray, 0, EncodingByte::Binary, 0),
+              writer.data());
+
+    IndexedArrayView<std::string> view;
+    ASSERT_TRUE(view.Open(writer.data().data(), writer.data().size()));
+    EXPECT_TRUE(view.empty());
+  }
+
+  // Offset tables whose length does not match the element count are rejected.
+  {
+    const std::vector<std::uint8_t> bytes =
+        Compose(EncodingByte::IndexedArray, 2, EncodingByte::Binary, 6,
+                Integer<std::uint16_t>(0), Integer<std::uint32_t>(3),
+                EncodingByte::String, 1, "a", EncodingByte::String, 2, "bc");
+    Deserializer<PedanticBufferReader> deserializer{bytes.data(),
+                                                    bytes.size()};
+    std::vector<std::string> decoded;
+    auto status = deserializer.Read(&decoded);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+
+    IndexedArrayView<std::string> view;
+    status = view.Open(bytes.data(), bytes.size());
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+  }
+
+  // Offsets that do not match the elements are detected on access.
+  {
+    const std::vector<std::uint8_t> bytes =
+        Compose(EncodingByte::IndexedArray, 2, EncodingByte::Binary, 8,
+                Integer<std::uint32_t>(0), Integer<std::uint32_t>(4),
+                EncodingByte::String, 1, "a", EncodingByte::String, 2, "bc");
+    IndexedArrayView<std::string> view;
+    ASSERT_TRUE(view.Open(bytes.data(), bytes.size()));
+
+    std::string element;
+    auto status = view.Read(0, &element);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+  }
+}
+
+namespace {
+
+struct SnapshotRecord {
+  std::uint64_t id;
+  std::string name;
+  std::vector<std::uint8_t> payload;
+
+  bool operator==(const SnapshotRecord& other) const {
+    return id == other.id && name == other.name && payload == other.payload;
+  }
+
+  NOP_STRUCTURE(SnapshotRecord, id, name, payload);
+};
+
+std::vector<SnapshotRecord> MakeSnapshot(std::size_t count) {
+  std::vector<SnapshotRecord> records;
+  for (std::size_t i = 0; i < count; i++) {
+    records.push_back({i * 977, std::string(i % 37, 'a' + i % 26),
+                       std::vector<std::uint8_t>(i % 300, i & 0xff)});
+  }
+  return records;
+}
+
+template <typename T>
+std::vector<std::uint8_t> SerializeSequential(const T& value) {
+  Serializer<VectorWriter> serializer;
+  EXPECT_TRUE(serializer.Write(value));
+  return serializer.writer().data();
+}
+
+}  // anonymous namespace
+
+TEST(Serializer, InfallibleWriter) {
+  static_assert(IsInfallibleWriter<BufferWriter>::value, "");
+  static_assert(IsInfallibleWriter<VectorWriter>::value, "");
+  static_assert(
+      IsInfallibleWriter<nop::SizeCacheWriter<VectorWriter>>::value, "");
+  static_assert(!IsInfallibleWriter<TestWriter>::value, "");
+  static_assert(!IsInfallibleWriter<PedanticBufferWriter>::value, "");
+
+  // Errors from member encodings are reported with either kind of writer.
+  const TestInvalidMember value{1, {1, 2, 3, 4}, 5, 2};
+  Status<void> status;
+
+  Serializer<VectorWriter> serializer;
+  status = serializer.Write(value);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+  EXPECT_GE(Encoding<TestInvalidMember>::Size(value),
+            serializer.writer().size());
+
+  Serializer<TestWriter> test_serializer;
+  status = test_serializer.Write(value);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+
+  // Valid values are unaffected.
+  const TestInvalidMember valid{1, {1, 2, 3, 4}, 2, 3};
+  serializer.writer().clear();
+  ASSERT_TRUE(serializer.Write(valid));
+  EXPECT_EQ(Compose(EncodingByte::Structure, 3, 1, EncodingByte::Binary, 2, 1,
+                    2, 3),
+            serializer.writer().data());
+}
+
+TEST(Serializer, ParallelSerializer) {
+  const std::vector<SnapshotRecord> records = MakeSnapshot(10000);
+  ParallelSerializer serializer{4};
+  EXPECT_EQ(4u, serializer.thread_count());
+
+  // The output matches the sequential serializer exactly.
+  {
+    VectorWriter writer;
+    ASSERT_TRUE(serializer.Write(records, &writer));
+    EXPECT_EQ(SerializeSequential(records), writer.data());
+
+    // Writes append to any earlier output.
+    ASSERT_TRUE(serializer.Write(records, &writer));
+    EXPECT_EQ(2 * SerializeSequential(records).size(), writer.size());
+  }
+  {
+    const IndexedArray<SnapshotRecord> indexed{records};
+    VectorWriter writer;
+    ASSERT_TRUE(serializer.Write(indexed, &writer));
+    EXPECT_EQ(SerializeSequential(indexed), writer.data());
+
+    IndexedArrayView<SnapshotRecord> view;
+    ASSERT_TRUE(view.Open(writer.data().data(), writer.size()));
+    SnapshotRecord record;
+    ASSERT_TRUE(view.Read(7777, &record));
+    EXPECT_EQ(records[7777].name, record.name);
+  }
+
+  // Small and integral arrays are written on the calling thread.
+  {
+    const std::vector<SnapshotRecord> small = MakeSnapshot(10);
+    VectorWriter writer;
+    ASSERT_TRUE(serializer.Write(small, &writer));
+    EXPECT_EQ(SerializeSequential(small), writer.data());
+
+    const std::vector<std::uint32_t> integers(5000, 0xabcdef);
+    writer.clear();
+    ASSERT_TRUE(serializer.Write(integers, &writer));
+    EXPECT_EQ(SerializeSequential(integers), writer.data());
+  }
+
+  // A shared pool may be used, and a buffer that is too small is an error.
+  {
+    WorkStealingPool pool{2};
+    ParallelSerializer shared{&pool};
+    std::vector<std::uint8_t> buffer(SerializeSequential(records).size());
+
+    BufferWriter writer{buffer.data(), buffer.size() - 1};
+    auto status = shared.Write(records, &writer);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::WriteLimitReached, status.error());
+
+    writer = BufferWriter{buffer.data(), buffer.size()};
+    ASSERT_TRUE(shared.Write(records, &writer));
+    EXPECT_EQ(SerializeSequential(records), buffer);
+  }
+}
+
+TEST(Deserializer, ParallelDeserializer) {
+  const std::vector<SnapshotRecord> records = MakeSnapshot(10000);
+  ParallelDeserializer deserializer{4};
+
+  // Plain arrays are divided by a pre-scan, indexed arrays by their offsets.
+  {
+    const std::vector<std::uint8_t> bytes = SerializeSequential(records);
+    PedanticBufferReader reader{bytes.data(), bytes.size()};
+    std::vector<SnapshotRecord> decoded(3);
+    ASSERT_TRUE(deserializer.Read(&decoded, &reader));
+    EXPECT_EQ(records, decoded);
+    EXPECT_TRUE(reader.empty());
+  }
+  {
+    std::vector<std::uint8_t> bytes =
+        SerializeSequential(IndexedArray<SnapshotRecord>{records});
+    const std::vector<std::uint8_t> trailer = SerializeSequential(7);
+    bytes.insert(bytes.end(), trailer.begin(), trailer.end());
+
+    BufferReader reader{bytes.data(), bytes.size()};
+    IndexedArray<SnapshotRecord> decoded;
+    ASSERT_TRUE(deserializer.Read(&decoded, &reader));
+    EXPECT_EQ(records, decoded.get());
+
+    // The reader is left after the array.
+    Deserializer<BufferReader*> trailer_deserializer{&reader};
+    int value = 0;
+    ASSERT_TRUE(trailer_deserializer.Read(&value));
+    EXPECT_EQ(7, value);
+  }
+
+  // Maps keep the first of any duplicate keys, as Deserializer does.
+  {
+    std::map<std::uint64_t, std::string> map;
+    std::unordered_map<std::uint64_t, std::string> unordered_map;
+    for (const SnapshotRecord& record : records) {
+      map.emplace(record.id % 7919, record.name);
+      unordered_map.emplace(record.id % 7919, record.name);
+    }
+
+    std::vector<std::uint8_t> bytes = SerializeSequential(unordered_map);
+    PedanticBufferReader reader{bytes.data(), bytes.size()};
+    std::map<std::uint64_t, std::string> decoded_map;
+    ASSERT_TRUE(deserializer.Read(&decoded_map, &reader));
+    EXPECT_EQ(map, decoded_map);
+
+    reader = PedanticBufferReader{bytes.data(), bytes.size()};
+    std::unordered_map<std::uint64_t, std::string> decoded_unordered_map;
+    ASSERT_TRUE(deserializer.Read(&decoded_unordered_map, &reader));
+    EXPECT_EQ(unordered_map, decoded_unordered_map);
+
+    // Encode duplicate keys directly, since maps cannot hold them.
+    std::vector<std::uint8_t> duplicates = Compose(
+        EncodingByte::Map, EncodingByte::U16, Integer<std::uint16_t>(1000));
+    for (int i = 0; i < 1000; i++) {
+      const std::vector<std::uint8_t> entry =
+          SerializeSequential(std::make_pair(i % 10, i));
+      duplicates.insert(duplicates.end(), entry.begin() + 2, entry.end());
+    }
+    std::map<int, int> expected;
+    Deserializer<BufferReader> sequential{duplicates.data(), duplicates.size()};
+    ASSERT_TRUE(sequential.Read(&expected));
+
+    reader = PedanticBufferReader{duplicates.data(), duplicates.size()};
+    std::map<int, int> decoded;
+    WorkStealingPool pool{3};
+    ParallelDeserializer shared{&pool};
+    ASSERT_TRUE(shared.Read(&decoded, &reader));
+    EXPECT_EQ(expected, decoded);
+  }
+
+  // Truncated and corrupt input is rejected.
+  {
+    std::vector<std::uint8_t> bytes = SerializeSequential(records);
+    bytes.pop_back();
+    PedanticBufferReader reader{bytes.data(), bytes.size()};
+    std::vector<SnapshotRecord> decoded;
+    auto status = deserializer.Read(&decoded, &reader);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+  }
+  {
+    std::vector<std::uint8_t> bytes =
+        SerializeSequential(IndexedArray<SnapshotRecord>{records});
+
+    // Move the offset of element 5000, which starts a chunk, back by a byte so
+    // that the chunks on either side of it no longer match their elements.
+    const std::size_t table_offset =
+        2 + Encoding<nop::SizeType>::Size(records.size()) +
+        Encoding<nop::SizeType>::Size(4 * records.size());
+    std::uint32_t offset;
+    std::memcpy(&offset, &bytes[table_offset + 4 * 5000], sizeof(offset));
+    offset--;
+    std::memcpy(&bytes[table_offset + 4 * 5000], &offset, sizeof(offset));
+
+    PedanticBufferReader reader{bytes.data(), bytes.size()};
+    std::vector<SnapshotRecord> decoded;
+    ASSERT_FALSE(deserializer.Read(&decoded, &reader));
+
+    const std::vector<std::uint8_t> string_bytes =
+        SerializeSequential(std::string{"records"});
+    reader = PedanticBufferReader{string_bytes.data(), string_bytes.size()};
+    auto status = deserializer.Read(&decoded, &reader);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+  }
+}
+
+TEST(Deserializer, ChunkedArray) {
+  TestWriter writer;
+  std::vector<std::uint8_t> expected;
+
+  // Non-integral elements are written in chunks as they are appended.
+  {
+    ChunkedArrayWriter<std::string> stream{2};
+    ASSERT_TRUE(stream.BeginStream(&writer));
+    ASSERT_TRUE(stream.Append("a", &writer));
+    EXPECT_EQ(1u, stream.buffered_count());
+    ASSERT_TRUE(stream.Append("bc", &writer));
+    EXPECT_EQ(0u, stream.buffered_count());
+    ASSERT_TRUE(stream.Append("def", &writer));
+    ASSERT_TRUE(stream.End(&writer));
+
+    expected = Compose(EncodingByte::ChunkedArray, 2, EncodingByte::String, 1,
+                       "a", EncodingByte::String, 2, "bc", 1,
+                       EncodingByte::String, 3, "def", 0);
+    EXPECT_EQ(expected, writer.data());
+
+    // Existing elements are reused and the vector is truncated.
+    std::vector<std::string> value{"w", "x", "y", "z"};
+    BufferReader reader{writer.data().data(), writer.data().size()};
+    Deserializer<BufferReader*> deserializer{&reader};
+    ASSERT_TRUE(deserializer.Read(&value));
+    EXPECT_EQ((std::vector<std::string>{"a", "bc", "def"}), value);
+  }
+
+  // Integral vectors accept the chunked form with encoded elements.
+  {
+    writer.clear();
+    ChunkedArrayWriter<int> stream{3};
+    ASSERT_TRUE(stream.BeginStream(&writer));
+    for (int i = 0; i < 5; i++)
+      ASSERT_TRUE(stream.Append(i * 100, &writer));
+    ASSERT_TRUE(stream.End(&writer));
+
+    expected =
+        Compose(EncodingByte::ChunkedArray, 3, 0, 100, EncodingByte::I16,
+                Integer<std::int16_t>(200), 2, EncodingByte::I16,
+                Integer<std::int16_t>(300), EncodingByte::I16,
+                Integer<std::int16_t>(400), 0);
+    EXPECT_EQ(expected, writer.data());
+
+    std::vector<int> value;
+    BufferReader reader{writer.data().data(), writer.data().size()};
+    Deserializer<BufferReader*> deserializer{&reader};
+    ASSERT_TRUE(deserializer.Read(&value));
+    EXPECT_EQ((std::vector<int>{0, 100, 200, 300, 400}), value);
+  }
+
+  // An empty stream is just the prefix and terminator.
+  {
+    writer.clear();
+    ChunkedArrayWriter<int> stream;
+    ASSERT_TRUE(stream.BeginStream(&writer));
+    ASSERT_TRUE(stream.End(&writer));
+    EXPECT_EQ(Compose(EncodingByte::ChunkedArray, 0), writer.data());
+
+    std::vector<int> value{1, 2};
+    BufferReader reader{writer.data().data(), writer.data().size()};
+    Deserializer<BufferReader*> deserializer{&reader};
+    ASSERT_TRUE(deserializer.Read(&value));
+    EXPECT_TRUE(value.empty());
+  }
+
+  // A stream missing its terminator is an error.
+  {
+    expected = Compose(EncodingByte::ChunkedArray, 1, 10);
+    std::vector<int> value;
+    PedanticBufferReader reader{expected.data(), expected.size()};
+    Deserializer<PedanticBufferReader*> deserializer{&reader};
+    auto status = deserializer.Read(&value);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+  }
+}
+
+TEST(Deserializer, FixIntArrays) {
+  enum class Level : std::int16_t { Low = -20, Zero = 0, High = 1000 };
+
+  // Runs of single byte elements are decoded in bulk from buffer readers and
+  // the wider elements between them are decoded individually.
+  {
+    std::vector<EnumA> expected;
+    for (int i = 0; i < 100; i++) {
+      if (i % 37 == 36)
+        expected.push_back(EnumA::D);
+      else
+        expected.push_back(i % 2 ? EnumA::B : EnumA::A);
+    }
+    std::vector<std::uint8_t> data;
+    for (EnumA value : expected) {
+      if (value == EnumA::D)
+        data = Compose(data, EncodingByte::U8, 255);
+      else
+        data = Compose(data, static_cast<int>(value));
+    }
+    data = Compose(EncodingByte::Array, 100, data);
+
+    std::vector<EnumA> value{EnumA::C};
+    BufferReader reader{data.data(), data.size()};
+    Deserializer<BufferReader*> deserializer{&reader};
+    ASSERT_TRUE(deserializer.Read(&value));
+    EXPECT_EQ(expected, value);
+    EXPECT_TRUE(reader.empty());
+
+    // Readers without borrowing use the per-element path with the same result.
+    TestReader test_reader;
+    test_reader.Set(data);
+    Deserializer<TestReader*> test_deserializer{&test_reader};
+    value.clear();
+    ASSERT_TRUE(test_deserializer.Read(&value));
+    EXPECT_EQ(expected, value);
+  }
+
+  // Signed underlying types accept negative fixints in the bulk path.
+  {
+    std::array<Level, 40> expected;
+    for (std::size_t i = 0; i < expected.size(); i++)
+      expected[i] = i == 33 ? Level::High : (i % 3 ? Level::Low : Level::Zero);
+    Serializer<VectorWriter> serializer;
+    ASSERT_TRUE(serializer.Write(expected));
+    const std::vector<std::uint8_t>& data = serializer.writer().data();
+
+    std::array<Level, 40> value;
+    PedanticBufferReader reader{data.data(), data.size()};
+    Deserializer<PedanticBufferReader*> deserializer{&reader};
+    ASSERT_TRUE(deserializer.Read(&value));
+    EXPECT_EQ(expected, value);
+  }
+
+  // Chunked integral arrays decode their encoded elements the same way.
+  {
+    std::vector<std::uint8_t> data = Compose(
+        EncodingByte::ChunkedArray, 3, -1, 2, EncodingByte::I16,
+        Integer<std::int16_t>(-300), 2, 127, -32, 0);
+    std::vector<std::int16_t> value{5, 6, 7, 8, 9, 10};
+    PedanticBufferReader reader{data.data(), data.size()};
+    Deserializer<PedanticBufferReader*> deserializer{&reader};
+    ASSERT_TRUE(deserializer.Read(&value));
+    EXPECT_EQ((std::vector<std::int16_t>{-1, 2, -300, 127, -32}), value);
+  }
+
+  // Bytes that are not valid for the element type are rejected.
+  {
+    std::vector<std::uint8_t> data =
+        Compose(EncodingByte::Array, 3, 1, EncodingByte::Nil, 1);
+    std::vector<EnumA> value;
+    PedanticBufferReader reader{data.data(), data.size()};
+    Deserializer<PedanticBufferReader*> deserializer{&reader};
+    auto status = deserializer.Read(&value);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+
+    // Negative fixints do not match unsigned underlying types.
+    data = Compose(EncodingByte::Array, 2, 1, -1);
+    reader = PedanticBufferReader{data.data(), data.size()};
+    status = deserializer.Read(&value);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+  }
+
+  // Element counts larger than the remaining input are rejected up front.
+  {
+    std::vector<std::uint8_t> data = Compose(
+        EncodingByte::Array, EncodingByte::U32, Integer<std::uint32_t>(1 << 30),
+        1, 1, 1);
+    std::vector<EnumA> value;
+    BufferReader reader{data.data(), data.size()};
+    Deserializer<BufferReader*> deserializer{&reader};
+    auto status = deserializer.Read(&value);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+    EXPECT_TRUE(value.empty());
+  }
+}
+
+TEST(Deserializer, Skip) {
+  // Values of every class are skipped using only their encoding.
+  std::vector<std::uint8_t> data = Compose(
+      EncodingByte::U16, Integer<std::uint16_t>(1000), EncodingByte::F32,
+      Float(1.5f), EncodingByte::Nil, 0xff, EncodingByte::Binary, 3, 1, 2, 3,
+      EncodingByte::String, 2, "ab", EncodingByte::Array, 2, 1,
+      EncodingByte::Nil, EncodingByte::Map, 1, EncodingByte::String, 1, "k",
+      EncodingByte::True, EncodingByte::Structure, 1, EncodingByte::Variant, 0,
+      EncodingByte::I8, -5, EncodingByte::Handle, 1, 0, EncodingByte::Error, 3,
+      EncodingByte::ChunkedArray, 1, 7, 2, 8, 9, 0, EncodingByte::Table, 10, 2,
+      0, 1, 5, 1, 3, EncodingByte::Nil, 0, 0, EncodingByte::String, 3, "end");
+  const int kSkippedCount = 13;
+
+  PedanticBufferReader reader{data.data(), data.size()};
+  Deserializer<PedanticBufferReader*> deserializer{&reader};
+  for (int i = 0; i < kSkippedCount; i++)
+    ASSERT_TRUE(deserializer.Skip()) << "value " << i;
+
+  std::string value;
+  ASSERT_TRUE(deserializer.Read(&value));
+  EXPECT_EQ("end", value);
+  EXPECT_TRUE(reader.empty());
+
+  // Truncated byte strings are rejected before skipping.
+  data = Compose(EncodingByte::Binary, 4, 1, 2);
+  reader = PedanticBufferReader{data.data(), data.size()};
+  auto status = deserializer.Skip();
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+
+  // Prefixes without a defined layout cannot be skipped.
+  for (auto prefix : {EncodingByte::Extension, EncodingByte::ReservedMin,
+                      EncodingByte::ReservedMax}) {
+    data = Compose(prefix, 0);
+    reader = PedanticBufferReader{data.data(), data.size()};
+    status = deserializer.Skip();
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+  }
+}
+
+namespace {
+
+struct ProjectedRecord {
+  int id;
+  std::string name;
+  std::vector<std::string> tags;
+  std::uint8_t data[8];
+  std::size_t size;
+
+  NOP_STRUCTURE(ProjectedRecord, id, name, tags, (data, size));
+};
+
+struct ProjectedTable {
+  Entry<int, 0> id;
+  Entry<std::string, 1> name;
+  Entry<std::vector<std::string>, 2> tags;
+
+  NOP_TABLE(ProjectedTable, id, name, tags);
+};
+
+}  // anonymous namespace
+
+TEST(Deserializer, ReadProjected) {
+  // Unlisted structure members are skipped and keep their values.
+  {
+    ProjectedRecord record{7, "seven", {"a", "b"}, {1, 2, 3}, 3};
+    Serializer<std::unique_ptr<TestWriter>> serializer{
+        std::make_unique<TestWriter>()};
+    ASSERT_TRUE(serializer.Write(record));
+    const std::vector<std::uint8_t> data = serializer.writer().data();
+
+    ProjectedRecord value{0, "unchanged", {"x"}, {}, 0};
+    PedanticBufferReader reader{data.data(), data.size()};
+    Deserializer<PedanticBufferReader*> deserializer{&reader};
+    using IdAndBuffer = NOP_PROJECTION(ProjectedRecord, id, (data, size));
+    ASSERT_TRUE(deserializer.ReadProjected<IdAndBuffer>(&value));
+    EXPECT_TRUE(reader.empty());
+    EXPECT_EQ(7, value.id);
+    EXPECT_EQ("unchanged", value.name);
+    EXPECT_EQ((std::vector<std::string>{"x"}), value.tags);
+    ASSERT_EQ(3u, value.size);
+    EXPECT_EQ(3, value.data[2]);
+
+    // The encoding must still be a structure with all of the members.
+    const std::vector<std::uint8_t> wrong_count =
+        Compose(EncodingByte::Structure, 2, 7, EncodingByte::Nil);
+    reader = PedanticBufferReader{wrong_count.data(), wrong_count.size()};
+    auto status = deserializer.ReadProjected<IdAndBuffer>(&value);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::InvalidMemberCount, status.error());
+
+    const std::vector<std::uint8_t> wrong_type = Compose(EncodingByte::Nil);
+    reader = PedanticBufferReader{wrong_type.data(), wrong_type.size()};
+    status = deserializer.ReadProjected<IdAndBuffer>(&value);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+  }
+
+  // Unlisted table entries are skipped and left empty.
+  {
+    ProjectedTable table;
+    table.id = 9;
+    table.name = "nine";
+    table.tags = std::vector<std::string>{"c"};
+    Serializer<std::unique_ptr<TestWriter>> serializer{
+        std::make_unique<TestWriter>()};
+    ASSERT_TRUE(serializer.Write(table));
+    const std::vector<std::uint8_t> data = serializer.writer().data();
+
+    ProjectedTable value;
+    value.name = "stale";
+    PedanticBufferReader reader{data.data(), data.size()};
+    Deserializer<PedanticBufferReader*> deserializer{&reader};
+    using Tags = NOP_PROJECTION(ProjectedTable, tags);
+    ASSERT_TRUE(deserializer.ReadProjected<Tags>(&value));
+    EXPECT_TRUE(reader.empty());
+    EXPECT_FALSE(value.id);
+    EXPECT_FALSE(value.name);
+    ASSERT_TRUE(value.tags);
+    EXPECT_EQ((std::vector<std::string>{"c"}), value.tags.get());
+  }
+}
+
+namespace {
+
+enum class FusedKind : std::uint16_t { A = 1, B = 1000 };
+
+struct FusedRecord {
+  std::int32_t a;
+  std::uint64_t b;
+  bool c;
+  FusedKind d;
+  double e;
+  std::string name;
+  std::int8_t f;
+  float g;
+  std::vector<std::int16_t> values;
+  std::uint16_t h;
+  std::uint64_t wide[2];
+  NOP_STRUCTURE(FusedRecord, a, b, c, d, e, name, f, g, values, h, wide);
+};
+
+struct FusedWide {
+  std::uint64_t v[40];
+  NOP_STRUCTURE(FusedWide, v);
+};
+
+struct FusedLong {
+  std::uint64_t a0, a1, a2, a3, a4, a5, a6, a7, a8, a9;
+  std::uint64_t b0, b1, b2, b3, b4, b5, b6, b7, b8, b9;
+  std::uint64_t c0, c1, c2, c3, c4, c5, c6, c7, c8, c9;
+  NOP_STRUCTURE(FusedLong, a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, b0, b1, b2,
+                b3, b4, b5, b6, b7, b8, b9, c0, c1, c2, c3, c4, c5, c6, c7, c8,
+                c9);
+};
+
+// Borrowing writer that counts the calls made to it.
+struct CountingVectorWriter : VectorWriter {
+  Status<void> Write(std::uint8_t byte) {
+    write_count++;
+    return VectorWriter::Write(byte);
+  }
+
+  template <typename T>
+  Status<void> Write(const T* begin, const T* end) {
+    write_count++;
+    return VectorWriter::Write(begin, end);
+  }
+
+  std::size_t write_count{0};
+};
+
+}  // anonymous namespace
+
+TEST(Serializer, FusedMembers) {
+  FusedRecord record{-70000,
+                     1ull << 40,
+                     true,
+                     FusedKind::B,
+                     1.5,
+                     "fused",
+                     -100,
+                     2.5f,
+                     {1, -2, 300},
+                     65535,
+                     {7, 1ull << 63}};
+
+  // Writers that do not borrow take every member separately.
+  Serializer<TestWriter> expected;
+  ASSERT_TRUE(expected.Write(record));
+
+  Serializer<CountingVectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(record));
+  EXPECT_EQ(expected.writer().data(), serializer.writer().data());
+
+  // Prefix and count, the run a..e, the string, the run f..g, the vector, the
+  // lone member h and the array.
+  EXPECT_EQ(2u + 1u + 3u + 1u + 3u + 2u + 3u,
+            serializer.writer().write_count);
+
+  FusedRecord result;
+  Deserializer<BufferReader> deserializer{serializer.writer().data().data(),
+                                          serializer.writer().size()};
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(record.b, result.b);
+  EXPECT_EQ(record.d, result.d);
+  EXPECT_EQ(record.g, result.g);
+  EXPECT_EQ(record.h, result.h);
+  EXPECT_EQ(record.values, result.values);
+
+  // Runs are split to bound the stack block.
+  FusedLong long_record{};
+  long_record.c9 = ~0ull;
+  Serializer<TestWriter> expected_long;
+  ASSERT_TRUE(expected_long.Write(long_record));
+  Serializer<CountingVectorWriter> long_serializer;
+  ASSERT_TRUE(long_serializer.Write(long_record));
+  EXPECT_EQ(expected_long.writer().data(), long_serializer.writer().data());
+  EXPECT_EQ(2u + 2u, long_serializer.writer().write_count);
+
+  // Structures of a single array are written as before.
+  FusedWide wide{};
+  Serializer<TestWriter> expected_wide;
+  ASSERT_TRUE(expected_wide.Write(wide));
+  Serializer<VectorWriter> wide_serializer;
+  ASSERT_TRUE(wide_serializer.Write(wide));
+  EXPECT_EQ(expected_wide.writer().data(), wide_serializer.writer().data());
+}
+
+namespace {
+
+// Borrowing reader that counts the reads made from it.
+struct CountingBufferReader : PedanticBufferReader {
+  using PedanticBufferReader::PedanticBufferReader;
+
+  Status<void> Read(std::uint8_t* byte) {
+    read_count++;
+    return PedanticBufferReader::Read(byte);
+  }
+
+  template <typename T>
+  Status<void> Read(T* begin, T* end) {
+    read_count++;
+    return PedanticBufferReader::Read(begin, end);
+  }
+
+  std::size_t read_count{0};
+};
+
+}  // anonymous namespace
+
+TEST(Deserializer, FusedMembers) {
+  const FusedRecord record{1,   2, false, FusedKind::A, -0.25, "x", 3, 4.0f,
+                           {5}, 6, {7, 8}};
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(record));
+  const std::vector<std::uint8_t> data = serializer.writer().data();
+
+  CountingBufferReader reader{data.data(), data.size()};
+  Deserializer<CountingBufferReader*> deserializer{&reader};
+  FusedRecord result;
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_TRUE(reader.empty());
+  EXPECT_EQ(record.a, result.a);
+  EXPECT_EQ(record.e, result.e);
+  EXPECT_EQ(record.name, result.name);
+  EXPECT_EQ(record.g, result.g);
+  EXPECT_EQ(record.values, result.values);
+  EXPECT_EQ(record.h, result.h);
+  EXPECT_EQ(record.wide[1], result.wide[1]);
+
+  // Only the prefix, count, string, vector and lone member h are read through
+  // the reader.
+  EXPECT_EQ(2u + 3u + 3u + 1u + 3u, reader.read_count);
+
+  // Runs near the end of the input are read member by member, so every
+  // truncation is detected.
+  for (std::size_t size = 0; size < data.size(); size++) {
+    PedanticBufferReader truncated{data.data(), size};
+    Deserializer<PedanticBufferReader*> truncated_deserializer{&truncated};
+    auto status = truncated_deserializer.Read(&result);
+    ASSERT_FALSE(status) << "size " << size;
+    EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+  }
+
+  // Invalid member encodings within a run are still rejected.
+  std::vector<std::uint8_t> invalid = data;
+  invalid[2] = static_cast<std::uint8_t>(EncodingByte::Nil);
+  invalid.resize(invalid.size() + 64);
+  PedanticBufferReader invalid_reader{invalid.data(), invalid.size()};
+  Deserializer<PedanticBufferReader*> invalid_deserializer{&invalid_reader};
+  auto status = invalid_deserializer.Read(&result);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+
+  FusedLong long_record{};
+  long_record.a0 = 1;
+  long_record.c9 = ~0ull;
+  Serializer<TestWriter> long_serializer;
+  ASSERT_TRUE(long_serializer.Write(long_record));
+  FusedLong long_result;
+  Deserializer<BufferReader> long_deserializer{
+      long_serializer.writer().data().data(),
+      long_serializer.writer().data().size()};
+  ASSERT_TRUE(long_deserializer.Read(&long_result));
+  EXPECT_EQ(1u, long_result.a0);
+  EXPECT_EQ(~0ull, long_result.c9);
+}
+
+namespace {
+
+struct FusedTable {
+  Entry<FusedRecord, 0> record;
+  Entry<int, 1> unused;
+  NOP_TABLE(FusedTable, record, unused);
+};
+
+}  // anonymous namespace
+
+TEST(Serializer, FusedMembersInTable) {
+  // Table entries are written through a BoundedWriter over a SizeCacheWriter,
+  // both of which forward borrowing.
+  static_assert(
+      nop::IsBorrowingWriter<
+          BoundedWriter<nop::SizeCacheWriter<CountingVectorWriter>>>::value,
+      "");
+
+  FusedTable table;
+  Serializer<CountingVectorWriter> empty_serializer;
+  ASSERT_TRUE(empty_serializer.Write(table));
+
+  table.record = FusedRecord{-70000,
+                             1ull << 40,
+                             true,
+                             FusedKind::B,
+                             1.5,
+                             "fused",
+                             -100,
+                             2.5f,
+                             {1, -2, 300},
+                             65535,
+                             {7, 1ull << 63}};
+  Serializer<TestWriter> expected;
+  ASSERT_TRUE(expected.Write(table));
+
+  Serializer<CountingVectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(table));
+  EXPECT_EQ(expected.writer().data(), serializer.writer().data());
+
+  // The entry id and size, then the record written in runs as above.
+  EXPECT_EQ(1u + 1u + 2u + 1u + 3u + 1u + 3u + 2u + 3u,
+            serializer.writer().write_count -
+                empty_serializer.writer().write_count);
+
+  FusedTable result;
+  Deserializer<BufferReader> deserializer{serializer.writer().data().data(),
+                                          serializer.writer().size()};
+  ASSERT_TRUE(deserializer.Read(&result));
+  ASSERT_TRUE(result.record);
+  EXPECT_EQ(table.record.get().b, result.record.get().b);
+  EXPECT_EQ(table.record.get().values, result.record.get().values);
+
+  // Borrowing through a BoundedWriter is limited to the remaining space.
+  VectorWriter vector_writer;
+  BoundedWriter<VectorWriter> bounded_writer{&vector_writer, 4};
+  void* data = nullptr;
+  auto status = bounded_writer.Borrow(&data, 5);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, status.error());
+
+  ASSERT_TRUE(bounded_writer.Borrow(&data, 4));
+  EXPECT_NE(nullptr, data);
+  EXPECT_EQ(4u, bounded_writer.size());
+  EXPECT_EQ(4u, vector_writer.size());
+}
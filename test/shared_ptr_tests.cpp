@@ -0,0 +1,311 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/lazy.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/object_table_reader.h>
+#include <nop/utility/object_table_writer.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BufferReader;
+using nop::Decode;
+using nop::Deserializer;
+using nop::Encode;
+using nop::EncodingByte;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::Lazy;
+using nop::ObjectTableReader;
+using nop::ObjectTableWriter;
+using nop::Serializer;
+using nop::SkipValue;
+using nop::Status;
+using nop::VectorWriter;
+
+namespace {
+
+using TableWriter = ObjectTableWriter<VectorWriter>;
+using TableReader = ObjectTableReader<BufferReader>;
+
+struct Node {
+  std::string name;
+  std::vector<std::shared_ptr<Node>> children;
+
+  NOP_STRUCTURE(Node, name, children);
+};
+
+std::shared_ptr<Node> MakeNode(std::string name,
+                               std::vector<std::shared_ptr<Node>> children) {
+  return std::make_shared<Node>(Node{std::move(name), std::move(children)});
+}
+
+// Returns a graph of |depth| levels where each level points twice to the next.
+std::shared_ptr<Node> MakeLadder(int depth) {
+  std::shared_ptr<Node> node = MakeNode("leaf", {});
+  for (int i = 0; i < depth; i++)
+    node = MakeNode(std::to_string(i), {node, node});
+  return node;
+}
+
+// Versions of a table where the reader does not know the first entry.
+struct WriterTable {
+  Entry<std::shared_ptr<int>, 0> extra;
+  Entry<std::shared_ptr<int>, 1> value;
+
+  NOP_TABLE_NS("SharedTable", WriterTable, extra, value);
+};
+
+struct ReaderTable {
+  Entry<std::shared_ptr<int>, 1> value;
+
+  NOP_TABLE_NS("SharedTable", ReaderTable, value);
+};
+
+}  // anonymous namespace
+
+TEST(SharedPtr, WithoutTable) {
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(std::shared_ptr<int>{}));
+  EXPECT_EQ(std::vector<std::uint8_t>{0xbe}, serializer.writer().data());
+
+  // Without a table each pointer is written as its object.
+  serializer.writer().clear();
+  auto shared = std::make_shared<const std::string>("shared");
+  std::vector<std::shared_ptr<const std::string>> values{shared, shared};
+  ASSERT_TRUE(serializer.Write(values));
+  std::vector<std::uint8_t> expected = serializer.writer().data();
+
+  serializer.writer().clear();
+  ASSERT_TRUE(serializer.Write(std::vector<std::string>{"shared", "shared"}));
+  EXPECT_EQ(expected, serializer.writer().data());
+
+  std::vector<std::shared_ptr<const std::string>> decoded;
+  Deserializer<BufferReader> deserializer{expected.data(), expected.size()};
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  ASSERT_EQ(2u, decoded.size());
+  EXPECT_EQ("shared", *decoded[0]);
+  EXPECT_EQ("shared", *decoded[1]);
+  EXPECT_NE(decoded[0], decoded[1]);
+
+  // Definitions and references require a table.
+  const std::vector<std::uint8_t> bytes = Encode<TableWriter>(values);
+  Deserializer<BufferReader> plain_deserializer{bytes.data(), bytes.size()};
+  Status<void> status = plain_deserializer.Read(&decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidObjectReference, status.error());
+}
+
+TEST(SharedPtr, Sharing) {
+  std::shared_ptr<Node> shared = MakeNode("shared", {});
+  std::shared_ptr<Node> root = MakeNode(
+      "root", {MakeNode("a", {shared}), MakeNode("b", {shared}), nullptr});
+
+  std::shared_ptr<Node> decoded;
+  ASSERT_TRUE(Decode<TableReader>(Encode<TableWriter>(root), &decoded));
+  ASSERT_TRUE(decoded);
+  EXPECT_EQ("root", decoded->name);
+  ASSERT_EQ(3u, decoded->children.size());
+  EXPECT_EQ("a", decoded->children[0]->name);
+  EXPECT_EQ("b", decoded->children[1]->name);
+  EXPECT_FALSE(decoded->children[2]);
+  ASSERT_EQ(1u, decoded->children[0]->children.size());
+  ASSERT_EQ(1u, decoded->children[1]->children.size());
+  EXPECT_EQ("shared", decoded->children[0]->children[0]->name);
+  EXPECT_EQ(decoded->children[0]->children[0],
+            decoded->children[1]->children[0]);
+}
+
+TEST(SharedPtr, Ladder) {
+  // The encoding grows with the number of distinct nodes, not the number of
+  // paths through the graph.
+  const std::vector<std::uint8_t> bytes = Encode<TableWriter>(MakeLadder(16));
+  EXPECT_GT(16u * 16u, bytes.size());
+
+  std::shared_ptr<Node> decoded;
+  ASSERT_TRUE(Decode<TableReader>(bytes, &decoded));
+  std::shared_ptr<Node> node = decoded;
+  for (int i = 15; i >= 0; i--) {
+    ASSERT_TRUE(node);
+    EXPECT_EQ(std::to_string(i), node->name);
+    ASSERT_EQ(2u, node->children.size());
+    EXPECT_EQ(node->children[0], node->children[1]);
+    node = node->children[0];
+  }
+  ASSERT_TRUE(node);
+  EXPECT_EQ("leaf", node->name);
+  EXPECT_TRUE(node->children.empty());
+}
+
+TEST(SharedPtr, Session) {
+  auto value = std::make_shared<std::string>("value");
+
+  Serializer<ObjectTableWriter<VectorWriter>> serializer;
+  ASSERT_TRUE(serializer.Write(value));
+  ASSERT_TRUE(serializer.Write(value));
+  EXPECT_EQ(1u, serializer.writer().table().size());
+
+  // The second value is a reference to the first.
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+  ASSERT_EQ(10u, bytes.size());
+  EXPECT_EQ(static_cast<std::uint8_t>(EncodingByte::ObjectDefinition),
+            bytes[0]);
+  EXPECT_EQ(static_cast<std::uint8_t>(EncodingByte::ObjectReference), bytes[8]);
+  EXPECT_EQ(0u, bytes[9]);
+
+  Deserializer<ObjectTableReader<BufferReader>> deserializer{bytes.data(),
+                                                             bytes.size()};
+  std::shared_ptr<std::string> first;
+  std::shared_ptr<std::string> second;
+  ASSERT_TRUE(deserializer.Read(&first));
+  ASSERT_TRUE(deserializer.Read(&second));
+  EXPECT_EQ("value", *first);
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(1u, deserializer.reader().table().size());
+
+  // Resetting the table defines the object again.
+  serializer.writer().table().Reset();
+  ASSERT_TRUE(serializer.Write(value));
+  EXPECT_EQ(static_cast<std::uint8_t>(EncodingByte::ObjectDefinition),
+            serializer.writer().writer().data()[10]);
+}
+
+TEST(SharedPtr, Errors) {
+  std::shared_ptr<int> value;
+
+  // References to unknown objects.
+  Status<void> status = Decode<TableReader>({0xae, 0x00}, &value);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidObjectReference, status.error());
+
+  // References to objects of another type.
+  const std::vector<std::uint8_t> bytes = {0xaf, 0x05, 0xae, 0x00};
+  Deserializer<ObjectTableReader<BufferReader>> deserializer{bytes.data(),
+                                                             bytes.size()};
+  ASSERT_TRUE(deserializer.Read(&value));
+  EXPECT_EQ(5, *value);
+  std::shared_ptr<std::uint64_t> other;
+  status = deserializer.Read(&other);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidObjectReference, status.error());
+
+  // References to an object that is still being decoded.
+  std::shared_ptr<Node> node;
+  status = Decode<TableReader>(
+      {0xaf, 0xb9, 0x02, 0xbd, 0x00, 0xba, 0x01, 0xae, 0x00}, &node);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidObjectReference, status.error());
+
+  // The type of the object determines which encodings are accepted.
+  status = Decode<TableReader>({0xaf, 0xbd, 0x00}, &value);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+}
+
+TEST(SharedPtr, SkipValue) {
+  Serializer<ObjectTableWriter<VectorWriter>> serializer;
+  ASSERT_TRUE(serializer.Write(MakeLadder(4)));
+  ASSERT_TRUE(serializer.Write(std::string{"end"}));
+
+  const VectorWriter& writer = serializer.writer().writer();
+  BufferReader reader{writer.data().data(), writer.size()};
+  ASSERT_TRUE(SkipValue(&reader));
+
+  std::string end;
+  Deserializer<BufferReader*> deserializer{&reader};
+  ASSERT_TRUE(deserializer.Read(&end));
+  EXPECT_EQ("end", end);
+}
+
+TEST(SharedPtr, SkipDefinitions) {
+  auto a = std::make_shared<int>(1);
+  auto b = std::make_shared<int>(2);
+
+  Serializer<ObjectTableWriter<VectorWriter>> serializer;
+  ASSERT_TRUE(serializer.Write(a));
+  ASSERT_TRUE(serializer.Write(b));
+  ASSERT_TRUE(serializer.Write(b));
+  ASSERT_TRUE(serializer.Write(a));
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+
+  // The skipped definition takes an id, so later references resolve to the
+  // objects the writer meant.
+  Deserializer<ObjectTableReader<BufferReader>> deserializer{bytes.data(),
+                                                             bytes.size()};
+  ASSERT_TRUE(deserializer.Skip());
+  EXPECT_EQ(1u, deserializer.reader().table().size());
+
+  std::shared_ptr<int> first;
+  std::shared_ptr<int> second;
+  ASSERT_TRUE(deserializer.Read(&first));
+  ASSERT_TRUE(deserializer.Read(&second));
+  EXPECT_EQ(2, *first);
+  EXPECT_EQ(first, second);
+
+  // References to the skipped object fail rather than resolve to another.
+  std::shared_ptr<int> skipped;
+  Status<void> status = deserializer.Read(&skipped);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidObjectReference, status.error());
+
+  // Lazy values are decoded at once when read with an object table.
+  Deserializer<ObjectTableReader<BufferReader>> lazy_deserializer{
+      bytes.data(), bytes.size()};
+  Lazy<std::shared_ptr<int>> lazy;
+  ASSERT_TRUE(lazy_deserializer.Read(&lazy));
+  ASSERT_TRUE(lazy_deserializer.Read(&second));
+  ASSERT_TRUE(lazy_deserializer.Read(&second));
+  ASSERT_TRUE(lazy_deserializer.Read(&first));
+  EXPECT_EQ(1, *first);
+  ASSERT_TRUE(lazy.is_decoded());
+  EXPECT_EQ(first, *lazy.get().get());
+}
+
+TEST(SharedPtr, SkippedEntry) {
+  auto a = std::make_shared<int>(1);
+  auto b = std::make_shared<int>(2);
+
+  WriterTable table;
+  table.extra = a;
+  table.value = b;
+
+  Serializer<ObjectTableWriter<VectorWriter>> serializer;
+  ASSERT_TRUE(serializer.Write(table));
+  ASSERT_TRUE(serializer.Write(b));
+  const std::vector<std::uint8_t>& bytes = serializer.writer().writer().data();
+
+  // The definition in the unknown entry is counted while it is skipped.
+  Deserializer<ObjectTableReader<BufferReader>> deserializer{bytes.data(),
+                                                             bytes.size()};
+  ReaderTable decoded;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  ASSERT_TRUE(decoded.value);
+  EXPECT_EQ(2, *decoded.value.get());
+  EXPECT_EQ(2u, deserializer.reader().table().size());
+
+  std::shared_ptr<int> value;
+  ASSERT_TRUE(deserializer.Read(&value));
+  EXPECT_EQ(decoded.value.get(), value);
+}
@@ -0,0 +1,153 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/shared_ring.h>
+#include <nop/utility/shared_ring_reader.h>
+#include <nop/utility/shared_ring_writer.h>
+
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::Serializer;
+using nop::SharedRing;
+using nop::SharedRingReader;
+using nop::SharedRingWriter;
+using nop::Status;
+
+namespace {
+
+struct Message {
+  int a;
+  std::string b;
+  std::vector<std::uint8_t> c;
+
+  bool operator==(const Message& other) const {
+    return a == other.a && b == other.b && c == other.c;
+  }
+
+  NOP_STRUCTURE(Message, a, b, c);
+};
+
+// Shared anonymous mapping that holds a ring.
+class SharedRegion {
+ public:
+  SharedRegion(std::size_t capacity)
+      : size_{SharedRing::RegionSize(capacity)},
+        memory_{::mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0)} {}
+  ~SharedRegion() { ::munmap(memory_, size_); }
+
+  SharedRing ring() const { return {memory_, size_}; }
+
+ private:
+  std::size_t size_;
+  void* memory_;
+};
+
+}  // anonymous namespace
+
+TEST(SharedRing, ReadWrite) {
+  SharedRegion region{1024};
+  SharedRing ring = region.ring();
+  ASSERT_TRUE(ring.Initialize());
+  EXPECT_EQ(1024u, ring.capacity());
+
+  Serializer<SharedRingWriter> serializer{ring};
+  Deserializer<SharedRingReader> deserializer{ring};
+
+  // Write and read enough messages to wrap around the ring several times.
+  for (int i = 0; i < 100; i++) {
+    const Message message{i, std::string(i, 'x'),
+                          std::vector<std::uint8_t>(i * 2, 0x55)};
+    ASSERT_TRUE(serializer.Write(message));
+
+    Message result;
+    ASSERT_TRUE(deserializer.Read(&result));
+    EXPECT_EQ(message, result);
+    EXPECT_EQ(0u, deserializer.reader().remaining());
+  }
+}
+
+TEST(SharedRing, Full) {
+  SharedRegion region{256};
+  SharedRing ring = region.ring();
+  ASSERT_TRUE(ring.Initialize());
+
+  Serializer<SharedRingWriter> serializer{ring};
+  Deserializer<SharedRingReader> deserializer{ring};
+
+  // Messages too large for the ring are rejected outright.
+  const Message large{1, "", std::vector<std::uint8_t>(300, 0x11)};
+  Status<void> status = serializer.Write(large);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, status.error());
+
+  // Fill the ring until the writer reports that it is full.
+  const Message message{2, "foo", std::vector<std::uint8_t>(40, 0x22)};
+  int count = 0;
+  while (serializer.Write(message))
+    count++;
+  EXPECT_LT(0, count);
+
+  // Consuming a record makes room for another.
+  Message result;
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(message, result);
+  ASSERT_TRUE(serializer.Write(message));
+
+  for (int i = 0; i < count; i++) {
+    ASSERT_TRUE(deserializer.Read(&result));
+    EXPECT_EQ(message, result);
+  }
+}
+
+TEST(SharedRing, Threads) {
+  SharedRegion region{4096};
+  SharedRing ring = region.ring();
+  ASSERT_TRUE(ring.Initialize());
+
+  const int kMessageCount = 10000;
+  std::thread producer{[ring] {
+    Serializer<SharedRingWriter> serializer{ring};
+    for (int i = 0; i < kMessageCount; i++) {
+      const Message message{i, "message", std::vector<std::uint8_t>(i % 100)};
+      while (!serializer.Write(message))
+        std::this_thread::yield();
+    }
+  }};
+
+  Deserializer<SharedRingReader> deserializer{ring, std::size_t{100}};
+  Message result;
+  for (int i = 0; i < kMessageCount; i++) {
+    ASSERT_TRUE(deserializer.Read(&result));
+    EXPECT_EQ(i, result.a);
+    EXPECT_EQ(static_cast<std::size_t>(i % 100), result.c.size());
+  }
+
+  producer.join();
+
+  // The writer closes the ring when it is destroyed.
+  Status<void> status = deserializer.Read(&result);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
@@ -14,12 +14,14 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <array>
 
 #include <nop/utility/sip_hash.h>
 
 using nop::BlockReader;
 using nop::SipHash;
+using nop::SipHasher;
 
 namespace {
 
@@ -123,3 +125,58 @@ TEST(SipHash, Vectors) {
         SipHash::Compute(BlockReader<std::uint8_t>(input.data(), i), k0, k1));
   }
 }
+
+TEST(SipHasher, Incremental) {
+  const std::uint64_t k0 = 0x0706050403020100;
+  const std::uint64_t k1 = 0x0f0e0d0c0b0a0908;
+
+  std::array<std::uint8_t, kMaxLength> input;
+  for (std::size_t i = 0; i < kMaxLength; i++)
+    input[i] = i;
+
+  for (std::size_t length = 0; length < kMaxLength; length++) {
+    EXPECT_EQ(VectorToInt(kVectors[length]),
+              SipHasher<64>::Compute(input.data(), length, k0, k1));
+
+    // Splitting the input into pieces must not change the hash.
+    for (std::size_t piece = 1; piece <= 9; piece++) {
+      SipHasher<64> hasher{k0, k1};
+      for (std::size_t offset = 0; offset < length; offset += piece)
+        hasher.Update(input.data() + offset, std::min(piece, length - offset));
+      EXPECT_EQ(VectorToInt(kVectors[length]), hasher.value())
+          << "length=" << length << " piece=" << piece;
+    }
+  }
+
+  // The hash may be read before more bytes are folded in.
+  SipHasher<64> hasher{k0, k1};
+  hasher.Update(input.data(), 5);
+  EXPECT_EQ(VectorToInt(kVectors[5]), hasher.value());
+  hasher.Update(input.data() + 5, 10);
+  EXPECT_EQ(VectorToInt(kVectors[15]), hasher.value());
+
+  hasher.Reset();
+  EXPECT_EQ(VectorToInt(kVectors[0]), hasher.value());
+}
+
+TEST(SipHasher, Wide) {
+  const std::uint64_t k0 = 0x0706050403020100;
+  const std::uint64_t k1 = 0x0f0e0d0c0b0a0908;
+
+  // First SipHash-2-4-128 reference vector, for the empty input.
+  const std::array<std::uint64_t, 2> expected{
+      {VectorToInt({{0xa3, 0x81, 0x7f, 0x04, 0xba, 0x25, 0xa8, 0xe6}}),
+       VectorToInt({{0x6d, 0xf6, 0x72, 0x14, 0xc7, 0x55, 0x02, 0x93}})}};
+  EXPECT_EQ(expected, SipHasher<128>::Compute(nullptr, 0, k0, k1));
+
+  std::array<std::uint8_t, kMaxLength> input;
+  for (std::size_t i = 0; i < kMaxLength; i++)
+    input[i] = i;
+
+  SipHasher<128> hasher{k0, k1};
+  for (std::size_t i = 0; i < kMaxLength; i++)
+    hasher.Update(&input[i], 1);
+  EXPECT_EQ(SipHasher<128>::Compute(input.data(), kMaxLength, k0, k1),
+            hasher.value());
+  EXPECT_NE(expected, hasher.value());
+}
@@ -0,0 +1,105 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <istream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <utility>
+
+#include <nop/utility/stream_reader.h>
+#include <nop/utility/stream_writer.h>
+
+using nop::ErrorStatus;
+using nop::Status;
+using nop::StreamReader;
+using nop::StreamWriter;
+
+namespace {
+
+// Stream buffer over a string that does not support seeking.
+class UnseekableBuffer : public std::streambuf {
+ public:
+  UnseekableBuffer(std::string data) : data_{std::move(data)} {
+    setg(&data_[0], &data_[0], &data_[0] + data_.size());
+  }
+
+ private:
+  std::string data_;
+};
+
+// Input stream that owns an UnseekableBuffer.
+class UnseekableStream : public std::istream {
+ public:
+  UnseekableStream(std::string data)
+      : std::istream{nullptr}, buffer_{std::move(data)} {
+    rdbuf(&buffer_);
+  }
+
+ private:
+  UnseekableBuffer buffer_;
+};
+
+}  // anonymous namespace
+
+TEST(StreamWriter, Skip) {
+  StreamWriter<std::stringstream> writer;
+
+  ASSERT_TRUE(writer.Write(0x01));
+  ASSERT_TRUE(writer.Skip(1000, 0xaa));
+  ASSERT_TRUE(writer.Skip(0));
+  ASSERT_TRUE(writer.Write(0x02));
+
+  std::string expected = "\x01";
+  expected += std::string(1000, '\xaa');
+  expected += "\x02";
+  EXPECT_EQ(expected, writer.stream().str());
+}
+
+TEST(StreamReader, Skip) {
+  std::string data;
+  for (int i = 0; i < 1000; i++)
+    data.push_back(static_cast<char>(i));
+
+  StreamReader<std::stringstream> reader{data};
+  std::uint8_t byte = 0;
+
+  ASSERT_TRUE(reader.Skip(500));
+  ASSERT_TRUE(reader.Read(&byte));
+  EXPECT_EQ(static_cast<std::uint8_t>(500), byte);
+
+  Status<void> status = reader.Skip(1000);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::StreamError, status.error());
+}
+
+TEST(StreamReader, SkipUnseekable) {
+  std::string data;
+  for (int i = 0; i < 1000; i++)
+    data.push_back(static_cast<char>(i));
+
+  StreamReader<UnseekableStream> reader{data};
+  std::uint8_t byte = 0;
+
+  ASSERT_TRUE(reader.Skip(500));
+  ASSERT_TRUE(reader.Read(&byte));
+  EXPECT_EQ(static_cast<std::uint8_t>(500), byte);
+
+  Status<void> status = reader.Skip(1000);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::StreamError, status.error());
+}
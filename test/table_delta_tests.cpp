@@ -0,0 +1,253 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/table.h>
+#include <nop/types/table_delta.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BufferReader;
+using nop::Decode;
+using nop::DeletedEntry;
+using nop::Deserializer;
+using nop::Encode;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::IndirectEntry;
+using nop::Serializer;
+using nop::Status;
+using nop::TableDelta;
+using nop::VectorWriter;
+
+namespace {
+
+struct Config {
+  Entry<std::string, 0> name;
+  Entry<std::map<std::string, int>, 1> limits;
+  Entry<std::vector<std::string>, 2> peers;
+  Entry<int, 3, DeletedEntry> timeout;
+  Entry<int, 10> replicas;
+
+  NOP_TABLE_NS("Config", Config, name, limits, peers, timeout, replicas);
+};
+
+// Newer definition of Config with an entry older code does not know.
+struct ConfigV2 {
+  Entry<std::string, 0> name;
+  Entry<std::map<std::string, int>, 1> limits;
+  Entry<std::vector<std::string>, 2> peers;
+  Entry<int, 3, DeletedEntry> timeout;
+  Entry<int, 10> replicas;
+  Entry<std::string, 11> region;
+
+  NOP_TABLE_NS("Config", ConfigV2, name, limits, peers, timeout, replicas,
+               region);
+};
+
+// Config with values stored out-of-line, which encodes the same.
+struct IndirectConfig {
+  Entry<std::string, 0, IndirectEntry> name;
+  Entry<std::map<std::string, int>, 1, IndirectEntry> limits;
+  Entry<std::vector<std::string>, 2, IndirectEntry> peers;
+  Entry<int, 3, DeletedEntry> timeout;
+  Entry<int, 10, IndirectEntry> replicas;
+
+  NOP_TABLE_NS("Config", IndirectConfig, name, limits, peers, timeout,
+               replicas);
+};
+
+struct Other {
+  Entry<int, 0> value;
+
+  NOP_TABLE_NS("Other", Other, value);
+};
+
+Config MakeConfig() {
+  Config config;
+  config.name = std::string{"cluster"};
+  config.limits = std::map<std::string, int>{{"cpu", 8}, {"memory", 64}};
+  config.peers = std::vector<std::string>(100, std::string(20, 'p'));
+  config.replicas = 3;
+  return config;
+}
+
+}  // anonymous namespace
+
+TEST(TableDelta, Apply) {
+  const Config previous = MakeConfig();
+  Config current = MakeConfig();
+  current.limits.get()["cpu"] = 16;
+  current.name.clear();
+  current.replicas = 5;
+
+  const std::vector<std::uint8_t> bytes =
+      Encode(TableDelta<Config>{previous, 7, current, 8});
+
+  // Unchanged entries are not sent.
+  EXPECT_LT(bytes.size() * 10, Encode(current).size());
+
+  Config replica = MakeConfig();
+  std::uint64_t version = 7;
+  TableDelta<Config> delta{&replica, &version};
+  ASSERT_TRUE(Decode(bytes, &delta));
+  EXPECT_EQ(7u, delta.base_version());
+  EXPECT_EQ(8u, delta.version());
+  EXPECT_EQ(8u, version);
+
+  EXPECT_FALSE(replica.name);
+  ASSERT_TRUE(replica.limits);
+  EXPECT_EQ(16, replica.limits.get().at("cpu"));
+  EXPECT_EQ(64, replica.limits.get().at("memory"));
+  ASSERT_TRUE(replica.peers);
+  EXPECT_EQ(previous.peers.get(), replica.peers.get());
+  ASSERT_TRUE(replica.replicas);
+  EXPECT_EQ(5, replica.replicas.get());
+  EXPECT_EQ(Encode(current), Encode(replica));
+
+  // Adding an entry back.
+  Config next = current;
+  next.name = std::string{"renamed"};
+  ASSERT_TRUE(Decode(Encode(TableDelta<Config>{current, 8, next, 9}), &delta));
+  EXPECT_EQ(9u, version);
+  ASSERT_TRUE(replica.name);
+  EXPECT_EQ("renamed", replica.name.get());
+  EXPECT_EQ(Encode(next), Encode(replica));
+}
+
+TEST(TableDelta, IndirectEntries) {
+  IndirectConfig previous;
+  previous.name = std::string{"cluster"};
+  previous.peers = std::vector<std::string>(100, std::string(20, 'p'));
+  previous.replicas = 3;
+
+  IndirectConfig current = previous;
+  current.name.clear();
+  current.replicas = 5;
+
+  const std::vector<std::uint8_t> bytes =
+      Encode(TableDelta<IndirectConfig>{previous, 1, current, 2});
+  EXPECT_LT(bytes.size() * 10, Encode(current).size());
+
+  // Deltas apply to tables with either entry storage.
+  Config replica;
+  ASSERT_TRUE(Decode(Encode(previous), &replica));
+  std::uint64_t version = 1;
+  TableDelta<Config> delta{&replica, &version};
+  ASSERT_TRUE(Decode(bytes, &delta));
+  EXPECT_FALSE(replica.name);
+  ASSERT_TRUE(replica.peers);
+  EXPECT_EQ(previous.peers.get(), replica.peers.get());
+  ASSERT_TRUE(replica.replicas);
+  EXPECT_EQ(5, replica.replicas.get());
+
+  IndirectConfig indirect_replica = previous;
+  version = 1;
+  TableDelta<IndirectConfig> indirect_delta{&indirect_replica, &version};
+  ASSERT_TRUE(Decode(bytes, &indirect_delta));
+  EXPECT_FALSE(indirect_replica.name);
+  EXPECT_EQ(5, indirect_replica.replicas.get());
+}
+
+TEST(TableDelta, Empty) {
+  const Config config = MakeConfig();
+  const std::vector<std::uint8_t> bytes =
+      Encode(TableDelta<Config>{config, 1, config, 2});
+
+  Config replica = config;
+  std::uint64_t version = 1;
+  TableDelta<Config> delta{&replica, &version};
+  ASSERT_TRUE(Decode(bytes, &delta));
+  EXPECT_EQ(2u, version);
+  EXPECT_EQ(Encode(config), Encode(replica));
+
+  // An empty delta is still a skippable structure.
+  Deserializer<BufferReader> deserializer{bytes.data(), bytes.size()};
+  EXPECT_TRUE(deserializer.Skip());
+}
+
+TEST(TableDelta, VersionMismatch) {
+  const Config previous = MakeConfig();
+  Config current = MakeConfig();
+  current.replicas = 4;
+
+  VectorWriter writer;
+  Serializer<VectorWriter*> serializer{&writer};
+  ASSERT_TRUE(serializer.Write(TableDelta<Config>{previous, 3, current, 4}));
+  ASSERT_TRUE(serializer.Write(std::string{"next"}));
+
+  Config replica = MakeConfig();
+  std::uint64_t version = 2;
+  TableDelta<Config> delta{&replica, &version};
+  BufferReader reader{writer.data().data(), writer.size()};
+  Deserializer<BufferReader*> deserializer{&reader};
+  Status<void> status = deserializer.Read(&delta);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::VersionMismatch, status.error());
+  EXPECT_EQ(2u, version);
+  EXPECT_EQ(3, replica.replicas.get());
+
+  // The rest of the delta was skipped.
+  std::string next;
+  ASSERT_TRUE(deserializer.Read(&next));
+  EXPECT_EQ("next", next);
+}
+
+TEST(TableDelta, UnknownEntries) {
+  ConfigV2 previous;
+  previous.name = std::string{"cluster"};
+  ConfigV2 current = previous;
+  current.region = std::string{"west"};
+  current.replicas = 2;
+
+  Config replica;
+  replica.name = std::string{"cluster"};
+  std::uint64_t version = 0;
+  TableDelta<Config> delta{&replica, &version};
+  ASSERT_TRUE(
+      Decode(Encode(TableDelta<ConfigV2>{previous, 0, current, 1}), &delta));
+  EXPECT_EQ(1u, version);
+  ASSERT_TRUE(replica.replicas);
+  EXPECT_EQ(2, replica.replicas.get());
+  EXPECT_EQ("cluster", replica.name.get());
+}
+
+TEST(TableDelta, Errors) {
+  // Deltas for other tables are rejected.
+  Other other;
+  other.value = 1;
+
+  Config replica;
+  std::uint64_t version = 0;
+  TableDelta<Config> delta{&replica, &version};
+  Status<void> status =
+      Decode(Encode(TableDelta<Other>{Other{}, 0, other, 1}), &delta);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidTableHash, status.error());
+  EXPECT_EQ(0u, version);
+
+  // A full table is not a delta.
+  status = Decode(Encode(MakeConfig()), &delta);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+}
@@ -0,0 +1,226 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/table.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/table_transcoder.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BufferReader;
+using nop::DefaultEntryConverter;
+using nop::DeletedEntry;
+using nop::Deserializer;
+using nop::Encode;
+using nop::Entry;
+using nop::EntryId;
+using nop::ErrorStatus;
+using nop::Status;
+using nop::TranscodeTable;
+using nop::VectorWriter;
+
+namespace {
+
+struct RecordV1 {
+  Entry<std::string, 0> name;
+  Entry<std::vector<int>, 1> samples;
+  Entry<std::int32_t, 2> count;
+  Entry<std::string, 3> legacy;
+  Entry<std::int32_t, 4> score;
+
+  NOP_TABLE_NS("Record", RecordV1, name, samples, count, legacy, score);
+};
+
+// RecordV1 as written by a newer producer with entries that neither version
+// below defines.
+struct RecordV1Extra {
+  Entry<std::string, 0> name;
+  Entry<std::int32_t, 2> count;
+  Entry<int, 5> level;
+  Entry<std::string, 9> extra;
+
+  NOP_TABLE_NS("Record", RecordV1Extra, name, count, level, extra);
+};
+
+// Widens count, retires legacy, turns score into a string, and adds level.
+struct RecordV2 {
+  Entry<std::string, 0> name;
+  Entry<std::vector<int>, 1> samples;
+  Entry<std::int64_t, 2> count;
+  Entry<std::string, 3, DeletedEntry> legacy;
+  Entry<std::string, 4> score;
+  Entry<int, 5> level;
+
+  NOP_TABLE_NS("Record", RecordV2, name, samples, count, legacy, score, level);
+};
+
+struct Other {
+  Entry<int, 0> value;
+
+  NOP_TABLE_NS("Other", Other, value);
+};
+
+struct ScoreConverter : DefaultEntryConverter {
+  using DefaultEntryConverter::operator();
+
+  Status<void> operator()(EntryId<4>, const std::int32_t& score,
+                          std::string* to) const {
+    if (score < 0)
+      return ErrorStatus::ProtocolError;
+    *to = std::to_string(score);
+    return {};
+  }
+};
+
+RecordV1 MakeRecord() {
+  RecordV1 record;
+  record.name = std::string{"sensor"};
+  record.samples = std::vector<int>{1, 2, 3, 5, 8, 13};
+  record.count = 6;
+  record.legacy = std::string(100, 'l');
+  record.score = 42;
+  return record;
+}
+
+}  // anonymous namespace
+
+TEST(TableTranscoder, Migrate) {
+  const std::vector<std::uint8_t> bytes = Encode(MakeRecord());
+
+  VectorWriter writer;
+  auto consumed = TranscodeTable<RecordV1, RecordV2>(
+      bytes.data(), bytes.size(), &writer, ScoreConverter{});
+  ASSERT_TRUE(consumed);
+  EXPECT_EQ(bytes.size(), consumed.get());
+
+  RecordV2 record;
+  Deserializer<BufferReader> deserializer{writer.data().data(),
+                                          writer.size()};
+  ASSERT_TRUE(deserializer.Read(&record));
+  EXPECT_TRUE(deserializer.reader().empty());
+  EXPECT_EQ("sensor", record.name.get());
+  EXPECT_EQ((std::vector<int>{1, 2, 3, 5, 8, 13}), record.samples.get());
+  EXPECT_EQ(6, record.count.get());
+  EXPECT_EQ("42", record.score.get());
+  EXPECT_FALSE(record.level);
+
+  // The output matches encoding the migrated record directly.
+  EXPECT_EQ(Encode(record), writer.data());
+}
+
+TEST(TableTranscoder, Verbatim) {
+  // Transcoding to the same definition copies every entry as it is.
+  const std::vector<std::uint8_t> bytes = Encode(MakeRecord());
+  VectorWriter writer;
+  ASSERT_TRUE((TranscodeTable<RecordV1, RecordV1>(bytes.data(), bytes.size(),
+                                                  &writer)));
+  EXPECT_EQ(bytes, writer.data());
+
+  // Entries unknown to From are copied when To defines them and dropped
+  // otherwise.
+  RecordV1Extra extra;
+  extra.name = std::string{"newer"};
+  extra.count = 1;
+  extra.level = 7;
+  extra.extra = std::string{"dropped"};
+  const std::vector<std::uint8_t> extra_bytes = Encode(extra);
+
+  writer.clear();
+  ASSERT_TRUE((TranscodeTable<RecordV1, RecordV2>(
+      extra_bytes.data(), extra_bytes.size(), &writer, ScoreConverter{})));
+
+  RecordV2 record;
+  Deserializer<BufferReader> deserializer{writer.data().data(),
+                                          writer.size()};
+  ASSERT_TRUE(deserializer.Read(&record));
+  EXPECT_EQ("newer", record.name.get());
+  EXPECT_EQ(1, record.count.get());
+  EXPECT_EQ(7, record.level.get());
+  EXPECT_FALSE(record.score);
+
+  RecordV2 expected;
+  expected.name = std::string{"newer"};
+  expected.count = 1;
+  expected.level = 7;
+  EXPECT_EQ(Encode(expected), writer.data());
+}
+
+TEST(TableTranscoder, Sequence) {
+  std::vector<std::uint8_t> bytes = Encode(MakeRecord());
+  RecordV1 second;
+  second.score = 7;
+  const std::vector<std::uint8_t> second_bytes = Encode(second);
+  bytes.insert(bytes.end(), second_bytes.begin(), second_bytes.end());
+
+  VectorWriter writer;
+  std::size_t offset = 0;
+  while (offset < bytes.size()) {
+    auto consumed = TranscodeTable<RecordV1, RecordV2>(
+        bytes.data() + offset, bytes.size() - offset, &writer,
+        ScoreConverter{});
+    ASSERT_TRUE(consumed);
+    offset += consumed.get();
+  }
+
+  Deserializer<BufferReader> deserializer{writer.data().data(),
+                                          writer.size()};
+  RecordV2 record;
+  ASSERT_TRUE(deserializer.Read(&record));
+  EXPECT_EQ("42", record.score.get());
+  ASSERT_TRUE(deserializer.Read(&record));
+  EXPECT_EQ("7", record.score.get());
+  EXPECT_FALSE(record.name);
+  EXPECT_TRUE(deserializer.reader().empty());
+}
+
+TEST(TableTranscoder, Errors) {
+  VectorWriter writer;
+
+  const std::vector<std::uint8_t> other_bytes = Encode(Other{});
+  auto consumed = TranscodeTable<RecordV1, RecordV2>(
+      other_bytes.data(), other_bytes.size(), &writer, ScoreConverter{});
+  ASSERT_FALSE(consumed);
+  EXPECT_EQ(ErrorStatus::InvalidTableHash, consumed.error());
+
+  const std::vector<std::uint8_t> string_bytes = Encode(std::string{"x"});
+  consumed = TranscodeTable<RecordV1, RecordV2>(
+      string_bytes.data(), string_bytes.size(), &writer, ScoreConverter{});
+  ASSERT_FALSE(consumed);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, consumed.error());
+
+  std::vector<std::uint8_t> bytes = Encode(MakeRecord());
+  bytes.pop_back();
+  consumed = TranscodeTable<RecordV1, RecordV2>(bytes.data(), bytes.size(),
+                                                &writer, ScoreConverter{});
+  ASSERT_FALSE(consumed);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, consumed.error());
+
+  // Converter errors are passed through.
+  RecordV1 record = MakeRecord();
+  record.score = -1;
+  bytes = Encode(record);
+  consumed = TranscodeTable<RecordV1, RecordV2>(bytes.data(), bytes.size(),
+                                                &writer, ScoreConverter{});
+  ASSERT_FALSE(consumed);
+  EXPECT_EQ(ErrorStatus::ProtocolError, consumed.error());
+}
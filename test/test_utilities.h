@@ -17,11 +17,17 @@
 #ifndef LIBNOP_TEST_TEST_UTILITIES_H_
 #define LIBNOP_TEST_TEST_UTILITIES_H_
 
+#include <gtest/gtest.h>
+
 #include <cstdint>
 #include <utility>
 #include <vector>
 
 #include <nop/base/utility.h>
+#include <nop/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
 
 namespace nop {
 
@@ -95,6 +101,34 @@ inline std::vector<std::uint8_t> Compose(Args&&... args) {
   return vector;
 }
 
+inline std::vector<std::uint8_t> TakeBytes(VectorWriter* writer) {
+  return writer->take();
+}
+
+// Unwraps writer adapters, such as ObjectTableWriter, down to the VectorWriter
+// holding the bytes.
+template <typename Writer>
+inline std::vector<std::uint8_t> TakeBytes(Writer* writer) {
+  return TakeBytes(&writer->writer());
+}
+
+// Serializes |value| through Writer, which must bottom out in a VectorWriter,
+// and returns the encoded bytes.
+template <typename Writer = VectorWriter, typename T>
+inline std::vector<std::uint8_t> Encode(const T& value) {
+  Serializer<Writer> serializer;
+  EXPECT_TRUE(serializer.Write(value));
+  return TakeBytes(&serializer.writer());
+}
+
+// Deserializes |value| from |bytes| through Reader, which must be constructible
+// from a pointer and size.
+template <typename Reader = BufferReader, typename T>
+inline Status<void> Decode(const std::vector<std::uint8_t>& bytes, T* value) {
+  Deserializer<Reader> deserializer{bytes.data(), bytes.size()};
+  return deserializer.Read(value);
+}
+
 }  // namespace nop
 
 #endif  // LIBNOP_TEST_TEST_UTILITIES_H_
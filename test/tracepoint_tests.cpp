@@ -0,0 +1,135 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <nop/rpc/interface.h>
+#include <nop/rpc/simple_method_receiver.h>
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/fd_reader.h>
+#include <nop/utility/fd_writer.h>
+#include <nop/utility/vector_writer.h>
+
+// This file is built into the instrumentation test binary with
+// NOP_ENABLE_TRACEPOINTS defined to 1; see the Makefile.
+static_assert(NOP_HAS_TRACEPOINTS,
+              "Tracepoint tests require NOP_ENABLE_TRACEPOINTS.");
+
+using nop::BindInterface;
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::FdReader;
+using nop::FdWriter;
+using nop::Interface;
+using nop::Serializer;
+using nop::VectorWriter;
+
+namespace {
+
+struct Sample {
+  std::uint32_t id;
+  std::string label;
+  NOP_STRUCTURE(Sample, id, label);
+};
+
+struct Service : Interface<Service> {
+  NOP_INTERFACE("io.github.eieio.TracepointService");
+  NOP_METHOD(Double, int(int value));
+  NOP_INTERFACE_API(Double);
+};
+
+// Sets every semaphore, as an attached tracer would.
+void SetSemaphores(unsigned short value) {
+  nop_write_entry_semaphore = value;
+  nop_write_exit_semaphore = value;
+  nop_read_entry_semaphore = value;
+  nop_read_exit_semaphore = value;
+  nop_dispatch_semaphore = value;
+  nop_dispatch_id_semaphore = value;
+  nop_fd_read_semaphore = value;
+  nop_fd_write_semaphore = value;
+}
+
+}  // anonymous namespace
+
+TEST(Tracepoints, Notes) {
+  EXPECT_FALSE(NOP_TRACEPOINT_ACTIVE(write_entry));
+  EXPECT_FALSE(NOP_TRACEPOINT_ACTIVE(fd_read));
+
+  // The probes are described by SDT notes in the executable.
+  std::ifstream file{"/proc/self/exe", std::ios::binary};
+  ASSERT_TRUE(file);
+  const std::string image{std::istreambuf_iterator<char>{file},
+                          std::istreambuf_iterator<char>{}};
+  EXPECT_NE(std::string::npos, image.find(".note.stapsdt"));
+  for (const char* name : {"write_entry", "write_exit", "read_entry",
+                           "read_exit", "dispatch", "fd_read", "fd_write"}) {
+    EXPECT_NE(std::string::npos, image.find(std::string{"nop"} + '\0' + name))
+        << name;
+  }
+}
+
+TEST(Tracepoints, Active) {
+  // Firing the probes does not change the results.
+  SetSemaphores(1);
+  EXPECT_TRUE(NOP_TRACEPOINT_ACTIVE(write_entry));
+
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(Sample{7, "seven"}));
+  Sample sample;
+  Deserializer<BufferReader> deserializer{serializer.writer().data().data(),
+                                          serializer.writer().size()};
+  ASSERT_TRUE(deserializer.Read(&sample));
+  EXPECT_EQ(7u, sample.id);
+  EXPECT_EQ("seven", sample.label);
+
+  int fds[2];
+  ASSERT_EQ(0, ::pipe(fds));
+  Serializer<FdWriter> fd_serializer{fds[1]};
+  Deserializer<FdReader> fd_deserializer{fds[0]};
+  ASSERT_TRUE(fd_serializer.Write(Sample{8, "eight"}));
+  ASSERT_TRUE(fd_deserializer.Read(&sample));
+  EXPECT_EQ(8u, sample.id);
+
+  VectorWriter reply;
+  Serializer<VectorWriter*> reply_serializer{&reply};
+  Serializer<VectorWriter> request;
+  ASSERT_TRUE(request.Write(Service::Double::Selector));
+  ASSERT_TRUE(request.Write(std::make_tuple(21)));
+  Deserializer<BufferReader> request_deserializer{
+      request.writer().data().data(), request.writer().size()};
+  auto receiver =
+      MakeSimpleMethodReceiver(&reply_serializer, &request_deserializer);
+  auto bindings =
+      BindInterface(Service::Double::Bind([](int value) { return 2 * value; }));
+  ASSERT_TRUE(bindings(&receiver));
+
+  int result = 0;
+  Deserializer<BufferReader> reply_deserializer{reply.data().data(),
+                                                reply.size()};
+  ASSERT_TRUE(reply_deserializer.Read(&result));
+  EXPECT_EQ(42, result);
+
+  SetSemaphores(0);
+}
@@ -0,0 +1,242 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nop/base/handle.h>
+#include <nop/schema_fingerprint.h>
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/optional.h>
+#include <nop/types/variant.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/trusted_deserializer.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BufferReader;
+using nop::Encode;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::HasSchemaFingerprint;
+using nop::IsTrustedReader;
+using nop::Optional;
+using nop::PedanticBufferReader;
+using nop::SchemaFingerprint;
+using nop::Status;
+using nop::TrustedDeserializer;
+using nop::TrustedReader;
+using nop::UniqueHandle;
+using nop::Variant;
+
+namespace {
+
+struct Point {
+  std::int32_t x;
+  std::int32_t y;
+  NOP_STRUCTURE(Point, x, y);
+};
+
+// Same shape as Point, with different names.
+struct Coordinate {
+  std::int32_t row;
+  std::int32_t column;
+  NOP_STRUCTURE(Coordinate, row, column);
+};
+
+struct WidePoint {
+  std::int64_t x;
+  std::int64_t y;
+  NOP_STRUCTURE(WidePoint, x, y);
+};
+
+struct UnsignedPoint {
+  std::uint32_t x;
+  std::uint32_t y;
+  NOP_STRUCTURE(UnsignedPoint, x, y);
+};
+
+struct Order {
+  std::uint64_t id;
+  std::string symbol;
+  std::vector<Point> path;
+  Optional<double> limit;
+  Variant<std::int32_t, std::string> tag;
+  std::map<std::string, std::int32_t> attributes;
+  NOP_STRUCTURE(Order, id, symbol, path, limit, tag, attributes);
+};
+
+struct ReorderedOrder {
+  std::string symbol;
+  std::uint64_t id;
+  std::vector<Point> path;
+  Optional<double> limit;
+  Variant<std::int32_t, std::string> tag;
+  std::map<std::string, std::int32_t> attributes;
+  NOP_STRUCTURE(ReorderedOrder, symbol, id, path, limit, tag, attributes);
+};
+
+struct Config {
+  Entry<std::int32_t, 0> version;
+  Entry<std::string, 1> name;
+  NOP_TABLE_NS("Config", Config, version, name);
+};
+
+struct RenamedConfig {
+  Entry<std::int32_t, 0> version;
+  Entry<std::string, 1> name;
+  NOP_TABLE_NS("OtherConfig", RenamedConfig, version, name);
+};
+
+struct RenumberedConfig {
+  Entry<std::int32_t, 0> version;
+  Entry<std::string, 2> name;
+  NOP_TABLE_NS("Config", RenumberedConfig, version, name);
+};
+
+struct HandlePolicy {
+  using Type = int;
+  static constexpr int Default() { return -1; }
+  static bool IsValid(int value) { return value >= 0; }
+  static void Close(int*) {}
+  static void Release(int*) {}
+};
+
+struct Message {
+  std::int32_t id;
+  UniqueHandle<HandlePolicy> handle;
+  NOP_STRUCTURE(Message, id, handle);
+};
+
+template <typename T>
+constexpr std::uint64_t FingerprintOf() {
+  return SchemaFingerprint<T>::Value;
+}
+
+Order MakeOrder() {
+  Order order;
+  order.id = 42;
+  order.symbol = "NOP";
+  order.path = {{1, 2}, {-3, 4}, {500000, -600000}};
+  order.limit = 1.25;
+  order.tag = std::string{"tag"};
+  order.attributes = {{"a", 1}, {"b", -2}};
+  return order;
+}
+
+}  // anonymous namespace
+
+TEST(SchemaFingerprint, Shape) {
+  // Fingerprints are compile-time constants.
+  static_assert(FingerprintOf<Point>() != 0, "");
+
+  EXPECT_EQ(FingerprintOf<Point>(), FingerprintOf<Point>());
+  EXPECT_EQ(FingerprintOf<Point>(), FingerprintOf<Coordinate>());
+  EXPECT_NE(FingerprintOf<Point>(), FingerprintOf<WidePoint>());
+  EXPECT_NE(FingerprintOf<Point>(), FingerprintOf<UnsignedPoint>());
+  EXPECT_NE(FingerprintOf<Order>(), FingerprintOf<ReorderedOrder>());
+
+  EXPECT_NE(FingerprintOf<std::int8_t>(), FingerprintOf<std::uint8_t>());
+  EXPECT_NE(FingerprintOf<float>(), FingerprintOf<double>());
+  EXPECT_NE(FingerprintOf<std::vector<int>>(),
+            FingerprintOf<std::vector<long>>());
+  EXPECT_NE(FingerprintOf<std::vector<int>>(), FingerprintOf<Optional<int>>());
+
+  using IntArray3 = std::array<int, 3>;
+  using IntArray4 = std::array<int, 4>;
+  EXPECT_NE(FingerprintOf<IntArray3>(), FingerprintOf<IntArray4>());
+
+  using IntStringVariant = Variant<int, std::string>;
+  using StringIntVariant = Variant<std::string, int>;
+  EXPECT_NE(FingerprintOf<IntStringVariant>(),
+            FingerprintOf<StringIntVariant>());
+}
+
+TEST(SchemaFingerprint, Tables) {
+  EXPECT_NE(FingerprintOf<Config>(), FingerprintOf<RenamedConfig>());
+  EXPECT_NE(FingerprintOf<Config>(), FingerprintOf<RenumberedConfig>());
+}
+
+TEST(SchemaFingerprint, Unsupported) {
+  EXPECT_TRUE(HasSchemaFingerprint<Order>::value);
+  EXPECT_TRUE(HasSchemaFingerprint<Config>::value);
+  EXPECT_FALSE(HasSchemaFingerprint<UniqueHandle<HandlePolicy>>::value);
+  EXPECT_FALSE(HasSchemaFingerprint<Message>::value);
+  EXPECT_FALSE(HasSchemaFingerprint<std::vector<Message>>::value);
+}
+
+TEST(TrustedDeserializer, Trust) {
+  EXPECT_FALSE(IsTrustedReader<BufferReader>::value);
+  EXPECT_TRUE(IsTrustedReader<TrustedReader<BufferReader>>::value);
+
+  const std::vector<std::uint8_t> bytes = Encode(MakeOrder());
+  TrustedDeserializer<Order, BufferReader> deserializer{bytes.data(),
+                                                       bytes.size()};
+  EXPECT_FALSE(deserializer.trusted());
+
+  Status<void> status = deserializer.Trust(FingerprintOf<ReorderedOrder>());
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::VersionMismatch, status.error());
+  EXPECT_FALSE(deserializer.trusted());
+
+  ASSERT_TRUE(deserializer.Trust(FingerprintOf<Order>()));
+  EXPECT_TRUE(deserializer.trusted());
+
+  Order order;
+  ASSERT_TRUE(deserializer.Read(&order));
+  EXPECT_EQ(42u, order.id);
+  EXPECT_EQ("NOP", order.symbol);
+  ASSERT_EQ(3u, order.path.size());
+  EXPECT_EQ(500000, order.path[2].x);
+  EXPECT_EQ(-600000, order.path[2].y);
+  ASSERT_FALSE(order.limit.empty());
+  EXPECT_EQ(1.25, order.limit.get());
+  ASSERT_TRUE(order.tag.is<std::string>());
+  EXPECT_EQ("tag", *order.tag.get<std::string>());
+  EXPECT_EQ(MakeOrder().attributes, order.attributes);
+  EXPECT_TRUE(deserializer.reader().empty());
+}
+
+TEST(TrustedDeserializer, Validation) {
+  // The validating path rejects a mismatched encoding that the trusted path
+  // would accept.
+  const std::vector<std::uint8_t> bytes = Encode(WidePoint{1ll << 40, 2});
+  TrustedDeserializer<Point, BufferReader> deserializer{bytes.data(),
+                                                       bytes.size()};
+  Point point;
+  Status<void> status = deserializer.Read(&point);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+
+  // Bounds checks of the reader still apply on the trusted path.
+  std::vector<std::uint8_t> truncated = Encode(MakeOrder());
+  truncated.resize(truncated.size() / 2);
+  TrustedDeserializer<Order, PedanticBufferReader> truncated_deserializer{
+      truncated.data(), truncated.size()};
+  ASSERT_TRUE(truncated_deserializer.Trust(FingerprintOf<Order>()));
+
+  Order order;
+  status = truncated_deserializer.Read(&order);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
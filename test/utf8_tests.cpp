@@ -0,0 +1,156 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/string_view.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/utf8.h>
+#include <nop/utility/utf8_validating_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::Encode;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::IsUtf8ValidatingReader;
+using nop::Status;
+using nop::StringView;
+using nop::Utf8ValidatingReader;
+using nop::ValidateUtf8;
+
+namespace {
+
+struct Request {
+  std::int32_t id;
+  std::string path;
+  std::vector<std::string> headers;
+  NOP_STRUCTURE(Request, id, path, headers);
+};
+
+struct Options {
+  Entry<std::string, 0> name;
+  NOP_TABLE_NS("Options", Options, name);
+};
+
+bool Validate(const std::string& value) {
+  return ValidateUtf8(value.data(), value.size());
+}
+
+template <typename T>
+Status<void> ValidatingDecode(const std::vector<std::uint8_t>& bytes,
+                              T* value) {
+  BufferReader buffer_reader{bytes.data(), bytes.size()};
+  Utf8ValidatingReader<BufferReader> reader{&buffer_reader};
+  Deserializer<Utf8ValidatingReader<BufferReader>*> deserializer{&reader};
+  return deserializer.Read(value);
+}
+
+}  // anonymous namespace
+
+TEST(Utf8, Validate) {
+  EXPECT_TRUE(Validate(""));
+  EXPECT_TRUE(Validate("plain ascii"));
+  EXPECT_TRUE(Validate("\x7f"));
+  EXPECT_TRUE(Validate("\xc2\x80"));              // U+0080
+  EXPECT_TRUE(Validate("\xdf\xbf"));              // U+07FF
+  EXPECT_TRUE(Validate("\xe0\xa0\x80"));          // U+0800
+  EXPECT_TRUE(Validate("\xed\x9f\xbf"));          // U+D7FF
+  EXPECT_TRUE(Validate("\xee\x80\x80"));          // U+E000
+  EXPECT_TRUE(Validate("\xef\xbf\xbf"));          // U+FFFF
+  EXPECT_TRUE(Validate("\xf0\x90\x80\x80"));      // U+10000
+  EXPECT_TRUE(Validate("\xf4\x8f\xbf\xbf"));      // U+10FFFF
+  EXPECT_TRUE(Validate("na\xc3\xafve caf\xc3\xa9"));
+
+  EXPECT_FALSE(Validate("\x80"));                 // Continuation byte.
+  EXPECT_FALSE(Validate("\xc0\x80"));             // Overlong U+0000.
+  EXPECT_FALSE(Validate("\xc1\xbf"));             // Overlong U+007F.
+  EXPECT_FALSE(Validate("\xe0\x9f\xbf"));         // Overlong U+07FF.
+  EXPECT_FALSE(Validate("\xed\xa0\x80"));         // Surrogate U+D800.
+  EXPECT_FALSE(Validate("\xf0\x8f\xbf\xbf"));     // Overlong U+FFFF.
+  EXPECT_FALSE(Validate("\xf4\x90\x80\x80"));     // U+110000.
+  EXPECT_FALSE(Validate("\xf5\x80\x80\x80"));
+  EXPECT_FALSE(Validate("\xff"));
+  EXPECT_FALSE(Validate("\xc3"));                 // Truncated.
+  EXPECT_FALSE(Validate("\xe2\x82"));             // Truncated.
+  EXPECT_FALSE(Validate("\xe2\x28\xa1"));         // Bad continuation.
+}
+
+TEST(Utf8, BlockBoundaries) {
+  // Place valid and invalid sequences at every offset across the vector
+  // blocks used to skip ASCII.
+  for (std::size_t offset = 0; offset < 80; offset++) {
+    std::string valid(100, 'a');
+    valid.replace(offset, 4, "\xf0\x9f\x98\x80");
+    EXPECT_TRUE(Validate(valid)) << "offset " << offset;
+
+    std::string invalid(100, 'a');
+    invalid[offset] = '\xc0';
+    EXPECT_FALSE(Validate(invalid)) << "offset " << offset;
+
+    std::string truncated(offset + 1, 'a');
+    truncated[offset] = '\xe2';
+    EXPECT_FALSE(Validate(truncated)) << "offset " << offset;
+  }
+}
+
+TEST(Utf8, ValidatingReader) {
+  EXPECT_FALSE(IsUtf8ValidatingReader<BufferReader>::value);
+  using ValidatingReader = Utf8ValidatingReader<BufferReader>;
+  EXPECT_TRUE(IsUtf8ValidatingReader<ValidatingReader>::value);
+
+  const Request request{
+      1, "/caf\xc3\xa9", {"accept: */*", "x-name: \xe2\x82\xac"}};
+  Request decoded;
+  ASSERT_TRUE(ValidatingDecode(Encode(request), &decoded));
+  EXPECT_EQ(request.path, decoded.path);
+  EXPECT_EQ(request.headers, decoded.headers);
+
+  // Malformed strings nested in containers are rejected.
+  const Request bad{2, "/ok", {"accept: */*", "x-name: \xed\xa0\x80"}};
+  const std::vector<std::uint8_t> bytes = Encode(bad);
+  Status<void> status = ValidatingDecode(bytes, &decoded);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidUtf8, status.error());
+
+  // The default readers accept any bytes.
+  Deserializer<BufferReader> deserializer{bytes.data(), bytes.size()};
+  EXPECT_TRUE(deserializer.Read(&decoded));
+
+  // Table entries and borrowed string views are validated as well.
+  Options options;
+  options.name = std::string{"\xc0\xaf"};
+  Options decoded_options;
+  status = ValidatingDecode(Encode(options), &decoded_options);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidUtf8, status.error());
+
+  StringView view;
+  status = ValidatingDecode(Encode(std::string{"\xff"}), &view);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::InvalidUtf8, status.error());
+  ASSERT_TRUE(ValidatingDecode(Encode(std::string{"\xc3\xa9"}), &view));
+  EXPECT_EQ(2u, view.size());
+}
@@ -20,6 +20,7 @@
 
 #include <nop/base/utility.h>
 #include <nop/structure.h>
+#include <nop/utility/key_index_map.h>
 
 using nop::EnableIfHasMemberList;
 using nop::EnableIfNotHasMemberList;
@@ -28,6 +29,7 @@ using nop::HasMemberList;
 using nop::IsIntegral;
 using nop::IsSame;
 using nop::IsUnique;
+using nop::KeyIndexMap;
 
 namespace {
 
@@ -143,3 +145,41 @@ TEST(Utility, IsSame) {
   EXPECT_FALSE((IsSame<std::is_same, int, float, int>::value));
   EXPECT_FALSE((IsSame<std::is_same, int, int, float>::value));
 }
+
+TEST(Utility, KeyIndexMap) {
+  {
+    constexpr KeyIndexMap<std::uint64_t, 4> map{{2, 0, 3, 1}};
+    static_assert(map.contiguous(), "Keys should be contiguous.");
+    static_assert(map.Find(2) == 0, "Wrong index for key 2.");
+
+    EXPECT_EQ(1u, map.Find(0));
+    EXPECT_EQ(3u, map.Find(1));
+    EXPECT_EQ(0u, map.Find(2));
+    EXPECT_EQ(2u, map.Find(3));
+    EXPECT_EQ(4u, map.Find(4));
+    EXPECT_EQ(4u, map.Find(~0ull));
+  }
+
+  {
+    constexpr KeyIndexMap<std::int32_t, 5> map{{100, -7, 42, 8, 1000000}};
+    static_assert(!map.contiguous(), "Keys should not be contiguous.");
+    static_assert(map.Find(42) == 2, "Wrong index for key 42.");
+
+    EXPECT_EQ(0u, map.Find(100));
+    EXPECT_EQ(1u, map.Find(-7));
+    EXPECT_EQ(2u, map.Find(42));
+    EXPECT_EQ(3u, map.Find(8));
+    EXPECT_EQ(4u, map.Find(1000000));
+    EXPECT_EQ(5u, map.Find(-8));
+    EXPECT_EQ(5u, map.Find(0));
+    EXPECT_EQ(5u, map.Find(43));
+    EXPECT_EQ(5u, map.Find(1000001));
+  }
+
+  {
+    constexpr KeyIndexMap<std::uint8_t, 1> map{{7}};
+    EXPECT_EQ(0u, map.Find(7));
+    EXPECT_EQ(1u, map.Find(6));
+    EXPECT_EQ(1u, map.Find(8));
+  }
+}
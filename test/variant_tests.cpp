@@ -41,6 +41,17 @@ struct DerivedType : BaseType {
   DerivedType(const BaseType& other) : BaseType{other} {}
 };
 
+using ManyVariant =
+    Variant<std::int8_t, std::uint8_t, std::int16_t, std::uint16_t,
+            std::int32_t, std::uint32_t, std::int64_t, std::uint64_t, float,
+            double, bool, std::string>;
+
+template <typename T>
+std::int32_t ManyIndexOf(const T&) {
+  return ManyVariant{}.index_of<T>();
+}
+std::int32_t ManyIndexOf(EmptyVariant) { return ManyVariant::kEmptyIndex; }
+
 template <typename T>
 class TestType {
  public:
@@ -947,6 +958,47 @@ TEST(Variant, Become) {
   }
 }
 
+TEST(Variant, VisitManyElements) {
+  const std::int32_t kElementCount = 12;
+
+  // Every index selects the element of the matching type.
+  for (std::int32_t i = -1; i < kElementCount; i++) {
+    ManyVariant v;
+    v.Become(i);
+    ASSERT_EQ(i, v.index());
+
+    std::int32_t visited_index = -2;
+    v.Visit([&visited_index](const auto& value) {
+      visited_index = ManyIndexOf(value);
+    });
+    EXPECT_EQ(i, visited_index);
+
+    const ManyVariant& const_v = v;
+    EXPECT_EQ(i, const_v.Visit(
+                     [](const auto& value) { return ManyIndexOf(value); }));
+  }
+
+  {
+    ManyVariant v{std::string{"test"}};
+    ASSERT_TRUE(v.is<std::string>());
+
+    ManyVariant copy{v};
+    ASSERT_TRUE(copy.is<std::string>());
+    EXPECT_EQ("test", std::get<std::string>(copy));
+
+    v = 10.0;
+    ASSERT_TRUE(v.is<double>());
+    EXPECT_DOUBLE_EQ(10.0, std::get<double>(v));
+
+    v.Become(kElementCount - 1);
+    ASSERT_TRUE(v.is<std::string>());
+    EXPECT_TRUE(std::get<std::string>(v).empty());
+
+    v.Become(kElementCount);
+    EXPECT_TRUE(v.empty());
+  }
+}
+
 TEST(Variant, Swap) {
   {
     Variant<std::string> a;
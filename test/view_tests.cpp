@@ -0,0 +1,168 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <nop/base/max_encoded_size.h>
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/types/view.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BufferReader;
+using nop::Compose;
+using nop::Deserializer;
+using nop::Encode;
+using nop::EncodingByte;
+using nop::ErrorStatus;
+using nop::FixedEncoding;
+using nop::Integer;
+using nop::IsFixedStructure;
+using nop::MaxEncodedSize;
+using nop::Status;
+using nop::View;
+
+namespace {
+
+enum class Side : std::uint8_t { Bid, Ask };
+
+struct Level {
+  std::int64_t price;
+  std::uint32_t quantity;
+
+  NOP_FIXED_STRUCTURE(Level, price, quantity);
+};
+
+struct Quote {
+  std::uint64_t timestamp;
+  std::array<char, 4> symbol;
+  Side side;
+  bool firm;
+  double spread;
+  Level level;
+
+  NOP_FIXED_STRUCTURE(Quote, timestamp, symbol, side, firm, spread, level);
+};
+
+// The same members with the default, compact encoding.
+struct CompactLevel {
+  std::int64_t price;
+  std::uint32_t quantity;
+
+  NOP_STRUCTURE(CompactLevel, price, quantity);
+};
+
+Quote MakeQuote() {
+  return {1234, {{'N', 'O', 'P', '!'}}, Side::Ask, true, 0.25, {-5, 100}};
+}
+
+}  // anonymous namespace
+
+TEST(FixedStructure, Encoding) {
+  static_assert(IsFixedStructure<Quote>::value, "");
+  static_assert(!IsFixedStructure<CompactLevel>::value, "");
+
+  EXPECT_EQ(Compose(EncodingByte::Structure, 2, EncodingByte::I64,
+                    Integer<std::int64_t>(-5), EncodingByte::U32,
+                    Integer<std::uint32_t>(100)),
+            Encode(Level{-5, 100}));
+  EXPECT_EQ(Compose(EncodingByte::Structure, 2, -5, 100),
+            Encode(CompactLevel{-5, 100}));
+
+  // Every value has the same size, which is also the maximum size.
+  const std::size_t size = FixedEncoding<Quote>::Size;
+  EXPECT_EQ(size, Encode(MakeQuote()).size());
+  EXPECT_EQ(size, Encode(Quote{}).size());
+  EXPECT_EQ(size, nop::Encoding<Quote>::Size(Quote{}));
+  EXPECT_EQ(size, MaxEncodedSize<Quote>::value);
+
+  // Fixed and compact encodings decode into either type.
+  Deserializer<BufferReader> deserializer;
+  std::vector<std::uint8_t> bytes = Encode(Level{-5, 100});
+  CompactLevel compact;
+  deserializer = Deserializer<BufferReader>{bytes.data(), bytes.size()};
+  ASSERT_TRUE(deserializer.Read(&compact));
+  EXPECT_EQ(-5, compact.price);
+  EXPECT_EQ(100u, compact.quantity);
+
+  bytes = Encode(CompactLevel{7, 8});
+  Level level;
+  deserializer = Deserializer<BufferReader>{bytes.data(), bytes.size()};
+  ASSERT_TRUE(deserializer.Read(&level));
+  EXPECT_EQ(7, level.price);
+  EXPECT_EQ(8u, level.quantity);
+}
+
+TEST(FixedStructure, View) {
+  const Quote quote = MakeQuote();
+  const std::vector<std::uint8_t> bytes = Encode(quote);
+
+  auto view = View<Quote>::Create(bytes.data(), bytes.size());
+  ASSERT_TRUE(view);
+  EXPECT_EQ(bytes.data(), view.get().data());
+  EXPECT_EQ(bytes.size(), view.get().size());
+
+  using Symbol = NOP_VIEW_MEMBER(Quote, symbol);
+  using Firm = NOP_VIEW_MEMBER(Quote, firm);
+  using Price = NOP_VIEW_MEMBER(Level, price);
+  const View<Quote>& quote_view = view.get();
+  EXPECT_EQ(1234u, quote_view.Get<0>());
+  EXPECT_EQ(quote.symbol, quote_view.Get<Symbol>());
+  EXPECT_EQ(Side::Ask, quote_view.Get<2>());
+  EXPECT_TRUE(quote_view.Get<Firm>());
+  EXPECT_EQ(0.25, quote_view.Get<4>());
+
+  auto level = quote_view.Get<NOP_VIEW_MEMBER(Quote, level)>();
+  EXPECT_EQ(-5, level.Get<Price>());
+  EXPECT_EQ(100u, level.Get<1>());
+
+  Quote decoded;
+  ASSERT_TRUE(view.get().Decode(&decoded));
+  EXPECT_EQ(quote.timestamp, decoded.timestamp);
+  EXPECT_EQ(quote.level.quantity, decoded.level.quantity);
+}
+
+TEST(FixedStructure, ViewErrors) {
+  std::vector<std::uint8_t> bytes = Encode(MakeQuote());
+
+  Status<View<Quote>> view =
+      View<Quote>::Create(bytes.data(), bytes.size() - 1);
+  ASSERT_FALSE(view);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, view.error());
+
+  // Compact encodings do not have the fixed layout.
+  std::vector<std::uint8_t> compact = Encode(CompactLevel{1, 2});
+  auto level_view = View<Level>::Create(compact.data(), compact.size());
+  ASSERT_FALSE(level_view);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, level_view.error());
+
+  compact.resize(View<Level>::Size);
+  level_view = View<Level>::Create(compact.data(), compact.size());
+  ASSERT_FALSE(level_view);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, level_view.error());
+
+  // Nested members are checked as well.
+  bytes[bytes.size() - 5] = static_cast<std::uint8_t>(EncodingByte::I32);
+  view = View<Quote>::Create(bytes.data(), bytes.size());
+  ASSERT_FALSE(view);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, view.error());
+}
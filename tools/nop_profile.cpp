@@ -0,0 +1,86 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <nop/utility/encoding_profiler.h>
+
+//
+// Prints a breakdown of the bytes of a serialized value by position within
+// the value and by encoding, without knowing its C++ type. Reads the value from
+// the given file or from stdin.
+//
+// Usage: nop_profile [--depth N] [FILE]
+//
+
+namespace {
+
+int Usage(const char* program) {
+  std::cerr << "Usage: " << program << " [--depth N] [FILE]" << std::endl;
+  return 2;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  std::size_t depth = nop::kMaxSkipDepth;
+  const char* path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+      depth = std::strtoul(argv[++i], nullptr, 10);
+    else if (argv[i][0] == '-' && argv[i][1] != '\0')
+      return Usage(argv[0]);
+    else if (path == nullptr)
+      path = argv[i];
+    else
+      return Usage(argv[0]);
+  }
+
+  std::vector<std::uint8_t> data;
+  if (path == nullptr || std::strcmp(path, "-") == 0) {
+    data.assign(std::istreambuf_iterator<char>{std::cin},
+                std::istreambuf_iterator<char>{});
+  } else {
+    std::ifstream file{path, std::ios::binary};
+    if (!file) {
+      std::cerr << "Failed to open " << path << std::endl;
+      return 1;
+    }
+    data.assign(std::istreambuf_iterator<char>{file},
+                std::istreambuf_iterator<char>{});
+  }
+
+  auto profile = nop::ProfileEncoding(data.data(), data.size());
+  if (!profile) {
+    std::cerr << "Failed to profile encoding: " << profile.GetErrorMessage()
+              << std::endl;
+    return 1;
+  }
+
+  std::cout << profile.get().Report(depth);
+  if (profile.get().root().total.total() != data.size()) {
+    std::cout << "\n"
+              << data.size() - profile.get().root().total.total()
+              << " trailing bytes after the value were not profiled."
+              << std::endl;
+  }
+  return 0;
+}